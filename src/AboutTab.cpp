@@ -35,8 +35,13 @@
 #include "AboutTab.hpp"
 
 #include "App.hpp"
+#include "curl_share.hpp"
+#include "humanize.hpp"
 #include "IconsFontAwesome4.h"
 #include "IconManager.hpp"
+#include "net/resolver.hpp"
+#include "Profiler.hpp"
+#include "StationIndex.hpp"
 #include "string_utils.hpp"
 #include "UI.hpp"
 
@@ -201,6 +206,8 @@ namespace AboutTab {
     void
     process_ui()
     {
+        PROFILE_SCOPE("AboutTab::process_ui");
+
         // Note: flat navigation doesn't work well on child windows that scroll.
         if (ImGui::RAII::Child about{"about"}) {
 
@@ -224,6 +231,27 @@ namespace AboutTab {
 #else
                 UI::show_info_row("Save folder", App::get_config_path());
 #endif
+                auto cs = curl_share::get_stats();
+                auto total = cs.new_connections + cs.reused_connections;
+                UI::show_info_row("Connections",
+                                  string_utils::cpp_sprintf("%llu new, %llu reused (%llu%%)",
+                                                            static_cast<unsigned long long>(cs.new_connections),
+                                                            static_cast<unsigned long long>(cs.reused_connections),
+                                                            static_cast<unsigned long long>(total
+                                                                ? 100 * cs.reused_connections / total
+                                                                : 0)));
+                auto dns = net::resolver::cache::get_stats();
+                UI::show_info_row("DNS cache",
+                                  string_utils::cpp_sprintf("%llu hits, %llu misses, %zu entries",
+                                                            static_cast<unsigned long long>(dns.hits),
+                                                            static_cast<unsigned long long>(dns.misses),
+                                                            dns.entries));
+                auto idx = StationIndex::get_stats();
+                UI::show_info_row("Station index",
+                                  string_utils::cpp_sprintf("%zu stations, %sB, %s",
+                                                            idx.stations,
+                                                            humanize::value(idx.bytes).c_str(),
+                                                            idx.status.c_str()));
             }
 
             ImGui::SeparatorText("Credits");
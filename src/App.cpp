@@ -6,6 +6,7 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <iostream>
 #include <memory>
@@ -41,17 +42,37 @@
 #include "App.hpp"
 
 #include "AboutTab.hpp"
+#include "audio_output.hpp"
 #include "BrowserTab.hpp"
 #include "cfg.hpp"
+#include "curl_share.hpp"
+#include "decoder.hpp"
 #include "FavoritesTab.hpp"
 #include "FontManager.hpp"
+#include "http_client.hpp"
 #include "IconManager.hpp"
 #include "IconsFontAwesome4.h"
+#include "logging.hpp"
+#include "net/resolver.hpp"
 #include "PlayerTab.hpp"
+#include "Profiler.hpp"
+#include "radio_client.hpp"
 #include "RadioBrowserAPI.hpp"
 #include "RecentTab.hpp"
+#include "resolved_url_cache.hpp"
+#include "rest.hpp"
+#include "scheduler.hpp"
+#include "Serializer.hpp"
 #include "SettingsTab.hpp"
+#include "socket_tuning.hpp"
+#include "startup_graph.hpp"
+#include "station_prober.hpp"
+#include "StationIndex.hpp"
+#include "StatsPanel.hpp"
+#include "stream_recorder.hpp"
 #include "Styles.hpp"
+#include "Telemetry.hpp"
+#include "thread_policy.hpp"
 #include "tracer.hpp"
 #include "UI.hpp"
 
@@ -89,6 +110,18 @@ namespace App {
     void
     draw();
 
+    bool
+    should_draw();
+
+    void
+    wait_for_activity();
+
+    void
+    check_loading();
+
+    void
+    show_loading();
+
 
     namespace {
 
@@ -138,8 +171,36 @@ namespace App {
 
         Uint64 fade_duration_ms = 5'000;
 
+        /*
+         * Frame pacing: frames are only drawn after input, after a redraw request, or on a
+         * slow heartbeat; otherwise the main loop sleeps. The logic still runs at
+         * logic_tick_ms while there are network requests to process.
+         */
+
+        // Keep drawing for this many frames after something happened, so ImGui settles.
+        const unsigned settle_frames = 30;
+        unsigned settle_countdown = settle_frames;
+
+        const Uint64 heartbeat_ms = 250;
+        const Uint64 screen_saver_heartbeat_ms = 1'000;
+        const Uint64 animation_heartbeat_ms = 33;
+        const Uint32 logic_tick_ms = 20;
+
+        Uint64 last_draw = 0;
+
+        std::atomic_bool redraw_requested = false;
+        // Reset at the start of every frame.
+        bool animating = false;
+        Uint32 wake_event_type = 0;
+
         std::filesystem::path config_path;
 
+        // Only exists while the startup steps are running.
+        std::optional<startup_graph> startup;
+
+        // The tabs' data is still being loaded by the startup workers.
+        bool loading = true;
+
     } // namespace
 
 
@@ -307,59 +368,165 @@ namespace App {
     {
         TRACE_FUNC;
 
-        initialize_config_dir();
-        // Note: initialize cfg module early.
-        cfg::initialize();
-        set_tab(cfg::state.initial_tab);
-        if (cfg::state.remember_tab)
-            cfg::state.initial_tab = TabID::last_active;
+        // Note: first, so everything else can log without blocking.
+        logging::initialize();
+
+        /*
+         * Startup runs as a dependency graph: everything that touches SDL, the renderer
+         * or ImGui stays on the main thread, while the file loads run on workers. The
+         * main loop starts as soon as the main thread steps are done; the tabs show a
+         * placeholder until the workers finish.
+         */
+        using enum startup_graph::where;
+        startup.emplace();
+        auto& graph = *startup;
+
+        graph.add("config_dir", {}, main, initialize_config_dir);
+        graph.add("serializer", {}, main, Serializer::initialize);
+        graph.add("scheduler", {}, main,
+                  []
+                  {
+                      scheduler::initialize(request_redraw);
+                  });
+
+        graph.add("cfg", {"config_dir"}, main,
+                  []
+                  {
+                      // Note: initialize cfg module early.
+                      cfg::initialize();
+                      set_tab(cfg::state.initial_tab);
+                      if (cfg::state.remember_tab)
+                          cfg::state.initial_tab = TabID::last_active;
+                      http_client::set_native_enabled(cfg::state.native_http);
+                      socket_tuning::set_enabled(cfg::state.stream_socket_tuning);
+                      tracer::set_enabled(cfg::state.tracing);
+                      if (cfg::state.capture_streams)
+                          radio_client::set_capture_dir(get_config_path() / "captures");
 
 #ifdef __WIIU__
-        old_disable_swkbd = cfg::state.disable_swkbd;
-        if (cfg::state.disable_swkbd) {
-            SDL_SetHint(SDL_HINT_ENABLE_SCREEN_KEYBOARD, "0");
-            // SDL_StartTextInput();
-        }
+                      old_disable_swkbd = cfg::state.disable_swkbd;
+                      if (cfg::state.disable_swkbd) {
+                          SDL_SetHint(SDL_HINT_ENABLE_SCREEN_KEYBOARD, "0");
+                          // SDL_StartTextInput();
+                      }
 #endif
+                  });
+
+        // The tabs only need the config dir and cfg; the player also uses the resolved URLs.
+        graph.add("favorites", {"cfg"}, worker, FavoritesTab::initialize);
+        graph.add("recent", {"cfg"}, worker, RecentTab::initialize);
+        graph.add("browser", {"cfg"}, worker, BrowserTab::initialize);
+        graph.add("player", {"cfg", "resolved_url_cache"}, worker, PlayerTab::initialize);
+        graph.add("telemetry", {"cfg"}, worker, Telemetry::initialize);
+
+        graph.add("dns_cache", {"config_dir"}, worker,
+                  []
+                  {
+                      try {
+                          net::resolver::cache::load(get_config_path() / "dns-cache.txt");
+                      }
+                      catch (std::exception& e) {
+                          cout << "ERROR: failed to load DNS cache: " << e.what() << endl;
+                      }
+                  });
+
+        graph.add("resolved_url_cache", {"config_dir"}, worker,
+                  []
+                  {
+                      try {
+                          resolved_url_cache::load(get_config_path() / "resolved-urls.json");
+                      }
+                      catch (std::exception& e) {
+                          cout << "ERROR: failed to load resolved URL cache: " << e.what() << endl;
+                      }
+                  });
+
+        graph.add("sdl", {"cfg"}, main,
+                  []
+                  {
+                      res.emplace();
+
+                      // Note: opening the audio device also stops the boot sound.
+                      audio_output::initialize();
+
+                      SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
+                      SDL_SetHint(SDL_HINT_RENDER_LINE_METHOD, "2");
+
+                      res->window.create(PACKAGE_STRING,
+                                         sdl::window::pos_centered,
+                                         {1280, 720},
+                                         0);
+
+                      res->renderer.create(res->window,
+                                           -1,
+                                           sdl::renderer::flag::accelerated,
+                                           sdl::renderer::flag::present_vsync);
+                      res->renderer.set_logical_size(res->window.get_size());
+
+                      wake_event_type = SDL_RegisterEvents(1);
+                      if (wake_event_type == static_cast<Uint32>(-1))
+                          wake_event_type = SDL_USEREVENT;
+                  });
+
+        graph.add("imgui", {"sdl"}, main, initialize_imgui);
+        graph.add("styles", {"imgui"}, main, Styles::initialize);
+
+        graph.add("curl_share", {"sdl"}, main, curl_share::initialize);
+        graph.add("icons", {"imgui", "curl_share"}, main,
+                  []
+                  {
+                      IconManager::initialize(res->renderer);
+                  });
+
+        graph.add("radio_browser", {"curl_share", "dns_cache", "scheduler"}, main,
+                  []
+                  {
+                      RadioBrowserAPI::initialize(get_user_agent());
+                      try {
+                          RadioBrowserAPI::load_mirror_stats(get_config_path() / "mirrors.json");
+                      }
+                      catch (std::exception& e) {
+                          cout << "ERROR: failed to load mirror stats: " << e.what() << endl;
+                      }
+                      try {
+                          rest::set_cache_dir(get_config_path() / "http-cache");
+                      }
+                      catch (std::exception& e) {
+                          cout << "ERROR: failed to create HTTP cache: " << e.what() << endl;
+                      }
+                      RadioBrowserAPI::set_server(cfg::state.server);
+                  });
+
+        graph.add("station_index", {"cfg"}, main,
+                  []
+                  {
+                      StationIndex::initialize(get_config_path() / "stations.idx");
+                      StationIndex::set_enabled(cfg::state.offline_index);
+                  });
+
+        // Note: the prober updates the resolved URLs, so they must be loaded first.
+        graph.add("station_prober", {"cfg", "curl_share", "resolved_url_cache"}, main,
+                  []
+                  {
+                      station_prober::set_enabled(cfg::state.check_favorites);
+                      station_prober::initialize(get_config_path() / "station-probes.json");
+                  });
+
+        graph.add("about", {}, main, AboutTab::initialize);
+
+        graph.run();
+    }
+
 
-        res.emplace();
-
-        // Create a temporary audio device to stop the boot sound.
-        sdl::audio::spec aspec;
-        aspec.freq = 48000;
-        aspec.format = AUDIO_S16SYS;
-        aspec.channels = 2;
-        aspec.samples = 2048;
-        sdl::audio::device adev{nullptr, false, aspec};
-
-        SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
-        SDL_SetHint(SDL_HINT_RENDER_LINE_METHOD, "2");
-
-        res->window.create(PACKAGE_STRING,
-                           sdl::window::pos_centered,
-                           {1280, 720},
-                           0);
-
-        res->renderer.create(res->window,
-                             -1,
-                             sdl::renderer::flag::accelerated,
-                             sdl::renderer::flag::present_vsync);
-        res->renderer.set_logical_size(res->window.get_size());
-
-        initialize_imgui();
-
-        // Initialize modules.
-        Styles::initialize();
-        IconManager::initialize(res->renderer);
-        RadioBrowserAPI::initialize(get_user_agent());
-        RadioBrowserAPI::set_server(cfg::state.server);
-
-        // Initialize tabs.
-        AboutTab::initialize();
-        FavoritesTab::initialize();
-        BrowserTab::initialize();
-        RecentTab::initialize();
-        PlayerTab::initialize();
+    // Once the startup workers are done, the tabs can use their data.
+    void
+    check_loading()
+    {
+        if (!loading || !startup->try_report())
+            return;
+        loading = false;
+        startup.reset();
+        settle_countdown = settle_frames;
     }
 
 
@@ -368,7 +535,13 @@ namespace App {
     {
         TRACE_FUNC;
 
+        // The tabs can't be finalized while they're still loading.
+        if (startup)
+            startup->wait();
+        startup.reset();
+
         // Finalize tabs.
+        Telemetry::finalize();
         PlayerTab::finalize();
         RecentTab::finalize();
         BrowserTab::finalize();
@@ -376,9 +549,46 @@ namespace App {
         AboutTab::finalize();
 
         // Finalize modules.
+        // Note: after PlayerTab, nothing is playing anymore.
+        audio_output::finalize();
+        decoder::clear_pool();
+        // Note: recordings are finished in the background, and may be in the config dir.
+        stream_recorder::wait_all();
+        StationIndex::finalize();
+        // Note: before the resolved URLs are saved, since it updates them.
+        station_prober::finalize();
+        try {
+            RadioBrowserAPI::save_mirror_stats(get_config_path() / "mirrors.json");
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: failed to save mirror stats: " << e.what() << endl;
+        }
+        try {
+            resolved_url_cache::save(get_config_path() / "resolved-urls.json");
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: failed to save resolved URL cache: " << e.what() << endl;
+        }
         RadioBrowserAPI::finalize();
         IconManager::finalize();
+        // Note: after everything that holds scheduler tasks.
+        scheduler::finalize();
+        if (tracer::is_enabled()) {
+            try {
+                tracer::export_chrome_json(get_config_path() / "trace.json");
+            }
+            catch (std::exception& e) {
+                cout << "ERROR: failed to save trace: " << e.what() << endl;
+            }
+        }
         Styles::finalize();
+        curl_share::finalize();
+        try {
+            net::resolver::cache::save(get_config_path() / "dns-cache.txt");
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: failed to save DNS cache: " << e.what() << endl;
+        }
 
         ImGui_ImplSDLRenderer2_Shutdown();
         ImGui_ImplSDL2_Shutdown();
@@ -389,15 +599,23 @@ namespace App {
         if (cfg::state.remember_tab)
             cfg::state.initial_tab = current_tab;
         cfg::finalize();
+        // Note: this writes all queued saves, it must happen before the config dir is
+        // closed.
+        Serializer::finalize();
         finalize_config_dir();
 
         res.reset();
+
+        logging::finalize();
     }
 
 
     void
     run()
     {
+        tracer::set_thread_name("main");
+        thread_policy::apply(thread_policy::role::ui);
+
         TRACE_FUNC;
 
         running = true;
@@ -409,20 +627,95 @@ namespace App {
             if (!running)
                 break;
 
-            draw();
+            if (should_draw()) {
+                process_ui();
+                draw();
+                Profiler::end_frame();
+            } else
+                wait_for_activity();
+
+        }
+    }
+
 
+    void
+    request_redraw()
+        noexcept
+    {
+        // Note: only one wake event is pushed, until the main loop handles it.
+        if (!redraw_requested.exchange(true) && wake_event_type) {
+            SDL_Event event{};
+            event.type = wake_event_type;
+            SDL_PushEvent(&event);
         }
     }
 
 
+    void
+    request_animation()
+        noexcept
+    {
+        animating = true;
+    }
+
+
+    Uint64
+    get_heartbeat_ms()
+        noexcept
+    {
+        if (animating)
+            return animation_heartbeat_ms;
+        return state == State::screen_saver ? screen_saver_heartbeat_ms : heartbeat_ms;
+    }
+
+
+    bool
+    should_draw()
+    {
+        const Uint64 now = SDL_GetTicks64();
+        if (redraw_requested.exchange(false))
+            settle_countdown = settle_frames;
+
+        bool result = settle_countdown > 0
+            || state == State::fading
+            || ImGui::IsAnyItemActive()
+            || now - last_draw >= get_heartbeat_ms();
+
+        if (settle_countdown)
+            --settle_countdown;
+        if (result)
+            last_draw = now;
+        return result;
+    }
+
+
+    // Sleep until there's an event, the next heartbeat, or the next logic tick.
+    void
+    wait_for_activity()
+    {
+        const Uint64 now = SDL_GetTicks64();
+        const Uint64 next_draw = last_draw + get_heartbeat_ms();
+        Uint64 timeout = next_draw > now ? next_draw - now : 0;
+        if (rest::is_busy() || loading)
+            timeout = std::min<Uint64>(timeout, logic_tick_ms);
+        if (timeout)
+            SDL_WaitEventTimeout(nullptr, static_cast<int>(timeout));
+    }
+
+
     void
     process_events()
     {
+        PROFILE_SCOPE("App::process_events");
+
         Uint64 now = SDL_GetTicks64();
 
         sdl::events::event event;
         while (sdl::events::poll(event)) {
 
+            // Note: any event may change what's on screen.
+            settle_countdown = settle_frames;
+
             ImGui_ImplSDL2_ProcessEvent(&event);
 
             switch (sdl::events::type{event.type}) {
@@ -489,14 +782,27 @@ namespace App {
     }
 
 
+    // Placeholder for the tabs, while their data is loading.
+    void
+    show_loading()
+    {
+        ImGui::Spacing();
+        UI::show_text_centered("Loading...");
+    }
+
+
     void
     process_ui()
     {
+        PROFILE_SCOPE("App::process_ui");
+
         ImGui_ImplSDLRenderer2_NewFrame();
         ImGui_ImplSDL2_NewFrame();
 
         ImGui::NewFrame();
 
+        animating = false;
+
         if (state == State::normal || state == State::fading) {
 
             auto& style = ImGui::GetStyle();
@@ -554,7 +860,10 @@ namespace App {
                             get_tab_item_flags_for(TabID::favorites)
                         }) {
                         current_tab = TabID::favorites;
-                        FavoritesTab::process_ui();
+                        if (loading)
+                            show_loading();
+                        else
+                            FavoritesTab::process_ui();
                     }
 
                     if (ImGui::RAII::TabItem browser_tab{
@@ -562,7 +871,10 @@ namespace App {
                             nullptr,
                             get_tab_item_flags_for(TabID::browser)}) {
                         current_tab = TabID::browser;
-                        BrowserTab::process_ui();
+                        if (loading)
+                            show_loading();
+                        else
+                            BrowserTab::process_ui();
                     }
 
                     if (ImGui::RAII::TabItem recent_tab{
@@ -571,7 +883,10 @@ namespace App {
                             get_tab_item_flags_for(TabID::recent)
                         }) {
                         current_tab = TabID::recent;
-                        RecentTab::process_ui();
+                        if (loading)
+                            show_loading();
+                        else
+                            RecentTab::process_ui();
                     }
 
                     if (ImGui::RAII::TabItem player_tab{
@@ -580,7 +895,10 @@ namespace App {
                             get_tab_item_flags_for(TabID::player)
                         }) {
                         current_tab = TabID::player;
-                        PlayerTab::process_ui();
+                        if (loading)
+                            show_loading();
+                        else
+                            PlayerTab::process_ui();
                     }
 
                     if (ImGui::RAII::TabItem settings_tab{
@@ -589,7 +907,10 @@ namespace App {
                             get_tab_item_flags_for(TabID::settings)
                         }) {
                         current_tab = TabID::settings;
-                        SettingsTab::process_ui();
+                        if (loading)
+                            show_loading();
+                        else
+                            SettingsTab::process_ui();
                     }
 
                     if (ImGui::RAII::TabItem about_tab{
@@ -612,19 +933,39 @@ namespace App {
 
             Styles::process_ui();
 
+            if (cfg::state.show_profiler)
+                Profiler::show_overlay();
+
+            if (cfg::state.show_stats)
+                StatsPanel::show();
+
             // ImGui::ShowStyleEditor();
 
-        }
+        } else
+            process_screen_saver();
 
         ImGui::EndFrame();
         ImGui::Render();
     }
 
 
+    // Note: it's drawn dim, straight into the background, and keeps moving, so it
+    // doesn't burn in.
     void
     process_screen_saver()
     {
-        // TODO
+        if (!cfg::state.show_visualizer)
+            return;
+        auto spectrum = PlayerTab::get_spectrum();
+        if (!spectrum)
+            return;
+
+        ImGui::GetStyle().Alpha = 1.0f;
+        const ImVec2 screen = ImGui::GetMainViewport()->Size;
+        const ImVec2 size = screen * ImVec2{0.8f, 0.5f};
+        const ImVec2 pos = (screen - size) * ImVec2{0.5f, 1.0f} - ImVec2{0, screen.y * 0.1f};
+        UI::draw_spectrum(ImGui::GetBackgroundDrawList(), pos, size, *spectrum, 0.4f);
+        request_animation();
     }
 
 
@@ -689,11 +1030,22 @@ namespace App {
         if (!running)
             return;
 
-        RadioBrowserAPI::process();
+        if (scheduler::run_main())
+            settle_countdown = settle_frames;
 
-        FavoritesTab::process_logic();
-        RecentTab::process_logic();
-        PlayerTab::process_logic();
+        if (RadioBrowserAPI::process())
+            settle_countdown = settle_frames;
+
+        check_loading();
+        if (!loading) {
+            FavoritesTab::process_logic();
+            RecentTab::process_logic();
+            PlayerTab::process_logic();
+            Telemetry::process_logic();
+        }
+
+        FontManager::process_logic();
+        StatsPanel::process_logic();
 
 
         Uint64 now = SDL_GetTicks64();
@@ -724,10 +1076,6 @@ namespace App {
                 cout << "Returning to normal" << endl;
                 state = State::normal;
             }
-
-        process_ui();
-
-        process_screen_saver();
     }
 
 
@@ -741,6 +1089,8 @@ namespace App {
     void
     draw()
     {
+        PROFILE_SCOPE("App::draw");
+
         res->renderer.set_color(sdl::color::black);
         res->renderer.clear();
 
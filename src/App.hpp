@@ -39,6 +39,17 @@ namespace App {
     void
     set_tab(TabID id);
 
+    // Make sure the next frame is drawn, even if idle. Can be called from any thread.
+    void
+    request_redraw()
+        noexcept;
+
+    // Something on screen moves: keep drawing at about 30 FPS until the next frame. Call it
+    // every frame, while drawing it.
+    void
+    request_animation()
+        noexcept;
+
 } // namespace App
 
 #endif
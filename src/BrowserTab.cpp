@@ -8,7 +8,7 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
-#include <cinttypes>
+#include <chrono>
 #include <compare>
 #include <cstdio>
 #include <exception>
@@ -16,8 +16,9 @@
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <list>
+#include <optional>
 #include <random>
-#include <regex>
 #include <span>
 #include <thread>
 #include <tuple>
@@ -39,16 +40,21 @@
 
 #include "App.hpp"
 #include "cfg.hpp"
-#include "humanize.hpp"
 #include "IconManager.hpp"
 #include "IconsFontAwesome4.h"
 #include "net/address.hpp"
 #include "net/resolver.hpp"
+#include "PlayerTab.hpp"
+#include "Profiler.hpp"
 #include "RadioBrowserAPI.hpp"
 #include "rest.hpp"
 #include "Serializer.hpp"
+#include "simple_regex.hpp"
 #include "Station.hpp"
+#include "station_arena.hpp"
 #include "StationDetailsPopup.hpp"
+#include "StationIndex.hpp"
+#include "Telemetry.hpp"
 #include "tracer.hpp"
 #include "UI.hpp"
 
@@ -89,6 +95,7 @@ namespace BrowserTab::GUI {
     unsigned page;
     bool search_options_visible = true;
     bool scroll_to_top = false;
+    UI::VirtualList stations_list;
 
     std::string
     to_label(Order order);
@@ -142,15 +149,51 @@ namespace BrowserTab {
     struct Country {
         std::string code;
         std::string name;
+        std::string label; // "code - name", for the combo
     };
 
 
-    std::regex tags_regex;
+    // Tags matching any of these are not shown; loaded from "tags.ignore".
+    std::vector<simple_regex::pattern> ignored_tags;
 
+    // The current page; the stations from the API live in stations_arena.
     std::vector<std::shared_ptr<Station>> stations;
+    station_arena stations_arena;
+
+    // Search responses for recent queries and adjacent pages, most recently used first.
+    struct CachedPage {
+        std::string key;
+        std::string response;
+        std::chrono::steady_clock::time_point when;
+    };
+
+    std::list<CachedPage> page_cache;
+    std::unordered_set<std::string> pages_prefetching;
+
+    const std::size_t page_cache_size = 16;
+    const auto page_cache_ttl = 5min;
+
+
+    // Live search starts after the name stops changing for this long.
+    const auto live_search_delay = 400ms;
+
+    std::optional<std::chrono::steady_clock::time_point> live_search_time;
+
+    // Only responses for the newest search may update stations.
+    unsigned search_generation = 0;
+    // The search whose stations are being shown.
+    unsigned page_generation = 0;
+
 
     // TODO: allow votes to expire after 10 min.
     std::unordered_map<std::string, RadioBrowserAPI::VoteResult> votes_cast;
+    // Votes waiting in the Telemetry queue.
+    std::unordered_set<std::string> votes_pending;
+
+
+    const std::string clicks_tooltip = "Daily total clicks and trend.";
+    const std::string bitrate_tooltip = "The advertised stream quality.";
+    const std::string codec_tooltip = "The codec used in this broadcast.";
 
 
     const std::string server_stats_popup_id = "info";
@@ -162,6 +205,20 @@ namespace BrowserTab {
     std::optional<std::vector<std::string>> codecs;
     std::optional<std::vector<std::string>> tags;
 
+    // Position of each country code in countries; built with it.
+    std::unordered_map<std::string, std::size_t> country_by_code;
+
+    // The tags that pass the tag combo's text filter, rebuilt only when the filter or the
+    // tags change.
+    struct FilteredTags {
+        std::string filter;
+        std::size_t source_size = 0;
+        std::vector<std::size_t> positions;
+        UI::VirtualList list;
+    };
+
+    FilteredTags filtered_tags;
+
 
     void
     fetch_codecs();
@@ -172,6 +229,10 @@ namespace BrowserTab {
     void
     fetch_tags();
 
+    // Only filters the tags again when the text or the tags changed.
+    void
+    update_filtered_tags(const ImGuiTextFilter& text_filter);
+
     void
     load();
 
@@ -192,6 +253,35 @@ namespace BrowserTab {
     fetch_server_stats();
 
 
+    void
+    start_search();
+
+    void
+    process_live_search();
+
+    RadioBrowserAPI::SearchStationParams
+    make_search_params(unsigned page);
+
+    std::string
+    make_page_key(const RadioBrowserAPI::SearchStationParams& params);
+
+    const std::string*
+    find_cached_page(const std::string& key);
+
+    void
+    store_cached_page(const std::string& key,
+                      const std::string& response);
+
+    void
+    prefetch_adjacent_pages();
+
+    void
+    prefetch_page(unsigned page);
+
+    void
+    begin_page(unsigned generation);
+
+
     std::string
     GUI::to_label(Order order)
     {
@@ -282,31 +372,28 @@ namespace BrowserTab {
 
 
     void
-    load_tags_regex()
+    load_ignored_tags()
     try {
         std::ifstream input;
         if (!try_open_file(input, App::get_config_path() / "tags.ignore"))
             if (!try_open_file(input, App::get_content_path() / "tags.ignore"))
                 throw std::runtime_error{"could not find tags.ignore"};
+        ignored_tags.clear();
         std::string line;
-        std::string full_regex;
-        unsigned counter = 0;
         while (getline(input, line)) {
             if (line.empty())
                 continue;
-            if (counter)
-                full_regex += "|";
-            full_regex += "(?:" + line + ")";
-            ++counter;
+            try {
+                ignored_tags.emplace_back(line);
+            }
+            catch (simple_regex::error& e) {
+                cout << "WARNING: ignoring rule \"" << line << "\": " << e.what() << endl;
+            }
         }
-        tags_regex.assign(full_regex,
-                          std::regex_constants::ECMAScript |
-                          std::regex_constants::optimize);
-        cout << "tags_regex has " << counter << " rules" << endl;
-        // cout << full_regex << endl;
+        cout << "ignored_tags has " << ignored_tags.size() << " rules" << endl;
     }
     catch (std::exception& e) {
-        cout << "ERROR: load_tags_regex(): " << e.what() << endl;
+        cout << "ERROR: load_ignored_tags(): " << e.what() << endl;
     }
 
 
@@ -315,7 +402,7 @@ namespace BrowserTab {
     {
         TRACE_FUNC;
 
-        load_tags_regex();
+        load_ignored_tags();
         load();
         // search_stations();
     }
@@ -382,7 +469,7 @@ namespace BrowserTab {
             state.page = GUI::page;
 
         auto filename = App::get_config_path() / "browser.json";
-        Serializer::save(state, filename);
+        Serializer::save_async(state, filename);
     }
     catch (std::exception& e) {
         cout << "ERROR: Browser::save(): " << e.what() << endl;
@@ -520,7 +607,9 @@ namespace BrowserTab {
                     /*******************
                      * Filter by name. *
                      *******************/
-                    ImGui::InputText("Name", GUI::filter_name);
+                    if (ImGui::InputText("Name", GUI::filter_name))
+                        live_search_time = std::chrono::steady_clock::now()
+                                         + live_search_delay;
 
                     /******************
                      * Filter by tag. *
@@ -547,12 +636,15 @@ namespace BrowserTab {
                         // The rest of tags.
                         if (!tags)
                             fetch_tags();
-                        for (auto& tag : *tags) {
-                            const bool is_selected = GUI::filter_tag == tag;
-                            if (text_filter.PassFilter(tag.data()))
-                                if (ImGui::Selectable(tag, is_selected))
+                        update_filtered_tags(text_filter);
+                        filtered_tags.list.show(
+                            filtered_tags.positions.size(),
+                            [](std::size_t i)
+                            {
+                                const auto& tag = (*tags)[filtered_tags.positions[i]];
+                                if (ImGui::Selectable(tag, GUI::filter_tag == tag))
                                     GUI::filter_tag = tag;
-                        }
+                            });
                     }
 
                     /**********************
@@ -578,9 +670,8 @@ namespace BrowserTab {
                         // The rest of countries
                         if (!countries)
                             fetch_countries();
-                        for (const auto& [code, name] : *countries) {
+                        for (const auto& [code, name, label] : *countries) {
                             const bool is_selected = GUI::filter_country == code;
-                            auto label = code + " - " + name;
                             if (text_filter.PassFilter(label.data()))
                                 if (ImGui::Selectable(label, is_selected))
                                     GUI::filter_country = code;
@@ -766,6 +857,16 @@ namespace BrowserTab {
                 ImGui::SetItemTooltip("Advance 100 pages.");
             }
 
+            ImGui::SameLine();
+
+            {
+                ImGui::RAII::Disabled disable_scan{stations.size() < 2};
+                // ⏩
+                if (ImGui::Button(ICON_FA_FAST_FORWARD " Scan"))
+                    PlayerTab::start_scan(stations);
+                ImGui::SetItemTooltip("Play each station of this page for a few seconds.");
+            }
+
         }
 
     } // navigation_child
@@ -776,6 +877,8 @@ namespace BrowserTab {
     {
         ImGui::RAII::ID station_id{station.get()};
 
+        const UI::StationLabels& labels = UI::get_labels(*station);
+
         if (ImGui::RAII::Child station_child{
                 "station",
                 {0, 0},
@@ -803,17 +906,23 @@ namespace BrowserTab {
 
                 auto vote_record = votes_cast.find(station->stationuuid);
                 const bool voted = vote_record != votes_cast.end();
+                const bool pending = votes_pending.contains(station->stationuuid);
                 bool ok = voted ? vote_record->second.ok : false;
-                std::string vote_label = (ok
-                                          ? ICON_FA_THUMBS_UP " "
-                                          : ICON_FA_THUMBS_O_UP " ")
-                                         + humanize::value(station->votes);
+                char vote_label[64];
+                std::snprintf(vote_label, sizeof vote_label,
+                              "%s %s",
+                              ok ? ICON_FA_THUMBS_UP : ICON_FA_THUMBS_O_UP,
+                              labels.votes.c_str());
 
                 {
-                    ImGui::RAII::Disabled disable_voting{voted || !cfg::state.send_clicks};
+                    // Note: a failed vote can be retried.
+                    ImGui::RAII::Disabled disable_voting{ok || pending
+                                                         || !cfg::state.send_clicks};
                     if (ImGui::Button(vote_label))
                         send_vote(station);
-                    if (voted)
+                    if (pending)
+                        ImGui::SetItemTooltip("Vote queued.");
+                    else if (voted)
                         ImGui::SetItemTooltip("%s", vote_record->second.message.data());
                     else
                         ImGui::SetItemTooltip("Vote for this station.");
@@ -843,27 +952,18 @@ namespace BrowserTab {
                         ImGuiChildFlags_NavFlattened
                     }) {
 
-                    char click_text[32];
-                    std::snprintf(click_text, sizeof click_text,
-                                  ICON_FA_BAR_CHART " %" PRIu64 " (%+d)",
-                                  station->click_count,
-                                  station->click_trend);
-                    UI::show_boxed(click_text,
-                                   "Daily total clicks and trend.");
+                    UI::show_boxed(labels.clicks, clicks_tooltip);
 
-                    if (station->bitrate) {
+                    if (!labels.bitrate.empty()) {
                         ImGui::SameLine();
-                        UI::show_boxed(ICON_FA_HEADPHONES " "
-                                       + std::to_string(station->bitrate) + " kbps",
-                                       "The advertised stream quality.");
+                        UI::show_boxed(labels.bitrate, bitrate_tooltip);
                     }
 
                     ImGui::SameLine();
 
-                    UI::show_boxed(ICON_FA_FLASK " " + station->codec,
-                                   "The codec used in this broadcast.");
+                    UI::show_boxed(labels.codec, codec_tooltip);
 
-                    UI::show_tags(station->tags);
+                    UI::show_tags(*station);
 
                 } // extra_info_child
 
@@ -876,12 +976,17 @@ namespace BrowserTab {
     void
     process_ui()
     {
-        ImGui::RAII::Disabled disable_searching{RadioBrowserAPI::is_searching()};
+        PROFILE_SCOPE("BrowserTab::process_ui");
+
+        process_live_search();
 
         show_status();
 
+        // Note: a new search replaces the one in progress, so these are never disabled.
         show_search_options();
 
+        ImGui::RAII::Disabled disable_searching{RadioBrowserAPI::is_searching()};
+
         show_navigation();
 
         // Note: flat navigation doesn't work well on child windows that scroll.
@@ -903,8 +1008,11 @@ namespace BrowserTab {
                 }
 #endif
 
-            for (auto& station_ptr : stations)
-                show_station(station_ptr);
+            GUI::stations_list.show(stations.size(),
+                                    [](std::size_t index)
+                                    {
+                                        show_station(stations[index]);
+                                    });
 
 #if 0
             // Disabled until ImGui fixes navigation.
@@ -921,30 +1029,6 @@ namespace BrowserTab {
     }
 
 
-    void
-    send_click(std::shared_ptr<Station>& station_ptr)
-    {
-        TRACE_FUNC;
-
-        if (!station_ptr || station_ptr->stationuuid.empty())
-            return;
-
-        RadioBrowserAPI::send_click(
-            station_ptr->stationuuid,
-            [station_ptr](RadioBrowserAPI::ClickResult result)
-            {
-                cout << "Result of click: "
-                     << (result.ok ? "success" : "failure")
-                     << endl;
-                if (!result.message.empty())
-                    cout << result.message << endl;
-
-                update_station(station_ptr);
-            },
-            common_error_handler);
-    }
-
-
     void
     send_vote(std::shared_ptr<Station>& station_ptr)
     {
@@ -953,19 +1037,22 @@ namespace BrowserTab {
         if (!station_ptr || station_ptr->stationuuid.empty())
             return;
 
-        RadioBrowserAPI::send_vote(
+        // Note: this disables the button until the result arrives.
+        votes_pending.insert(station_ptr->stationuuid);
+        Telemetry::queue_vote(
             station_ptr->stationuuid,
-            [station_ptr](RadioBrowserAPI::VoteResult result)
+            [station_ptr](bool ok, const std::string& message)
             {
                 cout << "Result of vote: "
-                     << (result.ok ? "success" : "failure")
+                     << (ok ? "success" : "failure")
                      << endl;
-                if (!result.message.empty())
-                    cout << result.message << endl;
+                if (!message.empty())
+                    cout << message << endl;
 
+                votes_pending.erase(station_ptr->stationuuid);
+                votes_cast[station_ptr->stationuuid] = {ok, message};
                 update_station(station_ptr);
-            },
-            common_error_handler);
+            });
     }
 
 
@@ -1030,12 +1117,19 @@ namespace BrowserTab {
             {},
             [](RadioBrowserAPI::CountryVec rb_countries)
             {
-                for (auto& [name, code, count] : rb_countries)
+                for (auto& [name, code, count] : rb_countries) {
+                    auto label = code + " - " + name;
                     countries->emplace_back(std::move(code),
-                                            std::move(name));
+                                            std::move(name),
+                                            std::move(label));
+                }
                 cout << "Got " << countries->size()
                      << " countries" << endl;
                 std::ranges::sort(*countries, {}, by_code);
+                country_by_code.clear();
+                country_by_code.reserve(countries->size());
+                for (std::size_t i = 0; i < countries->size(); ++i)
+                    country_by_code.try_emplace((*countries)[i].code, i);
             },
             common_error_handler);
     }
@@ -1083,17 +1177,17 @@ namespace BrowserTab {
             params,
             [](RadioBrowserAPI::TagVec rb_tags)
             {
-                std::smatch matches;
+                tags->reserve(rb_tags.size());
                 for (auto& [name, stationcount] : rb_tags) {
                     // ignore some bogus tags
                     if (name.size() < 2 || name.size() > 32)
                         continue;
-                    if (regex_search(name, matches, tags_regex) &&
-                        matches.length() > 0) {
-                        // cout << "Ignored tag: " << name << endl;
-                        // cout << "RE match: " << matches.str() << endl;
+                    if (std::ranges::any_of(ignored_tags,
+                                            [&name](const auto& p)
+                                            {
+                                                return p.search(name);
+                                            }))
                         continue;
-                    }
                     tags->push_back(std::move(name));
                 }
                 cout << "Got " << tags->size() << " tags" << endl;
@@ -1102,6 +1196,25 @@ namespace BrowserTab {
     }
 
 
+    void
+    update_filtered_tags(const ImGuiTextFilter& text_filter)
+    {
+        if (!tags)
+            return;
+        const std::string_view text = text_filter.InputBuf;
+        if (filtered_tags.source_size == tags->size() && filtered_tags.filter == text)
+            return;
+
+        filtered_tags.filter = text;
+        filtered_tags.source_size = tags->size();
+        filtered_tags.positions.clear();
+        for (std::size_t i = 0; i < tags->size(); ++i)
+            if (text_filter.PassFilter((*tags)[i].data()))
+                filtered_tags.positions.push_back(i);
+        filtered_tags.list.invalidate();
+    }
+
+
     void
     update_station(std::shared_ptr<Station> station_ptr)
     {
@@ -1126,10 +1239,114 @@ namespace BrowserTab {
         TRACE_FUNC;
 
         GUI::search_options_visible = false;
+        live_search_time.reset();
+        start_search();
+    }
+
+
+    void
+    process_live_search()
+    {
+        if (!live_search_time || std::chrono::steady_clock::now() < *live_search_time)
+            return;
+        live_search_time.reset();
+        GUI::page = 1;
+        start_search();
+    }
+
+
+    void
+    start_search()
+    {
         GUI::scroll_to_top = true;
 
+        // Supersede the previous search, if it's still running.
+        const unsigned generation = ++search_generation;
+        RadioBrowserAPI::cancel_search();
+        // Prefetches for the old search are useless now, don't let them queue up.
+        rest::cancel_queued(rest::priority::prefetch);
+
+        auto params = make_search_params(GUI::page);
+
+        if (cfg::state.offline_index && StationIndex::is_ready()) {
+            StationIndex::search_async(
+                params,
+                [generation](std::vector<std::shared_ptr<Station>> result)
+                {
+                    if (generation == search_generation) {
+                        stations = std::move(result);
+                        GUI::stations_list.invalidate();
+                    }
+                });
+            return;
+        }
+
+        auto key = make_page_key(params);
+
+        if (auto response = find_cached_page(key)) {
+            // Note: the page size limit must be respected.
+            Station::from_radio_browser_json(*response,
+                                             stations_arena,
+                                             stations,
+                                             cfg::state.browser_page_limit);
+            GUI::stations_list.invalidate();
+            prefetch_adjacent_pages();
+            return;
+        }
+
+        // Note: rows are shown as soon as each station arrives; the old ones stay until
+        // the first new one replaces them.
+        RadioBrowserAPI::search_stations_progressive(
+            params,
+            [generation](std::string_view element)
+            {
+                if (generation != search_generation)
+                    return;
+                begin_page(generation);
+                Station::append_radio_browser_json(element, stations_arena, stations);
+            },
+            [generation]
+            {
+                // Note: the retry starts the page over, on another mirror.
+                if (generation != search_generation)
+                    return;
+                page_generation = 0;
+                begin_page(generation);
+            },
+            [key, generation](const std::string& response)
+            {
+                store_cached_page(key, response);
+                if (generation != search_generation)
+                    return;
+                // Note: with no results, no element began the page.
+                begin_page(generation);
+                Station::end_radio_browser_page(stations_arena, stations);
+                cout << "Received " << stations.size() << " stations" << endl;
+                prefetch_adjacent_pages();
+            },
+            common_error_handler);
+    }
+
+
+    // Replace the old stations, once per search.
+    void
+    begin_page(unsigned generation)
+    {
+        if (page_generation == generation)
+            return;
+        page_generation = generation;
+        Station::begin_radio_browser_page(stations_arena,
+                                          stations,
+                                          cfg::state.browser_page_limit);
+        GUI::stations_list.invalidate();
+    }
+
+
+    RadioBrowserAPI::SearchStationParams
+    make_search_params(unsigned page)
+    {
         RadioBrowserAPI::SearchStationParams params;
-        params.offset = (GUI::page - 1u) * cfg::state.browser_page_limit;
+        params.offset = (page - 1u) * cfg::state.browser_page_limit;
         params.limit = cfg::state.browser_page_limit;
         params.hidebroken = true;
 
@@ -1148,20 +1365,105 @@ namespace BrowserTab {
         if (!GUI::filter_codec.empty())
             params.codec = GUI::filter_codec;
 
-        RadioBrowserAPI::search_stations(
+        return params;
+    }
+
+
+    std::string
+    make_page_key(const RadioBrowserAPI::SearchStationParams& params)
+    {
+        // Note: the separator can't appear in the text fields.
+        const char sep = '\n';
+        std::string key;
+        key += params.name.value_or("") + sep;
+        key += params.tag.value_or("") + sep;
+        key += params.countrycode.value_or("") + sep;
+        key += params.codec.value_or("") + sep;
+        if (params.order)
+            key += std::to_string(static_cast<int>(*params.order));
+        key += sep;
+        key += params.reverse.value_or(false) ? "r" : "";
+        key += sep;
+        key += std::to_string(params.offset.value_or(0)) + sep;
+        key += std::to_string(params.limit.value_or(0));
+        return key;
+    }
+
+
+    const std::string*
+    find_cached_page(const std::string& key)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        for (auto it = page_cache.begin(); it != page_cache.end(); ++it) {
+            if (it->key != key)
+                continue;
+            if (now - it->when > page_cache_ttl) {
+                page_cache.erase(it);
+                return nullptr;
+            }
+            page_cache.splice(page_cache.begin(), page_cache, it);
+            return &page_cache.front().response;
+        }
+        return nullptr;
+    }
+
+
+    void
+    store_cached_page(const std::string& key,
+                      const std::string& response)
+    {
+        std::erase_if(page_cache, [&key](const CachedPage& p) { return p.key == key; });
+        page_cache.push_front({key, response, std::chrono::steady_clock::now()});
+        while (page_cache.size() > page_cache_size)
+            page_cache.pop_back();
+    }
+
+
+    void
+    prefetch_adjacent_pages()
+    {
+        if (GUI::page > 1)
+            prefetch_page(GUI::page - 1);
+        // a short page is the last one
+        if (stations.size() >= cfg::state.browser_page_limit)
+            prefetch_page(GUI::page + 1);
+    }
+
+
+    void
+    prefetch_page(unsigned page)
+    {
+        auto params = make_search_params(page);
+        auto key = make_page_key(params);
+        if (pages_prefetching.contains(key))
+            return;
+        // Note: don't use find_cached_page(), since it would become the most recent.
+        if (std::ranges::contains(page_cache, key, &CachedPage::key))
+            return;
+
+        pages_prefetching.insert(key);
+        RadioBrowserAPI::prefetch_stations_json(
             params,
-            [](RadioBrowserAPI::StationVec rb_stations)
+            [key](const std::string& response)
             {
-                cout << "Received " << rb_stations.size() << " stations" << endl;
-                stations.clear();
-                for (auto& st : rb_stations) {
-                    // ensure the page size limit is respected
-                    if (stations.size() >= cfg::state.browser_page_limit)
-                        break;
-                    stations.push_back(std::make_shared<Station>(Station::from_radio_browser(st)));
-                }
+                pages_prefetching.erase(key);
+                store_cached_page(key, response);
+
+                station_arena arena;
+                std::vector<std::shared_ptr<Station>> prefetched;
+                Station::from_radio_browser_json(response,
+                                                 arena,
+                                                 prefetched,
+                                                 cfg::state.browser_page_limit);
+                for (auto& st : prefetched)
+                    IconManager::prefetch(st->favicon);
             },
-            common_error_handler);
+            [key](const std::exception& e)
+            {
+                pages_prefetching.erase(key);
+                if (!dynamic_cast<const rest::canceled_error*>(&e))
+                    cout << "WARNING: failed to prefetch page: " << e.what() << endl;
+            });
     }
 
 
@@ -1177,12 +1479,10 @@ namespace BrowserTab {
             return {};
         }
 
-        auto it = std::ranges::lower_bound(*countries, code, {}, by_code);
-        if (it == countries->end())
-            return {};
-        if (it->code != code)
+        auto it = country_by_code.find(code);
+        if (it == country_by_code.end())
             return {};
-        return it->name;
+        return (*countries)[it->second].name;
     }
 
 
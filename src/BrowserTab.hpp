@@ -27,9 +27,6 @@ namespace BrowserTab {
     void
     process_ui();
 
-    void
-    send_click(std::shared_ptr<Station>& station_ptr);
-
     void
     send_vote(std::shared_ptr<Station>& station_ptr);
 
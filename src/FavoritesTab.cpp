@@ -6,13 +6,17 @@
  */
 
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <optional>
 #include <stdexcept>
+#include <string>
+#include <unordered_map>
 #include <vector>
-#include <unordered_set>
 
 #include <imgui.h>
 #include <imgui_raii.h>
@@ -22,10 +26,18 @@
 
 #include "App.hpp"
 #include "cfg.hpp"
+#include "coro.hpp"
+#include "humanize.hpp"
 #include "IconManager.hpp"
 #include "IconsFontAwesome4.h"
+#include "interned_string.hpp"
+#include "PlayerTab.hpp"
+#include "Profiler.hpp"
+#include "RadioBrowserAPI.hpp"
 #include "Serializer.hpp"
 #include "Station.hpp"
+#include "station_journal.hpp"
+#include "station_prober.hpp"
 #include "string_utils.hpp"
 #include "tracer.hpp"
 #include "UI.hpp"
@@ -45,10 +57,11 @@ namespace FavoritesTab {
         };
 
 
-        // When editing we need a string, not a vector of strings.
+        // When editing we need a string, not a vector of strings, or an interned string.
         struct EditFields {
 
             std::string old_uuid;
+            std::string countrycode;
             std::string language;
             std::string tags;
 
@@ -69,8 +82,24 @@ namespace FavoritesTab {
         }; // struct EditFields
 
 
-        const std::string&
-        get_id(const std::shared_ptr<Station>& st);
+        // Lookup tables into stations, rebuilt on demand after the list changes.
+        struct Index {
+            bool valid = false;
+            // Position of the first station with each uuid.
+            std::unordered_map<std::string, std::size_t> by_uuid;
+            // Stations without uuid, by url.
+            std::unordered_multimap<std::string, std::size_t> by_url;
+            // Positions of the stations with each tag, sorted by tag.
+            std::map<interned_string, std::vector<std::size_t>> by_tag;
+        };
+
+
+        const Index&
+        get_index();
+
+        void
+        invalidate_index()
+            noexcept;
 
         void
         process_popup_create();
@@ -80,7 +109,20 @@ namespace FavoritesTab {
                              std::size_t index);
 
         void
-        process_popup_edit(Station& station);
+        process_popup_edit(Station& station,
+                           std::size_t index);
+
+        coro::task<>
+        refresh_details();
+
+        void
+        scan();
+
+        void
+        set_tag_filter(interned_string tag);
+
+        void
+        show_probe_result(const Station& station);
 
         void
         show_row(const std::string& label,
@@ -93,17 +135,39 @@ namespace FavoritesTab {
         void
         show_station_fields(Station& st);
 
+        void
+        show_tag_filter();
+
+        void
+        update_probe_targets();
+
 
         std::vector<std::shared_ptr<Station>> stations;
-        std::unordered_multiset<std::string> uuids;
         std::optional<MoveOp> move_operation;
         std::optional<std::size_t> scroll_to_station;
+        UI::VirtualList stations_list;
         const std::string popup_delete_title = "Delete station?";
         std::optional<std::size_t> station_index_to_remove;
         const std::string popup_edit_title = "Edit station";
         const std::string popup_create_title = "Create station";
         std::optional<EditFields> edit_fields;
         std::optional<Station> created_station;
+        std::optional<station_journal> journal;
+
+
+        Index lookup;
+
+        // Set when the prober has to be told about the changed stations.
+        bool probe_targets_outdated = true;
+
+        // The volatile fields aren't saved, so they're fetched once, after startup.
+        const auto refresh_delay = std::chrono::seconds{3};
+        std::optional<std::chrono::steady_clock::time_point> refresh_time;
+        // Note: destroying it cancels the request.
+        coro::task<> refresh_task;
+
+        // Only show stations with this tag, if not empty.
+        interned_string tag_filter;
 
 
         EditFields::EditFields() = default;
@@ -111,6 +175,7 @@ namespace FavoritesTab {
 
         EditFields::EditFields(const Station& station) :
             old_uuid{station.stationuuid},
+            countrycode{station.countrycode},
             language{static_cast<std::optional<std::string>>(station.language).value_or("")},
             tags{static_cast<std::optional<std::string>>(station.tags).value_or("")}
         {}
@@ -132,10 +197,38 @@ namespace FavoritesTab {
         }
 
 
-        const std::string&
-        get_id(const std::shared_ptr<Station>& st)
+        const Index&
+        get_index()
+        {
+            if (lookup.valid)
+                return lookup;
+
+            lookup.by_uuid.clear();
+            lookup.by_url.clear();
+            lookup.by_tag.clear();
+            for (std::size_t i = 0; i < stations.size(); ++i) {
+                const Station& st = *stations[i];
+                if (!st.stationuuid.empty())
+                    lookup.by_uuid.try_emplace(st.stationuuid, i);
+                else
+                    lookup.by_url.emplace(st.url, i);
+                for (auto& tag : st.tags)
+                    if (!tag.empty())
+                        lookup.by_tag[tag].push_back(i);
+            }
+            lookup.valid = true;
+            return lookup;
+        }
+
+
+        void
+        invalidate_index()
+            noexcept
         {
-            return st->stationuuid;
+            lookup.valid = false;
+            // Note: the index is invalidated whenever a station is added, edited or removed.
+            probe_targets_outdated = true;
+            stations_list.invalidate();
         }
 
 
@@ -193,6 +286,7 @@ namespace FavoritesTab {
                     if (ImGui::Button(label)) {
                         ImGui::CloseCurrentPopup();
                         if (edit_fields) {
+                            created_station->countrycode = edit_fields->countrycode;
                             created_station->language = edit_fields->language_csv();
                             created_station->tags = edit_fields->tags_csv();
                             edit_fields.reset();
@@ -261,7 +355,8 @@ namespace FavoritesTab {
 
 
         void
-        process_popup_edit(Station& station)
+        process_popup_edit(Station& station,
+                           std::size_t index)
         {
             // TODO: add button for updating from Browser, if uuid is present
 
@@ -312,17 +407,14 @@ namespace FavoritesTab {
                     if (ImGui::Button(label)) {
                         ImGui::CloseCurrentPopup();
                         if (edit_fields) {
-                            // If user changed UUID, update uuids set.
-                            if (edit_fields->old_uuid != station.stationuuid) {
-                                auto it = uuids.find(edit_fields->old_uuid);
-                                if (it != uuids.end())
-                                    uuids.erase(it);
-                                if (!station.stationuuid.empty())
-                                    uuids.insert(station.stationuuid);
-                            }
+                            // The uuid, url or tags may have changed.
+                            invalidate_index();
+                            station.countrycode = edit_fields->countrycode;
                             station.language = edit_fields->language_csv();
                             station.tags = edit_fields->tags_csv();
                             edit_fields.reset();
+                            journal->edit(index, station);
+                            journal->maybe_compact(stations);
                         }
                     }
                     ImGui::SetItemTooltip("Confirm editing this station.");
@@ -332,6 +424,100 @@ namespace FavoritesTab {
         }
 
 
+        // Fetch all stations in a single request, and queue their icons ahead of the others.
+        coro::task<>
+        refresh_details()
+        {
+            std::vector<std::string> uuids;
+            uuids.reserve(stations.size());
+            for (auto& st : stations) {
+                IconManager::prefetch(st->favicon, true);
+                if (!st->stationuuid.empty())
+                    uuids.push_back(st->stationuuid);
+            }
+            if (uuids.empty())
+                co_return;
+
+            cout << "Refreshing " << uuids.size() << " favorites" << endl;
+            try {
+                auto result =
+                    co_await RadioBrowserAPI::co::get_stations(std::move(uuids));
+                std::unordered_map<std::string, Station> fresh;
+                for (auto& rb_station : result)
+                    fresh.try_emplace(rb_station.stationuuid,
+                                      Station::from_radio_browser(rb_station));
+                // Note: only the volatile fields; the others might have been edited.
+                for (auto& st : stations) {
+                    auto it = fresh.find(st->stationuuid);
+                    if (it == fresh.end())
+                        continue;
+                    st->votes       = it->second.votes;
+                    st->click_count = it->second.click_count;
+                    st->click_trend = it->second.click_trend;
+                    st->bitrate     = it->second.bitrate;
+                    st->codec       = it->second.codec;
+                }
+                cout << "Refreshed " << fresh.size() << " favorites" << endl;
+            }
+            catch (std::exception& e) {
+                cout << "ERROR: FavoritesTab: could not refresh favorites: "
+                     << e.what() << endl;
+            }
+        }
+
+
+        // Scan the stations shown.
+        void
+        scan()
+        {
+            if (tag_filter.empty()) {
+                PlayerTab::start_scan(stations);
+                return;
+            }
+            std::vector<std::shared_ptr<Station>> shown;
+            const auto& by_tag = get_index().by_tag;
+            if (auto it = by_tag.find(tag_filter); it != by_tag.end())
+                for (auto i : it->second)
+                    shown.push_back(stations[i]);
+            PlayerTab::start_scan(std::move(shown));
+        }
+
+
+        void
+        set_tag_filter(interned_string tag)
+        {
+            tag_filter = tag;
+            // The rows change, so their cached heights don't apply anymore.
+            stations_list.invalidate();
+        }
+
+
+        void
+        show_probe_result(const Station& station)
+        {
+            const auto& key = station.stationuuid.empty() ? station.url : station.stationuuid;
+            const auto res = station_prober::lookup(key);
+            if (!res)
+                return;
+
+            using namespace std::chrono;
+            const auto now = duration_cast<seconds>(system_clock::now().time_since_epoch());
+            const seconds age{std::max<std::int64_t>(0, now.count() - res->timestamp)};
+            if (res->ok) {
+                std::string text = ICON_FA_CHECK;
+                if (!res->codec.empty())
+                    text += " " + res->codec;
+                if (res->bitrate)
+                    text += " " + std::to_string(res->bitrate) + " kbps";
+                UI::show_boxed(text,
+                               "Worked " + humanize::duration(age) + " ago.\n" + res->url);
+            } else
+                UI::show_boxed(ICON_FA_EXCLAMATION_TRIANGLE " Offline",
+                               "Failed " + humanize::duration(age) + " ago.\n" + res->error);
+            ImGui::SameLine();
+        }
+
+
         void
         show_row(const std::string& label,
                  std::string& value)
@@ -398,7 +584,7 @@ namespace FavoritesTab {
                     if (ImGui::Button(ICON_FA_PENCIL))
                         ImGui::OpenPopup(popup_edit_title);
                     ImGui::SetItemTooltip("Edit this station.");
-                    process_popup_edit(*station);
+                    process_popup_edit(*station, index);
 
                     ImGui::SameLine();
 
@@ -432,7 +618,8 @@ namespace FavoritesTab {
                             ImGuiChildFlags_NavFlattened
                         }) {
 
-                        UI::show_tags(station->tags);
+                        show_probe_result(*station);
+                        UI::show_tags(*station);
 
                     } // extra_info
 
@@ -459,12 +646,62 @@ namespace FavoritesTab {
                 show_row("homepage",     st.homepage);
                 show_row("favicon",      st.favicon);
                 show_row("tags",         edit_fields->tags);
-                show_row("countrycode",  st.countrycode);
+                show_row("countrycode",  edit_fields->countrycode);
                 show_row("language",     edit_fields->language);
                 show_row("stationuuid",  st.stationuuid);
             }
         }
 
+
+        void
+        show_tag_filter()
+        {
+            const auto& by_tag = get_index().by_tag;
+            const std::string all_label = "All tags";
+
+            ImGui::SetNextItemWidth(400);
+            ImGui::SetNextWindowSizeConstraints({0, 0},
+                                                {1200.0f, FLT_MAX});
+            if (ImGui::RAII::Combo tag_combo{
+                    "##tag_filter",
+                    tag_filter.empty() ? all_label : tag_filter.str(),
+                    ImGuiComboFlags_HeightLargest
+                }) {
+                static ImGuiTextFilter text_filter;
+                if (ImGui::IsWindowAppearing()) {
+                    ImGui::SetKeyboardFocusHere();
+                    text_filter.Clear();
+                }
+                text_filter.Draw("##tag", 900);
+                if (ImGui::Selectable(all_label, tag_filter.empty()))
+                    set_tag_filter({});
+                for (auto& [tag, positions] : by_tag) {
+                    if (!text_filter.PassFilter(tag.data()))
+                        continue;
+                    const std::string label = tag.str() + " (" + std::to_string(positions.size()) + ")";
+                    if (ImGui::Selectable(label, tag_filter == tag))
+                        set_tag_filter(tag);
+                }
+            }
+            ImGui::SetItemTooltip("Only show stations with this tag.");
+        }
+
+
+        void
+        update_probe_targets()
+        {
+            std::vector<station_prober::target> targets;
+            targets.reserve(stations.size());
+            for (auto& st : stations)
+                targets.push_back({
+                        st->stationuuid.empty() ? st->url : st->stationuuid,
+                        st->url,
+                        st->url_resolved
+                    });
+            station_prober::set_targets(std::move(targets));
+            probe_targets_outdated = false;
+        }
+
     } // namespace
 
 
@@ -473,8 +710,9 @@ namespace FavoritesTab {
     add(const Station& st)
     {
         stations.push_back(std::make_shared<Station>(st));
-        if (!st.stationuuid.empty())
-            uuids.insert(st.stationuuid);
+        invalidate_index();
+        journal->add(st);
+        journal->maybe_compact(stations);
     }
 
 
@@ -484,8 +722,9 @@ namespace FavoritesTab {
         if (!station.stationuuid.empty())
             return contains(station.stationuuid);
 
-        for (const auto& st : stations)
-            if (station == *st)
+        auto [first, last] = get_index().by_url.equal_range(station.url);
+        for (auto it = first; it != last; ++it)
+            if (station == *stations[it->second])
                 return true;
         return false;
     }
@@ -496,14 +735,40 @@ namespace FavoritesTab {
     {
         if (uuid.empty())
             return false;
-        return uuids.contains(uuid);
+        return get_index().by_uuid.contains(uuid);
+    }
+
+
+    void
+    export_json()
+    try {
+        auto filename = App::get_config_path() / "favorites.json";
+        Serializer::save_async(stations, filename);
+    }
+    catch (std::exception& e) {
+        cout << "ERROR: Favorites::export_json(): " << e.what() << endl;
     }
 
 
     void
     finalize()
     {
-        save();
+        refresh_task = {};
+        if (journal)
+            journal->close(stations);
+        journal.reset();
+    }
+
+
+    std::shared_ptr<Station>
+    get_next(const Station& st)
+    {
+        if (stations.size() < 2)
+            return {};
+        for (std::size_t i = 0; i < stations.size(); ++i)
+            if (*stations[i] == st)
+                return stations[(i + 1) % stations.size()];
+        return {};
     }
 
 
@@ -511,6 +776,7 @@ namespace FavoritesTab {
     initialize()
     {
         load();
+        refresh_time = std::chrono::steady_clock::now() + refresh_delay;
     }
 
 
@@ -521,14 +787,9 @@ namespace FavoritesTab {
 
         stations.clear();
 
-        auto filename = App::get_config_path() / "favorites.json";
-        Serializer::load(stations, filename);
-
-        uuids.clear();
-        for (auto& st : stations) {
-            if (!st->stationuuid.empty())
-                uuids.insert(st->stationuuid);
-        }
+        journal.emplace(App::get_config_path() / "favorites.beve");
+        journal->load(stations);
+        invalidate_index();
 
         cout << "Loaded " << stations.size() << " favorites" << endl;
     }
@@ -540,6 +801,8 @@ namespace FavoritesTab {
     void
     process_logic()
     {
+        PROFILE_SCOPE("FavoritesTab::process_logic");
+
         // Handle any pending move
         if (move_operation) {
             auto [src, dst] = *move_operation;
@@ -550,6 +813,9 @@ namespace FavoritesTab {
             stations.insert(stations.begin() + dst, std::move(tmp));
             scroll_to_station = dst;
             move_operation.reset();
+            invalidate_index();
+            journal->move(src, dst);
+            journal->maybe_compact(stations);
         }
 
         // Handle pending delete
@@ -557,12 +823,26 @@ namespace FavoritesTab {
             remove(*station_index_to_remove);
             station_index_to_remove.reset();
         }
+
+        if (probe_targets_outdated)
+            update_probe_targets();
+
+        // Note: wait while a station is starting, so it gets the bandwidth.
+        if (refresh_time
+            && std::chrono::steady_clock::now() >= *refresh_time
+            && !PlayerTab::is_starting()) {
+            refresh_time.reset();
+            refresh_task = refresh_details();
+            refresh_task.start();
+        }
     }
 
 
     void
     process_ui()
     {
+        PROFILE_SCOPE("FavoritesTab::process_ui");
+
         if (ImGui::RAII::Child toolbar_child{
                 "toolbar",
                 {0, 0},
@@ -578,22 +858,78 @@ namespace FavoritesTab {
 
             ImGui::SameLine();
 
+            if (ImGui::Button(ICON_FA_SHARE_SQUARE_O " Export"))
+                export_json();
+            ImGui::SetItemTooltip("Save a copy of the favorites as \"favorites.json\".\n"
+                                  "To import it back after editing, delete \"favorites.beve\".");
+
+            ImGui::SameLine();
+
+            {
+                ImGui::RAII::Disabled disable_scan{stations.size() < 2};
+                // ⏩
+                if (ImGui::Button(ICON_FA_FAST_FORWARD " Scan"))
+                    scan();
+                ImGui::SetItemTooltip("Play each station for a few seconds.");
+            }
+
+            ImGui::SameLine();
+
+            show_tag_filter();
+
+            ImGui::SameLine();
+
             ImGui::AlignTextToFramePadding();
-            UI::show_text_right("%zu stations", stations.size());
+            if (tag_filter.empty())
+                UI::show_text_right("%zu stations", stations.size());
+            else {
+                const auto& by_tag = get_index().by_tag;
+                auto it = by_tag.find(tag_filter);
+                UI::show_text_right("%zu of %zu stations",
+                                    it != by_tag.end() ? it->second.size() : 0,
+                                    stations.size());
+            }
 
         } // toolbar_child
 
         // Note: flat navigation doesn't work well on child windows that scroll.
         if (ImGui::RAII::Child favorites_child{"favorites"}) {
 
-            for (std::size_t index = 0; index < stations.size(); ++index) {
-                show_station(stations[index], index);
-                if (scroll_to_station && *scroll_to_station == index) {
-                    ImGui::SetScrollHereY();
-                    scroll_to_station.reset();
-                }
+            // Note: copied, editing a station rebuilds the index.
+            std::vector<std::size_t> rows;
+            if (!tag_filter.empty()) {
+                const auto& by_tag = get_index().by_tag;
+                auto it = by_tag.find(tag_filter);
+                if (it != by_tag.end())
+                    rows = it->second;
+            }
+            const bool filtered = !tag_filter.empty();
+            auto position_of = [&rows, filtered](std::size_t row)
+            {
+                return filtered ? rows[row] : row;
+            };
+
+            std::optional<std::size_t> scroll_target;
+            if (scroll_to_station) {
+                if (!filtered)
+                    scroll_target = scroll_to_station;
+                else if (auto it = std::ranges::find(rows, *scroll_to_station);
+                         it != rows.end())
+                    scroll_target = it - rows.begin();
             }
 
+            stations_list.show(filtered ? rows.size() : stations.size(),
+                               [&position_of](std::size_t row)
+                               {
+                                   const std::size_t index = position_of(row);
+                                   show_station(stations[index], index);
+                                   if (scroll_to_station && *scroll_to_station == index) {
+                                       ImGui::SetScrollHereY();
+                                       scroll_to_station.reset();
+                                   }
+                               },
+                               scroll_target);
+
         }
     }
 
@@ -604,11 +940,10 @@ namespace FavoritesTab {
         if (index >= stations.size())
             return;
 
-        auto it = uuids.find(stations[index]->stationuuid);
-        if (it != uuids.end())
-            uuids.erase(it);
-
         stations.erase(stations.begin() + index);
+        invalidate_index();
+        journal->remove(index);
+        journal->maybe_compact(stations);
     }
 
 
@@ -617,16 +952,10 @@ namespace FavoritesTab {
     {
         if (uuid.empty())
             return;
-        if (!uuids.contains(uuid))
-            return;
-
-        auto u = uuids.find(uuid);
-        if (u != uuids.end())
-            uuids.erase(u);
-
-        auto s = std::ranges::find(stations, uuid, get_id);
-        if (s != stations.end())
-            stations.erase(s);
+        const auto& by_uuid = get_index().by_uuid;
+        auto it = by_uuid.find(uuid);
+        if (it != by_uuid.end())
+            remove(it->second);
     }
 
 
@@ -636,11 +965,10 @@ namespace FavoritesTab {
         if (!station.stationuuid.empty())
             return remove(station.stationuuid);
 
-        std::erase_if(stations,
-                      [&station](const std::shared_ptr<Station>& st)
-                      {
-                          return station.stationuuid == st->stationuuid;
-                      });
+        auto [first, last] = get_index().by_url.equal_range(station.url);
+        for (auto it = first; it != last; ++it)
+            if (station == *stations[it->second])
+                return remove(it->second);
     }
 
 
@@ -649,8 +977,8 @@ namespace FavoritesTab {
     try {
         TRACE_FUNC;
 
-        auto filename = App::get_config_path() / "favorites.json";
-        Serializer::save(stations, filename);
+        if (journal)
+            journal->compact(stations);
     }
     catch (std::exception& e) {
         cout << "ERROR: Favorites::save(): " << e.what() << endl;
@@ -8,6 +8,7 @@
 #ifndef FAVORITES_TAB_HPP
 #define FAVORITES_TAB_HPP
 
+#include <memory>
 #include <string>
 
 
@@ -25,9 +26,17 @@ namespace FavoritesTab {
     bool
     contains(const std::string& uuid);
 
+    // Save a copy as JSON, that the user can read and edit.
+    void
+    export_json();
+
     void
     finalize();
 
+    // Return the favorite after st, wrapping around; null if st is not a favorite.
+    std::shared_ptr<Station>
+    get_next(const Station& st);
+
     void
     initialize();
 
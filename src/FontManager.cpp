@@ -6,10 +6,13 @@
  */
 
 #include <iostream>
+#include <map>
 #include <memory>
+#include <optional>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <system_error>
 #include <utility>
 
 #include <imgui.h>
@@ -25,6 +28,9 @@
 
 #include "FontManager.hpp"
 
+#include "App.hpp"
+#include "memory_accounting.hpp"
+#include "Serializer.hpp"
 #include "tracer.hpp"
 
 
@@ -192,15 +198,86 @@ namespace FontManager {
         }
 
 
+        /*
+         * FcInit() scans all installed fonts, which is most of the startup time spent on
+         * fonts; so the matches are cached, and fontconfig is only used when one is
+         * missing. Delete the cache file to pick up newly installed fonts.
+         */
+        class MatchCache {
+
+            std::map<std::string, std::string> matches;
+            bool modified = false;
+            std::optional<fc::Init> fc_init;
+
+
+            static
+            std::filesystem::path
+            get_path()
+            {
+                return App::get_config_path() / "font-matches.beve";
+            }
+
+        public:
+
+            MatchCache()
+            {
+                try {
+                    if (Serializer::can_load(get_path()))
+                        Serializer::load(matches, get_path());
+                }
+                catch (std::exception& e) {
+                    cout << "ERROR: failed to load font matches: " << e.what() << endl;
+                    matches.clear();
+                }
+            }
+
+
+            ~MatchCache()
+                noexcept
+            {
+                if (!modified)
+                    return;
+                try {
+                    Serializer::save(matches, get_path());
+                }
+                catch (std::exception& e) {
+                    cout << "ERROR: failed to save font matches: " << e.what() << endl;
+                }
+            }
+
+
+            std::filesystem::path
+            find(const std::string& family,
+                 const std::string& lang)
+            {
+                const std::string key = family + "/" + lang + "/"
+                                      + std::to_string(default_size);
+                if (auto it = matches.find(key); it != matches.end()) {
+                    std::error_code ec;
+                    if (exists(std::filesystem::path{it->second}, ec))
+                        return it->second;
+                }
+
+                if (!fc_init)
+                    fc_init.emplace();
+                auto result = find_font(family, lang);
+                matches[key] = result.string();
+                modified = true;
+                return result;
+            }
+
+        }; // class MatchCache
+
+
         void
         load_system_fonts()
         {
-            fc::Init fc_init;
+            MatchCache cache;
 
-            auto cafe_std_path = find_font("nintendo_NTLG-DB_002", "en");
-            auto cafe_cn_path  = find_font("nintendo_HeiTiW5_002", "zh-cn");
-            auto cafe_ko_path  = find_font("nintendo_Tae-Gothic_002", "ko");
-            auto cafe_tw_path  = find_font("nintendo_HeiMedium-B5_002", "zh-tw");
+            auto cafe_std_path = cache.find("nintendo_NTLG-DB_002", "en");
+            auto cafe_cn_path  = cache.find("nintendo_HeiTiW5_002", "zh-cn");
+            auto cafe_ko_path  = cache.find("nintendo_Tae-Gothic_002", "ko");
+            auto cafe_tw_path  = cache.find("nintendo_HeiMedium-B5_002", "zh-tw");
 
             std::set<std::filesystem::path> extra_fonts{
                 cafe_cn_path,
@@ -262,6 +339,22 @@ namespace FontManager {
     }
 
 
+    void
+    process_logic()
+    {
+        const auto* atlas = ImGui::GetIO().Fonts;
+        std::size_t bytes = 0;
+        // Note: on the Wii U the font files are in shared system memory, not owned by us.
+        for (const auto& src : atlas->Sources)
+            if (src.FontDataOwnedByAtlas)
+                bytes += src.FontDataSize;
+        // Note: count the pixels twice, since the renderer keeps its own copy.
+        for (const ImTextureData* tex : atlas->TexList)
+            bytes += 2 * tex->GetSizeInBytes();
+        memory_accounting::get(memory_accounting::tag::fonts).set(bytes);
+    }
+
+
 
     void
     load(const std::filesystem::path& filename,
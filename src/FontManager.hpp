@@ -22,6 +22,11 @@ namespace FontManager {
     finalize();
 
 
+    // Updates the memory accounting; the atlas grows as new glyphs are used.
+    void
+    process_logic();
+
+
     void
     load(const std::filesystem::path& filename,
          bool merge = true);
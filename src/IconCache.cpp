@@ -0,0 +1,487 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // equal(), min(), min_element()
+#include <cctype>               // tolower()
+#include <chrono>
+#include <cstdint>
+#include <cstdio>               // snprintf()
+#include <fstream>
+#include <iterator>             // begin(), end()
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <utility>              // move()
+#include <vector>
+
+#include <SDL_surface.h>
+
+#include "IconCache.hpp"
+
+#include "Serializer.hpp"
+
+
+using std::cout;
+using std::endl;
+
+using namespace std::literals;
+
+
+namespace IconCache {
+
+    namespace {
+
+        struct Record {
+            std::string file;
+            unsigned width = 0;
+            unsigned height = 0;
+            std::uint64_t bytes = 0;
+            std::string etag;
+            std::string last_modified;
+            // Seconds since the epoch.
+            std::int64_t checked = 0;
+            std::int64_t last_use = 0;
+        };
+
+
+        // Note: version 2 has premultiplied alpha.
+        const char file_magic[4] = {'R', 'I', 'C', '2'};
+
+        struct FileHeader {
+            char magic[4] = {file_magic[0], file_magic[1], file_magic[2], file_magic[3]};
+            std::uint32_t width = 0;
+            std::uint32_t height = 0;
+        };
+
+
+        struct Failure {
+            unsigned count = 0;
+            // Seconds since the epoch.
+            std::int64_t retry_after = 0;
+        };
+
+
+        // Files are shared by locations with the same icon.
+        struct FileUsage {
+            std::uint64_t bytes = 0;
+            unsigned refs = 0;
+        };
+
+
+        const std::uint64_t size_budget = 32 * 1024 * 1024;
+
+        // After this long, ask the server if the icon changed.
+        const auto revalidate_period = std::chrono::days{7};
+
+        // Retry delays for failed locations: the first one, and the longest.
+        const std::int64_t min_backoff = 10 * 60;
+        const std::int64_t max_backoff = 7 * 24 * 60 * 60;
+
+        const std::size_t max_failures = 4096;
+
+
+        // Note: it's held during file I/O too, so two threads never write the same file.
+        std::mutex mutex;
+
+        std::filesystem::path cache_dir;
+        std::map<std::string, Record> index;
+        std::map<std::string, FileUsage> files;
+        std::uint64_t total_bytes = 0;
+        std::map<std::string, Failure> failures;
+
+
+        std::filesystem::path
+        index_path()
+        {
+            return cache_dir / "index.beve";
+        }
+
+
+        std::filesystem::path
+        failures_path()
+        {
+            return cache_dir / "failures.beve";
+        }
+
+
+        std::int64_t
+        now_seconds()
+        {
+            using namespace std::chrono;
+            return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+        }
+
+
+        // FNV-1a, 64 bits.
+        void
+        hash_bytes(std::uint64_t& h,
+                   const void* data,
+                   std::size_t size)
+            noexcept
+        {
+            auto ptr = static_cast<const unsigned char*>(data);
+            for (std::size_t i = 0; i < size; ++i) {
+                h ^= ptr[i];
+                h *= 0x100000001b3u;
+            }
+        }
+
+
+        void
+        add_ref(const Record& rec)
+        {
+            auto& usage = files[rec.file];
+            if (!usage.refs++) {
+                usage.bytes = rec.bytes;
+                total_bytes += rec.bytes;
+            }
+        }
+
+
+        void
+        release(const Record& rec)
+        {
+            auto it = files.find(rec.file);
+            if (it == files.end())
+                return;
+            if (--it->second.refs)
+                return;
+            total_bytes -= it->second.bytes;
+            files.erase(it);
+            std::error_code ec;
+            remove(cache_dir / rec.file, ec);
+        }
+
+
+        void
+        evict_until(std::uint64_t budget)
+        {
+            while (total_bytes > budget && !index.empty()) {
+                auto oldest = std::ranges::min_element(index,
+                                                       {},
+                                                       [](const auto& kv)
+                                                       {
+                                                           return kv.second.last_use;
+                                                       });
+                release(oldest->second);
+                index.erase(oldest);
+            }
+        }
+
+
+        // Forget failures long past their backoff, and the oldest ones if there are too many.
+        void
+        prune_failures(std::int64_t now)
+        {
+            std::erase_if(failures,
+                          [now](const auto& kv)
+                          {
+                              return now - kv.second.retry_after > max_backoff;
+                          });
+            while (failures.size() > max_failures) {
+                auto oldest = std::ranges::min_element(failures,
+                                                       {},
+                                                       [](const auto& kv)
+                                                       {
+                                                           return kv.second.retry_after;
+                                                       });
+                failures.erase(oldest);
+            }
+        }
+
+
+        // Delete the files that no record refers to, like after a crash.
+        void
+        remove_orphans()
+        {
+            std::error_code ec;
+            for (auto& de : std::filesystem::directory_iterator{cache_dir, ec}) {
+                auto name = de.path().filename().string();
+                if (name.ends_with(".rgba") && !files.contains(name))
+                    remove(de.path(), ec);
+            }
+        }
+
+
+        sdl::surface
+        read_thumbnail(const Record& rec)
+        {
+            std::ifstream in{cache_dir / rec.file, std::ios::binary};
+            FileHeader header;
+            if (!in.read(reinterpret_cast<char*>(&header), sizeof header))
+                throw std::runtime_error{"truncated file"};
+            if (!std::equal(std::begin(header.magic), std::end(header.magic), file_magic))
+                throw std::runtime_error{"old file format"};
+            if (header.width != rec.width || header.height != rec.height)
+                throw std::runtime_error{"size mismatch"};
+
+            sdl::vec2 size;
+            size.x = header.width;
+            size.y = header.height;
+            sdl::surface img;
+            img.create(size, 32, SDL_PIXELFORMAT_RGBA32);
+
+            SDL_Surface* s = img.data();
+            SDL_LockSurface(s);
+            bool ok = true;
+            for (int y = 0; ok && y < s->h; ++y)
+                ok = bool(in.read(static_cast<char*>(s->pixels) + y * s->pitch, s->w * 4));
+            SDL_UnlockSurface(s);
+            if (!ok)
+                throw std::runtime_error{"truncated file"};
+            return img;
+        }
+
+
+        // Returns the file name.
+        std::string
+        write_thumbnail(sdl::surface& img,
+                        std::uint64_t& bytes)
+        {
+            SDL_Surface* s = SDL_ConvertSurfaceFormat(img.data(), SDL_PIXELFORMAT_RGBA32, 0);
+            if (!s)
+                throw std::runtime_error{"SDL_ConvertSurfaceFormat() failed: "s
+                                         + SDL_GetError()};
+
+            FileHeader header;
+            header.width = s->w;
+            header.height = s->h;
+            const std::size_t row_size = s->w * 4;
+            bytes = sizeof header + row_size * s->h;
+
+            SDL_LockSurface(s);
+            std::uint64_t h = 0xcbf29ce484222325u;
+            hash_bytes(h, &header, sizeof header);
+            for (int y = 0; y < s->h; ++y)
+                hash_bytes(h, static_cast<const char*>(s->pixels) + y * s->pitch, row_size);
+
+            char name[32];
+            std::snprintf(name, sizeof name, "%016llx.rgba", static_cast<unsigned long long>(h));
+
+            auto path = cache_dir / name;
+            bool ok = true;
+            std::error_code ec;
+            if (!exists(path, ec)) {
+                auto tmp_path = path;
+                tmp_path += ".tmp";
+                {
+                    std::ofstream out{tmp_path, std::ios::binary};
+                    out.write(reinterpret_cast<const char*>(&header), sizeof header);
+                    for (int y = 0; y < s->h; ++y)
+                        out.write(static_cast<const char*>(s->pixels) + y * s->pitch,
+                                  row_size);
+                    ok = bool(out);
+                }
+                if (ok)
+                    rename(tmp_path, path, ec);
+                ok = ok && !ec;
+                if (!ok)
+                    remove(tmp_path, ec);
+            }
+            SDL_UnlockSurface(s);
+            SDL_FreeSurface(s);
+            if (!ok)
+                throw std::runtime_error{"failed to write \"" + path.string() + "\""};
+            return name;
+        }
+
+    } // namespace
+
+
+    void
+    initialize(const std::filesystem::path& dir)
+    {
+        std::lock_guard guard{mutex};
+        cache_dir = dir;
+        index.clear();
+        files.clear();
+        total_bytes = 0;
+        failures.clear();
+        try {
+            create_directories(cache_dir);
+            if (Serializer::can_load(index_path()))
+                Serializer::load(index, index_path());
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: IconCache::initialize(): " << e.what() << endl;
+            index.clear();
+        }
+        try {
+            if (Serializer::can_load(failures_path()))
+                Serializer::load(failures, failures_path());
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: IconCache::initialize(): " << e.what() << endl;
+            failures.clear();
+        }
+        for (auto& [location, rec] : index)
+            add_ref(rec);
+        remove_orphans();
+        evict_until(size_budget);
+        prune_failures(now_seconds());
+    }
+
+
+    void
+    finalize()
+    try {
+        std::lock_guard guard{mutex};
+        if (cache_dir.empty())
+            return;
+        Serializer::save(index, index_path());
+        Serializer::save(failures, failures_path());
+        cache_dir.clear();
+    }
+    catch (std::exception& e) {
+        cout << "ERROR: IconCache::finalize(): " << e.what() << endl;
+    }
+
+
+    std::optional<hit>
+    load(const std::string& location)
+    {
+        std::lock_guard guard{mutex};
+        if (cache_dir.empty())
+            return {};
+        auto it = index.find(canonical_url(location));
+        if (it == index.end())
+            return {};
+
+        auto& rec = it->second;
+        try {
+            hit result;
+            result.img = read_thumbnail(rec);
+            result.valid.etag = rec.etag;
+            result.valid.last_modified = rec.last_modified;
+            const auto now = now_seconds();
+            result.stale = now - rec.checked
+                > std::chrono::duration_cast<std::chrono::seconds>(revalidate_period).count();
+            rec.last_use = now;
+            return result;
+        }
+        catch (std::exception& e) {
+            cout << "WARNING: IconCache::load(): \"" << rec.file << "\": " << e.what() << endl;
+            release(rec);
+            index.erase(it);
+            return {};
+        }
+    }
+
+
+    void
+    store(const std::string& location,
+          sdl::surface& img,
+          const validators& valid,
+          const std::string& final_location)
+    {
+        std::lock_guard guard{mutex};
+        if (cache_dir.empty())
+            return;
+        try {
+            Record rec;
+            rec.file = write_thumbnail(img, rec.bytes);
+            rec.width = img.data()->w;
+            rec.height = img.data()->h;
+            rec.etag = valid.etag;
+            rec.last_modified = valid.last_modified;
+            rec.checked = rec.last_use = now_seconds();
+
+            std::vector<std::string> keys{canonical_url(location)};
+            if (!final_location.empty()) {
+                auto alias = canonical_url(final_location);
+                if (alias != keys.front())
+                    keys.push_back(std::move(alias));
+            }
+            for (auto& key : keys) {
+                // Note: add the new reference first, so a shared file is not deleted.
+                add_ref(rec);
+                if (auto it = index.find(key); it != index.end())
+                    release(it->second);
+                index[key] = rec;
+                failures.erase(key);
+            }
+            evict_until(size_budget);
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: IconCache::store(): " << e.what() << endl;
+        }
+    }
+
+
+    void
+    refresh(const std::string& location)
+    {
+        std::lock_guard guard{mutex};
+        auto it = index.find(canonical_url(location));
+        if (it != index.end())
+            it->second.checked = it->second.last_use = now_seconds();
+    }
+
+
+    bool
+    is_failing(const std::string& location)
+    {
+        std::lock_guard guard{mutex};
+        auto it = failures.find(canonical_url(location));
+        return it != failures.end() && now_seconds() < it->second.retry_after;
+    }
+
+
+    void
+    record_failure(const std::string& location)
+    {
+        std::lock_guard guard{mutex};
+        auto& fail = failures[canonical_url(location)];
+        const unsigned shift = std::min(fail.count, 16u);
+        const std::int64_t delay = std::min(min_backoff << shift, max_backoff);
+        ++fail.count;
+        fail.retry_after = now_seconds() + delay;
+        if (failures.size() > max_failures)
+            prune_failures(now_seconds());
+    }
+
+
+    std::string
+    canonical_url(std::string_view url)
+    {
+        auto scheme_end = url.find("://");
+        if (scheme_end == std::string_view::npos)
+            return std::string{url};
+
+        std::string result;
+        result.reserve(url.size());
+        for (char c : url.substr(0, scheme_end))
+            result.push_back(std::tolower(static_cast<unsigned char>(c)));
+        const std::string scheme = result;
+        result += "://";
+
+        auto rest = url.substr(scheme_end + 3);
+        auto authority_end = rest.find_first_of("/?#");
+        auto authority = rest.substr(0, authority_end);
+        rest.remove_prefix(authority.size());
+
+        // Note: the user info is case-sensitive, only the host is not.
+        if (auto at = authority.rfind('@'); at != std::string_view::npos) {
+            result += authority.substr(0, at + 1);
+            authority.remove_prefix(at + 1);
+        }
+        if ((scheme == "http" && authority.ends_with(":80"))
+            || (scheme == "https" && authority.ends_with(":443")))
+            authority.remove_suffix(authority.size() - authority.rfind(':'));
+        for (char c : authority)
+            result.push_back(std::tolower(static_cast<unsigned char>(c)));
+
+        rest = rest.substr(0, rest.find('#'));
+        if (!rest.starts_with('/'))
+            result += '/';
+        result += rest;
+        return result;
+    }
+
+} // namespace IconCache
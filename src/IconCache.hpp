@@ -0,0 +1,92 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef ICON_CACHE_HPP
+#define ICON_CACHE_HPP
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <sdl2xx/surface.hpp>
+
+
+/*
+ * Disk cache for downscaled icons.
+ *
+ * Thumbnails are stored as raw RGBA files, named by a hash of their pixels, so stations
+ * that share an icon also share the file. An index maps each location to its file, and
+ * keeps the HTTP validators; when the total size goes over budget, the least recently
+ * used locations are evicted.
+ *
+ * Locations that failed to load are remembered too, and not retried until their backoff
+ * period expires; the period doubles with each consecutive failure.
+ *
+ * All functions are thread-safe.
+ */
+namespace IconCache {
+
+    struct validators {
+        std::string etag;
+        std::string last_modified;
+    };
+
+
+    struct hit {
+        sdl::surface img;
+        validators valid;
+        // Set when the server should be asked if the icon changed.
+        bool stale = false;
+    };
+
+
+    void
+    initialize(const std::filesystem::path& dir);
+
+    void
+    finalize();
+
+
+    std::optional<hit>
+    load(const std::string& location);
+
+
+    /*
+     * When the download was redirected, final_location is where it ended; it's stored as
+     * an alias, so other locations redirecting there don't need to download it again.
+     */
+    void
+    store(const std::string& location,
+          sdl::surface& img,
+          const validators& valid,
+          const std::string& final_location = {});
+
+
+    // The server said the stored icon is still current.
+    void
+    refresh(const std::string& location);
+
+
+    // True if the location failed recently, and should not be tried yet.
+    bool
+    is_failing(const std::string& location);
+
+    void
+    record_failure(const std::string& location);
+
+
+    /*
+     * Normalize a URL, so trivially different spellings use the same entry: the scheme
+     * and host are lowercased, default ports and the fragment are removed.
+     */
+    std::string
+    canonical_url(std::string_view url);
+
+} // namespace IconCache
+
+#endif
@@ -6,31 +6,45 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cmath>
-#include <concepts>
 #include <filesystem>
-#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <optional>
 #include <queue>
-#include <ranges>
 #include <span>
 #include <string>
 #include <thread>
+#include <tuple>
+#include <utility>              // move(), pair
 #include <vector>
 
 #include <curlxx/curl.hpp>
+#include <imgui.h>
 #include <sdl2xx/img.hpp>
 
 #include "IconManager.hpp"
 
 #include "App.hpp"
 #include "async_queue.hpp"
+#include "atlas_allocator.hpp"
+#include "cfg.hpp"
+#include "curl_share.hpp"
+#include "IconCache.hpp"
+#include "memory_accounting.hpp"
+#include "metrics.hpp"
+#include "mpmc_queue.hpp"
+#include "Profiler.hpp"
+#include "thread_policy.hpp"
 #include "thread_safe.hpp"
+#include "thumbnail.hpp"
 #include "tracer.hpp"
 
 
@@ -46,16 +60,32 @@ namespace IconManager {
 
     std::filesystem::path content_prefix;
 
-    const std::size_t max_cache_size = 256;
+    // Limit for entries without pixels too, like errors.
+    const std::size_t max_cache_size = 1024;
 
-    std::uint64_t use_counter = 0;
+    // Icons used this recently are not evicted, even when over budget.
+    const auto min_icon_lifetime = 1s;
+
+    const int atlas_size = 1024;
+    const std::size_t atlas_page_bytes = std::size_t(atlas_size) * atlas_size * 4;
 
     sdl::renderer* renderer = nullptr;
+
+    // Falls back to SDL_BLENDMODE_BLEND if the renderer can't do it.
+    SDL_BlendMode premultiplied_blend_mode = SDL_BLENDMODE_BLEND;
+
     sdl::texture error_icon;
     sdl::texture loading_icon;
 
     std::optional<curl::multi> multi;
 
+    // Lets other threads interrupt curl_multi_poll() in the worker.
+    std::mutex wake_mutex;
+    CURLM* wake_handle = nullptr;
+
+    // The worker wakes up at least this often, even with nothing to do.
+    const int idle_poll_ms = 1000;
+
 
     enum class LoadState : int {
         unloaded,
@@ -71,12 +101,32 @@ namespace IconManager {
 
     struct CacheEntry {
         std::atomic<LoadState> state{LoadState::unloaded};
-        std::uint64_t last_use = 0;
+        std::chrono::steady_clock::time_point last_use;
+        // Intrusive LRU list, from the most recently used.
+        CacheEntry* lru_prev = nullptr;
+        CacheEntry* lru_next = nullptr;
+        // What this entry adds to surface_bytes and texture_bytes.
+        std::size_t img_bytes = 0;
+        std::size_t tex_bytes = 0;
         sdl::surface img;
         sdl::texture tex;
         std::optional<curl::easy> easy;
         std::optional<std::vector<char>> raw_buf;
         std::string location;
+        // Set when the image came from the disk cache, and is only being revalidated.
+        bool revalidating = false;
+        // The last ImGui frame that asked for this icon.
+        int last_frame = 0;
+        // Requested by prefetch(), but not shown yet.
+        bool prefetched = false;
+        // Prefetched with urgent set; starts before everything else.
+        bool urgent = false;
+        // Thumbnails have premultiplied alpha; local images don't.
+        bool premultiplied = true;
+        // Where the image is, when it's in an atlas page instead of tex.
+        int atlas_page = -1;
+        sdl::vec2 atlas_pos;
+        sdl::vec2 atlas_img_size;
     };
 
 
@@ -84,6 +134,23 @@ namespace IconManager {
     using cache_t = std::unordered_map<std::string, CacheEntry>;
     thread_safe<cache_t> safe_cache;
 
+    // Note: these are protected by the safe_cache lock too.
+    CacheEntry* lru_head = nullptr;
+    CacheEntry* lru_tail = nullptr;
+    std::size_t surface_bytes = 0;
+    std::size_t texture_bytes = 0;
+    // Thumbnails are packed into these, so lists of icons share a few textures.
+    struct AtlasPage {
+        sdl::texture tex;
+        Uint32 format = 0;
+        atlas_allocator cells{atlas_size};
+    };
+    std::vector<std::unique_ptr<AtlasPage>> atlas_pages;
+    // Entries for the downloads currently in multi.
+    std::unordered_map<const curl::easy*, CacheEntry*> downloads;
+    // Canonical URLs being downloaded or decoded; others with the same URL wait for them.
+    std::unordered_set<std::string> active_urls;
+
 
     // std::queue<std::string> load_queue;
     async_queue<std::string> requests_queue;
@@ -92,9 +159,186 @@ namespace IconManager {
     std::jthread worker_thread;
 
 
+    // Note: only the worker thread uses this.
+    std::vector<std::string> pending_requests;
+
+    const std::size_t max_active_downloads = 10;
+
+    // Icons are small; anything bigger than this is not an icon.
+    const std::size_t max_download_size = 2 * 1024 * 1024;
+
+    // Downloads for icons not shown for this many frames are canceled.
+    const int stale_frames = 90;
+
+    std::atomic<int> current_frame = 0;
+
+    // Note: copies of the cfg budgets (in bytes), published by the main thread, for the
+    // worker's trim_cache().
+    std::atomic<std::size_t> surface_budget = 0;
+    std::atomic<std::size_t> texture_budget = 0;
+
+
+    // A finished download, waiting to be decoded.
+    struct DecodeJob {
+        std::string location;
+        std::vector<char> raw;
+        IconCache::validators valid;
+        // Where the download ended, after redirections.
+        std::string final_location;
+        // Only refresh the disk cache, the entry already has an image.
+        bool revalidating = false;
+    };
+
+    // Note: when full, the worker thread waits for the decode threads.
+    mpmc_queue<DecodeJob> decode_queue{32};
+
+    // Note: decoding is CPU-bound, while the worker thread mostly waits on the network.
+    std::array<std::jthread, 2> decode_threads;
+
+
+    // Texture creation budget for each frame.
+    const unsigned max_uploads_per_frame = 4;
+    const std::size_t max_upload_bytes_per_frame = 512 * 1024;
+
+    int upload_frame = -1;
+    unsigned frame_uploads = 0;
+    std::size_t frame_upload_bytes = 0;
+
+
     void
     worker_func(std::stop_token token);
 
+    void
+    decode_func(std::stop_token token);
+
+    sdl::surface
+    make_thumbnail(std::vector<char>& raw);
+
+    void
+    process_one_request(const std::string& location);
+
+
+    void
+    lru_unlink(CacheEntry& entry)
+        noexcept
+    {
+        if (entry.lru_prev)
+            entry.lru_prev->lru_next = entry.lru_next;
+        else if (lru_head == &entry)
+            lru_head = entry.lru_next;
+        if (entry.lru_next)
+            entry.lru_next->lru_prev = entry.lru_prev;
+        else if (lru_tail == &entry)
+            lru_tail = entry.lru_prev;
+        entry.lru_prev = entry.lru_next = nullptr;
+    }
+
+
+    void
+    lru_touch(CacheEntry& entry)
+        noexcept
+    {
+        entry.last_use = std::chrono::steady_clock::now();
+        if (lru_head == &entry)
+            return;
+        lru_unlink(entry);
+        entry.lru_next = lru_head;
+        if (lru_head)
+            lru_head->lru_prev = &entry;
+        lru_head = &entry;
+        if (!lru_tail)
+            lru_tail = &entry;
+    }
+
+
+    std::size_t
+    surface_size(const sdl::surface& img)
+        noexcept
+    {
+        if (!img)
+            return 0;
+        const SDL_Surface* s = img.data();
+        return static_cast<std::size_t>(s->pitch) * s->h;
+    }
+
+
+    void
+    publish_memory()
+        noexcept
+    {
+        using memory_accounting::tag;
+        memory_accounting::get(tag::icon_surfaces).set(surface_bytes);
+        memory_accounting::get(tag::icon_textures).set(texture_bytes);
+    }
+
+
+    // Update the memory accounting after entry.img or entry.tex changed.
+    void
+    account(CacheEntry& entry,
+            std::size_t tex_bytes)
+        noexcept
+    {
+        surface_bytes -= entry.img_bytes;
+        texture_bytes -= entry.tex_bytes;
+        entry.img_bytes = surface_size(entry.img);
+        entry.tex_bytes = tex_bytes;
+        surface_bytes += entry.img_bytes;
+        texture_bytes += entry.tex_bytes;
+        publish_memory();
+    }
+
+
+    void
+    erase_entry(cache_t& cache,
+                cache_t::iterator it)
+    {
+        auto& entry = it->second;
+        if (entry.easy) {
+            // If removing an active request, make sure it's removed from the curl::multi.
+            multi->remove(*entry.easy);
+            downloads.erase(&*entry.easy);
+            active_urls.erase(IconCache::canonical_url(entry.location));
+        }
+        if (entry.atlas_page >= 0)
+            atlas_pages[entry.atlas_page]->cells.release(entry.atlas_pos,
+                                                         entry.atlas_img_size);
+        lru_unlink(entry);
+        surface_bytes -= entry.img_bytes;
+        texture_bytes -= entry.tex_bytes;
+        publish_memory();
+        cache.erase(it);
+    }
+
+
+    // Note: only call this from the main thread, that owns cfg::state.
+    void
+    publish_budgets()
+        noexcept
+    {
+        surface_budget.store(std::size_t(cfg::state.icon_memory_budget) << 20,
+                             std::memory_order_relaxed);
+        texture_budget.store(std::size_t(cfg::state.icon_video_budget) << 20,
+                             std::memory_order_relaxed);
+    }
+
+
+    void
+    wake_worker()
+        noexcept
+    {
+        std::lock_guard guard{wake_mutex};
+        if (wake_handle)
+            curl_multi_wakeup(wake_handle);
+    }
+
+
+    void
+    enqueue(const std::string& location)
+    {
+        requests_queue.push(location);
+        wake_worker();
+    }
+
 
     void
     initialize(sdl::renderer& rend)
@@ -114,9 +358,32 @@ namespace IconManager {
                                               content_prefix / "ui/loading-icon.png");
         loading_icon.set_blend_mode(SDL_BLENDMODE_BLEND);
 
+        premultiplied_blend_mode = SDL_ComposeCustomBlendMode(SDL_BLENDFACTOR_ONE,
+                                                              SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                                                              SDL_BLENDOPERATION_ADD,
+                                                              SDL_BLENDFACTOR_ONE,
+                                                              SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                                                              SDL_BLENDOPERATION_ADD);
+        try {
+            // Check if the renderer supports it, on a texture we already have.
+            loading_icon.set_blend_mode(premultiplied_blend_mode);
+        }
+        catch (std::exception& e) {
+            cout << "WARNING: IconManager: no premultiplied alpha blending: "
+                 << e.what() << endl;
+            premultiplied_blend_mode = SDL_BLENDMODE_BLEND;
+        }
+        loading_icon.set_blend_mode(SDL_BLENDMODE_BLEND);
+
+        IconCache::initialize(App::get_config_path() / "icon-cache");
+
+        publish_budgets();
         requests_queue.reset();
+        decode_queue.reset();
         cout << "IconManager: launching worker thread." << endl;
         worker_thread = std::jthread{worker_func};
+        for (auto& t : decode_threads)
+            t = std::jthread{decode_func};
 
         assert((std::atomic<LoadState>{}.is_lock_free()));
     }
@@ -129,15 +396,28 @@ namespace IconManager {
 
         cout << "Stopping requests_queue" << endl;
         requests_queue.stop();
+        wake_worker();
 
         cout << "Destroying thread." << endl;
         worker_thread = {};
         cout << "Thread destroyed." << endl;
 
+        decode_queue.stop();
+        for (auto& t : decode_threads)
+            t = {};
+
+        IconCache::finalize();
+
         {
             cout << "Clearing safe_cache" << endl;
             auto cache = safe_cache.lock();
             cache->clear();
+            downloads.clear();
+            active_urls.clear();
+            atlas_pages.clear();
+            lru_head = lru_tail = nullptr;
+            surface_bytes = texture_bytes = 0;
+            publish_memory();
         }
 
         cout << "Destroying predefined icons" << endl;
@@ -146,39 +426,203 @@ namespace IconManager {
     }
 
 
-    const sdl::texture*
-    get(const std::string& location)
+    // Decide if this entry's texture can be created in this frame.
+    bool
+    can_upload(const CacheEntry& entry)
+    {
+        const int frame = ImGui::GetFrameCount();
+        if (frame != upload_frame) {
+            upload_frame = frame;
+            frame_uploads = 0;
+            frame_upload_bytes = 0;
+        }
+        // Note: always allow one, so a big icon can't get stuck.
+        if (frame_uploads
+            && (frame_uploads >= max_uploads_per_frame
+                || frame_upload_bytes + entry.img_bytes > max_upload_bytes_per_frame))
+            return false;
+        ++frame_uploads;
+        frame_upload_bytes += entry.img_bytes;
+        return true;
+    }
+
+
+    icon
+    make_icon(const sdl::texture& tex)
+    {
+        icon result;
+        result.texture = &tex;
+        result.size = tex.get_size();
+        return result;
+    }
+
+
+    icon
+    make_icon(const CacheEntry& entry)
+    {
+        if (entry.atlas_page < 0)
+            return make_icon(entry.tex);
+
+        const float scale = 1.0f / atlas_size;
+        const sdl::vec2 pos = entry.atlas_pos;
+        const sdl::vec2 size = entry.atlas_img_size;
+        icon result;
+        result.texture = &atlas_pages[entry.atlas_page]->tex;
+        result.size = size;
+        // Note: inset by half a texel, so linear filtering doesn't sample the neighbors.
+        result.uv0 = {(pos.x + 0.5f) * scale,
+                      (pos.y + 0.5f) * scale};
+        result.uv1 = {(pos.x + size.x - 0.5f) * scale,
+                      (pos.y + size.y - 0.5f) * scale};
+        return result;
+    }
+
+
+    std::size_t
+    max_atlas_pages()
+    {
+        const std::size_t budget = std::size_t(cfg::state.icon_video_budget) << 20;
+        return std::max<std::size_t>(1, budget / atlas_page_bytes);
+    }
+
+
+    AtlasPage&
+    add_atlas_page()
+    {
+        sdl::vec2 size;
+        size.x = size.y = atlas_size;
+        sdl::surface blank;
+        blank.create(size, 32, SDL_PIXELFORMAT_RGBA32);
+
+        auto page = std::make_unique<AtlasPage>();
+        page->tex.create(*renderer, blank);
+        page->tex.set_blend_mode(premultiplied_blend_mode);
+        // Note: SDL_UpdateTexture() needs pixels in the texture's format.
+        if (SDL_QueryTexture(page->tex.data(), &page->format, nullptr, nullptr, nullptr))
+            throw std::runtime_error{"SDL_QueryTexture() failed: "s + SDL_GetError()};
+        atlas_pages.push_back(std::move(page));
+        return *atlas_pages.back();
+    }
+
+
+    // Returns false if it doesn't fit in the atlas pages we can have.
+    bool
+    upload_to_atlas(CacheEntry& entry)
+    {
+        const sdl::vec2 size = entry.img.get_size();
+        std::optional<sdl::vec2> pos;
+        std::size_t index = 0;
+        for (; index < atlas_pages.size() && !pos; ++index)
+            pos = atlas_pages[index]->cells.allocate(size);
+        if (pos)
+            --index;
+        else {
+            if (atlas_pages.size() >= max_atlas_pages())
+                return false;
+            add_atlas_page();
+            index = atlas_pages.size() - 1;
+            pos = atlas_pages[index]->cells.allocate(size);
+            if (!pos)
+                return false;
+        }
+        auto& page = *atlas_pages[index];
+
+        SDL_Surface* src = entry.img.data();
+        SDL_Surface* converted = nullptr;
+        if (src->format->format != page.format) {
+            converted = SDL_ConvertSurfaceFormat(src, page.format, 0);
+            if (!converted) {
+                page.cells.release(*pos, size);
+                return false;
+            }
+            src = converted;
+        }
+        SDL_Rect rect{pos->x, pos->y, size.x, size.y};
+        SDL_LockSurface(src);
+        const int status = SDL_UpdateTexture(page.tex.data(), &rect, src->pixels, src->pitch);
+        SDL_UnlockSurface(src);
+        if (converted)
+            SDL_FreeSurface(converted);
+        if (status) {
+            page.cells.release(*pos, size);
+            return false;
+        }
+
+        entry.atlas_page = index;
+        entry.atlas_pos = *pos;
+        entry.atlas_img_size = size;
+        entry.img.destroy();
+        const std::size_t cell = page.cells.cell_for(size);
+        account(entry, cell * cell * 4);
+        return true;
+    }
+
+
+    void
+    upload(CacheEntry& entry)
+    {
+        if (entry.premultiplied && upload_to_atlas(entry))
+            return;
+
+        // Local images, or when the atlas is full.
+        entry.tex.create(*renderer, entry.img);
+        if (entry.premultiplied)
+            entry.tex.set_blend_mode(premultiplied_blend_mode);
+        else
+            entry.tex.set_blend_mode(SDL_BLENDMODE_BLEND);
+        const sdl::vec2 size = entry.img.get_size();
+        entry.img.destroy();
+        account(entry, std::size_t(size.x) * size.y * 4);
+    }
+
+
+    icon
+    lookup(const std::string& location,
+           bool prefetching,
+           bool urgent = false)
     {
-        ++use_counter;
+        PROFILE_SCOPE("IconManager::get");
+
+        const int frame = ImGui::GetFrameCount();
+        current_frame = frame;
+        publish_budgets();
         auto cache = safe_cache.lock();
         auto it = cache->find(location);
         try {
             if (it != cache->end()) {
                 auto& status = it->second;
-                status.last_use = use_counter;
+                if (!prefetching) {
+                    lru_touch(status);
+                    status.last_frame = frame;
+                    status.prefetched = false;
+                } else if (urgent)
+                    status.urgent = true;
 
                 try {
                     switch (status.state) {
 
                         case LoadState::loaded:
-                            if (!status.tex) {
-                                status.tex.create(*renderer, status.img);
-                                status.tex.set_blend_mode(SDL_BLENDMODE_BLEND);
-                                status.img.destroy();
+                            if (!status.tex && status.atlas_page < 0) {
+                                if (!can_upload(status))
+                                    return make_icon(loading_icon);
+                                upload(status);
                             }
-                            return &status.tex;
+                            return make_icon(status);
 
                         case LoadState::error:
-                            return &error_icon;
+                            return make_icon(error_icon);
 
                         case LoadState::requested:
                         case LoadState::loading:
-                            return &loading_icon;
+                            return make_icon(loading_icon);
 
                         case LoadState::unloaded:
-                            status.state = LoadState::loading;
-                            requests_queue.push(location);
-                            return &loading_icon;
+                            status.state = LoadState::requested;
+                            status.last_frame = frame;
+                            status.prefetched = prefetching;
+                            status.urgent = urgent;
+                            enqueue(location);
+                            return make_icon(loading_icon);
 
                         default:
                             throw std::logic_error{"invalid entry state: "
@@ -190,35 +634,139 @@ namespace IconManager {
                     throw;
                 }
             } else {
-                (*cache)[location].state = LoadState::requested;
-                requests_queue.push(location);
-                return &loading_icon;
+                auto& entry = (*cache)[location];
+                entry.location = location;
+                entry.state = LoadState::requested;
+                entry.last_frame = frame;
+                entry.prefetched = prefetching;
+                entry.urgent = urgent;
+                lru_touch(entry);
+                enqueue(location);
+                return make_icon(loading_icon);
             }
         }
         catch (std::exception& e) {
             cout << "ERROR: IconManager::get(): " << e.what() << endl;
-            return &error_icon;
+            return make_icon(error_icon);
         }
     }
 
 
-    // Find a CacheEntry that contains this specific curl::easy object.
-    CacheEntry*
-    find(thread_safe<cache_t>::guard<cache_t>& cache,
-         const curl::easy* ez)
+    const sdl::texture*
+    get(const std::string& location)
+    {
+        return lookup(location, false).texture;
+    }
+
+
+    icon
+    get_icon(const std::string& location)
     {
-        // TODO: use an auxiliary data structure to speed this up
-        for (auto& [location, entry] : *cache)
-            if (entry.easy && &*entry.easy == ez)
-                return &entry;
-        return nullptr;
+        return lookup(location, false);
+    }
+
+
+    void
+    prefetch(const std::string& location,
+             bool urgent)
+    {
+        if (!location.empty())
+            lookup(location, true, urgent);
+    }
+
+
+    bool
+    is_stale(const CacheEntry& entry,
+             int frame)
+        noexcept
+    {
+        // Note: prefetched icons are expected to not be visible yet.
+        return !entry.prefetched && frame - entry.last_frame > stale_frames;
+    }
+
+
+    // Start the urgent requests first, then the ones for the most recently shown icons.
+    void
+    start_pending_requests()
+    {
+        if (pending_requests.empty())
+            return;
+
+        {
+            auto cache = safe_cache.lock();
+            const int frame = current_frame;
+            std::vector<std::pair<std::tuple<bool, bool, int>, std::string>> sorted;
+            sorted.reserve(pending_requests.size());
+            for (auto& location : pending_requests) {
+                auto it = cache->find(location);
+                if (it == cache->end())
+                    continue;
+                auto& entry = it->second;
+                if (entry.state != LoadState::requested)
+                    continue;
+                if (is_stale(entry, frame)) {
+                    // Scrolled past before it even started.
+                    entry.state = LoadState::unloaded;
+                    continue;
+                }
+                sorted.emplace_back(std::tuple{entry.urgent,
+                                               !entry.prefetched,
+                                               entry.last_frame},
+                                    std::move(location));
+            }
+            std::ranges::sort(sorted,
+                              std::ranges::greater{},
+                              [](const auto& p) { return p.first; });
+            pending_requests.clear();
+            for (auto& p : sorted)
+                pending_requests.push_back(std::move(p.second));
+        }
+
+        std::vector<std::string> deferred;
+        for (auto& location : pending_requests) {
+            bool busy;
+            {
+                auto cache = safe_cache.lock();
+                busy = downloads.size() >= max_active_downloads
+                    || active_urls.contains(IconCache::canonical_url(location));
+            }
+            // Note: a request for a URL already active will likely find it in IconCache.
+            if (busy)
+                deferred.push_back(std::move(location));
+            else
+                process_one_request(location);
+        }
+        pending_requests = std::move(deferred);
+    }
+
+
+    // Cancel the downloads for icons that are not being shown anymore.
+    void
+    cancel_stale_downloads()
+    {
+        auto cache = safe_cache.lock();
+        const int frame = current_frame;
+        for (auto it = downloads.begin(); it != downloads.end();) {
+            CacheEntry* entry = it->second;
+            if (!is_stale(*entry, frame)) {
+                ++it;
+                continue;
+            }
+            it = downloads.erase(it);
+            active_urls.erase(IconCache::canonical_url(entry->location));
+            multi->remove(*entry->easy);
+            entry->easy.reset();
+            entry->raw_buf.reset();
+            entry->state = entry->revalidating ? LoadState::loaded : LoadState::unloaded;
+            entry->revalidating = false;
+        }
     }
 
 
     void
     process_one_request(const std::string& location)
     {
-        // TRACE("IconManager::process_one_request(\"" + location + "\")");
+        TRACE_FUNC;
 
         cache_t::iterator it;
 
@@ -242,6 +790,29 @@ namespace IconManager {
 
             if (location.starts_with("http://") || location.starts_with("https://")) {
                 // URL
+                static auto& cache_hits = metrics::get_counter("icons/cache_hits");
+                static auto& cache_misses = metrics::get_counter("icons/cache_misses");
+                std::optional<IconCache::hit> hit = IconCache::load(location);
+                // Note: a stale hit still needs a request, so it counts as a miss.
+                if (hit && !hit->stale)
+                    cache_hits.add();
+                else
+                    cache_misses.add();
+                if (hit) {
+                    auto cache = safe_cache.lock();
+                    entry.img = std::move(hit->img);
+                    account(entry, 0);
+                    entry.state = LoadState::loaded;
+                    App::request_redraw();
+                    if (!hit->stale)
+                        return;
+                    entry.revalidating = true;
+                } else if (IconCache::is_failing(location)) {
+                    // Note: don't log it, it failed before and was already reported.
+                    entry.state = LoadState::error;
+                    return;
+                }
+
                 auto& easy = entry.easy.emplace();
                 easy.set_verbose(false);
                 easy.set_http_version(curl::easy::http_version::none);
@@ -256,6 +827,14 @@ namespace IconManager {
                 easy.set_buffer_size(65536);
                 easy.set_tcp_no_delay(false);
                 easy.set_http_headers({ "Accept: image/*" });
+                if (hit) {
+                    if (!hit->valid.etag.empty())
+                        easy.append_http_header("If-None-Match: " + hit->valid.etag);
+                    if (!hit->valid.last_modified.empty())
+                        easy.append_http_header("If-Modified-Since: "
+                                                + hit->valid.last_modified);
+                }
+                curl_share::attach(easy);
                 easy.set_write_function([&entry](std::span<const char> buf) -> std::size_t
                 {
                     auto content_type_header = entry.easy->try_get_header("Content-Type");
@@ -264,12 +843,18 @@ namespace IconManager {
                         if (!ct.starts_with("image/")) {
                             cout << "ERROR: Content-Type should be \"image/*\" but got \""
                                  << ct << "\"" << endl;
-                            return CURL_READFUNC_ABORT;
+                            // Note: anything short of buf.size() aborts the transfer.
+                            return 0;
                         }
                     }
 
                     if (!entry.raw_buf)
                         entry.raw_buf.emplace();
+                    if (entry.raw_buf->size() + buf.size() > max_download_size) {
+                        cout << "ERROR: icon is bigger than " << max_download_size
+                             << " bytes" << endl;
+                        return 0;
+                    }
 #ifdef __cpp_lib_containers_ranges
                     entry.raw_buf->append_range(buf);
 #else
@@ -280,11 +865,19 @@ namespace IconManager {
                     return buf.size();
                 });
                 multi->add(easy);
+                auto cache = safe_cache.lock();
+                downloads[&easy] = &entry;
+                active_urls.insert(IconCache::canonical_url(location));
             } else if (location.starts_with("ui/")) {
                 // local path
                 // cout << "Loading local image from " << location << endl;
-                entry.img = sdl::img::load(content_prefix / location);
+                auto img = sdl::img::load(content_prefix / location);
+                auto cache = safe_cache.lock();
+                entry.img = std::move(img);
+                entry.premultiplied = false;
+                account(entry, 0);
                 entry.state = LoadState::loaded;
+                App::request_redraw();
                 // cout << "Created local image in format: "
                 //      << entry.img.get_format_enum()
                 //      << endl;
@@ -301,189 +894,211 @@ namespace IconManager {
     }
 
 
-    // Pushes the max element downwards to its correct heap location.
-    template<std::ranges::random_access_range R,
-             typename Comp = std::ranges::less,
-             class Proj = std::identity>
-    requires std::sortable<std::ranges::iterator_t<R>, Comp, Proj>
     void
-    sift_down_heap(R&& r,
-                   Comp comp = {},
-                   Proj proj = {})
+    trim_cache()
     {
-        if (std::empty(r))
-            return;
-        const auto size = std::size(r);
-        std::ranges::range_size_t<R> cur_idx = 0;
-        for (;;) {
-            auto left_idx = 2u * cur_idx + 1u;
-            // If reached bottom of heap, we can stop.
-            if (left_idx >= size)
-                break;
-            // Select the largest child to be the next.
-            auto next_idx = left_idx;
-            auto right_idx = 2u * cur_idx + 2u;
-            if (right_idx < size
-                && std::invoke(comp,
-                               std::invoke(proj, r[left_idx]),
-                               std::invoke(proj, r[right_idx])))
-                next_idx = right_idx;
-            // If max-heap property was restored, we can stop.
-            if (!std::invoke(comp,
-                             std::invoke(proj, r[cur_idx]),
-                             std::invoke(proj, r[next_idx])))
+        auto cache = safe_cache.lock();
+        const std::size_t max_surface = surface_budget.load(std::memory_order_relaxed);
+        const std::size_t max_texture = texture_budget.load(std::memory_order_relaxed);
+        const auto now = std::chrono::steady_clock::now();
+        while (lru_tail
+               && (surface_bytes > max_surface
+                   || texture_bytes > max_texture
+                   || cache->size() > max_cache_size)) {
+            // Note: don't evict what's on screen, it would be loaded again right away.
+            if (now - lru_tail->last_use < min_icon_lifetime)
                 break;
-            std::swap(r[cur_idx], r[next_idx]);
-            cur_idx = next_idx;
+            // cout << "IconManager: prunning " << lru_tail->location << endl;
+            erase_entry(*cache, cache->find(lru_tail->location));
         }
     }
 
 
-    std::uint64_t&
-    by_last_use(cache_t::iterator it)
-        noexcept
+    // Decode an image, and shrink it so it's never bigger than 256x256.
+    sdl::surface
+    make_thumbnail(std::vector<char>& raw)
     {
-        return it->second.last_use;
-    }
-
-
-    void
-    trim_cache()
-    {
-        auto cache = safe_cache.lock();
-        if (cache->size() <= max_cache_size)
-            return;
-
-        std::size_t excess = cache->size() - max_cache_size;
-        // cout << "IconManager: prunning " << excess << " icons" << endl;
-        std::vector<cache_t::iterator> to_remove(excess);
-        auto to_remove_end = to_remove.begin();
-        for (auto it = cache->begin(); it != cache->end(); ++it) {
-            if (to_remove_end != to_remove.end()) {
-                *to_remove_end++ = it;
-                std::ranges::push_heap(to_remove.begin(),
-                                       to_remove_end,
-                                       {},
-                                       by_last_use);
-            } else {
-                /*
-                 * Heap is already full:
-                 * If new element is older than the max element on the heap,
-                 * just replace the max element, and update the heap.
-                 */
-                if (by_last_use(it) < by_last_use(to_remove.front())) {
-                    to_remove.front() = it;
-                    sift_down_heap(to_remove, {}, by_last_use);
-                }
-            }
-        }
-        // Now to_remove contains the "excess" elements that must be purged.
-        for (auto it : to_remove) {
-            auto& info = it->second;
-            if (info.easy) {
-                // If removing an active request, make sure it's removed from the curl::multi.
-                // cout << "IconManager: prunning an active request" << endl;
-                multi->remove(*info.easy);
-            }
-            // unordered_map guarantees all other iterators remain valid
-            cache->erase(it);
-        }
+        const int max_size = 256; // TODO: make it customizable per icon
+        return thumbnail::make(raw, max_size);
     }
 
 
     void
     handle_finished_downloads()
     {
+        std::vector<DecodeJob> jobs;
         for (auto [ez, error_code] : multi->get_done()) {
             auto cache = safe_cache.lock();
-            auto* entry = find(cache, ez);
-            if (!entry) {
+            auto dl = downloads.find(ez);
+            if (dl == downloads.end()) {
                 cout << "ERROR: IconManager::handle_finished_downloads(): failed to find entry for "
                      << ez << endl;
                 continue;
             }
+            CacheEntry* entry = dl->second;
+            downloads.erase(dl);
+
+            curl_share::record(*entry->easy);
 
             try {
                 if (error_code)
                     throw curl::error{error_code};
 
-                if (!entry->raw_buf)
-                    throw std::runtime_error{"empty download"};
-
-                // cout << "Loading image from " << entry->location << endl;
-                sdl::rwops rw{std::span(*entry->raw_buf)};
-                auto img = sdl::img::load(rw);
-                const int max_size = 256; // TODO: make it customizable per icon
-                const sdl::vec2 old_size = img.get_size();
-                if (old_size.x > max_size || old_size.y > max_size) {
-                    sdl::vec2 new_size;
-                    if (old_size.x > old_size.y) {
-                        new_size.x = max_size;
-                        new_size.y = std::max(1, max_size * old_size.y / old_size.x);
-                    } else {
-                        new_size.y = max_size;
-                        new_size.x = std::max(1, max_size * old_size.x / old_size.y);
-                    }
-                    entry->img.create(new_size, 32, img.get_format_enum());
-                    // cout << "Created shrunk image in format: "
-                    //      << entry->img.get_format_enum()
-                    //      << endl;
-                    sdl::blit_scaled(img, nullptr, entry->img, nullptr);
+                long code = 0;
+                curl_easy_getinfo(entry->easy->data(), CURLINFO_RESPONSE_CODE, &code);
+                if (entry->revalidating && code == 304) {
+                    IconCache::refresh(entry->location);
+                    active_urls.erase(IconCache::canonical_url(entry->location));
                 } else {
-                    entry->img = std::move(img);
-                    // cout << "Created image in format: "
-                    //      << entry->img.get_format_enum()
-                    //      << endl;
+                    if (!entry->raw_buf)
+                        throw std::runtime_error{"empty download"};
+
+                    DecodeJob job;
+                    job.location = entry->location;
+                    job.raw = std::move(*entry->raw_buf);
+                    if (auto h = entry->easy->try_get_header("ETag"))
+                        job.valid.etag = h->value;
+                    if (auto h = entry->easy->try_get_header("Last-Modified"))
+                        job.valid.last_modified = h->value;
+                    char* final_url = nullptr;
+                    curl_easy_getinfo(entry->easy->data(), CURLINFO_EFFECTIVE_URL, &final_url);
+                    if (final_url && job.location != final_url)
+                        job.final_location = final_url;
+                    job.revalidating = entry->revalidating;
+                    // Note: active_urls keeps this URL until decode_one() is done with it.
+                    jobs.push_back(std::move(job));
                 }
-                entry->state = LoadState::loaded;
                 entry->raw_buf.reset();
             }
             catch (std::exception& e) {
                 cout << "ERROR: IconManager::handle_finished_downloads(): " << e.what() << endl;
-                entry->state = LoadState::error;
+                active_urls.erase(IconCache::canonical_url(entry->location));
+                // Note: a failed revalidation still leaves the cached image.
+                if (!entry->revalidating) {
+                    entry->state = LoadState::error;
+                    IconCache::record_failure(entry->location);
+                }
             }
+            entry->revalidating = false;
 
             multi->remove(*entry->easy);
             entry->easy.reset();
             entry->raw_buf.reset();
         }
+
+        // Note: pushed without holding the cache lock, since decode_one() needs it.
+        for (auto& job : jobs)
+            decode_queue.push(std::move(job));
     }
 
 
     void
     worker_func(std::stop_token token)
     {
+        tracer::set_thread_name("icon network");
+        thread_policy::apply(thread_policy::role::network);
         try {
             multi.emplace();
             multi->set_max_total_connections(10);
             multi->set_max_connections(10);
+            {
+                std::lock_guard guard{wake_mutex};
+                wake_handle = multi->data();
+            }
 
             while (!token.stop_requested()) {
-#if 1
-                auto location = requests_queue.try_pop_for(50ms);
-#else
-                auto location = requests_queue.try_pop();
-#endif
-                if (location) {
-                    process_one_request(*location);
-                } else if (location.error() == async_queue_error::stop) {
+                // Note: drain the whole queue before polling.
+                requests_queue.pop_all(pending_requests);
+                if (requests_queue.is_stopping())
                     break;
-                } else if (location.error() == async_queue_error::locked) {
-                    cout << "WARNING: requests_queue was locked" << endl;
-                }
+
+                start_pending_requests();
                 multi->perform();
                 handle_finished_downloads();
+                cancel_stale_downloads();
                 trim_cache();
-                std::this_thread::sleep_for(50ms);
+
+                // Block until a transfer makes progress, or wake_worker() is called.
+                curl_multi_poll(multi->data(), nullptr, 0, idle_poll_ms, nullptr);
             }
         }
         catch (std::exception& e) {
             cout << "ERROR: IconManager::worker_func(): " << e.what() << endl;
         }
+        {
+            std::lock_guard guard{wake_mutex};
+            wake_handle = nullptr;
+        }
         multi.reset();
     }
 
 
+    void
+    decode_one(DecodeJob& job)
+    {
+        TRACE_FUNC;
+
+        std::optional<sdl::surface> img;
+        try {
+            img = make_thumbnail(job.raw);
+            IconCache::store(job.location, *img, job.valid, job.final_location);
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: IconManager::decode_one(): \"" << job.location << "\": "
+                 << e.what() << endl;
+            if (!job.revalidating)
+                IconCache::record_failure(job.location);
+        }
+
+        auto cache = safe_cache.lock();
+        active_urls.erase(IconCache::canonical_url(job.location));
+
+        /*
+         * Note: when revalidating, the texture may already exist, and only the main
+         * thread can replace it; the new icon shows up next time it's loaded.
+         */
+        if (job.revalidating)
+            return;
+
+        auto it = cache->find(job.location);
+        // Note: it may have been evicted, or evicted and requested again, meanwhile.
+        if (it == cache->end())
+            return;
+        auto& entry = it->second;
+        if (entry.state != LoadState::loading || entry.easy)
+            return;
+        if (img) {
+            entry.img = std::move(*img);
+            account(entry, 0);
+            entry.state = LoadState::loaded;
+        } else
+            entry.state = LoadState::error;
+        App::request_redraw();
+    }
+
+
+    void
+    decode_func(std::stop_token token)
+    {
+        tracer::set_thread_name("icon decoder");
+        thread_policy::apply(thread_policy::role::background);
+        while (!token.stop_requested()) {
+            try {
+                auto job = decode_queue.pop();
+                decode_one(job);
+                // Let the requests waiting for the same URL go.
+                wake_worker();
+            }
+            catch (async_queue_error) {
+                break;
+            }
+            catch (std::exception& e) {
+                cout << "ERROR: IconManager::decode_func(): " << e.what() << endl;
+            }
+        }
+    }
+
+
     std::string
     to_string(LoadState st)
     {
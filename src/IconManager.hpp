@@ -12,9 +12,18 @@
 
 #include <sdl2xx/renderer.hpp>
 #include <sdl2xx/texture.hpp>
+#include <sdl2xx/vec2.hpp>
 
 namespace IconManager {
 
+    // A texture, or part of one.
+    struct icon {
+        const sdl::texture* texture = nullptr;
+        sdl::vec2 size;
+        sdl::vec2f uv0 = {0, 0};
+        sdl::vec2f uv1 = {1, 1};
+    };
+
     void
     initialize(sdl::renderer& rend);
 
@@ -22,9 +31,22 @@ namespace IconManager {
     finalize();
 
 
+    // Downloaded icons are packed into shared atlas textures; draw them with uv0 and uv1.
+    icon
+    get_icon(const std::string& location);
+
+
+    // Only for images that have their own texture, like the local "ui/" ones.
     const sdl::texture*
     get(const std::string& location);
 
+
+    // Start loading an icon in the background, so it's ready when it's shown. Urgent
+    // icons are downloaded before the ones being shown.
+    void
+    prefetch(const std::string& location,
+             bool urgent = false);
+
 } // namespace IconManager
 
 #endif
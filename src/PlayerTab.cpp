@@ -8,7 +8,9 @@
 #include <array>
 #include <chrono>
 #include <deque>
+#include <filesystem>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <optional>
 #include <ranges>
@@ -24,21 +26,26 @@
 #include <imgui_raii.h>
 #include <imgui_stdlib.h>
 
-#include <sdl2xx/audio.hpp>
-
 #include "PlayerTab.hpp"
 
 #include "App.hpp"
+#include "audio_output.hpp"
+#include "audio_pipeline.hpp"
 #include "BrowserTab.hpp"
 #include "cfg.hpp"
+#include "FavoritesTab.hpp"
 #include "humanize.hpp"
 #include "IconManager.hpp"
 #include "IconsFontAwesome4.h"
-#include "radio_client.hpp"
+#include "Profiler.hpp"
 #include "RecentTab.hpp"
 #include "Serializer.hpp"
+#include "socket_tuning.hpp"
 #include "Station.hpp"
 #include "StationDetailsPopup.hpp"
+#include "stream_recorder.hpp"
+#include "string_utils.hpp"
+#include "Telemetry.hpp"
 #include "UI.hpp"
 
 
@@ -63,10 +70,27 @@ namespace PlayerTab {
         bool details_expanded{};
         bool history_expanded{};
         std::deque<TrackInfo> history{};
+        // Keyed by stationuuid, in dB.
+        std::map<std::string, float> station_gains{};
     };
 
     State state;
 
+    // The history's relative times, in the same order as state.history.
+    std::vector<std::string> history_labels;
+    // The second history_labels was made for; they're only rebuilt once per second.
+    std::chrono::sys_seconds history_labels_time;
+
+
+    float
+    get_station_gain(const std::string& uuid)
+    {
+        auto it = state.station_gains.find(uuid);
+        if (it == state.station_gains.end())
+            return 0;
+        return it->second;
+    }
+
     std::shared_ptr<Station> station;
 
     void
@@ -75,33 +99,54 @@ namespace PlayerTab {
 
     /*
      * RAII-managed resources are stored here.
-     * Note that they're only allocated while playback is active.
+     * Note that they're only allocated while playback is active, or while a station is
+     * on standby.
      */
     struct Resources {
 
-        radio_client radio;
-        sdl::audio::device audio_dev;
+        const std::string station_uuid;
+        audio_pipeline pipeline;
+        bool apd_disabled = false;
+        unsigned seen_metadata_generation = 0;
+        // Shared with the pipeline, only to show the stats.
+        std::shared_ptr<stream_recorder> recorder;
 
-        Resources(const std::string& url,
-                  const std::string& url_resolved) :
-            radio{url, url_resolved, App::get_user_agent()}
+        Resources(const Station& st) :
+            station_uuid{st.stationuuid},
+            pipeline{st.url, st.url_resolved, App::get_user_agent()}
         {
-            if (cfg::state.disable_apd) {
+            pipeline.set_watermarks(cfg::state.player_low_watermark,
+                                    cfg::state.player_high_watermark);
+            pipeline.set_timeshift(std::chrono::minutes{cfg::state.timeshift_minutes});
+            pipeline.set_gain(get_station_gain(station_uuid),
+                              cfg::state.normalize_loudness);
+        }
+
+
+        ~Resources()
+        {
+            audio_output::release(&pipeline);
 #ifdef __WUT__
-                IMDisableAPD();
-#else
-                // TODO: write similar code for desktop, to prevent computer from
-                // suspending.
+            if (apd_disabled)
+                IMEnableAPD();
 #endif
-            }
         }
 
 
-        ~Resources()
+        // Called when these resources become the active playback.
+        void
+        activate()
         {
+            pipeline.set_standby(false);
+            if (cfg::state.disable_apd && !apd_disabled) {
 #ifdef __WUT__
-            IMEnableAPD();
+                IMDisableAPD();
+#else
+                // TODO: write similar code for desktop, to prevent computer from
+                // suspending.
 #endif
+                apd_disabled = true;
+            }
         }
 
 
@@ -109,59 +154,34 @@ namespace PlayerTab {
         Resources(Resources&&) = delete;
 
 
-        bool
-        is_buffer_too_empty()
-        {
-            // if (cfg::state.player_buffer_size == 0)
-            //     return false;
-
-            // return total_bytes_fed < cfg::state.player_buffer_size * 1024u;
-            return false;
-        }
-
-
         void
         process()
         {
-            try {
-                radio.process();
-                if (auto meta = radio.get_metadata())
-                    if (meta->title) {
-                        if (meta->artist)
-                            history_add(*meta->artist + " - " + *meta->title);
-                        else
-                            history_add(*meta->title);
-                    }
-
-                if (is_buffer_too_empty()) {
-                    // cout << "buffer too empty" << endl;
-                    return;
-                }
-
-                if (!audio_dev) {
-                    // see if we have enough bytes to initialize audio_dev properly.
-                    if (auto radio_spec = radio.get_spec()) {
-                        sdl::audio::spec spec;
-                        spec.freq     = radio_spec->rate;
-                        spec.channels = radio_spec->channels;
-                        spec.format   = radio_spec->format;
-                        spec.samples  = 8192;
-                        audio_dev.create(nullptr, false, spec);
-                        audio_dev.unpause();
-                    } else
-                        return;
-                }
+            PROFILE_SCOPE("PlayerTab::Resources::process");
 
-                if (!audio_dev) {
-                    cout << "no audio dev yet" << endl;
-                    return;
+            try {
+                // Note: decoding happens in the pipeline's thread, and audio_output
+                // pulls samples straight from it.
+                pipeline.set_watermarks(cfg::state.player_low_watermark,
+                                        cfg::state.player_high_watermark);
+                pipeline.set_timeshift(std::chrono::minutes{
+                        cfg::state.timeshift_minutes
+                    });
+                pipeline.set_gain(get_station_gain(station_uuid),
+                                  cfg::state.normalize_loudness);
+
+                // Note: only look at the metadata when it changes.
+                const unsigned generation = pipeline.get_metadata_generation();
+                if (generation != seen_metadata_generation) {
+                    seen_metadata_generation = generation;
+                    if (auto meta = pipeline.get_metadata())
+                        if (meta->title) {
+                            if (meta->artist)
+                                history_add(*meta->artist + " - " + *meta->title);
+                            else
+                                history_add(*meta->title);
+                        }
                 }
-
-                for (auto samples = radio.get_samples();
-                     !samples.empty();
-                     samples = radio.get_samples())
-                    audio_dev.play(samples);
-
             }
             catch (std::exception& e) {
                 cout << "ERROR: Player::Resources::process(): " << e.what() << endl;
@@ -170,7 +190,38 @@ namespace PlayerTab {
 
     }; // struct Resources
 
-    std::optional<Resources> res;
+    std::unique_ptr<Resources> res;
+
+
+    struct Standby {
+        std::shared_ptr<Station> station;
+        std::unique_ptr<Resources> res;
+    };
+
+    // Warm standby: connecting and buffering the stations likely to be played next, in
+    // the order they'll be played. Outside of scan mode, there's at most one.
+    std::deque<Standby> standby;
+
+
+    // Scan mode: each station plays for a while, then the next one, already buffered.
+    struct Scan {
+        std::vector<std::shared_ptr<Station>> stations;
+        std::size_t position = 0; // playing
+        std::size_t prepared = 0; // the last one put on standby
+        bool heard = false;
+        std::chrono::steady_clock::time_point hop_at;
+    };
+
+    std::optional<Scan> scan;
+
+    // How many stations ahead scan mode keeps connected, at most.
+    const std::size_t scan_lookahead = 2;
+
+    // Scan mode doesn't connect to another station while the ones ahead hold this much.
+    const std::size_t scan_memory_budget = 4 * 1024 * 1024;
+
+    // How long past its time a station waits for the next one to be ready.
+    const auto scan_max_wait = 5s;
 
 
     void
@@ -179,6 +230,9 @@ namespace PlayerTab {
     void
     save();
 
+    void
+    cancel_scan();
+
 
     void
     initialize()
@@ -191,7 +245,9 @@ namespace PlayerTab {
     finalize()
     {
         save();
+        scan.reset();
         res.reset();
+        standby.clear();
     }
 
 
@@ -210,42 +266,79 @@ namespace PlayerTab {
     save()
     try {
         auto filename = App::get_config_path() / "player.json";
-        Serializer::save(state, filename);
+        Serializer::save_async(state, filename);
     }
     catch (std::exception& e) {
         cout << "ERROR: Player::save(): " << e.what() << endl;
     }
 
 
+    // Adds the station to the Recent tab, and sends a click for it.
     void
-    play()
+    register_play()
     {
-        if (!station)
-            return;
+        RecentTab::queue_add(station);
+        Telemetry::queue_click(station,
+                               [st=station](bool, const std::string&)
+                               {
+                                   BrowserTab::update_station(st);
+                               });
+    }
 
-        if (res && res->radio.current_state != radio_client::state::stopped)
-            stop();
 
+    // Switches to the station, without registering it; scan mode only registers the
+    // station it stops on.
+    void
+    switch_playback()
+    {
         cout << "Starting playback of station \"" << station->name << "\"" << endl;
-
-        RecentTab::queue_add(station);
-
         cout << "Playing url=\"" << station->url
              << "\", url_resolved=\"" << station->url_resolved
              << "\""
              << endl;
 
-        // TODO: call RadioBrowserAPI directly.
-        BrowserTab::send_click(station);
+        std::unique_ptr<Resources> next;
+        auto it = std::ranges::find_if(standby,
+                                       [](const Standby& s)
+                                       {
+                                           return *s.station == *station;
+                                       });
+        if (it != standby.end()) {
+            cout << "Using standby stream" << endl;
+            next = std::move(it->res);
+            standby.erase(it);
+        } else {
+            // allocate and initialize resources here
+            next = std::make_unique<Resources>(*station);
+        }
+        // Note: switched before the old one is destroyed, so the audio fades from one to
+        // the other.
+        audio_output::set_source(&next->pipeline);
+        res = std::move(next);
+        res->activate();
+
+        // keep the next favorite warm, for quick switching
+        if (!scan)
+            if (auto next = FavoritesTab::get_next(*station))
+                prepare(next);
+    }
+
 
-        // allocate and initialize resources here
-        res.emplace(station->url, station->url_resolved);
+    void
+    play()
+    {
+        if (!station)
+            return;
+
+        register_play();
+        switch_playback();
     }
 
 
     void
     play(std::shared_ptr<Station>& st)
     {
+        cancel_scan();
         station = st;
         play();
     }
@@ -254,15 +347,275 @@ namespace PlayerTab {
     void
     stop()
     {
+        cancel_scan();
         res.reset();
     }
 
 
+    // Until it's played, a standby station only buffers up to the low watermark, keeps no
+    // timeshift, and drops old data to keep its connection flowing.
+    void
+    add_standby(const std::shared_ptr<Station>& st)
+    {
+        cout << "Preparing standby for station \"" << st->name << "\"" << endl;
+        auto& s = standby.emplace_back(st, std::make_unique<Resources>(*st));
+        s.res->pipeline.set_watermarks(cfg::state.player_low_watermark,
+                                       cfg::state.player_low_watermark);
+        s.res->pipeline.set_timeshift(0min);
+        s.res->pipeline.set_standby(true);
+    }
+
+
+    void
+    prepare(std::shared_ptr<Station>& st)
+    {
+        // Note: scan mode decides what's on standby.
+        if (!cfg::state.player_standby || !st || scan)
+            return;
+
+        // don't prepare what's already playing, or already prepared
+        if (res && station && *station == *st)
+            return;
+        if (!standby.empty() && *standby.front().station == *st)
+            return;
+
+        standby.clear();
+        add_standby(st);
+    }
+
+
+    void
+    start_scan(std::vector<std::shared_ptr<Station>> stations)
+    {
+        std::erase(stations, nullptr);
+        if (stations.empty())
+            return;
+
+        cout << "Scanning " << stations.size() << " stations" << endl;
+        cancel_scan();
+        scan.emplace(std::move(stations));
+        scan->hop_at = std::chrono::steady_clock::now()
+            + std::chrono::seconds{cfg::state.scan_seconds};
+        station = scan->stations.front();
+        switch_playback();
+        // Note: whatever was on standby is not in the scan order.
+        standby.clear();
+    }
+
+
+    // Leaves scan mode, without registering anything.
+    void
+    cancel_scan()
+    {
+        if (!scan)
+            return;
+        cout << "Scan stopped" << endl;
+        scan.reset();
+        // Note: don't keep connections that won't be used.
+        standby.clear();
+    }
+
+
+    void
+    stop_scan()
+    {
+        if (!scan)
+            return;
+        cancel_scan();
+        if (res && station)
+            register_play();
+    }
+
+
+    bool
+    is_scanning()
+    {
+        return scan.has_value();
+    }
+
+
+    // Keep the next stations connecting and buffering, within the limits.
+    void
+    fill_scan_standby()
+    {
+        const std::size_t count = scan->stations.size();
+        while (standby.size() < scan_lookahead) {
+            const std::size_t next = (scan->prepared + 1) % count;
+            if (next == scan->position)
+                return;
+
+            std::size_t buffered = 0;
+            for (auto& s : standby)
+                buffered += s.res->pipeline.available() + s.res->pipeline.get_net_buffered();
+            if (buffered >= scan_memory_budget)
+                return;
+
+            add_standby(scan->stations[next]);
+            scan->prepared = next;
+        }
+    }
+
+
+    void
+    process_scan()
+    {
+        if (!scan)
+            return;
+
+        const auto now = std::chrono::steady_clock::now();
+        const auto dwell = std::chrono::seconds{cfg::state.scan_seconds};
+
+        // Note: the time only counts once the station is heard.
+        if (!scan->heard && station && is_streaming(*station)) {
+            scan->heard = true;
+            scan->hop_at = now + dwell;
+        }
+
+        fill_scan_standby();
+
+        const bool failed = !res || res->pipeline.get_state() == radio_client::state::stopped;
+        if (!failed && now < scan->hop_at)
+            return;
+        if (standby.empty())
+            return;
+
+        auto& next = standby.front();
+        const auto next_state = next.res->pipeline.get_state();
+        const bool next_failed = next_state == radio_client::state::stopped;
+        const bool next_ready = next_state == radio_client::state::streaming_audio
+            && next.res->pipeline.get_buffered_ms() >= cfg::state.player_low_watermark;
+        if (!next_ready) {
+            // Note: skip stations that fail, or take too long, or the scan would get
+            // stuck; but not just because the current one failed, that would drop every
+            // station before it has time to connect.
+            if (next_failed || now >= scan->hop_at + scan_max_wait) {
+                cout << "Scan: skipping \"" << next.station->name << "\"" << endl;
+                standby.pop_front();
+            }
+            return;
+        }
+
+        auto it = std::ranges::find(scan->stations, next.station);
+        scan->position = it - scan->stations.begin();
+        scan->heard = false;
+        scan->hop_at = now + dwell;
+        station = next.station;
+        switch_playback();
+    }
+
+
     void
     process_logic()
     {
+        PROFILE_SCOPE("PlayerTab::process_logic");
+
+        process_scan();
         if (res)
             res->process();
+        audio_output::process();
+    }
+
+
+    void
+    start_recording()
+    {
+        std::filesystem::path dir = cfg::state.recording_dir;
+        if (dir.empty())
+            dir = App::get_config_path() / "recordings";
+        cout << "Recording \"" << station->name << "\" to " << dir << endl;
+        res->recorder = std::make_shared<stream_recorder>(dir, station->name);
+        res->pipeline.set_recorder(res->recorder);
+    }
+
+
+    void
+    stop_recording()
+    {
+        res->pipeline.set_recorder(nullptr);
+        res->recorder.reset();
+    }
+
+
+    void
+    show_record_button()
+    {
+        if (res->recorder) {
+            // ⏹
+            if (ImGui::Button(ICON_FA_STOP " Rec"))
+                stop_recording();
+            ImGui::SetItemTooltip("Stop recording.");
+        } else {
+            // ⏺
+            if (ImGui::Button(ICON_FA_CIRCLE " Rec"))
+                start_recording();
+            ImGui::SetItemTooltip("Record the stream, one file per track.");
+        }
+    }
+
+
+    void
+    show_timeshift_controls()
+    {
+        auto& pipeline = res->pipeline;
+
+        // ⏪
+        if (ImGui::Button(ICON_FA_BACKWARD))
+            pipeline.seek(-30s);
+        ImGui::SetItemTooltip("Rewind 30 seconds.");
+
+        ImGui::SameLine();
+
+        if (pipeline.is_paused()) {
+            // ▶
+            if (ImGui::Button(ICON_FA_PLAY))
+                pipeline.set_paused(false);
+            ImGui::SetItemTooltip("Resume; the stream was kept while paused.");
+        } else {
+            // ⏸
+            if (ImGui::Button(ICON_FA_PAUSE))
+                pipeline.set_paused(true);
+            ImGui::SetItemTooltip("Pause; the stream keeps being received.");
+        }
+
+        ImGui::SameLine();
+
+        {
+            ImGui::RAII::Disabled disable_live{pipeline.get_timeshift_delay() == 0};
+
+            // ⏩
+            if (ImGui::Button(ICON_FA_FORWARD))
+                pipeline.seek(30s);
+            ImGui::SetItemTooltip("Skip 30 seconds ahead.");
+
+            ImGui::SameLine();
+
+            // ⏭
+            if (ImGui::Button(ICON_FA_STEP_FORWARD " Live"))
+                pipeline.go_live();
+            ImGui::SetItemTooltip("Catch up with the live stream.");
+        }
+    }
+
+
+    void
+    show_scan_controls()
+    {
+        // ⏭
+        if (ImGui::Button(ICON_FA_STEP_FORWARD))
+            scan->hop_at = std::chrono::steady_clock::now();
+        ImGui::SetItemTooltip("Skip to the next station now.");
+
+        ImGui::SameLine();
+
+        // ⏹
+        if (ImGui::Button(ICON_FA_STOP " Scan"))
+            stop_scan();
+        ImGui::SetItemTooltip("Stop scanning, and keep playing this station.");
+
+        ImGui::SameLine();
+
+        ImGui::AlignTextToFramePadding();
+        ImGui::Text("%zu of %zu", scan->position + 1, scan->stations.size());
     }
 
 
@@ -310,6 +663,17 @@ namespace PlayerTab {
                 if (StationDetailsPopup::show_button(station->stationuuid))
                     StationDetailsPopup::open(station->stationuuid);
 
+                if (res && is_playing(station)) {
+                    if (res->pipeline.is_timeshift_enabled()) {
+                        show_timeshift_controls();
+                        ImGui::SameLine();
+                    }
+                    show_record_button();
+                }
+
+                if (scan)
+                    show_scan_controls();
+
             } // actions_child
 
             ImGui::SameLine();
@@ -334,6 +698,44 @@ namespace PlayerTab {
     }
 
 
+    void
+    show_visualizer()
+    {
+        if (!cfg::state.show_visualizer)
+            return;
+        auto spectrum = get_spectrum();
+        if (!spectrum)
+            return;
+        UI::show_spectrum(*spectrum, 120);
+        App::request_animation();
+    }
+
+
+    void
+    show_gain_row()
+    {
+        ImGui::TableNextRow();
+
+        ImGui::TableNextColumn();
+        ImGui::AlignTextToFramePadding();
+        UI::show_label("Gain");
+        ImGui::SetItemTooltip("Volume adjustment for this station.");
+
+        ImGui::TableNextColumn();
+        float gain = get_station_gain(res->station_uuid);
+        ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x * 0.5f);
+        if (ImGui::SliderFloat("##gain", &gain, -12.0f, 12.0f, "%+.1f dB")) {
+            if (gain == 0)
+                state.station_gains.erase(res->station_uuid);
+            else
+                state.station_gains[res->station_uuid] = gain;
+        }
+        ImGui::SameLine();
+        ImGui::AlignTextToFramePadding();
+        ImGui::Text("applied: %+.1f dB", res->pipeline.get_applied_gain_db());
+    }
+
+
     void
     show_stream()
     {
@@ -357,7 +759,7 @@ namespace PlayerTab {
                     ImGui::TableSetupColumn("label", ImGuiTableColumnFlags_WidthFixed);
                     ImGui::TableSetupColumn("value", ImGuiTableColumnFlags_WidthStretch);
 
-                    if (const auto meta = res->radio.get_metadata()) {
+                    if (const auto meta = res->pipeline.get_metadata()) {
                         if (meta->title)
                             UI::show_info_row("Title", *meta->title);
                         if (meta->artist)
@@ -367,12 +769,12 @@ namespace PlayerTab {
                         if (meta->genre)
                             UI::show_info_row("Genre", *meta->genre);
                         if (meta->cover_art && !meta->cover_art->empty()) {
-                            auto art = IconManager::get(*meta->cover_art);
+                            auto art = IconManager::get_icon(*meta->cover_art);
                             ImGui::TableNextRow();
                             ImGui::TableNextColumn();
                             UI::show_label("Cover art");
                             ImGui::TableNextColumn();
-                            UI::show_image(*art);
+                            UI::show_image(*art.texture, art.size, art.uv0, art.uv1);
                             ImGui::SetItemTooltip("%s", meta->cover_art->data());
                         }
                         for (auto& [k, v] : meta->extra)
@@ -388,13 +790,69 @@ namespace PlayerTab {
                             UI::show_link_row("URL", *meta->station_url);
                     }
 
-                    if (const auto info = res->radio.get_decoder_info()) {
+                    if (const auto info = res->pipeline.get_decoder_info()) {
                         if (!info->codec.empty())
                             UI::show_info_row("Codec", info->codec);
                         if (!info->bitrate.empty())
                             UI::show_info_row("Bitrate", info->bitrate);
                     }
 
+                    // buffer stats
+                    UI::show_info_row("Buffer",
+                                      string_utils::cpp_sprintf("%u / %u ms%s",
+                                                                res->pipeline.get_buffered_ms(),
+                                                                res->pipeline.get_target_ms(),
+                                                                res->pipeline.is_buffering()
+                                                                ? " (buffering)" : ""));
+                    UI::show_info_row("Underruns", res->pipeline.get_underruns());
+                    show_gain_row();
+                    if (res->pipeline.is_timeshift_enabled()) {
+                        using std::chrono::seconds;
+                        const seconds delay{res->pipeline.get_timeshift_delay()};
+                        const seconds length{res->pipeline.get_timeshift_length()};
+                        const bool paused = res->pipeline.is_paused();
+                        UI::show_info_row("Timeshift",
+                                          humanize::duration_brief(delay)
+                                          + " behind live, "
+                                          + humanize::duration_brief(length)
+                                          + " kept"
+                                          + (paused ? " (paused)" : ""));
+                    }
+                    if (res->recorder) {
+                        const auto rs = res->recorder->get_stats();
+                        std::string text = std::to_string(rs.files) + " files, "
+                            + humanize::value(rs.written) + "B written";
+                        if (rs.dropped)
+                            text += ", " + humanize::value(rs.dropped) + "B dropped";
+                        if (rs.errors)
+                            text += ", " + std::to_string(rs.errors) + " errors";
+                        UI::show_info_row("Recording", text);
+                    }
+                    if (socket_tuning::is_enabled()) {
+                        const auto ts = socket_tuning::get_stats();
+                        UI::show_info_row("Socket tuning",
+                                          string_utils::cpp_sprintf("%u connections (%u partial)",
+                                                                    ts.applied,
+                                                                    ts.failed));
+                    } else
+                        UI::show_info_row("Socket tuning", "off"s);
+                    UI::show_info_row("Network buffer",
+                                      string_utils::cpp_sprintf("%zu KiB%s",
+                                                                res->pipeline.get_net_buffered() / 1024,
+                                                                res->pipeline.is_net_paused()
+                                                                ? " (paused)" : ""));
+                    auto rs = res->pipeline.get_reconnect_stats();
+                    if (rs.count || rs.failures) {
+                        using std::chrono::duration_cast;
+                        using std::chrono::milliseconds;
+                        long long last_ms = duration_cast<milliseconds>(rs.last_duration).count();
+                        UI::show_info_row("Reconnects",
+                                          string_utils::cpp_sprintf("%u (%u failed), last took %lld ms",
+                                                                    rs.count,
+                                                                    rs.failures,
+                                                                    last_ms));
+                    }
+
                 }
 
             }
@@ -404,10 +862,29 @@ namespace PlayerTab {
     }
 
 
+    void
+    update_history_labels()
+    {
+        const auto now = std::chrono::floor<std::chrono::seconds>(system_clock::now());
+        if (now == history_labels_time && history_labels.size() == state.history.size())
+            return;
+        history_labels_time = now;
+
+        history_labels.clear();
+        for (const auto& [when, title] : state.history) {
+            auto t = duration_cast<std::chrono::seconds>(now - when);
+#if 0
+            history_labels.push_back(humanize::duration(t) + " ago");
+#else
+            history_labels.push_back(humanize::duration_brief(t));
+#endif
+        }
+    }
+
+
     void
     show_history()
     {
-        auto now = system_clock::now();
 
         if (ImGui::RAII::Child history_child{
                 "history",
@@ -429,17 +906,10 @@ namespace PlayerTab {
                     ImGui::TableSetupColumn("Field", ImGuiTableColumnFlags_WidthFixed);
                     ImGui::TableSetupColumn("Value", ImGuiTableColumnFlags_WidthStretch);
 
-                    for (const auto& [when, title] : state.history | std::views::reverse) {
+                    update_history_labels();
 
-                        auto t = duration_cast<std::chrono::seconds>(now - when);
-#if 0
-                        std::string label = humanize::duration(t) + " ago";
-#else
-                        std::string label = humanize::duration_brief(t);
-#endif
-                        UI::show_info_row(label, title);
-
-                    }
+                    for (std::size_t i = state.history.size(); i-- > 0;)
+                        UI::show_info_row(history_labels[i], state.history[i].title);
 
                 } // table
 
@@ -452,6 +922,8 @@ namespace PlayerTab {
     void
     process_ui()
     {
+        PROFILE_SCOPE("PlayerTab::process_ui");
+
         if (ImGui::RAII::Child player_child{
                 "player",
                 {0, 0},
@@ -459,6 +931,7 @@ namespace PlayerTab {
             }) {
 
             show_station();
+            show_visualizer();
             show_stream();
             show_history();
 
@@ -475,7 +948,7 @@ namespace PlayerTab {
             return false;
         if (!station)
             return false;
-        if (res->radio.current_state == radio_client::state::stopped)
+        if (res->pipeline.get_state() == radio_client::state::stopped)
             return false;
         return st == *station;
     }
@@ -490,6 +963,35 @@ namespace PlayerTab {
     }
 
 
+    bool
+    is_streaming(const Station& st)
+    {
+        if (!is_playing(st))
+            return false;
+        return res->pipeline.get_state() == radio_client::state::streaming_audio;
+    }
+
+
+    bool
+    is_starting()
+    {
+        if (!res || !station)
+            return false;
+        const auto st = res->pipeline.get_state();
+        return st != radio_client::state::stopped
+            && st != radio_client::state::streaming_audio;
+    }
+
+
+    std::optional<spectrum_analyzer::result>
+    get_spectrum()
+    {
+        if (!station || !is_streaming(*station))
+            return {};
+        return res->pipeline.get_spectrum();
+    }
+
+
     void
     history_add(const std::string& title)
     {
@@ -497,6 +999,7 @@ namespace PlayerTab {
             return;
 
         state.history.emplace_back(system_clock::now(), title);
+        history_labels.clear();
 
         if (state.history.size() > cfg::state.player_history_limit)
             state.history.erase(state.history.begin(),
@@ -9,7 +9,11 @@
 #define PLAYER_TAB_HPP
 
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
+
+#include "spectrum_analyzer.hpp"
 
 
 struct Station;
@@ -43,12 +47,45 @@ namespace PlayerTab {
     stop();
 
 
+    // Start connecting and buffering a station, so play() can switch to it quickly.
+    void
+    prepare(std::shared_ptr<Station>& st);
+
+
+    // Play each station for a while, in order, wrapping around; the next ones are
+    // connected in advance, so there's no gap between them. Playing or stopping a
+    // station stops the scan. Stations are not added to Recent, nor clicked, while
+    // they're scanned.
+    void
+    start_scan(std::vector<std::shared_ptr<Station>> stations);
+
+    // Keeps playing the current station, and registers it as played.
+    void
+    stop_scan();
+
+    bool
+    is_scanning();
+
+
     bool
     is_playing(const Station& st);
 
     bool
     is_playing(std::shared_ptr<Station>& st);
 
+    // Like is_playing(), but only once audio is arriving.
+    bool
+    is_streaming(const Station& st);
+
+    // True while the current station is connecting, before its audio arrives.
+    bool
+    is_starting();
+
+
+    // Empty when nothing is streaming.
+    std::optional<spectrum_analyzer::result>
+    get_spectrum();
+
 } // namespace PlayerTab
 
 #endif
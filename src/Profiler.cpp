@@ -0,0 +1,218 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // max(), nth_element()
+#include <array>
+#include <cstdio>               // snprintf()
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <imgui.h>
+#include <imgui_raii.h>
+
+#include "Profiler.hpp"
+
+
+using std::cout;
+using std::endl;
+
+
+namespace Profiler {
+
+    namespace {
+
+        // How many frames the statistics cover.
+        constexpr std::size_t window_frames = 120;
+
+    } // namespace
+
+
+    struct Section {
+
+        std::string name;
+        clock::duration current{};
+        unsigned current_calls = 0;
+
+        // Ring buffer of per-frame totals, in microseconds.
+        std::array<float, window_frames> samples{};
+        std::array<unsigned, window_frames> calls{};
+        std::size_t num_samples = 0;
+        std::size_t next_sample = 0;
+
+    }; // struct Section
+
+
+    namespace {
+
+        // Note: std::deque never moves its elements, the references stay valid.
+        std::deque<Section> sections;
+
+        const clock::time_point no_frame{};
+        clock::time_point frame_start = no_frame;
+        Section* frame_section = nullptr;
+
+
+        struct Stats {
+            float avg = 0;
+            float p95 = 0;
+            float max = 0;
+            float calls = 0;
+        };
+
+
+        Stats
+        get_stats(const Section& sec)
+        {
+            Stats result;
+            if (!sec.num_samples)
+                return result;
+
+            std::vector<float> values(sec.samples.begin(),
+                                      sec.samples.begin() + sec.num_samples);
+            unsigned total_calls = 0;
+            for (std::size_t i = 0; i < sec.num_samples; ++i) {
+                result.avg += values[i];
+                result.max = std::max(result.max, values[i]);
+                total_calls += sec.calls[i];
+            }
+            result.avg /= sec.num_samples;
+            result.calls = float(total_calls) / sec.num_samples;
+
+            auto p95 = values.begin() + (values.size() * 95) / 100;
+            if (p95 == values.end())
+                --p95;
+            std::ranges::nth_element(values, p95);
+            result.p95 = *p95;
+            return result;
+        }
+
+
+        void
+        close_sample(Section& sec)
+            noexcept
+        {
+            using us = std::chrono::duration<float, std::micro>;
+            sec.samples[sec.next_sample] = us{sec.current}.count();
+            sec.calls[sec.next_sample] = sec.current_calls;
+            sec.next_sample = (sec.next_sample + 1) % window_frames;
+            if (sec.num_samples < window_frames)
+                ++sec.num_samples;
+            sec.current = {};
+            sec.current_calls = 0;
+        }
+
+    } // namespace
+
+
+    Section&
+    get_section(const char* name)
+    {
+        for (auto& sec : sections)
+            if (sec.name == name)
+                return sec;
+        auto& sec = sections.emplace_back();
+        sec.name = name;
+        return sec;
+    }
+
+
+    Scope::Scope(Section& section)
+        noexcept :
+        section{section},
+        start{clock::now()}
+    {}
+
+
+    Scope::~Scope()
+        noexcept
+    {
+        section.current += clock::now() - start;
+        ++section.current_calls;
+    }
+
+
+    void
+    end_frame()
+    {
+        const auto now = clock::now();
+        if (!frame_section)
+            frame_section = &get_section("frame interval");
+        if (frame_start != no_frame) {
+            frame_section->current = now - frame_start;
+            frame_section->current_calls = 1;
+        }
+        frame_start = now;
+
+        for (auto& sec : sections)
+            close_sample(sec);
+    }
+
+
+    void
+    show_overlay()
+    {
+        ImGui::SetNextWindowBgAlpha(0.75f);
+        if (ImGui::RAII::Window win{"Profiler",
+                                    nullptr,
+                                    ImGuiWindowFlags_AlwaysAutoResize |
+                                    ImGuiWindowFlags_NoFocusOnAppearing |
+                                    ImGuiWindowFlags_NoNav}) {
+
+            if (ImGui::RAII::Table table{"sections", 5,
+                                         ImGuiTableFlags_RowBg |
+                                         ImGuiTableFlags_SizingFixedFit}) {
+                ImGui::TableSetupColumn("Section");
+                ImGui::TableSetupColumn("Calls");
+                ImGui::TableSetupColumn("Avg (ms)");
+                ImGui::TableSetupColumn("P95 (ms)");
+                ImGui::TableSetupColumn("Max (ms)");
+                ImGui::TableHeadersRow();
+
+                for (auto& sec : sections) {
+                    const auto stats = get_stats(sec);
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(sec.name.data());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.1f", stats.calls);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.2f", stats.avg / 1000);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.2f", stats.p95 / 1000);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.2f", stats.max / 1000);
+                }
+            }
+
+            if (ImGui::Button("Log"))
+                dump();
+        }
+    }
+
+
+    void
+    dump()
+    {
+        cout << "Profiler: last " << window_frames << " frames (avg / p95 / max ms, calls):"
+             << endl;
+        for (auto& sec : sections) {
+            const auto stats = get_stats(sec);
+            char buf[160];
+            std::snprintf(buf, sizeof buf,
+                          "  %-32s %8.2f %8.2f %8.2f  %6.1f",
+                          sec.name.data(),
+                          stats.avg / 1000,
+                          stats.p95 / 1000,
+                          stats.max / 1000,
+                          stats.calls);
+            cout << buf << endl;
+        }
+    }
+
+} // namespace Profiler
@@ -0,0 +1,71 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <chrono>
+
+
+/*
+ * Frame-time profiler.
+ *
+ * Scoped timers add up the time spent in each section during a frame; end_frame() closes
+ * the frame, and keeps the totals of the last frames, for rolling statistics.
+ *
+ * Only for the main thread.
+ */
+namespace Profiler {
+
+    using clock = std::chrono::steady_clock;
+
+    struct Section;
+
+
+    Section&
+    get_section(const char* name);
+
+
+    struct Scope {
+
+        Section& section;
+        const clock::time_point start;
+
+        Scope(Section& section)
+            noexcept;
+
+        ~Scope()
+            noexcept;
+
+    }; // struct Scope
+
+
+    void
+    end_frame();
+
+
+    void
+    show_overlay();
+
+
+    // Write the statistics to the log.
+    void
+    dump();
+
+} // namespace Profiler
+
+
+#define PROFILE_MERGE(a, b) a##b
+
+#define PROFILE_SCOPE_IMPL(name, n)                                     \
+    static Profiler::Section& PROFILE_MERGE(profile_section_, n) =      \
+        Profiler::get_section(name);                                    \
+    Profiler::Scope PROFILE_MERGE(profile_scope_, n){PROFILE_MERGE(profile_section_, n)}
+
+#define PROFILE_SCOPE(name) PROFILE_SCOPE_IMPL(name, __COUNTER__)
+
+#endif
@@ -1,14 +1,20 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdlib>
-#include <deque>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <ranges>
 #include <stdexcept>
-#include <thread>
 #include <unordered_set>
-#include <future>
+#include <utility>              // exchange()
 #include <stop_token>
 
 #ifdef __WIIU__
@@ -22,9 +28,15 @@
 
 #include "RadioBrowserAPI.hpp"
 
+#include "json_array_splitter.hpp"
 #include "net/address.hpp"
 #include "net/resolver.hpp"
+#include "Profiler.hpp"
+#include "read_mostly.hpp"
 #include "rest.hpp"
+#include "scheduler.hpp"
+#include "Serializer.hpp"
+#include "string_utils.hpp"
 #include "thread_safe.hpp"
 #include "tracer.hpp"
 
@@ -111,6 +123,33 @@ struct glz::meta<RadioBrowserAPI::TagParams::Order> {
 
 namespace RadioBrowserAPI {
 
+    struct Query {
+        string endpoint;
+        string body;
+        rest::json_success_function_t success_func;
+        error_function_t error_func;
+        // Gets the partial response, and which attempt it's from; the last call has
+        // the whole response.
+        std::move_only_function<void (std::string_view partial,
+                                      unsigned attempt)> progress_func;
+        unsigned retries = 0;
+        rest::priority prio = rest::priority::interactive;
+        rest::token token;
+        bool canceled = false;
+
+        // Once the query is done, drop what the callbacks hold.
+        void
+        release()
+            noexcept
+        {
+            token.detach();
+            success_func = {};
+            error_func = {};
+            progress_func = {};
+        }
+    };
+
+
     namespace {
 
         enum class State {
@@ -139,28 +178,115 @@ namespace RadioBrowserAPI {
 
         State state;
         bool searching;
-        thread_safe<string> server;
+        query_handle current_search;
+        // Note: read for every query, written when switching mirrors.
+        read_mostly<string> server{string{}};
+        // Set when the user picked the server; queries don't fail over from it.
+        bool server_pinned = false;
         thread_safe<std::minstd_rand> random_engine;
-        thread_safe<MirrorsVec> mirrors;     // TODO: consider not caching the mirrors.
-        std::jthread connect_thread;
-        std::jthread mirrors_thread;
+        read_mostly<MirrorsVec> mirrors{MirrorsVec{}}; // TODO: consider not caching the mirrors.
+        scheduler::task connect_task;
+        scheduler::task mirrors_task;
+        thread_safe<std::vector<scheduler::task>> lookup_tasks;
+
+        // Persistent, see load_mirror_stats() and save_mirror_stats().
+        struct MirrorLatency {
+            unsigned      rtt_ms    = 0;
+            unsigned      successes = 0;
+            unsigned      failures  = 0;
+            bool          last_ok   = false;
+            std::int64_t  timestamp = 0; // seconds since the epoch
+        };
+        using MirrorLatencyMap = std::map<string, MirrorLatency>;
+        thread_safe<MirrorLatencyMap> latencies;
+
+
+        // State for racing all mirrors against each other, see race_mirrors().
+        struct MirrorRace {
+            std::vector<rest::token> tokens;
+            std::size_t failures = 0;
+            bool done = false;
+            result_function_t<> result_func;
+            error_function_t error_func;
+
+            void
+            finish();
+        };
+        std::shared_ptr<MirrorRace> current_race;
+
+
+        // Circuit breaker for each mirror, only used from the main thread.
+        struct MirrorBreaker {
+            unsigned strikes = 0; // consecutive failures or slow responses
+            std::chrono::steady_clock::time_point open_until;
+        };
+        std::map<string, MirrorBreaker> breakers;
+
+        const unsigned max_strikes = 3;
+        const auto slow_query = 5s;
+        const auto breaker_cooldown = 60s;
+        const unsigned max_query_retries = 2;
+
+
+        // An idempotent query, that can be retried on another mirror.
+        /*
+         * Hands out the elements of a search response as they arrive.
+         *
+         * Note: a retry starts over on another mirror, which may not be in sync with the
+         * first one; so the page starts over too, see restart_func.
+         */
+        struct ElementFeed {
+            result_function_t<std::string_view> element_func;
+            result_function_t<> restart_func;
+            json_array_splitter splitter;
+            unsigned attempt = 0;
+            bool delivered = false;
+            // Only for this attempt.
+            std::exception_ptr failure;
+
+            void
+            scan(std::string_view partial,
+                 unsigned new_attempt)
+            {
+                if (new_attempt != attempt) {
+                    attempt = new_attempt;
+                    splitter.reset();
+                    failure = {};
+                    if (delivered && restart_func)
+                        restart_func();
+                    delivered = false;
+                }
+                // Note: once an element fails, the response is not usable.
+                if (failure)
+                    std::rethrow_exception(failure);
+                try {
+                    while (auto element = splitter.next(partial)) {
+                        delivered = true;
+                        element_func(*element);
+                    }
+                }
+                catch (...) {
+                    failure = std::current_exception();
+                    throw;
+                }
+            }
+        };
 
-        using pending_call_t = std::future<void>;
-        using pending_call_list_t = std::deque<pending_call_t>;
-        thread_safe<pending_call_list_t> pending_calls;
+        const unsigned max_lookup_workers = 4;
+        const auto reverse_lookup_deadline = 3s;
 
 
         string
         make_url(const string& endpoint)
         {
-            string current_server = server.load();
-            if (current_server.empty()) {
-                auto m = mirrors.lock();
+            auto current_server = server.load();
+            if (current_server->empty()) {
+                auto m = mirrors.load();
                 if (m->empty())
                     throw error{"no server, no mirrors to build URL"};
-                current_server = m->front();
+                return "http://"s + m->front() + endpoint;
             }
-            return "http://"s + current_server + endpoint;
+            return "http://"s + *current_server + endpoint;
         }
 
 
@@ -184,6 +310,42 @@ namespace RadioBrowserAPI {
         }
 
 
+        // Shared between get_mirrors_sync() and the reverse lookup workers, that may
+        // outlive it.
+        struct ReverseLookups {
+            std::vector<net::address> addresses;
+            std::atomic<std::size_t> next = 0;
+
+            std::mutex mutex;
+            std::condition_variable cond;
+            std::size_t finished = 0;
+            std::vector<string> names;
+        };
+
+
+        void
+        reverse_lookup_worker(std::shared_ptr<ReverseLookups> lookups)
+        {
+            net::resolver::name_resolver nr;
+            for (;;) {
+                std::size_t i = lookups->next++;
+                if (i >= lookups->addresses.size())
+                    return;
+                const auto& addr = lookups->addresses[i];
+                if (!nr.try_process(addr))
+                    cout << "ERROR: failed to look up name for \""
+                         << to_string(addr) << "\": "
+                         << nr.error.message.value_or("unknown error") << endl;
+
+                std::lock_guard guard{lookups->mutex};
+                if (nr.result.name)
+                    lookups->names.push_back(std::move(*nr.result.name));
+                ++lookups->finished;
+                lookups->cond.notify_all();
+            }
+        }
+
+
         MirrorsVec
         get_mirrors_sync(std::stop_token stopper)
         {
@@ -211,26 +373,45 @@ namespace RadioBrowserAPI {
 
             // cout << "Found " << addresses.size() << " mirrors" << endl;
 
-            // now find the canonical names for each IP address
+            // now find the canonical names for each IP address, in parallel
             {
-                net::resolver::name_resolver nr;
-                for (const auto& addr : addresses) {
-                    try {
-                        nr.process(addr);
-
-                        if (stopper.stop_requested())
-                            throw error{"stop requested"};
-
-                        if (nr.error.message)
-                            throw error{"failed to look up name for \""
-                                        + to_string(addr) + "\""};
-                        if (nr.result.name)
-                            mirrors_set.insert(std::move(*nr.result.name));
-                    }
-                    catch (std::exception& e) {
-                        cout << "ERROR: " << e.what() << endl;
+                auto lookups = std::make_shared<ReverseLookups>();
+                lookups->addresses = std::move(addresses);
+
+                unsigned num_workers = std::min<std::size_t>(max_lookup_workers,
+                                                             lookups->addresses.size());
+                std::vector<scheduler::task> old_tasks;
+                {
+                    auto tasks = lookup_tasks.lock();
+                    old_tasks = std::exchange(*tasks, {});
+                    for (unsigned i = 0; i < num_workers; ++i)
+                        tasks->push_back(scheduler::submit(scheduler::category::dns,
+                                                           [lookups](std::stop_token)
+                                                           {
+                                                               reverse_lookup_worker(lookups);
+                                                           }));
+                }
+                // Note: leftovers from a previous call are normally finished by now. They're
+                // joined after unlocking, so nothing a worker locks can deadlock with this.
+                old_tasks.clear();
+
+                const auto deadline = std::chrono::steady_clock::now() + reverse_lookup_deadline;
+                std::unique_lock guard{lookups->mutex};
+                while (lookups->finished < lookups->addresses.size()) {
+                    if (stopper.stop_requested())
+                        throw error{"stop requested"};
+                    auto now = std::chrono::steady_clock::now();
+                    if (now >= deadline) {
+                        cout << "WARNING: only " << lookups->finished << " of "
+                             << lookups->addresses.size()
+                             << " reverse lookups finished in time" << endl;
+                        break;
                     }
+                    // Note: wake up periodically to check the stopper.
+                    lookups->cond.wait_until(guard, std::min(deadline, now + 100ms));
                 }
+                for (auto& name : lookups->names)
+                    mirrors_set.insert(std::move(name));
             }
 
             if (stopper.stop_requested())
@@ -267,38 +448,352 @@ namespace RadioBrowserAPI {
         }
 
 
-        template<typename F,
-                 typename... Args>
+        std::int64_t
+        now_seconds()
+        {
+            using namespace std::chrono;
+            return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+        }
+
+
         void
-        defer_call(F&& func,
-                   Args&& ...args)
+        record_success(const string& mirror,
+                       std::chrono::steady_clock::duration rtt)
+        {
+            using std::chrono::duration_cast;
+            using std::chrono::milliseconds;
+            auto lat = latencies.lock();
+            auto& entry = (*lat)[mirror];
+            entry.rtt_ms = duration_cast<milliseconds>(rtt).count();
+            ++entry.successes;
+            entry.last_ok = true;
+            entry.timestamp = now_seconds();
+        }
+
+
+        void
+        record_failure(const string& mirror)
         {
-            if (func) {
-                auto pc = pending_calls.lock();
-                auto fut = std::async(std::launch::deferred,
-                                      std::forward<F>(func),
-                                      std::forward<Args>(args)...);
-                pc->push_back(std::move(fut));
+            auto lat = latencies.lock();
+            auto& entry = (*lat)[mirror];
+            ++entry.failures;
+            entry.last_ok = false;
+            entry.timestamp = now_seconds();
+        }
+
+
+        // The mirror that answered fastest the last time it was checked.
+        std::optional<string>
+        fastest_known_mirror(const std::function<bool(const string&)>& skip = {})
+        {
+            auto lat = latencies.lock();
+            std::optional<string> result;
+            unsigned best_rtt = 0;
+            for (const auto& [name, entry] : *lat) {
+                if (!entry.last_ok)
+                    continue;
+                if (skip && skip(name))
+                    continue;
+                if (!result || entry.rtt_ms < best_rtt) {
+                    result = name;
+                    best_rtt = entry.rtt_ms;
+                }
             }
+            return result;
+        }
+
+
+        void
+        MirrorRace::finish()
+        {
+            done = true;
+            for (auto& t : tokens)
+                t.cancel();
+            // Note: this breaks the reference cycle between the race and the requests.
+            tokens.clear();
+            if (current_race.get() == this)
+                current_race.reset();
         }
 
 
+        /*
+         * Send a stats request to every mirror at once; the first one to answer
+         * successfully becomes the server, and the others are canceled.
+         * Must be called from the main thread, like all rest async functions.
+         */
         void
-        perform_deferred_calls()
+        race_mirrors(const MirrorsVec& candidates,
+                     result_function_t<> result_func,
+                     error_function_t error_func)
         {
-            pending_call_list_t local_pending_calls;
-            if (auto pc = pending_calls.try_lock()) {
-                if (!pc->empty())
-                    local_pending_calls = std::move(*pc);
+            if (candidates.empty()) {
+                state = State::disconnected;
+                if (error_func)
+                    error_func(error{"no mirrors to connect to"});
+                return;
             }
-            for (auto& item : local_pending_calls)
-                try {
-                    cout << "making deferred call" << endl;
-                    item.get(); // make the pending calls
-                }
-                catch (std::exception& e) {
-                    cout << "BUG: issuing pending call threw: " << e.what() << endl;
-                }
+
+            if (current_race)
+                current_race->finish();
+
+            auto race = std::make_shared<MirrorRace>();
+            race->result_func = std::move(result_func);
+            race->error_func = std::move(error_func);
+            current_race = race;
+
+            const auto start = std::chrono::steady_clock::now();
+            const std::size_t total = candidates.size();
+
+            for (const auto& mirror : candidates) {
+                auto on_success = [race, mirror, start](const std::string&)
+                {
+                    auto rtt = std::chrono::steady_clock::now() - start;
+                    record_success(mirror, rtt);
+                    if (race->done)
+                        return;
+                    cout << "Mirror " << mirror << " won the race, in "
+                         << std::chrono::duration_cast<std::chrono::milliseconds>(rtt)
+                         << endl;
+                    server.store(mirror);
+                    state = State::connected;
+                    auto result_func = std::move(race->result_func);
+                    race->finish();
+                    if (result_func)
+                        result_func();
+                };
+
+                auto on_error = [race, mirror, total](const std::exception& e)
+                {
+                    cout << "Failed to connect to " << mirror << ": " << e.what() << endl;
+                    record_failure(mirror);
+                    if (race->done)
+                        return;
+                    if (++race->failures < total)
+                        return;
+                    state = State::disconnected;
+                    auto error_func = std::move(race->error_func);
+                    race->finish();
+                    if (error_func)
+                        error_func(error{"no working mirror found"});
+                };
+
+                race->tokens.push_back(rest::get_json_async("https://" + mirror + "/json/stats",
+                                                            {},
+                                                            std::move(on_success),
+                                                            std::move(on_error)));
+            }
+        }
+
+
+        // Like race_mirrors(), but only measures; the current server doesn't change.
+        void
+        measure_mirrors(const MirrorsVec& candidates)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (const auto& mirror : candidates)
+                // Note: the token is discarded, the request still runs to completion.
+                rest::get_json_async("https://" + mirror + "/json/stats",
+                                     {},
+                                     [mirror, start](const std::string&)
+                                     {
+                                         record_success(mirror,
+                                                        std::chrono::steady_clock::now()
+                                                        - start);
+                                     },
+                                     [mirror](const std::exception&)
+                                     {
+                                         record_failure(mirror);
+                                     });
+        }
+
+
+        bool
+        is_breaker_open(const string& mirror)
+        {
+            auto it = breakers.find(mirror);
+            if (it == breakers.end())
+                return false;
+            return std::chrono::steady_clock::now() < it->second.open_until;
+        }
+
+
+        /*
+         * Update the mirror's circuit breaker; when it trips, switch the server to the
+         * next best mirror, unless the user picked it. Returns true when a failed query
+         * should be retried, because the server is now a different mirror.
+         */
+        bool
+        record_query_result(const string& mirror,
+                            bool ok,
+                            std::chrono::steady_clock::duration rtt)
+        {
+            if (!ok && *server.load() != mirror)
+                // Another query already switched away from this mirror.
+                return true;
+
+            auto& breaker = breakers[mirror];
+            if (ok && rtt < slow_query) {
+                breaker.strikes = 0;
+                return false;
+            }
+
+            if (++breaker.strikes < max_strikes)
+                return false;
+
+            breaker.strikes = 0;
+            breaker.open_until = std::chrono::steady_clock::now() + breaker_cooldown;
+            cout << "Mirror " << mirror << " tripped the circuit breaker" << endl;
+
+            if (server_pinned) {
+                cout << "Not switching away from the configured server " << mirror
+                     << endl;
+                return false;
+            }
+
+            auto skip = [&mirror](const string& name)
+            {
+                return name == mirror || is_breaker_open(name);
+            };
+            auto next = fastest_known_mirror(skip);
+            if (!next) {
+                for (const auto& name : *mirrors.load())
+                    if (!skip(name)) {
+                        next = name;
+                        break;
+                    }
+            }
+            if (!next)
+                return false;
+
+            cout << "Switching to mirror " << *next << endl;
+            server.store(*next);
+            return !ok;
+        }
+
+
+        void
+        send_query(std::shared_ptr<Query> q)
+        {
+            // Note: it was canceled while waiting for the connection, already reported.
+            if (q->canceled)
+                return;
+            string mirror = *server.load();
+            auto start = std::chrono::steady_clock::now();
+            const unsigned attempt = q->retries;
+            rest::json_progress_function_t progress_func;
+            if (q->progress_func)
+                progress_func = [q, attempt](std::string_view partial)
+                {
+                    q->progress_func(partial, attempt);
+                };
+            q->token = rest::post_json_async(
+                make_url(q->endpoint),
+                q->body,
+                [q, mirror, start, attempt](const std::string& response)
+                {
+                    // Note: the token holds the request, whose callbacks hold q.
+                    q->token.detach();
+                    record_query_result(mirror, true, std::chrono::steady_clock::now() - start);
+                    // Note: the mirror answered, so failures from here on are reported
+                    // directly; going through rest would count them against the mirror.
+                    try {
+                        // Note: the progress function may not have seen the last bytes.
+                        if (q->progress_func)
+                            q->progress_func(response, attempt);
+                        if (q->success_func)
+                            q->success_func(response);
+                    }
+                    catch (std::exception& e) {
+                        if (q->error_func)
+                            q->error_func(e);
+                    }
+                    q->release();
+                },
+                [q, mirror](const std::exception& e)
+                {
+                    q->token.detach();
+                    // Note: a dropped request says nothing about the mirror.
+                    if (dynamic_cast<const rest::canceled_error*>(&e)) {
+                        if (q->error_func)
+                            q->error_func(e);
+                        q->release();
+                        return;
+                    }
+                    if (record_query_result(mirror, false, {})
+                        && q->retries < max_query_retries) {
+                        ++q->retries;
+                        cout << "Retrying " << q->endpoint << " on another mirror" << endl;
+                        send_query(q);
+                        return;
+                    }
+                    if (q->error_func)
+                        q->error_func(e);
+                    q->release();
+                },
+                q->prio,
+                std::move(progress_func));
+        }
+
+
+        // Query parameters for the list endpoints (codecs, countries, tags).
+        template<typename P>
+        rest::get_params_t
+        make_list_params(const P& params)
+        {
+            rest::get_params_t result;
+            if (params.order) {
+                string order;
+                glz::ex::write_json(*params.order, order);
+                result["order"] = string_utils::trimmed(order, '"');
+            }
+            if (params.reverse)
+                result["reverse"] = *params.reverse ? "true" : "false";
+            if (params.hidebroken)
+                result["hidebroken"] = *params.hidebroken ? "true" : "false";
+            if (params.offset)
+                result["offset"] = std::to_string(*params.offset);
+            if (params.limit)
+                result["limit"] = std::to_string(*params.limit);
+            return result;
+        }
+
+
+        /*
+         * Lists rarely change, so they use GET, which can be cached on disk and
+         * revalidated. The result may be delivered twice: once from the cache, and again if
+         * the server has something newer.
+         */
+        template<typename P>
+        rest::token
+        cached_list_query(const string& endpoint,
+                          const P& params,
+                          rest::json_success_function_t success_func,
+                          error_function_t error_func)
+        {
+            string params_json;
+            glz::ex::write_json(params, params_json);
+            return rest::get_json_cached_async(endpoint + params_json,
+                                               make_url(endpoint),
+                                               make_list_params(params),
+                                               std::move(success_func),
+                                               std::move(error_func));
+        }
+
+
+        // Call func(args...) later, on the main thread.
+        template<typename F,
+                 typename... Args>
+        void
+        defer_call(F&& func,
+                   Args&& ...args)
+        {
+            if (func)
+                scheduler::post_main(scheduler::category::network,
+                                     [func = std::forward<F>(func),
+                                      ...args = std::forward<Args>(args)]() mutable
+                                     {
+                                         std::invoke(std::move(func), std::move(args)...);
+                                     });
         }
 
 
@@ -461,6 +956,57 @@ namespace RadioBrowserAPI {
             }
         }
 
+        // Send the query once connected, connecting first if needed.
+        void
+        send_when_connected(std::shared_ptr<Query> q)
+        {
+            if (state == State::connected) {
+                send_query(std::move(q));
+                return;
+            }
+            // Note: when_connected() needs a copyable API function.
+            std::function api_func = [q](result_function_t<>, error_function_t)
+            {
+                send_when_connected(q);
+            };
+            when_connected(std::move(api_func),
+                           result_function_t<>{},
+                           [q](const std::exception& e)
+                           {
+                               if (q->canceled)
+                                   return;
+                               if (q->error_func)
+                                   q->error_func(e);
+                               q->release();
+                           });
+        }
+
+
+        // Like rest::post_json_async(), but with mirror failover.
+        query_handle
+        query_async(const string& endpoint,
+                    string body,
+                    rest::json_success_function_t success_func,
+                    error_function_t error_func,
+                    rest::priority prio = rest::priority::interactive,
+                    std::shared_ptr<ElementFeed> feed = {})
+        {
+            auto q = std::make_shared<Query>();
+            q->endpoint = endpoint;
+            q->body = std::move(body);
+            q->success_func = std::move(success_func);
+            q->error_func = std::move(error_func);
+            q->prio = prio;
+            if (feed)
+                q->progress_func = [feed](std::string_view partial,
+                                          unsigned attempt)
+                {
+                    feed->scan(partial, attempt);
+                };
+            send_when_connected(q);
+            return query_handle{q};
+        }
+
     } // namespace
 
 
@@ -469,13 +1015,40 @@ namespace RadioBrowserAPI {
     {}
 
 
+    query_handle::query_handle(std::weak_ptr<Query> query)
+        noexcept :
+        query{std::move(query)}
+    {}
+
+
+    void
+    query_handle::cancel()
+    {
+        // Note: if it's still waiting for the connection, it won't be sent.
+        if (auto q = query.lock()) {
+            q->canceled = true;
+            q->token.cancel();
+            q->release();
+        }
+    }
+
+
+    bool
+    query_handle::operator ==(const query_handle& other)
+        const noexcept
+    {
+        return !query.owner_before(other.query) && !other.query.owner_before(query);
+    }
+
+
 
     /*
      * This performs a connection "test" on a background thread:
      * - if there's no server set:
      *   - two DNS lookups are used to find a list of all mirrors.
      *   - the list is randomized
-     *   - a synchronous server stats call is done on each until one mirror succeeds.
+     *   - back on the main thread, all mirrors race each other with an async server stats
+     *     call; the first one to succeed wins.
      * - if there's a server:
      *   - a synchronous server stats call is done to see if it's online
      *
@@ -501,45 +1074,59 @@ namespace RadioBrowserAPI {
             return;
         }
 
-        connect_thread = std::jthread{
-            [](std::stop_token stopper,
-               result_function_t<> result_func,
-               error_function_t error_func)
+        state = State::connecting;
+
+        connect_task = scheduler::submit(
+            scheduler::category::network,
+            [result_func = std::move(result_func),
+             error_func = std::move(error_func)](std::stop_token stopper) mutable
             {
                 try {
-                    auto srv = server.load();
+                    string srv = *server.load();
                     if (srv.empty()) {
-                        // No server set, use a random one from the mirrors list.
-                        auto local_mirrors = mirrors.load();
+                        // Try the historically fastest mirror first, skipping DNS and the
+                        // race; the others get re-ranked in the background.
+                        if (auto best = fastest_known_mirror()) {
+                            auto start = std::chrono::steady_clock::now();
+                            auto [test_success, test_response] = test_server(*best);
+                            if (test_success) {
+                                record_success(*best, std::chrono::steady_clock::now() - start);
+                                server.store(*best);
+                                defer_call(
+                                    [](result_function_t<> result_func)
+                                    {
+                                        state = State::connected;
+                                        cout << "state = " << to_string(state) << endl;
+                                        get_mirrors([] { measure_mirrors(current_mirrors()); });
+                                        if (result_func)
+                                            std::invoke(result_func);
+                                    },
+                                    std::move(result_func));
+                                return;
+                            }
+                            record_failure(*best);
+                        }
+
+                        // No known good mirror, use a random one from the mirrors list.
+                        MirrorsVec local_mirrors = *mirrors.load();
                         if (local_mirrors.empty()) {
                             // If no mirrors list yet, fetch it.
                             local_mirrors = get_mirrors_sync(stopper);
                             mirrors.store(local_mirrors);
                         }
-                        bool success = false;
-                        for (const auto& mirror : local_mirrors) {
-                            if (stopper.stop_requested())
-                                throw error{"stop requested"};
-                            auto [test_success, test_response] = test_server(mirror);
-                            if (test_success) {
-                                server.store(mirror);
-                                success = true;
-                                break;
-                            }
-                        }
-                        if (!success)
-                            throw error{"no working mirror found"};
-                        // Defer the result_func call, after updating the connection state.
+                        // Race them on the main thread, where rest calls happen.
                         defer_call(
-                            [](result_function_t<> result_func)
+                            [](MirrorsVec candidates,
+                               result_function_t<> result_func,
+                               error_function_t error_func)
                             {
-                                cout << "DEBUG: connection succeeded [1]!" << endl;
-                                state = State::connected;
-                                cout << "state = " << to_string(state) << endl;
-                                if (result_func)
-                                    std::invoke(result_func);
+                                race_mirrors(candidates,
+                                             std::move(result_func),
+                                             std::move(error_func));
                             },
-                            std::move(result_func));
+                            std::move(local_mirrors),
+                            std::move(result_func),
+                            std::move(error_func));
                     } else {
                         // We have a server.
                         auto [test_success, test_response] = test_server(srv);
@@ -551,7 +1138,6 @@ namespace RadioBrowserAPI {
                         defer_call(
                             [](result_function_t<> result_func)
                             {
-                                cout << "DEBUG: connection succeeded [2]!" << endl;
                                 state = State::connected;
                                 cout << "state = " << to_string(state) << endl;
                                 if (result_func)
@@ -574,17 +1160,41 @@ namespace RadioBrowserAPI {
                         std::move(error_func),
                         error{e});
                 }
-            },
-            std::move(result_func),
-            std::move(error_func)
-        };
+            });
     }
 
 
     MirrorsVec
     current_mirrors()
     {
-        return mirrors.load();
+        return *mirrors.load();
+    }
+
+
+    std::optional<std::chrono::milliseconds>
+    get_mirror_rtt(const string& mirror)
+    {
+        auto lat = latencies.lock();
+        auto it = lat->find(mirror);
+        if (it == lat->end() || !it->second.successes)
+            return {};
+        return std::chrono::milliseconds{it->second.rtt_ms};
+    }
+
+
+    void
+    load_mirror_stats(const std::filesystem::path& filename)
+    {
+        MirrorLatencyMap loaded;
+        Serializer::load(loaded, filename);
+        latencies.store(std::move(loaded));
+    }
+
+
+    void
+    save_mirror_stats(const std::filesystem::path& filename)
+    {
+        Serializer::save(latencies.load(), filename);
     }
 
 
@@ -608,21 +1218,27 @@ namespace RadioBrowserAPI {
     {
         TRACE_FUNC;
 
-        connect_thread = {};
-        mirrors_thread = {};
+        connect_task = {};
+        mirrors_task = {};
+        // Note: joined after unlocking, so nothing a worker locks can deadlock with this.
+        auto old_lookup_tasks = std::exchange(*lookup_tasks.lock(), {});
+        old_lookup_tasks.clear();
+        if (current_race)
+            current_race->finish();
 
-        searching = false;
+        cancel_search();
         state = State::disconnected;
 
         rest::finalize();
     }
 
 
-    void
+    bool
     process()
     {
-        perform_deferred_calls();
-        rest::process();
+        PROFILE_SCOPE("RadioBrowserAPI::process");
+
+        return rest::process();
     }
 
 
@@ -633,16 +1249,28 @@ namespace RadioBrowserAPI {
     }
 
 
+    void
+    cancel_search()
+    {
+        current_search.cancel();
+        current_search = {};
+        searching = false;
+    }
+
+
     void
     set_server(const string& new_server)
     {
+        server_pinned = !new_server.empty();
         switch (state) {
 
             case State::disconnected:
                 break;
 
             case State::connecting:
-                connect_thread = {};
+                connect_task = {};
+                if (current_race)
+                    current_race->finish();
                 if (new_server.empty())
                     state = State::disconnected;
                 else
@@ -659,15 +1287,14 @@ namespace RadioBrowserAPI {
 
         }
 
-        auto s = server.lock();
-        *s = new_server;
+        server.store(new_server);
     }
 
 
     string
     get_server()
     {
-        return server.load();
+        return *server.load();
     }
 
 
@@ -677,10 +1304,10 @@ namespace RadioBrowserAPI {
     {
         TRACE_FUNC;
 
-        mirrors_thread = std::jthread{
-            [](std::stop_token stopper,
-               result_function_t<> result_func,
-               error_function_t error_func)
+        mirrors_task = scheduler::submit(
+            scheduler::category::network,
+            [result_func = std::move(result_func),
+             error_func = std::move(error_func)](std::stop_token stopper) mutable
             {
                 try {
                     auto new_mirrors = get_mirrors_sync(stopper);
@@ -690,10 +1317,7 @@ namespace RadioBrowserAPI {
                 catch (std::exception& e) {
                     defer_call(std::move(error_func), error{e});
                 }
-            },
-            std::move(result_func),
-            std::move(error_func)
-        };
+            });
     }
 
 
@@ -710,12 +1334,9 @@ namespace RadioBrowserAPI {
             return;
         }
 
-        std::string params_json;
-        glz::ex::write_json(params, params_json);
-
-        rest::post_json_async(
-            make_url("/json/codecs"),
-            params_json,
+        cached_list_query(
+            "/json/codecs",
+            params,
             [result_func = std::move(result_func)](const std::string& response)
                 mutable
             {
@@ -741,12 +1362,9 @@ namespace RadioBrowserAPI {
             return;
         }
 
-        std::string params_json;
-        glz::ex::write_json(params, params_json);
-
-        rest::post_json_async(
-            make_url("/json/countries"),
-            params_json,
+        cached_list_query(
+            "/json/countries",
+            params,
             [result_func = std::move(result_func)](const std::string& response)
                 mutable
             {
@@ -786,26 +1404,18 @@ namespace RadioBrowserAPI {
     }
 
 
-    void
+    query_handle
     get_station(const string& uuid,
                 result_function_t<Station> result_func,
                 error_function_t error_func)
     {
-        if (state != State::connected) {
-            when_connected(get_station,
-                           uuid,
-                           std::move(result_func),
-                           std::move(error_func));
-            return;
-        }
-
         StationUUIDParams params { .uuids = uuid };
         std::string params_json;
         glz::ex::write_json(params, params_json);
 
-        rest::post_json_async(
-            make_url("/json/stations/byuuid"),
-            params_json,
+        return query_async(
+            "/json/stations/byuuid",
+            std::move(params_json),
             [result_func = std::move(result_func)](const std::string& response)
                 mutable
             {
@@ -833,12 +1443,9 @@ namespace RadioBrowserAPI {
             return;
         }
 
-        std::string params_json;
-        glz::ex::write_json(params, params_json);
-
-        rest::post_json_async(
-            make_url("/json/tags"),
-            params_json,
+        cached_list_query(
+            "/json/tags",
+            params,
             [result_func=std::move(result_func)](const std::string& response)
                 mutable
             {
@@ -859,49 +1466,114 @@ namespace RadioBrowserAPI {
     }
 
 
-    void
+    query_handle
     search_stations(const SearchStationParams& params,
                     result_function_t<StationVec> result_func,
                     error_function_t error_func)
+    {
+        return search_stations_json(
+            params,
+            [result_func=std::move(result_func)](const string& response)
+                mutable
+            {
+                StationVec result;
+                glz::ex::read<glz_options>(result, response);
+                if (result_func)
+                    result_func(std::move(result));
+            },
+            std::move(error_func));
+    }
+
+
+    query_handle
+    search_stations_json(const SearchStationParams& params,
+                         result_function_t<const string&> result_func,
+                         error_function_t error_func)
+    {
+        return search_stations_progressive(params,
+                                    {},
+                                    {},
+                                    std::move(result_func),
+                                    std::move(error_func));
+    }
+
+
+    query_handle
+    search_stations_progressive(const SearchStationParams& params,
+                                result_function_t<std::string_view> element_func,
+                                result_function_t<> restart_func,
+                                result_function_t<const string&> result_func,
+                                error_function_t error_func)
     {
         if (searching) {
             error e{"RadioBrowserAPI is searching"};
             if (error_func)
                 error_func(e);
-            return;
-        }
-
-        if (state != State::connected) {
-            when_connected(search_stations,
-                           params,
-                           std::move(result_func),
-                           std::move(error_func));
-            return;
+            return {};
         }
 
         std::string params_json;
         glz::ex::write_json(params, params_json);
 
+        std::shared_ptr<ElementFeed> feed;
+        if (element_func) {
+            feed = std::make_shared<ElementFeed>();
+            feed->element_func = std::move(element_func);
+            feed->restart_func = std::move(restart_func);
+        }
+
         searching = true;
-        rest::post_json_async(
-            make_url("/json/stations/search"),
-            params_json,
+        current_search = query_async(
+            "/json/stations/search",
+            std::move(params_json),
             [result_func=std::move(result_func)](const std::string& response)
                 mutable
             {
                 searching = false;
-                StationVec result;
-                glz::ex::read<glz_options>(result, response);
+                current_search = {};
                 if (result_func)
-                    result_func(std::move(result));
+                    result_func(response);
             },
             [error_func=std::move(error_func)](const std::exception& e)
                 mutable
             {
                 searching = false;
+                current_search = {};
                 if (error_func)
                     error_func(e);
-            });
+            },
+            rest::priority::interactive,
+            std::move(feed));
+        return current_search;
+    }
+
+
+    query_handle
+    prefetch_stations_json(const SearchStationParams& params,
+                           result_function_t<const string&> result_func,
+                           error_function_t error_func)
+    {
+        if (state != State::connected) {
+            error e{"RadioBrowserAPI is not connected"};
+            if (error_func)
+                error_func(e);
+            return {};
+        }
+
+        std::string params_json;
+        glz::ex::write_json(params, params_json);
+
+        return query_async(
+            "/json/stations/search",
+            std::move(params_json),
+            [result_func=std::move(result_func)](const std::string& response)
+                mutable
+            {
+                if (result_func)
+                    result_func(response);
+            },
+            std::move(error_func),
+            rest::priority::prefetch);
     }
 
 
@@ -933,7 +1605,9 @@ namespace RadioBrowserAPI {
                 if (result_func)
                     result_func(std::move(result));
             },
-            std::move(error_func));
+            std::move(error_func),
+            rest::priority::background,
+            rest::sharing::exclusive);
     }
 
 
@@ -965,7 +1639,239 @@ namespace RadioBrowserAPI {
                 if (result_func)
                     result_func(std::move(result));
             },
-            std::move(error_func));
+            std::move(error_func),
+            rest::priority::background,
+            rest::sharing::exclusive);
     }
 
+
+
+    namespace co {
+
+        namespace {
+
+            template<typename T>
+            T
+            parse(const string& response)
+            {
+                T result;
+                glz::ex::read<glz_options>(result, response);
+                return result;
+            }
+
+
+            // Like when_connected(), but without an API call.
+            void
+            call_when_connected(result_function_t<> result_func,
+                                error_function_t error_func)
+            {
+                switch (state) {
+                    case State::connected:
+                        result_func();
+                        break;
+                    case State::connecting:
+                        // Check again later.
+                        defer_call([](result_function_t<> result_func,
+                                      error_function_t error_func)
+                                   {
+                                       call_when_connected(std::move(result_func),
+                                                           std::move(error_func));
+                                   },
+                                   std::move(result_func),
+                                   std::move(error_func));
+                        break;
+                    case State::disconnected:
+                        RadioBrowserAPI::connect(std::move(result_func),
+                                                 std::move(error_func));
+                        break;
+                    default:
+                        std::abort();
+                }
+            }
+
+
+            // Like query_async(), a retry on another mirror is canceled too.
+            coro::task<string>
+            query(string endpoint,
+                  string body,
+                  rest::priority prio = rest::priority::interactive)
+            {
+                co_return co_await coro::from_callbacks<string>(
+                    [&](coro::resolve_t<string> resolve,
+                        coro::reject_t reject) -> coro::canceler_t
+                    {
+                        auto q = query_async(endpoint,
+                                             std::move(body),
+                                             std::move(resolve),
+                                             std::move(reject),
+                                             prio);
+                        return [q] mutable { q.cancel(); };
+                    });
+            }
+
+
+            // Only the first delivery is used, from the disk cache if there's one.
+            template<typename P>
+            coro::task<string>
+            cached_list(string endpoint,
+                        P params)
+            {
+                co_return co_await coro::from_callbacks<string>(
+                    [&](coro::resolve_t<string> resolve,
+                        coro::reject_t reject) -> coro::canceler_t
+                    {
+                        auto tok = cached_list_query(endpoint,
+                                                     params,
+                                                     std::move(resolve),
+                                                     std::move(reject));
+                        return [tok = std::move(tok)] mutable { tok.cancel(); };
+                    });
+            }
+
+        } // namespace
+
+
+        coro::task<>
+        connect()
+        {
+            co_await coro::from_callbacks<>(
+                [](coro::resolve_t<> resolve,
+                   coro::reject_t reject) -> coro::canceler_t
+                {
+                    call_when_connected(std::move(resolve), std::move(reject));
+                    return {};
+                });
+        }
+
+
+        coro::task<CodecVec>
+        get_codecs(CodecParams params)
+        {
+            co_await connect();
+            co_return parse<CodecVec>(co_await cached_list("/json/codecs", params));
+        }
+
+
+        coro::task<CountryVec>
+        get_countries(CountryParams params)
+        {
+            co_await connect();
+            co_return parse<CountryVec>(co_await cached_list("/json/countries", params));
+        }
+
+
+        coro::task<ServerStats>
+        get_server_stats()
+        {
+            co_await connect();
+            co_return parse<ServerStats>(co_await rest::co::get_json(make_url("/json/stats")));
+        }
+
+
+        coro::task<Station>
+        get_station(string uuid)
+        {
+            co_await connect();
+            StationUUIDParams params { .uuids = std::move(uuid) };
+            std::string params_json;
+            glz::ex::write_json(params, params_json);
+            auto result = parse<StationVec>(co_await query("/json/stations/byuuid",
+                                                           std::move(params_json)));
+            if (result.size() != 1)
+                throw error{"incorrect array size: " + std::to_string(result.size())};
+            co_return std::move(result[0]);
+        }
+
+
+        coro::task<StationVec>
+        get_stations(std::vector<string> uuids)
+        {
+            co_await connect();
+            StationUUIDParams params { .uuids = string_utils::join(uuids, ",") };
+            std::string params_json;
+            glz::ex::write_json(params, params_json);
+            co_return parse<StationVec>(co_await query("/json/stations/byuuid",
+                                                       std::move(params_json)));
+        }
+
+
+        coro::task<TagVec>
+        get_tags(TagParams params)
+        {
+            co_await connect();
+            co_return parse<TagVec>(co_await cached_list("/json/tags", params));
+        }
+
+
+        coro::task<StationVec>
+        search_stations(SearchStationParams params)
+        {
+            co_return parse<StationVec>(co_await search_stations_json(std::move(params)));
+        }
+
+
+        coro::task<string>
+        search_stations_json(SearchStationParams params)
+        {
+            co_await connect();
+            co_return co_await coro::from_callbacks<string>(
+                [&](coro::resolve_t<string> resolve,
+                    coro::reject_t reject) -> coro::canceler_t
+                {
+                    auto search =
+                        RadioBrowserAPI::search_stations_json(params,
+                                                              std::move(resolve),
+                                                              std::move(reject));
+                    // Note: only cancel it if it wasn't superseded by another search.
+                    return [search]
+                    {
+                        if (search == current_search)
+                            cancel_search();
+                    };
+                });
+        }
+
+
+        coro::task<string>
+        prefetch_stations_json(SearchStationParams params)
+        {
+            if (state != State::connected)
+                throw error{"RadioBrowserAPI is not connected"};
+            std::string params_json;
+            glz::ex::write_json(params, params_json);
+            co_return co_await query("/json/stations/search",
+                                     std::move(params_json),
+                                     rest::priority::prefetch);
+        }
+
+
+        coro::task<ClickResult>
+        send_click(string uuid)
+        {
+            if (uuid.empty())
+                throw error{"empty station uuid"};
+            co_await connect();
+            // Note: clicking does not support GET/POST parameters.
+            co_return parse<ClickResult>(co_await rest::co::get_json(make_url("/json/url/" + uuid),
+                                                                     {},
+                                                                     rest::priority::background,
+                                                                     rest::sharing::exclusive));
+        }
+
+
+        coro::task<VoteResult>
+        send_vote(string uuid)
+        {
+            if (uuid.empty())
+                throw error{"empty station uuid"};
+            co_await connect();
+            // NOTE: voting does not support GET/POST parameters.
+            co_return parse<VoteResult>(co_await rest::co::get_json(make_url("/json/vote/" + uuid),
+                                                                    {},
+                                                                    rest::priority::background,
+                                                                    rest::sharing::exclusive));
+        }
+
+    } // namespace co
+
 } // namespace RadioBrowserAPI
@@ -1,14 +1,20 @@
 #ifndef RADIO_BROWSER_API_HPP
 #define RADIO_BROWSER_API_HPP
 
+#include <chrono>
 #include <cstdint>
 #include <exception>
+#include <filesystem>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "coro.hpp"
+
 
 namespace RadioBrowserAPI {
 
@@ -281,13 +287,44 @@ namespace RadioBrowserAPI {
     using error_function_t = std::move_only_function<error_function_sig>;
 
 
+    struct Query;
+
+    // Refers to a query sent to the server; dropping the handle does not cancel it.
+    class query_handle {
+
+        std::weak_ptr<Query> query;
+
+    public:
+
+        constexpr
+        query_handle()
+            noexcept = default;
+
+        explicit
+        query_handle(std::weak_ptr<Query> query)
+            noexcept;
+
+        // Cancel the query, without calling its handlers; this includes a retry on
+        // another mirror, and a query still waiting for the connection.
+        void
+        cancel();
+
+        [[nodiscard]]
+        bool
+        operator ==(const query_handle& other)
+            const noexcept;
+
+    }; // class query_handle
+
+
     void
     initialize(const string& user_agent);
 
     void
     finalize();
 
-    void
+    // Returns true if any request completed.
+    bool
     process();
 
 
@@ -295,6 +332,13 @@ namespace RadioBrowserAPI {
     is_searching();
 
 
+    // Cancel the search in progress, without calling its handlers.
+    void
+    cancel_search();
+
+
+    // An empty address picks a mirror automatically; only then can failing queries
+    // switch to another mirror.
     void
     set_server(const string& address);
 
@@ -314,6 +358,20 @@ namespace RadioBrowserAPI {
     current_mirrors();
 
 
+    // Last measured response time for this mirror, if it ever answered.
+    std::optional<std::chrono::milliseconds>
+    get_mirror_rtt(const string& mirror);
+
+
+    // Mirror response times and success rates, so the next connect() can skip the
+    // mirror discovery.
+    void
+    load_mirror_stats(const std::filesystem::path& filename);
+
+    void
+    save_mirror_stats(const std::filesystem::path& filename);
+
+
     void
     connect(result_function_t<> result_func = {},
             error_function_t error_func = {});
@@ -336,7 +394,7 @@ namespace RadioBrowserAPI {
                      error_function_t error_func = {});
 
 
-    void
+    query_handle
     get_station(const string& uuid,
                 result_function_t<Station> result_func,
                 error_function_t error_func = {});
@@ -352,11 +410,39 @@ namespace RadioBrowserAPI {
     reconnect();
 
 
-    void
+    query_handle
     search_stations(const SearchStationParams& params,
                     result_function_t<StationVec> result_func,
                     error_function_t error_func = {});
 
+    // Like search_stations(), but delivers the unparsed JSON array.
+    query_handle
+    search_stations_json(const SearchStationParams& params,
+                         result_function_t<const string&> result_func,
+                         error_function_t error_func = {});
+
+    /*
+     * Like search_stations_json(), but element_func also gets each station object
+     * (unparsed) as soon as it's complete, while the rest is still arriving. Every
+     * station goes through element_func before result_func gets the whole array.
+     *
+     * When the query is retried on another mirror, after some stations were delivered,
+     * restart_func is called: the elements delivered so far must be discarded, they
+     * start over from the first one.
+     */
+    query_handle
+    search_stations_progressive(const SearchStationParams& params,
+                                result_function_t<std::string_view> element_func,
+                                result_function_t<> restart_func,
+                                result_function_t<const string&> result_func,
+                                error_function_t error_func = {});
+
+    // Like search_stations_json(), but can run during a search; fails if not connected.
+    query_handle
+    prefetch_stations_json(const SearchStationParams& params,
+                           result_function_t<const string&> result_func,
+                           error_function_t error_func = {});
+
 
     void
     send_click(const string& uuid,
@@ -369,6 +455,55 @@ namespace RadioBrowserAPI {
               result_function_t<VoteResult> result_func,
               error_function_t error_func = {});
 
+
+    /*
+     * Coroutine versions of the functions above, for the main thread. They connect first,
+     * if needed; errors are thrown. Stopping the awaiting task cancels the request.
+     *
+     * Independent requests can run concurrently, with coro::when_all().
+     */
+    namespace co {
+
+        coro::task<>
+        connect();
+
+        coro::task<CodecVec>
+        get_codecs(CodecParams params = {});
+
+        coro::task<CountryVec>
+        get_countries(CountryParams params = {});
+
+        coro::task<ServerStats>
+        get_server_stats();
+
+        coro::task<Station>
+        get_station(string uuid);
+
+        // Many stations in a single request; there's no callback version. Stations that
+        // were removed from the server are missing from the result.
+        coro::task<StationVec>
+        get_stations(std::vector<string> uuids);
+
+        coro::task<TagVec>
+        get_tags(TagParams params = {});
+
+        coro::task<StationVec>
+        search_stations(SearchStationParams params);
+
+        coro::task<string>
+        search_stations_json(SearchStationParams params);
+
+        coro::task<string>
+        prefetch_stations_json(SearchStationParams params);
+
+        coro::task<ClickResult>
+        send_click(string uuid);
+
+        coro::task<VoteResult>
+        send_vote(string uuid);
+
+    } // namespace co
+
 } // namespace RadioBrowserAPI
 
 #endif
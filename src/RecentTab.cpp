@@ -20,9 +20,10 @@
 #include "cfg.hpp"
 #include "IconManager.hpp"
 #include "IconsFontAwesome4.h"
-#include "Serializer.hpp"
+#include "Profiler.hpp"
 #include "Station.hpp"
 #include "StationDetailsPopup.hpp"
+#include "station_journal.hpp"
 #include "UI.hpp"
 
 
@@ -39,6 +40,8 @@ namespace RecentTab {
 
         std::shared_ptr<Station> pending_add;
         std::optional<std::size_t> pending_remove;
+        UI::VirtualList stations_list;
+        std::optional<station_journal> journal;
 
     } // namespace
 
@@ -47,8 +50,9 @@ namespace RecentTab {
     load()
     try {
         stations.clear();
-        auto filename = App::get_config_path() / "recent.json";
-        Serializer::load(stations, filename);
+        journal.emplace(App::get_config_path() / "recent.beve");
+        journal->load(stations);
+        stations_list.invalidate();
     }
     catch (std::exception& e) {
         cout << "ERROR: Recent::load(): " << e.what() << endl;
@@ -58,8 +62,8 @@ namespace RecentTab {
     void
     save()
     try {
-        auto filename = App::get_config_path() / "recent.json";
-        Serializer::save(stations, filename);
+        if (journal)
+            journal->compact(stations);
     }
     catch (std::exception& e) {
         cout << "ERROR: Recent::save(): " << e.what() << endl;
@@ -76,7 +80,9 @@ namespace RecentTab {
     void
     finalize()
     {
-        save();
+        if (journal)
+            journal->close(stations);
+        journal.reset();
     }
 
 
@@ -139,7 +145,7 @@ namespace RecentTab {
                         ImGuiChildFlags_NavFlattened
                     }) {
 
-                    UI::show_tags(station->tags);
+                    UI::show_tags(*station);
 
                 }
 
@@ -152,6 +158,8 @@ namespace RecentTab {
     void
     process_ui()
     {
+        PROFILE_SCOPE("RecentTab::process_ui");
+
         if (ImGui::RAII::Child toolbar_child{
                 "toolbar",
                 {0, 0},
@@ -159,8 +167,12 @@ namespace RecentTab {
                 ImGuiChildFlags_NavFlattened
             }) {
 
-            if (ImGui::Button("Clear"))
+            if (ImGui::Button("Clear")) {
+                journal->remove(0, stations.size());
                 stations.clear();
+                journal->maybe_compact(stations);
+                stations_list.invalidate();
+            }
             ImGui::SetItemTooltip("Clear entire recent history.");
 
             ImGui::SameLine();
@@ -172,62 +184,82 @@ namespace RecentTab {
 
         // Note: flat navigation doesn't work well on child windows that scroll.
         if (ImGui::RAII::Child recent_child{"recent"})
-            for (std::size_t index = stations.size() - 1; index + 1 > 0; --index)
-                show_station(stations[index], index);
+            // Note: the most recent is shown first.
+            stations_list.show(stations.size(),
+                               [](std::size_t row)
+                               {
+                                   const std::size_t index = stations.size() - 1 - row;
+                                   show_station(stations[index], index);
+                               });
 
         StationDetailsPopup::process_ui();
     }
 
 
-    void
+    bool
     process_add()
     {
         if (!pending_add)
-            return;
+            return false;
         if (!stations.empty() && *pending_add == *stations.back())
-            return;
+            return false;
+        journal->add(*pending_add);
         stations.push_back(std::move(pending_add));
+        return true;
     }
 
 
-    void
+    bool
     process_remove()
     {
         // Handle any pending removal
         if (!pending_remove)
-            return;
+            return false;
 
         std::size_t index = *pending_remove;
-        if (index < stations.size())
-            stations.erase(stations.begin() + index);
         pending_remove.reset();
+        if (index >= stations.size())
+            return false;
+        stations.erase(stations.begin() + index);
+        journal->remove(index);
+        return true;
     }
 
 
-    void
+    bool
     remove_excess()
     {
-        if (stations.size() > cfg::state.recent_limit) {
-            std::size_t pending_remove = stations.size() - cfg::state.recent_limit;
-            stations.erase(stations.begin(),
-                           stations.begin() + pending_remove);
-        }
+        if (stations.size() <= cfg::state.recent_limit)
+            return false;
+        std::size_t pending_remove = stations.size() - cfg::state.recent_limit;
+        stations.erase(stations.begin(),
+                       stations.begin() + pending_remove);
+        journal->remove(0, pending_remove);
+        return true;
     }
 
 
     void
     process_logic()
     {
-        process_add();
-        process_remove();
-        remove_excess();
+        PROFILE_SCOPE("RecentTab::process_logic");
+
+        bool changed = process_add();
+        changed |= process_remove();
+        changed |= remove_excess();
+        if (changed) {
+            journal->maybe_compact(stations);
+            // Note: the most recent is shown first, so every row may have moved.
+            stations_list.invalidate();
+        }
     }
 
 
     void
     queue_add(std::shared_ptr<Station>& station)
     {
-        pending_add = station;
+        // Note: copied, so it doesn't keep a page of browser results alive.
+        pending_add = station ? std::make_shared<Station>(*station) : nullptr;
     }
 
 } // namespace RecentTab
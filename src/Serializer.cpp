@@ -0,0 +1,259 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // min(), ranges::contains()
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <iterator>             // istreambuf_iterator
+#include <map>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>              // move()
+#include <vector>
+
+#include "Serializer.hpp"
+
+#include "thread_policy.hpp"
+
+
+using std::cout;
+using std::endl;
+
+using namespace std::literals;
+
+using clock_type = std::chrono::steady_clock;
+
+
+namespace Serializer {
+
+    namespace {
+
+        // Wait for the file to stop changing for this long.
+        const auto debounce_delay = 2s;
+
+        // But don't wait longer than this, if it keeps changing.
+        const auto max_delay = 10s;
+
+
+        struct Pending {
+            std::string contents;
+            clock_type::time_point first;
+            clock_type::time_point due;
+        };
+
+        std::mutex mutex;
+        std::condition_variable_any queue_cond;
+        std::condition_variable idle_cond;
+        std::map<std::filesystem::path, Pending> pending;
+        // Changes every time the queue changes, so the writer can recompute its timeout.
+        unsigned generation = 0;
+        bool writing = false;
+        // The files being written right now.
+        std::vector<std::filesystem::path> writing_files;
+
+        std::jthread writer_thread;
+
+
+        void
+        write_batch(std::vector<std::pair<std::filesystem::path, std::string>>& batch)
+        {
+            for (auto& [filename, contents] : batch) {
+                try {
+                    write_file(filename, contents);
+                }
+                catch (std::exception& e) {
+                    cout << "ERROR: Serializer: failed to write \"" << filename.string()
+                         << "\": " << e.what() << endl;
+                }
+            }
+        }
+
+
+        void
+        writer_func(std::stop_token token)
+        {
+            thread_policy::apply(thread_policy::role::background);
+
+            std::unique_lock lock{mutex};
+            while (true) {
+                const bool everything = token.stop_requested();
+                const auto now = clock_type::now();
+                auto next = clock_type::time_point::max();
+                std::vector<std::pair<std::filesystem::path, std::string>> batch;
+                for (auto it = pending.begin(); it != pending.end();) {
+                    if (everything || it->second.due <= now) {
+                        batch.emplace_back(it->first, std::move(it->second.contents));
+                        it = pending.erase(it);
+                    } else {
+                        next = std::min(next, it->second.due);
+                        ++it;
+                    }
+                }
+
+                if (!batch.empty()) {
+                    writing = true;
+                    for (auto& [filename, contents] : batch)
+                        writing_files.push_back(filename);
+                    lock.unlock();
+                    write_batch(batch);
+                    lock.lock();
+                    writing = false;
+                    writing_files.clear();
+                    idle_cond.notify_all();
+                    continue;
+                }
+
+                if (token.stop_requested())
+                    break;
+
+                const unsigned old_generation = generation;
+                auto changed = [old_generation] { return generation != old_generation; };
+                if (next == clock_type::time_point::max())
+                    queue_cond.wait(lock, token, changed);
+                else
+                    queue_cond.wait_until(lock, token, next, changed);
+            }
+        }
+
+    } // namespace
+
+
+    bool
+    is_binary(const std::filesystem::path& filename)
+    {
+        return filename.extension() == ".beve";
+    }
+
+
+    std::filesystem::path
+    get_json_path(const std::filesystem::path& filename)
+    {
+        return std::filesystem::path{filename}.replace_extension(".json");
+    }
+
+
+    bool
+    can_load(const std::filesystem::path& filename)
+    {
+        if (exists(filename) || exists(std::filesystem::path{filename.string() + ".old"}))
+            return true;
+        return is_binary(filename) && can_load(get_json_path(filename));
+    }
+
+
+    std::string
+    read_file(const std::filesystem::path& filename)
+    {
+        std::ifstream input{filename, std::ios::binary};
+        if (!input)
+            throw std::runtime_error{"could not open \"" + filename.string() + "\""};
+        std::string contents{std::istreambuf_iterator<char>{input},
+                             std::istreambuf_iterator<char>{}};
+        if (input.bad())
+            throw std::runtime_error{"could not read \"" + filename.string() + "\""};
+        return contents;
+    }
+
+
+    void
+    write_file(const std::filesystem::path& filename,
+               const std::string& contents)
+    {
+        std::filesystem::path filename_new = filename.string() + ".new";
+        {
+            std::ofstream output{filename_new, std::ios::binary | std::ios::trunc};
+            if (!output)
+                throw std::runtime_error{"could not create \"" + filename_new.string() + "\""};
+            output.write(contents.data(), contents.size());
+            output.close();
+            if (!output)
+                throw std::runtime_error{"could not write \"" + filename_new.string() + "\""};
+        }
+
+#ifdef __WIIU__
+        // WORKAROUND: wut+newlib cannot rename when destination file already exists.
+        std::filesystem::path filename_old = filename.string() + ".old";
+        if (exists(filename_old))
+            remove(filename_old);
+        if (exists(filename))
+            rename(filename, filename_old);
+        rename(filename_new, filename);
+        remove(filename_old);
+#else
+        rename(filename_new, filename);
+#endif
+    }
+
+
+    void
+    initialize()
+    {
+        writer_thread = std::jthread{writer_func};
+    }
+
+
+    void
+    finalize()
+    {
+        if (!writer_thread.joinable())
+            return;
+        // Note: the writer writes everything still queued before it stops.
+        writer_thread.request_stop();
+        writer_thread.join();
+    }
+
+
+    void
+    flush()
+    {
+        std::unique_lock lock{mutex};
+        if (!writer_thread.joinable())
+            return;
+        const auto now = clock_type::now();
+        for (auto& [filename, p] : pending)
+            p.due = now;
+        ++generation;
+        queue_cond.notify_all();
+        idle_cond.wait(lock, [] { return pending.empty() && !writing; });
+    }
+
+
+    bool
+    is_queued(const std::filesystem::path& filename)
+    {
+        std::lock_guard lock{mutex};
+        return pending.contains(filename) || std::ranges::contains(writing_files, filename);
+    }
+
+
+    void
+    queue_write(const std::filesystem::path& filename,
+                std::string contents)
+    {
+        if (!writer_thread.joinable()) {
+            write_file(filename, contents);
+            return;
+        }
+
+        const auto now = clock_type::now();
+        {
+            std::lock_guard lock{mutex};
+            auto [it, inserted] = pending.try_emplace(filename);
+            Pending& p = it->second;
+            p.contents = std::move(contents);
+            if (inserted)
+                p.first = now;
+            p.due = std::min(now + debounce_delay, p.first + max_delay);
+            ++generation;
+        }
+        queue_cond.notify_all();
+    }
+
+} // namespace Serializer
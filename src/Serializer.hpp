@@ -12,18 +12,55 @@
 #include <stdexcept>
 #include <string>
 
+#include <glaze/beve.hpp>
 #include <glaze/json.hpp>
 #include <glaze/exceptions/json_exceptions.hpp>
 
 
 namespace Serializer {
 
+    /*
+     * Files with the ".beve" extension use glaze's binary format (BEVE); the others use
+     * JSON, that the user can read and edit.
+     *
+     * When a binary file doesn't exist yet, load() reads the ".json" file with the same
+     * name instead; the next save() migrates it.
+     */
+
     inline constexpr
     const glz::opts glz_options{
         .error_on_unknown_keys = false,
         .prettify = true,
     };
 
+    inline constexpr
+    const glz::opts beve_options{
+        .format = glz::BEVE,
+        .error_on_unknown_keys = false,
+    };
+
+
+    [[nodiscard]]
+    bool
+    is_binary(const std::filesystem::path& filename);
+
+
+    // The ".json" file a binary file is migrated from.
+    [[nodiscard]]
+    std::filesystem::path
+    get_json_path(const std::filesystem::path& filename);
+
+
+    // True if load() has something to read.
+    [[nodiscard]]
+    bool
+    can_load(const std::filesystem::path& filename);
+
+
+    [[nodiscard]]
+    std::string
+    read_file(const std::filesystem::path& filename);
+
 
     template<typename T>
     void
@@ -31,6 +68,18 @@ namespace Serializer {
          const std::filesystem::path& filename)
     {
         std::filesystem::path filename_old = filename.string() + ".old";
+        if (is_binary(filename)) {
+            std::string contents;
+            if (exists(filename))
+                contents = read_file(filename);
+            else if (exists(filename_old))
+                contents = read_file(filename_old);
+            else
+                return load(obj, get_json_path(filename));
+            glz::ex::read<beve_options>(obj, contents);
+            return;
+        }
+
         if (exists(filename))
             glz::ex::read_file_json<glz_options>(obj, filename.c_str(), std::string{});
         else if (exists(filename_old))
@@ -40,25 +89,80 @@ namespace Serializer {
     }
 
 
+    template<typename T>
+    [[nodiscard]]
+    std::string
+    serialize(const T& obj,
+              const std::filesystem::path& filename)
+    {
+        std::string contents;
+        if (is_binary(filename))
+            glz::ex::write<beve_options>(obj, contents);
+        else
+            glz::ex::write<glz_options>(obj, contents);
+        return contents;
+    }
+
+
+    /*
+     * Replace the file's contents; a crash leaves either the old or the new contents,
+     * that load() can find.
+     */
+    void
+    write_file(const std::filesystem::path& filename,
+               const std::string& contents);
+
+
     template<typename T>
     void
     save(const T& obj,
          const std::filesystem::path& filename)
     {
-        std::filesystem::path filename_new = filename.string() + ".new";
-        glz::ex::write_file_json<glz_options>(obj, filename_new.c_str(), std::string{});
+        write_file(filename, serialize(obj, filename));
+    }
 
-#ifdef __WIIU__
-        // WORKAROUND: wut+newlib cannot rename when destination file already exists.
-        std::filesystem::path filename_old = filename.string() + ".old";
-        if (exists(filename_old))
-            remove(filename_old);
-        rename(filename, filename_old);
-        rename(filename_new, filename);
-        remove(filename_old);
-#else
-        rename(filename_new, filename);
-#endif
+
+    /*
+     * Background writer, so saving doesn't stall the UI.
+     *
+     * Saves to the same file are coalesced: a file is only written after it stops changing
+     * for a little while; or, at most, a few seconds after the first request.
+     */
+
+    void
+    initialize();
+
+    // Write everything that's still queued, then stop the writer.
+    void
+    finalize();
+
+    // Wait until everything queued so far is written.
+    void
+    flush();
+
+
+    // True if the file was queued, and is not fully written yet.
+    [[nodiscard]]
+    bool
+    is_queued(const std::filesystem::path& filename);
+
+
+    // Written synchronously if the writer isn't running.
+    void
+    queue_write(const std::filesystem::path& filename,
+                std::string contents);
+
+
+    /*
+     * Note: obj is serialized by the calling thread, into memory, so the caller can keep
+     * modifying it; only the file operations happen in the background.
+     */
+    template<typename T>
+    void
+    save_async(const T& obj,
+               const std::filesystem::path& filename)
+    {
+        queue_write(filename, serialize(obj, filename));
     }
 
 } // namespace Serializer
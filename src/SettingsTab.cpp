@@ -5,6 +5,8 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <algorithm>            // max(), min()
+#include <filesystem>
 #include <iostream>
 
 #include <imgui.h>
@@ -13,11 +15,19 @@
 
 #include "SettingsTab.hpp"
 
+#include "App.hpp"
 #include "BrowserTab.hpp"
 #include "cfg.hpp"
+#include "http_client.hpp"
 #include "IconsFontAwesome4.h"
+#include "Profiler.hpp"
+#include "radio_client.hpp"
 #include "RadioBrowserAPI.hpp"
+#include "socket_tuning.hpp"
+#include "station_prober.hpp"
+#include "StationIndex.hpp"
 #include "Styles.hpp"
+#include "tracer.hpp"
 #include "UI.hpp"
 
 
@@ -31,6 +41,8 @@ namespace SettingsTab {
     void
     process_ui()
     {
+        PROFILE_SCOPE("SettingsTab::process_ui");
+
         const ImGuiStyle& style = ImGui::GetStyle();
 
         // Note: flat navigation doesn't work well on child windows that scroll.
@@ -193,9 +205,65 @@ namespace SettingsTab {
                 ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
                 ImGui::Checkbox("##switch_to_player", &cfg::state.switch_to_player);
 
+                /*****************
+                 * Offline index *
+                 *****************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Search offline");
+                ImGui::SetItemTooltip("Download the whole station list, and search it locally.\n"
+                                      "It's kept up to date in the background.");
+
+                ImGui::TableNextColumn();
+
+                if (ImGui::Checkbox("##offline_index", &cfg::state.offline_index))
+                    StationIndex::set_enabled(cfg::state.offline_index);
+                ImGui::SameLine();
+                ImGui::AlignTextToFramePadding();
+                ImGui::TextUnformatted(StationIndex::get_stats().status.c_str());
+
+                /*******************
+                 * Check favorites *
+                 *******************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Check favorites");
+                ImGui::SetItemTooltip("Check in the background that favorite stations still work.\n"
+                                      "The stream that worked is played directly next time.");
+
+                ImGui::TableNextColumn();
+
+                if (ImGui::Checkbox("##check_favorites", &cfg::state.check_favorites))
+                    station_prober::set_enabled(cfg::state.check_favorites);
+
+                /***************
+                 * Native HTTP *
+                 ***************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Built-in HTTP");
+                ImGui::SetItemTooltip("Receive http:// streams directly, without curl.\n"
+                                      "HTTPS streams always use curl.");
+
+                ImGui::TableNextColumn();
+
+                if (ImGui::Checkbox("##native_http", &cfg::state.native_http))
+                    http_client::set_native_enabled(cfg::state.native_http);
 
                 /**********************
-                 * Player buffer size *
+                 * Normalize loudness *
                  **********************/
 
                 ImGui::TableNextRow();
@@ -203,17 +271,221 @@ namespace SettingsTab {
                 ImGui::TableNextColumn();
 
                 ImGui::AlignTextToFramePadding();
-                UI::show_label("Player buffer size (KiB)");
-                ImGui::SetItemTooltip("Playback will only start after this many bytes are received.");
+                UI::show_label("Normalize loudness");
+                ImGui::SetItemTooltip("Bring all stations to a similar volume.\n"
+                                      "Peaks are limited, so loud stations don't clip.");
+
+                ImGui::TableNextColumn();
+
+                ImGui::Checkbox("##normalize_loudness", &cfg::state.normalize_loudness);
+
+                /*******************
+                 * Capture streams *
+                 *******************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Capture streams");
+                ImGui::SetItemTooltip("Save the raw audio responses, with their timing, in the"
+                                      " \"captures\" folder.\n"
+                                      "They can be replayed with a \"capture:\" URL.\n"
+                                      "Takes effect on the next connection.");
+
+                ImGui::TableNextColumn();
+
+                if (ImGui::Checkbox("##capture_streams", &cfg::state.capture_streams))
+                    radio_client::set_capture_dir(cfg::state.capture_streams
+                                                  ? App::get_config_path() / "captures"
+                                                  : std::filesystem::path{});
+
+                /********************
+                 * Recording folder *
+                 ********************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Recording folder");
+                ImGui::SetItemTooltip("Where the record button saves the audio, one file"
+                                      " per track.\n"
+                                      "Empty means the \"recordings\" folder, next to the"
+                                      " settings.");
+
+                ImGui::TableNextColumn();
+
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                ImGui::InputText("##recording_dir", cfg::state.recording_dir);
+
+                /************************
+                 * Stream socket tuning *
+                 ************************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Tune stream sockets");
+                ImGui::SetItemTooltip("Use a bigger receive buffer, keepalive and fewer ACKs"
+                                      " for audio streams.\n"
+                                      "Takes effect on the next connection.");
+
+                ImGui::TableNextColumn();
+
+                if (ImGui::Checkbox("##stream_socket_tuning", &cfg::state.stream_socket_tuning))
+                    socket_tuning::set_enabled(cfg::state.stream_socket_tuning);
+
+                /**********************
+                 * Icon memory budget *
+                 **********************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Icon memory (MiB)");
+                ImGui::SetItemTooltip("How much memory decoded station icons can use,"
+                                      " before the least recently shown are dropped.");
+
+                ImGui::TableNextColumn();
+
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                ImGui::Slider("##icon_memory_budget",
+                              cfg::state.icon_memory_budget,
+                              4u, 64u);
+
+                /*********************
+                 * Icon video budget *
+                 *********************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Icon video memory (MiB)");
+                ImGui::SetItemTooltip("How much video memory station icon textures can use.");
+
+                ImGui::TableNextColumn();
+
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                ImGui::Slider("##icon_video_budget",
+                              cfg::state.icon_video_budget,
+                              8u, 128u);
+
+                /************************
+                 * Player low watermark *
+                 ************************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Player low watermark (ms)");
+                ImGui::SetItemTooltip("Audio output starts once this much audio is buffered.\n"
+                                      "After underruns, the player buffers more, up to the"
+                                      " high watermark.");
 
                 ImGui::TableNextColumn();
 
                 ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
-                ImGui::Slider("##player_buffer_size",
-                              cfg::state.player_buffer_size,
-                              4u, 64u,
+                ImGui::Slider("##player_low_watermark",
+                              cfg::state.player_low_watermark,
+                              100u, 5000u,
                               "",
                               ImGuiSliderFlags_Logarithmic);
+                if (ImGui::IsItemEdited())
+                    cfg::state.player_high_watermark = std::max(cfg::state.player_high_watermark,
+                                                                cfg::state.player_low_watermark);
+
+                /*************************
+                 * Player high watermark *
+                 *************************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Player high watermark (ms)");
+                ImGui::SetItemTooltip("Decoding pauses while this much audio is buffered.");
+
+                ImGui::TableNextColumn();
+
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                ImGui::Slider("##player_high_watermark",
+                              cfg::state.player_high_watermark,
+                              100u, 5000u,
+                              "",
+                              ImGuiSliderFlags_Logarithmic);
+                if (ImGui::IsItemEdited())
+                    cfg::state.player_low_watermark = std::min(cfg::state.player_low_watermark,
+                                                               cfg::state.player_high_watermark);
+
+                /******************
+                 * Player standby *
+                 ******************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Pre-connect next station");
+                ImGui::SetItemTooltip("Connect and buffer the next favorite, or a hovered station,"
+                                      " in the background, for quicker switching.");
+
+                ImGui::TableNextColumn();
+
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                ImGui::Checkbox("##player_standby", &cfg::state.player_standby);
+
+                /*************
+                 * Scan time *
+                 *************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Scan time");
+                ImGui::SetItemTooltip("How long each station plays when scanning, in seconds.");
+
+                ImGui::TableNextColumn();
+
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                ImGui::Slider("##scan_seconds",
+                              cfg::state.scan_seconds,
+                              5u, 60u);
+
+                /*********************
+                 * Timeshift minutes *
+                 *********************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Timeshift (minutes)");
+                ImGui::SetItemTooltip("How much of the stream is kept, to pause and"
+                                      " rewind live radio.\n"
+                                      "About 1 MiB per minute, at 128 kbps; 0 disables it.");
+
+                ImGui::TableNextColumn();
+
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                ImGui::Slider("##timeshift_minutes",
+                              cfg::state.timeshift_minutes,
+                              0u, 30u);
 
                 /***********************
                  * Player history limit *
@@ -287,6 +559,23 @@ namespace SettingsTab {
                             1.0f / 8.0f,
                             {0u}, {600u});
 
+                /**************
+                 * Visualizer *
+                 **************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Visualizer");
+                ImGui::SetItemTooltip("Show a spectrum analyzer in the player, and in the screen saver.");
+
+                ImGui::TableNextColumn();
+
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                ImGui::Checkbox("##show_visualizer", &cfg::state.show_visualizer);
+
                 /*****************
                  * Disable swkbd *
                  *****************/
@@ -321,6 +610,91 @@ namespace SettingsTab {
                 ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
                 ImGui::Checkbox("##send_clicks", &cfg::state.send_clicks);
 
+                /*****************
+                 * Show profiler *
+                 *****************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Show profiler");
+                ImGui::SetItemTooltip("Show how long each part of the frame takes.");
+
+                ImGui::TableNextColumn();
+
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                ImGui::Checkbox("##show_profiler", &cfg::state.show_profiler);
+
+                /***********
+                 * Tracing *
+                 ***********/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Record trace");
+                ImGui::SetItemTooltip("Record what each thread is doing, to open in"
+                                      " chrome://tracing or Perfetto.\n"
+                                      "Saved as \"trace.json\" on exit, or with the button.");
+
+                ImGui::TableNextColumn();
+
+                if (ImGui::Checkbox("##tracing", &cfg::state.tracing))
+                    tracer::set_enabled(cfg::state.tracing);
+                ImGui::SameLine();
+                if (ImGui::Button("Save")) {
+                    const auto path = App::get_config_path() / "trace.json";
+                    try {
+                        tracer::export_chrome_json(path);
+                        cout << "Saved trace to " << path << endl;
+                    }
+                    catch (std::exception& e) {
+                        cout << "ERROR: failed to save trace: " << e.what() << endl;
+                    }
+                }
+
+                /**************
+                 * Show stats *
+                 **************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Show stats");
+                ImGui::SetItemTooltip("Show the network, audio, icon and memory counters.");
+
+                ImGui::TableNextColumn();
+
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                ImGui::Checkbox("##show_stats", &cfg::state.show_stats);
+
+                /**********************
+                 * Stats log interval *
+                 **********************/
+
+                ImGui::TableNextRow();
+
+                ImGui::TableNextColumn();
+
+                ImGui::AlignTextToFramePadding();
+                UI::show_label("Log stats every (s)");
+                ImGui::SetItemTooltip("Write all the stats to the log periodically.\n"
+                                      "Set to 0 to disable.");
+
+                ImGui::TableNextColumn();
+
+                ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+                ImGui::Drag("##stats_log_interval"s,
+                            cfg::state.stats_log_interval,
+                            1.0f / 8.0f,
+                            {0u}, {3600u});
+
 
                 /*******************
                  * End of settings *
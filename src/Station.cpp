@@ -6,6 +6,8 @@
  */
 
 #include <concepts>
+#include <stdexcept>
+#include <string>
 #include <utility>
 
 #include <glaze/json.hpp>
@@ -13,6 +15,96 @@
 
 #include "Station.hpp"
 
+#include "json_array_splitter.hpp"
+#include "memory_accounting.hpp"
+
+
+namespace {
+
+    // Same layout as Station, but (de)serialized with the radio-browser.info field names.
+    struct RadioBrowserStation : Station {};
+
+
+    std::size_t
+    heap_size(const std::string& s)
+        noexcept
+    {
+        // Note: short strings are stored inside the object.
+        static const std::size_t sso_capacity = std::string{}.capacity();
+        return s.capacity() > sso_capacity ? s.capacity() + 1 : 0;
+    }
+
+
+    std::size_t
+    heap_size(const Station& st)
+        noexcept
+    {
+        // Note: interned strings are shared, only the vectors are counted.
+        return heap_size(st.stationuuid)
+            + heap_size(st.name)
+            + heap_size(st.url)
+            + heap_size(st.url_resolved)
+            + heap_size(st.homepage)
+            + heap_size(st.favicon)
+            + st.language.capacity() * sizeof(interned_string)
+            + st.tags.capacity() * sizeof(interned_string);
+    }
+
+
+    // A result set, charged to memory_accounting::tag::stations while it's alive.
+    struct station_slab {
+
+        std::vector<RadioBrowserStation> entries;
+        std::size_t accounted = 0;
+
+        station_slab() = default;
+
+        station_slab(const station_slab&) = delete;
+
+        ~station_slab()
+        {
+            memory_accounting::get(memory_accounting::tag::stations).sub(accounted);
+        }
+
+        // Note: measured after parsing, since the strings are allocated by glaze.
+        void
+        update_accounting()
+            noexcept
+        {
+            std::size_t bytes = entries.capacity() * sizeof(RadioBrowserStation);
+            for (auto& st : entries)
+                bytes += heap_size(st);
+            auto& acc = memory_accounting::get(memory_accounting::tag::stations);
+            acc.sub(accounted);
+            acc.add(bytes);
+            accounted = bytes;
+        }
+
+    }; // struct station_slab
+
+} // namespace
+
+
+template<>
+struct glz::meta<RadioBrowserStation> {
+    using T = RadioBrowserStation;
+    static constexpr
+    auto value = object("stationuuid",  &T::stationuuid,
+                        "name",         &T::name,
+                        "url",          &T::url,
+                        "url_resolved", &T::url_resolved,
+                        "homepage",     &T::homepage,
+                        "favicon",      &T::favicon,
+                        "countrycode",  &T::countrycode,
+                        "language",     &T::language,
+                        "tags",         &T::tags,
+                        "votes",        &T::votes,
+                        "clickcount",   &T::click_count,
+                        "clicktrend",   &T::click_trend,
+                        "bitrate",      &T::bitrate,
+                        "codec",        &T::codec);
+};
+
 
 Station
 Station::from_radio_browser(const RadioBrowserAPI::Station& st)
@@ -38,6 +130,107 @@ Station::from_radio_browser(const RadioBrowserAPI::Station& st)
 }
 
 
+void
+Station::from_radio_browser_json(const std::string& json,
+                                 station_arena& arena,
+                                 std::vector<std::shared_ptr<Station>>& stations,
+                                 std::size_t limit)
+{
+    constexpr glz::opts options{ .error_on_unknown_keys = false };
+
+    // Drop our own references first, so the slab can be reused.
+    stations.clear();
+    if (!arena.slab || arena.in_use())
+        arena.slab = std::make_shared<station_slab>();
+    auto slab = std::static_pointer_cast<station_slab>(arena.slab);
+    // Note: this slab has no room reserved, it can't be appended to.
+    arena.page_limit = 0;
+
+    try {
+        // Note: the elements past the limit are not parsed at all.
+        json_array_splitter splitter;
+        std::string buffer; // glaze wants a null-terminated buffer
+        std::size_t count = 0;
+        while (count < limit) {
+            auto element = splitter.next(json);
+            if (!element)
+                break;
+            if (count == slab->entries.size())
+                slab->entries.emplace_back();
+            buffer.assign(*element);
+            // Note: glaze parses into the existing elements, reusing their strings. The
+            // radio-browser.info API always sends every field, so nothing stale is left.
+            glz::ex::read<options>(slab->entries[count], buffer);
+            ++count;
+        }
+        if (count < limit && !splitter.is_closed())
+            throw std::runtime_error{"not a complete JSON array"};
+        slab->entries.resize(count);
+    }
+    catch (...) {
+        // A partially parsed slab is useless.
+        slab->entries.clear();
+        slab->update_accounting();
+        throw;
+    }
+    slab->update_accounting();
+
+    stations.reserve(slab->entries.size());
+    for (RadioBrowserStation& st : slab->entries)
+        stations.emplace_back(slab, static_cast<Station*>(&st));
+}
+
+
+void
+Station::begin_radio_browser_page(station_arena& arena,
+                                  std::vector<std::shared_ptr<Station>>& stations,
+                                  std::size_t limit)
+{
+    stations.clear();
+    if (!arena.slab || arena.in_use())
+        arena.slab = std::make_shared<station_slab>();
+    auto slab = std::static_pointer_cast<station_slab>(arena.slab);
+    slab->entries.reserve(limit);
+    stations.reserve(limit);
+    arena.page_limit = limit;
+}
+
+
+void
+Station::append_radio_browser_json(std::string_view json,
+                                   station_arena& arena,
+                                   std::vector<std::shared_ptr<Station>>& stations)
+{
+    constexpr glz::opts options{ .error_on_unknown_keys = false };
+
+    const std::size_t index = stations.size();
+    // Note: past the reserved room, the slab would move the stations already handed out.
+    if (index >= arena.page_limit)
+        return;
+    auto slab = std::static_pointer_cast<station_slab>(arena.slab);
+    if (index == slab->entries.size())
+        slab->entries.emplace_back();
+
+    // Note: glaze wants a null-terminated buffer; this only runs on the main thread.
+    static std::string buffer;
+    buffer.assign(json);
+    // Note: on failure, the entry is left half-parsed, but it's not handed out.
+    glz::ex::read<options>(slab->entries[index], buffer);
+    stations.emplace_back(slab, static_cast<Station*>(&slab->entries[index]));
+}
+
+
+void
+Station::end_radio_browser_page(station_arena& arena,
+                                const std::vector<std::shared_ptr<Station>>& stations)
+{
+    auto slab = std::static_pointer_cast<station_slab>(arena.slab);
+    // Entries left over from a bigger page are dropped.
+    slab->entries.resize(stations.size());
+    slab->update_accounting();
+}
+
+
 bool
 operator ==(const Station& a,
             const Station& b)
@@ -8,7 +8,9 @@
 #ifndef STATION_HPP
 #define STATION_HPP
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -17,7 +19,9 @@
 #include <glaze/core/meta.hpp>
 
 #include "csv_strings.hpp"
+#include "interned_string.hpp"
 #include "RadioBrowserAPI.hpp"
+#include "station_arena.hpp"
 
 
 struct Station {
@@ -28,7 +32,7 @@ struct Station {
     std::string url_resolved;
     std::string homepage;
     std::string favicon;
-    std::string countrycode;
+    interned_string countrycode;
 
     csv_strings language;
     csv_strings tags;
@@ -38,13 +42,55 @@ struct Station {
     std::uint64_t click_count = 0;
     int click_trend = 0;
     unsigned bitrate = 0;
-    std::string codec;
+    interned_string codec;
 
 
     static
     Station
     from_radio_browser(const RadioBrowserAPI::Station& st);
 
+
+    /*
+     * Parse a radio-browser.info station array directly into Station objects, ignoring
+     * fields Station doesn't have.
+     *
+     * The stations are stored in the arena's slab, which is reused if nobody else holds
+     * its stations anymore. The old contents of stations are released first.
+     */
+    static
+    void
+    from_radio_browser_json(const std::string& json,
+                            station_arena& arena,
+                            std::vector<std::shared_ptr<Station>>& stations,
+                            std::size_t limit);
+
+
+    /*
+     * The same, but one station object at a time, while the array is still arriving:
+     * begin_radio_browser_page() releases the old stations, append_radio_browser_json()
+     * adds one station (up to the limit given to begin), and end_radio_browser_page()
+     * trims the slab.
+     *
+     * Note: the slab reserves room for limit stations, and the arena keeps that limit
+     * until the next page, so the ones already added are never moved.
+     */
+    static
+    void
+    begin_radio_browser_page(station_arena& arena,
+                             std::vector<std::shared_ptr<Station>>& stations,
+                             std::size_t limit);
+
+    static
+    void
+    append_radio_browser_json(std::string_view json,
+                              station_arena& arena,
+                              std::vector<std::shared_ptr<Station>>& stations);
+
+    static
+    void
+    end_radio_browser_page(station_arena& arena,
+                           const std::vector<std::shared_ptr<Station>>& stations);
+
 }; // struct Station
 
 
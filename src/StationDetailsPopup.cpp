@@ -8,6 +8,7 @@
 #include <iostream>
 #include <optional>
 #include <stdexcept>
+#include <utility>              // move()
 
 #include <imgui.h>
 #include <imgui_raii.h>
@@ -19,6 +20,7 @@
 #include "RadioBrowserAPI.hpp"
 #include "rest.hpp"
 #include "Station.hpp"
+#include "StationIndex.hpp"
 #include "tracer.hpp"
 #include "UI.hpp"
 
@@ -87,6 +89,16 @@ namespace StationDetailsPopup {
         reset();
         popup_queued = true;
         request_uuid = uuid;
+
+        // Note: the local index has the details already, no need to ask the server.
+        if (StationIndex::is_ready()) {
+            if (auto st = StationIndex::find(uuid)) {
+                result = std::move(st);
+                state = State::done;
+                return;
+            }
+        }
+
         state = State::fetching;
 
         RadioBrowserAPI::get_station(
@@ -163,7 +175,7 @@ namespace StationDetailsPopup {
                     UI::show_link_row("url_resolved", st.url_resolved);
                     UI::show_link_row("homepage",     st.homepage);
                     UI::show_link_row("favicon",      st.favicon);
-                    UI::show_info_row("countrycode",  st.countrycode);
+                    UI::show_info_row("countrycode",  st.countrycode.str());
                     UI::show_info_row("language",     st.language);
                     UI::show_info_row("tags",         st.tags);
                     UI::show_info_row("stationuuid",  st.stationuuid);
@@ -172,7 +184,7 @@ namespace StationDetailsPopup {
                     UI::show_info_row("clickcount",   st.click_count);
                     UI::show_info_row("clicktrend",   st.click_trend);
                     UI::show_info_row("bitrate",      st.bitrate);
-                    UI::show_info_row("codec",        st.codec);
+                    UI::show_info_row("codec",        st.codec.str());
 
                 } // fields_table
                 break;
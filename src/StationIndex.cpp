@@ -0,0 +1,1375 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>               // isalnum(), tolower()
+#include <charconv>             // from_chars()
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>              // memcpy()
+#include <ctime>                // time()
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>             // back_inserter()
+#include <mutex>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include <glaze/json.hpp>
+#include <glaze/exceptions/json_exceptions.hpp>
+
+#include "StationIndex.hpp"
+
+#include "csv_strings.hpp"
+#include "mapped_file.hpp"
+#include "memory_accounting.hpp"
+#include "read_mostly.hpp"
+#include "rest.hpp"
+#include "scheduler.hpp"
+#include "station_arena.hpp"
+#include "thread_policy.hpp"
+#include "thread_safe.hpp"
+#include "tracer.hpp"
+
+
+using std::cout;
+using std::endl;
+
+using namespace std::literals;
+
+using RBOrder = RadioBrowserAPI::SearchStationParams::Order;
+
+
+namespace StationIndex {
+
+    namespace {
+
+        const std::uint32_t file_magic = 0x52534958; // "RSIX"
+        const std::uint32_t file_version = 3;
+
+        // How often to ask the server for changes.
+        const auto update_interval = 6h;
+
+        // How long to wait before trying again, after a failed update.
+        const auto retry_interval = 10min;
+
+        // Stations per request.
+        const unsigned page_size = 5000;
+
+
+        /*
+         * The hot columns are the ones needed to search, sort and show the lists; these
+         * are offsets into the string pool.
+         */
+        enum StrColumn : unsigned {
+            col_name,
+            col_tags,
+            col_countrycode,
+            col_language,
+            col_codec,
+        };
+
+        const unsigned num_str_columns = col_codec + 1;
+
+
+        // Note: votes and clickcount are 64 bits, split into two columns.
+        enum NumColumn : unsigned {
+            col_bitrate,
+            col_votes,
+            col_clickcount,
+            col_clicktrend,
+            col_https,          // 1 if url_resolved is HTTPS
+            col_votes_high,
+            col_clickcount_high,
+        };
+
+        const unsigned num_num_columns = col_clickcount_high + 1;
+
+
+        // The rest of a station, only read for the stations being shown.
+        struct ColdFields {
+            std::string stationuuid;
+            std::string url;
+            std::string url_resolved;
+            std::string homepage;
+            std::string favicon;
+        };
+
+
+        /*
+         * File layout, all in native byte order:
+         *   - header
+         *   - num_str_columns arrays of count offsets
+         *   - num_num_columns arrays of count values
+         *   - count + 1 offsets of the cold records
+         *   - count (hash, row) pairs, sorted, to find a stationuuid
+         *   - pool of NUL-terminated strings
+         *   - cold section: for each row, its ColdFields as NUL-terminated strings
+         *
+         * Everything before the cold section is the hot part, that stays in memory.
+         */
+        struct Header {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint32_t count;
+            std::uint32_t pool_size;
+            std::int64_t  updated;     // time_t of the last update
+            std::uint32_t last_change; // offset of the last changeuuid, in the pool
+            std::uint32_t cold_size;
+        };
+
+        static_assert(sizeof(Header) % sizeof(std::uint32_t) == 0);
+
+        const std::size_t header_words = sizeof(Header) / sizeof(std::uint32_t);
+
+
+        std::size_t
+        words_for(std::size_t bytes)
+            noexcept
+        {
+            return (bytes + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t);
+        }
+
+
+        // Where each section starts, in words.
+        struct Layout {
+            std::size_t cold_offsets;
+            std::size_t uuid_table;
+            std::size_t pool;
+            std::size_t cold;
+
+            explicit
+            Layout(const Header& header)
+                noexcept
+            {
+                const std::size_t count = header.count;
+                cold_offsets = header_words + count * (num_str_columns + num_num_columns);
+                uuid_table = cold_offsets + count + 1;
+                pool = uuid_table + 2 * count;
+                cold = pool + words_for(header.pool_size);
+            }
+        };
+
+
+        // FNV-1a
+        std::uint32_t
+        hash_uuid(std::string_view uuid)
+            noexcept
+        {
+            std::uint32_t h = 2166136261u;
+            for (unsigned char c : uuid) {
+                h ^= c;
+                h *= 16777619u;
+            }
+            return h;
+        }
+
+
+        /*
+         * Inverted index of the trigrams in one column, for substring and fuzzy matching
+         * without scanning every row.
+         *
+         * Text is folded, and everything that isn't a letter or digit becomes a single
+         * space. Each posting list is a sorted list of rows, delta-encoded as varints.
+         */
+        struct Trigrams {
+
+            std::uint32_t rows = 0;
+            std::vector<std::uint32_t> keys;   // sorted
+            std::vector<std::uint32_t> starts; // keys.size() + 1 offsets into postings
+            std::vector<std::uint8_t> postings;
+
+            void
+            build(std::uint32_t count,
+                  const std::function<std::string_view(std::uint32_t)>& get_text);
+
+            /*
+             * Find the rows that can contain query; when fuzzy, allow a few trigrams to be
+             * missing, to tolerate typos. Empty if query is too short to use trigrams.
+             */
+            std::optional<std::vector<std::uint32_t>>
+            find(std::string_view query,
+                 bool fuzzy)
+                const;
+
+            std::size_t
+            memory_size()
+                const noexcept;
+
+        }; // struct Trigrams
+
+
+        // Read-only view over the index file.
+        struct Index {
+
+            const std::filesystem::path filename;
+            std::unique_ptr<mapped_file> file;
+            std::span<const std::uint32_t> words; // the hot part
+            Header header;
+            const char* pool = nullptr;
+            Trigrams name_trigrams;
+            Trigrams tag_trigrams;
+            // What's charged to memory_accounting::tag::station_index.
+            std::size_t accounted = 0;
+            // Set when a newer generation replaces this one; the file is deleted once
+            // nothing uses it.
+            mutable std::atomic<bool> obsolete = false;
+
+            explicit
+            Index(const std::filesystem::path& filename) :
+                filename{filename},
+                file{std::make_unique<mapped_file>(filename)}
+            {
+                const auto prefix = file->load_prefix(header_words);
+                std::memcpy(&header, prefix.data(), sizeof header);
+                if (header.magic != file_magic || header.version != file_version)
+                    throw std::runtime_error{"station index has the wrong version"};
+                if (!header.pool_size)
+                    throw std::runtime_error{"station index is empty"};
+                const Layout layout{header};
+                if (layout.cold * sizeof(std::uint32_t) + header.cold_size > file->size())
+                    throw std::runtime_error{"station index is truncated"};
+                words = file->load_prefix(layout.cold);
+                pool = reinterpret_cast<const char*>(words.data() + layout.pool);
+                if (pool[header.pool_size - 1] != '\0')
+                    throw std::runtime_error{"station index is corrupted"};
+                if (words[layout.cold_offsets + header.count] != header.cold_size)
+                    throw std::runtime_error{"station index is corrupted"};
+            }
+
+            Index(const Index&) = delete;
+
+            ~Index()
+            {
+                using memory_accounting::tag;
+                memory_accounting::get(tag::station_index).sub(accounted);
+                if (obsolete.load()) {
+                    // Note: closed first, an open file can't be deleted everywhere.
+                    file.reset();
+                    std::error_code ec;
+                    std::filesystem::remove(filename, ec);
+                }
+            }
+
+
+            std::uint32_t
+            size()
+                const noexcept
+            {
+                return header.count;
+            }
+
+
+            // Note: the cold section is not counted, only the stations shown are read.
+            std::size_t
+            memory_size()
+                const noexcept
+            {
+                return words.size() * sizeof(std::uint32_t)
+                     + name_trigrams.memory_size()
+                     + tag_trigrams.memory_size();
+            }
+
+
+            std::string_view
+            str(StrColumn col,
+                std::uint32_t row)
+                const noexcept
+            {
+                std::uint32_t offset = words[header_words + col * header.count + row];
+                if (offset >= header.pool_size)
+                    return {};
+                return pool + offset;
+            }
+
+
+            std::uint32_t
+            num(NumColumn col,
+                std::uint32_t row)
+                const noexcept
+            {
+                return words[header_words
+                             + (num_str_columns + col) * header.count
+                             + row];
+            }
+
+
+            std::uint64_t
+            num64(NumColumn low,
+                  NumColumn high,
+                  std::uint32_t row)
+                const noexcept
+            {
+                return std::uint64_t{num(high, row)} << 32 | num(low, row);
+            }
+
+
+            std::string_view
+            last_change()
+                const noexcept
+            {
+                if (header.last_change >= header.pool_size)
+                    return {};
+                return pool + header.last_change;
+            }
+
+
+            // The cold records of rows [first, last), as stored.
+            std::string
+            cold_records(std::uint32_t first,
+                         std::uint32_t last)
+                const
+            {
+                const Layout layout{header};
+                const std::uint32_t begin = words[layout.cold_offsets + first];
+                const std::uint32_t end = words[layout.cold_offsets + last];
+                if (begin > end || end > header.cold_size)
+                    throw std::runtime_error{"station index is corrupted"};
+                std::string result(end - begin, '\0');
+                file->read(layout.cold * sizeof(std::uint32_t) + begin, result);
+                return result;
+            }
+
+
+            ColdFields
+            cold(std::uint32_t row)
+                const;
+
+
+            // Rows whose stationuuid may be uuid; the hash can collide.
+            std::vector<std::uint32_t>
+            find_uuid(std::string_view uuid)
+                const
+            {
+                const Layout layout{header};
+                const std::uint32_t* table = words.data() + layout.uuid_table;
+                const std::uint32_t h = hash_uuid(uuid);
+                // Note: binary search over the pairs, by hash.
+                std::size_t lo = 0;
+                std::size_t hi = header.count;
+                while (lo < hi) {
+                    const std::size_t mid = lo + (hi - lo) / 2;
+                    if (table[2 * mid] < h)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+                std::vector<std::uint32_t> result;
+                for (std::size_t i = lo; i < header.count && table[2 * i] == h; ++i) {
+                    const std::uint32_t row = table[2 * i + 1];
+                    // Note: a corrupted table must not make fill() read past the columns.
+                    if (row < header.count)
+                        result.push_back(row);
+                }
+                return result;
+            }
+
+        }; // struct Index
+
+
+        // Splits one cold record into its fields.
+        ColdFields
+        parse_cold(std::string_view record)
+        {
+            ColdFields result;
+            for (auto* field : {&result.stationuuid,
+                                &result.url,
+                                &result.url_resolved,
+                                &result.homepage,
+                                &result.favicon}) {
+                const auto end = record.find('\0');
+                *field = record.substr(0, end);
+                if (end == std::string_view::npos)
+                    break;
+                record.remove_prefix(end + 1);
+            }
+            return result;
+        }
+
+
+        ColdFields
+        Index::cold(std::uint32_t row)
+            const
+        {
+            return parse_cold(cold_records(row, row + 1));
+        }
+
+
+        // One station, as sent by the server.
+        struct Record {
+            std::string   changeuuid;
+            std::string   stationuuid;
+            std::string   name;
+            std::string   url;
+            std::string   url_resolved;
+            std::string   homepage;
+            std::string   favicon;
+            std::string   tags;
+            std::string   countrycode;
+            std::string   language;
+            std::string   codec;
+            unsigned      bitrate     = 0;
+            std::uint64_t votes       = 0;
+            std::uint64_t clickcount  = 0;
+            int           clicktrend  = 0;
+            int           lastcheckok = 1;
+        };
+
+
+        std::filesystem::path index_filename;
+
+        // The newest generation on disk; only the worker thread touches it.
+        unsigned last_generation = 0;
+
+        // Note: searches never wait for a new index to be published.
+        read_mostly<Index> current;
+        thread_safe<std::string> status;
+        std::atomic_bool enabled = false;
+
+        std::jthread worker_thread;
+
+        // Main thread only.
+        std::vector<scheduler::task> searches;
+
+
+        constexpr glz::opts glz_options{ .error_on_unknown_keys = false };
+
+
+        char
+        fold(char c)
+            noexcept
+        {
+            return std::tolower(static_cast<unsigned char>(c));
+        }
+
+
+        bool
+        equal_folded(std::string_view a,
+                     std::string_view b)
+            noexcept
+        {
+            return std::ranges::equal(a, b, {}, fold, fold);
+        }
+
+
+        // Note: needle must be folded already.
+        bool
+        contains_folded(std::string_view haystack,
+                        std::string_view needle)
+            noexcept
+        {
+            return !std::ranges::search(haystack, needle, {}, fold).empty();
+        }
+
+
+        bool
+        less_folded(std::string_view a,
+                    std::string_view b)
+            noexcept
+        {
+            return std::ranges::lexicographical_compare(a, b, {}, fold, fold);
+        }
+
+
+        std::string
+        folded(std::string_view s)
+        {
+            std::string result(s.size(), '\0');
+            std::ranges::transform(s, result.begin(), fold);
+            return result;
+        }
+
+
+        // Note: needle must be folded already. Runs for every row, so it only compares
+        // views of tags, like csv_strings would split them.
+        bool
+        has_tag_folded(std::string_view tags,
+                       std::string_view needle)
+        {
+            while (!tags.empty()) {
+                auto comma = tags.find(',');
+                if (equal_folded(tags.substr(0, comma), needle))
+                    return true;
+                if (comma == std::string_view::npos)
+                    break;
+                tags.remove_prefix(comma + 1);
+            }
+            return false;
+        }
+
+
+        std::string
+        normalized(std::string_view s)
+        {
+            std::string result;
+            result.reserve(s.size());
+            for (char c : s) {
+                // Note: non-ASCII bytes are kept, so UTF-8 text still works.
+                unsigned char u = c;
+                if (u >= 0x80 || std::isalnum(u))
+                    result.push_back(fold(c));
+                else if (!result.empty() && result.back() != ' ')
+                    result.push_back(' ');
+            }
+            if (!result.empty() && result.back() == ' ')
+                result.pop_back();
+            return result;
+        }
+
+
+        // Sorted, unique trigram keys in text.
+        std::vector<std::uint32_t>
+        get_trigrams(std::string_view text)
+        {
+            const std::string norm = normalized(text);
+            std::vector<std::uint32_t> result;
+            for (std::size_t i = 0; i + 3 <= norm.size(); ++i)
+                result.push_back(std::uint32_t{static_cast<unsigned char>(norm[i])} << 16
+                                 | std::uint32_t{static_cast<unsigned char>(norm[i + 1])} << 8
+                                 | std::uint32_t{static_cast<unsigned char>(norm[i + 2])});
+            std::ranges::sort(result);
+            auto [first, last] = std::ranges::unique(result);
+            result.erase(first, last);
+            return result;
+        }
+
+
+        void
+        Trigrams::build(std::uint32_t count,
+                        const std::function<std::string_view(std::uint32_t)>& get_text)
+        {
+            rows = count;
+
+            // (key, row) pairs, so sorting them groups the rows by key
+            std::vector<std::uint64_t> pairs;
+            for (std::uint32_t row = 0; row < count; ++row)
+                for (auto key : get_trigrams(get_text(row)))
+                    pairs.push_back(std::uint64_t{key} << 32 | row);
+            std::ranges::sort(pairs);
+
+            keys.clear();
+            starts.clear();
+            postings.clear();
+            std::uint32_t prev_row = 0;
+            for (auto p : pairs) {
+                const std::uint32_t key = p >> 32;
+                const std::uint32_t row = p & 0xffffffffu;
+                if (keys.empty() || keys.back() != key) {
+                    keys.push_back(key);
+                    starts.push_back(postings.size());
+                    prev_row = 0;
+                }
+                std::uint32_t delta = row - prev_row;
+                prev_row = row;
+                while (delta >= 0x80) {
+                    postings.push_back(0x80 | (delta & 0x7f));
+                    delta >>= 7;
+                }
+                postings.push_back(delta);
+            }
+            starts.push_back(postings.size());
+
+            keys.shrink_to_fit();
+            starts.shrink_to_fit();
+            postings.shrink_to_fit();
+        }
+
+
+        std::optional<std::vector<std::uint32_t>>
+        Trigrams::find(std::string_view query,
+                       bool fuzzy)
+            const
+        {
+            const auto query_keys = get_trigrams(query);
+            if (query_keys.empty())
+                return {};
+
+            // Each typo removes up to 3 trigrams; short queries must match exactly.
+            const std::size_t total = query_keys.size();
+            const std::size_t needed = fuzzy && total >= 4
+                                     ? std::max<std::size_t>(2, total - 3)
+                                     : total;
+
+            std::vector<std::uint8_t> hits(rows);
+            std::size_t missing = 0;
+            for (auto key : query_keys) {
+                auto it = std::ranges::lower_bound(keys, key);
+                if (it == keys.end() || *it != key) {
+                    if (++missing > total - needed)
+                        return std::vector<std::uint32_t>{};
+                    continue;
+                }
+                const std::size_t k = it - keys.begin();
+                std::uint32_t row = 0;
+                std::uint32_t delta = 0;
+                unsigned shift = 0;
+                for (std::size_t i = starts[k]; i < starts[k + 1]; ++i) {
+                    delta |= std::uint32_t{postings[i] & 0x7fu} << shift;
+                    if (postings[i] & 0x80) {
+                        shift += 7;
+                        continue;
+                    }
+                    row += delta;
+                    delta = 0;
+                    shift = 0;
+                    if (hits[row] < 255)
+                        ++hits[row];
+                }
+            }
+
+            std::vector<std::uint32_t> result;
+            for (std::uint32_t row = 0; row < rows; ++row)
+                if (hits[row] >= needed)
+                    result.push_back(row);
+            return result;
+        }
+
+
+        std::size_t
+        Trigrams::memory_size()
+            const noexcept
+        {
+            return keys.size() * sizeof(std::uint32_t)
+                 + starts.size() * sizeof(std::uint32_t)
+                 + postings.size();
+        }
+
+
+        std::shared_ptr<const Index>
+        make_index(const std::filesystem::path& filename)
+        {
+            auto idx = std::make_shared<Index>(filename);
+            idx->name_trigrams.build(idx->size(),
+                                     [&idx](std::uint32_t row)
+                                     {
+                                         return idx->str(col_name, row);
+                                     });
+            idx->tag_trigrams.build(idx->size(),
+                                    [&idx](std::uint32_t row)
+                                    {
+                                        return idx->str(col_tags, row);
+                                    });
+            idx->accounted = idx->memory_size();
+            memory_accounting::get(memory_accounting::tag::station_index).add(idx->accounted);
+            return idx;
+        }
+
+
+        std::vector<std::uint32_t>
+        build(const std::vector<Record>& records,
+              std::string_view last_change)
+        {
+            const std::uint32_t count = records.size();
+            const std::size_t arrays_words = std::size_t{count}
+                                           * (num_str_columns + num_num_columns);
+
+            std::string pool;
+            // Many values repeat (country codes, codecs, languages), store them only once.
+            std::unordered_map<std::string, std::uint32_t> interned;
+            auto intern = [&](const std::string& s) -> std::uint32_t
+            {
+                auto [it, inserted] = interned.try_emplace(s, pool.size());
+                if (inserted) {
+                    pool.append(s);
+                    pool.push_back('\0');
+                }
+                return it->second;
+            };
+
+            std::vector<std::uint32_t> arrays(arrays_words);
+            auto set_str = [&](StrColumn col, std::uint32_t row, const std::string& s)
+            {
+                arrays[col * count + row] = intern(s);
+            };
+            auto set_num = [&](NumColumn col, std::uint32_t row, std::uint32_t value)
+            {
+                arrays[(num_str_columns + col) * count + row] = value;
+            };
+            auto set_num64 = [&](NumColumn low,
+                                 NumColumn high,
+                                 std::uint32_t row,
+                                 std::uint64_t value)
+            {
+                set_num(low, row, value & 0xffffffffu);
+                set_num(high, row, value >> 32);
+            };
+
+            std::string cold;
+            std::vector<std::uint32_t> cold_offsets;
+            cold_offsets.reserve(count + 1);
+            auto add_cold = [&cold](const std::string& s)
+            {
+                cold.append(s);
+                cold.push_back('\0');
+            };
+
+            std::vector<std::uint64_t> uuid_table;
+            uuid_table.reserve(count);
+
+            for (std::uint32_t row = 0; row < count; ++row) {
+                const auto& r = records[row];
+                set_str(col_name,         row, r.name);
+                set_str(col_tags,         row, r.tags);
+                set_str(col_countrycode,  row, r.countrycode);
+                set_str(col_language,     row, r.language);
+                set_str(col_codec,        row, r.codec);
+                set_num(col_bitrate,      row, r.bitrate);
+                set_num64(col_votes,      col_votes_high,      row, r.votes);
+                set_num64(col_clickcount, col_clickcount_high, row, r.clickcount);
+                set_num(col_clicktrend,   row, static_cast<std::uint32_t>(r.clicktrend));
+                set_num(col_https,        row, r.url_resolved.starts_with("https:"));
+
+                cold_offsets.push_back(cold.size());
+                add_cold(r.stationuuid);
+                add_cold(r.url);
+                add_cold(r.url_resolved);
+                add_cold(r.homepage);
+                add_cold(r.favicon);
+
+                uuid_table.push_back(std::uint64_t{hash_uuid(r.stationuuid)} << 32 | row);
+            }
+            cold_offsets.push_back(cold.size());
+            std::ranges::sort(uuid_table);
+
+            Header header{
+                .magic       = file_magic,
+                .version     = file_version,
+                .count       = count,
+                .pool_size   = 0,
+                .updated     = std::time(nullptr),
+                .last_change = intern(std::string{last_change}),
+                .cold_size   = static_cast<std::uint32_t>(cold.size()),
+            };
+            header.pool_size = pool.size();
+
+            const Layout layout{header};
+            std::vector<std::uint32_t> words(layout.cold + words_for(cold.size()));
+            std::memcpy(words.data(), &header, sizeof header);
+            std::ranges::copy(arrays, words.begin() + header_words);
+            std::ranges::copy(cold_offsets, words.begin() + layout.cold_offsets);
+            for (std::size_t i = 0; i < uuid_table.size(); ++i) {
+                words[layout.uuid_table + 2 * i] = uuid_table[i] >> 32;
+                words[layout.uuid_table + 2 * i + 1] = uuid_table[i] & 0xffffffffu;
+            }
+            std::memcpy(words.data() + layout.pool, pool.data(), pool.size());
+            std::memcpy(words.data() + layout.cold, cold.data(), cold.size());
+            return words;
+        }
+
+
+        std::vector<Record>
+        to_records(const Index& idx)
+        {
+            // Note: the whole cold section is read at once, not one record at a time.
+            const std::string cold = idx.cold_records(0, idx.size());
+            const Layout layout{idx.header};
+            const std::uint32_t* cold_offsets = idx.words.data() + layout.cold_offsets;
+
+            std::vector<Record> result(idx.size());
+            for (std::uint32_t row = 0; row < idx.size(); ++row) {
+                auto& r = result[row];
+                auto c = parse_cold(std::string_view{cold}.substr(cold_offsets[row],
+                                                                   cold_offsets[row + 1]
+                                                                   - cold_offsets[row]));
+                r.stationuuid  = std::move(c.stationuuid);
+                r.name         = idx.str(col_name,         row);
+                r.url          = std::move(c.url);
+                r.url_resolved = std::move(c.url_resolved);
+                r.homepage     = std::move(c.homepage);
+                r.favicon      = std::move(c.favicon);
+                r.tags         = idx.str(col_tags,         row);
+                r.countrycode  = idx.str(col_countrycode,  row);
+                r.language     = idx.str(col_language,     row);
+                r.codec        = idx.str(col_codec,        row);
+                r.bitrate      = idx.num(col_bitrate,      row);
+                r.votes        = idx.num64(col_votes,      col_votes_high,      row);
+                r.clickcount   = idx.num64(col_clickcount, col_clickcount_high, row);
+                r.clicktrend   = static_cast<int>(idx.num(col_clicktrend, row));
+            }
+            return result;
+        }
+
+
+        /*
+         * Every update is saved as a new generation, "stations.idx.<generation>", so the
+         * file in use is never replaced: on the Wii U and on Windows, a file that's open
+         * can't be renamed over.
+         */
+        std::filesystem::path
+        generation_filename(unsigned generation)
+        {
+            auto result = index_filename;
+            result += "." + std::to_string(generation);
+            return result;
+        }
+
+
+        // Load the newest generation, and delete the older ones.
+        std::shared_ptr<const Index>
+        load_file()
+        {
+            const std::string prefix = index_filename.filename().string() + ".";
+            std::vector<unsigned> generations;
+            std::error_code ec;
+            for (auto& entry : std::filesystem::directory_iterator{
+                                   index_filename.parent_path(), ec
+                               }) {
+                const std::string name = entry.path().filename().string();
+                if (!name.starts_with(prefix))
+                    continue;
+                const char* first = name.data() + prefix.size();
+                const char* last = name.data() + name.size();
+                unsigned generation;
+                auto [end, err] = std::from_chars(first, last, generation);
+                if (err == std::errc{} && end == last)
+                    generations.push_back(generation);
+            }
+            if (generations.empty())
+                return {};
+
+            std::ranges::sort(generations);
+            last_generation = generations.back();
+            generations.pop_back();
+            for (auto generation : generations)
+                std::filesystem::remove(generation_filename(generation), ec);
+
+            return make_index(generation_filename(last_generation));
+        }
+
+
+        std::filesystem::path
+        save_file(const std::vector<std::uint32_t>& words,
+                  unsigned generation)
+        {
+            auto tmp_filename = index_filename;
+            tmp_filename += ".tmp";
+            {
+                std::ofstream output{tmp_filename, std::ios::binary | std::ios::trunc};
+                output.write(reinterpret_cast<const char*>(words.data()),
+                             words.size() * sizeof(std::uint32_t));
+                if (!output)
+                    throw std::runtime_error{"could not write " + tmp_filename.string()};
+            }
+            auto filename = generation_filename(generation);
+            rename(tmp_filename, filename);
+            return filename;
+        }
+
+
+        std::vector<Record>
+        fetch(const std::string& endpoint,
+              const rest::get_params_t& params)
+        {
+            const std::string server = RadioBrowserAPI::get_server();
+            if (server.empty())
+                throw std::runtime_error{"not connected"};
+            std::vector<Record> result;
+            glz::ex::read<glz_options>(result,
+                                       rest::get_json_sync("http://" + server + endpoint,
+                                                           params));
+            return result;
+        }
+
+
+        // Download everything; the list is sorted by change, so the last one is the newest.
+        std::vector<Record>
+        fetch_all(std::stop_token token,
+                  std::string& last_change)
+        {
+            std::vector<Record> records;
+            while (!token.stop_requested()) {
+                auto page = fetch("/json/stations",
+                                  {
+                                      { "hidebroken", "true" },
+                                      { "order",      "changetimestamp" },
+                                      { "offset",     std::to_string(records.size()) },
+                                      { "limit",      std::to_string(page_size) },
+                                  });
+                if (!page.empty())
+                    last_change = page.back().changeuuid;
+                const bool last_page = page.size() < page_size;
+                std::ranges::move(page, std::back_inserter(records));
+                status.store("downloading (" + std::to_string(records.size()) + " stations)");
+                if (last_page)
+                    break;
+            }
+            return records;
+        }
+
+
+        // Apply the changes since last_change, return if there were any.
+        bool
+        fetch_changes(std::stop_token token,
+                      std::vector<Record>& records,
+                      std::string& last_change)
+        {
+            std::unordered_map<std::string, std::size_t> rows;
+            for (std::size_t i = 0; i < records.size(); ++i)
+                rows.emplace(records[i].stationuuid, i);
+
+            bool changed = false;
+            while (!token.stop_requested()) {
+                auto page = fetch("/json/stations/changed",
+                                  {
+                                      { "lastchangeuuid", last_change },
+                                      { "limit",          std::to_string(page_size) },
+                                  });
+                for (auto& r : page) {
+                    last_change = r.changeuuid;
+                    changed = true;
+                    if (auto it = rows.find(r.stationuuid); it != rows.end())
+                        records[it->second] = std::move(r);
+                    else {
+                        rows.emplace(r.stationuuid, records.size());
+                        records.push_back(std::move(r));
+                    }
+                }
+                if (page.size() < page_size)
+                    break;
+            }
+
+            // same as hidebroken
+            if (changed)
+                std::erase_if(records, [](const Record& r) { return !r.lastcheckok; });
+            return changed;
+        }
+
+
+        void
+        update(std::stop_token token)
+        {
+            auto old = current.load();
+            std::string last_change;
+            std::vector<Record> records;
+
+            if (old && !old->last_change().empty()) {
+                status.store("updating");
+                records = to_records(*old);
+                last_change = old->last_change();
+                // Note: even if nothing changed, it's rebuilt to store the new timestamp.
+                fetch_changes(token, records, last_change);
+            } else {
+                status.store("downloading");
+                records = fetch_all(token, last_change);
+            }
+
+            if (token.stop_requested())
+                return;
+
+            const unsigned generation = last_generation + 1;
+            auto filename = save_file(build(records, last_change), generation);
+            last_generation = generation;
+            current.store(make_index(filename));
+            // Note: the old file is deleted when the last search using it is done.
+            if (old)
+                old->obsolete.store(true);
+            status.store("ready");
+            cout << "StationIndex: " << records.size() << " stations" << endl;
+        }
+
+
+        void
+        worker_func(std::stop_token token)
+        {
+            tracer::set_thread_name("station index");
+            thread_policy::apply(thread_policy::role::background);
+            try {
+                if (!current.load()) {
+                    status.store("loading");
+                    current.store(load_file());
+                }
+                status.store(current.load() ? "ready" : "empty");
+            }
+            catch (std::exception& e) {
+                cout << "ERROR: StationIndex: failed to load index: " << e.what() << endl;
+            }
+
+            std::mutex mutex;
+            std::condition_variable_any cond;
+            while (!token.stop_requested()) {
+                auto idx = current.load();
+                auto delay = 1min;
+                const bool stale = !idx
+                    || std::time(nullptr) - idx->header.updated
+                       >= std::chrono::seconds{update_interval}.count();
+                if (stale && !RadioBrowserAPI::get_server().empty()) {
+                    try {
+                        update(token);
+                    }
+                    catch (std::exception& e) {
+                        cout << "ERROR: StationIndex: update failed: " << e.what() << endl;
+                        status.store("error: "s + e.what());
+                        delay = retry_interval;
+                    }
+                }
+
+                std::unique_lock lock{mutex};
+                cond.wait_for(lock, token, delay, [] { return false; });
+            }
+        }
+
+
+        // Decodes a whole station, including its cold fields.
+        void
+        fill(Station& st,
+             const Index& idx,
+             std::uint32_t row)
+        {
+            ColdFields cold = idx.cold(row);
+            st.stationuuid  = std::move(cold.stationuuid);
+            st.name         = idx.str(col_name, row);
+            st.url          = std::move(cold.url);
+            st.url_resolved = std::move(cold.url_resolved);
+            st.homepage     = std::move(cold.homepage);
+            st.favicon      = std::move(cold.favicon);
+            st.countrycode  = idx.str(col_countrycode, row);
+            st.language     = csv_strings(std::optional<std::string>{
+                                  std::string{idx.str(col_language, row)}});
+            st.tags         = csv_strings(std::optional<std::string>{
+                                  std::string{idx.str(col_tags, row)}});
+            st.votes        = idx.num64(col_votes,      col_votes_high,      row);
+            st.click_count  = idx.num64(col_clickcount, col_clickcount_high, row);
+            st.click_trend  = static_cast<int>(idx.num(col_clicktrend, row));
+            st.bitrate      = idx.num(col_bitrate,    row);
+            st.codec        = idx.str(col_codec,      row);
+        }
+
+    } // namespace
+
+
+    void
+    initialize(const std::filesystem::path& filename)
+    {
+        TRACE_FUNC;
+
+        index_filename = filename;
+        status.store("disabled");
+    }
+
+
+    void
+    finalize()
+    {
+        TRACE_FUNC;
+
+        set_enabled(false);
+        if (worker_thread.joinable())
+            worker_thread.join();
+        searches.clear();
+        current.store(nullptr);
+    }
+
+
+    void
+    set_enabled(bool enable)
+    {
+        if (enable == enabled)
+            return;
+        enabled = enable;
+
+        if (enable) {
+            // Note: the previous thread may still be finishing a request; the new one
+            // waits for it, so the UI thread doesn't.
+            worker_thread = std::jthread{
+                [old = std::move(worker_thread)](std::stop_token token) mutable
+                {
+                    if (old.joinable())
+                        old.join();
+                    worker_func(token);
+                }
+            };
+        } else {
+            worker_thread.request_stop();
+            status.store("disabled");
+        }
+    }
+
+
+    bool
+    is_ready()
+    {
+        return enabled && current.load();
+    }
+
+
+    stats
+    get_stats()
+    {
+        stats result;
+        result.status = status.load();
+        if (auto idx = current.load()) {
+            result.stations = idx->size();
+            result.bytes = idx->memory_size();
+        }
+        return result;
+    }
+
+
+    std::vector<std::shared_ptr<Station>>
+    search(const RadioBrowserAPI::SearchStationParams& params)
+    {
+        auto idx = current.load();
+        if (!idx)
+            return {};
+
+        const std::string name_query = folded(params.name.value_or(""));
+        const std::string tag_query = folded(params.tag.value_or(""));
+        const std::string language_query = folded(params.language.value_or(""));
+        const std::string countrycode_query = params.countrycode.value_or("");
+        const std::string codec_query = params.codec.value_or("");
+
+        // When fuzzy, the text fields were already matched by the trigrams.
+        auto matches = [&](std::uint32_t row,
+                           bool skip_name,
+                           bool skip_tag) -> bool
+        {
+            if (!name_query.empty() && !skip_name) {
+                auto s = idx->str(col_name, row);
+                if (params.nameExact.value_or(false)
+                    ? !equal_folded(s, name_query)
+                    : !contains_folded(s, name_query))
+                    return false;
+            }
+            if (!tag_query.empty() && !skip_tag) {
+                auto s = idx->str(col_tags, row);
+                if (params.tagExact.value_or(false)
+                    ? !has_tag_folded(s, tag_query)
+                    : !contains_folded(s, tag_query))
+                    return false;
+            }
+            if (!countrycode_query.empty()
+                && !equal_folded(idx->str(col_countrycode, row), countrycode_query))
+                return false;
+            if (!codec_query.empty()
+                && !equal_folded(idx->str(col_codec, row), codec_query))
+                return false;
+            if (!language_query.empty()
+                && !contains_folded(idx->str(col_language, row), language_query))
+                return false;
+            if (params.bitrateMin && idx->num(col_bitrate, row) < *params.bitrateMin)
+                return false;
+            if (params.bitrateMax && idx->num(col_bitrate, row) > *params.bitrateMax)
+                return false;
+            if (params.is_https && (idx->num(col_https, row) != 0) != *params.is_https)
+                return false;
+            return true;
+        };
+
+        auto scan = [&](bool fuzzy) -> std::vector<std::uint32_t>
+        {
+            // Narrow down the rows to check with the trigrams, when possible.
+            std::optional<std::vector<std::uint32_t>> candidates;
+            auto narrow = [&](const Trigrams& trigrams,
+                              const std::string& query) -> bool
+            {
+                auto found = trigrams.find(query, fuzzy);
+                if (!found)
+                    return false;
+                if (!candidates)
+                    candidates = std::move(found);
+                else {
+                    std::vector<std::uint32_t> both;
+                    std::ranges::set_intersection(*candidates, *found,
+                                                  std::back_inserter(both));
+                    *candidates = std::move(both);
+                }
+                return true;
+            };
+            const bool name_narrowed = !name_query.empty()
+                                     && narrow(idx->name_trigrams, name_query);
+            const bool tag_narrowed = !tag_query.empty()
+                                    && narrow(idx->tag_trigrams, tag_query);
+
+            std::vector<std::uint32_t> result;
+            auto check = [&](std::uint32_t row)
+            {
+                if (matches(row, fuzzy && name_narrowed, fuzzy && tag_narrowed))
+                    result.push_back(row);
+            };
+            if (candidates)
+                std::ranges::for_each(*candidates, check);
+            else
+                for (std::uint32_t row = 0; row < idx->size(); ++row)
+                    check(row);
+            return result;
+        };
+
+        auto rows = scan(false);
+        // Nothing matched exactly, try to tolerate typos.
+        if (rows.empty()
+            && (!name_query.empty() || !tag_query.empty())
+            && !params.nameExact.value_or(false)
+            && !params.tagExact.value_or(false))
+            rows = scan(true);
+
+        // Note: each key is read once per row, not on every comparison.
+        const bool reverse = params.reverse.value_or(false);
+        auto sort_by = [&rows, reverse](auto key_of, auto less)
+        {
+            using key_type = decltype(key_of(std::uint32_t{}));
+            std::vector<std::pair<key_type, std::uint32_t>> keyed;
+            keyed.reserve(rows.size());
+            for (auto row : rows)
+                keyed.emplace_back(key_of(row), row);
+            std::ranges::stable_sort(keyed,
+                                     [&less, reverse](const auto& a, const auto& b)
+                                     {
+                                         return reverse
+                                             ? less(b.first, a.first)
+                                             : less(a.first, b.first);
+                                     });
+            for (std::size_t i = 0; i < keyed.size(); ++i)
+                rows[i] = keyed[i].second;
+        };
+        auto by_str = [&idx, &sort_by](StrColumn col)
+        {
+            sort_by([&idx, col](std::uint32_t row) { return idx->str(col, row); },
+                    less_folded);
+        };
+        auto by_cold = [&idx, &sort_by](std::string ColdFields::* field)
+        {
+            sort_by([&idx, field](std::uint32_t row)
+                    {
+                        return std::move(idx->cold(row).*field);
+                    },
+                    less_folded);
+        };
+        auto by_num = [&idx, &sort_by](NumColumn col)
+        {
+            sort_by([&idx, col](std::uint32_t row) { return idx->num(col, row); },
+                    std::less{});
+        };
+        auto by_num64 = [&idx, &sort_by](NumColumn low, NumColumn high)
+        {
+            sort_by([&idx, low, high](std::uint32_t row)
+                    {
+                        return idx->num64(low, high, row);
+                    },
+                    std::less{});
+        };
+
+        switch (params.order.value_or(RBOrder::name)) {
+            using enum RBOrder;
+            case url:
+                by_cold(&ColdFields::url);
+                break;
+            case homepage:
+                by_cold(&ColdFields::homepage);
+                break;
+            case favicon:
+                by_cold(&ColdFields::favicon);
+                break;
+            case tags:
+                by_str(col_tags);
+                break;
+            case country:
+                // Note: only the code is stored, not the country name.
+                by_str(col_countrycode);
+                break;
+            case language:
+                by_str(col_language);
+                break;
+            case votes:
+                by_num64(col_votes, col_votes_high);
+                break;
+            case codec:
+                by_str(col_codec);
+                break;
+            case bitrate:
+                by_num(col_bitrate);
+                break;
+            case clickcount:
+                by_num64(col_clickcount, col_clickcount_high);
+                break;
+            case clicktrend:
+                sort_by([&idx](std::uint32_t row)
+                        {
+                            return static_cast<int>(idx->num(col_clicktrend, row));
+                        },
+                        std::less{});
+                break;
+            case random:
+                std::ranges::shuffle(rows, std::mt19937{std::random_device{}()});
+                break;
+            default:
+                by_str(col_name);
+                break;
+        }
+
+        const std::size_t offset = std::min<std::size_t>(params.offset.value_or(0),
+                                                         rows.size());
+        const std::size_t count = std::min<std::size_t>(params.limit.value_or(rows.size()),
+                                                        rows.size() - offset);
+
+        // Note: one allocation for the whole page.
+        auto result = station_arena::make_page(count);
+        auto next = result.begin();
+        for (auto row : std::span{rows}.subspan(offset, count))
+            fill(**next++, *idx, row);
+        return result;
+    }
+
+
+    void
+    search_async(const RadioBrowserAPI::SearchStationParams& params,
+                 RadioBrowserAPI::result_function_t<std::vector<std::shared_ptr<Station>>>
+                 result_func)
+    {
+        std::erase_if(searches, [](const scheduler::task& t) { return t.done(); });
+        for (auto& t : searches)
+            t.request_stop();
+
+        searches.push_back(
+            scheduler::submit(
+                scheduler::category::misc,
+                [params, result_func=std::move(result_func)](std::stop_token token)
+                    mutable
+                {
+                    auto result = search(params);
+                    if (token.stop_requested())
+                        return;
+                    scheduler::post_main(
+                        scheduler::category::misc,
+                        [result=std::move(result),
+                         result_func=std::move(result_func)]
+                            mutable
+                        {
+                            if (result_func)
+                                result_func(std::move(result));
+                        });
+                }));
+    }
+
+
+    std::optional<Station>
+    find(const std::string& uuid)
+    {
+        auto idx = current.load();
+        if (!idx || uuid.empty())
+            return {};
+        for (auto row : idx->find_uuid(uuid)) {
+            Station st;
+            fill(st, *idx, row);
+            if (st.stationuuid == uuid)
+                return st;
+        }
+        return {};
+    }
+
+} // namespace StationIndex
@@ -0,0 +1,86 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef STATION_INDEX_HPP
+#define STATION_INDEX_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "RadioBrowserAPI.hpp"
+#include "Station.hpp"
+
+
+/*
+ * Local copy of the whole radio-browser.info station list, for searching offline.
+ *
+ * A background thread downloads the list once, then only asks the server for the
+ * stations that changed since the last update. The index is stored as a flat columnar
+ * file, that's used as-is through a mapped_file.
+ *
+ * Only the hot part of the file stays in memory: the columns needed to search, sort and
+ * show the lists. The other fields (URLs, homepage, favicon, UUID) are stored per
+ * station, in a cold section that's only read for the stations actually shown, so the
+ * memory used doesn't grow much with the size of the catalogue.
+ */
+namespace StationIndex {
+
+    struct stats {
+        std::size_t stations = 0;
+        std::size_t bytes = 0;
+        std::string status;
+    };
+
+
+    void
+    initialize(const std::filesystem::path& filename);
+
+    void
+    finalize();
+
+
+    // Start or stop the background thread; a disabled index is never ready.
+    void
+    set_enabled(bool enabled);
+
+
+    bool
+    is_ready();
+
+
+    stats
+    get_stats();
+
+
+    /*
+     * Answer a station search locally.
+     *
+     * Supports name, tag, countrycode, codec, language, bitrate and https filters, and all
+     * orders; other fields are ignored.
+     */
+    std::vector<std::shared_ptr<Station>>
+    search(const RadioBrowserAPI::SearchStationParams& params);
+
+    // Like search(), but on a scheduler worker; result_func is called on the main thread.
+    // Starting another search stops the ones still running; their results may be dropped.
+    void
+    search_async(const RadioBrowserAPI::SearchStationParams& params,
+                 RadioBrowserAPI::result_function_t<std::vector<std::shared_ptr<Station>>>
+                 result_func);
+
+
+    // Decode a single station, by its stationuuid.
+    std::optional<Station>
+    find(const std::string& uuid);
+
+} // namespace StationIndex
+
+#endif
@@ -0,0 +1,244 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include <malloc.h>             // mallinfo()
+
+#include <imgui.h>
+#include <imgui_raii.h>
+
+#include "StatsPanel.hpp"
+
+#include "cfg.hpp"
+#include "humanize.hpp"
+#include "memory_accounting.hpp"
+#include "metrics.hpp"
+
+
+using std::cout;
+using std::endl;
+
+using namespace std::literals;
+
+
+namespace StatsPanel {
+
+    namespace {
+
+        using clock = std::chrono::steady_clock;
+
+        const auto sample_interval = 1s;
+
+        clock::time_point last_sample;
+        clock::time_point last_dump = clock::now();
+
+        metrics::snapshot current;
+
+        // Counter values at the previous sample, and their rates since then.
+        std::map<std::string, std::uint64_t> previous;
+        std::map<std::string, double> rates;
+
+
+        std::int64_t
+        get_heap_used()
+        {
+#ifdef __WIIU__
+            return mallinfo().uordblks;
+#else
+            return mallinfo2().uordblks;
+#endif
+        }
+
+
+        void
+        sample(clock::time_point now)
+        {
+            static auto& heap_used = metrics::get_gauge("memory/heap_used_bytes");
+            heap_used.set(get_heap_used());
+
+            const double seconds = std::chrono::duration<double>(now - last_sample).count();
+            current = metrics::take_snapshot();
+            for (auto& [name, value] : current.counters) {
+                auto it = previous.find(name);
+                if (it != previous.end() && seconds > 0)
+                    rates[name] = (value - it->second) / seconds;
+                previous[name] = value;
+            }
+            last_sample = now;
+        }
+
+
+        std::uint64_t
+        get_counter(const std::string& name)
+        {
+            auto it = previous.find(name);
+            return it == previous.end() ? 0 : it->second;
+        }
+
+
+        void
+        show_hit_rate(const char* label,
+                      const std::string& hits_name,
+                      const std::string& misses_name)
+        {
+            const std::uint64_t hits = get_counter(hits_name);
+            const std::uint64_t total = hits + get_counter(misses_name);
+            if (!total)
+                return;
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(label);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f%%", 100.0 * hits / total);
+        }
+
+
+        void
+        dump()
+        {
+            metrics::dump();
+            cout << "Memory (live / peak bytes):" << endl;
+            for (unsigned i = 0; i < memory_accounting::num_tags; ++i) {
+                const auto t = static_cast<memory_accounting::tag>(i);
+                const auto& acc = memory_accounting::get(t);
+                cout << "  " << memory_accounting::to_string(t) << " = "
+                     << acc.get_live() << " / " << acc.get_peak() << endl;
+            }
+        }
+
+    } // namespace
+
+
+    void
+    process_logic()
+    {
+        const auto now = clock::now();
+
+        // Note: only sample when someone is going to look at it.
+        const auto log_interval = std::chrono::seconds{cfg::state.stats_log_interval};
+        const bool want_dump = log_interval.count() && now - last_dump >= log_interval;
+        if ((cfg::state.show_stats || want_dump) && now - last_sample >= sample_interval)
+            sample(now);
+
+        if (want_dump) {
+            dump();
+            last_dump = now;
+        }
+    }
+
+
+    void
+    show()
+    {
+        ImGui::SetNextWindowBgAlpha(0.75f);
+        if (ImGui::RAII::Window win{"Stats",
+                                    nullptr,
+                                    ImGuiWindowFlags_AlwaysAutoResize |
+                                    ImGuiWindowFlags_NoFocusOnAppearing |
+                                    ImGuiWindowFlags_NoNav}) {
+
+            if (ImGui::RAII::Table table{"counters", 3,
+                                         ImGuiTableFlags_RowBg |
+                                         ImGuiTableFlags_SizingFixedFit}) {
+                ImGui::TableSetupColumn("Counter");
+                ImGui::TableSetupColumn("Total");
+                ImGui::TableSetupColumn("Per second");
+                ImGui::TableHeadersRow();
+
+                for (auto& [name, value] : current.counters) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(name.data());
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(humanize::value(value).data());
+                    ImGui::TableNextColumn();
+                    const auto rate = static_cast<std::uint64_t>(rates[name]);
+                    ImGui::TextUnformatted(humanize::value(rate).data());
+                }
+            }
+
+            if (ImGui::RAII::Table table{"gauges", 2,
+                                         ImGuiTableFlags_RowBg |
+                                         ImGuiTableFlags_SizingFixedFit}) {
+                ImGui::TableSetupColumn("Gauge");
+                ImGui::TableSetupColumn("Value");
+                ImGui::TableHeadersRow();
+
+                for (auto& [name, value] : current.gauges) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(name.data());
+                    ImGui::TableNextColumn();
+                    if (value < 0)
+                        ImGui::Text("-%s", humanize::value(-value).data());
+                    else
+                        ImGui::TextUnformatted(humanize::value(value).data());
+                }
+
+                show_hit_rate("icons/cache_hit_rate", "icons/cache_hits", "icons/cache_misses");
+            }
+
+            if (ImGui::RAII::Table table{"memory", 3,
+                                         ImGuiTableFlags_RowBg |
+                                         ImGuiTableFlags_SizingFixedFit}) {
+                ImGui::TableSetupColumn("Memory");
+                ImGui::TableSetupColumn("Live");
+                ImGui::TableSetupColumn("Peak");
+                ImGui::TableHeadersRow();
+
+                for (unsigned i = 0; i < memory_accounting::num_tags; ++i) {
+                    const auto t = static_cast<memory_accounting::tag>(i);
+                    const auto& acc = memory_accounting::get(t);
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(memory_accounting::to_string(t));
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%sB", humanize::value(acc.get_live()).data());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%sB", humanize::value(acc.get_peak()).data());
+                }
+            }
+
+            if (ImGui::RAII::Table table{"histograms", 6,
+                                         ImGuiTableFlags_RowBg |
+                                         ImGuiTableFlags_SizingFixedFit}) {
+                ImGui::TableSetupColumn("Histogram");
+                ImGui::TableSetupColumn("Count");
+                ImGui::TableSetupColumn("Mean");
+                ImGui::TableSetupColumn("P50");
+                ImGui::TableSetupColumn("P99");
+                ImGui::TableSetupColumn("Max");
+                ImGui::TableHeadersRow();
+
+                for (auto& [name, h] : current.histograms) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(name.data());
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(humanize::value(h.total).data());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.1f", h.mean());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.1f", h.percentile(0.50));
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.1f", h.percentile(0.99));
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.1f", h.max);
+                }
+            }
+
+            if (ImGui::Button("Log"))
+                dump();
+        }
+    }
+
+} // namespace StatsPanel
@@ -0,0 +1,29 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef STATS_PANEL_HPP
+#define STATS_PANEL_HPP
+
+
+/*
+ * Window showing the metrics registry, with the rate of each counter.
+ *
+ * It also samples the metrics that nobody updates on their own (like the heap usage),
+ * and writes all metrics to the log periodically, if enabled in the settings.
+ */
+namespace StatsPanel {
+
+    void
+    process_logic();
+
+
+    void
+    show();
+
+} // namespace StatsPanel
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // find_if()
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <iterator>             // make_move_iterator()
+#include <optional>
+#include <utility>              // move()
+
+#include <glaze/core/meta.hpp>
+
+#include "Telemetry.hpp"
+
+#include "App.hpp"
+#include "cfg.hpp"
+#include "PlayerTab.hpp"
+#include "Profiler.hpp"
+#include "RadioBrowserAPI.hpp"
+#include "Serializer.hpp"
+#include "Station.hpp"
+
+
+using std::cout;
+using std::endl;
+
+using namespace std::literals;
+
+using clock_type = std::chrono::steady_clock;
+
+
+namespace Telemetry {
+
+    struct Item {
+        std::string uuid;
+        bool vote = false;
+        unsigned failures = 0;
+        // Note: not saved, the caller is gone after a restart.
+        result_function_t result_func;
+    };
+
+} // namespace Telemetry
+
+
+template<>
+struct glz::meta<Telemetry::Item> {
+    using T = Telemetry::Item;
+    static constexpr
+    auto value = object("uuid", &T::uuid,
+                        "vote", &T::vote,
+                        "failures", &T::failures);
+};
+
+
+namespace Telemetry {
+
+    namespace {
+
+        // How long a station must keep streaming, before its click is queued.
+        const auto click_delay = 10s;
+
+        // How long the queue must be quiet, before it's sent.
+        const auto flush_delay = 5s;
+
+        const auto retry_delay = 1min;
+
+        const unsigned max_failures = 3;
+
+
+        struct PendingClick {
+            std::shared_ptr<Station> station;
+            std::optional<clock_type::time_point> streaming_since;
+            result_function_t result_func;
+        };
+
+        std::optional<PendingClick> pending_click;
+
+        std::deque<Item> outbox;
+
+        clock_type::time_point next_flush;
+
+        // Only one item is sent at a time.
+        bool sending = false;
+
+
+        void
+        load()
+        try {
+            outbox.clear();
+            auto filename = App::get_config_path() / "telemetry.json";
+            Serializer::load(outbox, filename);
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: Telemetry::load(): " << e.what() << endl;
+        }
+
+
+        void
+        save()
+        try {
+            auto filename = App::get_config_path() / "telemetry.json";
+            Serializer::save_async(outbox, filename);
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: Telemetry::save(): " << e.what() << endl;
+        }
+
+
+        std::deque<Item>::iterator
+        find_item(const std::string& uuid,
+                  bool vote)
+        {
+            return std::ranges::find_if(outbox,
+                                        [&uuid, vote](const Item& item)
+                                        {
+                                            return item.uuid == uuid && item.vote == vote;
+                                        });
+        }
+
+
+        void
+        enqueue(const std::string& uuid,
+                bool vote,
+                result_function_t result_func)
+        {
+            next_flush = clock_type::now() + flush_delay;
+
+            auto it = find_item(uuid, vote);
+            if (it != outbox.end()) {
+                // Already queued; only the latest caller gets the result.
+                if (result_func)
+                    it->result_func = std::move(result_func);
+                return;
+            }
+
+            outbox.emplace_back(uuid, vote, 0u, std::move(result_func));
+        }
+
+
+        void
+        check_pending_click(clock_type::time_point now)
+        {
+            if (!pending_click)
+                return;
+
+            const Station& st = *pending_click->station;
+            if (!PlayerTab::is_playing(st)) {
+                // The user moved on before the click counted.
+                pending_click.reset();
+                return;
+            }
+            if (!PlayerTab::is_streaming(st)) {
+                // It must stay up the whole time; start over after a reconnection.
+                pending_click->streaming_since.reset();
+                return;
+            }
+            if (!pending_click->streaming_since) {
+                pending_click->streaming_since = now;
+                return;
+            }
+            if (now - *pending_click->streaming_since < click_delay)
+                return;
+
+            enqueue(st.stationuuid, false, std::move(pending_click->result_func));
+            pending_click.reset();
+        }
+
+
+        void
+        finish_item(const std::string& uuid,
+                    bool vote,
+                    bool ok,
+                    const std::string& message)
+        {
+            sending = false;
+            auto it = find_item(uuid, vote);
+            if (it == outbox.end())
+                return;
+            auto result_func = std::move(it->result_func);
+            outbox.erase(it);
+            if (result_func)
+                result_func(ok, message);
+        }
+
+
+        void
+        fail_item(const std::string& uuid,
+                  bool vote,
+                  const std::exception& e)
+        {
+            cout << "WARNING: Telemetry: failed to send "
+                 << (vote ? "vote" : "click")
+                 << " for " << uuid << ": " << e.what() << endl;
+
+            sending = false;
+            next_flush = clock_type::now() + retry_delay;
+            auto it = find_item(uuid, vote);
+            if (it == outbox.end())
+                return;
+            if (++it->failures < max_failures)
+                return;
+            finish_item(uuid, vote, false, e.what());
+        }
+
+
+        // The callers still get a result, so they don't wait forever.
+        void
+        drop_all()
+        {
+            const std::string message = "Sending clicks and votes is disabled.";
+
+            if (pending_click) {
+                auto result_func = std::move(pending_click->result_func);
+                pending_click.reset();
+                if (result_func)
+                    result_func(false, message);
+            }
+
+            // Note: the item being sent is kept, its result is still coming.
+            std::deque<Item> dropped;
+            if (sending && !outbox.empty()) {
+                dropped.assign(std::make_move_iterator(outbox.begin() + 1),
+                               std::make_move_iterator(outbox.end()));
+                outbox.erase(outbox.begin() + 1, outbox.end());
+            } else
+                dropped.swap(outbox);
+            if (dropped.empty())
+                return;
+            for (auto& item : dropped)
+                if (item.result_func)
+                    item.result_func(false, message);
+            save();
+        }
+
+
+        void
+        flush(clock_type::time_point now)
+        {
+            if (sending || outbox.empty() || now < next_flush)
+                return;
+
+            const std::string uuid = outbox.front().uuid;
+            const bool vote = outbox.front().vote;
+            sending = true;
+
+            auto on_error = [uuid, vote](const std::exception& e)
+            {
+                fail_item(uuid, vote, e);
+            };
+
+            if (vote)
+                RadioBrowserAPI::send_vote(
+                    uuid,
+                    [uuid](RadioBrowserAPI::VoteResult result)
+                    {
+                        finish_item(uuid, true, result.ok, result.message);
+                    },
+                    std::move(on_error));
+            else
+                RadioBrowserAPI::send_click(
+                    uuid,
+                    [uuid](RadioBrowserAPI::ClickResult result)
+                    {
+                        finish_item(uuid, false, result.ok, result.message);
+                    },
+                    std::move(on_error));
+        }
+
+    } // namespace
+
+
+    void
+    initialize()
+    {
+        load();
+    }
+
+
+    void
+    finalize()
+    {
+        pending_click.reset();
+        save();
+    }
+
+
+    void
+    process_logic()
+    {
+        PROFILE_SCOPE("Telemetry::process_logic");
+
+        if (!cfg::state.send_clicks) {
+            // Note: nothing is kept for later, the user opted out.
+            drop_all();
+            return;
+        }
+
+        const auto now = clock_type::now();
+        check_pending_click(now);
+        flush(now);
+    }
+
+
+    void
+    queue_click(const std::shared_ptr<Station>& station,
+                result_function_t result_func)
+    {
+        if (!cfg::state.send_clicks || !station || station->stationuuid.empty())
+            return;
+
+        pending_click.emplace(station, std::nullopt, std::move(result_func));
+    }
+
+
+    void
+    queue_vote(const std::string& uuid,
+               result_function_t result_func)
+    {
+        if (!cfg::state.send_clicks || uuid.empty())
+            return;
+
+        enqueue(uuid, true, std::move(result_func));
+    }
+
+} // namespace Telemetry
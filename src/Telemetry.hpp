@@ -0,0 +1,55 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+
+
+struct Station;
+
+
+/*
+ * Outbound queue for the clicks and votes sent to radio-browser.info.
+ *
+ * A click is only queued after the station has been streaming for a while, so hopping
+ * through stations doesn't count. Queued items are sent one at a time, with background
+ * priority, after a quiet period; duplicates are collapsed. Unsent items are saved on
+ * exit, and sent on the next run.
+ */
+namespace Telemetry {
+
+    using result_function_sig = void (bool ok, const std::string& message);
+    using result_function_t = std::move_only_function<result_function_sig>;
+
+
+    void
+    initialize();
+
+    void
+    finalize();
+
+
+    void
+    process_logic();
+
+
+    // Count a click for the station, if it keeps playing.
+    void
+    queue_click(const std::shared_ptr<Station>& station,
+                result_function_t result_func = {});
+
+    void
+    queue_vote(const std::string& uuid,
+               result_function_t result_func = {});
+
+} // namespace Telemetry
+
+#endif
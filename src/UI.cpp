@@ -5,10 +5,14 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <algorithm>            // max()
+#include <cinttypes>            // PRIu64
 #include <cstdint>
+#include <cstdio>               // snprintf()
 #include <iostream>
 #include <optional>
 #include <stdexcept>
+#include <unordered_map>
 
 #include <imgui_raii.h>
 #include <imgui_stdlib.h>
@@ -21,6 +25,7 @@
 #include "BrowserTab.hpp"
 #include "cfg.hpp"
 #include "FavoritesTab.hpp"
+#include "humanize.hpp"
 #include "IconManager.hpp"
 #include "IconsFontAwesome4.h"
 #include "PlayerTab.hpp"
@@ -53,11 +58,10 @@ namespace UI {
         if (station.favicon.empty())
             return;
 
-        auto icon = IconManager::get(station.favicon);
-        auto icon_size = icon->get_size();
+        auto icon = IconManager::get_icon(station.favicon);
         sdl::vec2 size = {128, 128};
-        size.x = icon_size.x * size.y / icon_size.y;
-        show_image(*IconManager::get(station.favicon), size);
+        size.x = icon.size.x * size.y / icon.size.y;
+        show_image(*icon.texture, size, icon.uv0, icon.uv1);
         ImGui::SetItemTooltip(station.favicon);
     }
 
@@ -297,11 +301,142 @@ namespace UI {
                 if (cfg::state.switch_to_player)
                     App::set_tab(TabID::player);
                 PlayerTab::play(station);
-            }
+            } else if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal))
+                PlayerTab::prepare(station);
         }
     }
 
 
+    namespace {
+
+        struct CachedLabels {
+            // The fields the labels were made from.
+            std::uint64_t votes = 0;
+            std::uint64_t click_count = 0;
+            int click_trend = 0;
+            unsigned bitrate = 0;
+            interned_string codec;
+            interned_string countrycode;
+            csv_strings language;
+            csv_strings tags;
+
+            StationLabels labels;
+
+            // The last ImGui frame that used these labels.
+            int last_frame = 0;
+        };
+
+
+        // Keyed by address; a different Station at the same address is caught by the
+        // field comparison.
+        std::unordered_map<const Station*, CachedLabels> labels_cache;
+
+        // Labels not used for this many frames are dropped.
+        const int stale_label_frames = 120;
+
+        int labels_pruned_frame = 0;
+
+        const std::string language_tooltip = "Language spoken in this broadcast.";
+
+
+        bool
+        is_current(const CachedLabels& entry,
+                   const Station& station)
+            noexcept
+        {
+            return entry.votes == station.votes
+                && entry.click_count == station.click_count
+                && entry.click_trend == station.click_trend
+                && entry.bitrate == station.bitrate
+                && entry.codec == station.codec
+                && entry.countrycode == station.countrycode
+                && entry.language == station.language
+                && entry.tags == station.tags;
+        }
+
+
+        void
+        rebuild(CachedLabels& entry,
+                const Station& station)
+        {
+            entry.votes = station.votes;
+            entry.click_count = station.click_count;
+            entry.click_trend = station.click_trend;
+            entry.bitrate = station.bitrate;
+            entry.codec = station.codec;
+            entry.countrycode = station.countrycode;
+            entry.language = station.language;
+            entry.tags = station.tags;
+
+            StationLabels& labels = entry.labels;
+
+            labels.votes = humanize::value(station.votes);
+
+            char buf[64];
+            std::snprintf(buf, sizeof buf,
+                          ICON_FA_BAR_CHART " %" PRIu64 " (%+d)",
+                          station.click_count,
+                          station.click_trend);
+            labels.clicks = buf;
+
+            labels.bitrate.clear();
+            if (station.bitrate)
+                labels.bitrate = ICON_FA_HEADPHONES " "
+                               + std::to_string(station.bitrate) + " kbps";
+
+            labels.codec = ICON_FA_FLASK " " + station.codec.str();
+
+            labels.country.clear();
+            labels.country_name.clear();
+            if (!station.countrycode.empty())
+                labels.country = ICON_FA_FLAG_O " " + station.countrycode.str();
+
+            labels.languages.clear();
+            for (const auto& lang : station.language)
+                labels.languages.push_back(ICON_FA_LANGUAGE " " + lang.str());
+
+            labels.tags.clear();
+            for (const auto& tag : station.tags)
+                labels.tags.push_back(ICON_FA_TAG " " + tag.str());
+        }
+
+
+        void
+        prune_labels(int frame)
+        {
+            if (frame - labels_pruned_frame < stale_label_frames)
+                return;
+            labels_pruned_frame = frame;
+            std::erase_if(labels_cache,
+                          [frame](const auto& item)
+                          {
+                              return frame - item.second.last_frame > stale_label_frames;
+                          });
+        }
+
+    } // namespace
+
+
+    const StationLabels&
+    get_labels(const Station& station)
+    {
+        const int frame = ImGui::GetFrameCount();
+        prune_labels(frame);
+
+        auto [it, inserted] = labels_cache.try_emplace(&station);
+        CachedLabels& entry = it->second;
+        if (inserted || !is_current(entry, station))
+            rebuild(entry, station);
+        entry.last_frame = frame;
+
+        // Note: the country names arrive later, so keep asking until there's one.
+        if (entry.labels.country_name.empty() && !station.countrycode.empty())
+            entry.labels.country_name = BrowserTab::get_country_name(station.countrycode);
+
+        return entry.labels;
+    }
+
+
     void
     show_station_basic_info(const Station& station)
     {
@@ -322,19 +457,19 @@ namespace UI {
                 }
             }
 
+            const StationLabels& labels = get_labels(station);
+
             bool has_country = false;
-            if (!station.countrycode.empty()) {
+            if (!labels.country.empty()) {
                 has_country = true;
-                std::string tooltip = BrowserTab::get_country_name(station.countrycode);
-                show_boxed(ICON_FA_FLAG_O " " + station.countrycode, tooltip);
+                show_boxed(labels.country, labels.country_name);
             }
 
-            if (!station.language.empty()) {
+            if (!labels.languages.empty()) {
                 if (has_country)
                     ImGui::SameLine();
-                for (auto& lang : station.language) {
-                    show_boxed(ICON_FA_LANGUAGE " " + lang,
-                               "Language spoken in this broadcast.");
+                for (const auto& lang : labels.languages) {
+                    show_boxed(lang, language_tooltip);
                     ImGui::SameLine();
                 }
                 ImGui::NewLine();
@@ -345,13 +480,14 @@ namespace UI {
 
 
     void
-    show_tags(const std::vector<std::string>& tags)
+    show_tags(const Station& station)
     {
-        if (tags.empty())
+        const StationLabels& labels = get_labels(station);
+        if (labels.tags.empty())
             return;
 
-        for (const auto& tag : tags) {
-            show_boxed(ICON_FA_TAG " " + tag, {});
+        for (const auto& tag : labels.tags) {
+            show_boxed(tag);
             ImGui::SameLine();
         }
         ImGui::NewLine();
@@ -394,6 +530,68 @@ namespace UI {
     }
 
 
+    void
+    VirtualList::invalidate()
+        noexcept
+    {
+        heights.clear();
+    }
+
+
+    void
+    VirtualList::show(std::size_t count,
+                      const std::function<void (std::size_t index)>& show_row,
+                      std::optional<std::size_t> force_index)
+    {
+        // Note: the rows wrap and scale, so their heights depend on the font and width.
+        const float font_size = ImGui::GetFontSize();
+        const float width = ImGui::GetContentRegionAvail().x;
+        if (font_size != measured_font_size || width != measured_width) {
+            invalidate();
+            measured_font_size = font_size;
+            measured_width = width;
+        }
+
+        heights.resize(count);
+
+        float known_sum = 0;
+        std::size_t known = 0;
+        for (float h : heights)
+            if (h > 0) {
+                known_sum += h;
+                ++known;
+            }
+        const float estimate = known
+            ? known_sum / known
+            : 4 * ImGui::GetFrameHeightWithSpacing();
+
+        // Note: one extra screen above and below, so navigation can reach the next rows.
+        const float view_top = ImGui::GetScrollY();
+        const float view_height = ImGui::GetWindowHeight();
+        const float min_y = view_top - view_height;
+        const float max_y = view_top + 2 * view_height;
+
+        float y = ImGui::GetCursorPosY();
+        for (std::size_t index = 0; index < count; ++index) {
+            float& height = heights[index];
+            const float h = height > 0 ? height : estimate;
+            if ((y + h < min_y || y > max_y) && index != force_index) {
+                y += h;
+                continue;
+            }
+            ImGui::SetCursorPosY(y);
+            show_row(index);
+            const float end = ImGui::GetCursorPosY();
+            height = end - y;
+            y = end;
+        }
+
+        // Note: submit an item, so the skipped rows still count as content.
+        ImGui::SetCursorPosY(y);
+        ImGui::Dummy({0, 0});
+    }
+
+
     // DEBUG
     void
     show_last_bounding_box()
@@ -408,6 +606,50 @@ namespace UI {
     }
 
 
+    void
+    draw_spectrum(ImDrawList* list,
+                  const ImVec2& pos,
+                  const ImVec2& size,
+                  const spectrum_analyzer::result& spectrum,
+                  float alpha)
+    {
+        const ImU32 back_color = ImGui::GetColorU32(ImGuiCol_FrameBg, alpha);
+        const ImU32 bar_color = ImGui::GetColorU32(ImGuiCol_PlotHistogram, alpha);
+        const ImU32 vu_color = ImGui::GetColorU32(ImGuiCol_PlotLines, alpha);
+
+        // Note: one empty column separates the bars from the VU meters.
+        const std::size_t columns = spectrum.bands.size() + 1 + spectrum.vu.size();
+        const float column_width = size.x / columns;
+        const float gap = std::max(1.0f, column_width * 0.2f);
+        const float bottom = pos.y + size.y;
+
+        auto draw_bar = [&](std::size_t column, float level, ImU32 color)
+        {
+            const float x = pos.x + column * column_width;
+            list->AddRectFilled({x + gap / 2, bottom - level * size.y},
+                                {x + column_width - gap / 2, bottom},
+                                color);
+        };
+
+        list->AddRectFilled(pos, pos + size, back_color);
+        for (std::size_t i = 0; i < spectrum.bands.size(); ++i)
+            draw_bar(i, spectrum.bands[i], bar_color);
+        for (std::size_t i = 0; i < spectrum.vu.size(); ++i)
+            draw_bar(spectrum.bands.size() + 1 + i, spectrum.vu[i], vu_color);
+    }
+
+
+    void
+    show_spectrum(const spectrum_analyzer::result& spectrum,
+                  float height)
+    {
+        const ImVec2 pos = ImGui::GetCursorScreenPos();
+        const ImVec2 size{ImGui::GetContentRegionAvail().x, height};
+        ImGui::Dummy(size);
+        draw_spectrum(ImGui::GetWindowDrawList(), pos, size, spectrum);
+    }
+
+
 
     void
     show_text(const TextSpec& spec,
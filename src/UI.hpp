@@ -10,6 +10,8 @@
 
 #include <concepts>
 #include <cstdarg>
+#include <cstddef>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -21,6 +23,7 @@
 #include <sdl2xx/texture.hpp>
 
 #include "csv_strings.hpp"
+#include "spectrum_analyzer.hpp"
 
 
 struct Station;
@@ -121,12 +124,33 @@ namespace UI {
     show_play_button(std::shared_ptr<Station>& station);
 
 
+    // Text shown for a station, formatted once, instead of on every frame.
+    struct StationLabels {
+        std::string votes;
+        std::string clicks;          // with the daily trend
+        std::string bitrate;         // empty when unknown
+        std::string codec;
+        std::string country;
+        std::string country_name;
+        std::vector<std::string> languages;
+        std::vector<std::string> tags;
+    };
+
+
+    /*
+     * The labels are cached per Station, and rebuilt when the fields they come from
+     * change. The reference stays valid until the end of the frame.
+     */
+    const StationLabels&
+    get_labels(const Station& station);
+
+
     void
     show_station_basic_info(const Station& station);
 
 
     void
-    show_tags(const std::vector<std::string>& tags);
+    show_tags(const Station& station);
 
 
     void
@@ -141,6 +165,50 @@ namespace UI {
     show_last_bounding_box();
 
 
+    // Spectrum bars, with the two VU meters on the right.
+    void
+    draw_spectrum(ImDrawList* list,
+                  const ImVec2& pos,
+                  const ImVec2& size,
+                  const spectrum_analyzer::result& spectrum,
+                  float alpha = 1);
+
+    // Uses all the available width.
+    void
+    show_spectrum(const spectrum_analyzer::result& spectrum,
+                  float height);
+
+
+    /*
+     * A list that only lays out the rows near the visible part of the current window.
+     *
+     * Row heights are measured when the rows are shown, and cached; rows never shown are
+     * assumed to have the average height. The other rows are skipped by moving the
+     * cursor.
+     *
+     * The cache is dropped when the font size or the available width changes; callers
+     * must call invalidate() when the rows change.
+     */
+    struct VirtualList {
+
+        std::vector<float> heights;
+        float measured_font_size = 0;
+        float measured_width = 0;
+
+
+        void
+        invalidate()
+            noexcept;
+
+        // The row at force_index is always shown, so it can be scrolled to.
+        void
+        show(std::size_t count,
+             const std::function<void (std::size_t index)>& show_row,
+             std::optional<std::size_t> force_index = {});
+
+    }; // struct VirtualList
+
+
     struct TextSpec {
         float halign = 0;
         float width = 0;
@@ -9,10 +9,12 @@
 #define ASYNC_QUEUE_HPP
 
 #include <condition_variable>
+#include <cstddef>
 #include <expected>
 #include <mutex>
 #include <queue>
 #include <utility>              // forward(), move()
+#include <vector>
 
 
 enum class async_queue_error {
@@ -26,8 +28,9 @@ template<typename T,
          typename Q = std::queue<T>>
 class async_queue {
 
-    std::timed_mutex mutex;
-    std::condition_variable empty_cond;
+    mutable std::timed_mutex mutex;
+    // Note: _any, because the mutex is a timed_mutex (for try_pop_for()).
+    std::condition_variable_any empty_cond;
     Q queue;
     bool should_stop = false;
 
@@ -90,6 +93,7 @@ public:
             return false;
 
         queue.push(std::forward<U>(x));
+        empty_cond.notify_one();
         return true;
     }
 
@@ -151,6 +155,22 @@ public:
         return result;
     }
 
+
+    // Move everything currently queued to the end of out; returns how many were moved.
+    std::size_t
+    pop_all(std::vector<T>& out)
+    {
+        std::lock_guard guard{mutex};
+        if (should_stop)
+            return 0;
+        std::size_t count = 0;
+        for (; !queue.empty(); ++count) {
+            out.push_back(std::move(queue.front()));
+            queue.pop();
+        }
+        return count;
+    }
+
 }; // class async_queue
 
 #endif
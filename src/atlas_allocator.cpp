@@ -0,0 +1,165 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // any_of(), max()
+#include <array>
+#include <stdexcept>
+
+#include "atlas_allocator.hpp"
+
+
+namespace {
+
+    bool
+    same(const sdl::vec2& a,
+         const sdl::vec2& b)
+        noexcept
+    {
+        return a.x == b.x && a.y == b.y;
+    }
+
+
+    bool
+    contains(const auto& cells,
+             const sdl::vec2& pos)
+        noexcept
+    {
+        return std::ranges::any_of(cells,
+                                   [&pos](const sdl::vec2& c)
+                                   {
+                                       return same(c, pos);
+                                   });
+    }
+
+} // namespace
+
+
+atlas_allocator::atlas_allocator(int size,
+                                 int min_cell) :
+    size_{size},
+    min_cell{min_cell}
+{
+    if (size <= 0 || min_cell <= 0 || min_cell > size
+        || (size & (size - 1)) || (min_cell & (min_cell - 1)))
+        throw std::invalid_argument{"atlas sizes must be powers of two"};
+    free_cells.resize(level_for(min_cell) + 1);
+    free_cells[0].push_back({0, 0});
+}
+
+
+int
+atlas_allocator::level_for(int cell_size)
+    const noexcept
+{
+    int level = 0;
+    for (int s = size_; s / 2 >= cell_size; s /= 2)
+        ++level;
+    return level;
+}
+
+
+int
+atlas_allocator::cell_size(int level)
+    const noexcept
+{
+    return size_ >> level;
+}
+
+
+std::optional<sdl::vec2>
+atlas_allocator::take(int level)
+{
+    auto& cells = free_cells[level];
+    if (!cells.empty()) {
+        auto pos = cells.back();
+        cells.pop_back();
+        return pos;
+    }
+    if (level == 0)
+        return {};
+
+    // Split a bigger cell; keep the first quarter, the other three become free.
+    auto parent = take(level - 1);
+    if (!parent)
+        return {};
+    const int half = cell_size(level);
+    cells.push_back({parent->x + half, parent->y + half});
+    cells.push_back({parent->x,        parent->y + half});
+    cells.push_back({parent->x + half, parent->y});
+    return parent;
+}
+
+
+void
+atlas_allocator::give(sdl::vec2 pos,
+                      int level)
+{
+    if (level > 0) {
+        const int parent_size = cell_size(level - 1);
+        sdl::vec2 parent;
+        parent.x = pos.x / parent_size * parent_size;
+        parent.y = pos.y / parent_size * parent_size;
+        const int half = cell_size(level);
+        const std::array<sdl::vec2, 4> quarters = {{
+                {parent.x,        parent.y},
+                {parent.x + half, parent.y},
+                {parent.x,        parent.y + half},
+                {parent.x + half, parent.y + half},
+            }};
+
+        // Merge if the three buddies are free too.
+        auto& cells = free_cells[level];
+        unsigned found = 0;
+        for (auto& q : quarters)
+            if (!same(q, pos) && contains(cells, q))
+                ++found;
+        if (found == 3) {
+            std::erase_if(cells,
+                          [&quarters](const sdl::vec2& c)
+                          {
+                              return contains(quarters, c);
+                          });
+            give(parent, level - 1);
+            return;
+        }
+    }
+    free_cells[level].push_back(pos);
+}
+
+
+int
+atlas_allocator::size()
+    const noexcept
+{
+    return size_;
+}
+
+
+int
+atlas_allocator::cell_for(sdl::vec2 img_size)
+    const noexcept
+{
+    int side = std::max({img_size.x, img_size.y, min_cell});
+    return cell_size(level_for(side));
+}
+
+
+std::optional<sdl::vec2>
+atlas_allocator::allocate(sdl::vec2 img_size)
+{
+    if (img_size.x <= 0 || img_size.y <= 0 || img_size.x > size_ || img_size.y > size_)
+        return {};
+    return take(level_for(cell_for(img_size)));
+}
+
+
+void
+atlas_allocator::release(sdl::vec2 pos,
+                         sdl::vec2 img_size)
+{
+    give(pos, level_for(cell_for(img_size)));
+}
@@ -0,0 +1,77 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef ATLAS_ALLOCATOR_HPP
+#define ATLAS_ALLOCATOR_HPP
+
+#include <optional>
+#include <vector>
+
+#include <sdl2xx/vec2.hpp>
+
+
+/*
+ * Allocates square cells in a square texture atlas, as a quadtree buddy allocator.
+ *
+ * Each request is rounded up to a power-of-two cell; freeing a cell merges it back with
+ * its three buddies when they're all free, so space from evicted cells is reused for cells
+ * of any size.
+ */
+class atlas_allocator {
+
+    int size_ = 0;
+    int min_cell = 0;
+    // Free cell positions, for each level; level 0 is the whole atlas.
+    std::vector<std::vector<sdl::vec2>> free_cells;
+
+
+    int
+    level_for(int cell_size)
+        const noexcept;
+
+    int
+    cell_size(int level)
+        const noexcept;
+
+    std::optional<sdl::vec2>
+    take(int level);
+
+    void
+    give(sdl::vec2 pos,
+         int level);
+
+public:
+
+    // Both sizes must be powers of two.
+    atlas_allocator(int size = 1024,
+                    int min_cell = 32);
+
+
+    int
+    size()
+        const noexcept;
+
+
+    // The side of the cell that allocate() uses for this size.
+    int
+    cell_for(sdl::vec2 img_size)
+        const noexcept;
+
+
+    // Returns the top-left corner of the cell, or nothing if there's no space.
+    std::optional<sdl::vec2>
+    allocate(sdl::vec2 img_size);
+
+
+    // Note: img_size must be the same that was passed to allocate().
+    void
+    release(sdl::vec2 pos,
+            sdl::vec2 img_size);
+
+}; // class atlas_allocator
+
+#endif
@@ -0,0 +1,284 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // max(), min()
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>              // memset()
+#include <iostream>
+#include <span>
+#include <thread>
+
+#include <sdl2xx/audio.hpp>
+
+#include "audio_output.hpp"
+
+#include "audio_pipeline.hpp"
+#include "pcm_convert.hpp"
+#include "resampler.hpp"
+
+
+using std::cout;
+using std::endl;
+
+using namespace std::literals;
+
+
+namespace audio_output {
+
+    namespace {
+
+        const int device_channels = 2;
+        const Uint16 device_samples = 2048;
+
+        // 10 ms at 48 kHz.
+        const int fade_frames = 480;
+
+        // The callback converts this many frames at a time.
+        const int chunk_frames = 256;
+        const std::size_t max_source_channels = pcm::max_channels;
+        const std::size_t max_frame_size = max_source_channels * sizeof(float);
+
+        // A callback takes microseconds; this only matters if the device got stuck.
+        const auto release_timeout = 500ms;
+
+
+        sdl::audio::device device;
+        int device_rate = 0;
+        bool running = false;
+
+        std::atomic<audio_pipeline*> requested = nullptr;
+        // Note: while the device is running, only the audio thread changes this.
+        std::atomic<audio_pipeline*> playing = nullptr;
+
+        // Only the audio thread touches these.
+        float level = 0;
+        alignas(float) char scratch[chunk_frames * max_frame_size];
+        float mixed[chunk_frames * device_channels];
+
+
+        // Apply the gain ramp to the stereo mix.
+        void
+        apply_gain(const float* mix,
+                   std::int16_t* dst,
+                   int frames,
+                   float gain,
+                   float step)
+            noexcept
+        {
+            for (int i = 0; i < frames; ++i) {
+                const float g = gain + step * i;
+                dst[2 * i]     = pcm::sample_cast<std::int16_t>(mix[2 * i]     * g);
+                dst[2 * i + 1] = pcm::sample_cast<std::int16_t>(mix[2 * i + 1] * g);
+            }
+        }
+
+
+        // Returns false if nothing could be pulled from source.
+        bool
+        render(audio_pipeline* source,
+               std::int16_t* out,
+               int frames,
+               float gain,
+               float step)
+            noexcept
+        {
+            if (!source)
+                return false;
+            const auto spec = source->get_spec();
+            if (!spec || spec->rate != device_rate)
+                return false;
+            if (spec->channels < 1 || spec->channels > int(max_source_channels))
+                return false;
+
+            std::size_t sample_size;
+            if (spec->format == AUDIO_S16SYS)
+                sample_size = sizeof(std::int16_t);
+            else if (spec->format == AUDIO_F32SYS)
+                sample_size = sizeof(float);
+            else
+                return false;
+
+            source->pull(std::span{scratch, frames * spec->channels * sample_size});
+
+            // Note: mono goes to both sides; more channels are mixed down.
+            if (spec->format == AUDIO_S16SYS)
+                pcm::convert(reinterpret_cast<const std::int16_t*>(scratch), spec->channels,
+                             mixed, device_channels, frames);
+            else
+                pcm::convert(reinterpret_cast<const float*>(scratch), spec->channels,
+                             mixed, device_channels, frames);
+            apply_gain(mixed, out, frames, gain, step);
+            return true;
+        }
+
+
+        // Called by SDL, from the audio thread.
+        void
+        callback(void*,
+                 Uint8* stream,
+                 int len)
+        {
+            auto out = reinterpret_cast<std::int16_t*>(stream);
+            int frames = len / (device_channels * sizeof(std::int16_t));
+            audio_pipeline* source = playing.load();
+
+            while (frames > 0) {
+                const int n = std::min(frames, chunk_frames);
+
+                // Note: the old source is only let go once it's faded out.
+                audio_pipeline* wanted = requested.load();
+                if (source != wanted && (!source || level <= 0)) {
+                    source = wanted;
+                    playing.store(source);
+                    level = 0;
+                }
+
+                const float delta = float(n) / fade_frames;
+                const float next = source == wanted
+                    ? std::min(1.0f, level + delta)
+                    : std::max(0.0f, level - delta);
+
+                if (!render(source, out, n, level, (next - level) / n))
+                    std::memset(out, 0, n * device_channels * sizeof(std::int16_t));
+
+                level = next;
+                out += n * device_channels;
+                frames -= n;
+            }
+        }
+
+
+        void
+        open(int rate)
+        {
+            if (device) {
+                // Note: closing waits for the callback to return.
+                device.destroy();
+                running = false;
+            }
+
+            sdl::audio::spec spec;
+            spec.freq     = rate;
+            spec.format   = AUDIO_S16SYS;
+            spec.channels = device_channels;
+            spec.samples  = device_samples;
+            spec.callback = &callback;
+            spec.userdata = nullptr;
+            device.create(nullptr, false, spec);
+            device_rate = rate;
+        }
+
+
+        void
+        set_running(bool run)
+        {
+            if (!device || run == running)
+                return;
+            if (run)
+                device.unpause();
+            else
+                device.pause();
+            running = run;
+        }
+
+    } // namespace
+
+
+    void
+    initialize()
+    {
+        open(resampler::output_rate);
+    }
+
+
+    void
+    finalize()
+        noexcept
+    {
+        requested.store(nullptr);
+        try {
+            if (device)
+                device.destroy();
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: audio_output::finalize(): " << e.what() << endl;
+        }
+        running = false;
+        playing.store(nullptr);
+    }
+
+
+    void
+    set_source(audio_pipeline* source)
+        noexcept
+    {
+        requested.store(source);
+        if (source) {
+            try {
+                set_running(true);
+            }
+            catch (std::exception& e) {
+                cout << "ERROR: audio_output::set_source(): " << e.what() << endl;
+            }
+        }
+    }
+
+
+    void
+    release(const audio_pipeline* source)
+        noexcept
+    {
+        if (!source)
+            return;
+        if (requested.load() == source)
+            requested.store(nullptr);
+
+        if (running) {
+            const auto deadline = std::chrono::steady_clock::now() + release_timeout;
+            while (playing.load() == source && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(1ms);
+        }
+        if (playing.load() != source)
+            return;
+
+        // Note: pausing locks the device, so the callback can't be running after it.
+        try {
+            const bool was_running = running;
+            set_running(false);
+            playing.store(nullptr);
+            level = 0;
+            set_running(was_running && requested.load());
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: audio_output::release(): " << e.what() << endl;
+        }
+    }
+
+
+    void
+    process()
+    {
+        audio_pipeline* source = requested.load();
+        if (!source) {
+            // Done fading out.
+            if (running && !playing.load())
+                set_running(false);
+            return;
+        }
+
+        const auto spec = source->get_spec();
+        if (!spec || spec->rate == device_rate)
+            return;
+
+        cout << "Reopening audio device at " << spec->rate << " Hz" << endl;
+        open(spec->rate);
+        set_running(true);
+    }
+
+} // namespace audio_output
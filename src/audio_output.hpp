@@ -0,0 +1,57 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef AUDIO_OUTPUT_HPP
+#define AUDIO_OUTPUT_HPP
+
+
+struct audio_pipeline;
+
+
+/*
+ * The one SDL audio device, open for the app's whole lifetime, always 48 kHz stereo S16.
+ *
+ * The audio callback pulls from the current source pipeline, and converts its PCM (S16 or
+ * F32, any channel count) to the device format. Switching sources fades the old one out
+ * and the new one in, inside a single callback, so there's no click and no gap from
+ * reopening the device.
+ *
+ * Only a source with an unusual rate, that the resampler left alone, makes the device
+ * reopen at that rate.
+ *
+ * All functions must be called from the main thread.
+ */
+namespace audio_output {
+
+    // Opens the device, paused.
+    void
+    initialize();
+
+    void
+    finalize()
+        noexcept;
+
+
+    // What to play from now on; null fades out to silence, and pauses the device.
+    void
+    set_source(audio_pipeline* source)
+        noexcept;
+
+    // Blocks until the audio thread stops using source, so it can be destroyed. Stops it
+    // first, if it's the current source.
+    void
+    release(const audio_pipeline* source)
+        noexcept;
+
+
+    // Reopens the device when the source's rate changes.
+    void
+    process();
+
+} // namespace audio_output
+
+#endif
@@ -0,0 +1,584 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // clamp(), max(), min()
+#include <chrono>
+#include <cstring>              // memset()
+#include <vector>
+
+#include <SDL_audio.h>
+
+#include "audio_pipeline.hpp"
+
+#include "logging.hpp"
+#include "metrics.hpp"
+#include "thread_policy.hpp"
+#include "tracer.hpp"
+
+
+using namespace std::literals;
+
+
+namespace {
+
+    // About 5.4 seconds of 48 kHz stereo F32.
+    const std::size_t pcm_capacity = 2 * 1024 * 1024;
+
+    // Largest chunk decoded at once.
+    const std::size_t decode_block_size = 32 * 1024;
+
+    // How long the decode thread waits when it has nothing to do.
+    const auto idle_delay = 5ms;
+
+    // How long without underruns before the buffer target shrinks.
+    const auto stable_period = 60s;
+
+    // About 30 times per second.
+    const auto analysis_period = 33ms;
+
+    // How long the analysis keeps running after the last get_spectrum().
+    const auto analysis_timeout = 1s;
+
+} // namespace
+
+
+audio_pipeline::audio_pipeline(const std::string& url,
+                               const std::string& url_resolved,
+                               const std::string& user_agent) :
+    radio{url, url_resolved, user_agent},
+    pcm{pcm_capacity},
+    state{radio.current_state},
+    decode_thread{[this](std::stop_token token) { decode_thread_func(token); }}
+{}
+
+
+audio_pipeline::~audio_pipeline()
+    noexcept
+{
+    decode_thread.request_stop();
+    if (decode_thread.joinable())
+        decode_thread.join();
+}
+
+
+radio_client::state
+audio_pipeline::get_state()
+    const noexcept
+{
+    return state.load();
+}
+
+
+std::optional<decoder::spec>
+audio_pipeline::get_spec()
+    const
+{
+    return spec.load();
+}
+
+
+std::shared_ptr<const stream_metadata>
+audio_pipeline::get_metadata()
+    const noexcept
+{
+    return metadata.load();
+}
+
+
+unsigned
+audio_pipeline::get_metadata_generation()
+    const noexcept
+{
+    return metadata_generation.load();
+}
+
+
+std::shared_ptr<const decoder::info>
+audio_pipeline::get_decoder_info()
+    const noexcept
+{
+    return info.load();
+}
+
+
+std::size_t
+audio_pipeline::available()
+    const noexcept
+{
+    return pcm.size();
+}
+
+
+std::size_t
+audio_pipeline::read_samples(std::span<char> buf)
+    noexcept
+{
+    const std::size_t fs = frame_size.load();
+    if (!fs)
+        return 0;
+    std::size_t count = std::min(buf.size(), pcm.size());
+    count -= count % fs;
+    return pcm.read(buf.first(count));
+}
+
+
+void
+audio_pipeline::pull(std::span<char> buf)
+    noexcept
+{
+    std::size_t filled = 0;
+
+    // Note: only the consumer can drop from the ring. Whatever was read since the seek is
+    // already gone, so a few ms of new PCM might be dropped too.
+    if (std::size_t count = pcm_discard.exchange(0)) {
+        if (const std::size_t fs = frame_size.load())
+            pcm.discard(count - count % fs);
+        buffering.store(true);
+    }
+
+    if (paused.load()) {
+        std::memset(buf.data(), 0, buf.size());
+        return;
+    }
+
+    if (buffering.load()) {
+        // only start playing once we reach the target
+        if (frame_size.load() && pcm.size() >= ms_to_bytes(target_ms.load()))
+            buffering.store(false);
+    }
+
+    if (!buffering.load()) {
+        filled = read_samples(buf);
+        if (filled < buf.size()) {
+            // underrun, rebuffer
+            buffering.store(true);
+            ++underruns;
+            static auto& underrun_counter = metrics::get_counter("audio/underruns");
+            underrun_counter.add();
+        }
+    }
+
+    std::memset(buf.data() + filled, 0, buf.size() - filled);
+}
+
+
+void
+audio_pipeline::set_watermarks(unsigned low_ms,
+                               unsigned high_ms)
+    noexcept
+{
+    low_watermark.store(low_ms);
+    high_watermark.store(std::max(low_ms, high_ms));
+}
+
+
+void
+audio_pipeline::set_standby(bool enable)
+    noexcept
+{
+    standby.store(enable);
+}
+
+
+bool
+audio_pipeline::is_buffering()
+    const noexcept
+{
+    return buffering.load();
+}
+
+
+unsigned
+audio_pipeline::get_buffered_ms()
+    const noexcept
+{
+    const std::size_t bps = bytes_per_second.load();
+    if (!bps)
+        return 0;
+    return pcm.size() * 1000 / bps;
+}
+
+
+unsigned
+audio_pipeline::get_target_ms()
+    const noexcept
+{
+    return target_ms.load();
+}
+
+
+unsigned
+audio_pipeline::get_underruns()
+    const noexcept
+{
+    return underruns.load();
+}
+
+
+std::size_t
+audio_pipeline::get_net_buffered()
+    const noexcept
+{
+    return net_buffered.load();
+}
+
+
+bool
+audio_pipeline::is_net_paused()
+    const noexcept
+{
+    return net_paused.load();
+}
+
+
+radio_client::reconnect_stats
+audio_pipeline::get_reconnect_stats()
+    const
+{
+    return reconnects.load();
+}
+
+
+void
+audio_pipeline::set_timeshift(std::chrono::minutes length)
+    noexcept
+{
+    timeshift_minutes.store(length.count());
+}
+
+
+bool
+audio_pipeline::is_timeshift_enabled()
+    const noexcept
+{
+    return timeshift_enabled.load();
+}
+
+
+void
+audio_pipeline::set_paused(bool pause)
+    noexcept
+{
+    if (pause && !timeshift_enabled.load())
+        return;
+    paused.store(pause);
+}
+
+
+bool
+audio_pipeline::is_paused()
+    const noexcept
+{
+    return paused.load();
+}
+
+
+void
+audio_pipeline::seek(std::chrono::seconds delta)
+    noexcept
+{
+    seek_request += delta.count();
+}
+
+
+void
+audio_pipeline::go_live()
+    noexcept
+{
+    seek_request.store(0);
+    live_request.store(true);
+}
+
+
+unsigned
+audio_pipeline::get_timeshift_delay()
+    const noexcept
+{
+    return timeshift_delay.load();
+}
+
+
+unsigned
+audio_pipeline::get_timeshift_length()
+    const noexcept
+{
+    return timeshift_length.load();
+}
+
+
+void
+audio_pipeline::set_gain(float db,
+                         bool normalize)
+    noexcept
+{
+    gain_db.store(db);
+    this->normalize.store(normalize);
+}
+
+
+float
+audio_pipeline::get_applied_gain_db()
+    const noexcept
+{
+    return applied_gain_db.load();
+}
+
+
+spectrum_analyzer::result
+audio_pipeline::get_spectrum()
+    noexcept
+{
+    spectrum_requested.store(true);
+    return spectrum.load();
+}
+
+
+void
+audio_pipeline::set_recorder(std::shared_ptr<stream_recorder> rec)
+{
+    recorder_request.store(std::move(rec));
+    recorder_pending.store(true);
+}
+
+
+void
+audio_pipeline::decode_thread_func(std::stop_token token)
+{
+    tracer::set_thread_name("audio");
+    thread_policy::apply(thread_policy::role::audio);
+
+    // Reused for every decode_into() call; never bigger than the ring's free space, so
+    // it always fits.
+    std::vector<char> block(decode_block_size);
+
+    auto& decode_time = metrics::get_histogram("decoder/decode_us", metrics::cpu_us_buckets);
+
+    unsigned seen_underruns = 0;
+    auto stable_since = std::chrono::steady_clock::now();
+    bool timeshifted = false;
+
+    auto is_full = [this]
+    {
+        auto high_bytes = ms_to_bytes(high_watermark.load());
+        return high_bytes && pcm.size() >= high_bytes;
+    };
+
+    while (!token.stop_requested()) {
+        try {
+            adapt_target(seen_underruns, stable_since);
+            timeshifted = apply_timeshift(timeshifted);
+            if (recorder_pending.exchange(false))
+                radio.set_recorder(std::move(*recorder_request.lock()));
+            update_spectrum();
+
+            // Note: when full, don't even receive, so memory use stays bounded; but
+            // behind live, the timeshift buffer has to keep up with the stream, and on
+            // standby the connection has to keep flowing.
+            if (is_full()) {
+                if (timeshifted || standby.load()) {
+                    radio.process();
+                    // Note: on standby, the new audio is decoded and dropped; the decoder
+                    // must see every byte, or it loses the frame and page boundaries.
+                    if (standby.load())
+                        while (radio.get_samples(block))
+                            ;
+                    publish();
+                    radio.wait(idle_delay);
+                } else
+                    std::this_thread::sleep_for(idle_delay);
+                continue;
+            }
+
+            radio.process();
+            publish();
+
+            gain.set_gain_db(gain_db.load());
+            gain.set_normalize(normalize.load());
+
+            bool decoded = false;
+            while (!is_full()) {
+                // Note: resampling can make the output bigger than the input.
+                const std::size_t room = resampling.max_input(pcm.free_space());
+                std::span<char> out{block.data(), std::min(block.size(), room)};
+                TRACE("audio_pipeline::decode");
+                const auto decode_start = std::chrono::steady_clock::now();
+                std::size_t size = radio.get_samples(out);
+                if (!size)
+                    break;
+                using us = std::chrono::duration<double, std::micro>;
+                decode_time.record(us{std::chrono::steady_clock::now() - decode_start}.count());
+                std::span<char> samples = out.first(size);
+                if (auto s = radio.get_spec()) {
+                    TRACE("audio_pipeline::resample");
+                    const auto out_spec = resampling.configure(*s);
+                    samples = resampling.process(samples);
+                    gain.process(samples, out_spec);
+                }
+                pcm.write(samples);
+                decoded = true;
+            }
+
+            if (decoded)
+                applied_gain_db.store(gain.get_applied_db());
+
+            // Note: the decoder wants more data; wait for the network, instead of sleeping.
+            if (!decoded)
+                radio.wait(idle_delay);
+        }
+        catch (std::exception& e) {
+            LOG_LIMITED(error, 1s) << "audio_pipeline::decode_thread_func(): " << e.what();
+            std::this_thread::sleep_for(idle_delay);
+        }
+    }
+}
+
+
+void
+audio_pipeline::publish()
+{
+    static auto& buffered_gauge = metrics::get_gauge("audio/buffered_ms");
+    static auto& net_buffered_gauge = metrics::get_gauge("stream/net_buffered_bytes");
+
+    state.store(radio.current_state);
+    net_buffered.store(radio.http.get_fill_level());
+    buffered_gauge.set(get_buffered_ms());
+    net_buffered_gauge.set(net_buffered.load());
+    net_paused.store(radio.http.is_paused());
+
+    if (auto s = radio.get_spec()) {
+        // Note: what goes into the jitter buffer is the resampler's output.
+        const auto out_spec = resampling.configure(*s);
+        std::size_t fs = SDL_AUDIO_BITSIZE(out_spec.format) / 8 * out_spec.channels;
+        frame_size.store(fs);
+        bytes_per_second.store(fs * out_spec.rate);
+        spec.store(out_spec);
+    }
+
+    if (radio.metadata_generation != published_metadata_generation) {
+        published_metadata_generation = radio.metadata_generation;
+        if (const auto& m = radio.get_metadata())
+            metadata.store(*m);
+        else
+            metadata.reset();
+        metadata_generation.fetch_add(1);
+    }
+
+    if (auto new_info = radio.get_decoder_info()) {
+        auto old = info.load();
+        if (!old || *old != *new_info)
+            info.store(std::move(*new_info));
+    } else if (info.load())
+        info.reset();
+
+    reconnects.store(radio.reconnects);
+
+    timeshift_enabled.store(radio.timeshift.is_enabled());
+    timeshift_delay.store(radio.timeshift.get_delay().count());
+    timeshift_length.store(radio.timeshift.get_length().count());
+}
+
+
+void
+audio_pipeline::update_spectrum()
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (now < next_analysis)
+        return;
+    next_analysis = now + analysis_period;
+    if (spectrum_requested.exchange(false))
+        analysis_expires = now + analysis_timeout;
+    if (now >= analysis_expires)
+        return;
+
+    const auto s = spec.load();
+    if (!s)
+        return;
+
+    TRACE("audio_pipeline::analyze");
+    // Note: the oldest PCM in the ring is what plays next; while paused or buffering, the
+    // output is silence, and so is the analysis.
+    std::size_t size = 0;
+    if (!paused.load() && !buffering.load()) {
+        analyzer_input.resize(analyzer.get_input_size(*s));
+        size = pcm.peek(analyzer_input);
+    }
+    spectrum.store(analyzer.analyze(std::span{analyzer_input}.first(size), *s));
+}
+
+
+bool
+audio_pipeline::apply_timeshift(bool timeshifted)
+{
+    auto& ts = radio.timeshift;
+    ts.set_max_duration(std::chrono::minutes{timeshift_minutes.load()});
+    if (!ts.is_enabled()) {
+        paused.store(false);
+        seek_request.store(0);
+        live_request.store(false);
+        return false;
+    }
+
+    if (paused.load())
+        timeshifted = true;
+
+    bool moved = false;
+    if (live_request.exchange(false)) {
+        ts.go_live();
+        timeshifted = paused.load();
+        moved = true;
+    }
+    if (int delta = seek_request.exchange(0)) {
+        ts.seek(std::chrono::seconds{delta});
+        timeshifted = paused.load() || ts.unread();
+        moved = true;
+    }
+    if (moved)
+        pcm_discard.store(pcm.size());
+
+    return timeshifted;
+}
+
+
+void
+audio_pipeline::adapt_target(unsigned& seen_underruns,
+                             std::chrono::steady_clock::time_point& stable_since)
+{
+    const auto now = std::chrono::steady_clock::now();
+    const unsigned low = low_watermark.load();
+    const unsigned high = std::max(low, high_watermark.load());
+    unsigned target = target_ms.load();
+    if (!target)
+        target = low;
+
+    const unsigned current_underruns = underruns.load();
+    if (current_underruns != seen_underruns) {
+        // grow by 50% after an underrun
+        seen_underruns = current_underruns;
+        target += target / 2;
+        stable_since = now;
+    } else if (now - stable_since >= stable_period) {
+        // shrink by 10% after a stable period
+        target -= target / 10;
+        stable_since = now;
+    }
+
+    target_ms.store(std::clamp(target, low, high));
+}
+
+
+std::size_t
+audio_pipeline::ms_to_bytes(unsigned ms)
+    const noexcept
+{
+    const std::size_t fs = frame_size.load();
+    if (!fs)
+        return 0;
+    std::size_t bytes = bytes_per_second.load() * ms / 1000;
+    // round down to whole frames, never more than the ring can hold
+    bytes -= bytes % fs;
+    return std::min(bytes, pcm.capacity() - pcm.capacity() % fs);
+}
@@ -0,0 +1,301 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef AUDIO_PIPELINE_HPP
+#define AUDIO_PIPELINE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>               // shared_ptr
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "decoder.hpp"
+#include "gain_stage.hpp"
+#include "radio_client.hpp"
+#include "read_mostly.hpp"
+#include "resampler.hpp"
+#include "spectrum_analyzer.hpp"
+#include "spsc_ring.hpp"
+#include "stream_metadata.hpp"
+#include "stream_recorder.hpp"
+#include "thread_safe.hpp"
+
+
+/*
+ * Runs a radio_client and its decoder on a dedicated thread.
+ *
+ * Decoded PCM goes into a lock-free ring, that works as a jitter buffer; the audio output
+ * (consumer) side calls pull(), or read_samples(). Everything else is published as
+ * snapshots, safe to read from any thread.
+ *
+ * The jitter buffer has two watermarks, in milliseconds:
+ *   - pull() outputs silence until the buffer reaches the target; on underrun, it goes
+ *     back to buffering.
+ *   - the decode thread stops receiving and decoding while the buffer is above the high
+ *     watermark (on standby, it keeps receiving; see set_standby()).
+ *
+ * The target starts at the low watermark; it grows after every underrun, and shrinks back
+ * after a long period without underruns, always staying between the two watermarks.
+ *
+ * With timeshift enabled, playback can be paused, rewound and caught up; the compressed
+ * audio is kept in the radio_client's timeshift_buffer. Once the playback is behind live,
+ * the decode thread keeps receiving even while the jitter buffer is full, so the backlog
+ * keeps growing at the live end. Seeking discards the PCM already decoded.
+ *
+ * Decoded blocks are converted to 48 kHz by a resampler, and go through a gain_stage,
+ * before the jitter buffer; get_spec() describes the converted output.
+ *
+ * While someone asks for it, the decode thread also analyzes the PCM about to be played,
+ * about 30 times per second, and publishes the spectrum as a snapshot.
+ */
+struct audio_pipeline {
+
+    audio_pipeline(const std::string& url,
+                   const std::string& url_resolved,
+                   const std::string& user_agent);
+
+    ~audio_pipeline()
+        noexcept;
+
+    // disallow moving
+    audio_pipeline(audio_pipeline&&) = delete;
+
+
+    radio_client::state
+    get_state()
+        const noexcept;
+
+
+    std::optional<decoder::spec>
+    get_spec()
+        const;
+
+
+    // Null if there's no metadata.
+    std::shared_ptr<const stream_metadata>
+    get_metadata()
+        const noexcept;
+
+    // Changes every time the metadata changes.
+    unsigned
+    get_metadata_generation()
+        const noexcept;
+
+
+    // Null if there's no decoder yet.
+    std::shared_ptr<const decoder::info>
+    get_decoder_info()
+        const noexcept;
+
+
+    // Consumer side: how many bytes of PCM are ready.
+    std::size_t
+    available()
+        const noexcept;
+
+    // Consumer side: pop up to buf.size() bytes of PCM, always whole sample frames.
+    std::size_t
+    read_samples(std::span<char> buf)
+        noexcept;
+
+    // Consumer side: fill all of buf, with PCM or silence, following the watermarks.
+    void
+    pull(std::span<char> buf)
+        noexcept;
+
+
+    // Can be called from any thread, takes effect immediately.
+    void
+    set_watermarks(unsigned low_ms,
+                   unsigned high_ms)
+        noexcept;
+
+
+    // A standby pipeline isn't being played yet; once its buffer is full, it keeps
+    // receiving, but only keeps the newest undecoded data, so the connection doesn't stall.
+    // Can be called from any thread.
+    void
+    set_standby(bool enable)
+        noexcept;
+
+
+    bool
+    is_buffering()
+        const noexcept;
+
+
+    unsigned
+    get_buffered_ms()
+        const noexcept;
+
+    unsigned
+    get_target_ms()
+        const noexcept;
+
+    unsigned
+    get_underruns()
+        const noexcept;
+
+    // Undecoded data, waiting in the network buffer.
+    std::size_t
+    get_net_buffered()
+        const noexcept;
+
+    bool
+    is_net_paused()
+        const noexcept;
+
+    radio_client::reconnect_stats
+    get_reconnect_stats()
+        const;
+
+
+    // How much compressed audio to keep for timeshifting; zero disables it. Can be called
+    // from any thread.
+    void
+    set_timeshift(std::chrono::minutes length)
+        noexcept;
+
+    bool
+    is_timeshift_enabled()
+        const noexcept;
+
+    // Only works with timeshift enabled; pull() outputs silence while paused.
+    void
+    set_paused(bool pause)
+        noexcept;
+
+    bool
+    is_paused()
+        const noexcept;
+
+    // Negative rewinds; applied by the decode thread, clamped to what's kept.
+    void
+    seek(std::chrono::seconds delta)
+        noexcept;
+
+    void
+    go_live()
+        noexcept;
+
+    // How far behind live the playback is, in seconds.
+    unsigned
+    get_timeshift_delay()
+        const noexcept;
+
+    // How much can be rewound, in seconds.
+    unsigned
+    get_timeshift_length()
+        const noexcept;
+
+
+    // Can be called from any thread; applies to the next decoded block.
+    void
+    set_gain(float db,
+             bool normalize)
+        noexcept;
+
+    // The total gain, including normalization and limiting.
+    float
+    get_applied_gain_db()
+        const noexcept;
+
+
+    // Keeps the analysis running for about a second; call it every frame the spectrum is
+    // shown.
+    spectrum_analyzer::result
+    get_spectrum()
+        noexcept;
+
+
+    // Applied by the decode thread; null stops recording.
+    void
+    set_recorder(std::shared_ptr<stream_recorder> rec);
+
+private:
+
+    radio_client radio;
+
+    spsc_ring<char> pcm;
+
+    // Note: only the decode thread uses these.
+    resampler resampling;
+    gain_stage gain;
+    spectrum_analyzer analyzer;
+    std::vector<char> analyzer_input;
+    std::chrono::steady_clock::time_point next_analysis{};
+    std::chrono::steady_clock::time_point analysis_expires{};
+    unsigned published_metadata_generation = 0;
+
+    std::atomic<radio_client::state> state;
+    std::atomic<std::size_t> frame_size = 0;
+    std::atomic<std::size_t> bytes_per_second = 0;
+    std::atomic<unsigned> low_watermark = 0;
+    std::atomic<unsigned> high_watermark = 0;
+    std::atomic<bool> buffering = true;
+    std::atomic<bool> standby = false;
+    std::atomic<unsigned> target_ms = 0;
+    std::atomic<unsigned> underruns = 0;
+    std::atomic<std::size_t> net_buffered = 0;
+    std::atomic<bool> net_paused = false;
+    std::atomic<unsigned> timeshift_minutes = 0;
+    std::atomic<bool> timeshift_enabled = false;
+    std::atomic<bool> paused = false;
+    std::atomic<int> seek_request = 0; // seconds
+    std::atomic<bool> live_request = false;
+    // Set by the decode thread after a seek: how much old PCM pull() must drop.
+    std::atomic<std::size_t> pcm_discard = 0;
+    std::atomic<unsigned> timeshift_delay = 0;
+    std::atomic<unsigned> timeshift_length = 0;
+    std::atomic<float> gain_db = 0;
+    std::atomic<bool> normalize = false;
+    std::atomic<float> applied_gain_db = 0;
+    thread_safe<std::shared_ptr<stream_recorder>> recorder_request;
+    std::atomic<bool> recorder_pending = false;
+    std::atomic<bool> spectrum_requested = false;
+    std::atomic<unsigned> metadata_generation = 0;
+    // Note: read by the UI every frame, only written when they change.
+    read_mostly<std::optional<decoder::spec>> spec;
+    read_mostly<stream_metadata> metadata;
+    read_mostly<decoder::info> info;
+    read_mostly<radio_client::reconnect_stats> reconnects;
+    read_mostly<spectrum_analyzer::result> spectrum;
+
+    // Must be the last member, so it's joined before everything else is destroyed.
+    std::jthread decode_thread;
+
+
+    void
+    decode_thread_func(std::stop_token token);
+
+    void
+    publish();
+
+    // Returns true if the playback is behind live.
+    bool
+    apply_timeshift(bool timeshifted);
+
+    void
+    update_spectrum();
+
+    void
+    adapt_target(unsigned& seen_underruns,
+                 std::chrono::steady_clock::time_point& stable_since);
+
+    std::size_t
+    ms_to_bytes(unsigned ms)
+        const noexcept;
+
+}; // struct audio_pipeline
+
+#endif
@@ -0,0 +1,289 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Microbenchmarks for the core data paths, for the desktop build.
+ *
+ * Usage: radiiu-bench [--time MS] [--search-json FILE] [FILTER]
+ *
+ * FILE should be a recorded /json/stations/search response; without it, a synthetic one
+ * with 100 stations is used.
+ *
+ * The results go to stdout, one JSON object per line; log messages go to stderr.
+ */
+
+#include <algorithm>            // min()
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>             // istreambuf_iterator
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glaze/json.hpp>
+
+#include "bench.hpp"
+#include "byte_stream.hpp"
+#include "csv_strings.hpp"
+#include "icy.hpp"
+#include "icy_stream.hpp"
+#include "m3u.hpp"
+#include "mime_type.hpp"
+#include "pls.hpp"
+#include "RadioBrowserAPI.hpp"
+#include "Station.hpp"
+#include "station_arena.hpp"
+
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+using namespace std::literals;
+
+
+namespace {
+
+    std::string
+    make_search_json(std::size_t count)
+    {
+        std::vector<RadioBrowserAPI::Station> stations(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            auto& st = stations[i];
+            auto n = std::to_string(i);
+            st.changeuuid = "9617a958-0601-11e8-ae97-52543be04c81";
+            st.stationuuid = "96202f73-0601-11e8-ae97-52543be04c" + n;
+            st.name = "Example Radio " + n;
+            st.url = "http://stream.example.com:8000/radio" + n + ".pls";
+            st.url_resolved = "http://stream.example.com:8000/radio" + n;
+            st.homepage = "https://www.example.com/";
+            st.favicon = "https://www.example.com/favicon.png";
+            st.tags = "pop,rock,80s,90s,hits,news,talk";
+            st.countrycode = "US";
+            st.iso_3166_2 = "US-NY";
+            st.language = "english,spanish";
+            st.languagecodes = "en,es";
+            st.votes = 1000 + i;
+            st.lastchangetime_iso8601 = "2025-01-30T10:20:30Z";
+            st.codec = i % 2 ? "MP3" : "AAC+";
+            st.bitrate = 128;
+            st.lastcheckok = 1;
+            st.lastchecktime_iso8601 = "2025-02-01T03:04:05Z";
+            st.clickcount = 50 + i;
+            st.clicktrend = -2;
+            st.geo_lat = 40.7;
+            st.geo_long = -74.0;
+            st.has_extended_info = false;
+        }
+        return glz::write_json(stations).value_or("[]");
+    }
+
+
+    // An ICY stream with the given interval; only the second block has metadata.
+    std::string
+    make_icy_stream(std::size_t interval,
+                    std::size_t blocks)
+    {
+        const std::string meta = "StreamTitle='Some Artist - Some Song';StreamUrl='';";
+        const std::size_t meta_blocks = (meta.size() + 15) / 16;
+        std::string result;
+        for (std::size_t i = 0; i < blocks; ++i) {
+            result.append(interval, static_cast<char>(i));
+            if (i == 1) {
+                result += static_cast<char>(meta_blocks);
+                result += meta;
+                result.append(meta_blocks * 16 - meta.size(), '\0');
+            } else
+                result += '\0';
+        }
+        return result;
+    }
+
+
+    void
+    bench_byte_stream()
+    {
+        const std::vector<char> chunk(4096, 'x');
+        std::vector<char> out(chunk.size());
+
+        byte_stream bs;
+        bench::run("byte_stream/write_read", chunk.size(), [&]
+        {
+            bs.write(std::span{chunk});
+            bench::keep(bs.read(std::span{out}));
+        });
+
+        bench::run("byte_stream/write_discard", chunk.size(), [&]
+        {
+            bs.write(std::span{chunk});
+            bench::keep(bs.discard(chunk.size()));
+        });
+
+        // Note: keep a partial chunk stored, so the spans wrap around.
+        bs.clear();
+        bs.write(std::span{chunk}.first(1000));
+        bench::run("byte_stream/readable_spans", chunk.size(), [&]
+        {
+            bs.write(std::span{chunk});
+            std::size_t total = 0;
+            for (auto s : bs.readable_spans())
+                total += s.size();
+            bench::keep(bs.commit_read(chunk.size()));
+            bench::keep(total);
+        });
+    }
+
+
+    void
+    bench_icy()
+    {
+        const std::string meta = "StreamTitle='Some Artist - Some Song';StreamUrl='http://x/';";
+        bench::run("icy/parse", meta.size(), [&]
+        {
+            bench::keep(icy::parse(meta));
+        });
+
+        const std::size_t interval = 16000;
+        const auto input = make_icy_stream(interval, 16);
+        icy::stream stream{interval};
+        bench::run("icy/stream_demux", input.size(), [&]
+        {
+            // Note: deliver it like the network does, in pieces.
+            std::span<const char> data{input};
+            while (!data.empty()) {
+                auto n = std::min<std::size_t>(data.size(), 1460);
+                stream.demux(data.first(n));
+                data = data.subspan(n);
+            }
+            stream.data_stream.clear();
+        });
+    }
+
+
+    void
+    bench_playlists()
+    {
+        std::string m3u = "#EXTM3U\n";
+        std::string pls = "[playlist]\nNumberOfEntries=20\n";
+        for (int i = 1; i <= 20; ++i) {
+            auto n = std::to_string(i);
+            m3u += "#EXTINF:-1,Example Radio " + n + "\n";
+            m3u += "http://stream.example.com:8000/radio" + n + "\n";
+            pls += "File" + n + "=http://stream.example.com:8000/radio" + n + "\n";
+            pls += "Title" + n + "=Example Radio " + n + "\n";
+            pls += "Length" + n + "=-1\n";
+        }
+        pls += "Version=2\n";
+
+        bench::run("m3u/parse", m3u.size(), [&]
+        {
+            bench::keep(m3u::parse(m3u));
+        });
+
+        bench::run("pls/parse", pls.size(), [&]
+        {
+            bench::keep(pls::parse(pls));
+        });
+    }
+
+
+    void
+    bench_csv_strings()
+    {
+        const std::optional<std::string> joined = "pop,rock,80s,90s,hits,news,talk"s;
+        bench::run("csv_strings/round_trip", joined->size(), [&]
+        {
+            csv_strings cs{joined};
+            bench::keep(static_cast<std::optional<std::string>>(cs));
+        });
+    }
+
+
+    void
+    bench_mime_type()
+    {
+        const std::string content_type = "application/vnd.apple.mpegurl; charset=utf-8";
+        const std::vector<std::string> candidates{
+            "audio/mpegurl",
+            "audio/x-mpegurl",
+            "application/vnd.apple.mpegurl",
+        };
+        bench::run("mime_type/match", 0, [&]
+        {
+            bench::keep(mime_type::match(content_type, candidates));
+        });
+
+        enum class kind { m3u, pls, audio };
+        constexpr mime_type::table kinds{
+            mime_type::rule{ "audio/mpegurl",                 kind::m3u   },
+            mime_type::rule{ "audio/x-mpegurl",               kind::m3u   },
+            mime_type::rule{ "application/vnd.apple.mpegurl", kind::m3u   },
+            mime_type::rule{ "audio/x-scpls",                 kind::pls   },
+            mime_type::rule{ "audio/*",                       kind::audio },
+        };
+        bench::run("mime_type/table_lookup", 0, [&]
+        {
+            bench::keep(kinds.lookup(content_type));
+        });
+    }
+
+
+    void
+    bench_station_json(const std::string& json)
+    {
+        station_arena arena;
+        std::vector<std::shared_ptr<Station>> stations;
+        bench::run("station/parse_search_json", json.size(), [&]
+        {
+            Station::from_radio_browser_json(json, arena, stations, 1000);
+            bench::keep(stations.size());
+        });
+    }
+
+} // namespace
+
+
+int main(int argc, char* argv[])
+{
+    std::string search_json;
+
+    std::ostream results{cout.rdbuf()};
+    bench::out = &results;
+    cout.rdbuf(cerr.rdbuf());
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--time" && i + 1 < argc)
+            bench::min_time = std::chrono::milliseconds{std::atoi(argv[++i])};
+        else if (arg == "--search-json" && i + 1 < argc) {
+            std::ifstream in{argv[++i], std::ios::binary};
+            if (!in) {
+                cerr << "Could not open " << argv[i] << endl;
+                return EXIT_FAILURE;
+            }
+            search_json.assign(std::istreambuf_iterator<char>{in}, {});
+        } else
+            bench::filter = arg;
+    }
+
+    if (search_json.empty())
+        search_json = make_search_json(100);
+
+    bench_byte_stream();
+    bench_icy();
+    bench_playlists();
+    bench_csv_strings();
+    bench_mime_type();
+    bench_station_json(search_json);
+
+    cout.rdbuf(results.rdbuf());
+}
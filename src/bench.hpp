@@ -0,0 +1,102 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+
+/*
+ * Minimal timing harness.
+ *
+ * Each benchmark prints one JSON object per line, so results from different builds can be
+ * compared with a script:
+ *
+ *     {"name":"byte_stream/write_read","iterations":1000000,"ns_per_op":12.5,"mib_per_s":780.1}
+ */
+namespace bench {
+
+    using clock = std::chrono::steady_clock;
+
+
+    // How long each benchmark runs, after the warm-up.
+    inline std::chrono::milliseconds min_time{500};
+
+    // Only benchmarks with this in their name run.
+    inline std::string filter;
+
+    // Where the results go; keep the modules' log messages out of it.
+    inline std::ostream* out = &std::cout;
+
+
+    // Keep the compiler from optimizing away a result.
+    template<typename T>
+    inline
+    void
+    keep(const T& value)
+        noexcept
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+
+    /*
+     * Call func() repeatedly, and print the time per call.
+     *
+     * bytes: how much data each call processes, to also print the throughput; zero to
+     * skip it.
+     */
+    template<typename F>
+    void
+    run(std::string_view name,
+        std::size_t bytes,
+        F&& func)
+    {
+        if (!filter.empty() && !name.contains(filter))
+            return;
+
+        // warm-up, also fills the caches and the allocator
+        const auto warmup_end = clock::now() + min_time / 10;
+        while (clock::now() < warmup_end)
+            func();
+
+        // Note: the calls are timed in batches, so reading the clock doesn't dominate.
+        std::uint64_t iterations = 0;
+        std::uint64_t batch = 1;
+        const auto start = clock::now();
+        auto now = start;
+        while (now - start < min_time) {
+            for (std::uint64_t i = 0; i < batch; ++i)
+                func();
+            iterations += batch;
+            if (batch < (1u << 16))
+                batch *= 2;
+            now = clock::now();
+        }
+
+        const double ns = std::chrono::duration<double, std::nano>(now - start).count();
+        const double ns_per_op = ns / iterations;
+
+        *out << "{\"name\":\"" << name << "\""
+             << ",\"iterations\":" << iterations
+             << ",\"ns_per_op\":" << ns_per_op;
+        if (bytes)
+            *out << ",\"mib_per_s\":"
+                 << (bytes * iterations / (1024.0 * 1024.0)) / (ns / 1e9);
+        *out << "}" << std::endl;
+    }
+
+} // namespace bench
+
+#endif
@@ -5,13 +5,56 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <algorithm>            // min(), rotate()
+#include <bit>                  // bit_ceil()
+#include <cstring>              // memcpy()
+#include <utility>              // move(), swap()
+
 #include "byte_stream.hpp"
 
 
+namespace {
+
+    const std::size_t min_capacity = 4096;
+
+} // namespace
+
+
+byte_stream::byte_stream(memory_accounting::tag which)
+    noexcept :
+    buffer{which}
+{}
+
+
+std::size_t
+byte_stream::mask()
+    const noexcept
+{
+    return buffer.size() - 1;
+}
+
+
+void
+byte_stream::grow(std::size_t min_free)
+{
+    const std::size_t sz = size();
+    if (buffer.size() - sz >= min_free)
+        return;
+
+    std::size_t new_cap = std::bit_ceil(std::max(sz + min_free, min_capacity));
+    buffer_type new_buffer(new_cap, buffer.get_allocator());
+    [[maybe_unused]] auto copied = peek(new_buffer.data(), sz);
+    buffer = std::move(new_buffer);
+    head = 0;
+    tail = sz;
+}
+
+
 void
 byte_stream::clear()
+    noexcept
 {
-    data.clear();
+    head = tail = 0;
 }
 
 
@@ -19,7 +62,7 @@ bool
 byte_stream::empty()
     const noexcept
 {
-    return data.empty();
+    return head == tail;
 }
 
 
@@ -27,7 +70,98 @@ std::size_t
 byte_stream::size()
     const noexcept
 {
-    return data.size();
+    return tail - head;
+}
+
+
+std::size_t
+byte_stream::capacity()
+    const noexcept
+{
+    return buffer.size();
+}
+
+
+void
+byte_stream::reserve(std::size_t count)
+{
+    grow(count > size() ? count - size() : 0);
+}
+
+
+byte_stream::const_spans
+byte_stream::readable_spans()
+    const noexcept
+{
+    if (empty())
+        return {};
+
+    const std::size_t sz = size();
+    const std::size_t start = head & mask();
+    const std::size_t first = std::min(sz, buffer.size() - start);
+    return {
+        std::span{buffer.data() + start, first},
+        std::span{buffer.data(), sz - first}
+    };
+}
+
+
+std::size_t
+byte_stream::commit_read(std::size_t count)
+    noexcept
+{
+    count = std::min(count, size());
+    head += count;
+    // when it becomes empty, rewind, so the next write is contiguous
+    if (empty())
+        head = tail = 0;
+    return count;
+}
+
+
+byte_stream::spans
+byte_stream::writable_spans(std::size_t min_free)
+{
+    grow(min_free);
+    if (buffer.empty())
+        return {};
+
+    const std::size_t free = buffer.size() - size();
+    const std::size_t start = tail & mask();
+    const std::size_t first = std::min(free, buffer.size() - start);
+    return {
+        std::span{buffer.data() + start, first},
+        std::span{buffer.data(), free - first}
+    };
+}
+
+
+std::size_t
+byte_stream::commit_write(std::size_t count)
+    noexcept
+{
+    count = std::min(count, buffer.size() - size());
+    tail += count;
+    return count;
+}
+
+
+std::span<const std::byte>
+byte_stream::linearize()
+{
+    if (empty())
+        return {};
+
+    const std::size_t sz = size();
+    const std::size_t start = head & mask();
+    if (start + sz > buffer.size()) {
+        // data wraps around, rotate so it starts at index 0
+        std::rotate(buffer.begin(), buffer.begin() + start, buffer.end());
+        head = 0;
+        tail = sz;
+        return {buffer.data(), sz};
+    }
+    return {buffer.data() + start, sz};
 }
 
 
@@ -36,14 +170,8 @@ byte_stream::read(void* buf,
                   std::size_t count)
     noexcept
 {
-    if (count > size())
-        count = size();
-    auto bbuf = static_cast<std::byte*>(buf);
-    for (std::size_t i = 0; i < count; ++i) {
-        bbuf[i] = data.front();
-        data.pop_front();
-    }
-    return count;
+    count = peek(buf, count);
+    return commit_read(count);
 }
 
 
@@ -64,7 +192,7 @@ byte_stream::read(std::size_t count)
 std::string
 byte_stream::read_str(std::size_t count)
 {
-    std::string result(count, '\0');
+    std::string result(std::min(count, size()), '\0');
     auto sz = read(std::span(result));
     result.resize(sz);
     return result;
@@ -83,11 +211,14 @@ byte_stream::peek(void* buf,
                   std::size_t count)
     const noexcept
 {
+    auto bbuf = static_cast<std::byte*>(buf);
     std::size_t total = 0;
-    for (auto b : data) {
-        if (total >= count)
+    for (auto s : readable_spans()) {
+        std::size_t n = std::min(count - total, s.size());
+        if (!n)
             break;
-        reinterpret_cast<std::byte*>(buf)[total++] = b;
+        std::memcpy(bbuf + total, s.data(), n);
+        total += n;
     }
     return total;
 }
@@ -97,10 +228,7 @@ std::size_t
 byte_stream::discard(std::size_t count)
     noexcept
 {
-    if (count > data.size())
-        count = data.size();
-    data.erase(data.begin(), data.begin() + count);
-    return count;
+    return commit_read(count);
 }
 
 
@@ -109,8 +237,8 @@ byte_stream::try_load_u8()
 {
     if (empty())
         return {};
-    auto x = static_cast<std::uint8_t>(data.front());
-    data.pop_front();
+    auto x = static_cast<std::uint8_t>(buffer[head & mask()]);
+    commit_read(1);
     return x;
 }
 
@@ -120,9 +248,15 @@ byte_stream::write(const void* buf,
                    std::size_t size)
 {
     auto cbuf = static_cast<const std::byte*>(buf);
-    for (std::size_t i = 0; i < size; ++i)
-        data.push_back(cbuf[i]);
-    return size;
+    std::size_t total = 0;
+    for (auto s : writable_spans(size)) {
+        std::size_t n = std::min(size - total, s.size());
+        if (!n)
+            break;
+        std::memcpy(s.data(), cbuf + total, n);
+        total += n;
+    }
+    return commit_write(total);
 }
 
 
@@ -130,18 +264,14 @@ byte_stream::write(const void* buf,
 std::size_t
 byte_stream::write(std::string_view sv)
 {
-    for (char c : sv)
-        data.push_back(std::byte{c});
-    return sv.size();
+    return write(sv.data(), sv.size());
 }
 
 
 std::size_t
 byte_stream::write(const std::string& s)
 {
-    for (char c : s)
-        data.push_back(std::byte{c});
-    return s.size();
+    return write(s.data(), s.size());
 }
 #endif
 
@@ -149,16 +279,7 @@ byte_stream::write(const std::string& s)
 std::size_t
 byte_stream::consume(byte_stream& other)
 {
-    if (this == &other)
-        return 0;
-
-    std::size_t consumed = 0;
-    while (!other.empty()) {
-        data.push_back(other.data.front());
-        other.data.pop_front();
-        ++consumed;
-    }
-    return consumed;
+    return consume(other, other.size());
 }
 
 
@@ -169,11 +290,27 @@ byte_stream::consume(byte_stream& other,
     if (this == &other)
         return 0;
 
-    std::size_t consumed = 0;
-    while (count-- && !other.empty()) {
-        data.push_back(other.data.front());
-        other.data.pop_front();
-        ++consumed;
+    count = std::min(count, other.size());
+    if (!count)
+        return 0;
+
+    // if this is empty and will take everything, just swap the buffers
+    if (empty() && count == other.size()) {
+        std::swap(buffer, other.buffer);
+        std::swap(head, other.head);
+        std::swap(tail, other.tail);
+        other.clear();
+        return count;
     }
-    return consumed;
+
+    std::size_t total = 0;
+    for (auto s : other.readable_spans()) {
+        std::size_t n = std::min(count - total, s.size());
+        if (!n)
+            break;
+        write(s.data(), n);
+        total += n;
+    }
+    other.commit_read(total);
+    return total;
 }
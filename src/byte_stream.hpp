@@ -8,23 +8,74 @@
 #ifndef BYTE_STREAM_HPP
 #define BYTE_STREAM_HPP
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
-#include <deque>
 #include <optional>
 #include <span>
 #include <string>
 #include <vector>
 
+#include "memory_accounting.hpp"
 
+
+/*
+ * A FIFO of bytes, stored in a power-of-two ring buffer.
+ *
+ * The buffer only grows; clear() keeps the capacity, so a stream that reaches a steady
+ * state stops allocating.
+ *
+ * Besides the copying API (read(), peek(), write(), consume()), the stored bytes can be
+ * accessed in place:
+ *
+ *   - readable_spans() returns the stored bytes as (at most) two spans; after using them,
+ *     call commit_read() to drop the bytes that were used.
+ *
+ *   - writable_spans() returns free space as (at most) two spans; after filling them, call
+ *     commit_write() to append the bytes that were written.
+ *
+ *   - linearize() moves the stored bytes so they are contiguous, and returns them as a
+ *     single span.
+ *
+ * Any non-const operation invalidates spans previously obtained.
+ *
+ * The buffer is charged to a memory_accounting tag; consume() may swap buffers, and then
+ * each buffer keeps its original tag.
+ */
 class byte_stream {
 
-    std::deque<std::byte> data;
+    using buffer_type = std::vector<std::byte, memory_accounting::allocator<std::byte>>;
+
+    // size is always zero or a power of two
+    buffer_type buffer{memory_accounting::tag::streams};
+    std::size_t head = 0;          // read position, not wrapped
+    std::size_t tail = 0;          // write position, not wrapped
+
+
+    std::size_t
+    mask()
+        const noexcept;
+
+    void
+    grow(std::size_t min_free);
 
 public:
 
+    using const_spans = std::array<std::span<const std::byte>, 2>;
+    using spans       = std::array<std::span<std::byte>, 2>;
+
+
+    byte_stream()
+        noexcept = default;
+
+    explicit
+    byte_stream(memory_accounting::tag which)
+        noexcept;
+
+
     void
-    clear();
+    clear()
+        noexcept;
 
 
     bool
@@ -33,6 +84,39 @@ public:
     std::size_t
     size() const noexcept;
 
+    std::size_t
+    capacity() const noexcept;
+
+
+    // Ensure at least `count` bytes can be written without reallocating.
+    void
+    reserve(std::size_t count);
+
+
+    [[nodiscard]]
+    const_spans
+    readable_spans()
+        const noexcept;
+
+    std::size_t
+    commit_read(std::size_t count)
+        noexcept;
+
+
+    // Ensure at least `min_free` bytes of free space exist, and return all free space.
+    [[nodiscard]]
+    spans
+    writable_spans(std::size_t min_free = 0);
+
+    std::size_t
+    commit_write(std::size_t count)
+        noexcept;
+
+
+    [[nodiscard]]
+    std::span<const std::byte>
+    linearize();
+
 
     std::size_t
     read(void* buf,
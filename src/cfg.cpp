@@ -67,7 +67,7 @@ namespace cfg {
     {
         try {
             auto filename = App::get_config_path() / "settings.json";
-            Serializer::save(state, filename);
+            Serializer::save_async(state, filename);
         }
         catch (std::exception& e) {
             cout << "Error saving settings: " << e.what() << endl;
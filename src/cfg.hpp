@@ -18,20 +18,38 @@
 namespace cfg {
 
     struct State {
-        unsigned    browser_page_limit   = 20;
-        bool        disable_apd          = true;
-        bool        disable_swkbd        = false;
-        bool        inactive_screen_off  = false;
-        TabID       initial_tab          = TabID::browser;
-        unsigned    player_buffer_size   = 8;
-        unsigned    player_history_limit = 20;
-        bool        remember_tab         = true;
-        unsigned    recent_limit         = 10;
-        unsigned    screen_saver_timeout = 120;
-        bool        send_clicks          = false;
-        std::string server               = {};
-        std::string style                = {};
-        bool        switch_to_player     = false;
+        unsigned    browser_page_limit    = 20;
+        bool        capture_streams       = false;
+        bool        check_favorites       = true;
+        bool        disable_apd           = true;
+        bool        disable_swkbd         = false;
+        unsigned    icon_memory_budget    = 16; // MiB
+        unsigned    icon_video_budget     = 32; // MiB
+        bool        inactive_screen_off   = false;
+        TabID       initial_tab           = TabID::browser;
+        bool        native_http           = false;
+        bool        normalize_loudness    = false;
+        bool        offline_index         = false;
+        unsigned    player_high_watermark = 2000;
+        unsigned    player_history_limit  = 20;
+        unsigned    player_low_watermark  = 500;
+        bool        player_standby        = true;
+        bool        remember_tab          = true;
+        unsigned    recent_limit          = 10;
+        std::string recording_dir         = {}; // empty: config path / "recordings"
+        unsigned    scan_seconds          = 10;
+        unsigned    screen_saver_timeout  = 120;
+        bool        send_clicks           = false;
+        std::string server                = {};
+        bool        show_profiler         = false;
+        bool        show_stats            = false;
+        bool        show_visualizer       = true;
+        unsigned    stats_log_interval    = 0; // seconds
+        bool        stream_socket_tuning  = true;
+        std::string style                 = {};
+        bool        switch_to_player      = false;
+        unsigned    timeshift_minutes     = 10;
+        bool        tracing               = false;
     };
 
     extern State state;
@@ -0,0 +1,545 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Contention and stress benchmark for async_queue and thread_safe.
+ *
+ * Usage: radiiu-contention-bench [--items N] [--threads N] [--rounds N] [FILTER]
+ *
+ * Several producers and consumers hammer one queue (or one thread_safe), and every item
+ * is checked off when it arrives, so lost or duplicated items are detected. A watchdog
+ * reports a stall when nothing arrives for a while but items are still missing: that's
+ * what a lost wakeup looks like.
+ *
+ * The results go to stdout, one JSON object per line; latencies are in microseconds. The
+ * exit status is non-zero if any check failed.
+ *
+ * On the Wii U, run it with "make contention-bench"; the results go to the log.
+ */
+
+#include <algorithm>            // max(), min(), sort()
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>              // atoi()
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef __WIIU__
+#include <coreinit/thread.h>
+#include <coreinit/time.h>
+#include <whb/proc.h>
+#endif
+
+#include "async_queue.hpp"
+#include "bench.hpp"
+#include "thread_safe.hpp"
+
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+using namespace std::literals;
+
+
+namespace {
+
+    using clock = std::chrono::steady_clock;
+
+
+    struct options {
+        std::size_t items = 100'000;       // per producer
+        unsigned threads = 4;              // max producers/consumers
+        unsigned rounds = 200;             // for stop()/reset()
+    };
+
+    options opts;
+
+
+    // No progress for this long, with items still missing, is a stall.
+    const auto stall_timeout = 2s;
+
+    bool failed = false;
+
+
+    double
+    percentile(const std::vector<double>& sorted,
+               double p)
+    {
+        if (sorted.empty())
+            return 0;
+        auto idx = static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[idx];
+    }
+
+
+    double
+    to_us(clock::duration d)
+    {
+        return std::chrono::duration<double, std::micro>(d).count();
+    }
+
+
+    double
+    seconds_since(clock::time_point start)
+    {
+        return std::chrono::duration<double>(clock::now() - start).count();
+    }
+
+
+    // Per-thread samples, merged at the end; one vector per thread, so recording is free.
+    struct latencies {
+
+        std::vector<std::vector<double>> per_thread;
+
+        explicit
+        latencies(unsigned threads,
+                  std::size_t reserve) :
+            per_thread(threads)
+        {
+            for (auto& v : per_thread)
+                v.reserve(reserve);
+        }
+
+
+        std::vector<double>
+        merge()
+        {
+            std::vector<double> all;
+            for (auto& v : per_thread)
+                all.insert(all.end(), v.begin(), v.end());
+            std::sort(all.begin(), all.end());
+            return all;
+        }
+
+    }; // struct latencies
+
+
+    void
+    report(std::string_view name,
+           std::uint64_t ops,
+           double seconds,
+           std::vector<double> sorted,
+           std::string_view extra = {})
+    {
+        *bench::out << "{\"name\":\"" << name << "\""
+                    << ",\"ops\":" << ops
+                    << ",\"ops_per_s\":" << (seconds > 0 ? ops / seconds : 0)
+                    << ",\"p50_us\":" << percentile(sorted, 0.50)
+                    << ",\"p99_us\":" << percentile(sorted, 0.99)
+                    << ",\"p999_us\":" << percentile(sorted, 0.999)
+                    << ",\"max_us\":" << (sorted.empty() ? 0 : sorted.back())
+                    << extra
+                    << "}" << endl;
+    }
+
+
+    bool
+    selected(std::string_view name)
+    {
+        return bench::filter.empty() || name.contains(bench::filter);
+    }
+
+
+    struct item {
+        std::uint32_t producer;
+        std::uint32_t seq;
+        clock::time_point pushed;
+    };
+
+
+    enum class push_mode {
+        push,
+        try_push,
+    };
+
+    enum class pop_mode {
+        pop,
+        try_pop,
+        try_pop_for,
+    };
+
+
+    const char*
+    to_string(push_mode m)
+    {
+        return m == push_mode::push ? "push" : "try_push";
+    }
+
+
+    const char*
+    to_string(pop_mode m)
+    {
+        switch (m) {
+            case pop_mode::pop:
+                return "pop";
+            case pop_mode::try_pop:
+                return "try_pop";
+            case pop_mode::try_pop_for:
+                return "try_pop_for";
+        }
+        return "?";
+    }
+
+
+    /*
+     * Producers push opts.items each; consumers pop until everything arrived, then the
+     * queue is stopped. Latency is from push to pop.
+     */
+    void
+    run_queue(unsigned producers,
+              unsigned consumers,
+              push_mode pmode,
+              pop_mode cmode)
+    {
+        const std::string name = "async_queue/"s
+            + to_string(pmode) + "+" + to_string(cmode) + "/"
+            + std::to_string(producers) + "x" + std::to_string(consumers);
+        if (!selected(name))
+            return;
+
+        async_queue<item> queue;
+        const std::size_t expected = producers * opts.items;
+        // Note: one flag per item, to catch duplicates.
+        std::unique_ptr<std::atomic<bool>[]> seen{new std::atomic<bool>[expected]{}};
+        std::atomic<std::size_t> received = 0;
+        std::atomic<std::size_t> duplicates = 0;
+        std::atomic<std::uint64_t> push_retries = 0;
+        std::atomic<std::uint64_t> pop_misses = 0;
+        latencies lat{consumers, expected / consumers + 1};
+
+        auto consume = [&](unsigned id)
+        {
+            auto& samples = lat.per_thread[id];
+            auto take = [&](const item& it)
+            {
+                samples.push_back(to_us(clock::now() - it.pushed));
+                if (seen[it.producer * opts.items + it.seq].exchange(true))
+                    ++duplicates;
+                ++received;
+            };
+            for (;;) {
+                switch (cmode) {
+                    case pop_mode::pop:
+                        try {
+                            take(queue.pop());
+                        }
+                        catch (async_queue_error) {
+                            return;
+                        }
+                        break;
+                    case pop_mode::try_pop:
+                    case pop_mode::try_pop_for: {
+                        auto r = cmode == pop_mode::try_pop
+                            ? queue.try_pop()
+                            : queue.try_pop_for(1ms);
+                        if (r)
+                            take(*r);
+                        else if (r.error() == async_queue_error::stop)
+                            return;
+                        else {
+                            ++pop_misses;
+                            std::this_thread::yield();
+                        }
+                        break;
+                    }
+                }
+            }
+        };
+
+        auto produce = [&](unsigned id)
+        {
+            for (std::uint32_t seq = 0; seq < opts.items; ++seq) {
+                if (pmode == push_mode::push)
+                    queue.push(item{id, seq, clock::now()});
+                else
+                    while (!queue.try_push(item{id, seq, clock::now()})) {
+                        ++push_retries;
+                        std::this_thread::yield();
+                    }
+            }
+        };
+
+        const auto start = clock::now();
+        std::vector<std::jthread> threads;
+        for (unsigned i = 0; i < consumers; ++i)
+            threads.emplace_back(consume, i);
+        for (unsigned i = 0; i < producers; ++i)
+            threads.emplace_back(produce, i);
+
+        // Watchdog.
+        unsigned stalls = 0;
+        std::size_t last_received = 0;
+        auto last_progress = clock::now();
+        while (received < expected) {
+            std::this_thread::sleep_for(1ms);
+            const auto now = clock::now();
+            const std::size_t r = received;
+            if (r != last_received) {
+                last_received = r;
+                last_progress = now;
+            } else if (now - last_progress > stall_timeout) {
+                ++stalls;
+                cerr << name << ": stalled at " << r << "/" << expected
+                     << " items, queue " << (queue.empty() ? "empty" : "not empty")
+                     << endl;
+                break;
+            }
+        }
+        const double seconds = seconds_since(start);
+
+        queue.stop();
+        threads.clear();
+
+        const std::size_t lost = expected - received;
+        if (lost || duplicates || stalls)
+            failed = true;
+
+        const std::string extra = ",\"lost\":" + std::to_string(lost)
+            + ",\"duplicates\":" + std::to_string(duplicates)
+            + ",\"stalls\":" + std::to_string(stalls)
+            + ",\"push_retries\":" + std::to_string(push_retries)
+            + ",\"pop_misses\":" + std::to_string(pop_misses);
+        report(name, received, seconds, lat.merge(), extra);
+    }
+
+
+    /*
+     * Consumers block in pop(), then stop() must wake all of them; after reset(), the
+     * queue must work again. Latency is from stop() to each consumer returning.
+     */
+    void
+    run_stop_reset(unsigned consumers)
+    {
+        const std::string name = "async_queue/stop_reset/" + std::to_string(consumers);
+        if (!selected(name))
+            return;
+
+        // Note: shared with the threads, so a stuck one can be abandoned safely.
+        struct state {
+            async_queue<int> queue;
+            std::atomic<unsigned> got = 0;
+            std::atomic<unsigned> woken = 0;
+            std::atomic<clock::rep> stop_time = 0;
+            std::vector<double> wake;
+            std::mutex wake_mutex;
+        };
+        auto st = std::make_shared<state>();
+
+        unsigned stuck = 0;
+        unsigned bad_rounds = 0;
+        const auto start = clock::now();
+
+        for (unsigned round = 0; round < opts.rounds; ++round) {
+            st->got = 0;
+            st->woken = 0;
+
+            std::vector<std::jthread> threads;
+            for (unsigned i = 0; i < consumers; ++i)
+                threads.emplace_back([st]
+                {
+                    try {
+                        for (;;)
+                            if (st->queue.pop() == 42)
+                                ++st->got;
+                    }
+                    catch (async_queue_error) {
+                        const clock::time_point t{clock::duration{st->stop_time.load()}};
+                        const double us = to_us(clock::now() - t);
+                        std::lock_guard guard{st->wake_mutex};
+                        st->wake.push_back(us);
+                    }
+                    ++st->woken;
+                });
+
+            for (unsigned i = 0; i < consumers; ++i)
+                st->queue.push(42);
+
+            // Note: stop() discards queued items, so wait until they were all taken.
+            auto deadline = clock::now() + stall_timeout;
+            while (st->got < consumers && clock::now() < deadline)
+                std::this_thread::sleep_for(100us);
+            if (st->got < consumers)
+                ++bad_rounds;
+
+            st->stop_time = clock::now().time_since_epoch().count();
+            st->queue.stop();
+
+            deadline = clock::now() + stall_timeout;
+            while (st->woken < consumers && clock::now() < deadline)
+                std::this_thread::sleep_for(100us);
+            if (st->woken < consumers) {
+                ++stuck;
+                cerr << name << ": round " << round << ": only " << st->woken << "/"
+                     << consumers << " consumers woke up" << endl;
+                // Note: the threads can't be joined; give up on this test.
+                for (auto& t : threads)
+                    t.detach();
+                break;
+            }
+            threads.clear();
+            st->queue.reset();
+        }
+        const double seconds = seconds_since(start);
+
+        if (stuck || bad_rounds)
+            failed = true;
+
+        std::vector<double> wake;
+        {
+            std::lock_guard guard{st->wake_mutex};
+            wake = st->wake;
+        }
+        std::sort(wake.begin(), wake.end());
+        const std::size_t wakeups = wake.size();
+        const std::string extra = ",\"stuck\":" + std::to_string(stuck)
+            + ",\"bad_rounds\":" + std::to_string(bad_rounds);
+        report(name, wakeups, seconds, std::move(wake), extra);
+    }
+
+
+    struct shared_data {
+        std::uint64_t value = 0;
+        std::uint64_t checksum = 0;
+    };
+
+
+    /*
+     * Threads increment a shared counter through lock() or try_lock(). Latency is how
+     * long it took to acquire the lock.
+     */
+    void
+    run_thread_safe(unsigned threads_count,
+                    bool use_try_lock)
+    {
+        const std::string name = "thread_safe/"s + (use_try_lock ? "try_lock" : "lock")
+            + "/" + std::to_string(threads_count);
+        if (!selected(name))
+            return;
+
+        thread_safe<shared_data> data;
+        std::atomic<std::uint64_t> failures = 0;
+        latencies lat{threads_count, opts.items};
+
+        auto work = [&](unsigned id)
+        {
+            auto& samples = lat.per_thread[id];
+            for (std::size_t i = 0; i < opts.items; ++i) {
+                const auto t0 = clock::now();
+                for (;;) {
+                    auto guard = use_try_lock ? data.try_lock() : data.lock();
+                    if (guard) {
+                        samples.push_back(to_us(clock::now() - t0));
+                        ++guard->value;
+                        guard->checksum += id + 1;
+                        break;
+                    }
+                    ++failures;
+                    std::this_thread::yield();
+                }
+            }
+        };
+
+        const auto start = clock::now();
+        {
+            std::vector<std::jthread> threads;
+            for (unsigned i = 0; i < threads_count; ++i)
+                threads.emplace_back(work, i);
+        }
+        const double seconds = seconds_since(start);
+
+        const auto result = data.load();
+        const std::uint64_t expected = threads_count * opts.items;
+        const std::uint64_t expected_checksum
+            = opts.items * threads_count * (threads_count + 1) / 2;
+        const bool ok = result.value == expected && result.checksum == expected_checksum;
+        if (!ok)
+            failed = true;
+
+        const std::string extra = ",\"ok\":"s + (ok ? "true" : "false")
+            + ",\"try_lock_failures\":" + std::to_string(failures);
+        report(name, result.value, seconds, lat.merge(), extra);
+    }
+
+
+    void
+    run_all()
+    {
+        std::vector<unsigned> counts{1};
+        for (unsigned n = 2; n <= opts.threads; n *= 2)
+            counts.push_back(n);
+        if (counts.back() != opts.threads)
+            counts.push_back(opts.threads);
+
+        for (unsigned n : counts) {
+            run_queue(n, n, push_mode::push, pop_mode::pop);
+            run_queue(n, n, push_mode::try_push, pop_mode::pop);
+            run_queue(n, n, push_mode::push, pop_mode::try_pop);
+            run_queue(n, n, push_mode::push, pop_mode::try_pop_for);
+        }
+        // Unbalanced: many producers feeding one consumer, like the icon worker.
+        run_queue(opts.threads, 1, push_mode::push, pop_mode::pop);
+        run_queue(1, opts.threads, push_mode::push, pop_mode::pop);
+
+        for (unsigned n : counts)
+            run_stop_reset(n);
+
+        for (unsigned n : counts) {
+            run_thread_safe(n, false);
+            run_thread_safe(n, true);
+        }
+    }
+
+} // namespace
+
+
+int main(int argc, char* argv[])
+{
+#ifdef __WIIU__
+    WHBProcInit();
+    // Note: the console has three cores.
+    opts.items = 20'000;
+    opts.threads = 3;
+#endif
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--items" && i + 1 < argc)
+            opts.items = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc)
+            opts.threads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--rounds" && i + 1 < argc)
+            opts.rounds = std::max(1, std::atoi(argv[++i]));
+        else
+            bench::filter = arg;
+    }
+
+    std::ostream results{cout.rdbuf()};
+    bench::out = &results;
+    cout.rdbuf(cerr.rdbuf());
+
+    run_all();
+
+    cout.rdbuf(results.rdbuf());
+
+#ifdef __WIIU__
+    cout << (failed ? "FAILED" : "OK") << "; press HOME to exit." << endl;
+    while (WHBProcIsRunning())
+        OSSleepTicks(OSMillisecondsToTicks(100));
+    WHBProcShutdown();
+#endif
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
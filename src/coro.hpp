@@ -0,0 +1,680 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CORO_HPP
+#define CORO_HPP
+
+#include <atomic>
+#include <concepts>             // convertible_to, derived_from
+#include <coroutine>
+#include <exception>
+#include <functional>           // move_only_function
+#include <iostream>
+#include <memory>               // make_shared(), shared_ptr, weak_ptr
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <tuple>
+#include <type_traits>
+#include <utility>              // exchange(), forward(), move()
+#include <vector>
+
+#include "scheduler.hpp"
+
+
+/*
+ * Coroutines for the main thread.
+ *
+ * A coro::task<T> is lazy: it only runs when it's co_await'ed, start()ed or detach()ed.
+ * Callback-based APIs are awaited through coro::from_callbacks(); their callbacks may be
+ * invoked from any thread, but the coroutine is always resumed from
+ * scheduler::run_main(), so coroutine code runs on the main thread, like rest and
+ * RadioBrowserAPI callbacks.
+ *
+ * Each task chain shares one stop token. When a stop is requested, whatever is being
+ * awaited is canceled, and co_await throws coro::canceled_error. Destroying a suspended
+ * task also cancels what it was waiting for, but without resuming it.
+ */
+namespace coro {
+
+    struct canceled_error : std::runtime_error {
+
+        canceled_error() :
+            std::runtime_error{"canceled"}
+        {}
+
+    }; // struct canceled_error
+
+
+    template<typename T = void>
+    class task;
+
+
+    namespace detail {
+
+        struct promise_base {
+
+            std::coroutine_handle<> continuation;
+            std::stop_token stop_token;
+            // Only used by the root of a chain, see task::start().
+            std::stop_source stop_source{std::nostopstate};
+            std::exception_ptr exception;
+            bool started = false;
+            bool detached = false;
+
+
+            std::suspend_always
+            initial_suspend()
+                noexcept
+            {
+                return {};
+            }
+
+
+            struct final_awaiter {
+
+                bool
+                await_ready()
+                    noexcept
+                {
+                    return false;
+                }
+
+
+                template<typename P>
+                std::coroutine_handle<>
+                await_suspend(std::coroutine_handle<P> h)
+                    noexcept
+                {
+                    auto& p = h.promise();
+                    if (p.continuation)
+                        return p.continuation;
+                    if (p.detached) {
+                        p.report();
+                        h.destroy();
+                    }
+                    return std::noop_coroutine();
+                }
+
+
+                void
+                await_resume()
+                    noexcept
+                {}
+
+            }; // struct final_awaiter
+
+
+            final_awaiter
+            final_suspend()
+                noexcept
+            {
+                return {};
+            }
+
+
+            void
+            unhandled_exception()
+                noexcept
+            {
+                exception = std::current_exception();
+            }
+
+
+            // Nobody is going to see the exception of a detached task, so print it.
+            void
+            report()
+                noexcept
+            {
+                if (!exception)
+                    return;
+                try {
+                    std::rethrow_exception(exception);
+                }
+                catch (canceled_error&) {}
+                catch (std::exception& e) {
+                    std::cout << "ERROR: detached coroutine failed: " << e.what()
+                              << std::endl;
+                }
+            }
+
+        }; // struct promise_base
+
+
+        template<typename T>
+        struct promise : promise_base {
+
+            std::optional<T> value;
+
+
+            task<T>
+            get_return_object()
+                noexcept;
+
+
+            template<typename U>
+            requires(std::convertible_to<U&&, T>)
+            void
+            return_value(U&& v)
+            {
+                value.emplace(std::forward<U>(v));
+            }
+
+
+            T
+            take_result()
+            {
+                if (exception)
+                    std::rethrow_exception(exception);
+                return std::move(*value);
+            }
+
+        }; // struct promise<T>
+
+
+        template<>
+        struct promise<void> : promise_base {
+
+            task<void>
+            get_return_object()
+                noexcept;
+
+
+            void
+            return_void()
+                noexcept
+            {}
+
+
+            void
+            take_result()
+            {
+                if (exception)
+                    std::rethrow_exception(exception);
+            }
+
+        }; // struct promise<void>
+
+
+        template<typename P>
+        concept task_promise = std::derived_from<P, promise_base>;
+
+    } // namespace detail
+
+
+    template<typename T>
+    class [[nodiscard]] task {
+
+    public:
+
+        using promise_type = detail::promise<T>;
+
+    private:
+
+        std::coroutine_handle<promise_type> handle;
+
+        friend promise_type;
+
+        explicit
+        task(std::coroutine_handle<promise_type> h)
+            noexcept :
+            handle{h}
+        {}
+
+
+        struct awaiter {
+
+            std::coroutine_handle<promise_type> handle;
+
+
+            bool
+            await_ready()
+                const noexcept
+            {
+                return !handle || handle.done();
+            }
+
+
+            template<detail::task_promise P>
+            std::coroutine_handle<>
+            await_suspend(std::coroutine_handle<P> parent)
+                noexcept
+            {
+                auto& p = handle.promise();
+                p.continuation = parent;
+                if (p.started)
+                    return std::noop_coroutine();
+                p.started = true;
+                p.stop_token = parent.promise().stop_token;
+                return handle;
+            }
+
+
+            T
+            await_resume()
+            {
+                if (!handle)
+                    throw std::logic_error{"awaiting an empty coro::task"};
+                return handle.promise().take_result();
+            }
+
+        }; // struct awaiter
+
+    public:
+
+        task()
+            noexcept = default;
+
+
+        task(task&& other)
+            noexcept :
+            handle{std::exchange(other.handle, {})}
+        {}
+
+
+        task&
+        operator =(task&& other)
+            noexcept
+        {
+            if (this != &other) {
+                if (handle)
+                    handle.destroy();
+                handle = std::exchange(other.handle, {});
+            }
+            return *this;
+        }
+
+
+        ~task()
+            noexcept
+        {
+            if (handle)
+                handle.destroy();
+        }
+
+
+        [[nodiscard]]
+        bool
+        done()
+            const noexcept
+        {
+            return !handle || handle.done();
+        }
+
+
+        /*
+         * Run it until the first suspension point. Without a stop token, the task gets its
+         * own, for request_stop().
+         */
+        void
+        start(std::stop_token token = {})
+        {
+            if (!handle)
+                return;
+            auto& p = handle.promise();
+            if (p.started)
+                return;
+            p.started = true;
+            if (!token.stop_possible()) {
+                p.stop_source = std::stop_source{};
+                token = p.stop_source.get_token();
+            }
+            p.stop_token = std::move(token);
+            handle.resume();
+        }
+
+
+        // Only works on a task started without an external stop token.
+        void
+        request_stop()
+            noexcept
+        {
+            if (handle)
+                handle.promise().stop_source.request_stop();
+        }
+
+
+        // Let it run to completion without an owner; exceptions get printed.
+        void
+        detach() &&
+        {
+            if (!handle)
+                return;
+            start();
+            auto h = std::exchange(handle, {});
+            if (h.done()) {
+                h.promise().report();
+                h.destroy();
+            } else
+                h.promise().detached = true;
+        }
+
+
+        awaiter
+        operator co_await()
+            const noexcept
+        {
+            return awaiter{handle};
+        }
+
+    }; // class task
+
+
+    namespace detail {
+
+        template<typename T>
+        task<T>
+        promise<T>::get_return_object()
+            noexcept
+        {
+            return task<T>{std::coroutine_handle<promise<T>>::from_promise(*this)};
+        }
+
+
+        inline
+        task<void>
+        promise<void>::get_return_object()
+            noexcept
+        {
+            return task<void>{std::coroutine_handle<promise<void>>::from_promise(*this)};
+        }
+
+    } // namespace detail
+
+
+    // co_await get_stop_token() gives the stop token of the current task chain.
+    struct get_stop_token {
+
+        std::stop_token token;
+
+
+        bool
+        await_ready()
+            const noexcept
+        {
+            return false;
+        }
+
+
+        template<detail::task_promise P>
+        bool
+        await_suspend(std::coroutine_handle<P> h)
+            noexcept
+        {
+            token = h.promise().stop_token;
+            return false; // don't actually suspend
+        }
+
+
+        std::stop_token
+        await_resume()
+            noexcept
+        {
+            return std::move(token);
+        }
+
+    }; // struct get_stop_token
+
+
+    // Called to cancel the operation; it's fine if it's empty.
+    using canceler_t = std::move_only_function<void()>;
+
+    using reject_t = std::move_only_function<void(const std::exception&)>;
+
+    namespace detail {
+
+        template<typename T>
+        struct resolve_sig {
+            using type = void (T);
+        };
+
+        template<>
+        struct resolve_sig<void> {
+            using type = void ();
+        };
+
+    } // namespace detail
+
+    template<typename T = void>
+    using resolve_t = std::move_only_function<typename detail::resolve_sig<T>::type>;
+
+    template<typename T = void>
+    using starter_t = std::move_only_function<canceler_t(resolve_t<T>, reject_t)>;
+
+
+    namespace detail {
+
+        template<typename T>
+        struct value_holder {
+            std::optional<T> value;
+        };
+
+        template<>
+        struct value_holder<void> {};
+
+
+        template<typename T>
+        struct callback_state : value_holder<T> {
+
+            // Cleared when the awaiting coroutine is gone.
+            std::coroutine_handle<> handle;
+            std::exception_ptr exception;
+            canceler_t canceler;
+            // Note: resolve and reject may be called from any thread.
+            std::atomic<bool> finished = false;
+
+
+            static
+            void
+            resume_later(std::shared_ptr<callback_state> st)
+            {
+                scheduler::post_main(scheduler::category::misc,
+                                     [st = std::move(st)]
+                                     {
+                                         if (auto h = std::exchange(st->handle, {}))
+                                             h.resume();
+                                     });
+            }
+
+
+            /*
+             * Prefer the exception being handled, if it's the one being reported, so the
+             * awaiting coroutine catches it with its real type.
+             */
+            static
+            std::exception_ptr
+            capture(const std::exception& e)
+            {
+                if (auto current = std::current_exception()) {
+                    try {
+                        std::rethrow_exception(current);
+                    }
+                    catch (const std::exception& c) {
+                        if (&c == &e)
+                            return current;
+                    }
+                    catch (...) {}
+                }
+                return std::make_exception_ptr(std::runtime_error{e.what()});
+            }
+
+        }; // struct callback_state
+
+
+        template<typename T>
+        class callback_awaiter {
+
+            using state_t = callback_state<T>;
+
+            std::shared_ptr<state_t> st;
+            starter_t<T> starter;
+            std::optional<std::stop_callback<std::move_only_function<void()>>> on_stop;
+
+        public:
+
+            explicit
+            callback_awaiter(starter_t<T> s) :
+                st{std::make_shared<state_t>()},
+                starter{std::move(s)}
+            {}
+
+            // disallow moving, the state must not be shared with a moved-from awaiter
+            callback_awaiter(callback_awaiter&&) = delete;
+
+
+            ~callback_awaiter()
+                noexcept
+            {
+                on_stop.reset();
+                st->handle = {};
+                if (!st->finished.exchange(true)) {
+                    if (st->canceler)
+                        st->canceler();
+                }
+                // Note: the canceler often holds the request that holds the callbacks.
+                st->canceler = nullptr;
+            }
+
+
+            bool
+            await_ready()
+                const noexcept
+            {
+                return false;
+            }
+
+
+            template<task_promise P>
+            void
+            await_suspend(std::coroutine_handle<P> h)
+            {
+                st->handle = h;
+
+                resolve_t<T> resolve;
+                if constexpr (std::is_void_v<T>)
+                    resolve = [st = st]
+                    {
+                        if (st->finished.exchange(true))
+                            return;
+                        state_t::resume_later(st);
+                    };
+                else
+                    resolve = [st = st](T value)
+                    {
+                        if (st->finished.exchange(true))
+                            return;
+                        st->value.emplace(std::move(value));
+                        state_t::resume_later(st);
+                    };
+
+                reject_t reject = [st = st](const std::exception& e)
+                {
+                    if (st->finished.exchange(true))
+                        return;
+                    st->exception = state_t::capture(e);
+                    state_t::resume_later(st);
+                };
+
+                // Note: callbacks may be invoked before the starter returns.
+                st->canceler = starter(std::move(resolve), std::move(reject));
+
+                auto token = h.promise().stop_token;
+                if (token.stop_possible()) {
+                    // Note: the stop can be requested from any thread.
+                    std::weak_ptr<state_t> weak = st;
+                    on_stop.emplace(std::move(token),
+                                    [weak]
+                                    {
+                                        auto st = weak.lock();
+                                        if (!st)
+                                            return;
+                                        scheduler::post_main(
+                                            scheduler::category::misc,
+                                            [st]
+                                            {
+                                                if (st->finished.exchange(true))
+                                                    return;
+                                                if (st->canceler)
+                                                    st->canceler();
+                                                st->exception =
+                                                    std::make_exception_ptr(canceled_error{});
+                                                if (auto h = std::exchange(st->handle, {}))
+                                                    h.resume();
+                                            });
+                                    });
+                }
+            }
+
+
+            T
+            await_resume()
+            {
+                if (st->exception)
+                    std::rethrow_exception(st->exception);
+                if constexpr (!std::is_void_v<T>)
+                    return std::move(*st->value);
+            }
+
+        }; // class callback_awaiter
+
+    } // namespace detail
+
+
+    /*
+     * Await a callback-based operation. The starter is called with the resolve and reject
+     * callbacks, and returns how to cancel the operation (or an empty canceler).
+     */
+    template<typename T = void>
+    task<T>
+    from_callbacks(starter_t<T> starter)
+    {
+        co_return co_await detail::callback_awaiter<T>{std::move(starter)};
+    }
+
+
+    // Run all tasks concurrently; the first exception is rethrown, the others are dropped.
+    template<typename T>
+    task<std::vector<T>>
+    when_all(std::vector<task<T>> tasks)
+    {
+        auto token = co_await get_stop_token{};
+        for (auto& t : tasks)
+            t.start(token);
+        std::vector<T> results;
+        results.reserve(tasks.size());
+        for (auto& t : tasks)
+            results.push_back(co_await t);
+        co_return results;
+    }
+
+
+    inline
+    task<>
+    when_all(std::vector<task<>> tasks)
+    {
+        auto token = co_await get_stop_token{};
+        for (auto& t : tasks)
+            t.start(token);
+        for (auto& t : tasks)
+            co_await t;
+    }
+
+
+    template<typename... Ts>
+    requires(!std::is_void_v<Ts> && ...)
+    task<std::tuple<Ts...>>
+    when_all(task<Ts>... tasks)
+    {
+        auto token = co_await get_stop_token{};
+        (tasks.start(token), ...);
+        // Note: braced initialization is evaluated left to right.
+        co_return std::tuple<Ts...>{co_await tasks...};
+    }
+
+} // namespace coro
+
+#endif
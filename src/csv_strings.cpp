@@ -5,6 +5,9 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <string_view>
+#include <vector>
+
 #include "csv_strings.hpp"
 
 #include "string_utils.hpp"
@@ -12,8 +15,10 @@
 
 csv_strings::csv_strings(const std::optional<std::string>& joined)
 {
-    if (joined && !joined->empty())
-        operator =(string_utils::split(*joined, ",", false));
+    if (joined && !joined->empty()) {
+        auto tokens = string_utils::split(std::string_view{*joined}, ",", false);
+        assign(tokens.begin(), tokens.end());
+    }
 }
 
 
@@ -22,5 +27,6 @@ csv_strings::operator std::optional<std::string>()
 {
     if (empty())
         return {};
-    return string_utils::join(*this, ",", false);
+    std::vector<std::string> tokens(begin(), end());
+    return string_utils::join(tokens, ",", false);
 }
@@ -12,14 +12,19 @@
 #include <string>
 #include <vector>
 
+#include <glaze/beve/read.hpp>
+#include <glaze/beve/write.hpp>
 #include <glaze/core/reflect.hpp>
 #include <glaze/json/read.hpp>
 #include <glaze/json/write.hpp>
 
+#include "interned_string.hpp"
 
-struct csv_strings : std::vector<std::string> {
 
-    using base = std::vector<std::string>;
+// Note: the values repeat a lot across stations, so they are interned.
+struct csv_strings : std::vector<interned_string> {
+
+    using base = std::vector<interned_string>;
 
     // Inherit constructors.
     using base::base;
@@ -104,4 +109,37 @@ struct glz::to<glz::JSON, csv_strings> {
     }
 };
 
+
+// BEVE is never edited by hand, so it stores the plain array of strings.
+
+template<>
+struct glz::from<glz::BEVE, csv_strings> {
+    template<auto Opts>
+    static
+    void
+    op(csv_strings& value,
+       is_context auto&& ctx,
+       auto&& it,
+       auto&& end)
+    {
+        parse<BEVE>::op<Opts>(static_cast<csv_strings::base&>(value), ctx, it, end);
+    }
+};
+
+
+template<>
+struct glz::to<glz::BEVE, csv_strings> {
+    template<auto Opts>
+    static
+    void
+    op(const csv_strings& value,
+       is_context auto&& ctx,
+       auto&& b,
+       auto&& ix)
+        noexcept
+    {
+        serialize<BEVE>::op<Opts>(static_cast<const csv_strings::base&>(value), ctx, b, ix);
+    }
+};
+
 #endif
@@ -0,0 +1,124 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+
+#include <curl/curl.h>
+
+#include "curl_share.hpp"
+
+#include "tracer.hpp"
+
+
+using std::cout;
+using std::endl;
+
+
+namespace curl_share {
+
+    namespace {
+
+        CURLSH* handle = nullptr;
+
+        std::array<std::mutex, CURL_LOCK_DATA_LAST> mutexes;
+
+        std::atomic<std::uint64_t> new_connections = 0;
+        std::atomic<std::uint64_t> reused_connections = 0;
+
+
+        void
+        lock_func(CURL*,
+                  curl_lock_data data,
+                  curl_lock_access,
+                  void*)
+        {
+            mutexes[data].lock();
+        }
+
+
+        void
+        unlock_func(CURL*,
+                    curl_lock_data data,
+                    void*)
+        {
+            mutexes[data].unlock();
+        }
+
+    } // namespace
+
+
+    void
+    initialize()
+    {
+        TRACE_FUNC;
+
+        handle = curl_share_init();
+        if (!handle) {
+            cout << "ERROR: curl_share_init() failed" << endl;
+            return;
+        }
+
+        curl_share_setopt(handle, CURLSHOPT_LOCKFUNC, lock_func);
+        curl_share_setopt(handle, CURLSHOPT_UNLOCKFUNC, unlock_func);
+        curl_share_setopt(handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        // Note: CURL_LOCK_DATA_CONNECT is left out on purpose, see curl_share.hpp.
+    }
+
+
+    void
+    finalize()
+    {
+        TRACE_FUNC;
+
+        if (!handle)
+            return;
+
+        auto e = curl_share_cleanup(handle);
+        if (e != CURLSHE_OK)
+            cout << "BUG: curl_share_cleanup() failed: " << curl_share_strerror(e) << endl;
+        handle = nullptr;
+    }
+
+
+    void
+    attach(curl::easy& easy)
+        noexcept
+    {
+        if (handle)
+            curl_easy_setopt(easy.data(), CURLOPT_SHARE, handle);
+    }
+
+
+    void
+    record(const curl::easy& easy)
+        noexcept
+    {
+        long connects = 0;
+        if (curl_easy_getinfo(easy.data(), CURLINFO_NUM_CONNECTS, &connects) != CURLE_OK)
+            return;
+        if (connects)
+            new_connections += connects;
+        else
+            ++reused_connections;
+    }
+
+
+    stats
+    get_stats()
+        noexcept
+    {
+        return {
+            new_connections.load(),
+            reused_connections.load()
+        };
+    }
+
+} // namespace curl_share
@@ -0,0 +1,59 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CURL_SHARE_HPP
+#define CURL_SHARE_HPP
+
+#include <cstdint>
+
+#include <curlxx/easy.hpp>
+
+
+/*
+ * Process-wide curl share handle: the DNS cache and TLS sessions are shared by every easy
+ * handle attached to it, from any thread.
+ *
+ * Note: the connection pool is not shared. rest, IconManager and the stream clients drive
+ * their multi handles from different threads, and libcurl doesn't support sharing
+ * connections between concurrent threads, whatever the lock functions do. Each multi
+ * handle pools the connections of its own easy handles; resuming a TLS session is what
+ * saves most of a new connection's cost.
+ */
+namespace curl_share {
+
+    struct stats {
+        std::uint64_t new_connections = 0;
+        std::uint64_t reused_connections = 0;
+    };
+
+
+    void
+    initialize();
+
+    void
+    finalize();
+
+
+    // Must be called again after easy.reset(), since that clears the share option.
+    void
+    attach(curl::easy& easy)
+        noexcept;
+
+
+    // Call when a transfer finishes, to count whether its connection was reused.
+    void
+    record(const curl::easy& easy)
+        noexcept;
+
+
+    stats
+    get_stats()
+        noexcept;
+
+} // namespace curl_share
+
+#endif
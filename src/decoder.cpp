@@ -5,9 +5,14 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
-#include <algorithm>
+#include <algorithm>            // copy_n(), count_if(), find_if(), min()
+#include <array>
+#include <cstdint>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
+#include <utility>              // move()
+#include <vector>
 
 #include "decoder.hpp"
 
@@ -15,6 +20,7 @@
 #include "decoder_mp3.hpp"
 #include "decoder_opus.hpp"
 #include "decoder_vorbis.hpp"
+#include "mime_type.hpp"
 
 
 using std::cout;
@@ -28,79 +34,291 @@ namespace decoder {
     {}
 
 
+    std::size_t
+    base::feed(byte_stream& src,
+               std::size_t max_bytes)
+    {
+        std::size_t total = 0;
+        for (auto s : src.readable_spans()) {
+            const std::size_t n = std::min(max_bytes - total, s.size());
+            if (!n)
+                break;
+            feed(std::span{reinterpret_cast<const char*>(s.data()), n});
+            total += n;
+        }
+        src.commit_read(total);
+        return total;
+    }
+
+
+    std::size_t
+    base::decode_into(std::span<char> out)
+    {
+        std::size_t total = 0;
+        while (total < out.size()) {
+            if (pending_output.empty())
+                pending_output = decode();
+            if (pending_output.empty())
+                break;
+            std::size_t n = std::min(out.size() - total, pending_output.size());
+            std::copy_n(pending_output.data(), n, out.data() + total);
+            pending_output = pending_output.subspan(n);
+            total += n;
+        }
+        return total;
+    }
+
+
+    void
+    base::reset(std::span<const char> data)
+    {
+        pending_output = {};
+        restart(data);
+    }
+
+
     namespace {
 
+        // Enough for the playing station, and the next one that's being prepared.
+        const int max_pooled_per_codec = 2;
+
+        std::mutex pool_mutex;
+        std::vector<std::unique_ptr<base>> pool;
+
+
+        std::unique_ptr<base>
+        take_pooled(codec c)
+        {
+            std::lock_guard guard{pool_mutex};
+            auto it = std::ranges::find_if(pool,
+                                           [c](const auto& dec)
+                                           {
+                                               return dec->get_codec() == c;
+                                           });
+            if (it == pool.end())
+                return {};
+            auto dec = std::move(*it);
+            pool.erase(it);
+            return dec;
+        }
+
+
+        constexpr mime_type::table mime_table{
+            mime_type::rule{ "audio/aac",           codec::aac    },
+            mime_type::rule{ "audio/aacp",          codec::aac    },
+            mime_type::rule{ "audio/mp3",           codec::mp3    },
+            mime_type::rule{ "audio/mpeg",          codec::mp3    },
+            mime_type::rule{ "audio/mpeg3",         codec::mp3    },
+            mime_type::rule{ "audio/opus",          codec::opus   },
+            mime_type::rule{ "audio/vorbis",        codec::vorbis },
+            mime_type::rule{ "audio/x-aac",         codec::aac    },
+            mime_type::rule{ "audio/x-hx-aac-adts", codec::aac    },
+            mime_type::rule{ "audio/x-mp3",         codec::mp3    },
+            mime_type::rule{ "audio/x-mpeg",        codec::mp3    },
+        };
+
+
         bool
-        match(std::span<const char> data,
-              std::span<const char> prefix)
+        starts_with(std::span<const char> data,
+                    std::string_view prefix)
+            noexcept
         {
-            if (data.size() < prefix.size())
+            return std::string_view{data.data(), data.size()}.starts_with(prefix);
+        }
+
+
+        bool
+        contains(std::span<const char> data,
+                 std::string_view needle)
+            noexcept
+        {
+            return std::string_view{data.data(), data.size()}.contains(needle);
+        }
+
+
+        std::uint8_t
+        byte_at(std::span<const char> data,
+                std::size_t i)
+            noexcept
+        {
+            return static_cast<std::uint8_t>(data[i]);
+        }
+
+
+        // ADTS header: 12 bits sync, 1 bit ID, 2 bits layer (always 0)
+        bool
+        is_adts_header(std::span<const char> data, std::size_t i)
+            noexcept
+        {
+            if (i + 3 > data.size())
+                return false;
+            if (byte_at(data, i) != 0xff || (byte_at(data, i + 1) & 0xf6) != 0xf0)
                 return false;
+            // sampling frequency index must be valid
+            return ((byte_at(data, i + 2) >> 2) & 0x0f) < 13;
+        }
 
-            return std::equal(prefix.begin(),
-                              prefix.end(),
-                              data.begin());
+
+        // MPEG audio header: 11 bits sync, 2 bits version, 2 bits layer (never 0)
+        bool
+        is_mpa_header(std::span<const char> data, std::size_t i)
+            noexcept
+        {
+            if (i + 3 > data.size())
+                return false;
+            if (byte_at(data, i) != 0xff || (byte_at(data, i + 1) & 0xe0) != 0xe0)
+                return false;
+            const std::uint8_t b1 = byte_at(data, i + 1);
+            const std::uint8_t b2 = byte_at(data, i + 2);
+            const unsigned version = (b1 >> 3) & 0x03;
+            const unsigned layer   = (b1 >> 1) & 0x03;
+            const unsigned bitrate = (b2 >> 4) & 0x0f;
+            const unsigned rate    = (b2 >> 2) & 0x03;
+            return version != 1 && layer != 0 && bitrate != 0x0f && rate != 0x03;
         }
 
     } // namespace
 
 
-    std::unique_ptr<base>
-    create(const std::string& content_type,
-           std::span<const char> data)
+    std::string
+    to_string(codec c)
     {
-        if (content_type == "audio/aac" ||
-            content_type == "audio/aacp" ||
-            content_type == "audio/x-aac" ||
-            content_type == "audio/audio/x-hx-aac-adts") {
-            cout << "Creating aac decoder from content type: " << content_type << endl;
-            return std::make_unique<aac>(data);
+        switch (c) {
+            case codec::aac:
+                return "aac";
+            case codec::mp3:
+                return "mp3";
+            case codec::opus:
+                return "opus";
+            case codec::vorbis:
+                return "vorbis";
+            default:
+                return "unknown";
         }
+    }
 
-        if (content_type == "audio/mpeg") {
-            cout << "Creating mp3 decoder from content type: " << content_type << endl;
-            return std::make_unique<mp3>(data);
-        }
 
-        if (content_type == "audio/vorbis") {
-            cout << "Creating opus decoder from content type: " << content_type << endl;
-            return std::make_unique<opus>(data);
+    codec
+    probe_content_type(std::string_view content_type)
+        noexcept
+    {
+        return mime_table.lookup(content_type).value_or(codec::unknown);
+    }
+
+
+    codec
+    probe_data(std::span<const char> data)
+        noexcept
+    {
+        data = data.first(std::min(data.size(), probe_window));
+
+        if (starts_with(data, "ID3"))
+            return codec::mp3;
+
+        if (starts_with(data, "OggS")) {
+            // The first page has the identification header of the first stream.
+            if (contains(data, "OpusHead"))
+                return codec::opus;
+            if (contains(data, "\x01vorbis"))
+                return codec::vorbis;
+            return codec::unknown;
         }
 
-        if (content_type == "audio/vorbis") {
-            cout << "Creating vorbis decoder from content type: " << content_type << endl;
-            return std::make_unique<vorbis>(data);
+        // The stream might not start at a frame boundary, so look for the first sync.
+        for (std::size_t i = 0; i + 1 < data.size(); ++i) {
+            if (byte_at(data, i) != 0xff)
+                continue;
+            if (is_adts_header(data, i))
+                return codec::aac;
+            if (is_mpa_header(data, i))
+                return codec::mp3;
         }
 
-        cout << "No match for content type: " << content_type << endl;
+        return codec::unknown;
+    }
 
-        if (match(data, "\xff\xfb") || match(data, "ID3")) {
-            cout << "Creating mp3 decoder from data signature" << endl;
-            return std::make_unique<mp3>(data);
-        }
 
-        if (match(data, "OggS")) {
+    std::unique_ptr<base>
+    create(codec c,
+           std::span<const char> data)
+    {
+        if (auto dec = take_pooled(c)) {
             try {
-                return std::make_unique<opus>(data);
+                dec->reset(data);
+                cout << "Reusing " << to_string(c) << " decoder." << endl;
+                return dec;
             }
             catch (...) {
+                // Note: the data is the problem, not the decoder; keep it for the retry.
+                recycle(std::move(dec));
+                throw;
             }
-            try {
+        }
+
+        switch (c) {
+            case codec::aac:
+                return std::make_unique<aac>(data);
+            case codec::mp3:
+                return std::make_unique<mp3>(data);
+            case codec::opus:
+                return std::make_unique<opus>(data);
+            case codec::vorbis:
                 return std::make_unique<vorbis>(data);
-            }
-            catch (...) {
-            }
+            default:
+                throw std::runtime_error{"cannot create decoder"};
         }
+    }
 
-        if (match(data, "\xff\xf1") ||
-            match(data, "\xff\xf9")) {
-            cout << "Creating aac decoder from data signature" << endl;
-            return std::make_unique<aac>(data);
+
+    std::unique_ptr<base>
+    create(const std::string& content_type,
+           std::span<const char> data)
+    {
+        codec c = probe_content_type(content_type);
+        if (c != codec::unknown) {
+            cout << "Creating " << to_string(c) << " decoder from content type: "
+                 << content_type << endl;
+            return create(c, data);
         }
 
+        cout << "No match for content type: " << content_type << endl;
+
+        c = probe_data(data);
+        if (c != codec::unknown)
+            cout << "Creating " << to_string(c) << " decoder from data signature" << endl;
+
         // Note: FLAC is  66 4C 61 43   "fLaC"
 
-        throw std::runtime_error{"cannot create decoder"};
+        return create(c, data);
+    }
+
+
+    void
+    recycle(std::unique_ptr<base> dec)
+        noexcept
+    {
+        if (!dec)
+            return;
+        const codec c = dec->get_codec();
+        auto same_codec = [c](const auto& d) { return d->get_codec() == c; };
+        std::lock_guard guard{pool_mutex};
+        if (std::ranges::count_if(pool, same_codec) >= max_pooled_per_codec)
+            return;
+        try {
+            pool.push_back(std::move(dec));
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: decoder::recycle(): " << e.what() << endl;
+        }
+    }
+
+
+    void
+    clear_pool()
+        noexcept
+    {
+        std::lock_guard guard{pool_mutex};
+        pool.clear();
     }
 
 } // namespace decoder
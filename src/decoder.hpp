@@ -15,9 +15,11 @@
 #include <iosfwd>
 #include <span>
 #include <string>
+#include <string_view>
 
 #include <SDL_audio.h>
 
+#include "byte_stream.hpp"
 #include "stream_metadata.hpp"
 
 
@@ -33,6 +35,18 @@ namespace decoder {
     struct info {
         std::string codec;
         std::string bitrate;
+
+        bool
+        operator ==(const info& other) const = default;
+    };
+
+
+    enum class codec {
+        unknown,
+        aac,
+        mp3,
+        opus,
+        vorbis,
     };
 
 
@@ -57,10 +71,24 @@ namespace decoder {
         std::size_t
         feed(std::span<const char> data) = 0;
 
+        // Take up to max_bytes from the front of src. Decoders that buffer into their own
+        // byte_stream override this to take the bytes without copying, when possible.
+        virtual
+        std::size_t
+        feed(byte_stream& src,
+             std::size_t max_bytes);
+
         virtual
         std::span<const char>
         decode() = 0;
 
+        // Decode as many whole sample frames as fit into out, return how many bytes were
+        // written. The default implementation copies from decode(), and keeps what didn't
+        // fit for the next call; don't mix it with decode() calls.
+        virtual
+        std::size_t
+        decode_into(std::span<char> out);
+
         virtual
         std::optional<spec>
         get_spec()
@@ -75,13 +103,74 @@ namespace decoder {
         get_metadata()
             const = 0;
 
+        virtual
+        codec
+        get_codec()
+            const noexcept = 0;
+
+
+        // Start over with a new stream of the same codec, from its first bytes. Buffers
+        // and library handles are kept when possible. If it throws, the decoder can still
+        // be reset again.
+        void
+        reset(std::span<const char> data);
+
+
+    protected:
+
+        // Called by reset(), once the base state is cleared.
+        virtual
+        void
+        restart(std::span<const char> data) = 0;
+
+
+    private:
+
+        // Output from decode() that didn't fit in decode_into().
+        std::span<const char> pending_output;
+
     }; // struct base
 
 
+    std::string
+    to_string(codec c);
+
+
+    // How many bytes probe_data() looks at.
+    constexpr std::size_t probe_window = 4096;
+
+
+    // Identify codec from the content type. Ogg containers give codec::unknown.
+    codec
+    probe_content_type(std::string_view content_type)
+        noexcept;
+
+    // Identify codec by looking at the first bytes of the stream.
+    codec
+    probe_data(std::span<const char> data)
+        noexcept;
+
+
+    std::unique_ptr<base>
+    create(codec c,
+           std::span<const char> data);
+
     std::unique_ptr<base>
     create(const std::string& content_type,
            std::span<const char> data);
 
+
+    // Give back a decoder that's no longer needed, so create() can reset and reuse it,
+    // instead of constructing a new one. Only a couple per codec are kept.
+    void
+    recycle(std::unique_ptr<base> dec)
+        noexcept;
+
+    // Destroy the decoders kept by recycle().
+    void
+    clear_pool()
+        noexcept;
+
 } // namespace decoder
 
 #endif
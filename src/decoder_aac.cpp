@@ -10,6 +10,8 @@
 
 #include "decoder_aac.hpp"
 
+#include "logging.hpp"
+
 
 using std::cout;
 using std::endl;
@@ -103,37 +105,9 @@ namespace decoder {
     } // namespace
 
 
-    aac::aac(std::span<const char> data) :
-        handle{open()}
+    aac::aac(std::span<const char> data)
     {
-        auto cfg = NeAACDecGetCurrentConfiguration(handle);
-        // dump(cfg);
-        cfg->outputFormat = FAAD_FMT_16BIT;
-        // cfg->defSampleRate = 44100;
-        cfg->downMatrix = 1; // downmix to stereo
-        if (!NeAACDecSetConfiguration(handle, cfg)) {
-            close();
-            throw error{"NeAACDecSetConfiguration() failed"};
-        }
-
-        auto r = NeAACDecInit(handle,
-                              reinterpret_cast<unsigned char*>(const_cast<char*>(data.data())),
-                              data.size_bytes(),
-                              &rate,
-                              &channels);
-        if (r < 0) {
-            close();
-            throw error{"NeAACDecInit() failed"};
-        }
-        assert((unsigned long)r <= data.size());
-
-        cout << "aac::rate = " << rate << '\n'
-             << "aac::channels = " << (unsigned)channels << endl;
-
-        cfg = NeAACDecGetCurrentConfiguration(handle);
-        // dump(cfg);
-
-        stream.write(data.subspan(r));
+        aac::restart(data);
     }
 
 
@@ -151,6 +125,15 @@ namespace decoder {
     }
 
 
+    std::size_t
+    aac::feed(byte_stream& src,
+              std::size_t max_bytes)
+    {
+        // Note: this swaps buffers when our stream is empty, and src fits.
+        return stream.consume(src, max_bytes);
+    }
+
+
     std::span<const char>
     aac::decode()
     {
@@ -160,22 +143,22 @@ namespace decoder {
             return {};
 
         NeAACDecFrameInfo frame;
-        std::vector<unsigned char> buf(stream.size());
-        auto sz = stream.peek(std::span{buf});
+        // decode in place, no need to copy the input
+        auto buf = stream.linearize();
         auto samples = NeAACDecDecode(handle,
                                       &frame,
-                                      buf.data(),
-                                      sz);
+                                      reinterpret_cast<unsigned char*>(
+                                          const_cast<std::byte*>(buf.data())),
+                                      buf.size());
         if (frame.error) {
             //throw error{"NeAACDecDecode() failed", frame.error};
-            cout << "aac::decode(): error: "
-                 << NeAACDecGetErrorMessage(frame.error)
-                 << endl;
+            LOG_LIMITED(warning, 1s) << "aac::decode(): "
+                                     << NeAACDecGetErrorMessage(frame.error);
             return {};
         }
         stream.discard(frame.bytesconsumed);
         if (frame.samples == 0) {
-            cout << "aac::decode(): frame.samples == 0" << endl;
+            LOG_LIMITED(warning, 1s) << "aac::decode(): frame.samples == 0";
             return {};
         }
 
@@ -184,7 +167,7 @@ namespace decoder {
 
         return {
             reinterpret_cast<const char*>(samples),
-            2 * frame.samples
+            sizeof(float) * frame.samples
         };
     }
 
@@ -194,7 +177,7 @@ namespace decoder {
         noexcept
     {
         spec result;
-        result.format = AUDIO_S16SYS;
+        result.format = AUDIO_F32SYS;
         result.rate = rate;
         result.channels = 2;
         return result;
@@ -219,6 +202,58 @@ namespace decoder {
     }
 
 
+    codec
+    aac::get_codec()
+        const noexcept
+    {
+        return codec::aac;
+    }
+
+
+    void
+    aac::restart(std::span<const char> data)
+    {
+        // Note: NeAACDecInit() can't be called twice on the same handle, so only the
+        // handle is replaced; the stream keeps its buffer.
+        close();
+        stream.clear();
+        rate = 0;
+        channels = 0;
+        current_channels = 0;
+        current_rate = 0;
+
+        handle = open();
+        auto cfg = NeAACDecGetCurrentConfiguration(handle);
+        // dump(cfg);
+        cfg->outputFormat = FAAD_FMT_FLOAT;
+        // cfg->defSampleRate = 44100;
+        cfg->downMatrix = 1; // downmix to stereo
+        if (!NeAACDecSetConfiguration(handle, cfg)) {
+            close();
+            throw error{"NeAACDecSetConfiguration() failed"};
+        }
+
+        auto r = NeAACDecInit(handle,
+                              reinterpret_cast<unsigned char*>(const_cast<char*>(data.data())),
+                              data.size_bytes(),
+                              &rate,
+                              &channels);
+        if (r < 0) {
+            close();
+            throw error{"NeAACDecInit() failed"};
+        }
+        assert((unsigned long)r <= data.size());
+
+        cout << "aac::rate = " << rate << '\n'
+             << "aac::channels = " << (unsigned)channels << endl;
+
+        cfg = NeAACDecGetCurrentConfiguration(handle);
+        // dump(cfg);
+
+        stream.write(data.subspan(r));
+    }
+
+
     NeAACDecHandle
     aac::open()
     {
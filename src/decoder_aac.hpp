@@ -52,6 +52,11 @@ namespace decoder {
         feed(std::span<const char> data)
             override;
 
+        std::size_t
+        feed(byte_stream& src,
+             std::size_t max_bytes)
+            override;
+
         std::span<const char>
         decode()
             override;
@@ -68,6 +73,17 @@ namespace decoder {
         get_metadata()
             const override;
 
+        codec
+        get_codec()
+            const noexcept override;
+
+
+    protected:
+
+        void
+        restart(std::span<const char> data)
+            override;
+
 
     private:
 
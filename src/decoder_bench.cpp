@@ -0,0 +1,254 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Offline decoder throughput harness, for the desktop build.
+ *
+ * Usage: radiiu-decoder-bench [--chunk BYTES] [--block BYTES] [--content-type TYPE] FILE...
+ *
+ * Each FILE is a recorded stream (raw MP3, ADTS AAC, Ogg Opus or Ogg Vorbis), without ICY
+ * metadata. It's fed through decoder::create() and the feed()/decode_into() loop, in
+ * chunks like the network delivers them, as fast as possible.
+ *
+ * The results go to stdout, one JSON object per file; log messages go to stderr. The
+ * allocation counts only include C++ allocations (operator new), not the codec libraries'
+ * own malloc() calls.
+ */
+
+#include <algorithm>            // max(), min(), sort()
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>              // malloc(), free()
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>             // istreambuf_iterator
+#include <new>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <SDL_audio.h>
+
+#include "decoder.hpp"
+
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+using namespace std::literals;
+
+
+namespace {
+
+    std::atomic<std::uint64_t> alloc_count;
+    std::atomic<std::uint64_t> alloc_bytes;
+
+} // namespace
+
+
+void*
+operator new(std::size_t size)
+{
+    alloc_count.fetch_add(1, std::memory_order_relaxed);
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+
+
+void
+operator delete(void* p)
+    noexcept
+{
+    std::free(p);
+}
+
+
+void
+operator delete(void* p,
+                std::size_t)
+    noexcept
+{
+    std::free(p);
+}
+
+
+namespace {
+
+    using clock = std::chrono::steady_clock;
+
+
+    struct options {
+        std::size_t chunk_size = 4096;
+        std::size_t block_size = 16 * 1024;
+        std::string content_type;
+    };
+
+
+    // Used when --content-type is not given.
+    std::string
+    guess_content_type(const std::filesystem::path& path)
+    {
+        auto ext = path.extension().string();
+        if (ext == ".mp3")
+            return "audio/mpeg";
+        if (ext == ".aac" || ext == ".adts")
+            return "audio/aac";
+        if (ext == ".opus")
+            return "audio/opus";
+        // Note: for Ogg, the decoder looks at the data.
+        return "";
+    }
+
+
+    double
+    percentile(const std::vector<double>& sorted,
+               double p)
+    {
+        if (sorted.empty())
+            return 0;
+        auto idx = static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[idx];
+    }
+
+
+    bool
+    run(const std::filesystem::path& path,
+        const options& opts,
+        std::ostream& out)
+    {
+        std::ifstream in{path, std::ios::binary};
+        if (!in) {
+            cerr << "Could not open " << path << endl;
+            return false;
+        }
+        const std::vector<char> input{std::istreambuf_iterator<char>{in}, {}};
+
+        const auto content_type = opts.content_type.empty()
+            ? guess_content_type(path)
+            : opts.content_type;
+
+        // Note: radio_client collects about this much before creating the decoder.
+        const std::size_t initial_size = std::min<std::size_t>(input.size(), 16 * 1024);
+        std::span<const char> remaining{input};
+
+        std::vector<char> block(opts.block_size);
+        std::vector<double> latencies; // microseconds
+        latencies.reserve(input.size() / 64 + 64);
+
+        const auto allocs_before = alloc_count.load();
+        const auto alloc_bytes_before = alloc_bytes.load();
+        const auto start = clock::now();
+
+        auto dec = decoder::create(content_type, remaining.first(initial_size));
+        remaining = remaining.subspan(initial_size);
+
+        std::uint64_t output_bytes = 0;
+        auto drain = [&]
+        {
+            for (;;) {
+                const auto t0 = clock::now();
+                const std::size_t size = dec->decode_into(block);
+                const auto t1 = clock::now();
+                if (!size)
+                    break;
+                latencies.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+                output_bytes += size;
+            }
+        };
+
+        drain();
+        while (!remaining.empty()) {
+            auto chunk = remaining.first(std::min(opts.chunk_size, remaining.size()));
+            dec->feed(chunk);
+            remaining = remaining.subspan(chunk.size());
+            drain();
+        }
+
+        const auto wall = std::chrono::duration<double>(clock::now() - start).count();
+        const auto allocs = alloc_count.load() - allocs_before;
+        const auto allocated = alloc_bytes.load() - alloc_bytes_before;
+
+        double audio_seconds = 0;
+        if (auto s = dec->get_spec()) {
+            const std::size_t frame_size = SDL_AUDIO_BITSIZE(s->format) / 8 * s->channels;
+            if (frame_size && s->rate)
+                audio_seconds = static_cast<double>(output_bytes) / frame_size / s->rate;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+
+        out << "{\"file\":\"" << path.filename().string() << "\""
+            << ",\"codec\":\"" << dec->get_info().codec << "\""
+            << ",\"input_bytes\":" << input.size()
+            << ",\"output_bytes\":" << output_bytes
+            << ",\"audio_seconds\":" << audio_seconds
+            << ",\"wall_seconds\":" << wall
+            << ",\"realtime_factor\":" << (wall > 0 ? audio_seconds / wall : 0)
+            << ",\"allocations\":" << allocs
+            << ",\"allocated_bytes\":" << allocated
+            << ",\"decode_calls\":" << latencies.size()
+            << ",\"p50_us\":" << percentile(latencies, 0.50)
+            << ",\"p90_us\":" << percentile(latencies, 0.90)
+            << ",\"p99_us\":" << percentile(latencies, 0.99)
+            << ",\"max_us\":" << (latencies.empty() ? 0 : latencies.back())
+            << "}" << endl;
+        return true;
+    }
+
+} // namespace
+
+
+int main(int argc, char* argv[])
+{
+    options opts;
+    std::vector<std::filesystem::path> files;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--chunk" && i + 1 < argc)
+            opts.chunk_size = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--block" && i + 1 < argc)
+            opts.block_size = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--content-type" && i + 1 < argc)
+            opts.content_type = argv[++i];
+        else
+            files.emplace_back(arg);
+    }
+
+    if (files.empty()) {
+        cerr << "Usage: " << argv[0]
+             << " [--chunk BYTES] [--block BYTES] [--content-type TYPE] FILE..." << endl;
+        return EXIT_FAILURE;
+    }
+
+    std::ostream results{cout.rdbuf()};
+    cout.rdbuf(cerr.rdbuf());
+
+    int status = EXIT_SUCCESS;
+    for (auto& file : files) {
+        try {
+            if (!run(file, opts, results))
+                status = EXIT_FAILURE;
+        }
+        catch (std::exception& e) {
+            cerr << "ERROR: " << file << ": " << e.what() << endl;
+            status = EXIT_FAILURE;
+        }
+    }
+
+    cout.rdbuf(results.rdbuf());
+    return status;
+}
@@ -54,6 +54,7 @@ namespace decoder {
 
     namespace {
 
+        // Only the formats the rest of the pipeline handles.
         SDL_AudioFormat
         to_sdl_format(unsigned encoding)
         {
@@ -62,16 +63,9 @@ namespace decoder {
                 case MPG123_ENC_SIGNED_16:
                     return AUDIO_S16SYS;
 
-                case MPG123_ENC_UNSIGNED_16:
-                    return AUDIO_U16SYS;
-
-                case MPG123_ENC_SIGNED_32:
-                    return AUDIO_S32SYS;
-
                 case MPG123_ENC_FLOAT_32:
                     return AUDIO_F32SYS;
 
-                // Note: 24-bit encoding doesn't have a SDL equivalent.
                 default:
                     return 0;
 
@@ -94,9 +88,9 @@ namespace decoder {
         result.channels = fmt->channels & MPG123_STEREO ? 2 : 1;
         result.format = to_sdl_format(fmt->encoding);
         if (!result.format) {
-            // no exact match, ask mpg123 to convert it to S16
-            result.format = AUDIO_S16SYS;
-            mpg.set_format(fmt->rate, fmt->channels, MPG123_ENC_SIGNED_16);
+            // Note: no exact match, ask mpg123 to convert it to F32, so nothing is lost.
+            result.format = AUDIO_F32SYS;
+            mpg.set_format(fmt->rate, fmt->channels, MPG123_ENC_FLOAT_32);
         }
 
         return result;
@@ -246,4 +240,21 @@ namespace decoder {
         return {};
     }
 
+
+    codec
+    mp3::get_codec()
+        const noexcept
+    {
+        return codec::mp3;
+    }
+
+
+    void
+    mp3::restart(std::span<const char> data)
+    {
+        // Note: opening the feed again closes the old one, but keeps the handle.
+        mpg.open_feed();
+        feed(data);
+    }
+
 } // namespace decoder
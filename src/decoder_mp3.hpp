@@ -25,6 +25,9 @@ namespace decoder {
         ~mp3()
             noexcept override;
 
+        // mpg123 copies into its own buffers anyway, so use the generic feed(byte_stream&).
+        using base::feed;
+
         std::size_t
         feed(std::span<const char> data)
             override;
@@ -45,6 +48,17 @@ namespace decoder {
         get_metadata()
             const override;
 
+        codec
+        get_codec()
+            const noexcept override;
+
+
+    protected:
+
+        void
+        restart(std::span<const char> data)
+            override;
+
     }; // struct mp3
 
 } // namespace decoder
@@ -7,6 +7,7 @@
 
 #include <bit>
 #include <cerrno>
+#include <cstdint>              // uintptr_t
 #include <iostream>
 #include <string_view>
 
@@ -14,6 +15,7 @@
 
 #include "decoder_opus.hpp"
 
+#include "logging.hpp"
 #include "string_utils.hpp"
 
 
@@ -50,22 +52,7 @@ namespace decoder {
     opus::opus(std::span<const char> data) :
         samples(8192 * 2)
     {
-        OpusFileCallbacks callbacks {
-            .read = &read_callback,
-            .seek = nullptr,
-            .tell = nullptr,
-            .close = nullptr,
-        };
-
-        int e;
-        oof = op_open_callbacks(this,
-                                &callbacks,
-                                reinterpret_cast<const unsigned char*>(data.data()),
-                                data.size_bytes(),
-                                &e);
-        if (!oof)
-            throw error{"op_open_callbacks() failed", e};
-
+        opus::restart(data);
         cout << "Created opus decoder." << endl;
     }
 
@@ -84,12 +71,21 @@ namespace decoder {
     }
 
 
+    std::size_t
+    opus::feed(byte_stream& src,
+               std::size_t max_bytes)
+    {
+        // Note: this swaps buffers when our stream is empty, and src fits.
+        return stream.consume(src, max_bytes);
+    }
+
+
     std::span<const char>
     opus::decode()
     {
-        int r = op_read_stereo(oof,
-                               samples.data(),
-                               samples.size());
+        int r = op_read_float_stereo(oof,
+                                     samples.data(),
+                                     samples.size());
 
         if (r <= 0) {
             switch (r) {
@@ -97,10 +93,11 @@ namespace decoder {
                     return {};
                 case OP_HOLE:
                 case OP_EREAD:
-                    cout << "Harmless (?) Opus error: " << opus_error_to_string(r) << endl;
+                    LOG_LIMITED(warning, 1s) << "Harmless (?) Opus error: "
+                                             << opus_strerror(r);
                     return {};
                 default:
-                    throw error{"op_read_stereo() failed", r};
+                    throw error{"op_read_float_stereo() failed", r};
             }
         }
         auto decoded = std::span(samples.data(), r * 2);
@@ -109,12 +106,45 @@ namespace decoder {
     }
 
 
+    std::size_t
+    opus::decode_into(std::span<char> out)
+    {
+        // op_read_float_stereo() writes F32 stereo frames directly into out.
+        if (reinterpret_cast<std::uintptr_t>(out.data()) % alignof(float))
+            return base::decode_into(out);
+
+        const std::size_t frame_size = 2 * sizeof(float);
+        std::size_t total = 0;
+        while (out.size() - total >= frame_size) {
+            int r = op_read_float_stereo(oof,
+                                         reinterpret_cast<float*>(out.data() + total),
+                                         (out.size() - total) / frame_size * 2);
+            if (r <= 0) {
+                switch (r) {
+                    case 0:
+                        break;
+                    case OP_HOLE:
+                    case OP_EREAD:
+                        LOG_LIMITED(warning, 1s) << "Harmless (?) Opus error: "
+                                                 << opus_strerror(r);
+                        break;
+                    default:
+                        throw error{"op_read_float_stereo() failed", r};
+                }
+                break;
+            }
+            total += r * frame_size;
+        }
+        return total;
+    }
+
+
     std::optional<spec>
     opus::get_spec()
         noexcept
     {
         spec result;
-        result.format = AUDIO_S16SYS;
+        result.format = AUDIO_F32SYS;
         result.rate = 48000;
         //result.channels = op_channel_count(oof, -1);
         result.channels = 2;
@@ -199,6 +229,40 @@ namespace decoder {
     }
 
 
+    codec
+    opus::get_codec()
+        const noexcept
+    {
+        return codec::opus;
+    }
+
+
+    void
+    opus::restart(std::span<const char> data)
+    {
+        op_free(oof);
+        oof = nullptr;
+        stream.clear();
+        bitrate = 0;
+
+        OpusFileCallbacks callbacks {
+            .read = &read_callback,
+            .seek = nullptr,
+            .tell = nullptr,
+            .close = nullptr,
+        };
+
+        int e;
+        oof = op_open_callbacks(this,
+                                &callbacks,
+                                reinterpret_cast<const unsigned char*>(data.data()),
+                                data.size_bytes(),
+                                &e);
+        if (!oof)
+            throw error{"op_open_callbacks() failed", e};
+    }
+
+
     int
     opus::read_callback(void* ctx,
                         unsigned char* buf,
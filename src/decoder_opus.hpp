@@ -32,7 +32,7 @@ namespace decoder {
 
         OggOpusFile* oof = nullptr;
         byte_stream stream;
-        std::vector<opus_int16> samples;
+        std::vector<float> samples;
         opus_int32 bitrate = 0;
 
 
@@ -46,10 +46,19 @@ namespace decoder {
         feed(std::span<const char> data)
             override;
 
+        std::size_t
+        feed(byte_stream& src,
+             std::size_t max_bytes)
+            override;
+
         std::span<const char>
         decode()
             override;
 
+        std::size_t
+        decode_into(std::span<char> out)
+            override;
+
         std::optional<spec>
         get_spec()
             noexcept override;
@@ -62,6 +71,10 @@ namespace decoder {
         get_metadata()
             const override;
 
+        codec
+        get_codec()
+            const noexcept override;
+
 
         static
         int
@@ -70,6 +83,12 @@ namespace decoder {
                       int size);
 
 
+    protected:
+
+        void
+        restart(std::span<const char> data)
+            override;
+
     }; // struct opus
 
 } // namespace decoder
@@ -5,13 +5,15 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
-#include <bit>
 #include <cerrno>
+#include <cstdint>
 #include <iostream>
 #include <string_view>
 
 #include "decoder_vorbis.hpp"
 
+#include "logging.hpp"
+#include "pcm_convert.hpp"
 #include "string_utils.hpp"
 
 
@@ -62,6 +64,32 @@ namespace decoder {
             }
         }
 
+
+        /*
+         * For each channel count, which Vorbis channel goes into each SDL channel.
+         *
+         *   Vorbis                          SDL
+         *   3: FL FC FR                     FL FR LFE
+         *   4: FL FR RL RR                  FL FR BL BR
+         *   5: FL FC FR RL RR               FL FR LFE BL BR
+         *   6: FL FC FR RL RR LFE           FL FR FC LFE BL BR
+         *   7: FL FC FR SL SR RC LFE        FL FR FC LFE BC SL SR
+         *   8: FL FC FR SL SR RL RR LFE     FL FR FC LFE BL BR SL SR
+         *
+         * Note: SDL has no layout with a center and no LFE, so with 3 and 5 channels the
+         * center goes where SDL expects the LFE; at least left and right are correct.
+         */
+        constexpr int sdl_order[pcm::max_channels][pcm::max_channels] = {
+            {0},
+            {0, 1},
+            {0, 2, 1},
+            {0, 1, 2, 3},
+            {0, 2, 1, 3, 4},
+            {0, 2, 1, 5, 3, 4},
+            {0, 2, 1, 6, 5, 3, 4},
+            {0, 2, 1, 7, 5, 6, 3, 4},
+        };
+
     } // namespace
 
 
@@ -77,23 +105,10 @@ namespace decoder {
 
 
     vorbis::vorbis(std::span<const char> data) :
+        ovf{},
         samples(8192)
     {
-        ov_callbacks callbacks {
-            .read_func = &read_callback,
-            .seek_func = nullptr,
-            .close_func = nullptr,
-            .tell_func = nullptr,
-        };
-
-        int e = ov_open_callbacks(this,
-                                  &ovf,
-                                  data.data(),
-                                  data.size_bytes(),
-                                  callbacks);
-        if (e)
-            throw error{"ov_open_callbacks() failed", e};
-
+        vorbis::restart(data);
         cout << "Created vorbis decoder." << endl;
     }
 
@@ -112,25 +127,76 @@ namespace decoder {
     }
 
 
+    std::size_t
+    vorbis::feed(byte_stream& src,
+                 std::size_t max_bytes)
+    {
+        // Note: this swaps buffers when our stream is empty, and src fits.
+        return stream.consume(src, max_bytes);
+    }
+
+
     std::span<const char>
     vorbis::decode()
     {
-        // TODO: when more than 2 channels, we should reorder them to match SDL channels.
+        const std::size_t size = read_float(samples);
+        return std::span(samples.data(), size);
+    }
+
+
+    std::size_t
+    vorbis::decode_into(std::span<char> out)
+    {
+        // ov_read_float() gives planar floats; they're interleaved straight into out.
+        if (reinterpret_cast<std::uintptr_t>(out.data()) % alignof(float))
+            return base::decode_into(out);
+
+        std::size_t total = 0;
+        while (std::size_t size = read_float(out.subspan(total)))
+            total += size;
+        return total;
+    }
+
+
+    std::size_t
+    vorbis::read_float(std::span<char> out)
+    {
+        auto vinfo = ov_info(&ovf, -1);
+        if (!vinfo || vinfo->channels <= 0)
+            return 0;
+
+        const std::size_t frame_size = sizeof(float) * vinfo->channels;
+        const std::size_t max_frames = out.size() / frame_size;
+        if (!max_frames)
+            return 0;
+
+        float** planes;
         int bitstream;
-        long r = ov_read(&ovf,
-                         samples.data(),
-                         samples.size(),
-                         std::endian::native == std::endian::big,
-                         2,
-                         1,
-                         &bitstream);
+        long r = ov_read_float(&ovf, &planes, max_frames, &bitstream);
         if (r == 0)
-            return {};
+            return 0;
         if (r < 0) {
-            cout << "vorbis::decode(): " << vorbis_error_to_string(r) << endl;
-            return {};
+            LOG_LIMITED(warning, 1s) << "vorbis::read_float(): " << vorbis_error_to_string(r);
+            return 0;
         }
-        return std::span(samples.data(), r);
+        // Note: the channel count can change between chained streams.
+        vinfo = ov_info(&ovf, -1);
+        if (!vinfo || static_cast<std::size_t>(r) * vinfo->channels * sizeof(float)
+                      > out.size())
+            return 0;
+        // Note: the channels are reordered by picking the planes in SDL's order.
+        const float* ordered[pcm::max_channels];
+        const float* const* src = planes;
+        if (vinfo->channels <= pcm::max_channels) {
+            for (int c = 0; c < vinfo->channels; ++c)
+                ordered[c] = planes[sdl_order[vinfo->channels - 1][c]];
+            src = ordered;
+        }
+        pcm::interleave(src,
+                        vinfo->channels,
+                        reinterpret_cast<float*>(out.data()),
+                        r);
+        return r * vinfo->channels * sizeof(float);
     }
 
 
@@ -142,7 +208,7 @@ namespace decoder {
         if (!vinfo)
             return {};
         spec result;
-        result.format = AUDIO_S16SYS;
+        result.format = AUDIO_F32SYS;
         result.rate = vinfo->rate;
         result.channels = vinfo->channels;
         return result;
@@ -226,6 +292,39 @@ namespace decoder {
     }
 
 
+    codec
+    vorbis::get_codec()
+        const noexcept
+    {
+        return codec::vorbis;
+    }
+
+
+    void
+    vorbis::restart(std::span<const char> data)
+    {
+        // Note: ov_clear() leaves ovf zeroed, and a failed ov_open_callbacks() clears it.
+        ov_clear(&ovf);
+        stream.clear();
+        bitrate = 0;
+
+        ov_callbacks callbacks {
+            .read_func = &read_callback,
+            .seek_func = nullptr,
+            .close_func = nullptr,
+            .tell_func = nullptr,
+        };
+
+        int e = ov_open_callbacks(this,
+                                  &ovf,
+                                  data.data(),
+                                  data.size_bytes(),
+                                  callbacks);
+        if (e)
+            throw error{"ov_open_callbacks() failed", e};
+    }
+
+
     std::size_t
     vorbis::read_callback(void* buf,
                           std::size_t size,
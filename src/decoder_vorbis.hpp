@@ -46,10 +46,19 @@ namespace decoder {
         feed(std::span<const char> data)
             override;
 
+        std::size_t
+        feed(byte_stream& src,
+             std::size_t max_bytes)
+            override;
+
         std::span<const char>
         decode()
             override;
 
+        std::size_t
+        decode_into(std::span<char> out)
+            override;
+
         std::optional<spec>
         get_spec()
             noexcept override;
@@ -62,6 +71,10 @@ namespace decoder {
         get_metadata()
             const override;
 
+        codec
+        get_codec()
+            const noexcept override;
+
 
         static
         std::size_t
@@ -70,6 +83,20 @@ namespace decoder {
                       std::size_t count,
                       void* ctx);
 
+
+    protected:
+
+        void
+        restart(std::span<const char> data)
+            override;
+
+
+    private:
+
+        // Decode into out as interleaved F32, return how many bytes were written.
+        std::size_t
+        read_float(std::span<char> out);
+
     }; // struct vorbis
 
 } // namespace decoder
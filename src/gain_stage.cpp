@@ -0,0 +1,275 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // clamp(), max(), min()
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>              // abs()
+
+#include "gain_stage.hpp"
+
+
+namespace {
+
+    // Mean square level that normalization aims for: -18 dBFS.
+    const float target_power = 0.0158f;
+
+    // How much normalization can change the level, in dB.
+    const float max_boost_db = 12;
+    const float max_cut_db = -12;
+
+    // Blocks quieter than -50 dBFS don't update the loudness.
+    const float gate_power = 1e-5f;
+
+    // Time constants, in seconds.
+    const float loudness_period = 3;
+    const float release_period = 1;
+
+    // The limiter keeps block peaks under this.
+    const float ceiling = 0.98f;
+
+    // Soft clipping starts here, and never reaches full scale.
+    const float knee = 0.8f;
+
+    // The kernels work on groups of this many samples, so the inner loops have a fixed
+    // trip count, and GCC vectorizes them even at -O2.
+    constexpr int lanes = 8;
+
+
+    struct block_stats {
+        float power = 0; // mean square
+        float peak = 0;
+    };
+
+
+    float
+    db_to_linear(float db)
+        noexcept
+    {
+        return std::pow(10.0f, db / 20);
+    }
+
+
+    block_stats
+    measure(std::span<const std::int16_t> samples)
+        noexcept
+    {
+        // Note: 32-bit partial sums, of the squares divided by 2^12, don't overflow for
+        // up to 64 Ki samples; quieter than the gate, the rounding doesn't matter.
+        std::int32_t sums[lanes] = {};
+        int peaks[lanes] = {};
+        const int n = samples.size();
+        int i = 0;
+        for (; i + lanes <= n; i += lanes)
+            for (int j = 0; j < lanes; ++j) {
+                const int x = samples[i + j];
+                const int a = std::abs(x);
+                sums[j] += (x * x) >> 12;
+                peaks[j] = a > peaks[j] ? a : peaks[j];
+            }
+        for (; i < n; ++i) {
+            const int x = samples[i];
+            sums[0] += (x * x) >> 12;
+            peaks[0] = std::max(peaks[0], std::abs(x));
+        }
+        std::int64_t sum = 0;
+        int peak = 0;
+        for (int j = 0; j < lanes; ++j) {
+            sum += sums[j];
+            peak = std::max(peak, peaks[j]);
+        }
+        const float scale = 1.0f / 32768;
+        return {
+            .power = sum * 4096.0f * scale * scale / n,
+            .peak = peak * scale,
+        };
+    }
+
+
+    block_stats
+    measure(std::span<const float> samples)
+        noexcept
+    {
+        // Note: one partial sum per lane; a single float sum can't be vectorized.
+        float sums[lanes] = {};
+        float peaks[lanes] = {};
+        const int n = samples.size();
+        int i = 0;
+        for (; i + lanes <= n; i += lanes)
+            for (int j = 0; j < lanes; ++j) {
+                const float x = samples[i + j];
+                const float a = std::fabs(x);
+                sums[j] += x * x;
+                peaks[j] = a > peaks[j] ? a : peaks[j];
+            }
+        for (; i < n; ++i) {
+            const float x = samples[i];
+            const float a = std::fabs(x);
+            sums[0] += x * x;
+            peaks[0] = a > peaks[0] ? a : peaks[0];
+        }
+        block_stats result;
+        for (int j = 0; j < lanes; ++j) {
+            result.power += sums[j];
+            result.peak = std::max(result.peak, peaks[j]);
+        }
+        result.power /= n;
+        return result;
+    }
+
+
+    // Identity up to the knee, then bends smoothly towards 1.
+    inline
+    float
+    soft_clip(float x)
+        noexcept
+    {
+        const float a = std::fabs(x);
+        const float excess = a - knee;
+        // Note: max(excess, 0) without a branch or a select, so GCC vectorizes it.
+        const float over = (excess + std::fabs(excess)) * 0.5f;
+        const float room = 1 - knee;
+        return std::copysign(a - over + room * over / (room + over), x);
+    }
+
+
+    // The gain goes from start, by step every sample.
+    void
+    apply(std::span<float> samples,
+          float start,
+          float step)
+        noexcept
+    {
+        const int n = samples.size();
+        int i = 0;
+        for (; i + lanes <= n; i += lanes)
+            for (int j = 0; j < lanes; ++j)
+                samples[i + j] = soft_clip(samples[i + j] * (start + step * (i + j)));
+        for (; i < n; ++i)
+            samples[i] = soft_clip(samples[i] * (start + step * i));
+    }
+
+
+    void
+    apply(std::span<std::int16_t> samples,
+          float start,
+          float step)
+        noexcept
+    {
+        const float scale = 1.0f / 32768;
+        const int n = samples.size();
+        int i = 0;
+        // Note: soft_clip() stays under 1, so this can't overflow.
+        for (; i + lanes <= n; i += lanes)
+            for (int j = 0; j < lanes; ++j)
+                samples[i + j] = soft_clip(samples[i + j] * scale
+                                           * (start + step * (i + j))) * 32767;
+        for (; i < n; ++i)
+            samples[i] = soft_clip(samples[i] * scale * (start + step * i)) * 32767;
+    }
+
+
+    template<typename T>
+    std::span<T>
+    as_samples(std::span<char> pcm)
+        noexcept
+    {
+        return {reinterpret_cast<T*>(pcm.data()), pcm.size() / sizeof(T)};
+    }
+
+} // namespace
+
+
+void
+gain_stage::set_gain_db(float db)
+    noexcept
+{
+    gain_db = db;
+}
+
+
+void
+gain_stage::set_normalize(bool enable)
+    noexcept
+{
+    normalize = enable;
+}
+
+
+void
+gain_stage::process(std::span<char> pcm,
+                    const decoder::spec& spec)
+    noexcept
+{
+    if (gain_db == 0 && !normalize) {
+        applied = 1;
+        return;
+    }
+
+    const bool is_s16 = spec.format == AUDIO_S16SYS;
+    const bool is_f32 = spec.format == AUDIO_F32SYS;
+    if (!is_s16 && !is_f32)
+        return;
+
+    const std::size_t count = pcm.size() / (is_s16 ? 2 : 4);
+    if (!count || spec.rate <= 0 || spec.channels <= 0)
+        return;
+    const float seconds = static_cast<float>(count) / (spec.rate * spec.channels);
+
+    const block_stats stats = is_s16
+        ? measure(as_samples<std::int16_t>(pcm))
+        : measure(as_samples<float>(pcm));
+
+    float target = db_to_linear(gain_db);
+
+    if (normalize) {
+        if (stats.power > gate_power) {
+            if (loudness == 0)
+                loudness = stats.power;
+            else
+                loudness += std::min(1.0f, seconds / loudness_period)
+                            * (stats.power - loudness);
+        }
+        if (loudness > 0)
+            target *= std::clamp(std::sqrt(target_power / loudness),
+                                 db_to_linear(max_cut_db),
+                                 db_to_linear(max_boost_db));
+    }
+
+    // Note: the limiter works on the block as a whole, so it's like a look-ahead.
+    if (stats.peak * target > ceiling)
+        target = ceiling / stats.peak;
+
+    // Drop immediately, recover slowly.
+    float next = target;
+    if (target > applied)
+        next = applied + std::min(1.0f, seconds / release_period) * (target - applied);
+
+    const float step = (next - applied) / count;
+    if (is_s16)
+        apply(as_samples<std::int16_t>(pcm), applied, step);
+    else
+        apply(as_samples<float>(pcm), applied, step);
+    applied = next;
+}
+
+
+float
+gain_stage::get_applied_db()
+    const noexcept
+{
+    return 20 * std::log10(applied);
+}
+
+
+void
+gain_stage::reset()
+    noexcept
+{
+    applied = 1;
+    loudness = 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef GAIN_STAGE_HPP
+#define GAIN_STAGE_HPP
+
+#include <span>
+
+#include "decoder.hpp"
+
+
+/*
+ * Volume processing for decoded PCM, between the decoder and the jitter buffer:
+ *
+ *   - a fixed gain, set per station;
+ *   - loudness normalization: the mean square level is tracked over a few seconds, and
+ *     the gain slowly moves it towards a target level; silence doesn't count;
+ *   - a limiter: the gain drops immediately if the block's peak would go over full scale,
+ *     and recovers slowly;
+ *   - soft clipping, for what still goes over.
+ *
+ * The gain is ramped sample by sample inside each block, so changes don't click. The
+ * kernels are plain loops over contiguous samples, with no branches, so the compiler can
+ * vectorize them (SSE/NEON on desktop); on the Wii U they're scalar float code, a few
+ * instructions per sample.
+ *
+ * Only S16 and F32 are processed; other formats pass through. With no gain and no
+ * normalization, the samples aren't touched at all.
+ */
+class gain_stage {
+
+    float gain_db = 0;
+    bool normalize = false;
+
+    float applied = 1;    // linear gain at the end of the last block
+    float loudness = 0;   // smoothed mean square, before any gain
+
+public:
+
+    void
+    set_gain_db(float db)
+        noexcept;
+
+    void
+    set_normalize(bool enable)
+        noexcept;
+
+
+    // In place.
+    void
+    process(std::span<char> pcm,
+            const decoder::spec& spec)
+        noexcept;
+
+
+    // The total gain applied to the last block.
+    [[nodiscard]]
+    float
+    get_applied_db()
+        const noexcept;
+
+
+    // Forget the measured loudness, like at the start of a new stream.
+    void
+    reset()
+        noexcept;
+
+}; // class gain_stage
+
+#endif
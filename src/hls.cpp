@@ -0,0 +1,346 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <charconv>             // from_chars()
+#include <optional>
+#include <utility>              // move()
+
+#include "hls.hpp"
+
+#include "string_utils.hpp"
+
+
+using namespace std::literals;
+
+
+namespace hls {
+
+    namespace {
+
+        // Calls func(line) for every non-empty line, without the line breaks.
+        template<typename F>
+        void
+        for_each_line(std::string_view text,
+                      F&& func)
+        {
+            while (!text.empty()) {
+                auto end = text.find_first_of("\r\n");
+                auto line = string_utils::trimmed_view(text.substr(0, end));
+                if (!line.empty())
+                    func(line);
+                if (end == std::string_view::npos)
+                    break;
+                text.remove_prefix(end + 1);
+            }
+        }
+
+
+        // Find an attribute in a list like: BANDWIDTH=128000,CODECS="mp4a.40.2,mp4a.40.5"
+        std::optional<std::string_view>
+        get_attribute(std::string_view list,
+                      std::string_view name)
+        {
+            while (!list.empty()) {
+                auto eq = list.find('=');
+                if (eq == std::string_view::npos)
+                    return {};
+                auto key = string_utils::trimmed_view(list.substr(0, eq));
+                list.remove_prefix(eq + 1);
+
+                std::string_view value;
+                if (list.starts_with('"')) {
+                    auto close = list.find('"', 1);
+                    if (close == std::string_view::npos)
+                        return {};
+                    value = list.substr(1, close - 1);
+                    list.remove_prefix(close + 1);
+                    auto comma = list.find(',');
+                    list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+                } else {
+                    auto comma = list.find(',');
+                    value = list.substr(0, comma);
+                    list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+                }
+
+                if (key == name)
+                    return value;
+            }
+            return {};
+        }
+
+
+        template<typename T>
+        T
+        to_number(std::string_view s,
+                  T fallback = {})
+        {
+            T result = fallback;
+            auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), result);
+            if (ec != std::errc{})
+                return fallback;
+            return result;
+        }
+
+
+        std::string_view
+        after(std::string_view line,
+              std::string_view tag)
+        {
+            return line.substr(tag.size());
+        }
+
+    } // namespace
+
+
+    error::error(const std::string& msg) :
+        std::runtime_error{"HLS error: " + msg}
+    {}
+
+
+    bool
+    is_hls(std::string_view text)
+        noexcept
+    {
+        return text.contains("#EXT-X-");
+    }
+
+
+    bool
+    is_master(std::string_view text)
+        noexcept
+    {
+        return text.contains("#EXT-X-STREAM-INF");
+    }
+
+
+    master_playlist
+    parse_master(std::string_view text,
+                 const std::string& base_url)
+    {
+        master_playlist result;
+        std::optional<variant> pending;
+
+        for_each_line(text, [&](std::string_view line)
+        {
+            if (line.starts_with("#EXT-X-STREAM-INF:")) {
+                auto attrs = after(line, "#EXT-X-STREAM-INF:");
+                pending.emplace();
+                if (auto bw = get_attribute(attrs, "BANDWIDTH"))
+                    pending->bandwidth = to_number<unsigned>(*bw);
+                if (auto codecs = get_attribute(attrs, "CODECS"))
+                    pending->codecs = *codecs;
+                return;
+            }
+            if (line.starts_with('#'))
+                return;
+            if (pending) {
+                pending->url = resolve_url(base_url, line);
+                result.variants.push_back(std::move(*pending));
+                pending.reset();
+            }
+        });
+
+        if (result.variants.empty())
+            throw error{"master playlist has no variants"};
+        return result;
+    }
+
+
+    media_playlist
+    parse_media(std::string_view text,
+                const std::string& base_url)
+    {
+        media_playlist result;
+        std::optional<double> duration;
+        std::uint64_t next_sequence = 0;
+
+        for_each_line(text, [&](std::string_view line)
+        {
+            if (line.starts_with("#EXT-X-TARGETDURATION:")) {
+                result.target_duration = to_number<double>(after(line, "#EXT-X-TARGETDURATION:"));
+                return;
+            }
+            if (line.starts_with("#EXT-X-MEDIA-SEQUENCE:")) {
+                result.media_sequence = to_number<std::uint64_t>(after(line,
+                                                                       "#EXT-X-MEDIA-SEQUENCE:"));
+                next_sequence = result.media_sequence;
+                return;
+            }
+            if (line.starts_with("#EXTINF:")) {
+                auto value = after(line, "#EXTINF:");
+                duration = to_number<double>(value.substr(0, value.find(',')));
+                return;
+            }
+            if (line.starts_with("#EXT-X-ENDLIST")) {
+                result.ended = true;
+                return;
+            }
+            if (line.starts_with("#EXT-X-KEY:")) {
+                auto method = get_attribute(after(line, "#EXT-X-KEY:"), "METHOD");
+                if (method && *method != "NONE")
+                    throw error{"encrypted segments are not supported"};
+                return;
+            }
+            if (line.starts_with("#EXT-X-MAP:"))
+                throw error{"fragmented MP4 segments are not supported"};
+            if (line.starts_with('#'))
+                return;
+
+            segment seg;
+            seg.sequence = next_sequence++;
+            seg.url = resolve_url(base_url, line);
+            seg.duration = duration.value_or(result.target_duration);
+            result.segments.push_back(std::move(seg));
+            duration.reset();
+        });
+
+        if (result.target_duration <= 0) {
+            // Note: it's mandatory, but a sane fallback is better than failing.
+            result.target_duration = 10;
+            for (auto& seg : result.segments)
+                if (seg.duration <= 0)
+                    seg.duration = result.target_duration;
+        }
+        return result;
+    }
+
+
+    const variant&
+    pick_variant(const master_playlist& pl,
+                 unsigned max_bandwidth)
+    {
+        const variant* best = nullptr;
+        const variant* smallest = nullptr;
+        for (auto& v : pl.variants) {
+            if (!smallest || v.bandwidth < smallest->bandwidth)
+                smallest = &v;
+            if (v.bandwidth <= max_bandwidth && (!best || v.bandwidth > best->bandwidth))
+                best = &v;
+        }
+        if (!smallest)
+            throw error{"no variants to pick from"};
+        return best ? *best : *smallest;
+    }
+
+
+    std::string
+    resolve_url(const std::string& base_url,
+                std::string_view ref)
+    {
+        if (ref.contains("://"))
+            return std::string{ref};
+
+        auto scheme_end = base_url.find("://");
+        if (scheme_end == std::string::npos)
+            return std::string{ref};
+
+        if (ref.starts_with("//"))
+            return base_url.substr(0, scheme_end + 1) + std::string{ref};
+
+        auto authority_end = base_url.find_first_of("/?#", scheme_end + 3);
+        if (ref.starts_with('/'))
+            return base_url.substr(0, authority_end) + std::string{ref};
+
+        // Note: the query doesn't belong to the directory.
+        std::string dir = base_url.substr(0, base_url.find_first_of("?#", scheme_end + 3));
+        auto slash = dir.rfind('/');
+        if (slash == std::string::npos || slash < scheme_end + 3)
+            dir += '/';
+        else
+            dir.resize(slash + 1);
+        return dir + std::string{ref};
+    }
+
+} // namespace hls
+
+
+#ifdef UNIT_TEST
+
+// compilation: g++ -std=c++23 -DUNIT_TEST hls.cpp
+
+#include <iostream>
+
+#include "string_utils.cpp"
+
+#include "unit_test.hpp"
+
+using std::cout;
+using std::endl;
+
+int main()
+{
+    int total = 0;
+    int successes = 0;
+
+    {
+        cout << "Test: resolve_url" << endl;
+        CHECK_EQUAL(hls::resolve_url("http://a.com/x/live.m3u8?t=1", "seg1.ts"),
+                    "http://a.com/x/seg1.ts"s);
+        CHECK_EQUAL(hls::resolve_url("http://a.com/x/live.m3u8", "/seg1.ts"),
+                    "http://a.com/seg1.ts"s);
+        CHECK_EQUAL(hls::resolve_url("https://a.com/x/live.m3u8", "//b.com/s.ts"),
+                    "https://b.com/s.ts"s);
+        CHECK_EQUAL(hls::resolve_url("http://a.com", "s.ts"),
+                    "http://a.com/s.ts"s);
+        CHECK_EQUAL(hls::resolve_url("http://a.com/x/", "http://c.com/s.ts"),
+                    "http://c.com/s.ts"s);
+    }
+
+    {
+        cout << "Test: master playlist" << endl;
+        auto input = "#EXTM3U\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=64000,CODECS=\"mp4a.40.5\"\n"
+            "low/index.m3u8\n"
+            "#EXT-X-STREAM-INF:CODECS=\"mp4a.40.2\",BANDWIDTH=256000\r\n"
+            "high/index.m3u8\r\n"
+            "#EXT-X-STREAM-INF:BANDWIDTH=1280000\n"
+            "video/index.m3u8\n"s;
+        CHECK_EQUAL(hls::is_hls(input), true);
+        CHECK_EQUAL(hls::is_master(input), true);
+        auto pl = hls::parse_master(input, "http://a.com/master.m3u8");
+        CHECK_EQUAL(pl.variants.size(), 3);
+        CHECK_EQUAL(pl.variants.at(0).url, "http://a.com/low/index.m3u8"s);
+        CHECK_EQUAL(pl.variants.at(1).codecs, "mp4a.40.2"s);
+        CHECK_EQUAL(pl.variants.at(1).bandwidth, 256000);
+        CHECK_EQUAL(hls::pick_variant(pl, 320000).url, "http://a.com/high/index.m3u8"s);
+        CHECK_EQUAL(hls::pick_variant(pl, 1000).url, "http://a.com/low/index.m3u8"s);
+    }
+
+    {
+        cout << "Test: media playlist" << endl;
+        auto input = "#EXTM3U\n"
+            "#EXT-X-TARGETDURATION:6\n"
+            "#EXT-X-MEDIA-SEQUENCE:100\n"
+            "#EXTINF:6.0,\n"
+            "s100.aac\n"
+            "#EXTINF:5.5,title\n"
+            "s101.aac\n"s;
+        CHECK_EQUAL(hls::is_master(input), false);
+        auto pl = hls::parse_media(input, "http://a.com/live/index.m3u8");
+        CHECK_EQUAL(pl.target_duration, 6);
+        CHECK_EQUAL(pl.media_sequence, 100);
+        CHECK_EQUAL(pl.ended, false);
+        CHECK_EQUAL(pl.segments.size(), 2);
+        CHECK_EQUAL(pl.segments.at(1).sequence, 101);
+        CHECK_EQUAL(pl.segments.at(1).duration, 5.5);
+        CHECK_EQUAL(pl.segments.at(1).url, "http://a.com/live/s101.aac"s);
+    }
+
+    {
+        cout << "Test: unsupported media playlists" << endl;
+        CHECK_EXCEPT(hls::parse_media("#EXTM3U\n#EXT-X-KEY:METHOD=AES-128,URI=\"k\"\ns.ts\n",
+                                      "http://a.com/"),
+                     hls::error);
+        CHECK_EXCEPT(hls::parse_media("#EXTM3U\n#EXT-X-MAP:URI=\"init.mp4\"\ns.m4s\n",
+                                      "http://a.com/"),
+                     hls::error);
+    }
+
+    cout << "Successes: " << successes << " / " << total << endl;
+}
+
+#endif // UNIT_TEST
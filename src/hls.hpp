@@ -0,0 +1,92 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef HLS_HPP
+#define HLS_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// HTTP Live Streaming (RFC 8216) playlists.
+namespace hls {
+
+    struct error : std::runtime_error {
+
+        error(const std::string& msg);
+
+    }; // struct error
+
+
+    struct variant {
+        std::string url;
+        unsigned bandwidth = 0;
+        std::string codecs;
+    }; // struct variant
+
+
+    struct master_playlist {
+        std::vector<variant> variants;
+    }; // struct master_playlist
+
+
+    struct segment {
+        std::uint64_t sequence = 0;
+        std::string url;
+        double duration = 0;
+    }; // struct segment
+
+
+    struct media_playlist {
+        double target_duration = 0;
+        std::uint64_t media_sequence = 0;
+        std::vector<segment> segments;
+        bool ended = false;     // #EXT-X-ENDLIST, it's not live
+    }; // struct media_playlist
+
+
+    // True if the M3U text has HLS tags, so it's not just a list of streams.
+    [[nodiscard]]
+    bool
+    is_hls(std::string_view text)
+        noexcept;
+
+    [[nodiscard]]
+    bool
+    is_master(std::string_view text)
+        noexcept;
+
+
+    // Relative URLs are resolved against base_url. Throws hls::error.
+    master_playlist
+    parse_master(std::string_view text,
+                 const std::string& base_url);
+
+    // Throws hls::error, also for encrypted or fragmented MP4 segments.
+    media_playlist
+    parse_media(std::string_view text,
+                const std::string& base_url);
+
+
+    // Pick the best variant that fits in max_bandwidth (bits per second), or the smallest
+    // one if none fits. The playlist must not be empty.
+    const variant&
+    pick_variant(const master_playlist& pl,
+                 unsigned max_bandwidth);
+
+
+    [[nodiscard]]
+    std::string
+    resolve_url(const std::string& base_url,
+                std::string_view ref);
+
+} // namespace hls
+
+#endif
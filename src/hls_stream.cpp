@@ -0,0 +1,334 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // clamp(), min()
+#include <array>
+#include <iostream>
+#include <thread>
+#include <utility>              // move()
+
+#include "hls_stream.hpp"
+
+#include "mime_type.hpp"
+#include "tracer.hpp"
+
+
+using std::cout;
+using std::endl;
+
+using namespace std::literals;
+
+
+namespace hls {
+
+    namespace {
+
+        // How many segments are downloaded at the same time.
+        const std::size_t max_fetches = 3;
+
+        // Don't request more segments while this much is waiting for the decoder.
+        const std::size_t max_buffered = 1024 * 1024;
+
+        // Pick the best variant up to this bandwidth, in bits per second.
+        const unsigned max_bandwidth = 320'000;
+
+        // A live stream starts this many segments from the end (RFC 8216, 6.3.3).
+        const std::size_t live_edge_segments = 3;
+
+        // Give up after this many failed requests in a row.
+        const unsigned max_failures = 5;
+
+        constexpr mime_type::pattern audio_mime{"audio/*"};
+
+        // ID3v2 header: "ID3", version (2), flags, size (4, syncsafe)
+        const std::size_t id3_header_size = 10;
+
+
+        // Guess from the CODECS attribute (RFC 6381).
+        std::optional<std::string>
+        codecs_to_content_type(std::string_view codecs)
+        {
+            if (codecs.contains("mp4a.40.34") || codecs.contains("mp4a.6b")
+                || codecs.contains("mp3"))
+                return "audio/mpeg";
+            if (codecs.contains("mp4a"))
+                return "audio/aac";
+            return {};
+        }
+
+    } // namespace
+
+
+    stream::fetch::fetch(const std::string& user_agent) :
+        http{user_agent}
+    {
+        http.on_response_finished = [this] { done = true; };
+    }
+
+
+    stream::stream(const std::string& url,
+                   std::string_view playlist,
+                   const std::string& user_agent) :
+        user_agent{user_agent},
+        playlist_http{user_agent}
+    {
+        TRACE_FUNC;
+
+        playlist_http.on_response_finished = [this] { playlist_done = true; };
+
+        if (is_master(playlist)) {
+            auto master = parse_master(playlist, url);
+            const auto& v = pick_variant(master, max_bandwidth);
+            cout << "HLS: picked variant with bandwidth " << v.bandwidth
+                 << " out of " << master.variants.size() << endl;
+            media_url = v.url;
+            codecs = v.codecs;
+            if (v.bandwidth)
+                bitrate = v.bandwidth / 1000;
+            request_playlist();
+        } else {
+            media_url = url;
+            load_playlist(playlist);
+        }
+    }
+
+
+    void
+    stream::process()
+    {
+        if (playlist_loading) {
+            try {
+                playlist_http.process();
+            }
+            catch (std::exception& e) {
+                playlist_loading = false;
+                record_failure(e);
+                next_refresh = clock::now()
+                    + std::chrono::duration_cast<clock::duration>(
+                          std::chrono::duration<double>{target_duration / 2});
+            }
+        }
+
+        if (playlist_done) {
+            playlist_loading = false;
+            playlist_done = false;
+            load_playlist(playlist_http.data_stream.read_str());
+        }
+
+        if (!playlist_loading && !ended && !media_url.empty() && clock::now() >= next_refresh)
+            request_playlist();
+
+        request_segments();
+
+        for (auto& f : fetches) {
+            if (f->done)
+                continue;
+            try {
+                f->http.process();
+            }
+            catch (std::exception& e) {
+                // Note: skipping a segment is better than restarting the whole stream.
+                cout << "HLS: skipping segment " << f->seg.sequence << endl;
+                f->done = true;
+                f->failed = true;
+                f->http.data_stream.clear();
+                record_failure(e);
+            }
+        }
+
+        drain();
+    }
+
+
+    void
+    stream::wait(std::chrono::milliseconds timeout)
+    {
+        if (!fetches.empty()) {
+            if (!fetches.front()->done)
+                fetches.front()->http.wait(timeout);
+            return;
+        }
+
+        if (playlist_loading) {
+            playlist_http.wait(timeout);
+            return;
+        }
+
+        if (ended)
+            return;
+
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(next_refresh - clock::now());
+        std::this_thread::sleep_for(std::clamp(left, 0ms, timeout));
+    }
+
+
+    std::optional<std::string>
+    stream::get_content_type()
+        const
+    {
+        if (demuxer)
+            return demuxer->get_content_type();
+        if (segment_content_type)
+            return segment_content_type;
+        return codecs_to_content_type(codecs);
+    }
+
+
+    bool
+    stream::finished()
+        const noexcept
+    {
+        return ended && queued.empty() && fetches.empty();
+    }
+
+
+    void
+    stream::request_playlist()
+    {
+        playlist_http.set_url(media_url);
+        playlist_loading = true;
+        playlist_done = false;
+    }
+
+
+    void
+    stream::load_playlist(std::string_view text)
+    {
+        auto pl = parse_media(text, media_url);
+        target_duration = pl.target_duration;
+        ended = pl.ended;
+
+        std::size_t first = 0;
+        if (!last_sequence) {
+            if (!ended && pl.segments.size() > live_edge_segments)
+                first = pl.segments.size() - live_edge_segments;
+        } else if (pl.media_sequence > *last_sequence + 1)
+            cout << "HLS: fell behind the live playlist, "
+                 << (pl.media_sequence - *last_sequence - 1)
+                 << " segments were lost" << endl;
+
+        std::size_t added = 0;
+        for (std::size_t i = first; i < pl.segments.size(); ++i) {
+            auto& seg = pl.segments[i];
+            if (last_sequence && seg.sequence <= *last_sequence)
+                continue;
+            last_sequence = seg.sequence;
+            queued.push_back(std::move(seg));
+            ++added;
+        }
+
+        // Note: reload after the target duration, or half of it if nothing changed
+        // (RFC 8216, 6.3.4).
+        double delay = added ? target_duration : target_duration / 2;
+        next_refresh = clock::now()
+            + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>{delay});
+    }
+
+
+    void
+    stream::request_segments()
+    {
+        while (!queued.empty()
+               && fetches.size() < max_fetches
+               && data_stream.size() < max_buffered) {
+            std::unique_ptr<fetch> f;
+            if (spare.empty())
+                f = std::make_unique<fetch>(user_agent);
+            else {
+                f = std::move(spare.back());
+                spare.pop_back();
+            }
+            f->seg = std::move(queued.front());
+            queued.pop_front();
+            f->done = false;
+            f->failed = false;
+            f->started = false;
+            f->http.set_url(f->seg.url);
+            fetches.push_back(std::move(f));
+        }
+    }
+
+
+    void
+    stream::drain()
+    {
+        while (!fetches.empty()) {
+            auto& head = *fetches.front();
+            if (!output(head) || !head.done)
+                return;
+            if (!head.failed)
+                failures = 0;
+            spare.push_back(std::move(fetches.front()));
+            fetches.pop_front();
+        }
+    }
+
+
+    bool
+    stream::output(fetch& f)
+    {
+        auto& in = f.http.data_stream;
+
+        // Note: a failed fetch must not decide the format, or eat an ID3 tag.
+        if (f.failed) {
+            in.clear();
+            return true;
+        }
+
+        if (!f.started) {
+            // Packed audio segments start with an ID3 tag, with the timestamp.
+            std::array<std::uint8_t, id3_header_size> hdr;
+            if (in.peek(std::span{hdr}) < hdr.size())
+                return f.done;
+            std::size_t skip = 0;
+            if (hdr[0] == 'I' && hdr[1] == 'D' && hdr[2] == '3') {
+                skip = id3_header_size
+                    + ((hdr[6] & 0x7f) << 21 | (hdr[7] & 0x7f) << 14
+                       | (hdr[8] & 0x7f) << 7 | (hdr[9] & 0x7f));
+                if (hdr[5] & 0x10)
+                    skip += id3_header_size; // footer
+            }
+            if (in.size() < skip)
+                return f.done;
+            in.discard(skip);
+            f.started = true;
+        }
+
+        if (!format_known) {
+            if (in.size() < 2 * mpeg_ts::packet_size && !f.done)
+                return false;
+            auto head = in.linearize();
+            if (mpeg_ts::probe({reinterpret_cast<const char*>(head.data()), head.size()})) {
+                cout << "HLS: segments are MPEG transport streams" << endl;
+                demuxer.emplace();
+            } else if (auto ct = f.http.get_header("content-type");
+                       ct && audio_mime.matches(*ct))
+                segment_content_type = *ct;
+            format_known = true;
+        }
+
+        for (auto span : in.readable_spans()) {
+            std::span<const char> chunk{reinterpret_cast<const char*>(span.data()), span.size()};
+            if (demuxer)
+                demuxer->feed(chunk, data_stream);
+            else
+                data_stream.write(chunk);
+        }
+        in.clear();
+        return true;
+    }
+
+
+    void
+    stream::record_failure(const std::exception& e)
+    {
+        cout << "HLS: " << e.what() << endl;
+        if (++failures >= max_failures)
+            throw error{"too many failed requests"};
+    }
+
+} // namespace hls
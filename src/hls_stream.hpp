@@ -0,0 +1,148 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef HLS_STREAM_HPP
+#define HLS_STREAM_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "byte_stream.hpp"
+#include "hls.hpp"
+#include "http_client.hpp"
+#include "mpeg_ts.hpp"
+
+
+namespace hls {
+
+    /*
+     * Plays an HLS stream: it refreshes the media playlist when it's live, and downloads
+     * the next few segments concurrently, so the per-request latency doesn't stall the
+     * playback.
+     *
+     * The segments are appended to data_stream in order, as elementary audio (ID3 tags
+     * stripped, transport streams demuxed), so it can go straight into the decoder.
+     */
+    class stream {
+
+    public:
+
+        byte_stream data_stream;
+
+        // From the variant's BANDWIDTH, in kbps.
+        std::optional<unsigned> bitrate;
+
+
+        // The playlist text was already downloaded from url; it can be either a master or
+        // a media playlist. Throws hls::error.
+        stream(const std::string& url,
+               std::string_view playlist,
+               const std::string& user_agent);
+
+        // disallow moving
+        stream(stream&&) = delete;
+
+
+        // Throws hls::error when too many requests in a row fail.
+        void
+        process();
+
+        // Block until the segment at the head has data, or the timeout expires.
+        void
+        wait(std::chrono::milliseconds timeout);
+
+
+        // Known once the first segment starts arriving.
+        [[nodiscard]]
+        std::optional<std::string>
+        get_content_type()
+            const;
+
+        // True when the playlist ended, and every segment was delivered.
+        [[nodiscard]]
+        bool
+        finished()
+            const noexcept;
+
+    private:
+
+        using clock = std::chrono::steady_clock;
+
+        struct fetch {
+
+            http_client http;
+            segment seg;
+            bool done = false;
+            bool failed = false;
+            // Set after the leading ID3 tag was skipped.
+            bool started = false;
+
+            fetch(const std::string& user_agent);
+
+        }; // struct fetch
+
+
+        std::string user_agent;
+        std::string media_url;
+        std::string codecs;
+
+        http_client playlist_http;
+        bool playlist_loading = false;
+        bool playlist_done = false;
+        clock::time_point next_refresh;
+
+        double target_duration = 0;
+        bool ended = false;
+
+        // Known segments that weren't requested yet.
+        std::deque<segment> queued;
+        std::optional<std::uint64_t> last_sequence;
+
+        // Requests in flight, in sequence order; only the head writes to data_stream.
+        std::deque<std::unique_ptr<fetch>> fetches;
+        // Finished requests, kept so their connections can be reused: each http_client's
+        // curl multi handle keeps its idle connections. The native path closes them.
+        std::vector<std::unique_ptr<fetch>> spare;
+
+        bool format_known = false;
+        std::optional<mpeg_ts::demuxer> demuxer;
+        std::optional<std::string> segment_content_type;
+
+        unsigned failures = 0;
+
+
+        void
+        request_playlist();
+
+        void
+        load_playlist(std::string_view text);
+
+        void
+        request_segments();
+
+        // Append what the head requests received, and recycle the finished ones.
+        void
+        drain();
+
+        // Returns false if it needs more data first.
+        bool
+        output(fetch& f);
+
+        void
+        record_failure(const std::exception& e);
+
+    }; // class stream
+
+} // namespace hls
+
+#endif
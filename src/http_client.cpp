@@ -5,12 +5,22 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <algorithm>            // min()
 #include <functional>
 #include <iostream>
+#include <thread>
 #include <vector>
 
+#include <sys/select.h>         // fd_set
+
 #include "http_client.hpp"
 
+#include "curl_share.hpp"
+#include "http_socket.hpp"
+#include "metrics.hpp"
+#include "net/connector.hpp"
+#include "net/socket.hpp"
+#include "socket_tuning.hpp"
 #include "string_utils.hpp"
 #include "tracer.hpp"
 
@@ -22,6 +32,33 @@ using namespace std::literals;
 using namespace std::placeholders;
 
 
+namespace {
+
+    // How much the native transfer reads per frame, when there's no high watermark.
+    const std::size_t native_chunk_size = 64 * 1024;
+
+
+    // Called by curl after creating the socket, before connecting.
+    int
+    streaming_sockopt_callback(void*,
+                               curl_socket_t fd,
+                               curlsocktype purpose)
+    {
+        if (purpose != CURLSOCKTYPE_IPCXN)
+            return CURL_SOCKOPT_OK;
+        // Note: the socket belongs to curl, so it's released before it gets closed.
+        net::socket sock{fd};
+        socket_tuning::apply(sock);
+        sock.release();
+        return CURL_SOCKOPT_OK;
+    }
+
+} // namespace
+
+
+std::atomic<bool> http_client::native_enabled = false;
+
+
 http_client::http_client(const std::string& user_agent) :
     user_agent{user_agent}
 {
@@ -61,6 +98,7 @@ void
 http_client::add_header(const std::string& hdr)
 {
     easy.append_http_header(hdr);
+    headers.push_back(hdr);
 }
 
 
@@ -77,7 +115,42 @@ http_client::set_url(const std::string& url)
     // TRACE_FUNC;
 
     multi.remove(easy);
+    native.reset();
+    native_finished = false;
+    native_buffer.clear();
 
+    request_prepared = false;
+    response_started = false;
+    pending_on_response_started = false;
+    pending_on_recv = false;
+    paused = false;
+
+    data_stream.clear();
+
+    if (native_enabled.load() && url.starts_with("http://")) {
+        try {
+            auto sock = std::make_unique<http_socket>();
+            sock->user_agent = user_agent;
+            sock->streaming = streaming;
+            sock->headers = headers;
+            if (!accepts.empty())
+                sock->headers.push_back("Accept: "s + string_utils::join(accepts, ","));
+            sock->start(url);
+            native = std::move(sock);
+            return;
+        }
+        catch (http_socket::unsupported_error& e) {
+            cout << "http_client: using curl for " << url << ": " << e.what() << endl;
+        }
+    }
+
+    start_curl(url);
+}
+
+
+void
+http_client::start_curl(const std::string& url)
+{
     easy.reset();
     easy.set_verbose(true); // DEBUG
     if (!user_agent.empty())
@@ -94,31 +167,53 @@ http_client::set_url(const std::string& url)
     easy.set_transfer_encoding(true);
     easy.set_url(url);
     easy.set_write_function(std::bind(&http_client::curl_write_callback, this, _1));
+    curl_easy_setopt(easy.data(), CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS,
+                     static_cast<long>(net::default_connection_stagger.count()));
+    if (streaming)
+        curl_easy_setopt(easy.data(), CURLOPT_SOCKOPTFUNCTION, streaming_sockopt_callback);
+    curl_share::attach(easy);
 
     multi.add(easy);
-
-    request_prepared = false;
-    response_started = false;
-    pending_on_response_started = false;
-    pending_on_recv = false;
-
-    data_stream.clear();
 }
 
 
 void
 http_client::process()
 {
+    if (native) {
+        try {
+            process_native();
+            return;
+        }
+        catch (http_socket::unsupported_error& e) {
+            // Note: after a redirect, it's the last http:// URL; curl follows the rest.
+            if (response_started)
+                throw;
+            cout << "http_client: switching to curl for " << native->current_url()
+                 << ": " << e.what() << endl;
+            auto url = native->current_url();
+            native.reset();
+            start_curl(url);
+        }
+    }
+
     if (!request_prepared) {
         if (!accepts.empty())
             easy.append_http_header("Accept: "s + string_utils::join(accepts, ","));
         request_prepared = true;
     }
 
+    if (paused && get_fill_level() <= low_watermark) {
+        paused = false;
+        curl_easy_pause(easy.data(), CURLPAUSE_CONT);
+    }
+
     multi.perform();
 
     // Note: we invoke them here, not inside the curl callback.
     if  (pending_on_response_started) {
+        // Note: streams may never finish, so count the connection as soon as it responds.
+        curl_share::record(easy);
         if (on_response_started)
             on_response_started();
         pending_on_response_started = false;
@@ -142,12 +237,104 @@ http_client::process()
 }
 
 
+void
+http_client::wait(std::chrono::milliseconds timeout)
+{
+    using flags = net::socket::poll_flags;
+
+    poller.clear();
+
+    if (native) {
+        // Note: when paused or finished, the socket would wake us up for nothing.
+        if (!paused && !native_finished)
+            native->add_to(poller);
+    } else if (!paused) {
+        // Host curl's sockets in the poller, and don't sleep past curl's own timers.
+        fd_set read_set, write_set, error_set;
+        FD_ZERO(&read_set);
+        FD_ZERO(&write_set);
+        FD_ZERO(&error_set);
+        int max_fd = -1;
+        curl_multi_fdset(multi.data(), &read_set, &write_set, &error_set, &max_fd);
+        for (int fd = 0; fd <= max_fd; ++fd) {
+            auto events = flags::none;
+            if (FD_ISSET(fd, &read_set))
+                events = events | flags::in;
+            if (FD_ISSET(fd, &write_set))
+                events = events | flags::out;
+            if (FD_ISSET(fd, &error_set))
+                events = events | flags::pri;
+            if (events != flags::none)
+                poller.add(fd, events);
+        }
+        long curl_timeout = -1;
+        curl_multi_timeout(multi.data(), &curl_timeout);
+        if (curl_timeout >= 0)
+            timeout = std::min(timeout, std::chrono::milliseconds{curl_timeout});
+    }
+
+    if (poller.empty()) {
+        std::this_thread::sleep_for(timeout);
+        return;
+    }
+
+    auto result = poller.try_wait(timeout);
+    if (!result)
+        cout << "WARNING: http_client::wait(): " << result.error().what() << endl;
+}
+
+
+void
+http_client::set_watermarks(std::size_t low_bytes,
+                            std::size_t high_bytes)
+    noexcept
+{
+    high_watermark = high_bytes;
+    low_watermark = std::min(low_bytes, high_bytes);
+}
+
+
+std::size_t
+http_client::get_fill_level()
+    const noexcept
+{
+    return fill_stream->size();
+}
+
+
+bool
+http_client::is_paused()
+    const noexcept
+{
+    return paused;
+}
+
+
+bool
+http_client::is_native()
+    const noexcept
+{
+    return native != nullptr;
+}
+
+
+void
+http_client::set_native_enabled(bool enable)
+    noexcept
+{
+    native_enabled.store(enable);
+}
+
+
 std::optional<std::string>
 http_client::get_header(const std::string& name)
 {
     if (!response_started)
         return {};
 
+    if (native)
+        return native->get_header(name);
+
     auto result = easy.try_get_header(name);
     if (result)
         return result->value;
@@ -163,7 +350,20 @@ http_client::curl_write_callback(std::span<const char> buf)
         return 0;
     }
 
-    data_stream.write(buf);
+    // Note: returning CURL_WRITEFUNC_PAUSE means this buffer will be delivered again after
+    // unpausing, so nothing can be consumed from it.
+    if (high_watermark && get_fill_level() >= high_watermark) {
+        paused = true;
+        return CURL_WRITEFUNC_PAUSE;
+    }
+
+    if (on_data)
+        on_data(buf);
+    else
+        data_stream.write(buf);
+
+    static auto& received = metrics::get_counter("stream/bytes_received");
+    received.add(buf.size());
 
     if (!response_started) {
         response_started = true;
@@ -174,3 +374,58 @@ http_client::curl_write_callback(std::span<const char> buf)
 
     return buf.size();
 }
+
+
+void
+http_client::process_native()
+{
+    if (native_finished)
+        return;
+
+    std::size_t max_bytes = native_chunk_size;
+    if (high_watermark) {
+        const std::size_t level = get_fill_level();
+        if (paused && level <= low_watermark)
+            paused = false;
+        if (!paused && level >= high_watermark)
+            paused = true;
+        if (paused)
+            return;
+        max_bytes = high_watermark - level;
+    }
+
+    // Note: without on_data, the socket receives straight into data_stream.
+    byte_stream& dest = on_data ? native_buffer : data_stream;
+    const bool had_headers = native->headers_ready();
+    const std::size_t received = native->process(dest, max_bytes);
+
+    if (!had_headers && native->headers_ready()) {
+        response_started = true;
+        if (on_response_started)
+            on_response_started();
+    }
+
+    // Note: on_response_started may have set on_data, for data already in native_buffer.
+    if (on_data && native_buffer.size()) {
+        for (auto span : native_buffer.readable_spans())
+            on_data({reinterpret_cast<const char*>(span.data()), span.size()});
+        native_buffer.clear();
+    } else if (!on_data && native_buffer.size()) {
+        for (auto span : native_buffer.readable_spans())
+            data_stream.write(span);
+        native_buffer.clear();
+    }
+
+    if (received) {
+        static auto& received_counter = metrics::get_counter("stream/bytes_received");
+        received_counter.add(received);
+        if (on_recv)
+            on_recv();
+    }
+
+    if (native->finished()) {
+        native_finished = true;
+        if (on_response_finished)
+            on_response_finished();
+    }
+}
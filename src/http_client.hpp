@@ -8,31 +8,51 @@
 #ifndef HTTP_CLIENT_HPP
 #define HTTP_CLIENT_HPP
 
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
+#include <vector>
 
 #include <curlxx/curl.hpp>
 
 #include "byte_stream.hpp"
+#include "memory_accounting.hpp"
+#include "net/poller.hpp"
+
+
+class http_socket;
 
 
 struct http_client {
 
     std::string user_agent;
 
+    // Long-lived audio stream; its sockets get the socket_tuning options.
+    bool streaming = false;
+
     curl::multi multi;
     curl::easy easy;
     bool request_prepared = false;
     bool response_started = false;
-    byte_stream data_stream;
+    byte_stream data_stream{memory_accounting::tag::network};
 
 
     std::function<void()> on_response_started;
     std::function<void()> on_response_finished;
     std::function<void()> on_recv;
 
+    // Note: unlike the others, it's invoked inside the curl callback; when set, incoming
+    // data goes straight to it, bypassing data_stream.
+    std::function<void(std::span<const char>)> on_data;
+
+    // Where received data accumulates; whoever sets on_data should point it to its own
+    // buffer, so the fill level stays meaningful.
+    const byte_stream* fill_stream = &data_stream;
+
 
     // disallow moving
     http_client(http_client&&) = delete;
@@ -59,12 +79,63 @@ struct http_client {
     process();
 
 
+    // Block until the connection has something for process(), or the timeout expires.
+    void
+    wait(std::chrono::milliseconds timeout);
+
+
+    // The transfer is paused when the fill level reaches high_bytes, and resumed when it
+    // drops to low_bytes or less. Zero disables the limit.
+    void
+    set_watermarks(std::size_t low_bytes,
+                   std::size_t high_bytes)
+        noexcept;
+
+    std::size_t
+    get_fill_level()
+        const noexcept;
+
+    bool
+    is_paused()
+        const noexcept;
+
+    // True when the current URL is handled by http_socket.
+    [[nodiscard]]
+    bool
+    is_native()
+        const noexcept;
+
+
+    // Use http_socket for plain http:// URLs, in all clients; curl is still used for
+    // everything else. Off by default; takes effect on the next set_url().
+    static
+    void
+    set_native_enabled(bool enable)
+        noexcept;
+
+
     std::optional<std::string>
     get_header(const std::string& name);
 
 private:
 
     std::vector<std::string> accepts;
+    std::vector<std::string> headers;
+
+    static std::atomic<bool> native_enabled;
+
+    std::unique_ptr<http_socket> native;
+    // Scratch space for the native transfer, when on_data is set.
+    byte_stream native_buffer{memory_accounting::tag::network};
+    bool native_finished = false;
+
+    net::poller poller;
+
+    void
+    start_curl(const std::string& url);
+
+    void
+    process_native();
 
     std::size_t
     curl_write_callback(std::span<const char> buf);
@@ -72,6 +143,10 @@ private:
     bool pending_on_response_started = false;
     bool pending_on_recv = false;
 
+    std::size_t low_watermark = 0;
+    std::size_t high_watermark = 0;
+    bool paused = false;
+
 }; // struct http_client
 
 #endif
@@ -0,0 +1,461 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // min()
+#include <cctype>               // tolower()
+#include <charconv>             // from_chars()
+#include <iostream>
+#include <ranges>
+#include <string_view>
+#include <system_error>
+
+#include "http_socket.hpp"
+
+#include "hls.hpp"
+#include "net/error.hpp"
+#include "net/resolver.hpp"
+#include "socket_tuning.hpp"
+#include "string_utils.hpp"
+
+
+using std::cout;
+using std::endl;
+
+using namespace std::literals;
+
+
+namespace {
+
+    const unsigned max_redirects = 5;
+
+    // For the name lookup, connection and response headers together.
+    const auto connect_timeout = 10s;
+
+    const std::size_t max_header_size = 16 * 1024;
+
+
+    std::string
+    to_lower(std::string_view s)
+    {
+        std::string result{s};
+        for (auto& c : result)
+            c = std::tolower(static_cast<unsigned char>(c));
+        return result;
+    }
+
+
+    bool
+    would_block(const net::error& e)
+        noexcept
+    {
+        return e.code() == std::errc::operation_would_block
+            || e.code() == std::errc::resource_unavailable_try_again;
+    }
+
+} // namespace
+
+
+void
+http_socket::start(const std::string& new_url)
+{
+    redirects = 0;
+    restart(new_url);
+}
+
+
+void
+http_socket::restart(const std::string& new_url)
+{
+    sock = {};
+    connector.reset();
+    lookup.reset();
+    header_buf.clear();
+    status = 0;
+    response_headers.clear();
+    body_left.reset();
+
+    parse_url(new_url);
+    current_phase = phase::resolving;
+    deadline = std::chrono::steady_clock::now() + connect_timeout;
+}
+
+
+std::size_t
+http_socket::process(byte_stream& dest,
+                     std::size_t max_bytes)
+{
+    if (current_phase != phase::idle
+        && current_phase != phase::receiving_body
+        && current_phase != phase::finished
+        && std::chrono::steady_clock::now() > deadline)
+        throw std::runtime_error{"timeout connecting to " + host};
+
+    switch (current_phase) {
+
+        case phase::idle:
+        case phase::finished:
+            return 0;
+
+        case phase::resolving:
+            if (!lookup)
+                start_lookup();
+            if (!lookup->done.load())
+                return 0;
+            start_connecting();
+            current_phase = phase::connecting;
+            check_connected();
+            return 0;
+
+        case phase::connecting:
+            check_connected();
+            return 0;
+
+        case phase::receiving_headers:
+            return receive_headers(dest, max_bytes);
+
+        case phase::receiving_body:
+            return receive_body(dest, max_bytes);
+
+    }
+    return 0;
+}
+
+
+bool
+http_socket::headers_ready()
+    const noexcept
+{
+    return current_phase == phase::receiving_body
+        || current_phase == phase::finished;
+}
+
+
+bool
+http_socket::finished()
+    const noexcept
+{
+    return current_phase == phase::finished;
+}
+
+
+void
+http_socket::add_to(net::poller& p)
+    const
+{
+    switch (current_phase) {
+        case phase::connecting:
+            connector.add_to(p);
+            break;
+        case phase::receiving_headers:
+        case phase::receiving_body:
+            p.add(sock, net::socket::poll_flags::in);
+            break;
+        default:
+            break;
+    }
+}
+
+
+const std::string&
+http_socket::current_url()
+    const noexcept
+{
+    return url;
+}
+
+
+unsigned
+http_socket::status_code()
+    const noexcept
+{
+    return status;
+}
+
+
+std::optional<std::string>
+http_socket::get_header(const std::string& name)
+    const
+{
+    for (const auto& [key, value] : response_headers)
+        if (string_utils::equal_case(key, name))
+            return value;
+    return {};
+}
+
+
+void
+http_socket::parse_url(const std::string& new_url)
+{
+    const auto prefix = "http://"sv;
+    if (new_url.size() <= prefix.size()
+        || !string_utils::equal_case(std::string_view{new_url}.substr(0, prefix.size()),
+                                     prefix))
+        throw unsupported_error{"not an http:// URL: " + new_url};
+
+    std::string_view rest = std::string_view{new_url}.substr(prefix.size());
+
+    auto path_start = rest.find_first_of("/?#");
+    std::string_view authority = rest.substr(0, path_start);
+    std::string new_path = path_start == std::string_view::npos
+        ? "/"
+        : std::string{rest.substr(path_start)};
+    if (auto frag = new_path.find('#'); frag != std::string::npos)
+        new_path.erase(frag);
+    if (new_path.empty() || new_path.front() != '/')
+        new_path.insert(0, "/");
+
+    if (authority.find('@') != std::string_view::npos)
+        throw unsupported_error{"credentials in URL"};
+    if (authority.starts_with('['))
+        throw unsupported_error{"IPv6 literal in URL"};
+
+    std::string new_port = "80";
+    if (auto colon = authority.rfind(':'); colon != std::string_view::npos) {
+        new_port = authority.substr(colon + 1);
+        authority = authority.substr(0, colon);
+        if (new_port.empty())
+            new_port = "80";
+    }
+    if (authority.empty())
+        throw unsupported_error{"no host in URL: " + new_url};
+
+    // Note: only a valid URL replaces the current one.
+    url = new_url;
+    path = std::move(new_path);
+    port = std::move(new_port);
+    host = authority;
+}
+
+
+void
+http_socket::start_lookup()
+{
+    lookup = std::make_shared<lookup_result>();
+    auto func = [result = lookup, host = host, port = port](std::stop_token)
+    {
+        net::resolver::address_resolver ar;
+        ar.param.type = net::socket::type::tcp;
+        if (ar.try_process(host, port))
+            for (const auto& entry : ar.result.entries)
+                result->addresses.push_back(entry.addr);
+        else
+            result->error = ar.error.message.value_or("unknown error");
+        result->done.store(true);
+    };
+    lookup_task = scheduler::submit(scheduler::category::dns, std::move(func));
+}
+
+
+void
+http_socket::start_connecting()
+{
+    if (!lookup->error.empty())
+        throw std::runtime_error{"failed resolving \"" + host + "\": " + lookup->error};
+    auto addresses = std::move(lookup->addresses);
+    lookup.reset();
+    if (addresses.empty())
+        throw std::runtime_error{"no addresses for \"" + host + "\""};
+
+    connector.on_create = [this](net::socket& s)
+    {
+        if (streaming)
+            socket_tuning::apply(s);
+    };
+    connector.start(addresses);
+}
+
+
+void
+http_socket::check_connected()
+{
+    if (auto connected = connector.process()) {
+        sock = std::move(*connected);
+        send_request();
+    }
+}
+
+
+void
+http_socket::send_request()
+{
+    std::string req = "GET " + path + " HTTP/1.0\r\n";
+    req += "Host: " + host;
+    if (port != "80")
+        req += ":" + port;
+    req += "\r\n";
+    if (!user_agent.empty())
+        req += "User-Agent: " + user_agent + "\r\n";
+    for (const auto& hdr : headers)
+        req += hdr + "\r\n";
+    req += "Connection: close\r\n\r\n";
+
+    // Note: the request is much smaller than the socket buffer, send_all() won't spin.
+    sock.send_all(req.data(), req.size());
+    current_phase = phase::receiving_headers;
+}
+
+
+std::size_t
+http_socket::receive_headers(byte_stream& dest,
+                             std::size_t max_bytes)
+{
+    char buf[2048];
+    auto received = sock.try_recv(buf, sizeof buf);
+    if (!received) {
+        if (would_block(received.error()))
+            return 0;
+        throw received.error();
+    }
+    if (!*received)
+        throw std::runtime_error{"connection closed before the response headers"};
+
+    const std::size_t old_size = header_buf.size();
+    header_buf.append(buf, *received);
+
+    // Note: the end marker may straddle two receives.
+    auto end = header_buf.find("\r\n\r\n", old_size >= 3 ? old_size - 3 : 0);
+    std::size_t marker_size = 4;
+    if (end == std::string::npos) {
+        // Some SHOUTcast servers use bare newlines.
+        end = header_buf.find("\n\n", old_size >= 1 ? old_size - 1 : 0);
+        marker_size = 2;
+    }
+    if (end == std::string::npos) {
+        if (header_buf.size() > max_header_size)
+            throw std::runtime_error{"response headers are too big"};
+        return 0;
+    }
+
+    std::string body_start = header_buf.substr(end + marker_size);
+    header_buf.resize(end);
+
+    if (handle_headers())
+        return 0;
+
+    current_phase = phase::receiving_body;
+    if (body_start.empty())
+        return 0;
+    if (body_left && body_start.size() > *body_left)
+        body_start.resize(*body_left);
+    // Note: the leftover must not be lost, even if it goes over max_bytes.
+    (void)max_bytes;
+    dest.write(body_start.data(), body_start.size());
+    if (body_left) {
+        *body_left -= body_start.size();
+        if (!*body_left) {
+            current_phase = phase::finished;
+            sock = {};
+        }
+    }
+    return body_start.size();
+}
+
+
+std::size_t
+http_socket::receive_body(byte_stream& dest,
+                          std::size_t max_bytes)
+{
+    std::size_t total = 0;
+    if (body_left)
+        max_bytes = std::min(max_bytes, *body_left);
+
+    // Note: receive straight into the stream's free space.
+    auto spans = dest.writable_spans(max_bytes);
+    for (auto span : spans) {
+        std::size_t len = std::min(span.size(), max_bytes - total);
+        if (!len)
+            break;
+        auto received = sock.try_recv(span.data(), len);
+        if (!received) {
+            if (would_block(received.error()))
+                break;
+            dest.commit_write(total);
+            throw received.error();
+        }
+        if (!*received) {
+            current_phase = phase::finished;
+            sock = {};
+            break;
+        }
+        total += *received;
+        if (*received < len)
+            break;
+    }
+    dest.commit_write(total);
+
+    if (body_left) {
+        *body_left -= total;
+        if (!*body_left) {
+            current_phase = phase::finished;
+            sock = {};
+        }
+    }
+    return total;
+}
+
+
+bool
+http_socket::handle_headers()
+{
+    auto lines = string_utils::split(std::string_view{header_buf}, "\n"sv, true);
+    if (lines.empty())
+        throw std::runtime_error{"empty response"};
+
+    // "HTTP/1.0 200 OK" or "ICY 200 OK"
+    auto status_line = string_utils::trimmed_view(lines.front());
+    auto space = status_line.find(' ');
+    if (space == std::string_view::npos)
+        throw std::runtime_error{"invalid status line: " + std::string{status_line}};
+    auto code_str = status_line.substr(space + 1, 3);
+    status = 0;
+    auto [ptr, ec] = std::from_chars(code_str.data(), code_str.data() + code_str.size(),
+                                     status);
+    if (ec != std::errc{})
+        throw std::runtime_error{"invalid status line: " + std::string{status_line}};
+
+    for (auto line : lines | std::views::drop(1)) {
+        line = string_utils::trimmed_view(line);
+        auto colon = line.find(':');
+        if (colon == std::string_view::npos)
+            continue;
+        response_headers.emplace_back(to_lower(string_utils::trimmed_view(line.substr(0, colon))),
+                                      std::string{string_utils::trimmed_view(line.substr(colon + 1))});
+    }
+
+    if (status >= 300 && status < 400) {
+        auto location = get_header("location");
+        if (!location)
+            throw std::runtime_error{"redirect without a location"};
+        if (++redirects > max_redirects)
+            throw std::runtime_error{"too many redirects"};
+        // Note: relative and scheme-relative locations are resolved like HLS URIs.
+        std::string next = hls::resolve_url(url, *location);
+        cout << "http_socket: redirected to " << next << endl;
+        // Note: for https://, this throws unsupported_error, and url stays unchanged.
+        restart(next);
+        return true;
+    }
+
+    if (status < 200 || status >= 300)
+        throw std::runtime_error{"HTTP error " + std::to_string(status) + " from " + url};
+
+    if (auto te = get_header("transfer-encoding"); te && !string_utils::equal_case(*te, "identity"))
+        throw unsupported_error{"transfer encoding: " + *te};
+
+    if (auto len = get_header("content-length")) {
+        std::size_t n = 0;
+        auto [p, e] = std::from_chars(len->data(), len->data() + len->size(), n);
+        if (e == std::errc{})
+            body_left = n;
+    }
+    if (body_left && !*body_left) {
+        current_phase = phase::finished;
+        sock = {};
+    }
+
+    return false;
+}
@@ -0,0 +1,184 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef HTTP_SOCKET_HPP
+#define HTTP_SOCKET_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>               // shared_ptr
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>              // pair<>
+#include <vector>
+
+#include "byte_stream.hpp"
+#include "net/connector.hpp"
+#include "net/poller.hpp"
+#include "net/socket.hpp"
+#include "scheduler.hpp"
+
+
+/*
+ * A minimal streaming HTTP client, directly on net::socket, for Icecast/SHOUTcast streams.
+ *
+ * It sends an HTTP/1.0 GET, so servers answer without chunked encoding, and receives the
+ * body straight into a byte_stream. Redirects to http:// URLs are followed.
+ *
+ * Anything it can't handle (https://, chunked responses, malformed URLs) throws
+ * unsupported_error; the caller should use curl for that URL instead, see current_url().
+ *
+ * Nothing blocks: the name lookup runs as a scheduler task, and process() checks on it.
+ * Connecting races all the addresses, see net::connector.
+ */
+class http_socket {
+
+public:
+
+    struct unsupported_error : std::runtime_error {
+
+        using std::runtime_error::runtime_error;
+
+    }; // struct unsupported_error
+
+
+    std::string user_agent;
+    // Extra request headers, like "Icy-MetaData: 1".
+    std::vector<std::string> headers;
+    // Apply socket_tuning to the connection.
+    bool streaming = false;
+
+
+    // Only parses the URL; throws unsupported_error if it's not http://.
+    void
+    start(const std::string& url);
+
+
+    /*
+     * Make progress, without blocking. Body data is appended to dest, at most max_bytes.
+     * Returns how many body bytes were received.
+     */
+    std::size_t
+    process(byte_stream& dest,
+            std::size_t max_bytes);
+
+
+    [[nodiscard]]
+    bool
+    headers_ready()
+        const noexcept;
+
+    // The server closed the connection, or the whole Content-Length arrived.
+    [[nodiscard]]
+    bool
+    finished()
+        const noexcept;
+
+
+    // Add the sockets process() is waiting on, if any.
+    void
+    add_to(net::poller& p)
+        const;
+
+
+    // After redirects.
+    [[nodiscard]]
+    const std::string&
+    current_url()
+        const noexcept;
+
+
+    [[nodiscard]]
+    unsigned
+    status_code()
+        const noexcept;
+
+
+    // Case-insensitive; only available after headers_ready().
+    [[nodiscard]]
+    std::optional<std::string>
+    get_header(const std::string& name)
+        const;
+
+private:
+
+    enum class phase {
+        idle,
+        resolving,
+        connecting,
+        receiving_headers,
+        receiving_body,
+        finished,
+    };
+
+    phase current_phase = phase::idle;
+
+    std::string url;
+    std::string host;
+    std::string port = "80";
+    std::string path;
+    unsigned redirects = 0;
+
+    // Written by the lookup task, read once done is set.
+    struct lookup_result {
+        std::atomic<bool> done = false;
+        std::vector<net::address> addresses;
+        std::string error;
+    };
+
+    std::shared_ptr<lookup_result> lookup;
+    // Note: replacing or destroying it waits for a lookup still running.
+    scheduler::task lookup_task;
+
+    net::socket sock;
+    net::connector connector;
+
+    std::string header_buf;
+    unsigned status = 0;
+    // Names are stored in lower case.
+    std::vector<std::pair<std::string, std::string>> response_headers;
+    std::optional<std::size_t> body_left;
+
+    std::chrono::steady_clock::time_point deadline;
+
+
+    void
+    parse_url(const std::string& new_url);
+
+    void
+    start_lookup();
+
+    // Throws if the lookup failed.
+    void
+    start_connecting();
+
+    void
+    check_connected();
+
+    void
+    send_request();
+
+    std::size_t
+    receive_headers(byte_stream& dest,
+                    std::size_t max_bytes);
+
+    std::size_t
+    receive_body(byte_stream& dest,
+                 std::size_t max_bytes);
+
+    // Returns true if it's a redirect, and the request was restarted.
+    bool
+    handle_headers();
+
+    void
+    restart(const std::string& new_url);
+
+}; // class http_socket
+
+#endif
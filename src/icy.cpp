@@ -13,8 +13,6 @@
 using std::runtime_error;
 using std::string;
 
-using namespace std::literals;
-
 
 namespace icy {
 
@@ -22,62 +20,14 @@ namespace icy {
     parse(std::string_view input)
     {
         dict_t result;
-
-        const auto npos = std::string_view::npos;
-        using size_type = std::string_view::size_type;
-
-        while (!input.empty()) {
-
-            // Look for KeyName=
-            size_type key_end_pos = input.find('=');
-            if (key_end_pos == npos)
-                break;
-
-            std::string_view key = input.substr(0, key_end_pos);
-            if (key.empty())
-                // Input error: empty key
-                break;
-
-            // Discard all the way up to the '='
-            input.remove_prefix(key_end_pos + 1);
-            if (input.empty())
-                // Input error: empty value
-                break;
-
-            char quote_char = input.front();
-            if (quote_char != '\'' && quote_char != '"')
-                break;
-
-            input.remove_prefix(1);
-            if (input.empty())
-                // Input error: truncated inside quotes
-                break;
-
-            size_type remove_size = 2;
-            size_type close_quote_pos = input.find(quote_char + ";"s);
-            if (close_quote_pos == npos) {
-                // When on the end of input, the last quote doesn't have a following ';'
-                close_quote_pos = input.size() - 1;
-                remove_size = 1;
-                if (input[close_quote_pos] != quote_char)
-                    // Input error: input does not end in the closing quote char
-                    break;
-            }
-
-            if (close_quote_pos == npos)
-                // Input error: unterminated quote
-                break;
-
-            std::string_view value = input.substr(0, close_quote_pos);
-
-            result.emplace(key, value);
-
-            input.remove_prefix(close_quote_pos + remove_size);
-
-        }
-
+        visit(input,
+              [&result](std::string_view key, std::string_view value)
+              {
+                  result.emplace(key, value);
+              });
         return result;
     }
+
 } // icy
 
 
@@ -8,6 +8,7 @@
 #ifndef ICY_HPP
 #define ICY_HPP
 
+#include <string>
 #include <string_view>
 #include <unordered_map>
 
@@ -19,6 +20,63 @@ namespace icy {
     dict_t
     parse(std::string_view input);
 
+
+    // Call func(key, value) for every field in input, without allocating; the views
+    // point into input.
+    template<typename Func>
+    void
+    visit(std::string_view input,
+          Func&& func)
+    {
+        const auto npos = std::string_view::npos;
+        using size_type = std::string_view::size_type;
+
+        while (!input.empty()) {
+
+            // Look for KeyName=
+            size_type key_end_pos = input.find('=');
+            if (key_end_pos == npos)
+                break;
+
+            std::string_view key = input.substr(0, key_end_pos);
+            if (key.empty())
+                // Input error: empty key
+                break;
+
+            // Discard all the way up to the '='
+            input.remove_prefix(key_end_pos + 1);
+            if (input.empty())
+                // Input error: empty value
+                break;
+
+            char quote_char = input.front();
+            if (quote_char != '\'' && quote_char != '"')
+                break;
+
+            input.remove_prefix(1);
+            if (input.empty())
+                // Input error: truncated inside quotes
+                break;
+
+            const char terminator[2] = { quote_char, ';' };
+            size_type remove_size = 2;
+            size_type close_quote_pos = input.find(std::string_view{terminator, 2});
+            if (close_quote_pos == npos) {
+                // When on the end of input, the last quote doesn't have a following ';'
+                close_quote_pos = input.size() - 1;
+                remove_size = 1;
+                if (input[close_quote_pos] != quote_char)
+                    // Input error: input does not end in the closing quote char
+                    break;
+            }
+
+            func(key, input.substr(0, close_quote_pos));
+
+            input.remove_prefix(close_quote_pos + remove_size);
+
+        }
+    }
+
 } // namespace icy
 
 #endif
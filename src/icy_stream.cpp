@@ -5,6 +5,8 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <algorithm>            // find_if(), min()
+#include <cstring>              // memcpy()
 #include <iostream>
 #include <stdexcept>
 
@@ -18,51 +20,100 @@
 using std::cout;
 using std::endl;
 
+using namespace std::literals;
+
 
 namespace icy {
 
     stream::stream(http_client& hc) :
-        http(hc)
+        http{&hc}
+    {
+        TRACE_FUNC;
+
+        read_headers([&hc](const std::string& name) { return hc.get_header(name); });
+
+        // Anything that arrived together with the headers is still in the http buffer.
+        for (auto s : http->data_stream.readable_spans())
+            demux({reinterpret_cast<const char*>(s.data()), s.size()});
+        http->data_stream.clear();
+
+        http->on_data = [this](std::span<const char> buf) { demux(buf); };
+        http->fill_stream = &data_stream;
+    }
+
+
+    stream::stream(const header_lookup& get_header)
     {
         TRACE_FUNC;
 
+        read_headers(get_header);
+    }
+
+
+    stream::stream(std::size_t metaint) :
+        interval{metaint},
+        data_left{metaint}
+    {}
+
+
+    stream::~stream()
+        noexcept
+    {
+        if (!http)
+            return;
+        http->on_data = nullptr;
+        http->fill_stream = &http->data_stream;
+    }
+
+
+    void
+    stream::read_headers(const header_lookup& get_header)
+    {
         using string_utils::trimmed;
 
         unsigned icy_num = 0;
 
-        if (auto hdr = http.get_header("icy-metaint")) {
+        if (auto hdr = get_header("icy-metaint")) {
             cout << "Got icy-metaint: " << *hdr << endl;
             data_left = interval = std::stoull(*hdr);
             ++icy_num;
         }
 
-        if (auto hdr = http.get_header("icy-name")) {
+        if (auto hdr = get_header("icy-name")) {
             initial_meta.station_name = trimmed(*hdr);
             ++icy_num;
         }
 
-        if (auto hdr = http.get_header("icy-url")) {
+        if (auto hdr = get_header("icy-url")) {
             initial_meta.station_url = trimmed(*hdr);
             ++icy_num;
         }
 
-        if (auto hdr = http.get_header("icy-genre")) {
+        if (auto hdr = get_header("icy-genre")) {
             initial_meta.station_genre = trimmed(*hdr);
             ++icy_num;
         }
 
-        if (auto hdr = http.get_header("icy-description")) {
+        if (auto hdr = get_header("icy-description")) {
             initial_meta.station_description = trimmed(*hdr);
             ++icy_num;
         }
 
-        if (auto hdr = http.get_header("icy-br"))
+        if (auto hdr = get_header("icy-br")) {
+            // Note: some servers send multiple values, like "128,128".
+            try {
+                bitrate = std::stoul(*hdr);
+            }
+            catch (std::exception& e) {
+                cout << "Invalid icy-br: " << *hdr << endl;
+            }
             ++icy_num;
+        }
 
-        if (auto hdr = http.get_header("ice-audio-info"))
+        if (auto hdr = get_header("ice-audio-info"))
             ++icy_num;
 
-        if (auto hdr = http.get_header("icy-pub"))
+        if (auto hdr = get_header("icy-pub"))
             ++icy_num;
 
         if (!icy_num)
@@ -81,40 +132,43 @@ namespace icy {
 
 
     void
-    stream::process()
+    stream::demux(std::span<const char> buf)
     {
         if (!interval) {
-            data_stream.consume(http.data_stream);
+            data_stream.write(buf);
             return;
         }
 
-        // try to convert the whole raw_stream into either data_stream or meta_stream
-        while (!http.data_stream.empty()) {
-
-            if (data_left)
-                data_left -= data_stream.consume(http.data_stream, data_left);
-            else {
-                // no more data, start reading metadata
-
-                if (meta_left == 0) {
-                    // when both data_left and meta_left are zero, we're waiting for the
-                    // meta size prefix
-                    auto c = http.data_stream.try_load_u8();
-                    if (!c) // if not enough raw data to parse size of meta data, give up
-                        return;
-                    meta_left = *c * 16u;
-                    if (meta_left == 0) { // no metadata for now
-                        data_left = interval;
-                        continue;
-                    }
-                }
+        while (!buf.empty()) {
+
+            if (data_left) {
+                std::size_t n = std::min(data_left, buf.size());
+                data_stream.write(buf.first(n));
+                data_left -= n;
+                buf = buf.subspan(n);
+                continue;
+            }
 
-                meta_left -= meta_stream.consume(http.data_stream, meta_left);
-                if (meta_left == 0) {
-                    // finished reading this chunk of metadata
+            if (meta_left == 0) {
+                // when both data_left and meta_left are zero, the next byte is the meta
+                // size prefix
+                meta_left = static_cast<unsigned char>(buf.front()) * 16u;
+                buf = buf.subspan(1);
+                meta_size = 0;
+                if (meta_left == 0) // no metadata for now
                     data_left = interval;
-                    process_metadata();
-                }
+                continue;
+            }
+
+            std::size_t n = std::min(meta_left, buf.size());
+            std::memcpy(meta_buf.data() + meta_size, buf.data(), n);
+            meta_size += n;
+            meta_left -= n;
+            buf = buf.subspan(n);
+            if (meta_left == 0) {
+                // finished reading this chunk of metadata
+                data_left = interval;
+                process_metadata({meta_buf.data(), meta_size});
             }
 
         }
@@ -122,35 +176,86 @@ namespace icy {
 
 
     void
-    stream::process_metadata()
+    stream::process_metadata(std::string_view meta_str)
     {
-        using string_utils::trimmed;
-
-        current_meta = initial_meta;
+        using string_utils::trimmed_view;
 
         // Note: icy metadata is padded with null bytes.
-        std::string meta_str = trimmed(meta_stream.read_str(), '\0');
-
-        auto meta = icy::parse(meta_str);
+        meta_str = trimmed_view(meta_str, "\0"sv);
 
 #if 0
-        cout << "Icy Metadata:\n";
-        for (auto [key, val] : meta)
-            cout << "    " << key << "=\"" << val << "\"\n";
-        cout << endl;
+        cout << "Icy Metadata: " << meta_str << endl;
 #endif
 
-        for (const auto& [k, v] : meta) {
+        // Note: most blocks repeat the previous title, so only touch the strings when
+        // something changed.
+        bool has_title = false;
+        bool has_url = false;
+        bool changed = false;
+        std::size_t num_extra = 0;
+        auto handle_field = [&](std::string_view k, std::string_view v)
+        {
+            v = trimmed_view(v);
             // TODO: check if there are more special keys
             // TODO: handle StreamArtwork
             if (k == "StreamTitle") {
-                current_meta.title = trimmed(v);
+                has_title = true;
+                changed |= update(current_meta.title, v);
             } else if (k == "StreamUrl") {
-                current_meta.cover_art = trimmed(v);
-            } else
-                current_meta.extra[k] = trimmed(v);
+                has_url = true;
+                changed |= update(current_meta.cover_art, v);
+            } else {
+                ++num_extra;
+                auto& extra = current_meta.extra;
+                auto it = std::ranges::find_if(extra,
+                                               [k](const auto& e) { return e.first == k; });
+                if (it == extra.end()) {
+                    extra.emplace(k, v);
+                    changed = true;
+                } else if (it->second != v) {
+                    it->second = v;
+                    changed = true;
+                }
+            }
+        };
+
+        icy::visit(meta_str, handle_field);
+
+        if (!has_title && current_meta.title != initial_meta.title) {
+            current_meta.title = initial_meta.title;
+            changed = true;
+        }
+        if (!has_url && current_meta.cover_art != initial_meta.cover_art) {
+            current_meta.cover_art = initial_meta.cover_art;
+            changed = true;
         }
 
+        if (current_meta.extra.size() > num_extra) {
+            // some old fields are gone, rebuild them
+            current_meta.extra = initial_meta.extra;
+            num_extra = 0;
+            icy::visit(meta_str,
+                       [&](std::string_view k, std::string_view v)
+                       {
+                           if (k != "StreamTitle" && k != "StreamUrl")
+                               handle_field(k, v);
+                       });
+            changed = true;
+        }
+
+        if (changed)
+            ++generation;
+    }
+
+
+    bool
+    stream::update(std::optional<std::string>& field,
+                   std::string_view value)
+    {
+        if (field && *field == value)
+            return false;
+        field = value;
+        return true;
     }
 
 } // namespace icy
@@ -8,8 +8,13 @@
 #ifndef ICY_STREAM_HPP
 #define ICY_STREAM_HPP
 
+#include <array>
 #include <cstddef>
+#include <functional>
+#include <optional>
 #include <span>
+#include <string>
+#include <string_view>
 
 #include "byte_stream.hpp"
 #include "http_client.hpp"
@@ -20,32 +25,68 @@ namespace icy {
 
     struct stream {
 
-        http_client& http;
-        byte_stream meta_stream;
+        using header_lookup = std::function<std::optional<std::string>(const std::string&)>;
+
+        // Null when there's no HTTP connection.
+        http_client* http = nullptr;
         byte_stream data_stream;
 
         std::size_t interval = 0;
         std::size_t data_left = 0;
         std::size_t meta_left = 0;
 
+        // From the icy-br header, in kbps.
+        std::optional<unsigned> bitrate;
+
         stream_metadata initial_meta;
         stream_metadata current_meta;
+        // Incremented every time current_meta changes.
+        unsigned generation = 0;
 
+        // Note: while this object exists, it intercepts all data received by hc.
         stream(http_client& hc);
 
+        // Without a connection, like for a recorded stream; feed it through demux().
+        explicit
+        stream(const header_lookup& get_header);
+
+        explicit
+        stream(std::size_t metaint);
+
+        ~stream()
+            noexcept;
+
+        // disallow moving
+        stream(stream&&) = delete;
+
 
         const stream_metadata&
         get_metadata()
             const noexcept;
 
 
+        // Split buf into audio (appended to data_stream) and metadata, in a single pass.
         void
-        process();
+        demux(std::span<const char> buf);
 
     private:
 
+        // The length prefix is one byte, in units of 16 bytes.
+        std::array<char, 255 * 16> meta_buf;
+        std::size_t meta_size = 0;
+
+        // Throws if there are no ICY headers.
         void
-        process_metadata();
+        read_headers(const header_lookup& get_header);
+
+        void
+        process_metadata(std::string_view meta_str);
+
+        // Returns true if field changed.
+        static
+        bool
+        update(std::optional<std::string>& field,
+               std::string_view value);
 
 
     }; // struct stream
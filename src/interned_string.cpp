@@ -0,0 +1,200 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+#include <utility>              // swap()
+
+#include "interned_string.hpp"
+
+
+struct interned_string::entry {
+    std::string text;
+    // Note: it only drops to zero with the table locked, so it can't be revived and
+    // erased at the same time.
+    mutable std::atomic<unsigned> refs = 0;
+};
+
+
+namespace {
+
+    using entry = interned_string::entry;
+
+
+    struct entry_hash {
+        using is_transparent = void;
+
+        std::size_t
+        operator ()(std::string_view s)
+            const noexcept
+        {
+            return std::hash<std::string_view>{}(s);
+        }
+
+        std::size_t
+        operator ()(const entry& e)
+            const noexcept
+        {
+            return (*this)(e.text);
+        }
+    };
+
+
+    struct entry_equal {
+        using is_transparent = void;
+
+        bool
+        operator ()(const entry& a,
+                    const entry& b)
+            const noexcept
+        {
+            return a.text == b.text;
+        }
+
+        bool
+        operator ()(std::string_view a,
+                    const entry& b)
+            const noexcept
+        {
+            return a == b.text;
+        }
+
+        bool
+        operator ()(const entry& a,
+                    std::string_view b)
+            const noexcept
+        {
+            return a.text == b;
+        }
+    };
+
+
+    struct table {
+        std::mutex mutex;
+        // Note: nodes are stable, so pointers to the elements stay valid.
+        std::unordered_set<entry, entry_hash, entry_equal> entries;
+    };
+
+
+    table&
+    get_table()
+    {
+        // Note: never destroyed, interned strings may outlive other static objects.
+        static table* t = new table;
+        return *t;
+    }
+
+
+    const entry*
+    intern(std::string_view s)
+    {
+        if (s.empty())
+            return nullptr;
+        auto& t = get_table();
+        std::lock_guard lock{t.mutex};
+        auto it = t.entries.find(s);
+        if (it == t.entries.end())
+            it = t.entries.emplace(std::string{s}).first;
+        it->refs.fetch_add(1, std::memory_order_relaxed);
+        return &*it;
+    }
+
+
+    void
+    acquire(const entry* e)
+        noexcept
+    {
+        if (e)
+            e->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+
+    void
+    release(const entry* e)
+        noexcept
+    {
+        if (!e)
+            return;
+
+        // Fast path: this is not the last reference.
+        unsigned refs = e->refs.load(std::memory_order_relaxed);
+        while (refs > 1)
+            if (e->refs.compare_exchange_weak(refs, refs - 1, std::memory_order_release))
+                return;
+
+        auto& t = get_table();
+        std::lock_guard lock{t.mutex};
+        if (e->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            auto it = t.entries.find(e->text);
+            t.entries.erase(it);
+        }
+    }
+
+
+    const std::string empty_string;
+
+} // namespace
+
+
+interned_string::interned_string(std::string_view s) :
+    ptr{intern(s)}
+{}
+
+
+interned_string::interned_string(const std::string& s) :
+    interned_string{std::string_view{s}}
+{}
+
+
+interned_string::interned_string(const char* s) :
+    interned_string{std::string_view{s ? s : ""}}
+{}
+
+
+interned_string::interned_string(const interned_string& other)
+    noexcept :
+    ptr{other.ptr}
+{
+    acquire(ptr);
+}
+
+
+interned_string::~interned_string()
+    noexcept
+{
+    release(ptr);
+}
+
+
+interned_string&
+interned_string::operator =(const interned_string& other)
+    noexcept
+{
+    // Note: acquire first, in case it's the same entry.
+    acquire(other.ptr);
+    release(ptr);
+    ptr = other.ptr;
+    return *this;
+}
+
+
+interned_string&
+interned_string::operator =(interned_string&& other)
+    noexcept
+{
+    std::swap(ptr, other.ptr);
+    return *this;
+}
+
+
+const std::string&
+interned_string::str()
+    const noexcept
+{
+    return ptr ? ptr->text : empty_string;
+}
@@ -0,0 +1,263 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef INTERNED_STRING_HPP
+#define INTERNED_STRING_HPP
+
+#include <compare>
+#include <cstddef>
+#include <functional>           // hash
+#include <string>
+#include <string_view>
+#include <utility>              // exchange()
+
+#include <glaze/beve/read.hpp>
+#include <glaze/beve/write.hpp>
+#include <glaze/json/read.hpp>
+#include <glaze/json/write.hpp>
+
+
+/*
+ * Immutable string, stored only once in a global table.
+ *
+ * Meant for the values that repeat across many stations, like tags, languages, country
+ * codes and codecs: a copy is just a pointer and a reference count, and equality is a
+ * pointer comparison. A string is removed from the table when its last copy is destroyed.
+ *
+ * Interning and copying are thread-safe.
+ */
+class interned_string {
+
+public:
+
+    // Note: only defined in interned_string.cpp.
+    struct entry;
+
+private:
+
+    // Null for the empty string.
+    const entry* ptr = nullptr;
+
+public:
+
+    constexpr
+    interned_string()
+        noexcept = default;
+
+    interned_string(std::string_view s);
+
+    interned_string(const std::string& s);
+
+    interned_string(const char* s);
+
+    interned_string(const interned_string& other)
+        noexcept;
+
+    interned_string(interned_string&& other)
+        noexcept :
+        ptr{std::exchange(other.ptr, nullptr)}
+    {}
+
+
+    ~interned_string()
+        noexcept;
+
+
+    interned_string&
+    operator =(const interned_string& other)
+        noexcept;
+
+    interned_string&
+    operator =(interned_string&& other)
+        noexcept;
+
+
+    [[nodiscard]]
+    const std::string&
+    str()
+        const noexcept;
+
+    // Note: implicit, so it can be passed to functions that take a string.
+    operator const std::string&()
+        const noexcept
+    {
+        return str();
+    }
+
+
+    [[nodiscard]]
+    bool
+    empty()
+        const noexcept
+    {
+        return !ptr;
+    }
+
+    [[nodiscard]]
+    std::size_t
+    size()
+        const noexcept
+    {
+        return str().size();
+    }
+
+    [[nodiscard]]
+    const char*
+    data()
+        const noexcept
+    {
+        return str().data();
+    }
+
+    [[nodiscard]]
+    const char*
+    c_str()
+        const noexcept
+    {
+        return str().c_str();
+    }
+
+
+    [[nodiscard]]
+    friend
+    bool
+    operator ==(const interned_string& a,
+                const interned_string& b)
+        noexcept
+    {
+        return a.ptr == b.ptr;
+    }
+
+    [[nodiscard]]
+    friend
+    bool
+    operator ==(const interned_string& a,
+                std::string_view b)
+        noexcept
+    {
+        return a.str() == b;
+    }
+
+    [[nodiscard]]
+    friend
+    bool
+    operator ==(const interned_string& a,
+                const std::string& b)
+        noexcept
+    {
+        return a.str() == b;
+    }
+
+    [[nodiscard]]
+    friend
+    bool
+    operator ==(const interned_string& a,
+                const char* b)
+        noexcept
+    {
+        return a.str() == b;
+    }
+
+
+    // Note: ordered by contents, not by address, so sorting is stable across runs.
+    [[nodiscard]]
+    friend
+    std::strong_ordering
+    operator <=>(const interned_string& a,
+                 const interned_string& b)
+        noexcept
+    {
+        if (a.ptr == b.ptr)
+            return std::strong_ordering::equal;
+        return a.str() <=> b.str();
+    }
+
+
+    friend struct std::hash<interned_string>;
+
+}; // class interned_string
+
+
+template<>
+struct std::hash<interned_string> {
+    std::size_t
+    operator ()(const interned_string& s)
+        const noexcept
+    {
+        return std::hash<const void*>{}(s.ptr);
+    }
+};
+
+
+// Serialized as plain strings.
+
+template<>
+struct glz::from<glz::JSON, interned_string> {
+    template<auto Opts>
+    static
+    void
+    op(interned_string& value,
+       is_context auto&& ctx,
+       auto&& it,
+       auto&& end)
+    {
+        std::string s;
+        parse<JSON>::op<Opts>(s, ctx, it, end);
+        value = interned_string{s};
+    }
+};
+
+
+template<>
+struct glz::to<glz::JSON, interned_string> {
+    template<auto Opts>
+    static
+    void
+    op(const interned_string& value,
+       is_context auto&& ctx,
+       auto&& b,
+       auto&& ix)
+        noexcept
+    {
+        serialize<JSON>::op<Opts>(value.str(), ctx, b, ix);
+    }
+};
+
+
+template<>
+struct glz::from<glz::BEVE, interned_string> {
+    template<auto Opts>
+    static
+    void
+    op(interned_string& value,
+       is_context auto&& ctx,
+       auto&& it,
+       auto&& end)
+    {
+        std::string s;
+        parse<BEVE>::op<Opts>(s, ctx, it, end);
+        value = interned_string{s};
+    }
+};
+
+
+template<>
+struct glz::to<glz::BEVE, interned_string> {
+    template<auto Opts>
+    static
+    void
+    op(const interned_string& value,
+       is_context auto&& ctx,
+       auto&& b,
+       auto&& ix)
+        noexcept
+    {
+        serialize<BEVE>::op<Opts>(value.str(), ctx, b, ix);
+    }
+};
+
+#endif
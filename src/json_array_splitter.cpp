@@ -0,0 +1,204 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "json_array_splitter.hpp"
+
+
+namespace {
+
+    bool
+    is_space(char c)
+        noexcept
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+} // namespace
+
+
+std::optional<std::string_view>
+json_array_splitter::next(std::string_view json)
+    noexcept
+{
+    while (pos < json.size() && !closed) {
+        const char c = json[pos];
+
+        if (in_string) {
+            if (escaped)
+                escaped = false;
+            else if (c == '\\')
+                escaped = true;
+            else if (c == '"') {
+                in_string = false;
+                // A string element ends with its closing quote.
+                if (depth == 1) {
+                    in_element = false;
+                    ++pos;
+                    return json.substr(element_start, pos - element_start);
+                }
+            }
+            ++pos;
+            continue;
+        }
+
+        if (depth == 0) {
+            if (c == '[')
+                depth = 1;
+            ++pos;
+            continue;
+        }
+
+        if (depth == 1 && in_element) {
+            // A number, or a literal; it ends before the next separator.
+            if (c == ',' || c == ']' || is_space(c)) {
+                in_element = false;
+                return json.substr(element_start, pos - element_start);
+            }
+            ++pos;
+            continue;
+        }
+
+        if (depth == 1) {
+            if (c == ']')
+                closed = true;
+            else if (c != ',' && !is_space(c)) {
+                in_element = true;
+                element_start = pos;
+                if (c == '"')
+                    in_string = true;
+                else if (c == '{' || c == '[')
+                    depth = 2;
+            }
+            ++pos;
+            continue;
+        }
+
+        // Inside an object or array element.
+        if (c == '"')
+            in_string = true;
+        else if (c == '{' || c == '[')
+            ++depth;
+        else if (c == '}' || c == ']') {
+            ++pos;
+            if (--depth == 1) {
+                in_element = false;
+                return json.substr(element_start, pos - element_start);
+            }
+            continue;
+        }
+        ++pos;
+    }
+    return {};
+}
+
+
+bool
+json_array_splitter::is_closed()
+    const noexcept
+{
+    return closed;
+}
+
+
+void
+json_array_splitter::reset()
+    noexcept
+{
+    *this = {};
+}
+
+
+#ifdef UNIT_TEST
+
+// compilation: g++ -std=c++23 -DUNIT_TEST json_array_splitter.cpp
+
+#include <algorithm>            // min()
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "unit_test.hpp"
+
+using std::cout;
+using std::endl;
+
+using namespace std::literals;
+
+
+// Feeds the text in chunks of the given size, collecting the elements.
+std::vector<std::string>
+split(std::string_view text,
+      std::size_t chunk)
+{
+    json_array_splitter splitter;
+    std::vector<std::string> result;
+    for (std::size_t end = 0; end < text.size() + chunk; end += chunk) {
+        auto partial = text.substr(0, std::min(end, text.size()));
+        while (auto element = splitter.next(partial))
+            result.emplace_back(*element);
+    }
+    return result;
+}
+
+
+int main()
+{
+    int total = 0;
+    int successes = 0;
+
+    {
+        cout << "Test: objects" << endl;
+        auto text = R"( [ {"a": 1, "b": {"c": [1, 2]}} , {"d": "x"} ] )"sv;
+        for (std::size_t chunk : {1, 3, 7, 100}) {
+            auto elements = split(text, chunk);
+            CHECK_EQUAL(elements.size(), 2u);
+            CHECK_EQUAL(elements.at(0), R"({"a": 1, "b": {"c": [1, 2]}})"s);
+            CHECK_EQUAL(elements.at(1), R"({"d": "x"})"s);
+        }
+    }
+
+    {
+        cout << "Test: brackets and quotes inside strings" << endl;
+        auto text = R"([{"name": "x}]\"{["}, {"n": "\\"}])"sv;
+        for (std::size_t chunk : {1, 2, 100}) {
+            auto elements = split(text, chunk);
+            CHECK_EQUAL(elements.size(), 2u);
+            CHECK_EQUAL(elements.at(0), R"({"name": "x}]\"{["})"s);
+            CHECK_EQUAL(elements.at(1), R"({"n": "\\"})"s);
+        }
+    }
+
+    {
+        cout << "Test: scalars" << endl;
+        auto elements = split(R"([1, "two",true ,null,[3]])", 1);
+        CHECK_EQUAL(elements.size(), 5u);
+        CHECK_EQUAL(elements.at(0), "1"s);
+        CHECK_EQUAL(elements.at(1), "\"two\""s);
+        CHECK_EQUAL(elements.at(2), "true"s);
+        CHECK_EQUAL(elements.at(3), "null"s);
+        CHECK_EQUAL(elements.at(4), "[3]"s);
+    }
+
+    {
+        cout << "Test: incomplete and empty" << endl;
+        json_array_splitter splitter;
+        CHECK_EQUAL(splitter.next(R"([{"a": 1)").has_value(), false);
+        CHECK_EQUAL(splitter.next(R"([{"a": 1}, {)").value(), R"({"a": 1})"sv);
+        CHECK_EQUAL(splitter.next(R"([{"a": 1}, {)").has_value(), false);
+        CHECK_EQUAL(splitter.is_closed(), false);
+
+        splitter.reset();
+        CHECK_EQUAL(splitter.next("[ ]").has_value(), false);
+        CHECK_EQUAL(splitter.is_closed(), true);
+    }
+
+    cout << "Successes: " << successes << " / " << total << endl;
+    return successes < total ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif // UNIT_TEST
@@ -0,0 +1,57 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef JSON_ARRAY_SPLITTER_HPP
+#define JSON_ARRAY_SPLITTER_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+
+/*
+ * Finds the elements of a JSON array while it's still arriving, so each one can be parsed
+ * as soon as it's complete.
+ *
+ * next() is given all the text received so far; every call must see the same bytes as the
+ * previous one, possibly with more at the end. Only the new bytes are scanned. It doesn't
+ * validate anything, it only tracks strings and nesting, to find where each top-level
+ * element ends.
+ */
+class json_array_splitter {
+
+    std::size_t pos = 0;            // how much was scanned
+    std::size_t element_start = 0;
+    unsigned depth = 0;             // 1 is inside the array, between elements
+    bool in_element = false;
+    bool in_string = false;
+    bool escaped = false;
+    bool closed = false;
+
+public:
+
+    // Returns the next complete element, or nothing if it didn't arrive yet.
+    std::optional<std::string_view>
+    next(std::string_view json)
+        noexcept;
+
+
+    // True once the closing bracket was seen.
+    [[nodiscard]]
+    bool
+    is_closed()
+        const noexcept;
+
+
+    // Start over, for a different text.
+    void
+    reset()
+        noexcept;
+
+}; // class json_array_splitter
+
+#endif
@@ -0,0 +1,399 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Headless multi-stream load test, for the desktop build.
+ *
+ * Usage: radiiu-load-bench [--streams N] [--seconds S] [--name NAME] [--tag TAG]
+ *                          [--codec CODEC] [--server HOST]
+ *
+ * Searches radio-browser.info for stations, then plays the first N of them at the same
+ * time, each on its own thread, through radio_client, like the audio thread does; the
+ * decoded audio is thrown away. After S seconds, it prints one JSON object per stream
+ * (decoded throughput, CPU time, reconnections), and one for the whole process (memory).
+ *
+ * The results go to stdout; log messages go to stderr.
+ */
+
+#include <algorithm>            // max(), min()
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>               // fdopen(), fputs()
+#include <cstdlib>
+#include <ctime>                // clock_gettime()
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <SDL_audio.h>
+#include <sys/resource.h>       // getrusage()
+#include <unistd.h>             // dup(), dup2()
+
+#include "curl_share.hpp"
+#include "memory_accounting.hpp"
+#include "Profiler.hpp"
+#include "radio_client.hpp"
+#include "RadioBrowserAPI.hpp"
+#include "scheduler.hpp"
+
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+using namespace std::literals;
+
+
+/*
+ * Note: RadioBrowserAPI::process() has a PROFILE_SCOPE, but Profiler.cpp needs ImGui, so
+ * the sections are no-ops here.
+ */
+namespace Profiler {
+
+    struct Section {};
+
+
+    Section&
+    get_section(const char*)
+    {
+        static Section dummy;
+        return dummy;
+    }
+
+
+    Scope::Scope(Section& section)
+        noexcept :
+        section(section),
+        start{}
+    {}
+
+
+    Scope::~Scope()
+        noexcept
+    {}
+
+} // namespace Profiler
+
+
+namespace {
+
+    using clock = std::chrono::steady_clock;
+
+    const std::string user_agent = "radiiu-load-bench";
+
+    // Same as the audio thread.
+    const auto idle_delay = 5ms;
+
+
+    struct options {
+        unsigned streams = 4;
+        unsigned seconds = 60;
+        std::size_t block_size = 16 * 1024;
+        RadioBrowserAPI::SearchStationParams search;
+        std::string server;
+    };
+
+
+    struct stream_result {
+        std::string name;
+        std::string url;
+        std::string codec;
+        std::string bitrate;
+        std::uint64_t output_bytes = 0;
+        double audio_seconds = 0;
+        double wall_seconds = 0;
+        double cpu_ms = 0;        // the whole thread
+        double decode_cpu_ms = 0; // only inside get_samples()
+        unsigned reconnects = 0;
+        unsigned reconnect_failures = 0;
+        bool streaming = false;
+        std::string error;
+    };
+
+
+    double
+    thread_cpu_ms()
+        noexcept
+    {
+        timespec ts{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec * 1000.0 + ts.tv_nsec / 1'000'000.0;
+    }
+
+
+    void
+    play(const RadioBrowserAPI::Station& station,
+         const options& opts,
+         std::stop_token token,
+         stream_result& result)
+    {
+        const double cpu_start = thread_cpu_ms();
+        const auto start = clock::now();
+        try {
+            radio_client radio{station.url, station.url_resolved, user_agent};
+            std::vector<char> block(opts.block_size);
+            std::size_t frame_size = 0;
+            unsigned rate = 0;
+
+            while (!token.stop_requested()) {
+                radio.process();
+                if (radio.current_state == radio_client::state::stopped)
+                    break;
+
+                if (!frame_size)
+                    if (auto s = radio.get_spec()) {
+                        frame_size = SDL_AUDIO_BITSIZE(s->format) / 8 * s->channels;
+                        rate = s->rate;
+                    }
+
+                bool decoded = false;
+                for (;;) {
+                    const double t0 = thread_cpu_ms();
+                    const std::size_t size = radio.get_samples(block);
+                    result.decode_cpu_ms += thread_cpu_ms() - t0;
+                    if (!size)
+                        break;
+                    result.output_bytes += size;
+                    decoded = true;
+                }
+                if (!decoded)
+                    radio.wait(idle_delay);
+            }
+
+            if (frame_size && rate)
+                result.audio_seconds = static_cast<double>(result.output_bytes)
+                                     / frame_size / rate;
+            if (auto info = radio.get_decoder_info()) {
+                result.codec = info->codec;
+                result.bitrate = info->bitrate;
+            }
+            result.reconnects = radio.reconnects.count;
+            result.reconnect_failures = radio.reconnects.failures;
+            using state = radio_client::state;
+            result.streaming = radio.current_state == state::streaming_audio;
+        }
+        catch (std::exception& e) {
+            result.error = e.what();
+        }
+        result.wall_seconds = std::chrono::duration<double>(clock::now() - start).count();
+        result.cpu_ms = thread_cpu_ms() - cpu_start;
+    }
+
+
+    // Minimal JSON string escaping, for station names.
+    std::string
+    quote(std::string_view s)
+    {
+        std::string result = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            if (static_cast<unsigned char>(c) < 0x20)
+                result += ' ';
+            else
+                result += c;
+        }
+        result += '"';
+        return result;
+    }
+
+
+    std::string
+    to_json(const stream_result& r)
+    {
+        std::ostringstream out;
+        out << "{\"name\":" << quote(r.name)
+            << ",\"url\":" << quote(r.url)
+            << ",\"codec\":" << quote(r.codec)
+            << ",\"bitrate\":" << quote(r.bitrate)
+            << ",\"output_bytes\":" << r.output_bytes
+            << ",\"output_kbps\":" << (r.wall_seconds > 0
+                                       ? r.output_bytes * 8 / 1000.0 / r.wall_seconds
+                                       : 0)
+            << ",\"audio_seconds\":" << r.audio_seconds
+            << ",\"wall_seconds\":" << r.wall_seconds
+            << ",\"realtime_factor\":" << (r.wall_seconds > 0
+                                           ? r.audio_seconds / r.wall_seconds
+                                           : 0)
+            << ",\"cpu_ms\":" << r.cpu_ms
+            << ",\"decode_cpu_ms\":" << r.decode_cpu_ms
+            << ",\"reconnects\":" << r.reconnects
+            << ",\"reconnect_failures\":" << r.reconnect_failures
+            << ",\"streaming\":" << (r.streaming ? "true" : "false");
+        if (!r.error.empty())
+            out << ",\"error\":" << quote(r.error);
+        out << "}\n";
+        return out.str();
+    }
+
+
+    std::string
+    summary_json(unsigned streams,
+                 double wall_seconds)
+    {
+        using memory_accounting::tag;
+
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        auto to_ms = [](const timeval& tv)
+        {
+            return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+        };
+        const double cpu_ms = to_ms(usage.ru_utime) + to_ms(usage.ru_stime);
+
+        std::ostringstream out;
+        out << "{\"streams\":" << streams
+            << ",\"wall_seconds\":" << wall_seconds
+            << ",\"process_cpu_ms\":" << cpu_ms;
+        for (auto t : {tag::network, tag::streams, tag::timeshift}) {
+            const auto& acc = memory_accounting::get(t);
+            out << ",\"" << memory_accounting::to_string(t) << "_peak_bytes\":"
+                << acc.get_peak();
+        }
+        // Note: on Linux, ru_maxrss is in KiB.
+        out << ",\"max_rss_bytes\":" << usage.ru_maxrss * 1024L
+            << "}\n";
+        return out.str();
+    }
+
+
+    // Runs the main thread's share of the work until done() is true.
+    template<typename F>
+    void
+    pump_until(F done)
+    {
+        while (!done()) {
+            scheduler::run_main();
+            if (!RadioBrowserAPI::process())
+                std::this_thread::sleep_for(idle_delay);
+        }
+    }
+
+
+    std::optional<RadioBrowserAPI::StationVec>
+    find_stations(const options& opts)
+    {
+        std::optional<RadioBrowserAPI::StationVec> stations;
+        bool finished = false;
+        RadioBrowserAPI::search_stations(
+            opts.search,
+            [&](RadioBrowserAPI::StationVec result)
+            {
+                stations = std::move(result);
+                finished = true;
+            },
+            [&](const std::exception& e)
+            {
+                cout << "ERROR: search failed: " << e.what() << endl;
+                finished = true;
+            });
+        pump_until([&] { return finished; });
+        return stations;
+    }
+
+} // namespace
+
+
+int main(int argc, char* argv[])
+{
+    options opts;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--streams" && i + 1 < argc)
+            opts.streams = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--seconds" && i + 1 < argc)
+            opts.seconds = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--name" && i + 1 < argc)
+            opts.search.name = argv[++i];
+        else if (arg == "--tag" && i + 1 < argc)
+            opts.search.tag = argv[++i];
+        else if (arg == "--codec" && i + 1 < argc)
+            opts.search.codec = argv[++i];
+        else if (arg == "--server" && i + 1 < argc)
+            opts.server = argv[++i];
+        else {
+            cerr << "Usage: " << argv[0]
+                 << " [--streams N] [--seconds S] [--name NAME] [--tag TAG]"
+                 << " [--codec CODEC] [--server HOST]" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Note: the search should only return stations that are likely to work.
+    opts.search.hidebroken = true;
+    opts.search.order = RadioBrowserAPI::SearchStationParams::Order::clickcount;
+    opts.search.reverse = true;
+    opts.search.limit = opts.streams;
+
+    // Note: the log is written to stdout, so stdout is moved to stderr, and the results
+    // go to the original stdout.
+    std::FILE* results = fdopen(dup(STDOUT_FILENO), "w");
+    if (!results) {
+        cerr << "Could not duplicate stdout" << endl;
+        return EXIT_FAILURE;
+    }
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+
+    scheduler::initialize([] {});
+    curl_share::initialize();
+    RadioBrowserAPI::initialize(user_agent);
+    RadioBrowserAPI::set_server(opts.server);
+
+    int status = EXIT_SUCCESS;
+
+    auto stations = find_stations(opts);
+    if (!stations || stations->empty()) {
+        cout << "ERROR: no stations found" << endl;
+        status = EXIT_FAILURE;
+    } else {
+        const auto& list = *stations;
+        const std::size_t count = std::min<std::size_t>(list.size(), opts.streams);
+        std::vector<stream_result> stream_results(count);
+        const auto start = clock::now();
+        {
+            std::vector<std::jthread> players;
+            for (std::size_t i = 0; i < count; ++i) {
+                stream_results[i].name = list[i].name;
+                stream_results[i].url = list[i].url;
+                players.emplace_back(
+                    [&list, &opts, &stream_results, i](std::stop_token token)
+                    {
+                        play(list[i], opts, token, stream_results[i]);
+                    });
+            }
+
+            const auto deadline = start + std::chrono::seconds{opts.seconds};
+            pump_until([&] { return clock::now() >= deadline; });
+            // Note: the jthreads are stopped and joined here.
+        }
+        const double wall = std::chrono::duration<double>(clock::now() - start).count();
+
+        for (const auto& r : stream_results) {
+            std::fputs(to_json(r).c_str(), results);
+            if (!r.error.empty() || !r.output_bytes)
+                status = EXIT_FAILURE;
+        }
+        std::fputs(summary_json(count, wall).c_str(), results);
+    }
+
+    std::fclose(results);
+
+    RadioBrowserAPI::finalize();
+    scheduler::finalize();
+    curl_share::finalize();
+
+    return status;
+}
@@ -0,0 +1,232 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // min()
+#include <cstdio>               // fflush(), fwrite()
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "logging.hpp"
+
+#include "mpmc_queue.hpp"
+#include "thread_policy.hpp"
+#include "tracer.hpp"
+
+
+using namespace std::literals;
+
+
+#ifdef __WIIU__
+// Defined in stdout-wiiu.cpp; writes synchronously.
+void
+whb_log_write(const char* buf,
+              std::size_t len)
+    noexcept;
+#endif
+
+
+namespace logging {
+
+    namespace {
+
+        struct message {
+            std::array<char, 256> text;
+            std::uint16_t size = 0;
+        };
+
+
+        // About 64 KiB.
+        constexpr std::size_t ring_capacity = 256;
+
+        // The flusher polls, so producers never have to wake it up (that would lock).
+        const auto flush_interval = 20ms;
+
+
+        std::unique_ptr<mpmc_queue<message>> ring;
+        std::atomic<bool> running = false;
+        std::atomic<std::uint64_t> dropped = 0;
+        std::jthread flusher;
+
+
+        void
+        output(std::string_view text)
+            noexcept
+        {
+#ifdef __WIIU__
+            whb_log_write(text.data(), text.size());
+#else
+            std::fwrite(text.data(), 1, text.size(), stdout);
+#endif
+        }
+
+
+        void
+        flush_queued()
+        {
+            while (auto msg = ring->try_pop())
+                output({msg->text.data(), msg->size});
+#ifndef __WIIU__
+            std::fflush(stdout);
+#endif
+        }
+
+
+        void
+        flusher_func(std::stop_token token)
+        {
+            tracer::set_thread_name("log flusher");
+            thread_policy::apply(thread_policy::role::background);
+            while (!token.stop_requested()) {
+                flush_queued();
+                std::this_thread::sleep_for(flush_interval);
+            }
+        }
+
+
+        std::uint32_t
+        now_ms()
+            noexcept
+        {
+            using std::chrono::milliseconds;
+            const auto t = std::chrono::steady_clock::now().time_since_epoch();
+            return std::chrono::duration_cast<milliseconds>(t).count();
+        }
+
+    } // namespace
+
+
+    void
+    initialize()
+    {
+        ring = std::make_unique<mpmc_queue<message>>(ring_capacity);
+        flusher = std::jthread{flusher_func};
+        running = true;
+    }
+
+
+    void
+    finalize()
+    {
+        if (!running)
+            return;
+        running = false;
+        flusher.request_stop();
+        flusher.join();
+        flush_queued();
+        const auto lost = dropped.load();
+        if (lost) {
+            const auto msg = "logging: " + std::to_string(lost) + " messages were dropped\n";
+            output(msg);
+        }
+    }
+
+
+    void
+    write(std::string_view text)
+        noexcept
+    {
+        if (!running) {
+            output(text);
+            return;
+        }
+
+        message msg;
+        while (!text.empty()) {
+            msg.size = std::min(text.size(), msg.text.size());
+            text.copy(msg.text.data(), msg.size);
+            text.remove_prefix(msg.size);
+            if (!ring->try_push(msg))
+                ++dropped;
+        }
+    }
+
+
+    std::uint64_t
+    get_dropped()
+        noexcept
+    {
+        return dropped.load();
+    }
+
+
+    bool
+    rate_limit::allow()
+        noexcept
+    {
+        const std::uint32_t now = now_ms();
+        std::uint32_t prev = last.load(std::memory_order_relaxed);
+        // Note: the subtraction is modulo 2^32, so wrapping around is harmless.
+        if (used.load(std::memory_order_relaxed)
+            && now - prev < static_cast<std::uint32_t>(interval.count())) {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // Note: if another thread got here first, this message is the one suppressed.
+        if (!last.compare_exchange_strong(prev, now, std::memory_order_relaxed)
+            && used.load(std::memory_order_relaxed)) {
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        used.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+
+    unsigned
+    rate_limit::take_suppressed()
+        noexcept
+    {
+        return suppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+
+    line::fixed_buf::fixed_buf()
+        noexcept
+    {
+        // Note: leave room for the newline.
+        setp(storage.data(), storage.data() + storage.size() - 1);
+    }
+
+
+    std::string_view
+    line::fixed_buf::finish()
+        noexcept
+    {
+        // Note: there's always room for it, see the constructor.
+        *pptr() = '\n';
+        return {pbase(), pptr() + 1};
+    }
+
+
+    // Note: buf is constructed after the base, but std::ostream only stores the pointer.
+    line::line(level lvl,
+               rate_limit* limit) :
+        std::ostream{&buf}
+    {
+        switch (lvl) {
+            case level::warning:
+                *this << "WARNING: ";
+                break;
+            case level::error:
+                *this << "ERROR: ";
+                break;
+            default:
+                break;
+        }
+        if (limit)
+            if (unsigned n = limit->take_suppressed())
+                *this << "(" << n << " similar messages suppressed) ";
+    }
+
+
+    line::~line()
+    {
+        logging::write(buf.finish());
+    }
+
+} // namespace logging
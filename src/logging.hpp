@@ -0,0 +1,160 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef LOGGING_HPP
+#define LOGGING_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+#include <string_view>
+
+
+/*
+ * Asynchronous log sink.
+ *
+ * Messages go into a lock-free ring, and a background thread writes them out; when the
+ * ring is full, messages are dropped (and counted), never waited on. On the Wii U, stdout
+ * itself goes through the ring, so plain `cout << ... << endl` doesn't block either.
+ *
+ * Before initialize() and after finalize(), messages are written synchronously.
+ *
+ * For hot paths, the LOG() macros also filter by level at compile time (configure with
+ * CPPFLAGS=-DRADIIU_LOG_LEVEL=N, where 0 = debug ... 3 = error), and format into a fixed
+ * buffer, without allocating:
+ *
+ *     LOG(error) << "decode failed: " << code;
+ *     LOG_LIMITED(warning, 1s) << "Harmless (?) Opus error: " << msg;
+ *
+ * LOG_LIMITED() writes at most one message per interval from that line; the next message
+ * that gets through reports how many were suppressed.
+ */
+namespace logging {
+
+    enum class level : unsigned {
+        debug,
+        info,
+        warning,
+        error,
+    };
+
+
+#ifndef RADIIU_LOG_LEVEL
+#define RADIIU_LOG_LEVEL 1
+#endif
+
+    inline constexpr level compiled_level = static_cast<level>(RADIIU_LOG_LEVEL);
+
+
+    void
+    initialize();
+
+    // Writes out everything still queued.
+    void
+    finalize();
+
+
+    // Never blocks; long text is split into several messages.
+    void
+    write(std::string_view text)
+        noexcept;
+
+
+    // Messages lost because the ring was full.
+    [[nodiscard]]
+    std::uint64_t
+    get_dropped()
+        noexcept;
+
+
+    struct rate_limit {
+
+        const std::chrono::milliseconds interval;
+
+        constexpr
+        rate_limit(std::chrono::milliseconds interval)
+            noexcept :
+            interval{interval}
+        {}
+
+        // Returns false if the message should be suppressed.
+        bool
+        allow()
+            noexcept;
+
+        // How many were suppressed since the last allowed message.
+        unsigned
+        take_suppressed()
+            noexcept;
+
+    private:
+
+        // Note: 32-bit milliseconds, so the atomics are lock-free on the Wii U too.
+        std::atomic<std::uint32_t> last = 0;
+        std::atomic<bool> used = false;
+        std::atomic<unsigned> suppressed = 0;
+
+    }; // struct rate_limit
+
+
+    // One log message; it's queued on destruction. Longer messages are truncated.
+    class line : public std::ostream {
+
+        struct fixed_buf : std::streambuf {
+
+            std::array<char, 240> storage;
+
+            fixed_buf()
+                noexcept;
+
+            // Appends a newline, and returns the whole text.
+            [[nodiscard]]
+            std::string_view
+            finish()
+                noexcept;
+
+        }; // struct fixed_buf
+
+        fixed_buf buf;
+
+    public:
+
+        line(level lvl,
+             rate_limit* limit = nullptr);
+
+        ~line();
+
+    }; // class line
+
+} // namespace logging
+
+
+#define LOG_MERGE_IMPL(a, b) a##b
+#define LOG_MERGE(a, b) LOG_MERGE_IMPL(a, b)
+
+// Note: the switch makes each macro a single statement, so a following else can't bind
+// to the if inside it.
+
+#define LOG(lvl)                                                        \
+    switch (0) case 0: default:                                         \
+        if constexpr (logging::level::lvl < logging::compiled_level) {} \
+        else logging::line{logging::level::lvl}
+
+#define LOG_LIMITED_IMPL(lvl, interval, limit)                          \
+    switch (0) case 0: default:                                         \
+        if constexpr (logging::level::lvl < logging::compiled_level) {} \
+        else if (static logging::rate_limit limit{interval};            \
+                 !limit.allow()) {}                                     \
+        else logging::line{logging::level::lvl, &limit}
+
+#define LOG_LIMITED(lvl, interval)                                      \
+    LOG_LIMITED_IMPL(lvl, interval, LOG_MERGE(log_limit_, __COUNTER__))
+
+#endif
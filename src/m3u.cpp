@@ -6,7 +6,7 @@
  */
 
 #include <ostream>
-#include <ranges>
+#include <stdexcept>
 #include <utility>              // move()
 
 #include "m3u.hpp"
@@ -63,65 +63,125 @@ namespace m3u {
     }
 
 
-    playlist
-    parse(const std::string& input)
+    namespace {
+
+        // Protection against garbage, like a binary stream with the wrong mime type.
+        const std::size_t max_line_size = 8 * 1024;
+
+    } // namespace
+
+
+    void
+    parser::feed(std::string_view chunk)
+    {
+        while (!chunk.empty()) {
+            auto end = chunk.find_first_of("\r\n");
+            if (end == std::string_view::npos) {
+                partial_line.append(chunk);
+                if (partial_line.size() > max_line_size)
+                    throw std::runtime_error{"M3U line is too long"};
+                return;
+            }
+            // Note: only lines split across chunks are copied.
+            if (partial_line.empty())
+                process_line(chunk.substr(0, end));
+            else {
+                partial_line.append(chunk.substr(0, end));
+                process_line(partial_line);
+                partial_line.clear();
+            }
+            chunk.remove_prefix(end + 1);
+        }
+    }
+
+
+    void
+    parser::finish()
+    {
+        if (!partial_line.empty()) {
+            process_line(partial_line);
+            partial_line.clear();
+        }
+    }
+
+
+    const playlist&
+    parser::get_tracks()
+        const noexcept
     {
-        playlist result;
+        return tracks;
+    }
+
+
+    std::optional<std::string>
+    parser::first_url()
+        const
+    {
+        if (tracks.empty())
+            return {};
+        return tracks.front().url;
+    }
+
 
-        auto lines = string_utils::split(input, {"\r"s, "\n"s}, true);
-        if (lines.empty())
-            return result;
+    void
+    parser::process_line(std::string_view line)
+    {
+        if (line.empty())
+            return;
 
         // check if first line is #EXTM3U
-        if (lines.front() == ext_m3u) {
-            // handle extended playlist
-            std::optional<std::chrono::seconds> duration;
-            std::optional<std::string> title;
-            for (auto& line : lines | std::views::drop(1)) {
-                if (line.empty()) {
-                    duration.reset();
-                    title.reset();
-                    continue;
-                }
-                if (line[0] == '#') {
-                    // maybe ext directive, maybe comment
-                    if (line.starts_with(ext_inf)) {
-                        // #EXTINF:N,TITLE
-                        auto tokens = string_utils::split(line.substr(ext_inf.size()),
-                                                          ",", false, 2);
-                        if (tokens.size() != 2) {
-                            duration.reset();
-                            title.reset();
-                            continue;
-                        }
-                        long d = std::stol(tokens[0]);
-                        if (d != 0 && d != -1)
-                            duration = std::chrono::seconds(d);
-
-                        if (!tokens[1].empty())
-                            title = std::move(tokens[1]);
-                    } else {
-                        // non-standard directive, or comment, just skip it
-                        duration.reset();
-                        title.reset();
-                        continue;
-                    }
-                } else {
-                    result.emplace_back(std::move(line), duration, title);
+        if (!seen_first_line) {
+            seen_first_line = true;
+            if (line == ext_m3u) {
+                is_ext = true;
+                return;
+            }
+        }
+
+        if (!is_ext) {
+            // handle simple playlist, no comments allowed
+            tracks.emplace_back(std::string{line}, std::nullopt, std::nullopt);
+            return;
+        }
+
+        // handle extended playlist
+        if (line[0] == '#') {
+            // maybe ext directive, maybe comment
+            if (line.starts_with(ext_inf)) {
+                // #EXTINF:N,TITLE
+                auto tokens = string_utils::split(line.substr(ext_inf.size()),
+                                                  ","sv, false, 2);
+                if (tokens.size() != 2) {
                     duration.reset();
                     title.reset();
+                    return;
                 }
-            } // for (line : lines)
-        } else {
-            // handle simple playlist, no comments allowed
-            for (auto& line : lines) {
-                if (line.empty())
-                    continue;
-                result.emplace_back(std::move(line), std::nullopt, std::nullopt);
+                long d = std::stol(std::string{tokens[0]});
+                if (d != 0 && d != -1)
+                    duration = std::chrono::seconds(d);
+
+                if (!tokens[1].empty())
+                    title = std::string{tokens[1]};
+            } else {
+                // non-standard directive, or comment, just skip it
+                duration.reset();
+                title.reset();
             }
+        } else {
+            tracks.emplace_back(std::string{line}, duration, title);
+            duration.reset();
+            title.reset();
         }
+    }
+
 
-        return result;
+    playlist
+    parse(const std::string& input)
+    {
+        parser p;
+        p.feed(input);
+        p.finish();
+        return p.get_tracks();
     }
 
 } // namespace m3u
@@ -211,6 +271,28 @@ int main()
         dump(pl);
     }
 
+    {
+        cout << "Test: extended, fed one byte at a time" << endl;
+        auto input = "#EXTM3U"s + crlf
+            + "#EXTINF:-1,First"s + crlf
+            + "http://example.com/1"s + crlf
+            + "http://example.com/2"s;
+        m3u::parser p;
+        for (std::size_t i = 0; i < input.size(); ++i) {
+            p.feed(std::string_view{input}.substr(i, 1));
+            // The first URL must show up as soon as its line ends.
+            if (i + 1 == input.find("http://example.com/2"))
+                CHECK_EQUAL(p.first_url().value_or(""), "http://example.com/1"s);
+        }
+        CHECK_EQUAL(p.get_tracks().size(), 1);
+        p.finish();
+        auto& pl = p.get_tracks();
+        CHECK_EQUAL(pl.size(), 2);
+        CHECK_EQUAL(*pl.at(0).title, "First"s);
+        CHECK_EQUAL(pl.at(1).url, "http://example.com/2"s);
+        dump(pl);
+    }
+
     cout << "Successes: " << successes << " / " << total << endl;
 }
 
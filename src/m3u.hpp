@@ -12,6 +12,7 @@
 #include <iosfwd>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 
@@ -38,6 +39,44 @@ namespace m3u {
                 const playlist& pl);
 
 
+    /*
+     * Incremental parser: the input can be fed in chunks, as it arrives, and the tracks
+     * are available as soon as their line is complete.
+     */
+    class parser {
+
+        std::string partial_line;
+        bool seen_first_line = false;
+        bool is_ext = false;
+        std::optional<std::chrono::seconds> duration;
+        std::optional<std::string> title;
+        playlist tracks;
+
+        void
+        process_line(std::string_view line);
+
+    public:
+
+        void
+        feed(std::string_view chunk);
+
+        // End of input; the last line doesn't need a line break.
+        void
+        finish();
+
+        [[nodiscard]]
+        const playlist&
+        get_tracks()
+            const noexcept;
+
+        [[nodiscard]]
+        std::optional<std::string>
+        first_url()
+            const;
+
+    }; // class parser
+
+
     playlist
     parse(const std::string& input);
 
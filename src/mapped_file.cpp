@@ -0,0 +1,155 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <cstring>              // memcpy(), strerror()
+#include <stdexcept>
+#include <string>
+
+#if !defined(__WIIU__) && !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>              // open()
+#include <sys/mman.h>
+#include <sys/stat.h>           // fstat()
+#include <unistd.h>             // close()
+#endif
+
+#include "mapped_file.hpp"
+
+
+#if defined(__WIIU__) || defined(_WIN32)
+
+
+mapped_file::mapped_file(const std::filesystem::path& filename) :
+    filename{filename},
+    input{filename, std::ios::binary | std::ios::ate}
+{
+    if (!input)
+        throw std::runtime_error{"could not open " + filename.string()};
+    file_size = input.tellg();
+}
+
+
+mapped_file::~mapped_file()
+    noexcept = default;
+
+
+std::span<const std::uint32_t>
+mapped_file::load_prefix(std::size_t count)
+{
+    if (count * sizeof(std::uint32_t) > file_size)
+        throw std::runtime_error{filename.string() + " is truncated"};
+    if (count > prefix.size()) {
+        prefix.resize(count);
+        prefix.shrink_to_fit();
+        read(0, {reinterpret_cast<char*>(prefix.data()), count * sizeof(std::uint32_t)});
+    }
+    return std::span{prefix}.first(count);
+}
+
+
+void
+mapped_file::read(std::size_t offset,
+                  std::span<char> out)
+    const
+{
+    if (offset > file_size || out.size() > file_size - offset)
+        throw std::runtime_error{"reading past the end of " + filename.string()};
+    std::lock_guard guard{input_mutex};
+    input.clear();
+    input.seekg(offset);
+    if (!input.read(out.data(), out.size()))
+        throw std::runtime_error{"could not read " + filename.string()};
+}
+
+
+std::size_t
+mapped_file::memory_size()
+    const noexcept
+{
+    return prefix.capacity() * sizeof(std::uint32_t);
+}
+
+
+#else
+
+
+mapped_file::mapped_file(const std::filesystem::path& filename) :
+    filename{filename}
+{
+    const int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error{"could not open " + filename.string()
+                                 + ": " + std::strerror(errno)};
+    struct stat st{};
+    if (fstat(fd, &st) < 0) {
+        const int e = errno;
+        close(fd);
+        throw std::runtime_error{"could not stat " + filename.string()
+                                 + ": " + std::strerror(e)};
+    }
+    file_size = st.st_size;
+    if (file_size) {
+        void* addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            const int e = errno;
+            close(fd);
+            throw std::runtime_error{"could not map " + filename.string()
+                                     + ": " + std::strerror(e)};
+        }
+        mapping = addr;
+    }
+    // Note: the mapping stays valid after the file is closed, or replaced.
+    close(fd);
+}
+
+
+mapped_file::~mapped_file()
+    noexcept
+{
+    if (mapping)
+        munmap(const_cast<void*>(mapping), file_size);
+}
+
+
+std::span<const std::uint32_t>
+mapped_file::load_prefix(std::size_t count)
+{
+    if (count * sizeof(std::uint32_t) > file_size)
+        throw std::runtime_error{filename.string() + " is truncated"};
+    return {static_cast<const std::uint32_t*>(mapping), count};
+}
+
+
+void
+mapped_file::read(std::size_t offset,
+                  std::span<char> out)
+    const
+{
+    if (offset > file_size || out.size() > file_size - offset)
+        throw std::runtime_error{"reading past the end of " + filename.string()};
+    if (!out.empty())
+        std::memcpy(out.data(), static_cast<const char*>(mapping) + offset, out.size());
+}
+
+
+std::size_t
+mapped_file::memory_size()
+    const noexcept
+{
+    return 0;
+}
+
+
+#endif
+
+
+std::size_t
+mapped_file::size()
+    const noexcept
+{
+    return file_size;
+}
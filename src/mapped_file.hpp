@@ -0,0 +1,85 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <vector>
+
+
+/*
+ * A read-only view of a file, for data that's too big to keep in memory.
+ *
+ * On desktop, the file is memory-mapped, so only the pages that are actually used become
+ * resident, and the OS can drop them again. Where there's no mmap() (the Wii U), only
+ * the prefix passed to load_prefix() is kept in memory; read() fetches the rest from the
+ * file, as needed.
+ */
+class mapped_file {
+
+public:
+
+    // Throws std::runtime_error if the file can't be opened.
+    explicit
+    mapped_file(const std::filesystem::path& filename);
+
+    mapped_file(const mapped_file&) = delete;
+
+    ~mapped_file()
+        noexcept;
+
+
+    [[nodiscard]]
+    std::size_t
+    size()
+        const noexcept;
+
+
+    /*
+     * Make the first count words of the file directly accessible; the span is valid until
+     * the next call. Throws std::runtime_error if the file is shorter.
+     */
+    std::span<const std::uint32_t>
+    load_prefix(std::size_t count);
+
+
+    // Copy bytes from anywhere in the file; safe from any thread.
+    void
+    read(std::size_t offset,
+         std::span<char> out)
+        const;
+
+
+    // The memory held by this object; mapped pages are not counted.
+    [[nodiscard]]
+    std::size_t
+    memory_size()
+        const noexcept;
+
+
+private:
+
+    std::filesystem::path filename;
+    std::size_t file_size = 0;
+
+#if defined(__WIIU__) || defined(_WIN32)
+    std::vector<std::uint32_t> prefix;
+    mutable std::mutex input_mutex;
+    mutable std::ifstream input;
+#else
+    const void* mapping = nullptr;
+#endif
+
+}; // class mapped_file
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <array>
+#include <utility>              // to_underlying()
+
+#include "memory_accounting.hpp"
+
+
+namespace memory_accounting {
+
+    namespace {
+
+        std::array<account, num_tags> accounts;
+
+
+        void
+        update_peak(std::atomic<std::size_t>& peak,
+                    std::size_t value)
+            noexcept
+        {
+            std::size_t old = peak.load(std::memory_order_relaxed);
+            while (value > old)
+                if (peak.compare_exchange_weak(old, value, std::memory_order_relaxed))
+                    break;
+        }
+
+    } // namespace
+
+
+    void
+    account::add(std::size_t bytes)
+        noexcept
+    {
+        const std::size_t now = live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        update_peak(peak, now);
+    }
+
+
+    void
+    account::sub(std::size_t bytes)
+        noexcept
+    {
+        live.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+
+    void
+    account::set(std::size_t bytes)
+        noexcept
+    {
+        live.store(bytes, std::memory_order_relaxed);
+        update_peak(peak, bytes);
+    }
+
+
+    std::size_t
+    account::get_live()
+        const noexcept
+    {
+        return live.load(std::memory_order_relaxed);
+    }
+
+
+    std::size_t
+    account::get_peak()
+        const noexcept
+    {
+        return peak.load(std::memory_order_relaxed);
+    }
+
+
+    account&
+    get(tag t)
+        noexcept
+    {
+        return accounts[std::to_underlying(t)];
+    }
+
+
+    const char*
+    to_string(tag t)
+        noexcept
+    {
+        switch (t) {
+            case tag::network:
+                return "network";
+            case tag::streams:
+                return "streams";
+            case tag::icon_surfaces:
+                return "icon_surfaces";
+            case tag::icon_textures:
+                return "icon_textures";
+            case tag::fonts:
+                return "fonts";
+            case tag::stations:
+                return "stations";
+            case tag::station_index:
+                return "station_index";
+            case tag::timeshift:
+                return "timeshift";
+        }
+        return "?";
+    }
+
+} // namespace memory_accounting
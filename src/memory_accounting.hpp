@@ -0,0 +1,152 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MEMORY_ACCOUNTING_HPP
+#define MEMORY_ACCOUNTING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+
+/*
+ * Live and peak bytes used by each of the big memory consumers.
+ *
+ * Containers account themselves by using memory_accounting::allocator, that charges every
+ * allocation to a tag:
+ *
+ *     std::vector<std::byte, memory_accounting::allocator<std::byte>>
+ *         buf{memory_accounting::tag::network};
+ *
+ * Memory that isn't allocated through a container (SDL surfaces and textures, the font
+ * atlas) is reported with add() and sub(), or set().
+ *
+ * Updates are lock-free and safe from any thread.
+ */
+namespace memory_accounting {
+
+    enum class tag : unsigned {
+        network,       // http_client buffers
+        streams,       // other byte_streams: ICY, containers, decoders
+        icon_surfaces,
+        icon_textures,
+        fonts,         // font files and atlas pages
+        stations,      // station lists from radio-browser.info
+        station_index,
+        timeshift,     // compressed audio kept for pausing and rewinding
+    };
+
+    inline constexpr std::size_t num_tags = 8;
+
+
+    struct account {
+
+        void
+        add(std::size_t bytes)
+            noexcept;
+
+        void
+        sub(std::size_t bytes)
+            noexcept;
+
+        void
+        set(std::size_t bytes)
+            noexcept;
+
+        [[nodiscard]]
+        std::size_t
+        get_live()
+            const noexcept;
+
+        [[nodiscard]]
+        std::size_t
+        get_peak()
+            const noexcept;
+
+    private:
+
+        // Note: size_t is 32 bits on the Wii U, so these are lock-free there too.
+        std::atomic<std::size_t> live = 0;
+        std::atomic<std::size_t> peak = 0;
+
+    }; // struct account
+
+
+    [[nodiscard]]
+    account&
+    get(tag t)
+        noexcept;
+
+
+    [[nodiscard]]
+    const char*
+    to_string(tag t)
+        noexcept;
+
+
+    template<typename T>
+    struct allocator {
+
+        using value_type = T;
+
+        // Note: the memory is always returned to the account it came from.
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap            = std::true_type;
+        using is_always_equal                        = std::false_type;
+
+        tag which;
+
+        constexpr
+        allocator(tag which)
+            noexcept :
+            which{which}
+        {}
+
+        template<typename U>
+        constexpr
+        allocator(const allocator<U>& other)
+            noexcept :
+            which{other.which}
+        {}
+
+
+        [[nodiscard]]
+        T*
+        allocate(std::size_t n)
+        {
+            T* result = std::allocator<T>{}.allocate(n);
+            get(which).add(n * sizeof(T));
+            return result;
+        }
+
+
+        void
+        deallocate(T* p,
+                   std::size_t n)
+            noexcept
+        {
+            get(which).sub(n * sizeof(T));
+            std::allocator<T>{}.deallocate(p, n);
+        }
+
+
+        template<typename U>
+        constexpr
+        bool
+        operator ==(const allocator<U>& other)
+            const noexcept
+        {
+            return which == other.which;
+        }
+
+    }; // struct allocator
+
+} // namespace memory_accounting
+
+#endif
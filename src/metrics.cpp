@@ -0,0 +1,228 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // is_sorted(), lower_bound(), min(), sort()
+#include <cstdio>               // snprintf()
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+#include "metrics.hpp"
+
+
+using std::cout;
+using std::endl;
+
+
+namespace metrics {
+
+    namespace {
+
+        std::mutex registry_mutex;
+
+        // Note: std::deque never moves its elements, the references stay valid.
+        std::deque<counter> counters;
+        std::deque<gauge> gauges;
+        std::deque<histogram> histograms;
+
+
+        template<typename T>
+        T*
+        find(std::deque<T>& metrics,
+             const std::string& name)
+        {
+            for (auto& m : metrics)
+                if (m.name == name)
+                    return &m;
+            return nullptr;
+        }
+
+
+        void
+        update_max(std::atomic<float>& max,
+                   float value)
+            noexcept
+        {
+            float old = max.load(std::memory_order_relaxed);
+            while (value > old)
+                if (max.compare_exchange_weak(old, value, std::memory_order_relaxed))
+                    break;
+        }
+
+    } // namespace
+
+
+    counter::counter(const std::string& name) :
+        name{name}
+    {}
+
+
+    std::uint64_t
+    counter::get()
+        const noexcept
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+
+
+    gauge::gauge(const std::string& name) :
+        name{name}
+    {}
+
+
+    std::int64_t
+    gauge::get()
+        const noexcept
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+
+
+    double
+    histogram::snapshot::mean()
+        const noexcept
+    {
+        return total ? sum / total : 0;
+    }
+
+
+    double
+    histogram::snapshot::percentile(double p)
+        const noexcept
+    {
+        if (!total)
+            return 0;
+        const auto rank = static_cast<std::uint64_t>(p * (total - 1)) + 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < bounds.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank)
+                return std::min(bounds[i], max);
+        }
+        return max;
+    }
+
+
+    histogram::histogram(const std::string& name,
+                         std::span<const double> bounds) :
+        name{name},
+        bounds(bounds.begin(), bounds.end()),
+        counts{std::make_unique<std::atomic<std::uint32_t>[]>(bounds.size() + 1)}
+    {
+        if (!std::ranges::is_sorted(this->bounds))
+            throw std::invalid_argument{"histogram bounds must be sorted: " + name};
+    }
+
+
+    void
+    histogram::record(double value)
+        noexcept
+    {
+        const auto idx = std::ranges::lower_bound(bounds, value) - bounds.begin();
+        counts[idx].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(static_cast<float>(value), std::memory_order_relaxed);
+        update_max(max, static_cast<float>(value));
+    }
+
+
+    histogram::snapshot
+    histogram::get()
+        const
+    {
+        snapshot result;
+        result.bounds = bounds;
+        result.counts.resize(bounds.size() + 1);
+        // Note: the counts are read one by one; recompute the total from them, so the
+        // percentiles are consistent.
+        for (std::size_t i = 0; i < result.counts.size(); ++i) {
+            result.counts[i] = counts[i].load(std::memory_order_relaxed);
+            result.total += result.counts[i];
+        }
+        result.sum = sum.load(std::memory_order_relaxed);
+        result.max = max.load(std::memory_order_relaxed);
+        return result;
+    }
+
+
+    counter&
+    get_counter(const std::string& name)
+    {
+        std::lock_guard guard{registry_mutex};
+        if (auto c = find(counters, name))
+            return *c;
+        return counters.emplace_back(name);
+    }
+
+
+    gauge&
+    get_gauge(const std::string& name)
+    {
+        std::lock_guard guard{registry_mutex};
+        if (auto g = find(gauges, name))
+            return *g;
+        return gauges.emplace_back(name);
+    }
+
+
+    histogram&
+    get_histogram(const std::string& name,
+                  std::span<const double> bounds)
+    {
+        std::lock_guard guard{registry_mutex};
+        if (auto h = find(histograms, name))
+            return *h;
+        return histograms.emplace_back(name, bounds);
+    }
+
+
+    snapshot
+    take_snapshot()
+    {
+        snapshot result;
+        {
+            std::lock_guard guard{registry_mutex};
+            for (auto& c : counters)
+                result.counters.emplace_back(c.name, c.get());
+            for (auto& g : gauges)
+                result.gauges.emplace_back(g.name, g.get());
+            for (auto& h : histograms)
+                result.histograms.emplace_back(h.name, h.get());
+        }
+        auto by_name = [](const auto& a, const auto& b) { return a.first < b.first; };
+        std::ranges::sort(result.counters, by_name);
+        std::ranges::sort(result.gauges, by_name);
+        std::ranges::sort(result.histograms, by_name);
+        return result;
+    }
+
+
+    void
+    dump()
+    {
+        const auto snap = take_snapshot();
+        cout << "Metrics:" << endl;
+        for (auto& [name, value] : snap.counters)
+            cout << "  " << name << " = " << value << endl;
+        for (auto& [name, value] : snap.gauges)
+            cout << "  " << name << " = " << value << endl;
+        for (auto& [name, h] : snap.histograms) {
+            char buf[160];
+            std::snprintf(buf, sizeof buf,
+                          "n=%llu mean=%.1f p50=%.1f p90=%.1f p99=%.1f max=%.1f",
+                          static_cast<unsigned long long>(h.total),
+                          h.mean(),
+                          h.percentile(0.50),
+                          h.percentile(0.90),
+                          h.percentile(0.99),
+                          h.max);
+            cout << "  " << name << ": " << buf << endl;
+        }
+    }
+
+} // namespace metrics
@@ -0,0 +1,202 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/*
+ * Registry of runtime counters, gauges and histograms.
+ *
+ * Metrics are created on first use, and live until the program ends, so the references
+ * can be cached in static variables:
+ *
+ *     static auto& received = metrics::get_counter("stream/bytes_received");
+ *     received.add(size);
+ *
+ * Updating a metric is lock-free, and safe from any thread (including the audio
+ * callback); only creating one, and taking a snapshot, lock the registry.
+ *
+ * Note: the Wii U is 32-bit, and its 64-bit atomics take a lock; so the values are kept in
+ * 32 bits. Counters wrap around after 2^32.
+ */
+namespace metrics {
+
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+    static_assert(std::atomic<std::int32_t>::is_always_lock_free);
+    static_assert(std::atomic<float>::is_always_lock_free);
+
+    struct counter {
+
+        const std::string name;
+
+        explicit
+        counter(const std::string& name);
+
+        void
+        add(std::uint32_t n = 1)
+            noexcept
+        {
+            value.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]]
+        std::uint64_t
+        get()
+            const noexcept;
+
+    private:
+
+        std::atomic<std::uint32_t> value = 0;
+
+    }; // struct counter
+
+
+    struct gauge {
+
+        const std::string name;
+
+        explicit
+        gauge(const std::string& name);
+
+        void
+        set(std::int32_t v)
+            noexcept
+        {
+            value.store(v, std::memory_order_relaxed);
+        }
+
+        void
+        add(std::int32_t delta)
+            noexcept
+        {
+            value.fetch_add(delta, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]]
+        std::int64_t
+        get()
+            const noexcept;
+
+    private:
+
+        std::atomic<std::int32_t> value = 0;
+
+    }; // struct gauge
+
+
+    /*
+     * Fixed buckets: bucket i counts the values <= bounds[i]; one extra bucket counts the
+     * values above the last bound.
+     */
+    struct histogram {
+
+        struct snapshot {
+
+            std::vector<double> bounds;
+            std::vector<std::uint64_t> counts;
+            std::uint64_t total = 0;
+            double sum = 0;
+            double max = 0;
+
+            [[nodiscard]]
+            double
+            mean()
+                const noexcept;
+
+            // The upper bound of the bucket where the percentile falls; max for the
+            // last bucket.
+            [[nodiscard]]
+            double
+            percentile(double p)
+                const noexcept;
+
+        }; // struct snapshot
+
+
+        const std::string name;
+        const std::vector<double> bounds;
+
+        histogram(const std::string& name,
+                  std::span<const double> bounds);
+
+        void
+        record(double value)
+            noexcept;
+
+        [[nodiscard]]
+        snapshot
+        get()
+            const;
+
+    private:
+
+        std::unique_ptr<std::atomic<std::uint32_t>[]> counts;
+        std::atomic<std::uint32_t> total = 0;
+        std::atomic<float> sum = 0;
+        std::atomic<float> max = 0;
+
+    }; // struct histogram
+
+
+    [[nodiscard]]
+    counter&
+    get_counter(const std::string& name);
+
+    [[nodiscard]]
+    gauge&
+    get_gauge(const std::string& name);
+
+    // Note: the bounds are only used the first time the histogram is requested.
+    [[nodiscard]]
+    histogram&
+    get_histogram(const std::string& name,
+                  std::span<const double> bounds);
+
+
+    // Bucket bounds for network latencies, in milliseconds.
+    inline constexpr std::array latency_ms_buckets{
+        10.0, 25.0, 50.0, 100.0, 250.0, 500.0, 1000.0, 2500.0, 5000.0, 10000.0
+    };
+
+    // Bucket bounds for short CPU tasks, in microseconds.
+    inline constexpr std::array cpu_us_buckets{
+        50.0, 100.0, 250.0, 500.0, 1000.0, 2500.0, 5000.0, 10000.0, 25000.0
+    };
+
+
+    struct snapshot {
+
+        std::vector<std::pair<std::string, std::uint64_t>> counters;
+        std::vector<std::pair<std::string, std::int64_t>> gauges;
+        std::vector<std::pair<std::string, histogram::snapshot>> histograms;
+
+    }; // struct snapshot
+
+
+    // All metrics, sorted by name.
+    [[nodiscard]]
+    snapshot
+    take_snapshot();
+
+
+    // Write all metrics to the log.
+    void
+    dump();
+
+} // namespace metrics
+
+#endif
@@ -8,23 +8,213 @@
 #ifndef MIME_TYPE_HPP
 #define MIME_TYPE_HPP
 
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 
 namespace mime_type {
 
+    namespace detail {
+
+        constexpr
+        char
+        to_lower(char c)
+            noexcept
+        {
+            return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+        }
+
+
+        constexpr
+        std::string_view
+        trimmed(std::string_view s)
+            noexcept
+        {
+            while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+                s.remove_prefix(1);
+            while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+                s.remove_suffix(1);
+            return s;
+        }
+
+
+        // Case-insensitive; '*' matches any sequence of characters.
+        constexpr
+        bool
+        glob_match(std::string_view input,
+                   std::string_view glob)
+            noexcept
+        {
+            while (!glob.empty()) {
+                if (glob.front() == '*') {
+                    glob.remove_prefix(1);
+                    if (glob.empty())
+                        return true;
+                    for (std::size_t i = 0; i <= input.size(); ++i)
+                        if (glob_match(input.substr(i), glob))
+                            return true;
+                    return false;
+                }
+                if (input.empty() || to_lower(input.front()) != to_lower(glob.front()))
+                    return false;
+                input.remove_prefix(1);
+                glob.remove_prefix(1);
+            }
+            return input.empty();
+        }
+
+    } // namespace detail
+
+
     /*
-     * input: must have no wildcards, no parameters
-     * candidate: can have wildcards
+     * A content type split into type and subtype, with the parameters dropped.
+     *
+     * Both parts are views into the parsed string, so parsing doesn't allocate.
      */
+    struct view {
+
+        std::string_view type;
+        std::string_view subtype;
+
+
+        // Returns nothing if the input is not "type/subtype[;parameters]".
+        [[nodiscard]]
+        static constexpr
+        std::optional<view>
+        parse(std::string_view input)
+            noexcept
+        {
+            input = detail::trimmed(input.substr(0, input.find(';')));
+            auto slash = input.find('/');
+            if (slash == std::string_view::npos)
+                return {};
+            view result{detail::trimmed(input.substr(0, slash)),
+                        detail::trimmed(input.substr(slash + 1))};
+            if (result.type.empty() || result.subtype.empty())
+                return {};
+            return result;
+        }
+
+    }; // struct view
+
+
+    // A pattern like "audio/mpeg", "audio/*" or "application/*mpegurl".
+    //
+    // Declare patterns constexpr, so they're validated at compile time.
+    struct pattern {
+
+        std::string_view type;
+        std::string_view subtype;
+
+
+        // Throws std::invalid_argument; in a constant expression that's a compilation error.
+        constexpr
+        pattern(std::string_view str)
+        {
+            auto v = view::parse(str);
+            if (!v)
+                throw std::invalid_argument{"invalid mime-type pattern"};
+            type = v->type;
+            subtype = v->subtype;
+        }
+
+        constexpr
+        pattern(const char* str) :
+            pattern{std::string_view{str}}
+        {}
 
+
+        [[nodiscard]]
+        constexpr
+        bool
+        matches(const view& v)
+            const noexcept
+        {
+            return detail::glob_match(v.type, type)
+                && detail::glob_match(v.subtype, subtype);
+        }
+
+        [[nodiscard]]
+        constexpr
+        bool
+        matches(std::string_view content_type)
+            const noexcept
+        {
+            auto v = view::parse(content_type);
+            return v && matches(*v);
+        }
+
+    }; // struct pattern
+
+
+    template<typename T>
+    struct rule {
+        pattern pat;
+        T value;
+    };
+
+
+    // Maps content types to values, like handler enums; the first matching rule wins.
+    //
+    // Example:
+    //
+    //     constexpr mime_type::table kinds{
+    //         mime_type::rule{ "audio/x-scpls", kind::pls   },
+    //         mime_type::rule{ "audio/*",       kind::audio },
+    //     };
+    template<typename T,
+             std::size_t N>
+    struct table {
+
+        std::array<rule<T>, N> rules;
+
+
+        [[nodiscard]]
+        constexpr
+        std::optional<T>
+        lookup(const view& v)
+            const noexcept
+        {
+            for (auto& r : rules)
+                if (r.pat.matches(v))
+                    return r.value;
+            return {};
+        }
+
+        [[nodiscard]]
+        constexpr
+        std::optional<T>
+        lookup(std::string_view content_type)
+            const noexcept
+        {
+            auto v = view::parse(content_type);
+            if (!v)
+                return {};
+            return lookup(*v);
+        }
+
+    }; // struct table
+
+    template<typename T,
+             typename... R>
+    table(rule<T>, R...) -> table<T, 1 + sizeof...(R)>;
+
+
+    /*
+     * input: must have no wildcards, may have parameters
+     * candidate: can have wildcards
+     */
     bool
     match(const std::string& input,
           const std::string& candidate);
 
     /*
-     * input: must have no wildcards, no parameters
+     * input: must have no wildcards, may have parameters
      * candidate: can have wildcards
      */
     bool
@@ -0,0 +1,192 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // min()
+
+#include "mpeg_ts.hpp"
+
+
+namespace mpeg_ts {
+
+    namespace {
+
+        const std::uint8_t sync_byte = 0x47;
+
+        const std::uint16_t pat_pid = 0x0000;
+
+        // From ISO/IEC 13818-1, table 2-34.
+        const std::uint8_t stream_type_mpeg1_audio = 0x03;
+        const std::uint8_t stream_type_mpeg2_audio = 0x04;
+        const std::uint8_t stream_type_adts_aac    = 0x0f;
+
+
+        bool
+        is_audio(std::uint8_t stream_type)
+            noexcept
+        {
+            return stream_type == stream_type_mpeg1_audio
+                || stream_type == stream_type_mpeg2_audio
+                || stream_type == stream_type_adts_aac;
+        }
+
+
+        std::uint16_t
+        read_u16(const std::uint8_t* p)
+            noexcept
+        {
+            return static_cast<std::uint16_t>((p[0] << 8) | p[1]);
+        }
+
+    } // namespace
+
+
+    bool
+    probe(std::span<const char> data)
+        noexcept
+    {
+        if (data.size() < 2 * packet_size)
+            return !data.empty() && static_cast<std::uint8_t>(data[0]) == sync_byte;
+        return static_cast<std::uint8_t>(data[0]) == sync_byte
+            && static_cast<std::uint8_t>(data[packet_size]) == sync_byte;
+    }
+
+
+    void
+    demuxer::feed(std::span<const char> data,
+                  byte_stream& out)
+    {
+        if (!partial.empty()) {
+            std::size_t needed = packet_size - partial.size();
+            std::size_t n = std::min(needed, data.size());
+            partial.append(data.data(), n);
+            data = data.subspan(n);
+            if (partial.size() < packet_size)
+                return;
+            process_packet(reinterpret_cast<const std::uint8_t*>(partial.data()), out);
+            partial.clear();
+        }
+
+        while (data.size() >= packet_size) {
+            auto pkt = reinterpret_cast<const std::uint8_t*>(data.data());
+            if (pkt[0] != sync_byte) {
+                // Lost sync, look for the next packet.
+                data = data.subspan(1);
+                continue;
+            }
+            process_packet(pkt, out);
+            data = data.subspan(packet_size);
+        }
+
+        partial.assign(data.data(), data.size());
+    }
+
+
+    std::optional<std::string>
+    demuxer::get_content_type()
+        const
+    {
+        if (!audio_pid)
+            return {};
+        if (audio_stream_type == stream_type_adts_aac)
+            return "audio/aac";
+        return "audio/mpeg";
+    }
+
+
+    void
+    demuxer::process_packet(const std::uint8_t* pkt,
+                            byte_stream& out)
+    {
+        const bool unit_start = pkt[1] & 0x40;
+        const std::uint16_t pid = read_u16(pkt + 1) & 0x1fff;
+        const unsigned adaptation = (pkt[3] >> 4) & 0x03;
+
+        std::size_t offset = 4;
+        if (adaptation & 0x02)
+            offset += 1 + pkt[4];
+        if (!(adaptation & 0x01) || offset >= packet_size)
+            return; // no payload
+
+        const std::uint8_t* payload = pkt + offset;
+        std::size_t size = packet_size - offset;
+
+        if (pid == pat_pid || (pmt_pid && pid == *pmt_pid)) {
+            // Note: assume the tables fit in one packet, they always do for audio.
+            if (!unit_start)
+                return;
+            std::size_t pointer = payload[0];
+            if (1 + pointer >= size)
+                return;
+            payload += 1 + pointer;
+            size -= 1 + pointer;
+            if (pid == pat_pid)
+                process_pat(payload, size);
+            else
+                process_pmt(payload, size);
+            return;
+        }
+
+        if (!audio_pid || pid != *audio_pid)
+            return;
+
+        if (unit_start) {
+            // PES header: 00 00 01, stream id, length, 2 flag bytes, header data length
+            if (size < 9 || payload[0] != 0 || payload[1] != 0 || payload[2] != 1)
+                return;
+            std::size_t header_size = 9 + payload[8];
+            if (header_size >= size)
+                return;
+            payload += header_size;
+            size -= header_size;
+        }
+
+        out.write(payload, size);
+    }
+
+
+    void
+    demuxer::process_pat(const std::uint8_t* data,
+                         std::size_t size)
+    {
+        // table id, section length, ts id, version, section number, last section number
+        if (size < 8)
+            return;
+        std::size_t section_size = read_u16(data + 1) & 0x0fff;
+        std::size_t end = std::min(size, 3 + section_size) - 4; // drop CRC
+        for (std::size_t i = 8; i + 4 <= end; i += 4) {
+            std::uint16_t program = read_u16(data + i);
+            if (program == 0)
+                continue; // network PID
+            pmt_pid = read_u16(data + i + 2) & 0x1fff;
+            return;
+        }
+    }
+
+
+    void
+    demuxer::process_pmt(const std::uint8_t* data,
+                         std::size_t size)
+    {
+        if (audio_pid || size < 12)
+            return;
+        std::size_t section_size = read_u16(data + 1) & 0x0fff;
+        std::size_t end = std::min(size, 3 + section_size) - 4; // drop CRC
+        std::size_t info_size = read_u16(data + 10) & 0x0fff;
+        for (std::size_t i = 12 + info_size; i + 5 <= end; ) {
+            std::uint8_t type = data[i];
+            std::uint16_t pid = read_u16(data + i + 1) & 0x1fff;
+            std::size_t es_info_size = read_u16(data + i + 3) & 0x0fff;
+            if (is_audio(type)) {
+                audio_pid = pid;
+                audio_stream_type = type;
+                return;
+            }
+            i += 5 + es_info_size;
+        }
+    }
+
+} // namespace mpeg_ts
@@ -0,0 +1,75 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MPEG_TS_HPP
+#define MPEG_TS_HPP
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+
+#include "byte_stream.hpp"
+
+
+/*
+ * Minimal MPEG transport stream demuxer, as used by HLS segments.
+ *
+ * It finds the first audio stream of the first program, and outputs its elementary
+ * stream (ADTS AAC, or MPEG audio), ready for the decoder. Everything else is dropped.
+ */
+namespace mpeg_ts {
+
+    inline constexpr std::size_t packet_size = 188;
+
+
+    // True if the data looks like a transport stream.
+    [[nodiscard]]
+    bool
+    probe(std::span<const char> data)
+        noexcept;
+
+
+    class demuxer {
+
+    public:
+
+        // Packets can be split across calls.
+        void
+        feed(std::span<const char> data,
+             byte_stream& out);
+
+        // "audio/aac" or "audio/mpeg", once the audio stream was found.
+        [[nodiscard]]
+        std::optional<std::string>
+        get_content_type()
+            const;
+
+    private:
+
+        std::string partial;
+        std::optional<std::uint16_t> pmt_pid;
+        std::optional<std::uint16_t> audio_pid;
+        std::uint8_t audio_stream_type = 0;
+
+        void
+        process_packet(const std::uint8_t* pkt,
+                       byte_stream& out);
+
+        void
+        process_pat(const std::uint8_t* data,
+                    std::size_t size);
+
+        void
+        process_pmt(const std::uint8_t* data,
+                    std::size_t size);
+
+    }; // class demuxer
+
+} // namespace mpeg_ts
+
+#endif
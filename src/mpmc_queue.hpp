@@ -0,0 +1,316 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MPMC_QUEUE_HPP
+#define MPMC_QUEUE_HPP
+
+#include <algorithm>            // max()
+#include <atomic>
+#include <bit>                  // bit_ceil()
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <expected>
+#include <memory>               // unique_ptr
+#include <mutex>
+#include <optional>
+#include <utility>              // forward(), move()
+#include <vector>
+
+#include "async_queue.hpp"      // async_queue_error
+
+
+/*
+ * Bounded lock-free queue, for any number of producer and consumer threads.
+ *
+ * Same interface as async_queue, but pushing and popping only touch atomics; the mutex is
+ * only used to sleep, when pop() finds the queue empty or push() finds it full, and to
+ * wake up those sleepers. Since it never waits for the lock to be free, try_pop() never
+ * fails with async_queue_error::locked, and try_pop_for() waits for an element, not for
+ * the lock.
+ *
+ * Each slot has a sequence number, that tells if it's ready to be written or read in the
+ * current lap around the ring (Dmitry Vyukov's bounded MPMC queue). Slots hold a
+ * default-constructed T when empty.
+ */
+template<typename T>
+class mpmc_queue {
+
+    // Avoid false sharing between the producer and consumer indices.
+    static constexpr std::size_t line_size = 64;
+
+    struct slot {
+        std::atomic<std::size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<slot[]> slots;
+    std::size_t mask;
+
+    alignas(line_size) std::atomic<std::size_t> enqueue_pos = 0;
+    alignas(line_size) std::atomic<std::size_t> dequeue_pos = 0;
+
+    alignas(line_size) std::atomic<bool> should_stop = false;
+
+    // Threads sleeping in pop() or push(); only notify when there's someone to wake up.
+    std::atomic<unsigned> pop_sleepers = 0;
+    std::atomic<unsigned> push_sleepers = 0;
+    std::mutex mutex;
+    std::condition_variable not_empty_cond;
+    std::condition_variable not_full_cond;
+
+
+    template<typename U>
+    bool
+    enqueue(U&& x)
+    {
+        std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            slot& s = slots[pos & mask];
+            const std::size_t seq = s.seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                      std::memory_order_relaxed)) {
+                    s.value = std::forward<U>(x);
+                    s.seq.store(pos + 1, std::memory_order_release);
+                    wake(pop_sleepers, not_empty_cond);
+                    return true;
+                }
+            } else if (diff < 0)
+                return false; // full
+            else
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+
+    std::optional<T>
+    dequeue()
+    {
+        std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            slot& s = slots[pos & mask];
+            const std::size_t seq = s.seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                                      std::memory_order_relaxed)) {
+                    std::optional<T> result{std::move(s.value)};
+                    s.seq.store(pos + mask + 1, std::memory_order_release);
+                    wake(push_sleepers, not_full_cond);
+                    return result;
+                }
+            } else if (diff < 0)
+                return {}; // empty
+            else
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+
+    bool
+    has_ready()
+        const noexcept
+    {
+        const std::size_t pos = dequeue_pos.load(std::memory_order_acquire);
+        const std::size_t seq = slots[pos & mask].seq.load(std::memory_order_acquire);
+        return static_cast<std::ptrdiff_t>(seq - (pos + 1)) >= 0;
+    }
+
+
+    bool
+    has_room()
+        const noexcept
+    {
+        const std::size_t pos = enqueue_pos.load(std::memory_order_acquire);
+        const std::size_t seq = slots[pos & mask].seq.load(std::memory_order_acquire);
+        return static_cast<std::ptrdiff_t>(seq - pos) >= 0;
+    }
+
+
+    void
+    wake(std::atomic<unsigned>& sleepers,
+         std::condition_variable& cond)
+    {
+        /*
+         * Note: the sleeper increments its counter before checking the queue, so either it
+         * sees this change, or this sees the counter. Locking the mutex makes sure it's
+         * already waiting.
+         */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed)) {
+            std::lock_guard guard{mutex};
+            cond.notify_all();
+        }
+    }
+
+
+    template<typename Pred>
+    void
+    sleep(std::atomic<unsigned>& sleepers,
+          std::condition_variable& cond,
+          Pred pred)
+    {
+        std::unique_lock guard{mutex};
+        sleepers.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cond.wait(guard, pred);
+        sleepers.fetch_sub(1);
+    }
+
+public:
+
+    // Capacity gets rounded up to a power of two.
+    explicit
+    mpmc_queue(std::size_t min_capacity) :
+        slots{std::make_unique<slot[]>(std::bit_ceil(std::max<std::size_t>(min_capacity,
+                                                                            2)))},
+        mask{std::bit_ceil(std::max<std::size_t>(min_capacity, 2)) - 1}
+    {
+        for (std::size_t i = 0; i <= mask; ++i)
+            slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // disallow moving
+    mpmc_queue(mpmc_queue&&) = delete;
+
+
+    std::size_t
+    capacity()
+        const noexcept
+    {
+        return mask + 1;
+    }
+
+
+    // Makes the queue usable again after a stop().
+    void
+    reset()
+    {
+        should_stop.store(false);
+    }
+
+
+    // This will make all future pop() calls throw async_queue_error::stop.
+    // It also wakes up all threads waiting in pop() or push().
+    void
+    stop()
+    {
+        should_stop.store(true);
+        std::lock_guard guard{mutex};
+        not_empty_cond.notify_all();
+        not_full_cond.notify_all();
+    }
+
+
+    bool
+    is_stopping()
+        const noexcept
+    {
+        return should_stop.load();
+    }
+
+
+    // Note: only a snapshot, other threads may change it right away.
+    bool
+    empty()
+        const noexcept
+    {
+        return !has_ready();
+    }
+
+
+    // Blocks while the queue is full; after a stop(), the element is discarded.
+    template<typename U>
+    void
+    push(U&& x)
+    {
+        while (!enqueue(std::forward<U>(x))) {
+            if (should_stop.load())
+                return;
+            sleep(push_sleepers,
+                  not_full_cond,
+                  [this] { return should_stop.load() || has_room(); });
+        }
+    }
+
+
+    template<typename U>
+    bool
+    try_push(U&& x)
+    {
+        return enqueue(std::forward<U>(x));
+    }
+
+
+    T
+    pop()
+    {
+        while (true) {
+            if (should_stop.load())
+                throw async_queue_error::stop;
+            if (auto result = dequeue())
+                return std::move(*result);
+            sleep(pop_sleepers,
+                  not_empty_cond,
+                  [this] { return should_stop.load() || has_ready(); });
+        }
+    }
+
+
+    // Note: not noexcept, waking up a blocked push() locks the mutex.
+    std::expected<T, async_queue_error>
+    try_pop()
+    {
+        if (should_stop.load())
+            return std::unexpected{async_queue_error::stop};
+        if (auto result = dequeue())
+            return std::move(*result);
+        return std::unexpected{async_queue_error::empty};
+    }
+
+
+    template<typename Rep,
+             typename Period>
+    std::expected<T, async_queue_error>
+    try_pop_for(const std::chrono::duration<Rep, Period>& timeout)
+    {
+        auto result = try_pop();
+        if (result || result.error() != async_queue_error::empty)
+            return result;
+
+        {
+            std::unique_lock guard{mutex};
+            pop_sleepers.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            not_empty_cond.wait_for(guard,
+                                    timeout,
+                                    [this] { return should_stop.load() || has_ready(); });
+            pop_sleepers.fetch_sub(1);
+        }
+        return try_pop();
+    }
+
+
+    // Move everything currently queued to the end of out; returns how many were moved.
+    std::size_t
+    pop_all(std::vector<T>& out)
+    {
+        std::size_t count = 0;
+        if (should_stop.load())
+            return count;
+        while (auto result = dequeue()) {
+            out.push_back(std::move(*result));
+            ++count;
+        }
+        return count;
+    }
+
+}; // class mpmc_queue
+
+#endif
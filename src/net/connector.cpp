@@ -0,0 +1,184 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // max()
+#include <cerrno>
+#include <system_error>
+#include <vector>             // erase_if()
+
+#include "connector.hpp"
+
+
+namespace net {
+
+    namespace {
+
+        // Alternate between families, starting with the resolver's first one.
+        std::vector<address>
+        interleave(const std::vector<address>& addresses)
+        {
+            if (addresses.empty())
+                return {};
+
+            const auto first_family = addresses.front().family();
+            std::vector<address> primary;
+            std::vector<address> secondary;
+            for (const auto& addr : addresses)
+                (addr.family() == first_family ? primary : secondary).push_back(addr);
+
+            std::vector<address> result;
+            result.reserve(addresses.size());
+            for (std::size_t i = 0; i < std::max(primary.size(), secondary.size()); ++i) {
+                if (i < primary.size())
+                    result.push_back(primary[i]);
+                if (i < secondary.size())
+                    result.push_back(secondary[i]);
+            }
+            return result;
+        }
+
+
+        bool
+        in_progress(const error& e)
+            noexcept
+        {
+            return e.code() == std::errc::operation_in_progress
+                || e.code() == std::errc::operation_would_block
+                || e.code() == std::errc::resource_unavailable_try_again;
+        }
+
+    } // namespace
+
+
+    void
+    connector::start(const std::vector<address>& addresses,
+                     std::chrono::milliseconds new_stagger)
+    {
+        reset();
+        pending = interleave(addresses);
+        stagger = new_stagger;
+        next_start = std::chrono::steady_clock::now();
+    }
+
+
+    std::optional<socket>
+    connector::start_next()
+    {
+        while (next_pending < pending.size()) {
+            const auto& addr = pending[next_pending++];
+            try {
+                socket sock{addr.family(), socket::type::tcp};
+                sock.set_nonblock(true);
+                if (on_create)
+                    on_create(sock);
+                try {
+                    sock.connect(addr);
+                }
+                catch (error& e) {
+                    if (!in_progress(e))
+                        throw;
+                    poll.add(sock, socket::poll_flags::out);
+                    attempts.push_back(attempt{std::move(sock), addr});
+                    next_start = std::chrono::steady_clock::now() + stagger;
+                    return {};
+                }
+                return sock;
+            }
+            catch (error& e) {
+                last_error = e;
+            }
+        }
+        return {};
+    }
+
+
+    std::optional<socket>
+    connector::process(std::chrono::milliseconds timeout)
+    {
+        auto now = std::chrono::steady_clock::now();
+        // Note: nothing in flight means the previous one failed, so skip the stagger.
+        if (next_pending < pending.size() && (attempts.empty() || now >= next_start)) {
+            if (auto sock = start_next()) {
+                reset();
+                return sock;
+            }
+        }
+
+        if (attempts.empty()) {
+            if (next_pending < pending.size())
+                return {};
+            auto e = last_error.value_or(error{EHOSTUNREACH});
+            reset();
+            throw e;
+        }
+
+        // Don't wait past the next attempt's start.
+        if (next_pending < pending.size()) {
+            using std::chrono::milliseconds;
+            auto until_next = std::max(std::chrono::ceil<milliseconds>(next_start - now),
+                                       milliseconds{0});
+            if (timeout.count() < 0 || until_next < timeout)
+                timeout = until_next;
+        }
+
+        if (poll.wait(timeout).empty())
+            return {};
+
+        // Note: only a few attempts are in flight, so each one is checked.
+        const auto done_flags = socket::poll_flags::out
+                              | socket::poll_flags::err
+                              | socket::poll_flags::hup;
+        for (auto& a : attempts) {
+            auto ready = a.sock.try_poll(done_flags);
+            if (ready && (*ready & done_flags) == socket::poll_flags::none)
+                continue;
+            auto status = ready ? a.sock.get_error() : std::unexpected{ready.error()};
+            if (status && !status->code()) {
+                socket winner = std::move(a.sock);
+                poll.remove(winner);
+                reset();
+                return winner;
+            }
+            last_error = status ? *status : status.error();
+            poll.remove(a.sock);
+            a.sock = {};
+        }
+        std::erase_if(attempts, [](const attempt& a) { return !a.sock; });
+        return {};
+    }
+
+
+    void
+    connector::add_to(poller& p)
+        const
+    {
+        for (auto& a : attempts)
+            p.add(a.sock, socket::poll_flags::out);
+    }
+
+
+    bool
+    connector::active()
+        const noexcept
+    {
+        return !attempts.empty() || next_pending < pending.size();
+    }
+
+
+    void
+    connector::reset()
+        noexcept
+    {
+        poll.clear();
+        attempts.clear();
+        pending.clear();
+        next_pending = 0;
+        last_error.reset();
+    }
+
+
+} // namespace net
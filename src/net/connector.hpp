@@ -0,0 +1,98 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef NET_CONNECTOR_HPP
+#define NET_CONNECTOR_HPP
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "address.hpp"
+#include "poller.hpp"
+#include "socket.hpp"
+
+
+namespace net {
+
+    // Delay between connection attempts, as recommended by RFC 8305.
+    inline constexpr std::chrono::milliseconds default_connection_stagger{250};
+
+
+    /*
+     * Staggered parallel TCP connect ("happy eyeballs", RFC 8305).
+     *
+     * The addresses are reordered to alternate between IPv6 and IPv4, keeping the
+     * resolver's order within each family. A new attempt starts every stagger interval,
+     * or right away when one fails, without cancelling the ones in flight; the first
+     * one to connect wins, and the others are closed.
+     *
+     * Nothing blocks; call process() until it returns a socket. The returned socket is
+     * still non-blocking.
+     */
+    class connector {
+
+    public:
+
+        // Called on every new socket before connecting, to set options.
+        std::function<void(socket&)> on_create;
+
+
+        void
+        start(const std::vector<address>& addresses,
+              std::chrono::milliseconds stagger = default_connection_stagger);
+
+
+        /*
+         * Waits up to timeout for progress, but not past the next attempt; negative means
+         * no limit. Throws net::error when every address failed.
+         */
+        std::optional<socket>
+        process(std::chrono::milliseconds timeout = {});
+
+
+        // Adds the sockets in flight to the poller, for waiting on other things too.
+        void
+        add_to(poller& p)
+            const;
+
+
+        [[nodiscard]]
+        bool
+        active()
+            const noexcept;
+
+
+        void
+        reset()
+            noexcept;
+
+    private:
+
+        struct attempt {
+            socket sock;
+            address addr;
+        };
+
+        std::vector<address> pending;
+        std::size_t next_pending = 0;
+        std::vector<attempt> attempts;
+        std::chrono::milliseconds stagger{};
+        std::chrono::steady_clock::time_point next_start;
+        std::optional<error> last_error;
+        poller poll;
+
+        // Returns a socket if it connected immediately.
+        std::optional<socket>
+        start_next();
+
+    }; // class connector
+
+} // namespace net
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // find_if()
+#include <cerrno>
+
+#include <unistd.h>             // close()
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include "poller.hpp"
+
+
+namespace net {
+
+    namespace {
+
+        auto
+        find_entry(std::vector<pollfd>& entries, int fd)
+            noexcept
+        {
+            return std::ranges::find_if(entries,
+                                        [fd](const pollfd& e) { return e.fd == fd; });
+        }
+
+
+#ifdef __linux__
+        // Note: on Linux, the EPOLL* bits have the same values as the POLL* ones.
+        epoll_event
+        make_epoll_event(int fd, socket::poll_flags flags)
+            noexcept
+        {
+            epoll_event ev{};
+            ev.events = static_cast<unsigned short>(flags);
+            ev.data.fd = fd;
+            return ev;
+        }
+#endif
+
+    } // namespace
+
+
+    poller::poller()
+    {
+#ifdef __linux__
+        epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epfd == -1)
+            throw error{errno, "epoll_create1() failed"};
+#endif
+    }
+
+
+    poller::~poller()
+        noexcept
+    {
+#ifdef __linux__
+        if (epfd != -1)
+            ::close(epfd);
+#endif
+    }
+
+
+    void
+    poller::add(int fd, poll_flags flags)
+    {
+        auto it = find_entry(entries, fd);
+#ifdef __linux__
+        auto ev = make_epoll_event(fd, flags);
+        int op = it == entries.end() ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+        if (epoll_ctl(epfd, op, fd, &ev) == -1)
+            throw error{errno, "epoll_ctl() failed"};
+#endif
+        if (it == entries.end())
+            entries.push_back(pollfd{ .fd = fd, .events = static_cast<short>(flags), .revents = 0 });
+        else
+            it->events = static_cast<short>(flags);
+    }
+
+
+    void
+    poller::add(const socket& sock, poll_flags flags)
+    { add(sock.fd, flags); }
+
+
+    void
+    poller::remove(int fd)
+        noexcept
+    {
+        auto it = find_entry(entries, fd);
+        if (it == entries.end())
+            return;
+#ifdef __linux__
+        // Note: the fd may already be closed, which removes it from the epoll set.
+        epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+#endif
+        entries.erase(it);
+    }
+
+
+    void
+    poller::remove(const socket& sock)
+        noexcept
+    { remove(sock.fd); }
+
+
+    void
+    poller::clear()
+        noexcept
+    {
+#ifdef __linux__
+        for (auto& e : entries)
+            epoll_ctl(epfd, EPOLL_CTL_DEL, e.fd, nullptr);
+#endif
+        entries.clear();
+    }
+
+
+    bool
+    poller::empty()
+        const noexcept
+    { return entries.empty(); }
+
+
+    std::size_t
+    poller::size()
+        const noexcept
+    { return entries.size(); }
+
+
+    std::span<const poller::event>
+    poller::wait(std::chrono::milliseconds timeout)
+    {
+        auto result = try_wait(timeout);
+        if (!result)
+            throw result.error();
+        return *result;
+    }
+
+
+    std::expected<std::span<const poller::event>, error>
+    poller::try_wait(std::chrono::milliseconds timeout)
+        noexcept
+    {
+        ready.clear();
+        int ms = timeout.count() < 0 ? -1 : static_cast<int>(timeout.count());
+
+#ifdef __linux__
+        epoll_event evs[64];
+        int status = epoll_wait(epfd, evs, std::size(evs), ms);
+        if (status == -1) {
+            if (errno == EINTR)
+                return std::span<const event>{};
+            return std::unexpected{error{errno}};
+        }
+        for (int i = 0; i < status; ++i)
+            ready.push_back(event{ evs[i].data.fd,
+                                   static_cast<poll_flags>(evs[i].events & 0xffff) });
+#else
+        int status = ::poll(entries.data(), entries.size(), ms);
+        if (status == -1) {
+            if (errno == EINTR)
+                return std::span<const event>{};
+            return std::unexpected{error{errno}};
+        }
+        for (auto& e : entries)
+            if (e.revents)
+                ready.push_back(event{ e.fd, static_cast<poll_flags>(e.revents) });
+#endif
+
+        return std::span<const event>{ready};
+    }
+
+} // namespace net
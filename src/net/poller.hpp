@@ -0,0 +1,88 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef NET_POLLER_HPP
+#define NET_POLLER_HPP
+
+#include <chrono>
+#include <expected>
+#include <span>
+#include <vector>
+
+#include <poll.h>
+
+#include "error.hpp"
+#include "socket.hpp"
+
+
+namespace net {
+
+    /*
+     * Waits on many file descriptors at once: epoll on Linux, poll() elsewhere (like on
+     * the Wii U).
+     *
+     * Descriptors are added by socket, or by raw fd, for sockets owned by someone else
+     * (like curl's). Adding an fd that's already there changes its flags.
+     *
+     * There's no wakeup mechanism; wait with a timeout when other threads may have work
+     * for the caller.
+     */
+    class poller {
+
+    public:
+
+        using poll_flags = socket::poll_flags;
+
+        struct event {
+            int fd;
+            poll_flags flags;
+        };
+
+
+        poller();
+
+        ~poller() noexcept;
+
+        // disallow moving
+        poller(poller&&) = delete;
+
+
+        void add(int fd, poll_flags flags);
+        void add(const socket& sock, poll_flags flags);
+
+        void remove(int fd) noexcept;
+        void remove(const socket& sock) noexcept;
+
+        void clear() noexcept;
+
+        [[nodiscard]] bool empty() const noexcept;
+        [[nodiscard]] std::size_t size() const noexcept;
+
+
+        // Returns the descriptors that are ready; empty on timeout. A negative timeout
+        // waits forever. Throws net::error.
+        std::span<const event> wait(std::chrono::milliseconds timeout);
+
+        std::expected<std::span<const event>, error>
+        try_wait(std::chrono::milliseconds timeout)
+            noexcept;
+
+    private:
+
+        // The registered descriptors, on both backends.
+        std::vector<pollfd> entries;
+        std::vector<event> ready;
+
+#ifdef __linux__
+        int epfd = -1;
+#endif
+
+    }; // class poller
+
+} // namespace net
+
+#endif
@@ -5,8 +5,13 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <atomic>
 #include <cstring> // memcpy(), memset()
+#include <fstream>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
 
 #include "resolver.hpp"
@@ -40,6 +45,96 @@ namespace net::resolver {
             return {};
         }
 
+
+        using clock = std::chrono::system_clock;
+
+
+        struct forward_entry {
+            clock::time_point expiry;
+            std::optional<std::string> error;
+            std::vector<address_resolver::entry_t> entries;
+            std::optional<std::string> canon_name;
+        };
+
+
+        struct reverse_entry {
+            clock::time_point expiry;
+            std::optional<std::string> error;
+            std::optional<std::string> name;
+            std::optional<std::string> service;
+        };
+
+
+        std::mutex cache_mutex;
+        std::map<std::string, forward_entry> forward_cache;
+        std::map<std::string, reverse_entry> reverse_cache;
+        std::chrono::seconds positive_ttl = std::chrono::hours{6};
+        std::chrono::seconds negative_ttl = std::chrono::seconds{30};
+
+        std::atomic<std::uint64_t> cache_hits = 0;
+        std::atomic<std::uint64_t> cache_misses = 0;
+
+
+        std::string
+        to_hex(const void* data,
+               std::size_t size)
+        {
+            static const char digits[] = "0123456789abcdef";
+            auto bytes = static_cast<const unsigned char*>(data);
+            std::string result;
+            result.reserve(2 * size);
+            for (std::size_t i = 0; i < size; ++i) {
+                result += digits[bytes[i] >> 4];
+                result += digits[bytes[i] & 0xf];
+            }
+            return result;
+        }
+
+
+        std::string
+        from_hex(const std::string& hex)
+        {
+            if (hex.size() % 2)
+                throw std::runtime_error{"invalid hex string"};
+            std::string result;
+            result.reserve(hex.size() / 2);
+            for (std::size_t i = 0; i < hex.size(); i += 2)
+                result += static_cast<char>(std::stoul(hex.substr(i, 2), nullptr, 16));
+            return result;
+        }
+
+
+        std::vector<std::string>
+        split_tabs(const std::string& line)
+        {
+            std::vector<std::string> result;
+            std::istringstream input{line};
+            std::string field;
+            while (std::getline(input, field, '\t'))
+                result.push_back(std::move(field));
+            // a trailing empty field is lost by getline()
+            if (!line.empty() && line.back() == '\t')
+                result.emplace_back();
+            return result;
+        }
+
+
+        template<typename Entry>
+        const Entry*
+        lookup(const std::map<std::string, Entry>& cache,
+               const std::string& key)
+        {
+            auto it = cache.find(key);
+            if (it == cache.end() || it->second.expiry <= clock::now()) {
+                ++cache_misses;
+                return nullptr;
+            }
+            ++cache_hits;
+            if (it->second.error)
+                throw std::runtime_error{*it->second.error};
+            return &it->second;
+        }
+
     } // namespace
 
 
@@ -52,6 +147,23 @@ namespace net::resolver {
         result.entries.clear();
         result.canon_name.reset();
 
+        const bool use_cache = param.cached && !param.numeric;
+        std::string key;
+        if (use_cache) {
+            key = name.value_or("")
+                + "|" + service.value_or("")
+                + "|" + std::to_string(param.family.value_or(0))
+                + "|" + (param.type ? std::to_string(static_cast<int>(*param.type)) : "")
+                + "|" + (param.canon ? "c" : "")
+                + (param.passive ? "p" : "");
+            std::lock_guard guard{cache_mutex};
+            if (auto entry = lookup(forward_cache, key)) {
+                result.entries = entry->entries;
+                result.canon_name = entry->canon_name;
+                return;
+            }
+        }
+
         struct ::addrinfo hints;
         struct ::addrinfo* hints_ptr = nullptr;
 
@@ -89,8 +201,19 @@ namespace net::resolver {
                                    service ? service->data() : nullptr,
                                    hints_ptr,
                                    &raw_result_ptr);
-        if (status)
-            throw std::runtime_error{::gai_strerror(status)};
+        if (status) {
+            std::string msg = ::gai_strerror(status);
+            if (use_cache) {
+                std::lock_guard guard{cache_mutex};
+                forward_cache[key] = {
+                    .expiry = clock::now() + negative_ttl,
+                    .error = msg,
+                    .entries = {},
+                    .canon_name = {}
+                };
+            }
+            throw std::runtime_error{msg};
+        }
 
         // take ownership of the raw pointer
         std::unique_ptr<struct ::addrinfo> info{raw_result_ptr};
@@ -113,6 +236,16 @@ namespace net::resolver {
 
             result.entries.push_back(std::move(entry));
         }
+
+        if (use_cache) {
+            std::lock_guard guard{cache_mutex};
+            forward_cache[key] = {
+                .expiry = clock::now() + positive_ttl,
+                .error = {},
+                .entries = result.entries,
+                .canon_name = result.canon_name
+            };
+        }
     }
 
 
@@ -159,17 +292,53 @@ namespace net::resolver {
         if (param.numeric_service)
             flags |= NI_NUMERICSERV;
 
+        const bool use_cache = param.cached && !param.numeric_host;
+        std::string key;
+        if (use_cache) {
+            key = to_hex(addr.data(), addr.size())
+                + "|" + std::to_string(flags)
+                + "|" + (param.name ? "n" : "")
+                + (param.service ? "s" : "");
+            std::lock_guard guard{cache_mutex};
+            if (auto entry = lookup(reverse_cache, key)) {
+                result.name = entry->name;
+                result.service = entry->service;
+                return;
+            }
+        }
+
         int status = ::getnameinfo(addr.data(),    addr.size(),
                                    name.data(),    name.size(),
                                    service.data(), service.size(),
                                    flags);
-        if (status)
-            throw std::runtime_error{::gai_strerror(status)};
+        if (status) {
+            std::string msg = ::gai_strerror(status);
+            if (use_cache) {
+                std::lock_guard guard{cache_mutex};
+                reverse_cache[key] = {
+                    .expiry = clock::now() + negative_ttl,
+                    .error = msg,
+                    .name = {},
+                    .service = {}
+                };
+            }
+            throw std::runtime_error{msg};
+        }
 
         if (param.name)
             result.name = name.data();
         if (param.service)
             result.service = service.data();
+
+        if (use_cache) {
+            std::lock_guard guard{cache_mutex};
+            reverse_cache[key] = {
+                .expiry = clock::now() + positive_ttl,
+                .error = {},
+                .name = result.name,
+                .service = result.service
+            };
+        }
     }
 
 
@@ -191,4 +360,143 @@ namespace net::resolver {
         }
     }
 
+
+
+    namespace cache {
+
+        void
+        set_ttl(std::chrono::seconds positive,
+                std::chrono::seconds negative)
+            noexcept
+        {
+            std::lock_guard guard{cache_mutex};
+            positive_ttl = positive;
+            negative_ttl = negative;
+        }
+
+
+        void
+        clear()
+        {
+            std::lock_guard guard{cache_mutex};
+            forward_cache.clear();
+            reverse_cache.clear();
+        }
+
+
+        stats
+        get_stats()
+        {
+            std::lock_guard guard{cache_mutex};
+            return {
+                .hits = cache_hits.load(),
+                .misses = cache_misses.load(),
+                .entries = forward_cache.size() + reverse_cache.size()
+            };
+        }
+
+
+        /*
+         * File format, one entry per line, tab-separated:
+         *   F <key> <expiry> <canon_name> <address hex>,<type> ...
+         *   R <key> <expiry> <name> <service>
+         * Expiry is in seconds since the epoch; empty strings mean no value.
+         */
+
+        void
+        save(const std::filesystem::path& filename)
+        {
+            using std::chrono::duration_cast;
+            using std::chrono::seconds;
+
+            std::ofstream output{filename};
+            if (!output)
+                throw std::runtime_error{"could not open \"" + filename.string() + "\""};
+
+            std::lock_guard guard{cache_mutex};
+            const auto now = clock::now();
+
+            for (const auto& [key, entry] : forward_cache) {
+                if (entry.error || entry.expiry <= now)
+                    continue;
+                output << "F\t" << key
+                       << '\t' << duration_cast<seconds>(entry.expiry.time_since_epoch()).count()
+                       << '\t' << entry.canon_name.value_or("");
+                for (const auto& e : entry.entries)
+                    output << '\t' << to_hex(e.addr.data(), e.addr.size())
+                           << ',' << static_cast<int>(e.type);
+                output << '\n';
+            }
+
+            for (const auto& [key, entry] : reverse_cache) {
+                if (entry.error || entry.expiry <= now)
+                    continue;
+                output << "R\t" << key
+                       << '\t' << duration_cast<seconds>(entry.expiry.time_since_epoch()).count()
+                       << '\t' << entry.name.value_or("")
+                       << '\t' << entry.service.value_or("")
+                       << '\n';
+            }
+        }
+
+
+        void
+        load(const std::filesystem::path& filename)
+        {
+            std::ifstream input{filename};
+            if (!input)
+                return;
+
+            auto to_optional = [](std::string s) -> std::optional<std::string>
+            {
+                if (s.empty())
+                    return {};
+                return s;
+            };
+
+            std::lock_guard guard{cache_mutex};
+            const auto now = clock::now();
+
+            std::string line;
+            while (std::getline(input, line)) {
+                try {
+                    auto fields = split_tabs(line);
+                    if (fields.size() < 4)
+                        continue;
+                    clock::time_point expiry{std::chrono::seconds{std::stoll(fields[2])}};
+                    if (expiry <= now)
+                        continue;
+
+                    if (fields[0] == "F") {
+                        forward_entry entry;
+                        entry.expiry = expiry;
+                        entry.canon_name = to_optional(fields[3]);
+                        for (std::size_t i = 4; i < fields.size(); ++i) {
+                            auto comma = fields[i].find(',');
+                            if (comma == std::string::npos)
+                                throw std::runtime_error{"invalid address entry"};
+                            std::string raw = from_hex(fields[i].substr(0, comma));
+                            address_resolver::entry_t e;
+                            e.addr = address{reinterpret_cast<const ::sockaddr*>(raw.data()),
+                                             static_cast<socklen_t>(raw.size())};
+                            e.type = static_cast<socket::type>(std::stoi(fields[i].substr(comma + 1)));
+                            entry.entries.push_back(std::move(e));
+                        }
+                        forward_cache[fields[1]] = std::move(entry);
+                    } else if (fields[0] == "R" && fields.size() >= 5) {
+                        reverse_entry entry;
+                        entry.expiry = expiry;
+                        entry.name = to_optional(fields[3]);
+                        entry.service = to_optional(fields[4]);
+                        reverse_cache[fields[1]] = std::move(entry);
+                    }
+                }
+                catch (std::exception&) {
+                    // skip invalid lines
+                }
+            }
+        }
+
+    } // namespace cache
+
 } // namespace net::addrinfo
@@ -8,6 +8,10 @@
 #ifndef NET_RESOLVER_HPP
 #define NET_RESOLVER_HPP
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
 #include <optional>
 #include <string>
 #include <vector>
@@ -29,6 +33,7 @@ namespace net::resolver {
             bool canon   = false; // store the canonical name
             bool numeric = false; // only parse numerical notation, no name resolution
             bool passive = false;
+            bool cached  = true;  // use the resolver cache
         } param;
 
 
@@ -73,6 +78,8 @@ namespace net::resolver {
             bool local           = false;
             bool numeric_host    = false;
             bool numeric_service = false;
+
+            bool cached          = true; // use the resolver cache
         } param;
 
 
@@ -95,6 +102,45 @@ namespace net::resolver {
 
     };
 
+
+    /*
+     * Results from both resolvers are cached, successes for the positive TTL, failures
+     * for the negative TTL; getaddrinfo() doesn't tell the real DNS TTL. Numeric lookups
+     * are never cached. All functions are thread-safe.
+     */
+    namespace cache {
+
+        struct stats {
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::size_t entries = 0;
+        };
+
+
+        void
+        set_ttl(std::chrono::seconds positive,
+                std::chrono::seconds negative)
+            noexcept;
+
+
+        void
+        clear();
+
+
+        stats
+        get_stats();
+
+
+        // Only successful, unexpired results are saved.
+        void
+        save(const std::filesystem::path& filename);
+
+        // Expired results are ignored.
+        void
+        load(const std::filesystem::path& filename);
+
+    } // namespace cache
+
 } // namespace net::resolver
 
 #endif
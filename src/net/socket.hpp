@@ -49,6 +49,8 @@ namespace net {
 
         int fd = -1;
 
+        friend class poller;
+
     public:
 
         enum class ip_option : int {
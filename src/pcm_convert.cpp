@@ -0,0 +1,229 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <utility>              // index_sequence
+
+#include "pcm_convert.hpp"
+
+
+namespace pcm {
+
+    namespace {
+
+        // Entry i is for i + 1 channels.
+        template<sample Src, sample Dst, std::size_t... I>
+        constexpr
+        auto
+        make_same_table(std::index_sequence<I...>)
+            noexcept
+        {
+            using fn = void (*)(const Src*, Dst*, std::size_t) noexcept;
+            return std::array<fn, sizeof...(I)>{
+                &convert<Src, int(I) + 1, Dst, int(I) + 1>...
+            };
+        }
+
+
+        template<sample Src, sample Dst, std::size_t... I>
+        constexpr
+        auto
+        make_stereo_table(std::index_sequence<I...>)
+            noexcept
+        {
+            using fn = void (*)(const Src*, Dst*, std::size_t) noexcept;
+            return std::array<fn, sizeof...(I)>{
+                &convert<Src, int(I) + 1, Dst, 2>...
+            };
+        }
+
+
+        template<sample Src, std::size_t... I>
+        constexpr
+        auto
+        make_deinterleave_table(std::index_sequence<I...>)
+            noexcept
+        {
+            using fn = void (*)(const Src*, float* const*, std::size_t) noexcept;
+            return std::array<fn, sizeof...(I)>{
+                &deinterleave<Src, int(I) + 1>...
+            };
+        }
+
+
+        template<sample Dst, std::size_t... I>
+        constexpr
+        auto
+        make_interleave_table(std::index_sequence<I...>)
+            noexcept
+        {
+            using fn = void (*)(const float* const*, Dst*, std::size_t) noexcept;
+            return std::array<fn, sizeof...(I)>{
+                &interleave<Dst, int(I) + 1>...
+            };
+        }
+
+
+        using channel_indices = std::make_index_sequence<max_channels>;
+
+
+        bool
+        valid(int channels)
+            noexcept
+        {
+            return channels >= 1 && channels <= max_channels;
+        }
+
+    } // namespace
+
+
+    template<sample Src, sample Dst>
+    bool
+    convert(const Src* src,
+            int src_channels,
+            Dst* dst,
+            int dst_channels,
+            std::size_t frames)
+        noexcept
+    {
+        static constexpr auto same = make_same_table<Src, Dst>(channel_indices{});
+        static constexpr auto stereo = make_stereo_table<Src, Dst>(channel_indices{});
+        if (!valid(src_channels))
+            return false;
+        if (dst_channels == src_channels)
+            same[src_channels - 1](src, dst, frames);
+        else if (dst_channels == 2)
+            stereo[src_channels - 1](src, dst, frames);
+        else
+            return false;
+        return true;
+    }
+
+
+    template<sample Src>
+    bool
+    deinterleave(const Src* src,
+                 int channels,
+                 float* const* dst,
+                 std::size_t frames)
+        noexcept
+    {
+        static constexpr auto table = make_deinterleave_table<Src>(channel_indices{});
+        if (!valid(channels))
+            return false;
+        table[channels - 1](src, dst, frames);
+        return true;
+    }
+
+
+    template<sample Dst>
+    bool
+    interleave(const float* const* src,
+               int channels,
+               Dst* dst,
+               std::size_t frames)
+        noexcept
+    {
+        static constexpr auto table = make_interleave_table<Dst>(channel_indices{});
+        if (!valid(channels))
+            return false;
+        table[channels - 1](src, dst, frames);
+        return true;
+    }
+
+
+    template bool convert(const std::int16_t*, int, std::int16_t*, int, std::size_t) noexcept;
+    template bool convert(const std::int16_t*, int, float*, int, std::size_t) noexcept;
+    template bool convert(const float*, int, std::int16_t*, int, std::size_t) noexcept;
+    template bool convert(const float*, int, float*, int, std::size_t) noexcept;
+
+    template bool deinterleave(const std::int16_t*, int, float* const*, std::size_t) noexcept;
+    template bool deinterleave(const float*, int, float* const*, std::size_t) noexcept;
+
+    template bool interleave(const float* const*, int, std::int16_t*, std::size_t) noexcept;
+    template bool interleave(const float* const*, int, float*, std::size_t) noexcept;
+
+} // namespace pcm
+
+
+#ifdef UNIT_TEST
+
+// compilation: g++ -std=c++23 -DUNIT_TEST pcm_convert.cpp
+
+#include <iostream>
+#include <vector>
+
+#include "unit_test.hpp"
+
+using std::cout;
+using std::endl;
+
+int main()
+{
+    int total = 0;
+    int successes = 0;
+
+    {
+        cout << "Test: sample_cast" << endl;
+        CHECK_EQUAL(pcm::sample_cast<float>(std::int16_t{-32768}), -1.0f);
+        CHECK_EQUAL(pcm::sample_cast<float>(std::int16_t{16384}), 0.5f);
+        CHECK_EQUAL(pcm::sample_cast<std::int16_t>(0.5f), 16384);
+        CHECK_EQUAL(pcm::sample_cast<std::int16_t>(2.0f), 32767);
+        CHECK_EQUAL(pcm::sample_cast<std::int16_t>(-2.0f), -32768);
+    }
+
+    {
+        cout << "Test: convert S16 to F32" << endl;
+        const std::int16_t src[] = {0, 16384, -16384, 32767};
+        float dst[4] = {};
+        CHECK_EQUAL(pcm::convert(src, 2, dst, 2, 2), true);
+        CHECK_EQUAL(dst[1], 0.5f);
+        CHECK_EQUAL(dst[2], -0.5f);
+    }
+
+    {
+        cout << "Test: mono to stereo" << endl;
+        const float src[] = {0.25f, -0.5f};
+        std::int16_t dst[4] = {};
+        CHECK_EQUAL(pcm::convert(src, 1, dst, 2, 2), true);
+        CHECK_EQUAL(dst[0], 8192);
+        CHECK_EQUAL(dst[1], 8192);
+        CHECK_EQUAL(dst[3], -16384);
+    }
+
+    {
+        cout << "Test: 5.1 downmix" << endl;
+        // FL FR FC LFE BL BR; full scale everywhere except LFE.
+        const float src[] = {1, 1, 1, 1, 1, 1};
+        float dst[2] = {};
+        CHECK_EQUAL(pcm::convert(src, 6, dst, 2, 1), true);
+        CHECK_EQUAL(dst[0] > 0.999f && dst[0] < 1.001f, true);
+        CHECK_EQUAL(dst[1] > 0.999f && dst[1] < 1.001f, true);
+        const float left_only[] = {1, 0, 0, 0, 0, 0};
+        pcm::convert(left_only, 6, dst, 2, 1);
+        CHECK_EQUAL(dst[1], 0.0f);
+        CHECK_EQUAL(pcm::convert(src, 6, dst, 3, 1), false);
+        CHECK_EQUAL(pcm::convert(src, 9, dst, 2, 1), false);
+    }
+
+    {
+        cout << "Test: deinterleave and interleave" << endl;
+        const std::int16_t src[] = {1, 2, 3, 4, 5, 6};
+        std::vector<float> left(2), middle(2), right(2);
+        float* planes[] = {left.data(), middle.data(), right.data()};
+        CHECK_EQUAL(pcm::deinterleave(src, 3, planes, 2), true);
+        CHECK_EQUAL(middle[1], 5.0f / 32768);
+        std::int16_t back[6] = {};
+        CHECK_EQUAL(pcm::interleave(planes, 3, back, 2), true);
+        CHECK_EQUAL(back[0], 1);
+        CHECK_EQUAL(back[4], 5);
+        CHECK_EQUAL(back[5], 6);
+    }
+
+    cout << "Successes: " << successes << " / " << total << endl;
+}
+
+#endif // UNIT_TEST
@@ -0,0 +1,225 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef PCM_CONVERT_HPP
+#define PCM_CONVERT_HPP
+
+#include <algorithm>            // clamp()
+#include <array>
+#include <cmath>                // lrint()
+#include <cstddef>
+#include <cstdint>
+#include <cstring>              // memcpy()
+#include <type_traits>
+
+
+/*
+ * PCM conversion kernels: sample format (S16 or F32), interleaved vs planar, and channel
+ * layout.
+ *
+ * Each kernel is a template over the source format, the source channel count, the
+ * target format and the target channel count, so the inner loops have a fixed trip count
+ * and no branches; GCC unrolls them, and vectorizes them on desktop. The runtime versions
+ * pick the right instantiation once per call, not once per sample.
+ *
+ * Decoders emit whatever their library produces natively, and the rest of the pipeline
+ * works in that format; these are used where the samples have to change shape anyway
+ * (the resampler's planar history, the output device), so each sample is converted once.
+ */
+namespace pcm {
+
+    constexpr int max_channels = 8;
+
+
+    template<typename T>
+    concept sample = std::is_same_v<T, std::int16_t> || std::is_same_v<T, float>;
+
+
+    template<sample Dst,
+             sample Src>
+    constexpr
+    Dst
+    sample_cast(Src x)
+        noexcept
+    {
+        if constexpr (std::is_same_v<Src, Dst>)
+            return x;
+        else if constexpr (std::is_same_v<Dst, float>)
+            return x * (1.0f / 32768);
+        else
+            return std::lrint(std::clamp(x * 32768, -32768.0f, 32767.0f));
+    }
+
+
+    /*
+     * How each channel goes into the left and right outputs, using SDL's channel order:
+     *
+     *   3: FL FR LFE
+     *   4: FL FR BL BR
+     *   5: FL FR LFE BL BR
+     *   6: FL FR FC LFE BL BR
+     *   7: FL FR FC LFE BC SL SR
+     *   8: FL FR FC LFE BL BR SL SR
+     *
+     * Center and surround channels go in at -3 dB, LFE is dropped; each side is then
+     * scaled so it can't go over full scale.
+     */
+    template<int Channels>
+    requires(Channels >= 1 && Channels <= max_channels)
+    constexpr
+    std::array<std::array<float, Channels>, 2>
+    stereo_matrix()
+        noexcept
+    {
+        constexpr float h = 0.70710678f; // -3 dB
+        std::array<std::array<float, Channels>, 2> m{};
+        if constexpr (Channels == 1) {
+            m[0] = {1};
+            m[1] = {1};
+        } else if constexpr (Channels == 2) {
+            m[0] = {1, 0};
+            m[1] = {0, 1};
+        } else if constexpr (Channels == 3) {
+            m[0] = {1, 0, 0};
+            m[1] = {0, 1, 0};
+        } else if constexpr (Channels == 4) {
+            m[0] = {1, 0, h, 0};
+            m[1] = {0, 1, 0, h};
+        } else if constexpr (Channels == 5) {
+            m[0] = {1, 0, 0, h, 0};
+            m[1] = {0, 1, 0, 0, h};
+        } else if constexpr (Channels == 6) {
+            m[0] = {1, 0, h, 0, h, 0};
+            m[1] = {0, 1, h, 0, 0, h};
+        } else if constexpr (Channels == 7) {
+            m[0] = {1, 0, h, 0, h * h, h, 0};
+            m[1] = {0, 1, h, 0, h * h, 0, h};
+        } else {
+            m[0] = {1, 0, h, 0, h, 0, h, 0};
+            m[1] = {0, 1, h, 0, 0, h, 0, h};
+        }
+        for (auto& side : m) {
+            float sum = 0;
+            for (float c : side)
+                sum += c;
+            for (float& c : side)
+                c /= sum;
+        }
+        return m;
+    }
+
+
+    /*
+     * Interleaved to interleaved. The target has either the same number of channels as
+     * the source, or two (mono is duplicated, more channels are mixed down).
+     */
+    template<sample Src, int SrcChannels,
+             sample Dst, int DstChannels>
+    requires(DstChannels == SrcChannels || DstChannels == 2)
+    void
+    convert(const Src* __restrict src,
+            Dst* __restrict dst,
+            std::size_t frames)
+        noexcept
+    {
+        if constexpr (SrcChannels == DstChannels) {
+            if constexpr (std::is_same_v<Src, Dst>)
+                std::memcpy(dst, src, frames * SrcChannels * sizeof(Src));
+            else
+                for (std::size_t i = 0; i < frames * SrcChannels; ++i)
+                    dst[i] = sample_cast<Dst>(src[i]);
+        } else {
+            constexpr auto m = stereo_matrix<SrcChannels>();
+            for (std::size_t i = 0; i < frames; ++i) {
+                const Src* frame = src + i * SrcChannels;
+                float left = 0;
+                float right = 0;
+                for (int c = 0; c < SrcChannels; ++c) {
+                    const float x = sample_cast<float>(frame[c]);
+                    left  += m[0][c] * x;
+                    right += m[1][c] * x;
+                }
+                dst[2 * i]     = sample_cast<Dst>(left);
+                dst[2 * i + 1] = sample_cast<Dst>(right);
+            }
+        }
+    }
+
+
+    // Interleaved to planar float.
+    template<sample Src, int Channels>
+    void
+    deinterleave(const Src* __restrict src,
+                 float* const* dst,
+                 std::size_t frames)
+        noexcept
+    {
+        if constexpr (Channels == 1)
+            convert<Src, 1, float, 1>(src, dst[0], frames);
+        else
+            for (int c = 0; c < Channels; ++c) {
+                float* __restrict plane = dst[c];
+                for (std::size_t i = 0; i < frames; ++i)
+                    plane[i] = sample_cast<float>(src[i * Channels + c]);
+            }
+    }
+
+
+    // Planar float to interleaved.
+    template<sample Dst, int Channels>
+    void
+    interleave(const float* const* src,
+               Dst* __restrict dst,
+               std::size_t frames)
+        noexcept
+    {
+        if constexpr (Channels == 1)
+            convert<float, 1, Dst, 1>(src[0], dst, frames);
+        else
+            for (int c = 0; c < Channels; ++c) {
+                const float* __restrict plane = src[c];
+                for (std::size_t i = 0; i < frames; ++i)
+                    dst[i * Channels + c] = sample_cast<Dst>(plane[i]);
+            }
+    }
+
+
+    /*
+     * Runtime versions: channel counts go from 1 to max_channels. They return false,
+     * without touching dst, for unsupported channel counts.
+     */
+
+    template<sample Src, sample Dst>
+    bool
+    convert(const Src* src,
+            int src_channels,
+            Dst* dst,
+            int dst_channels,
+            std::size_t frames)
+        noexcept;
+
+
+    template<sample Src>
+    bool
+    deinterleave(const Src* src,
+                 int channels,
+                 float* const* dst,
+                 std::size_t frames)
+        noexcept;
+
+
+    template<sample Dst>
+    bool
+    interleave(const float* const* src,
+               int channels,
+               Dst* dst,
+               std::size_t frames)
+        noexcept;
+
+} // namespace pcm
+
+#endif
@@ -7,7 +7,6 @@
 
 #include <cstdio>
 #include <ostream>
-#include <ranges>
 #include <utility>              // move()
 
 #include "pls.hpp"
@@ -59,80 +58,145 @@ namespace pls {
     }
 
 
+    namespace {
+
+        // Protection against garbage, like a binary stream with the wrong mime type.
+        const std::size_t max_line_size = 8 * 1024;
+
+    } // namespace
+
+
+    void
+    parser::feed(std::string_view chunk)
+    {
+        while (!chunk.empty()) {
+            auto end = chunk.find_first_of("\r\n");
+            if (end == std::string_view::npos) {
+                partial_line.append(chunk);
+                if (partial_line.size() > max_line_size)
+                    throw error{"line is too long"};
+                return;
+            }
+            // Note: only lines split across chunks are copied.
+            if (partial_line.empty())
+                process_line(chunk.substr(0, end));
+            else {
+                partial_line.append(chunk.substr(0, end));
+                process_line(partial_line);
+                partial_line.clear();
+            }
+            chunk.remove_prefix(end + 1);
+        }
+    }
+
+
+    void
+    parser::finish()
+    {
+        if (!partial_line.empty()) {
+            process_line(partial_line);
+            partial_line.clear();
+        }
+
+        // sanity check, ensure the playlist wasn't truncated
+        if (num_of_entries && *num_of_entries != tracks.size())
+            throw error{"incomplete playlist: NumberOfEntries says "
+                        + std::to_string(*num_of_entries) + " but found "
+                        + std::to_string(tracks.size()) + " tracks"};
+    }
+
+
+    const playlist&
+    parser::get_tracks()
+        const noexcept
+    {
+        return tracks;
+    }
+
+
+    std::optional<std::string>
+    parser::first_url()
+        const
+    {
+        if (tracks.empty() || tracks.front().url.empty())
+            return {};
+        return tracks.front().url;
+    }
+
+
     /*
      * Note: a PLS file can have all its keys out of order.
      */
-    playlist
-    parse(const std::string& input)
+    void
+    parser::process_line(std::string_view line)
     {
         using string_utils::equal_case;
-        using string_utils::split;
-
-        playlist result;
 
-        auto lines = split(input, {"\r"s, "\n"s}, true);
-        if (lines.empty())
-            return result;
+        if (line.empty())
+            return;
 
-        if (lines.front() != header)
-            throw error{"wrong header: \""s + lines.front() + "\""};
-
-        std::optional<std::size_t> num_of_entries;
-
-        for (auto& line : lines | std::views::drop(1)) {
+        if (!seen_header) {
+            if (line != header)
+                throw error{"wrong header: \""s + std::string{line} + "\""};
+            seen_header = true;
+            return;
+        }
 
-            auto tokens = split(line, "=", false, 2);
-            if (tokens.size() != 2)
-                throw error{"can't parse line: \""s + line + "\""s};
+        auto eq = line.find('=');
+        if (eq == std::string_view::npos)
+            throw error{"can't parse line: \""s + std::string{line} + "\""s};
+        const std::string key{line.substr(0, eq)};
+        const std::string_view value = line.substr(eq + 1);
 
-            if (equal_case(tokens[0], "NumberOfEntries")) {
-                try {
-                    num_of_entries = std::stoul(tokens[1]);
-                }
-                catch (std::exception&) {
-                    throw error{"failed to parse number of entries: \""s + line + "\""s};
-                }
-                continue;
+        if (equal_case(key, "NumberOfEntries")) {
+            try {
+                num_of_entries = std::stoul(std::string{value});
             }
-            if (equal_case(tokens[0], "Version")) {
-                if (tokens[1] != "2")
-                    throw error{"unsupported PLS version"};
-                continue;
+            catch (std::exception&) {
+                throw error{"failed to parse number of entries: \""s + std::string{line} + "\""s};
             }
+            return;
+        }
+        if (equal_case(key, "Version")) {
+            if (value != "2")
+                throw error{"unsupported PLS version"};
+            return;
+        }
 
-            // otherwise assume it's a track entry
-            char key_name[64] = "";
-            std::size_t key_num = 0;
-            int r = std::sscanf(tokens[0].data(), "%63[A-Za-z]%zu", key_name, &key_num);
-            if (r != 2)
-                throw error{"can't parse key: \""s + tokens[0] + "\""s};
-
-            if (key_num == 0)
-                throw error{"track number cannot be zero"};
-            if (result.size() < key_num)
-                result.resize(key_num);
-            track& trk = result[key_num - 1];
-
-            if (equal_case(key_name, "File")) {
-                trk.url = tokens[1];
-            } else if (equal_case(key_name, "Length")) {
-                long val = std::stol(tokens[1]);
-                if (val != -1 && val != 0)
-                    trk.length = std::chrono::seconds(val);
-            } else if (equal_case(key_name, "Title")) {
-                if (!tokens[1].empty())
-                    trk.title = tokens[1];
-            } else
-                throw error{"invalid key: \""s + key_name + "\""s};
-        } // for each line
+        // otherwise assume it's a track entry
+        char key_name[64] = "";
+        std::size_t key_num = 0;
+        int r = std::sscanf(key.data(), "%63[A-Za-z]%zu", key_name, &key_num);
+        if (r != 2)
+            throw error{"can't parse key: \""s + key + "\""s};
+
+        if (key_num == 0)
+            throw error{"track number cannot be zero"};
+        if (tracks.size() < key_num)
+            tracks.resize(key_num);
+        track& trk = tracks[key_num - 1];
+
+        if (equal_case(key_name, "File")) {
+            trk.url = value;
+        } else if (equal_case(key_name, "Length")) {
+            long val = std::stol(std::string{value});
+            if (val != -1 && val != 0)
+                trk.length = std::chrono::seconds(val);
+        } else if (equal_case(key_name, "Title")) {
+            if (!value.empty())
+                trk.title = value;
+        } else
+            throw error{"invalid key: \""s + key_name + "\""s};
+    }
 
-        // sanity check, ensure the playlist wasn't truncated
-        if (num_of_entries && *num_of_entries != result.size())
-            throw error{"incomplete playlist: NumberOfEntries says "
-                        + std::to_string(*num_of_entries) + " but found "
-                        + std::to_string(result.size()) + " tracks"};
 
-        return result;
+    playlist
+    parse(const std::string& input)
+    {
+        parser p;
+        p.feed(input);
+        p.finish();
+        return p.get_tracks();
     }
 
 } // namespace pls
@@ -287,6 +351,30 @@ int main()
         dump(pl);
     }
 
+    {
+        cout << "Test: File1 available before the end" << endl;
+        auto url1 = "http://www.example.com/track1.mp3"s;
+        pls::parser p;
+        p.feed("[playlist]\nTitle1=One\nFi");
+        CHECK_EQUAL(p.first_url().has_value(), false);
+        p.feed("le1="s + url1);
+        CHECK_EQUAL(p.first_url().has_value(), false);
+        p.feed("\nFile2=http://www.example.com/track2.mp3\nNumberOf");
+        CHECK_EQUAL(p.first_url().value_or(""), url1);
+        p.feed("Entries=2");
+        p.finish();
+        CHECK_EQUAL(p.get_tracks().size(), 2);
+        dump(p.get_tracks());
+    }
+
+    {
+        cout << "Test: truncated, detected by finish()" << endl;
+        pls::parser p;
+        p.feed("[playlist]\nFile1=http://www.example.com/track1.mp3\nNumberOfEntries=3\n");
+        CHECK_EQUAL(p.first_url().has_value(), true);
+        CHECK_EXCEPT(p.finish(), pls::error);
+    }
+
     cout << "Successes: " << successes << " / " << total << endl;
 }
 
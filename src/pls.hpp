@@ -14,6 +14,7 @@
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 
@@ -47,6 +48,44 @@ namespace pls {
                 const playlist& pl);
 
 
+    /*
+     * Incremental parser: the input can be fed in chunks, as it arrives. Since the keys
+     * can be in any order, only finish() checks that the playlist is complete; but the
+     * first track's URL is available as soon as the "File1" line is seen.
+     */
+    class parser {
+
+        std::string partial_line;
+        bool seen_header = false;
+        std::optional<std::size_t> num_of_entries;
+        playlist tracks;
+
+        void
+        process_line(std::string_view line);
+
+    public:
+
+        // Throws pls::error.
+        void
+        feed(std::string_view chunk);
+
+        // End of input; the last line doesn't need a line break. Throws pls::error.
+        void
+        finish();
+
+        [[nodiscard]]
+        const playlist&
+        get_tracks()
+            const noexcept;
+
+        [[nodiscard]]
+        std::optional<std::string>
+        first_url()
+            const;
+
+    }; // class parser
+
+
     playlist
     parse(const std::string& input);
 
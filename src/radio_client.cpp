@@ -5,14 +5,18 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <algorithm>            // clamp(), min()
+#include <array>
+#include <chrono>
 #include <iostream>
+#include <iterator>             // next()
+#include <string_view>
+#include <thread>
 
 #include "radio_client.hpp"
 
-#include "cfg.hpp"
-#include "m3u.hpp"
 #include "mime_type.hpp"
-#include "pls.hpp"
+#include "resolved_url_cache.hpp"
 #include "tracer.hpp"
 
 
@@ -24,30 +28,97 @@ using namespace std::literals;
 
 namespace {
 
-    // Mime types for M3U playlists
-    const std::vector<std::string> m3u_mimes{
-        "audio/mpegurl",
-        "audio/x-mpegurl",
-        "application/vnd.apple.mpegurl",
-        "application/vnd.apple.mpegurl.audio",
-        "application/mpegurl",
-        "application/x-mpegurl",
+    enum class response_kind {
+        m3u,
+        pls,
+        audio,
     };
 
-    // Mime types for PLS playlists
-    const std::vector<std::string> pls_mimes{
-        "audio/x-scpls",
+    // Note: the playlists must come before "audio/*".
+    constexpr mime_type::table response_kinds{
+        mime_type::rule{ "audio/mpegurl",                       response_kind::m3u   },
+        mime_type::rule{ "audio/x-mpegurl",                     response_kind::m3u   },
+        mime_type::rule{ "application/vnd.apple.mpegurl",       response_kind::m3u   },
+        mime_type::rule{ "application/vnd.apple.mpegurl.audio", response_kind::m3u   },
+        mime_type::rule{ "application/mpegurl",                 response_kind::m3u   },
+        mime_type::rule{ "application/x-mpegurl",               response_kind::m3u   },
+        mime_type::rule{ "audio/x-scpls",                       response_kind::pls   },
+        mime_type::rule{ "audio/*",                             response_kind::audio },
+        mime_type::rule{ "application/ogg",                     response_kind::audio },
     };
 
-    // Mime types for audio streams
-    const std::vector<std::string> audio_mimes{
-        "audio/*",
-        "application/ogg",
+
+    // How much compressed audio to collect before creating the decoder.
+    const auto decoder_prebuffer = 250ms;
+
+    // Used when the bitrate is unknown.
+    const std::size_t default_decoder_threshold = 16 * 1024;
+
+    const std::size_t max_decoder_threshold = 256 * 1024;
+
+    // Limits for undecoded data; must be well above max_decoder_threshold.
+    const std::size_t http_low_watermark  = 512 * 1024;
+    const std::size_t http_high_watermark = 1024 * 1024;
+
+    // How much of data_stream is given to the decoder at once.
+    const std::size_t decoder_feed_size = 16 * 1024;
+
+    // How much of the timeshift buffer is given to the decoder at once.
+    const std::size_t timeshift_feed_size = 4 * 1024;
+
+    // Bigger M3U playlists aren't kept, so they can't be played as HLS.
+    const std::size_t max_playlist_text = 256 * 1024;
+
+
+    // Saved in captures; the other headers don't affect playback.
+    const std::array captured_headers{
+        "content-type"s,
+        "icy-metaint"s,
+        "icy-name"s,
+        "icy-url"s,
+        "icy-genre"s,
+        "icy-description"s,
+        "icy-br"s,
+        "ice-audio-info"s,
+        "icy-pub"s,
     };
 
+    const std::string replay_scheme = "capture:";
+
+
+    std::string
+    recording_extension(const std::string& content_type)
+    {
+        switch (decoder::probe_content_type(content_type)) {
+            case decoder::codec::aac:
+                return "aac";
+            case decoder::codec::mp3:
+                return "mp3";
+            case decoder::codec::opus:
+                return "opus";
+            case decoder::codec::vorbis:
+                return "ogg";
+            default:
+                if (content_type.contains("ogg"))
+                    return "ogg";
+                return "bin";
+        }
+    }
+
+
+    // Reconnection delay starts small and doubles after each failed attempt.
+    const auto min_reconnect_delay = 500ms;
+    const auto max_reconnect_delay = 30s;
+    const unsigned max_reconnect_attempts = 10;
+
 } // namespace
 
 
+std::mutex radio_client::capture_mutex;
+std::filesystem::path radio_client::capture_dir;
+std::atomic<double> radio_client::replay_speed = 1.0;
+
+
 radio_client::radio_client(const std::string& url,
                            const std::string& url_resolved,
                            const std::string& user_agent) :
@@ -59,32 +130,111 @@ radio_client::radio_client(const std::string& url,
 {
     TRACE_FUNC;
 
+    http.streaming = true;
     http.add_header("Icy-MetaData: 1");
+    http.set_watermarks(http_low_watermark, http_high_watermark);
 
     // Note: these callbacks are invoked during http::process()
     http.on_response_started  = [this] { process_http_response_started();  };
     http.on_response_finished = [this] { process_http_response_finished(); };
     http.on_recv = [this] { process_http_recv(); };
 
-    if (!url_resolved.empty())
-        set_next_url(url_resolved);
-    else
-        set_next_url(url);
+    if (url.starts_with(replay_scheme)) {
+        current_url = url;
+        try {
+            replay = std::make_unique<stream_capture::player>(url.substr(replay_scheme.size()),
+                                                              replay_speed.load());
+            cout << "Replaying capture of \"" << replay->get_header().url << "\"" << endl;
+            current_state = state::started;
+            process_http_response_started();
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: " << e.what() << endl;
+            current_state = state::stopped;
+        }
+        return;
+    }
+
+    const std::string start_url = url_resolved.empty() ? url : url_resolved;
+    if (auto cached = resolved_url_cache::lookup(start_url)) {
+        cout << "Using cached stream URL for \"" << start_url << "\": " << *cached << endl;
+        cached_from = start_url;
+        this->url_resolved = *cached;
+        set_next_url(*cached);
+    } else
+        set_next_url(start_url);
+}
+
+
+radio_client::~radio_client()
+    noexcept
+{
+    decoder::recycle(std::move(dec));
 }
 
 
 void
 radio_client::process()
 {
+    TRACE_FUNC;
+
+    if (replay) {
+        process_replay();
+        return;
+    }
+
+    if (current_state == state::reconnecting) {
+        if (std::chrono::steady_clock::now() < reconnect_at)
+            return;
+        cout << "Reconnecting to \"" << url_resolved << "\", attempt "
+             << reconnect_attempt << endl;
+        // Note: the decoder is kept, so it continues where it stopped.
+        set_next_url(url_resolved);
+    }
+
     try {
-        http.process();
+        if (hls_stream) {
+            hls_stream->process();
+            process_audio();
+            if (hls_stream->finished()) {
+                cout << "HLS playlist ended." << endl;
+                hls_stream.reset();
+                data_stream = &http.data_stream;
+                current_state = state::stopped;
+            }
+        } else
+            http.process();
     }
     catch (std::exception& e) {
-        current_state = state::stopped;
+        cout << "ERROR: radio_client::process(): " << e.what() << endl;
+        if (current_state == state::streaming_audio || reconnect_attempt)
+            schedule_reconnect();
+        else if (!fall_back_from_cache())
+            current_state = state::stopped;
     }
 }
 
 
+void
+radio_client::wait(std::chrono::milliseconds timeout)
+{
+    if (current_state == state::reconnecting) {
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(reconnect_at
+                                                                 - std::chrono::steady_clock::now());
+        // Note: the old connection is dead, it could wake us up in a loop.
+        std::this_thread::sleep_for(std::clamp(left, 0ms, timeout));
+        return;
+    }
+    if (replay) {
+        auto left = replay->finished() ? timeout : replay->time_until_next();
+        std::this_thread::sleep_for(std::clamp(left, 0ms, timeout));
+    } else if (hls_stream)
+        hls_stream->wait(timeout);
+    else
+        http.wait(timeout);
+}
+
+
 std::optional<decoder::spec>
 radio_client::get_spec()
 {
@@ -100,7 +250,40 @@ radio_client::get_samples()
     if (!dec)
         return {};
 
-    return dec->decode();
+    auto samples = dec->decode();
+    while (samples.empty() && feed_decoder())
+        samples = dec->decode();
+    return samples;
+}
+
+
+std::size_t
+radio_client::get_samples(std::span<char> out)
+{
+    if (!dec)
+        return 0;
+
+    std::size_t size = dec->decode_into(out);
+
+    // Note: the decoder only gets more once it runs dry, so when the output can't keep up,
+    // the undecoded data piles up in data_stream, and the transfer is paused.
+    while (!size && feed_decoder())
+        size = dec->decode_into(out);
+
+    // Note: the decoder only gets more from the timeshift buffer once it runs dry, so the
+    // cursor stays at what's being played.
+    while (!size && timeshift.unread()) {
+        auto chunk = timeshift.peek(timeshift_feed_size);
+        dec->feed(std::span{reinterpret_cast<const char*>(chunk.data()), chunk.size()});
+        timeshift.commit_read(chunk.size());
+        size = dec->decode_into(out);
+    }
+
+    // Note: after it was disabled, the buffer is released once it's drained.
+    if (!timeshift.is_enabled() && timeshift.size() && !timeshift.unread())
+        timeshift.clear();
+
+    return size;
 }
 
 
@@ -122,11 +305,64 @@ radio_client::get_decoder_info()
 }
 
 
+void
+radio_client::set_capture_dir(const std::filesystem::path& dir)
+{
+    std::lock_guard guard{capture_mutex};
+    capture_dir = dir;
+}
+
+
+void
+radio_client::set_recorder(std::shared_ptr<stream_recorder> rec)
+{
+    recorder = std::move(rec);
+    recorded_title.reset();
+    if (!recorder || !dec)
+        return;
+    std::uint64_t pos = timeshift.get_read_pos();
+    auto mark = timeshift_titles.begin();
+    for (std::size_t skip = 0; skip < timeshift.unread();) {
+        // Note: each chunk stops at the next title change.
+        while (mark != timeshift_titles.end()
+               && std::next(mark) != timeshift_titles.end()
+               && std::next(mark)->pos <= pos)
+            ++mark;
+        std::size_t max_size = timeshift.unread() - skip;
+        if (mark != timeshift_titles.end() && std::next(mark) != timeshift_titles.end())
+            max_size = std::min<std::uint64_t>(max_size, std::next(mark)->pos - pos);
+        auto chunk = timeshift.peek_ahead(skip, max_size);
+        if (mark != timeshift_titles.end())
+            record(chunk, mark->title);
+        else
+            record(chunk);
+        skip += chunk.size();
+        pos += chunk.size();
+    }
+}
+
+
+void
+radio_client::set_replay_speed(double speed)
+    noexcept
+{
+    replay_speed.store(speed);
+}
+
+
 void
 radio_client::set_next_url(const std::string& next_url)
 {
     icy_stream.reset();
+    hls_stream.reset();
+    if (capture) {
+        capture.reset();
+        http.on_data = nullptr;
+    }
+    data_stream = &http.data_stream;
+    decoder_threshold = 0;
 
+    current_url = next_url;
     http.set_url(next_url);
     if (next_url.empty())
         current_state = state::stopped;
@@ -135,41 +371,246 @@ radio_client::set_next_url(const std::string& next_url)
 }
 
 
+void
+radio_client::schedule_reconnect()
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    if (reconnect_attempt)
+        ++reconnects.failures;
+    else
+        disconnected_at = now;
+
+    if (url_resolved.empty() || reconnect_attempt >= max_reconnect_attempts) {
+        cout << "Giving up on reconnecting." << endl;
+        reconnect_attempt = 0;
+        current_state = state::stopped;
+        return;
+    }
+
+    auto delay = std::min<std::chrono::steady_clock::duration>(min_reconnect_delay
+                                                               * (1u << reconnect_attempt),
+                                                               max_reconnect_delay);
+    ++reconnect_attempt;
+    reconnect_at = now + delay;
+    current_state = state::reconnecting;
+}
+
+
+bool
+radio_client::fall_back_from_cache()
+{
+    if (cached_from.empty())
+        return false;
+    cout << "Cached stream URL failed, fetching \"" << cached_from << "\" again." << endl;
+    resolved_url_cache::invalidate(cached_from);
+    url_resolved = std::move(cached_from);
+    cached_from.clear();
+    set_next_url(url_resolved);
+    return true;
+}
+
+
+void
+radio_client::mark_streaming()
+{
+    current_state = state::streaming_audio;
+    // Note: the cached URL works, so there's no need to fall back anymore.
+    cached_from.clear();
+    if (url_resolved.empty())
+        url_resolved = url;
+    if (reconnect_attempt) {
+        auto elapsed = std::chrono::steady_clock::now() - disconnected_at;
+        ++reconnects.count;
+        reconnects.last_duration = elapsed;
+        reconnects.total_duration += elapsed;
+        reconnect_attempt = 0;
+        cout << "Reconnected after "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed)
+             << endl;
+    }
+}
+
+
+void
+radio_client::set_decoder_threshold(unsigned bitrate)
+{
+    // kbps -> bytes
+    decoder_threshold = bitrate * 1000 / 8 * decoder_prebuffer.count() / 1000;
+    decoder_threshold = std::clamp(decoder_threshold,
+                                   decoder::probe_window,
+                                   max_decoder_threshold);
+}
+
+
+void
+radio_client::start_hls()
+{
+    cout << "Detected HLS playlist." << endl;
+    // Note: reconnecting fetches the playlist again.
+    url_resolved = current_url;
+    try {
+        auto hls = std::make_unique<hls::stream>(current_url, playlist_text, user_agent);
+        playlist_text.clear();
+        mark_streaming();
+        hls_stream = std::move(hls);
+        data_stream = &hls_stream->data_stream;
+        if (hls_stream->bitrate) {
+            set_decoder_threshold(*hls_stream->bitrate);
+            timeshift.set_bitrate(*hls_stream->bitrate);
+        }
+    }
+    catch (std::exception& e) {
+        cout << "ERROR: " << e.what() << endl;
+        current_state = state::stopped;
+    }
+}
+
+
+std::optional<std::string>
+radio_client::get_header(const std::string& name)
+{
+    if (replay)
+        return replay->get_header().get(name);
+    return http.get_header(name);
+}
+
+
+void
+radio_client::start_capture()
+{
+    std::filesystem::path dir;
+    {
+        std::lock_guard guard{capture_mutex};
+        dir = capture_dir;
+    }
+    if (dir.empty())
+        return;
+
+    stream_capture::header hdr;
+    hdr.url = current_url;
+    for (auto& name : captured_headers)
+        if (auto value = http.get_header(name))
+            hdr.fields.emplace_back(name, *value);
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::system_clock::now().time_since_epoch());
+    auto path = dir / ("capture-" + std::to_string(ms.count()) + ".rcap");
+    try {
+        std::filesystem::create_directories(dir);
+        capture = std::make_unique<stream_capture::writer>(path, hdr);
+        cout << "Capturing stream to " << path << endl;
+        // Note: part of the body may have arrived together with the headers.
+        for (auto span : http.data_stream.readable_spans())
+            capture->write({reinterpret_cast<const char*>(span.data()), span.size()});
+    }
+    catch (std::exception& e) {
+        cout << "ERROR: could not start capture: " << e.what() << endl;
+        capture.reset();
+    }
+}
+
+
+void
+radio_client::process_replay()
+{
+    try {
+        replay->deliver([this](std::span<const char> buf)
+        {
+            if (icy_stream)
+                icy_stream->demux(buf);
+            else
+                data_stream->write(buf);
+        });
+        if (current_state == state::streaming_audio)
+            process_audio();
+    }
+    catch (std::exception& e) {
+        cout << "ERROR: radio_client::process_replay(): " << e.what() << endl;
+        current_state = state::stopped;
+    }
+
+    if (replay->finished() && current_state == state::streaming_audio) {
+        cout << "Replay ended." << endl;
+        current_state = state::stopped;
+    }
+}
+
+
 void
 radio_client::process_http_response_started()
 {
     // TRACE_FUNC;
 
-    auto content_type = http.get_header("content-type");
+    auto content_type = get_header("content-type");
     if (!content_type) {
         cout << "ERROR: server provided no content-type" << endl;
-        current_state = state::stopped;
+        if (!fall_back_from_cache())
+            current_state = state::stopped;
         return;
     }
 
-    if (mime_type::match(*content_type, m3u_mimes)) {
+    const auto kind = response_kinds.lookup(*content_type);
+    if (kind == response_kind::m3u) {
         cout << "Detected M3U mime: " << *content_type << endl;
         current_state = state::receiving_playlist;
         current_playlist = playlist_type::m3u;
-    } else if (mime_type::match(*content_type, pls_mimes)) {
+        m3u_parser = {};
+        playlist_text.clear();
+        playlist_truncated = false;
+    } else if (kind == response_kind::pls) {
         cout << "Detected PLS mime: " << *content_type << endl;
         current_state = state::receiving_playlist;
         current_playlist = playlist_type::pls;
-    } else if (mime_type::match(*content_type, audio_mimes)) {
+        pls_parser = {};
+    } else if (kind == response_kind::audio) {
         cout << "Detected audio mime: " << *content_type << endl;
-        current_state = state::streaming_audio;
+        mark_streaming();
+        if (dec && decoder::probe_content_type(*content_type)
+                   != decoder::probe_content_type(dec_content_type)) {
+            cout << "Codec changed, discarding old decoder." << endl;
+            decoder::recycle(std::move(dec));
+            dec_metadata.reset();
+            timeshift.clear();
+        }
+        if (!replay)
+            start_capture();
         try {
             cout << "Trying to create ICY stream" << endl;
-            icy_stream = std::make_unique<icy::stream>(http);
+            if (replay)
+                icy_stream = std::make_unique<icy::stream>([this](const std::string& name)
+                {
+                    return get_header(name);
+                });
+            else
+                icy_stream = std::make_unique<icy::stream>(http);
             cout << "ICY stream created. " << endl;
             data_stream = &icy_stream->data_stream;
-            metadata = icy_stream->get_metadata();
+            rebuild_metadata();
+            if (icy_stream->bitrate) {
+                set_decoder_threshold(*icy_stream->bitrate);
+                timeshift.set_bitrate(*icy_stream->bitrate);
+            }
         }
         catch (std::exception& e) {
             cout << "Could not create ICY stream: " << e.what() << endl;
         }
-    } else
+        if (capture) {
+            // Note: tee the raw body, before the ICY demuxer sees it.
+            auto inner = std::move(http.on_data);
+            http.on_data = [this, inner = std::move(inner)](std::span<const char> buf)
+            {
+                capture->write(buf);
+                if (inner)
+                    inner(buf);
+                else
+                    http.data_stream.write(buf);
+            };
+        }
+    } else {
         cout << "ERROR: don't know how to handle mime-type: " << *content_type << endl;
+        fall_back_from_cache();
+    }
 }
 
 
@@ -179,59 +620,92 @@ radio_client::process_http_response_finished()
     // TRACE_FUNC;
 
     if (current_state == state::receiving_playlist)
-        process_playlist();
+        process_playlist(true);
+    else if (current_state == state::streaming_audio) {
+        cout << "Stream ended." << endl;
+        schedule_reconnect();
+    }
 }
 
 
 void
 radio_client::process_http_recv()
 {
-    if (icy_stream)
-        icy_stream->process();
-
     if (current_state == state::streaming_audio)
         process_audio();
+    else if (current_state == state::receiving_playlist)
+        process_playlist(false);
 }
 
 
 void
-radio_client::process_playlist()
+radio_client::process_playlist(bool finished)
 {
     // TRACE_FUNC;
 
-    url_resolved.clear();
-
-    std::string data = data_stream->read_str();
-
-    switch (current_playlist) {
-        case playlist_type::m3u: {
-            try {
-                auto pl = m3u::parse(data);
-                url_resolved = pl.at(0).url;
-            }
-            catch (std::exception& e) {
-                cout << "ERROR: " << e.what() << endl;
-                cout << "<m3u>\n" << data << "\n</m3u>" << endl;
-            }
-            break;
+    std::optional<std::string> first_url;
+    try {
+        for (auto span : data_stream->readable_spans()) {
+            std::string_view chunk{reinterpret_cast<const char*>(span.data()), span.size()};
+            if (current_playlist == playlist_type::m3u) {
+                m3u_parser.feed(chunk);
+                if (playlist_truncated)
+                    continue;
+                if (playlist_text.size() + chunk.size() <= max_playlist_text)
+                    playlist_text.append(chunk);
+                else {
+                    cout << "WARNING: playlist is bigger than " << max_playlist_text
+                         << " bytes, only its first URL can be used" << endl;
+                    playlist_truncated = true;
+                }
+            } else if (current_playlist == playlist_type::pls)
+                pls_parser.feed(chunk);
         }
+        data_stream->clear();
+
+        switch (current_playlist) {
+            case playlist_type::m3u:
+                // Note: HLS tags come before the first URL, so it's not resolved early.
+                if (hls::is_hls(playlist_text)) {
+                    if (playlist_truncated)
+                        throw hls::error{"HLS playlist is too big"};
+                    if (finished)
+                        start_hls();
+                    return;
+                }
+                if (finished)
+                    m3u_parser.finish();
+                first_url = m3u_parser.first_url();
+                break;
+
+            case playlist_type::pls:
+                // Note: finish() only checks for truncation, File1 doesn't need it.
+                first_url = pls_parser.first_url();
+                if (!first_url && finished)
+                    pls_parser.finish();
+                break;
+
+            default:
+                cout << "ERROR: should not invoke process_playlist() when no playlist" << endl;
+                finished = true;
+        } // switch (current_playlist)
+    }
+    catch (std::exception& e) {
+        cout << "ERROR: " << e.what() << endl;
+        finished = true;
+    }
 
-        case playlist_type::pls: {
-            try {
-                auto pl = pls::parse(data);
-                url_resolved = pl.at(0).url;
-            }
-            catch (std::exception& e) {
-                cout << "ERROR: " << e.what() << endl;
-                cout << "<pls>\n" << data << "\n</pls>" << endl;
-            }
-            break;
-        }
+    if (!first_url && !finished)
+        return;
+
+    if (first_url && !finished)
+        cout << "Playlist resolved before it finished downloading." << endl;
 
-        default:
-            cout << "ERROR: should not invoke process_playlist() when no playlist" << endl;
-    } // switch (current_playlist)
+    if (first_url)
+        resolved_url_cache::store(current_url, *first_url);
 
+    // Note: this also cancels the rest of the playlist download.
+    url_resolved = first_url.value_or("");
     cout << "radio_client::url_resolved = \"" << url_resolved << "\"" << endl;
     set_next_url(url_resolved);
 }
@@ -243,38 +717,159 @@ radio_client::process_audio()
     if (current_state != state::streaming_audio)
         cout << "WARNING: logic error! process_audio should only happen during streaming_audio state" << endl;
 
-    if (icy_stream)
-        metadata = icy_stream->get_metadata();
+    update_metadata();
 
     if (!dec) {
-        if (data_stream->size() < cfg::state.player_buffer_size * 1024)
+        if (!decoder_threshold)
+            decoder_threshold = default_decoder_threshold;
+        if (data_stream->size() < decoder_threshold)
             return; // don't bother creating a decoder when too little data
         try {
             // try to create a decoder
-            auto hdr_content_type = http.get_header("content-type");
+            auto hdr_content_type = hls_stream
+                ? hls_stream->get_content_type()
+                : get_header("content-type");
             auto content_type = hdr_content_type ? *hdr_content_type : ""s;
-            std::vector<char> initial_buf(data_stream->size());
-            std::size_t initial_size = data_stream->peek(std::span{initial_buf});
-            dec = decoder::create(content_type, std::span{initial_buf.data(),
-                                                          initial_size});
-            data_stream->discard(initial_size);
+            auto initial_buf = data_stream->linearize();
+            dec = decoder::create(content_type,
+                                  std::span{reinterpret_cast<const char*>(initial_buf.data()),
+                                            initial_buf.size()});
+            dec_content_type = content_type;
+            record(initial_buf);
+            data_stream->discard(initial_buf.size());
         }
         catch (std::exception& e) {
             cout << "Failed to create decoder with "
                  << data_stream->size()
                  << " bytes: " << e.what() << endl;
+            // try again later, with more data
+            decoder_threshold = std::min(2 * decoder_threshold, max_decoder_threshold);
         }
     }
     if (!dec)
         return;
 
-    dec->feed(data_stream->read_as<char>());
+    // Note: while the buffer still has unread data, new data must queue up behind it.
+    // Otherwise, it stays in data_stream until the decoder needs it; see feed_decoder().
+    if (timeshift.is_enabled() || timeshift.unread()) {
+        if (recorder)
+            for (auto span : data_stream->readable_spans())
+                record(span);
+        mark_timeshift_title();
+        timeshift.write(*data_stream);
+    }
+
+    update_metadata();
+}
+
 
-    if (auto dec_meta = dec->get_metadata()) {
+bool
+radio_client::feed_decoder()
+{
+    if (!dec || data_stream->empty() || timeshift.is_enabled() || timeshift.unread())
+        return false;
+
+    if (recorder) {
+        // Note: record exactly what the decoder takes.
+        std::size_t left = decoder_feed_size;
+        for (auto span : data_stream->readable_spans()) {
+            auto part = span.first(std::min(left, span.size()));
+            record(part);
+            left -= part.size();
+            if (!left)
+                break;
+        }
+    }
+
+    dec->feed(*data_stream, decoder_feed_size);
+    return true;
+}
+
+
+void
+radio_client::update_metadata()
+{
+    bool changed = icy_stream && icy_stream->generation != icy_generation;
+    if (dec) {
+        auto dec_meta = dec->get_metadata();
+        if (dec_meta && dec_meta != dec_metadata) {
+            dec_metadata = std::move(dec_meta);
+            changed = true;
+        }
+    }
+    if (changed)
+        rebuild_metadata();
+}
+
+
+void
+radio_client::rebuild_metadata()
+{
+    if (icy_stream) {
+        metadata = icy_stream->get_metadata();
+        icy_generation = icy_stream->generation;
+    } else
+        metadata.reset();
+    if (dec_metadata) {
         if (metadata)
-            metadata->merge(*dec_meta);
+            metadata->merge(*dec_metadata);
         else
-            metadata = std::move(dec_meta);
+            metadata = dec_metadata;
+    }
+    ++metadata_generation;
+}
+
+
+std::string
+radio_client::get_record_title()
+    const
+{
+    // Note: only ICY titles split the recording; titles from the container (Ogg) come
+    // after the new headers, so splitting there would leave them in the old file.
+    std::string title;
+    if (icy_stream) {
+        const auto m = icy_stream->get_metadata();
+        if (m.artist && m.title)
+            title = *m.artist + " - " + *m.title;
+        else if (m.title)
+            title = *m.title;
+    }
+    return title;
+}
+
+
+void
+radio_client::mark_timeshift_title()
+{
+    std::string title = get_record_title();
+    if (timeshift_titles.empty() || timeshift_titles.back().title != title)
+        timeshift_titles.push_back({timeshift.get_end_pos(), std::move(title)});
+
+    // Note: the last mark before the oldest data is kept, it's the title of that data.
+    while (timeshift_titles.size() > 1
+           && timeshift_titles[1].pos <= timeshift.get_begin_pos())
+        timeshift_titles.pop_front();
+}
+
+
+void
+radio_client::record(std::span<const std::byte> data,
+                     const std::string& title)
+{
+    if (!recorder || data.empty())
+        return;
+
+    if (!recorded_title || *recorded_title != title) {
+        recorder->start_file(title, recording_extension(dec_content_type));
+        recorded_title = title;
     }
 
+    recorder->write(data);
+}
+
+
+void
+radio_client::record(std::span<const std::byte> data)
+{
+    record(data, get_record_title());
 }
@@ -8,18 +8,35 @@
 #ifndef RADIO_CLIENT_HPP
 #define RADIO_CLIENT_HPP
 
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
 #include <span>
 #include <string>
 
 #include <sdl2xx/audio.hpp>
 
 #include "decoder.hpp"
+#include "hls_stream.hpp"
 #include "http_client.hpp"
 #include "icy_stream.hpp"
+#include "m3u.hpp"
+#include "pls.hpp"
+#include "stream_capture.hpp"
+#include "stream_recorder.hpp"
+#include "timeshift_buffer.hpp"
 
 
-// This class is the high-level handler for internet radio streams.
+/*
+ * This class is the high-level handler for internet radio streams.
+ *
+ * A URL like "capture:/path/to/file" replays a capture, made by set_capture_dir(), instead
+ * of connecting.
+ */
 
 struct radio_client {
 
@@ -28,6 +45,7 @@ struct radio_client {
         started,
         receiving_playlist,
         streaming_audio,
+        reconnecting,
     };
 
     state current_state = state::stopped;
@@ -44,20 +62,58 @@ struct radio_client {
     };
 
     playlist_type current_playlist = playlist_type::none;
+    // Only the one for current_playlist is used.
+    m3u::parser m3u_parser;
+    pls::parser pls_parser;
+    // The M3U text, kept in case it turns out to be an HLS playlist.
+    std::string playlist_text;
+    // Set when the M3U text didn't fit in playlist_text.
+    bool playlist_truncated = false;
 
     std::string url;
     std::string url_resolved;
     std::string user_agent;
 
+    // The URL currently being fetched.
+    std::string current_url;
+    // When connecting to a URL from resolved_url_cache, the playlist URL it came from.
+    std::string cached_from;
+
     std::optional<stream_metadata> metadata;
+    // Incremented every time metadata changes.
+    unsigned metadata_generation = 0;
 
     http_client http;
     std::unique_ptr<icy::stream> icy_stream;
+    std::unique_ptr<hls::stream> hls_stream;
+
+    // Tees the audio response to a file, when capturing is enabled.
+    std::unique_ptr<stream_capture::writer> capture;
+    // Replaces http, for a "capture:" URL.
+    std::unique_ptr<stream_capture::player> replay;
+
+    // Gets the same audio as the timeshift buffer, split at every ICY title change.
+    std::shared_ptr<stream_recorder> recorder;
 
     byte_stream* data_stream = nullptr;
 
     std::unique_ptr<decoder::base> dec;
 
+    // When enabled, audio goes through it to reach the decoder; see get_samples().
+    timeshift_buffer timeshift;
+
+    // How many bytes to collect before trying to create the decoder.
+    std::size_t decoder_threshold = 0;
+
+    struct reconnect_stats {
+        unsigned count = 0;     // successful reconnections
+        unsigned failures = 0;  // failed attempts
+        std::chrono::steady_clock::duration last_duration{};
+        std::chrono::steady_clock::duration total_duration{};
+    };
+
+    reconnect_stats reconnects;
+
 
     radio_client(const std::string& url,
                  const std::string& url_resolved,
@@ -66,10 +122,18 @@ struct radio_client {
     // disallow moving
     radio_client(radio_client&&) = delete;
 
+    // The decoder goes back to decoder::recycle().
+    ~radio_client()
+        noexcept;
+
 
     void
     process();
 
+    // Block until the stream has data for process(), or the timeout expires.
+    void
+    wait(std::chrono::milliseconds timeout);
+
 
     std::optional<decoder::spec>
     get_spec();
@@ -78,6 +142,10 @@ struct radio_client {
     std::span<const char>
     get_samples();
 
+    // Decode into a caller-provided buffer, return how many bytes were written.
+    std::size_t
+    get_samples(std::span<char> out);
+
 
     const std::optional<stream_metadata>&
     get_metadata()
@@ -89,11 +157,88 @@ struct radio_client {
         const;
 
 
+    // Record every audio response to a new file in dir; empty disables it. Takes effect on
+    // the next connection.
+    static
+    void
+    set_capture_dir(const std::filesystem::path& dir);
+
+    // Null stops recording. The timeshift backlog is recorded first, so the recording
+    // starts close to what's being played.
+    void
+    set_recorder(std::shared_ptr<stream_recorder> rec);
+
+
+    // How fast "capture:" URLs are replayed; 0 means as fast as possible.
+    static
+    void
+    set_replay_speed(double speed)
+        noexcept;
+
+
 private:
 
+    static std::mutex capture_mutex;
+    static std::filesystem::path capture_dir;
+    static std::atomic<double> replay_speed;
+
+    // The content type the decoder was created for.
+    std::string dec_content_type;
+
+    // What metadata was last built from.
+    unsigned icy_generation = 0;
+    std::optional<stream_metadata> dec_metadata;
+
+    // Title of the file being recorded; empty until the first file starts.
+    std::optional<std::string> recorded_title;
+
+    // Where each ICY title starts in the timeshift buffer, so its backlog is recorded
+    // under the titles it arrived with.
+    struct title_mark {
+        std::uint64_t pos;
+        std::string title;
+    };
+    std::deque<title_mark> timeshift_titles;
+
+    unsigned reconnect_attempt = 0;
+    std::chrono::steady_clock::time_point disconnected_at;
+    std::chrono::steady_clock::time_point reconnect_at;
+
+
     void
     set_next_url(const std::string& next_url);
 
+    // Schedule another connection to the audio url, or stop if there were too many attempts.
+    void
+    schedule_reconnect();
+
+    // If the current URL came from resolved_url_cache, drop it, and fetch the playlist
+    // again. Returns false if there's nothing to fall back to.
+    bool
+    fall_back_from_cache();
+
+    // Bookkeeping for when audio starts arriving.
+    void
+    mark_streaming();
+
+    // Size the prebuffer for this bitrate, in kbps.
+    void
+    set_decoder_threshold(unsigned bitrate);
+
+    // Play the HLS playlist in playlist_text.
+    void
+    start_hls();
+
+    // From the replay, or from http.
+    std::optional<std::string>
+    get_header(const std::string& name);
+
+    void
+    start_capture();
+
+    void
+    process_replay();
+
     void
     process_http_response_started();
 
@@ -103,12 +248,44 @@ private:
     void
     process_http_recv();
 
+    // Feed what arrived so far; switch to the first URL as soon as it's known.
     void
-    process_playlist();
+    process_playlist(bool finished);
 
     void
     process_audio();
 
+    // Rebuild metadata, only if the ICY or decoder metadata changed.
+    void
+    update_metadata();
+
+    // Rebuild metadata from the ICY and decoder metadata.
+    void
+    rebuild_metadata();
+
+    // The ICY "artist - title", or empty.
+    [[nodiscard]]
+    std::string
+    get_record_title()
+        const;
+
+    // Remember the current title at the live end of the timeshift buffer.
+    void
+    mark_timeshift_title();
+
+    // Tee the compressed audio to the recorder; a new file starts when the title changes.
+    void
+    record(std::span<const std::byte> data,
+           const std::string& title);
+
+    void
+    record(std::span<const std::byte> data);
+
+    // Give the decoder the next chunk of data_stream, unless it goes through the timeshift
+    // buffer; returns false if there was nothing to give.
+    bool
+    feed_decoder();
+
 }; // struct radio_client
 
 #endif
@@ -0,0 +1,228 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef READ_MOSTLY_HPP
+#define READ_MOSTLY_HPP
+
+#include <array>
+#include <atomic>
+#include <concepts>             // constructible_from
+#include <cstddef>
+#include <cstdint>
+#include <cstring>              // memcpy()
+#include <memory>               // make_shared(), shared_ptr
+#include <mutex>
+#include <thread>               // this_thread::yield()
+#include <type_traits>
+#include <utility>              // forward(), move()
+
+
+/*
+ * Like thread_safe, for values that are read often (like every frame) and written rarely.
+ *
+ * Readers never wait for a writer: they get an immutable snapshot, through an atomic
+ * shared_ptr. Writers publish a new version; a reader holding an old snapshot keeps it
+ * alive. Writers are serialized with a mutex, so update() is a consistent
+ * read-modify-write.
+ *
+ * A default-constructed read_mostly holds no value, so load() returns a null pointer.
+ */
+template<typename T>
+class read_mostly {
+
+    std::atomic<std::shared_ptr<const T>> current;
+    std::mutex write_mutex;
+
+public:
+
+    read_mostly() = default;
+
+
+    template<typename... Args>
+    requires(sizeof...(Args) > 0 && std::constructible_from<T, Args&&...>)
+    read_mostly(Args&& ...args) :
+        current{std::make_shared<const T>(std::forward<Args>(args)...)}
+    {}
+
+
+    [[nodiscard]]
+    std::shared_ptr<const T>
+    load()
+        const noexcept
+    {
+        return current.load(std::memory_order_acquire);
+    }
+
+
+    template<typename U>
+    requires(std::constructible_from<T, U&&>)
+    void
+    store(U&& new_data)
+    {
+        // Note: constructed before locking, so writers only serialize on the swap.
+        auto ptr = std::make_shared<const T>(std::forward<U>(new_data));
+        std::lock_guard guard{write_mutex};
+        current.store(std::move(ptr), std::memory_order_release);
+    }
+
+
+    void
+    store(std::shared_ptr<const T> ptr)
+    {
+        std::lock_guard guard{write_mutex};
+        current.store(std::move(ptr), std::memory_order_release);
+    }
+
+
+    void
+    reset()
+    {
+        store(std::shared_ptr<const T>{});
+    }
+
+
+    // Publish func(copy), where copy starts as the current value, or T{} if there's none.
+    template<typename Func>
+    void
+    update(Func&& func)
+    {
+        std::lock_guard guard{write_mutex};
+        auto old = current.load(std::memory_order_relaxed);
+        auto ptr = old ? std::make_shared<T>(*old) : std::make_shared<T>();
+        std::forward<Func>(func)(*ptr);
+        current.store(std::move(ptr), std::memory_order_release);
+    }
+
+}; // class read_mostly<T>
+
+
+/*
+ * Small trivially-copyable values use a seqlock instead: load() returns a copy, and never
+ * allocates. The value is stored as atomic words, so readers racing with a writer never
+ * see a torn value; they just try again.
+ */
+template<typename T>
+requires(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>)
+class read_mostly<T> {
+
+    using word_t = std::uintptr_t;
+
+    static constexpr std::size_t num_words = (sizeof(T) + sizeof(word_t) - 1) / sizeof(word_t);
+
+    using buffer_t = std::array<word_t, num_words>;
+
+    // Odd while a write is in progress.
+    std::atomic<unsigned> seq = 0;
+    std::array<std::atomic<word_t>, num_words> words{};
+    std::mutex write_mutex;
+
+
+    static
+    buffer_t
+    to_words(const T& value)
+        noexcept
+    {
+        buffer_t buf{};
+        std::memcpy(buf.data(), &value, sizeof(T));
+        return buf;
+    }
+
+
+    static
+    T
+    from_words(const buffer_t& buf)
+        noexcept
+    {
+        T value;
+        std::memcpy(static_cast<void*>(&value), buf.data(), sizeof(T));
+        return value;
+    }
+
+
+    buffer_t
+    read_words()
+        const noexcept
+    {
+        buffer_t buf;
+        for (std::size_t i = 0; i < num_words; ++i)
+            buf[i] = words[i].load(std::memory_order_relaxed);
+        return buf;
+    }
+
+
+    // Note: write_mutex must be locked.
+    void
+    write_words(const buffer_t& buf)
+        noexcept
+    {
+        const unsigned s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < num_words; ++i)
+            words[i].store(buf[i], std::memory_order_relaxed);
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+public:
+
+    read_mostly() :
+        read_mostly{T{}}
+    {}
+
+
+    read_mostly(const T& value)
+    {
+        auto buf = to_words(value);
+        for (std::size_t i = 0; i < num_words; ++i)
+            words[i].store(buf[i], std::memory_order_relaxed);
+    }
+
+
+    [[nodiscard]]
+    T
+    load()
+        const noexcept
+    {
+        while (true) {
+            const unsigned before = seq.load(std::memory_order_acquire);
+            if (before & 1) {
+                // A writer got preempted in the middle; let it finish.
+                std::this_thread::yield();
+                continue;
+            }
+            auto buf = read_words();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == before)
+                return from_words(buf);
+        }
+    }
+
+
+    void
+    store(const T& new_data)
+        noexcept
+    {
+        auto buf = to_words(new_data);
+        std::lock_guard guard{write_mutex};
+        write_words(buf);
+    }
+
+
+    template<typename Func>
+    void
+    update(Func&& func)
+    {
+        std::lock_guard guard{write_mutex};
+        // Note: no other writer can change it now, no need to check seq.
+        T value = from_words(read_words());
+        std::forward<Func>(func)(value);
+        write_words(to_words(value));
+    }
+
+}; // class read_mostly<T>
+
+#endif
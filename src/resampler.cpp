@@ -0,0 +1,378 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // clamp(), min()
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <numbers>
+#include <numeric>              // gcd()
+
+#include "resampler.hpp"
+
+#include "pcm_convert.hpp"
+
+
+struct resampler::table {
+    unsigned up;                // L
+    unsigned down;              // M
+    std::vector<float> coefs;   // up phases, taps each
+};
+
+
+namespace {
+
+    // Taps per phase; a multiple of lanes.
+    constexpr int taps = 48;
+
+    // The dot products use this many partial sums, so GCC vectorizes them.
+    constexpr int lanes = 8;
+
+    // Larger ratios would need too much memory for the table.
+    const unsigned max_phases = 1024;
+
+    // The cutoff, relative to the lower of the two Nyquist frequencies.
+    const double rolloff = 0.9;
+
+    // Kaiser window shape: about 80 dB of stopband attenuation.
+    const double kaiser_beta = 8;
+
+    const unsigned max_channels = pcm::max_channels;
+
+
+    // Modified Bessel function of the first kind, order 0.
+    double
+    bessel_i0(double x)
+        noexcept
+    {
+        double sum = 1;
+        double term = 1;
+        for (int k = 1; k < 50; ++k) {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+            if (term < sum * 1e-12)
+                break;
+        }
+        return sum;
+    }
+
+
+    std::shared_ptr<const resampler::table>
+    make_table(unsigned up,
+               unsigned down)
+    {
+        auto t = std::make_shared<resampler::table>();
+        t->up = up;
+        t->down = down;
+        t->coefs.resize(up * taps);
+
+        // Cutoff in cycles per input sample; lower when reducing the rate.
+        const double fc = 0.5 * rolloff * std::min(1.0, double(up) / down);
+        const double center = taps / 2 - 1;
+        const double half_width = taps / 2;
+        const double norm = bessel_i0(kaiser_beta);
+
+        for (unsigned p = 0; p < up; ++p) {
+            float* h = t->coefs.data() + p * taps;
+            double sum = 0;
+            for (int j = 0; j < taps; ++j) {
+                // Distance, in input samples, from tap j to the output position.
+                const double x = center - j + double(p) / up;
+                const double r = std::clamp(x / half_width, -1.0, 1.0);
+                const double window = bessel_i0(kaiser_beta * std::sqrt(1 - r * r)) / norm;
+                const double arg = 2 * fc * x;
+                const double sinc = arg == 0
+                    ? 1
+                    : std::sin(std::numbers::pi * arg) / (std::numbers::pi * arg);
+                const double v = 2 * fc * sinc * window;
+                h[j] = v;
+                sum += v;
+            }
+            // Note: every phase gets exactly unity gain at DC, so there's no ripple.
+            for (int j = 0; j < taps; ++j)
+                h[j] /= sum;
+        }
+        return t;
+    }
+
+
+    // Tables are shared between all resamplers; built on first use.
+    std::shared_ptr<const resampler::table>
+    get_table(int input_rate)
+    {
+        static std::mutex mutex;
+        static std::map<int, std::shared_ptr<const resampler::table>> tables;
+
+        const unsigned g = std::gcd(input_rate, resampler::output_rate);
+        const unsigned up = resampler::output_rate / g;
+        const unsigned down = input_rate / g;
+        if (up > max_phases)
+            return {};
+
+        std::lock_guard guard{mutex};
+        auto& t = tables[input_rate];
+        if (!t)
+            t = make_table(up, down);
+        return t;
+    }
+
+
+    inline
+    float
+    dot(const float* h,
+        const float* x)
+        noexcept
+    {
+        float sums[lanes] = {};
+        for (int i = 0; i < taps; i += lanes)
+            for (int j = 0; j < lanes; ++j)
+                sums[j] += h[i + j] * x[i + j];
+        float result = 0;
+        for (int j = 0; j < lanes; ++j)
+            result += sums[j];
+        return result;
+    }
+
+} // namespace
+
+
+decoder::spec
+resampler::configure(const decoder::spec& input)
+{
+    if (configured
+        && input.format == input_spec.format
+        && input.rate == input_spec.rate
+        && input.channels == input_spec.channels)
+        return is_active() ? decoder::spec{input.format, output_rate, input.channels} : input;
+
+    input_spec = input;
+    configured = true;
+    filter.reset();
+    reset();
+
+    const bool supported_format = input.format == AUDIO_S16SYS
+                                  || input.format == AUDIO_F32SYS;
+    if (!supported_format
+        || input.rate <= 0
+        || input.rate == output_rate
+        || input.channels <= 0
+        || input.channels > int(max_channels))
+        return input;
+
+    filter = get_table(input.rate);
+    if (!filter)
+        return input;
+
+    history.resize(input.channels);
+    return {input.format, output_rate, input.channels};
+}
+
+
+bool
+resampler::is_active()
+    const noexcept
+{
+    return bool(filter);
+}
+
+
+std::size_t
+resampler::max_input(std::size_t out_size)
+    const noexcept
+{
+    if (!filter)
+        return out_size;
+
+    const std::size_t frame_size = SDL_AUDIO_BITSIZE(input_spec.format) / 8
+                                   * input_spec.channels;
+    const std::size_t out_frames = out_size / frame_size;
+    // Note: the frames already buffered can produce a few outputs too.
+    const std::size_t frames = (out_frames * filter->down) / filter->up;
+    if (frames <= taps + 1)
+        return 0;
+    return (frames - taps - 1) * frame_size;
+}
+
+
+std::span<char>
+resampler::process(std::span<char> input)
+{
+    if (!filter)
+        return input;
+    if (input_spec.format == AUDIO_S16SYS)
+        return run(std::span{reinterpret_cast<const std::int16_t*>(input.data()),
+                             input.size() / sizeof(std::int16_t)});
+    else
+        return run(std::span{reinterpret_cast<const float*>(input.data()),
+                             input.size() / sizeof(float)});
+}
+
+
+void
+resampler::reset()
+    noexcept
+{
+    history.clear();
+    if (filter)
+        history.resize(input_spec.channels);
+    pos = 0;
+    phase = 0;
+}
+
+
+template<typename T>
+std::span<char>
+resampler::run(std::span<const T> input)
+{
+    const unsigned channels = input_spec.channels;
+    const std::size_t in_frames = input.size() / channels;
+
+    // De-interleave.
+    float* planes[max_channels];
+    for (unsigned c = 0; c < channels; ++c) {
+        auto& h = history[c];
+        // Note: start with silence, so the first output frame is aligned with the first
+        // input frame.
+        if (h.empty())
+            h.assign(taps / 2 - 1, 0.0f);
+        const std::size_t old_size = h.size();
+        h.resize(old_size + in_frames);
+        planes[c] = h.data() + old_size;
+    }
+    pcm::deinterleave(input.data(), channels, planes, in_frames);
+
+    const unsigned up = filter->up;
+    const unsigned down = filter->down;
+    const std::size_t available = history[0].size();
+
+    const std::size_t max_out = available * up / down + 2;
+    output.resize(max_out * channels * sizeof(T));
+    T* out = reinterpret_cast<T*>(output.data());
+
+    std::size_t produced = 0;
+    while (pos + taps <= available) {
+        const float* h = filter->coefs.data() + phase * taps;
+        for (unsigned c = 0; c < channels; ++c)
+            out[produced * channels + c] = pcm::sample_cast<T>(dot(h, history[c].data() + pos));
+        ++produced;
+        phase += down;
+        pos += phase / up;
+        phase %= up;
+    }
+
+    // Drop what won't be needed again.
+    const std::size_t consumed = std::min(pos, available);
+    for (auto& h : history)
+        h.erase(h.begin(), h.begin() + consumed);
+    pos -= consumed;
+
+    return std::span{output}.first(produced * channels * sizeof(T));
+}
+
+
+#ifdef UNIT_TEST
+
+// compilation:
+//     g++ -std=c++23 -c pcm_convert.cpp
+//     g++ -std=c++23 -DUNIT_TEST resampler.cpp pcm_convert.o
+
+#include <iostream>
+
+#include "unit_test.hpp"
+
+using std::cout;
+using std::endl;
+
+
+// Feeds frames of a constant, in chunks; returns everything that came out.
+template<typename T>
+std::vector<T>
+resample_constant(resampler& rs,
+                  T value,
+                  int channels,
+                  std::size_t frames,
+                  std::size_t chunk)
+{
+    std::vector<T> result;
+    std::vector<T> input;
+    for (std::size_t done = 0; done < frames; done += chunk) {
+        input.assign(std::min(chunk, frames - done) * channels, value);
+        auto out = rs.process(std::span{reinterpret_cast<char*>(input.data()),
+                                        input.size() * sizeof(T)});
+        const T* first = reinterpret_cast<const T*>(out.data());
+        result.insert(result.end(), first, first + out.size() / sizeof(T));
+    }
+    return result;
+}
+
+
+int main()
+{
+    int total = 0;
+    int successes = 0;
+
+    {
+        cout << "Test: 44.1 kHz to 48 kHz frame count" << endl;
+        resampler rs;
+        auto spec = rs.configure({AUDIO_S16SYS, 44100, 2});
+        CHECK_EQUAL(rs.is_active(), true);
+        CHECK_EQUAL(spec.rate, 48000);
+        CHECK_EQUAL(spec.channels, 2);
+        // One second in, one second out, minus the filter's delay (about 26 frames).
+        auto out = resample_constant<std::int16_t>(rs, 0, 2, 44100, 1000);
+        CHECK_EQUAL(out.size() / 2, 47974u);
+
+        // The chunk size makes no difference.
+        rs.reset();
+        out = resample_constant<std::int16_t>(rs, 0, 2, 44100, 44100);
+        CHECK_EQUAL(out.size() / 2, 47974u);
+
+        // Leftovers carry into the next call, so the ratio holds in the long run.
+        rs.reset();
+        out = resample_constant<std::int16_t>(rs, 0, 2, 441000, 333);
+        CHECK_EQUAL(out.size() / 2 + 26, 480000u);
+    }
+
+    {
+        cout << "Test: DC gain, S16" << endl;
+        resampler rs;
+        rs.configure({AUDIO_S16SYS, 44100, 2});
+        auto out = resample_constant<std::int16_t>(rs, 10000, 2, 4410, 441);
+        // Skip the start, where the filter still sees the initial silence.
+        int worst = 0;
+        for (std::size_t i = 2 * taps; i < out.size(); ++i)
+            worst = std::max(worst, std::abs(out[i] - 10000));
+        CHECK_EQUAL(worst <= 1, true);
+    }
+
+    {
+        cout << "Test: DC gain, F32 downsampling" << endl;
+        resampler rs;
+        auto spec = rs.configure({AUDIO_F32SYS, 96000, 1});
+        CHECK_EQUAL(spec.rate, 48000);
+        auto out = resample_constant<float>(rs, 0.5f, 1, 9600, 1000);
+        CHECK_EQUAL(out.size(), 4800u - 12);
+        float worst = 0;
+        for (std::size_t i = taps; i < out.size(); ++i)
+            worst = std::max(worst, std::abs(out[i] - 0.5f));
+        CHECK_EQUAL(worst < 1e-5f, true);
+    }
+
+    {
+        cout << "Test: pass-through" << endl;
+        resampler rs;
+        auto spec = rs.configure({AUDIO_S16SYS, 48000, 2});
+        CHECK_EQUAL(rs.is_active(), false);
+        CHECK_EQUAL(spec.rate, 48000);
+        CHECK_EQUAL(rs.max_input(4096), 4096u);
+    }
+
+    cout << "Successes: " << successes << " / " << total << endl;
+}
+
+#endif // UNIT_TEST
@@ -0,0 +1,91 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef RESAMPLER_HPP
+#define RESAMPLER_HPP
+
+#include <cstddef>
+#include <memory>               // shared_ptr
+#include <span>
+#include <vector>
+
+#include "decoder.hpp"
+
+
+/*
+ * Converts decoded PCM to 48 kHz, the rate the Wii U mixes at, so SDL never has to
+ * resample, and the output rate doesn't change between stations.
+ *
+ * It's a polyphase FIR: for an input rate R, the ratio 48000/R is reduced to L/M, and a
+ * Kaiser-windowed sinc is split into L phases of a fixed number of taps. Each output frame
+ * is one dot product per channel, with the phase picked by the output's position between
+ * two input frames. The tables are built once per input rate, and shared by all
+ * resamplers.
+ *
+ * Samples are kept as planar float internally, so the dot products run over contiguous
+ * memory, with a fixed trip count; GCC vectorizes them on desktop.
+ *
+ * Only S16 and F32 are converted, and only for rates where L stays small (all the usual
+ * ones: 8, 11.025, 16, 22.05, 24, 32, 44.1, 88.2 and 96 kHz); anything else passes
+ * through, and SDL converts it.
+ */
+class resampler {
+
+public:
+
+    static constexpr int output_rate = 48000;
+
+    // Returns the spec that comes out of process(). Only resets when the spec changes.
+    decoder::spec
+    configure(const decoder::spec& input);
+
+    [[nodiscard]]
+    bool
+    is_active()
+        const noexcept;
+
+    // How many bytes of input can be processed, for the output to fit in out_size bytes.
+    [[nodiscard]]
+    std::size_t
+    max_input(std::size_t out_size)
+        const noexcept;
+
+    // Converts whole frames; the result is valid until the next call. When not active,
+    // returns the input.
+    std::span<char>
+    process(std::span<char> input);
+
+    // Forget the past samples.
+    void
+    reset()
+        noexcept;
+
+
+    // Note: defined in resampler.cpp.
+    struct table;
+
+private:
+
+    std::shared_ptr<const table> filter;
+    decoder::spec input_spec{};
+    bool configured = false;
+
+    // One buffer per channel; the frames before pos were already consumed.
+    std::vector<std::vector<float>> history;
+    std::size_t pos = 0;
+    unsigned phase = 0;
+
+    std::vector<char> output;
+
+
+    template<typename T>
+    std::span<char>
+    run(std::span<const T> input);
+
+}; // class resampler
+
+#endif
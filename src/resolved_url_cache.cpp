@@ -0,0 +1,132 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <utility>              // move()
+
+#include "resolved_url_cache.hpp"
+
+#include "Serializer.hpp"
+#include "thread_safe.hpp"
+
+
+using namespace std::literals;
+
+
+namespace resolved_url_cache {
+
+    namespace {
+
+        const auto ttl = std::chrono::days{7};
+
+        // Avoids growing forever, for users who hop through lots of stations.
+        const std::size_t max_entries = 500;
+
+
+        struct Entry {
+            std::string  stream_url;
+            std::int64_t timestamp = 0; // seconds since the epoch
+        };
+
+        using EntryMap = std::map<std::string, Entry>;
+        thread_safe<EntryMap> entries;
+
+
+        std::int64_t
+        now_seconds()
+        {
+            using namespace std::chrono;
+            return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+        }
+
+
+        bool
+        is_fresh(const Entry& e,
+                 std::int64_t now)
+        {
+            return now - e.timestamp
+                < std::chrono::duration_cast<std::chrono::seconds>(ttl).count();
+        }
+
+
+        void
+        remove_oldest(EntryMap& map)
+        {
+            auto oldest = map.begin();
+            for (auto it = map.begin(); it != map.end(); ++it)
+                if (it->second.timestamp < oldest->second.timestamp)
+                    oldest = it;
+            if (oldest != map.end())
+                map.erase(oldest);
+        }
+
+    } // namespace
+
+
+    std::optional<std::string>
+    lookup(const std::string& playlist_url)
+    {
+        auto map = entries.lock();
+        auto it = map->find(playlist_url);
+        if (it == map->end())
+            return {};
+        if (!is_fresh(it->second, now_seconds())) {
+            map->erase(it);
+            return {};
+        }
+        return it->second.stream_url;
+    }
+
+
+    void
+    store(const std::string& playlist_url,
+          const std::string& stream_url)
+    {
+        if (playlist_url.empty() || stream_url == playlist_url)
+            return;
+        if (!stream_url.starts_with("http://") && !stream_url.starts_with("https://"))
+            return;
+
+        auto map = entries.lock();
+        if (!map->contains(playlist_url) && map->size() >= max_entries)
+            remove_oldest(*map);
+        (*map)[playlist_url] = Entry{stream_url, now_seconds()};
+    }
+
+
+    void
+    invalidate(const std::string& playlist_url)
+    {
+        entries.lock()->erase(playlist_url);
+    }
+
+
+    void
+    save(const std::filesystem::path& filename)
+    {
+        auto map = entries.load();
+        const auto now = now_seconds();
+        std::erase_if(map, [now](const auto& kv) { return !is_fresh(kv.second, now); });
+        Serializer::save(map, filename);
+    }
+
+
+    void
+    load(const std::filesystem::path& filename)
+    {
+        if (!Serializer::can_load(filename))
+            return;
+        EntryMap loaded;
+        Serializer::load(loaded, filename);
+        const auto now = now_seconds();
+        std::erase_if(loaded, [now](const auto& kv) { return !is_fresh(kv.second, now); });
+        entries.store(std::move(loaded));
+    }
+
+} // namespace resolved_url_cache
@@ -0,0 +1,50 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef RESOLVED_URL_CACHE_HPP
+#define RESOLVED_URL_CACHE_HPP
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+
+/*
+ * Remembers which stream URL a playlist URL resolved to, so the next time the station is
+ * played the playlist download can be skipped.
+ *
+ * Entries expire after a while, since stations move their streams around; a stream URL
+ * that fails to connect is removed, and the playlist is used again. Safe to use from any
+ * thread.
+ */
+namespace resolved_url_cache {
+
+    // Returns the cached stream URL, if it's still fresh.
+    [[nodiscard]]
+    std::optional<std::string>
+    lookup(const std::string& playlist_url);
+
+    // Only http:// and https:// stream URLs are stored.
+    void
+    store(const std::string& playlist_url,
+          const std::string& stream_url);
+
+    void
+    invalidate(const std::string& playlist_url);
+
+
+    // Expired entries are not saved.
+    void
+    save(const std::filesystem::path& filename);
+
+    // Expired entries are ignored.
+    void
+    load(const std::filesystem::path& filename);
+
+} // namespace resolved_url_cache
+
+#endif
@@ -5,19 +5,34 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <algorithm>            // any_of(), min()
+#include <array>
 #include <cassert>
+#include <charconv>             // from_chars()
+#include <cstdint>
+#include <cstdio>               // snprintf()
+#include <deque>
+#include <fstream>
 #include <iostream>
+#include <iterator>             // istreambuf_iterator
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
 #include <stdexcept>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+#include <curl/curl.h>
 #include <curlxx/curl.hpp>
 
 #include "rest.hpp"
 
-#include "byte_stream.hpp"
+#include "curl_share.hpp"
+#include "metrics.hpp"
+#include "net/connector.hpp"
+#include "scheduler.hpp"
 #include "tracer.hpp"
 
 
@@ -32,6 +47,61 @@ using namespace std::literals;
 
 namespace rest {
 
+    namespace {
+
+        constexpr mime_type::pattern json_mime{"application/json"};
+
+
+        // "https://host/json/stations/search?..." -> "/json/stations/search"
+        // Stops at the first segment with a digit (UUIDs, IDs), and after three segments
+        // (tags, names), so the number of histograms stays small.
+        std::string
+        get_endpoint(std::string_view url)
+        {
+            if (auto scheme = url.find("://"); scheme != std::string_view::npos)
+                url.remove_prefix(scheme + 3);
+            url = url.substr(0, url.find_first_of("?#"));
+            auto slash = url.find('/');
+            if (slash == std::string_view::npos)
+                return "/";
+            url.remove_prefix(slash + 1);
+
+            std::string result;
+            for (unsigned depth = 0; depth < 3 && !url.empty(); ++depth) {
+                auto segment = url.substr(0, url.find('/'));
+                if (segment.find_first_of("0123456789") != std::string_view::npos)
+                    break;
+                result += '/';
+                result += segment;
+                url.remove_prefix(std::min(url.size(), segment.size() + 1));
+            }
+            return result.empty() ? "/" : result;
+        }
+
+
+        void
+        record_latency(curl::easy& easy,
+                       bool failed)
+        {
+            if (failed) {
+                static auto& errors = metrics::get_counter("rest/errors");
+                errors.add();
+                return;
+            }
+            const char* url = nullptr;
+            curl_off_t total_us = 0;
+            if (curl_easy_getinfo(easy.data(), CURLINFO_EFFECTIVE_URL, &url) || !url)
+                return;
+            if (curl_easy_getinfo(easy.data(), CURLINFO_TOTAL_TIME_T, &total_us))
+                return;
+            auto& hist = metrics::get_histogram("rest/latency_ms " + get_endpoint(url),
+                                                metrics::latency_ms_buckets);
+            hist.record(total_us / 1000.0);
+        }
+
+    } // namespace
+
+
     /* --------------------- */
     /* function declarations */
     /* --------------------- */
@@ -39,11 +109,19 @@ namespace rest {
     curl::easy
     make_easy(const std::string& url);
 
+    std::size_t
+    append_response(curl::easy& easy,
+                    std::string& body,
+                    std::span<const char> data);
+
     std::string
     make_url(const std::string& base_url,
              const get_params_t& params);
 
 
+    struct flight;
+
+
     /* -------------- */
     /* struct request */
     /* -------------- */
@@ -54,7 +132,20 @@ namespace rest {
         curl::easy easy;
         success_function_t success_func;
         error_function_t error_func;
-        byte_stream response_stream;
+        // Note: contiguous, so finish() can hand it over without copying.
+        std::string response_body;
+
+        priority prio = priority::interactive;
+        std::optional<clock::time_point> deadline;
+        clock::time_point queued_at;
+
+        // Set when this request doesn't transfer anything, it only subscribes to a flight.
+        bool coalesced = false;
+        std::weak_ptr<flight> shared_flight;
+
+        // Called from the write function, with the body received so far.
+        std::move_only_function<void (std::string_view partial,
+                                      const std::string& content_type)> progress_func;
 
         // forbid moving
         request_base(request_base&& other) = delete;
@@ -88,6 +179,20 @@ namespace rest {
         handle_error(const std::exception& e)
             noexcept;
 
+        // Only subscribers that asked for progress do something here.
+        virtual
+        void
+        handle_progress(std::string_view partial,
+                        const std::string& content_type)
+            noexcept;
+
+        // Called once the request landed, so whatever the callbacks captured is released,
+        // even if a token still holds the request.
+        virtual
+        void
+        release_callbacks()
+            noexcept;
+
     }; // struct request
 
 
@@ -113,45 +218,190 @@ namespace rest {
 
     struct json_request_base : virtual request_base {
         json_success_function_t json_success_func;
+        json_progress_function_t json_progress_func;
 
-        json_request_base(json_success_function_t json_success_func);
+        json_request_base(json_success_function_t json_success_func,
+                          json_progress_function_t json_progress_func = {});
 
         void
         handle_success(const std::string& response,
                        const std::string& content_type)
             noexcept override;
 
+        void
+        handle_progress(std::string_view partial,
+                        const std::string& content_type)
+            noexcept override;
+
+        void
+        release_callbacks()
+            noexcept override;
+
     }; // struct json_request
 
 
+    // A GET that is never coalesced, for sharing::exclusive.
     struct json_request_get : request_get, json_request_base {
 
         json_request_get(const std::string& url,
-                         const get_params_t& params,
                          json_success_function_t json_success_func,
                          error_function_t error_func);
 
     }; // struct json_request_get
 
 
+    // A POST that is never coalesced, for sharing::exclusive.
     struct json_request_post : request_post, json_request_base {
 
         json_request_post(const std::string& url,
                           const std::string& body,
                           json_success_function_t json_success_func,
-                          error_function_t error_func);
+                          error_function_t error_func,
+                          json_progress_function_t json_progress_func);
 
     }; // struct json_request_post
 
 
+    // What's stored on disk for a cached response.
+    struct stored_response {
+        std::string body;
+        std::string etag;
+        std::string last_modified;
+    };
+
+
+    // Conditional GET, that revalidates a response stored on disk.
+    struct cached_json_request_get : request_get {
+
+        std::string cache_key;
+        std::filesystem::path body_path;
+        std::filesystem::path meta_path;
+        std::string cached_body;
+        json_success_function_t json_success_func;
+
+        cached_json_request_get(const std::string& cache_key,
+                                const std::string& url,
+                                const get_params_t& params,
+                                json_success_function_t json_success_func,
+                                error_function_t error_func);
+
+        // Called on the main thread, once the stored response was read; delivers it, and
+        // sets up the revalidation.
+        void
+        start(stored_response stored);
+
+        void
+        handle_success(const std::string& response,
+                       const std::string& content_type)
+            noexcept override;
+
+        void
+        release_callbacks()
+            noexcept override;
+
+    }; // struct cached_json_request_get
+
+
+    /* ------------- */
+    /* struct flight */
+    /* ------------- */
+
+    /*
+     * Identical requests made while one is in progress share its transfer; the result is
+     * delivered to every subscriber that wasn't canceled.
+     */
+    struct flight {
+
+        std::string key;
+        std::weak_ptr<request_base> transfer;
+        std::vector<std::shared_ptr<request_base>> subscribers;
+
+        void
+        deliver(const std::string& response,
+                const std::string& content_type)
+            noexcept;
+
+        void
+        fail(const std::exception& e)
+            noexcept;
+
+        void
+        progress(std::string_view partial,
+                 const std::string& content_type)
+            noexcept;
+
+        // Detach from the resources, so new requests start a new flight.
+        std::vector<std::shared_ptr<request_base>>
+        land()
+            noexcept;
+
+        priority
+        priority_class()
+            const noexcept;
+
+    }; // struct flight
+
+
+    struct json_subscriber : json_request_base {
+
+        json_subscriber(json_success_function_t json_success_func,
+                        error_function_t error_func,
+                        json_progress_function_t json_progress_func = {});
+
+    }; // struct json_subscriber
+
+
     /* ---------------- */
     /* struct resources */
     /* ---------------- */
 
+    /* ------------------ */
+    /* struct timer_wheel */
+    /* ------------------ */
+
+    /*
+     * Hashed timer wheel for request deadlines.
+     *
+     * Deadlines further than one revolution stay in their slot, and are checked again on
+     * the next pass. Entries are never removed early; stale ones are skipped on expiry.
+     */
+    struct timer_wheel {
+
+        static constexpr clock::duration tick = 250ms;
+        static constexpr std::size_t num_slots = 256;
+
+        struct entry {
+            clock::time_point when;
+            std::weak_ptr<request_base> req;
+        };
+
+        std::array<std::vector<entry>, num_slots> slots;
+        std::size_t cursor = 0;
+        clock::time_point cursor_time = clock::now();
+
+
+        void
+        insert(clock::time_point when,
+               std::weak_ptr<request_base> req);
+
+        // Remove and return the requests whose deadline is not after now.
+        std::vector<std::shared_ptr<request_base>>
+        expire(clock::time_point now);
+
+    }; // struct timer_wheel
+
+
     struct resources {
 
+        static constexpr std::size_t num_priorities = 3;
+
         curl::multi multi;
+        // Requests that were added to multi, and are transferring.
         std::map<CURL*, std::shared_ptr<request_base>> requests;
+        std::map<std::string, std::shared_ptr<flight>> flights;
+        std::array<std::deque<std::shared_ptr<request_base>>, num_priorities> queues;
+        std::array<unsigned, num_priorities> running = {};
+        timer_wheel deadlines;
 
         resources();
 
@@ -164,7 +414,37 @@ namespace rest {
         void
         remove(std::shared_ptr<request_base>& req);
 
+        // Join the flight for key, or start one with make_transfer().
+        token
+        subscribe(const std::string& key,
+                  std::shared_ptr<request_base> sub,
+                  const std::function<std::shared_ptr<request_base>()>& make_transfer,
+                  priority prio);
+
+        // Start the queued requests that fit the concurrency limits.
+        void
+        start_queued();
+
         void
+        cancel_queued(priority prio);
+
+        void
+        set_deadline(std::shared_ptr<request_base>& req,
+                     clock::time_point when);
+
+        // Returns true if any request expired.
+        bool
+        expire_deadlines();
+
+        void
+        unsubscribe(std::shared_ptr<request_base>& sub);
+
+        bool
+        is_busy()
+            const noexcept;
+
+        // Returns true if any request completed.
+        bool
         process();
 
     }; // struct resources
@@ -177,6 +457,30 @@ namespace rest {
     std::string user_agent;
     std::optional<resources> res;
     unsigned init_counter;
+    std::filesystem::path cache_dir;
+    // Cache files are read and written on workers; only touched from the main thread.
+    std::vector<scheduler::task> cache_tasks;
+
+    // Every request fails after this long, unless it sets its own deadline.
+    const std::array<clock::duration, resources::num_priorities> default_timeouts = {
+        20s, // interactive
+        30s, // prefetch
+        60s, // background
+    };
+
+    // Abort transfers slower than low_speed_limit bytes/s, for low_speed_time seconds.
+    const long low_speed_limit = 64;
+    const long low_speed_time = 15;
+
+    // How many requests of each priority can transfer at the same time.
+    const std::array<unsigned, resources::num_priorities> concurrency_limits = {
+        3, // interactive
+        1, // prefetch
+        1, // background
+    };
+
+    // A background request that waited this long starts, even if interactive ones run.
+    const clock::duration max_background_wait = 5s;
 
 
     /* ------------- */
@@ -211,8 +515,20 @@ namespace rest {
         easy.set_write_function(
             [this](std::span<const char> data)
             {
-                return response_stream.write(data);
+                const std::size_t size = append_response(easy, response_body, data);
+                if (progress_func) {
+                    std::string content_type;
+                    if (auto h = easy.try_get_header("Content-Type"))
+                        content_type = h->value;
+                    progress_func(response_body, content_type);
+                }
+                return size;
             });
+        curl_easy_setopt(easy.data(), CURLOPT_LOW_SPEED_LIMIT, low_speed_limit);
+        curl_easy_setopt(easy.data(), CURLOPT_LOW_SPEED_TIME, low_speed_time);
+        curl_easy_setopt(easy.data(), CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS,
+                         static_cast<long>(net::default_connection_stagger.count()));
+        curl_share::attach(easy);
     }
 
 
@@ -232,7 +548,7 @@ namespace rest {
         std::string content_type;
         try {
             current_status = status::finished;
-            response = response_stream.read_str();
+            response = std::move(response_body);
             if (auto h = easy.try_get_header("Content-Type"))
                 content_type = h->value;
             handle_success(response, content_type);
@@ -281,6 +597,23 @@ namespace rest {
     }
 
 
+    void
+    request_base::handle_progress(std::string_view,
+                                  const std::string&)
+        noexcept
+    {}
+
+
+    void
+    request_base::release_callbacks()
+        noexcept
+    {
+        success_func = {};
+        error_func = {};
+        progress_func = {};
+    }
+
+
     /* ------------------- */
     /* request_get methods */
     /* ------------------- */
@@ -315,9 +648,11 @@ namespace rest {
     /* json_request_base methods */
     /* ------------------------- */
 
-    json_request_base::json_request_base(json_success_function_t json_success_func) :
+    json_request_base::json_request_base(json_success_function_t json_success_func,
+                                         json_progress_function_t json_progress_func) :
         request_base{},
-        json_success_func{std::move(json_success_func)}
+        json_success_func{std::move(json_success_func)},
+        json_progress_func{std::move(json_progress_func)}
     {
         easy.set_http_headers("Accept: application/json");
     }
@@ -328,7 +663,7 @@ namespace rest {
                                       const std::string& content_type)
         noexcept
     try {
-        if (!mime_type::match(content_type, "application/json")) {
+        if (!json_mime.matches(content_type)) {
             handle_error(error{
                     "invalid content type",
                     response,
@@ -347,18 +682,48 @@ namespace rest {
     }
 
 
-    /*--------------------------*/
+    void
+    json_request_base::handle_progress(std::string_view partial,
+                                       const std::string& content_type)
+        noexcept
+    try {
+        if (json_progress_func && json_mime.matches(content_type))
+            json_progress_func(partial);
+    }
+    catch (std::exception& e) {
+        // Note: the whole response still goes to handle_success(), which reports errors.
+        cout << "WARNING: progress function failed: " << e.what() << endl;
+        json_progress_func = {};
+    }
+    catch (...) {
+        cout << "WARNING: progress function failed" << endl;
+        json_progress_func = {};
+    }
+
+
+    void
+    json_request_base::release_callbacks()
+        noexcept
+    {
+        request_base::release_callbacks();
+        json_success_func = {};
+        json_progress_func = {};
+    }
+
+
+    /* ------------------------ */
     /* json_request_get methods */
-    /*--------------------------*/
+    /* ------------------------ */
 
-    json_request_get::json_request_get(const std::string& base_url,
-                                       const get_params_t& params,
+    json_request_get::json_request_get(const std::string& url,
                                        json_success_function_t json_success_func,
                                        error_function_t error_func) :
         request_base{{}, std::move(error_func)},
-        request_get{base_url, params},
+        request_get{url, {}},
         json_request_base{std::move(json_success_func)}
-    {}
+    {
+        easy.set_http_headers("Accept: application/json");
+    }
 
 
     /* ------------------------- */
@@ -368,16 +733,341 @@ namespace rest {
     json_request_post::json_request_post(const std::string& url,
                                          const std::string& body,
                                          json_success_function_t json_success_func,
-                                         error_function_t error_func) :
+                                         error_function_t error_func,
+                                         json_progress_function_t json_progress_func) :
         request_base{{}, std::move(error_func)},
         request_post{url, body},
-        json_request_base{std::move(json_success_func)}
+        json_request_base{std::move(json_success_func), std::move(json_progress_func)}
+    {
+        easy.set_http_headers("Accept: application/json",
+                              "Content-Type: application/json");
+        // Note: without a flight in between, the transfer reports its own progress.
+        if (this->json_progress_func)
+            progress_func = [this](std::string_view partial,
+                                   const std::string& content_type)
+            {
+                handle_progress(partial, content_type);
+            };
+    }
+
+
+    /* ------------------------------- */
+    /* cached_json_request_get methods */
+    /* ------------------------------- */
+
+    namespace {
+
+        // FNV-1a; unlike std::hash, it's stable across runs.
+        std::string
+        cache_file_name(const std::string& key)
+        {
+            std::uint64_t h = 0xcbf29ce484222325u;
+            for (unsigned char c : key) {
+                h ^= c;
+                h *= 0x100000001b3u;
+            }
+            char buf[17];
+            std::snprintf(buf, sizeof buf, "%016llx", static_cast<unsigned long long>(h));
+            return buf;
+        }
+
+
+        std::string
+        read_file(const std::filesystem::path& filename)
+        {
+            std::ifstream input{filename, std::ios::binary};
+            if (!input)
+                return {};
+            return std::string{std::istreambuf_iterator<char>{input}, {}};
+        }
+
+
+        // meta file has the ETag on the first line, Last-Modified on the second
+        stored_response
+        read_stored_response(const std::filesystem::path& body_path,
+                             const std::filesystem::path& meta_path)
+        {
+            stored_response result;
+            result.body = read_file(body_path);
+            if (result.body.empty())
+                return result;
+            std::ifstream meta{meta_path};
+            std::getline(meta, result.etag);
+            std::getline(meta, result.last_modified);
+            return result;
+        }
+
+
+        void
+        write_stored_response(const std::filesystem::path& body_path,
+                              const std::filesystem::path& meta_path,
+                              const stored_response& stored)
+        {
+            // Note: two writes to the same files must not interleave.
+            static std::mutex write_mutex;
+            std::lock_guard guard{write_mutex};
+            // Note: truncate the old validators first, so they never go with a new body.
+            {
+                std::ofstream meta{meta_path};
+            }
+            {
+                std::ofstream body{body_path, std::ios::binary};
+                body << stored.body;
+            }
+            {
+                std::ofstream meta{meta_path};
+                meta << stored.etag << '\n';
+                meta << stored.last_modified << '\n';
+            }
+        }
+
+
+        // Called on the main thread.
+        void
+        submit_cache_task(scheduler::task_function_t func)
+        {
+            std::erase_if(cache_tasks, [](const scheduler::task& t) { return t.done(); });
+            cache_tasks.push_back(scheduler::submit(scheduler::category::misc,
+                                                    std::move(func)));
+        }
+
+    } // namespace
+
+
+    cached_json_request_get::cached_json_request_get(const std::string& cache_key,
+                                                     const std::string& url,
+                                                     const get_params_t& params,
+                                                     json_success_function_t json_success_func,
+                                                     error_function_t error_func) :
+        request_base{{}, std::move(error_func)},
+        request_get{url, params},
+        cache_key{cache_key},
+        body_path{cache_dir / (cache_file_name(cache_key) + ".json")},
+        meta_path{cache_dir / (cache_file_name(cache_key) + ".meta")},
+        json_success_func{std::move(json_success_func)}
+    {
+        easy.set_http_headers("Accept: application/json");
+    }
+
+
+    void
+    cached_json_request_get::start(stored_response stored)
+    {
+        cached_body = std::move(stored.body);
+        if (!cached_body.empty()) {
+            try {
+                if (json_success_func)
+                    json_success_func(cached_body);
+                // The cached response was good, so revalidation errors are not reported.
+                error_func = [key = cache_key](const std::exception& e)
+                {
+                    cout << "WARNING: could not revalidate \"" << key << "\": "
+                         << e.what() << endl;
+                };
+            }
+            catch (std::exception& e) {
+                cout << "ERROR: bad cached response for \"" << cache_key << "\": "
+                     << e.what() << endl;
+            }
+            if (!stored.etag.empty())
+                easy.append_http_header("If-None-Match: " + stored.etag);
+            if (!stored.last_modified.empty())
+                easy.append_http_header("If-Modified-Since: " + stored.last_modified);
+        }
+    }
+
+
+    void
+    cached_json_request_get::handle_success(const std::string& response,
+                                            const std::string& content_type)
+        noexcept
+    try {
+        long code = 0;
+        curl_easy_getinfo(easy.data(), CURLINFO_RESPONSE_CODE, &code);
+        if (code == 304)
+            return; // cached copy is still valid
+
+        if (!json_mime.matches(content_type)) {
+            handle_error(error{
+                    "invalid content type",
+                    response,
+                    content_type
+                });
+            return;
+        }
+
+        if (response == cached_body)
+            return;
+
+        stored_response stored;
+        stored.body = response;
+        if (auto h = easy.try_get_header("ETag"))
+            stored.etag = h->value;
+        if (auto h = easy.try_get_header("Last-Modified"))
+            stored.last_modified = h->value;
+        submit_cache_task([body_path = body_path,
+                           meta_path = meta_path,
+                           stored = std::move(stored)](std::stop_token)
+        {
+            try {
+                write_stored_response(body_path, meta_path, stored);
+            }
+            catch (std::exception& e) {
+                cout << "WARNING: could not store cached response: " << e.what() << endl;
+            }
+        });
+
+        if (json_success_func)
+            json_success_func(response);
+    }
+    catch (std::exception& e) {
+        handle_error(error{e.what(), response, content_type});
+    }
+    catch (...) {
+        handle_error(error{"unknown exception", response, content_type});
+    }
+
+
+    void
+    cached_json_request_get::release_callbacks()
+        noexcept
+    {
+        request_base::release_callbacks();
+        json_success_func = {};
+    }
+
+
+    /* ----------------------- */
+    /* json_subscriber methods */
+    /* ----------------------- */
+
+    json_subscriber::json_subscriber(json_success_function_t json_success_func,
+                                     error_function_t error_func,
+                                     json_progress_function_t json_progress_func) :
+        request_base{{}, std::move(error_func)},
+        json_request_base{std::move(json_success_func), std::move(json_progress_func)}
+    {
+        coalesced = true;
+    }
+
+
+    /* -------------- */
+    /* flight methods */
+    /* -------------- */
+
+    std::vector<std::shared_ptr<request_base>>
+    flight::land()
+        noexcept
     {
-        cout << "DEBUG: making json post request\n"
-             << "    URL: " << url << "\n"
-             << "    body: " << body
-             << endl;
-        easy.append_http_header("Content-Type: application/json");
+        // Note: this may be the last reference to the flight, but the transfer's callbacks
+        // still hold one.
+        auto it = res->flights.find(key);
+        if (it != res->flights.end() && it->second.get() == this)
+            res->flights.erase(it);
+        return std::move(subscribers);
+    }
+
+
+    priority
+    flight::priority_class()
+        const noexcept
+    {
+        if (auto t = transfer.lock())
+            return t->prio;
+        return priority::background;
+    }
+
+
+    void
+    flight::deliver(const std::string& response,
+                    const std::string& content_type)
+        noexcept
+    {
+        for (auto& sub : land()) {
+            if (sub->current_status != status::pending)
+                continue;
+            sub->current_status = status::finished;
+            sub->handle_success(response, content_type);
+            sub->release_callbacks();
+        }
+    }
+
+
+    void
+    flight::fail(const std::exception& e)
+        noexcept
+    {
+        for (auto& sub : land()) {
+            if (sub->current_status != status::pending)
+                continue;
+            sub->current_status = status::finished;
+            sub->handle_error(e);
+            sub->release_callbacks();
+        }
+    }
+
+
+    void
+    flight::progress(std::string_view partial,
+                     const std::string& content_type)
+        noexcept
+    {
+        for (auto& sub : subscribers)
+            if (sub->current_status == status::pending)
+                sub->handle_progress(partial, content_type);
+    }
+
+
+    /* -------------------- */
+    /* timer_wheel methods */
+    /* -------------------- */
+
+    void
+    timer_wheel::insert(clock::time_point when,
+                        std::weak_ptr<request_base> req)
+    {
+        std::size_t ticks = 1;
+        if (when > cursor_time)
+            ticks = std::max<std::size_t>(1, (when - cursor_time + tick - clock::duration{1}) / tick);
+        const std::size_t slot = (cursor + ticks) % num_slots;
+        slots[slot].emplace_back(when, std::move(req));
+    }
+
+
+    std::vector<std::shared_ptr<request_base>>
+    timer_wheel::expire(clock::time_point now)
+    {
+        std::vector<std::shared_ptr<request_base>> result;
+
+        auto check_slot = [&result, now](std::vector<entry>& slot)
+        {
+            std::erase_if(slot,
+                          [&result, now](const entry& e)
+                          {
+                              auto req = e.req.lock();
+                              if (!req)
+                                  return true;
+                              if (e.when > now)
+                                  return false;
+                              result.push_back(std::move(req));
+                              return true;
+                          });
+        };
+
+        if (now - cursor_time >= tick * num_slots) {
+            // Note: after a long stall, don't spin around the wheel many times.
+            for (auto& slot : slots)
+                check_slot(slot);
+            cursor_time = now;
+            return result;
+        }
+
+        while (now - cursor_time >= tick) {
+            cursor = (cursor + 1) % num_slots;
+            cursor_time += tick;
+            check_slot(slots[cursor]);
+        }
+        return result;
     }
 
 
@@ -389,6 +1079,9 @@ namespace rest {
     {
         multi.set_max_total_connections(5);
         multi.set_max_connections(5);
+        // Note: the limits above only matter for HTTP/1.1 mirrors; with HTTP/2, all
+        // requests go through a single connection.
+        curl_multi_setopt(multi.data(), CURLMOPT_PIPELINING, long{CURLPIPE_MULTIPLEX});
     }
 
 
@@ -405,8 +1098,12 @@ namespace rest {
     resources::add(std::shared_ptr<request_base> req)
     {
         assert(req);
-        multi.add(req->easy);
-        requests.emplace(req->get_id(), std::move(req));
+        if (!req->deadline)
+            set_deadline(req,
+                         clock::now() + default_timeouts[static_cast<unsigned>(req->prio)]);
+        req->queued_at = clock::now();
+        queues[static_cast<unsigned>(req->prio)].push_back(std::move(req));
+        start_queued();
     }
 
 
@@ -414,29 +1111,193 @@ namespace rest {
     resources::remove(std::shared_ptr<request_base>& req)
     {
         assert(req);
-        multi.remove(req->easy);
-        requests.erase(req->get_id());
+        const unsigned p = static_cast<unsigned>(req->prio);
+        if (requests.erase(req->get_id())) {
+            multi.remove(req->easy);
+            --running[p];
+        } else
+            std::erase(queues[p], req);
     }
 
 
     void
+    resources::start_queued()
+    {
+        const unsigned interactive = static_cast<unsigned>(priority::interactive);
+        const unsigned background = static_cast<unsigned>(priority::background);
+        for (unsigned p = 0; p < num_priorities; ++p) {
+            auto& queue = queues[p];
+            while (!queue.empty() && running[p] < concurrency_limits[p]) {
+                // Note: fire-and-forget requests should not delay interactive ones, but
+                // they must not starve either, or they just expire in the queue.
+                if (p == background
+                    && (running[interactive] || !queues[interactive].empty())
+                    && clock::now() - queue.front()->queued_at < max_background_wait)
+                    break;
+                auto req = std::move(queue.front());
+                queue.pop_front();
+                multi.add(req->easy);
+                ++running[p];
+                requests.emplace(req->get_id(), std::move(req));
+            }
+        }
+    }
+
+
+    void
+    resources::cancel_queued(priority prio)
+    {
+        auto queue = std::move(queues[static_cast<unsigned>(prio)]);
+        queues[static_cast<unsigned>(prio)].clear();
+        for (auto& req : queue) {
+            req->current_status = status::canceled;
+            req->handle_error(canceled_error{"canceled before starting"});
+            req->release_callbacks();
+        }
+    }
+
+
+    void
+    resources::set_deadline(std::shared_ptr<request_base>& req,
+                            clock::time_point when)
+    {
+        assert(req);
+        req->deadline = when;
+        deadlines.insert(when, req);
+    }
+
+
+    bool
+    resources::expire_deadlines()
+    {
+        bool expired = false;
+        for (auto& req : deadlines.expire(clock::now())) {
+            if (req->current_status != status::pending)
+                continue;
+            // Note: the deadline may have been moved since this entry was inserted.
+            if (!req->deadline || *req->deadline > clock::now())
+                continue;
+            req->current_status = status::finished;
+            if (req->coalesced)
+                unsubscribe(req);
+            else
+                remove(req);
+            req->handle_error(timeout_error{"deadline exceeded"});
+            req->release_callbacks();
+            expired = true;
+        }
+        return expired;
+    }
+
+
+    token
+    resources::subscribe(const std::string& key,
+                         std::shared_ptr<request_base> sub,
+                         const std::function<std::shared_ptr<request_base>()>& make_transfer,
+                         priority prio)
+    {
+        assert(sub);
+        std::shared_ptr<flight> fl;
+        if (auto it = flights.find(key); it != flights.end())
+            fl = it->second;
+
+        if (fl && prio < fl->priority_class()) {
+            // A more urgent subscriber; if the transfer is still queued, move it up.
+            if (auto transfer = fl->transfer.lock();
+                transfer && !requests.contains(transfer->get_id())) {
+                std::erase(queues[static_cast<unsigned>(transfer->prio)], transfer);
+                transfer->prio = prio;
+                add(std::move(transfer));
+            }
+        }
+
+        if (!fl) {
+            fl = std::make_shared<flight>();
+            fl->key = key;
+            auto transfer = make_transfer();
+            transfer->prio = prio;
+            transfer->success_func = [fl](const std::string& response,
+                                          const std::string& content_type)
+            {
+                fl->deliver(response, content_type);
+            };
+            transfer->error_func = [fl](const std::exception& e)
+            {
+                fl->fail(e);
+            };
+            transfer->progress_func = [fl](std::string_view partial,
+                                           const std::string& content_type)
+            {
+                fl->progress(partial, content_type);
+            };
+            fl->transfer = transfer;
+            add(std::move(transfer));
+            flights[key] = fl;
+        }
+        sub->coalesced = true;
+        sub->shared_flight = fl;
+        fl->subscribers.push_back(sub);
+        return token{std::move(sub)};
+    }
+
+
+    void
+    resources::unsubscribe(std::shared_ptr<request_base>& sub)
+    {
+        assert(sub);
+        auto fl = sub->shared_flight.lock();
+        if (!fl)
+            return;
+        std::erase(fl->subscribers, sub);
+        if (!fl->subscribers.empty())
+            return;
+
+        // Nobody is waiting for this transfer anymore.
+        if (auto transfer = fl->transfer.lock()) {
+            transfer->current_status = status::canceled;
+            remove(transfer);
+            transfer->release_callbacks();
+        }
+        fl->land();
+    }
+
+
+    bool
+    resources::is_busy()
+        const noexcept
+    {
+        if (!requests.empty())
+            return true;
+        return std::ranges::any_of(queues, [](const auto& q) { return !q.empty(); });
+    }
+
+
+    bool
     resources::process()
     {
+        bool completed = false;
         multi.perform();
         for (auto& [easy, err] : multi.get_done()) {
             auto id = easy->data();
             auto it = requests.find(id);
-            if (it == requests.end()) {
-                cout << "BUG: finished an unknown handle!" << endl;
+            if (it == requests.end())
+                // Note: it may have been canceled by a callback, earlier in this loop.
                 continue;
-            }
             auto req = std::move(it->second);
             remove(req);
+            curl_share::record(*easy);
+            record_latency(*easy, err);
             if (err)
                 req->handle_error(curl::error{err});
             else
                 req->finish();
+            req->release_callbacks();
+            completed = true;
         }
+        if (expire_deadlines())
+            completed = true;
+        start_queued();
+        return completed;
     }
 
 
@@ -472,11 +1333,23 @@ namespace rest {
     {
         if (req && req->current_status != status::finished) {
             req->current_status = status::canceled;
-            res->remove(req);
+            if (req->coalesced)
+                res->unsubscribe(req);
+            else
+                res->remove(req);
+            req->release_callbacks();
         }
     }
 
 
+    void
+    token::set_deadline(clock::duration timeout)
+    {
+        if (req && req->current_status == status::pending)
+            res->set_deadline(req, clock::now() + timeout);
+    }
+
+
     void
     token::detach()
         noexcept
@@ -521,15 +1394,31 @@ namespace rest {
         if (--init_counter)
             return;
 
+        cache_tasks.clear();
         res.reset();
     }
 
 
-    void
+    bool
     process()
     {
         assert(res);
-        res->process();
+        return res->process();
+    }
+
+
+    bool
+    is_busy()
+    {
+        return res && res->is_busy();
+    }
+
+
+    void
+    cancel_queued(priority prio)
+    {
+        assert(res);
+        res->cancel_queued(prio);
     }
 
 
@@ -537,14 +1426,19 @@ namespace rest {
     get_async(const std::string& base_url,
               const get_params_t& params,
               success_function_t success_func,
-              error_function_t error_func)
+              error_function_t error_func,
+              priority prio)
     {
-        auto req = std::make_shared<request_get>(base_url,
-                                                 params,
-                                                 std::move(success_func),
-                                                 std::move(error_func));
-        res->add(req);
-        return token{std::move(req)};
+        const std::string url = make_url(base_url, params);
+        auto sub = std::make_shared<request_base>(std::move(success_func),
+                                                  std::move(error_func));
+        return res->subscribe("GET " + url,
+                              std::move(sub),
+                              [&url]
+                              {
+                                  return std::make_shared<request_get>(url, get_params_t{});
+                              },
+                              prio);
     }
 
 
@@ -552,12 +1446,14 @@ namespace rest {
     post_async(const std::string& url,
                const std::string& body,
                success_function_t success_func,
-               error_function_t error_func)
+               error_function_t error_func,
+               priority prio)
     {
         auto req = std::make_shared<request_post>(url,
                                                   body,
                                                   std::move(success_func),
                                                   std::move(error_func));
+        req->prio = prio;
         res->add(req);
         return token{std::move(req)};
     }
@@ -569,14 +1465,14 @@ namespace rest {
     {
         std::string url = make_url(base_url, params);
         curl::easy easy = make_easy(url);
-        byte_stream response_stream;
+        std::string response;
         easy.set_write_function(
-            [&response_stream](std::span<const char> buf)
+            [&easy, &response](std::span<const char> buf)
             {
-                return response_stream.write(buf);
+                return append_response(easy, response, buf);
             });
         easy.perform();
-        std::string response = response_stream.read_str();
+        curl_share::record(easy);
         std::string content_type;
         if (auto h = easy.try_get_header("Content-Type"))
             content_type = h->value;
@@ -592,14 +1488,14 @@ namespace rest {
         easy.set_post(true);
         easy.set_copy_post_fields(body);
 
-        byte_stream response_stream;
+        std::string response;
         easy.set_write_function(
-            [&response_stream](std::span<const char> buf)
+            [&easy, &response](std::span<const char> buf)
             {
-                return response_stream.write(buf);
+                return append_response(easy, response, buf);
             });
         easy.perform();
-        std::string response = response_stream.read_str();
+        curl_share::record(easy);
         std::string content_type;
         if (auto h = easy.try_get_header("Content-Type"))
             content_type = h->value;
@@ -611,14 +1507,32 @@ namespace rest {
     get_json_async(const std::string& base_url,
                    const get_params_t& params,
                    json_success_function_t json_success_func,
-                   error_function_t error_func)
+                   error_function_t error_func,
+                   priority prio,
+                   sharing share)
     {
-        auto req = std::make_shared<json_request_get>(base_url,
-                                                      params,
-                                                      std::move(json_success_func),
-                                                      std::move(error_func));
-        res->add(req);
-        return token{std::move(req)};
+        const std::string url = make_url(base_url, params);
+        if (share == sharing::exclusive) {
+            auto req = std::make_shared<json_request_get>(url,
+                                                          std::move(json_success_func),
+                                                          std::move(error_func));
+            req->prio = prio;
+            res->add(req);
+            return token{std::move(req)};
+        }
+
+        auto sub = std::make_shared<json_subscriber>(std::move(json_success_func),
+                                                     std::move(error_func));
+        return res->subscribe("GET json " + url,
+                              std::move(sub),
+                              [&url]
+                              {
+                                  auto req = std::make_shared<request_get>(url,
+                                                                           get_params_t{});
+                                  req->easy.set_http_headers("Accept: application/json");
+                                  return req;
+                              },
+                              prio);
     }
 
 
@@ -626,17 +1540,95 @@ namespace rest {
     post_json_async(const std::string& url,
                     const std::string& body,
                     json_success_function_t success_func,
-                    error_function_t error_func)
+                    error_function_t error_func,
+                    priority prio,
+                    json_progress_function_t progress_func,
+                    sharing share)
     {
-        auto req = std::make_shared<json_request_post>(url,
-                                                       body,
-                                                       std::move(success_func),
-                                                       std::move(error_func));
-        res->add(req);
+        if (share == sharing::exclusive) {
+            auto req = std::make_shared<json_request_post>(url,
+                                                           body,
+                                                           std::move(success_func),
+                                                           std::move(error_func),
+                                                           std::move(progress_func));
+            req->prio = prio;
+            res->add(req);
+            return token{std::move(req)};
+        }
+
+        auto sub = std::make_shared<json_subscriber>(std::move(success_func),
+                                                     std::move(error_func),
+                                                     std::move(progress_func));
+        return res->subscribe("POST json " + url + "\n" + body,
+                              std::move(sub),
+                              [&url, &body]
+                              {
+                                  auto req = std::make_shared<request_post>(url, body);
+                                  req->easy.set_http_headers("Accept: application/json",
+                                                             "Content-Type: application/json");
+                                  return req;
+                              },
+                              prio);
+    }
+
+
+    token
+    get_json_cached_async(const std::string& cache_key,
+                          const std::string& base_url,
+                          const get_params_t& params,
+                          json_success_function_t success_func,
+                          error_function_t error_func,
+                          priority prio)
+    {
+        if (cache_dir.empty())
+            return get_json_async(base_url,
+                                  params,
+                                  std::move(success_func),
+                                  std::move(error_func),
+                                  prio);
+
+        auto req = std::make_shared<cached_json_request_get>(cache_key,
+                                                             base_url,
+                                                             params,
+                                                             std::move(success_func),
+                                                             std::move(error_func));
+        req->prio = prio;
+        // Note: the stored response is read on a worker; the request is only sent once
+        // it's back on the main thread.
+        submit_cache_task([req](std::stop_token) mutable
+        {
+            stored_response stored;
+            try {
+                stored = read_stored_response(req->body_path, req->meta_path);
+            }
+            catch (std::exception& e) {
+                cout << "WARNING: could not read cached response: " << e.what() << endl;
+            }
+            scheduler::post_main(scheduler::category::misc,
+                                 [req = std::move(req),
+                                  stored = std::move(stored)] mutable
+                                 {
+                                     if (!res || req->current_status != status::pending)
+                                         return;
+                                     req->start(std::move(stored));
+                                     // Note: the success function may have canceled it.
+                                     if (req->current_status == status::pending)
+                                         res->add(std::move(req));
+                                 });
+        });
         return token{std::move(req)};
     }
 
 
+    void
+    set_cache_dir(const std::filesystem::path& dir)
+    {
+        cache_dir = dir;
+        if (!cache_dir.empty())
+            create_directories(cache_dir);
+    }
+
+
     std::string
     get_json_sync(const std::string& base_url,
                   const get_params_t& params)
@@ -644,16 +1636,16 @@ namespace rest {
         std::string url = make_url(base_url, params);
         curl::easy easy = make_easy(url);
         easy.set_http_headers("Accept: application/json");
-        byte_stream response_stream;
+        std::string response;
         easy.set_write_function(
-            [&response_stream](std::span<const char> buf)
+            [&easy, &response](std::span<const char> buf)
             {
-                return response_stream.write(buf);
+                return append_response(easy, response, buf);
             });
         easy.perform();
-        std::string response = response_stream.read_str();
+        curl_share::record(easy);
         std::string content_type = easy.get_header("Content-Type").value;
-        if (!mime_type::match(content_type, "application/json"))
+        if (!json_mime.matches(content_type))
             throw error{"Invalid content type", response, content_type};
         return response;
     }
@@ -670,25 +1662,110 @@ namespace rest {
         easy.set_post(true);
         easy.set_copy_post_fields(body);
 
-        byte_stream response_stream;
+        std::string response;
         easy.set_write_function(
-            [&response_stream](std::span<const char> buf)
+            [&easy, &response](std::span<const char> buf)
             {
-                return response_stream.write(buf);
+                return append_response(easy, response, buf);
             });
         easy.perform();
-        std::string response = response_stream.read_str();
+        curl_share::record(easy);
         std::string content_type = easy.get_header("Content-Type").value;
-        if (!mime_type::match(content_type, "application/json"))
+        if (!json_mime.matches(content_type))
             throw error{"Invalid content type", response, content_type};
         return response;
     }
 
 
+    /* ------------------- */
+    /* Coroutine functions */
+    /* ------------------- */
+
+    namespace co {
+
+        namespace {
+
+            // The token is held by the awaiter, so it can cancel the request.
+            coro::canceler_t
+            make_canceler(token tok)
+            {
+                return [tok = std::move(tok)] mutable { tok.cancel(); };
+            }
+
+        } // namespace
+
+
+        coro::task<std::string>
+        get_json(std::string base_url,
+                 get_params_t params,
+                 priority prio,
+                 sharing share)
+        {
+            co_return co_await coro::from_callbacks<std::string>(
+                [&](coro::resolve_t<std::string> resolve,
+                    coro::reject_t reject)
+                {
+                    return make_canceler(get_json_async(base_url,
+                                                        params,
+                                                        std::move(resolve),
+                                                        std::move(reject),
+                                                        prio,
+                                                        share));
+                });
+        }
+
+
+        coro::task<std::string>
+        post_json(std::string url,
+                  std::string body,
+                  priority prio,
+                  sharing share)
+        {
+            co_return co_await coro::from_callbacks<std::string>(
+                [&](coro::resolve_t<std::string> resolve,
+                    coro::reject_t reject)
+                {
+                    return make_canceler(post_json_async(url,
+                                                         body,
+                                                         std::move(resolve),
+                                                         std::move(reject),
+                                                         prio,
+                                                         {},
+                                                         share));
+                });
+        }
+
+    } // namespace co
+
+
     /* ---------------- */
     /* helper functions */
     /* ---------------- */
 
+    // Don't trust a Content-Length bigger than this.
+    const std::size_t max_reserve = 16 * 1024 * 1024;
+
+
+    std::size_t
+    append_response(curl::easy& easy,
+                    std::string& body,
+                    std::span<const char> data)
+    {
+        if (body.empty()) {
+            if (auto h = easy.try_get_header("Content-Length")) {
+                std::size_t length = 0;
+                const auto& value = h->value;
+                auto [ptr, ec] = std::from_chars(value.data(),
+                                                 value.data() + value.size(),
+                                                 length);
+                if (ec == std::errc{})
+                    body.reserve(std::min(length, max_reserve));
+            }
+        }
+        body.append(data.data(), data.size());
+        return data.size();
+    }
+
     curl::easy
     make_easy(const std::string& url)
     {
@@ -701,11 +1778,21 @@ namespace rest {
         easy.set_buffer_size(65536);
         easy.set_fail_on_error(true);
         easy.set_follow_location(true);
-        easy.set_http_version(curl::easy::http_version::none);
         easy.set_ssl_verify_peer(false);
         easy.set_tcp_no_delay(false);
         easy.set_transfer_encoding(true);
         easy.set_url(url);
+        // Note: HTTP/2 when the mirror offers it over TLS; this fails harmlessly if curl
+        // was built without it. Waiting for the connection that's being made lets the
+        // concurrent requests share it, instead of each one opening its own.
+        curl_easy_setopt(easy.data(), CURLOPT_HTTP_VERSION, long{CURL_HTTP_VERSION_2TLS});
+        curl_easy_setopt(easy.data(), CURLOPT_PIPEWAIT, 1L);
+        curl_easy_setopt(easy.data(), CURLOPT_LOW_SPEED_LIMIT, low_speed_limit);
+        curl_easy_setopt(easy.data(), CURLOPT_LOW_SPEED_TIME, low_speed_time);
+        // Note: the mirror checks go through here.
+        curl_easy_setopt(easy.data(), CURLOPT_HAPPY_EYEBALLS_TIMEOUT_MS,
+                         static_cast<long>(net::default_connection_stagger.count()));
+        curl_share::attach(easy);
         return easy;
     }
 
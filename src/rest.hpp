@@ -8,14 +8,18 @@
 #ifndef REST_HPP
 #define REST_HPP
 
+#include <chrono>
+#include <filesystem>
 #include <functional>
 #include <map>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 #include <curlxx/easy.hpp>
 
+#include "coro.hpp"
 #include "mime_type.hpp"
 
 
@@ -33,6 +37,22 @@ namespace rest {
     }; // struct error
 
 
+    // Reported to requests dropped by cancel_queued().
+    struct canceled_error : error {
+
+        using error::error;
+
+    }; // struct canceled_error
+
+
+    // Reported to requests that didn't finish before their deadline.
+    struct timeout_error : error {
+
+        using error::error;
+
+    }; // struct timeout_error
+
+
     using success_function_sig = void (const std::string& response,
                                        const std::string& content_type);
     using success_function_t = std::move_only_function<success_function_sig>;
@@ -44,6 +64,10 @@ namespace rest {
     using json_success_function_sig = void (const std::string& json_response);
     using json_success_function_t = std::move_only_function<json_success_function_sig>;
 
+    // Called with the response received so far, while it's still arriving.
+    using json_progress_function_sig = void (std::string_view partial_json);
+    using json_progress_function_t = std::move_only_function<json_progress_function_sig>;
+
 
     using get_params_t = std::map<std::string, std::string>;
 
@@ -58,6 +82,31 @@ namespace rest {
     }; // enum class status
 
 
+    /*
+     * Each class has its own concurrency limit; requests beyond it wait in a queue.
+     * Background requests also wait while any interactive request is pending, for up to
+     * a few seconds.
+     */
+    enum class priority {
+        interactive,
+        prefetch,
+        background,
+    }; // enum class priority
+
+
+    /*
+     * Identical JSON requests in flight normally share one transfer. Requests that change
+     * something on the server (clicks, votes) must be exclusive, so each one reaches it.
+     */
+    enum class sharing {
+        coalesce,
+        exclusive,
+    }; // enum class sharing
+
+
+    using clock = std::chrono::steady_clock;
+
+
     class token {
 
         std::shared_ptr<request_base> req;
@@ -82,6 +131,13 @@ namespace rest {
         void
         cancel();
 
+        /*
+         * Fail with timeout_error if not finished after this long, counting from now.
+         * Every request already gets a default deadline for its priority.
+         */
+        void
+        set_deadline(clock::duration timeout);
+
         void
         detach()
             noexcept;
@@ -101,10 +157,21 @@ namespace rest {
     finalize();
 
 
-    void
+    // Returns true if any request completed, so its callbacks were called.
+    bool
     process();
 
 
+    // True while there are requests transferring, or waiting to start.
+    bool
+    is_busy();
+
+
+    // Drop the requests of this class that didn't start yet; they fail with an error.
+    void
+    cancel_queued(priority prio);
+
+
     /* ----------------- */
     /* Untyped functions */
     /* ----------------- */
@@ -113,14 +180,16 @@ namespace rest {
     get_async(const std::string& base_url,
               const get_params_t& params,
               success_function_t success_func,
-              error_function_t error_func = {});
+              error_function_t error_func = {},
+              priority prio = priority::interactive);
 
 
     token
     post_async(const std::string& url,
                const std::string& body,
                success_function_t success_func,
-               error_function_t error_func = {});
+               error_function_t error_func = {},
+               priority prio = priority::interactive);
 
 
     struct response_and_type_t {
@@ -145,13 +214,45 @@ namespace rest {
     get_json_async(const std::string& base_url,
                    const get_params_t& params,
                    json_success_function_t success_func,
-                   error_function_t error_func = {});
-
+                   error_function_t error_func = {},
+                   priority prio = priority::interactive,
+                   sharing share = sharing::coalesce);
+
+    /*
+     * If progress_func is given, it's called each time more of the response arrives,
+     * from inside rest::process(); the text can end anywhere, even inside a string. It
+     * must not cancel requests. If it throws, it's not called again, and the error is
+     * only logged; success_func still gets the whole response.
+     */
     token
     post_json_async(const std::string& url,
                     const std::string& params,
                     json_success_function_t success_func,
-                    error_function_t error_func = {});
+                    error_function_t error_func = {},
+                    priority prio = priority::interactive,
+                    json_progress_function_t progress_func = {},
+                    sharing share = sharing::coalesce);
+
+
+    /*
+     * Like get_json_async(), but the response is stored on disk, under cache_key.
+     *
+     * The cache files are read and written on a worker thread. A cached response is
+     * delivered first, from scheduler::run_main(); then it's revalidated with a
+     * conditional request, and success_func is called again only if the response changed.
+     * Errors are only reported if nothing was cached.
+     */
+    token
+    get_json_cached_async(const std::string& cache_key,
+                          const std::string& base_url,
+                          const get_params_t& params,
+                          json_success_function_t success_func,
+                          error_function_t error_func = {},
+                          priority prio = priority::interactive);
+
+    // An empty path disables the cache.
+    void
+    set_cache_dir(const std::filesystem::path& dir);
 
 
     std::string
@@ -162,6 +263,31 @@ namespace rest {
     post_json_sync(const std::string& url,
                    const std::string& body);
 
+
+    /* ------------------- */
+    /* Coroutine functions */
+    /* ------------------- */
+
+    /*
+     * Like the *_async() functions, but awaitable; the response is returned, errors are
+     * thrown. Stopping the awaiting task cancels the request.
+     */
+    namespace co {
+
+        coro::task<std::string>
+        get_json(std::string base_url,
+                 get_params_t params = {},
+                 priority prio = priority::interactive,
+                 sharing share = sharing::coalesce);
+
+        coro::task<std::string>
+        post_json(std::string url,
+                  std::string body,
+                  priority prio = priority::interactive,
+                  sharing share = sharing::coalesce);
+
+    } // namespace co
+
 } // namespace rest
 
 #endif
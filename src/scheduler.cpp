@@ -0,0 +1,814 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // clamp(), max()
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>               // snprintf()
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>              // move(), swap()
+#include <vector>
+
+#include "scheduler.hpp"
+
+#include "thread_policy.hpp"
+#include "tracer.hpp"
+
+
+using std::cout;
+using std::endl;
+
+using namespace std::literals;
+
+
+namespace scheduler {
+
+    namespace detail {
+
+        struct task_state {
+            std::stop_source stopper;
+            std::mutex mutex;
+            std::condition_variable done_cond;
+            bool done = false;
+
+
+            void
+            finish()
+                noexcept
+            {
+                {
+                    std::lock_guard guard{mutex};
+                    done = true;
+                }
+                done_cond.notify_all();
+            }
+        };
+
+    } // namespace detail
+
+
+    namespace {
+
+        struct queued_task {
+            category cat;
+            task_function_t func;
+            std::shared_ptr<detail::task_state> state;
+            clock_type::time_point queued_at;
+        };
+
+
+        struct queued_main {
+            category cat;
+            main_function_t func;
+            clock_type::time_point queued_at;
+        };
+
+
+        struct pool;
+
+
+        struct worker {
+            pool* owner = nullptr;
+            std::mutex mutex;
+            std::deque<queued_task> tasks;
+            std::jthread thread;
+        };
+
+
+        // Workers that steal from each other, but not from other pools.
+        struct pool {
+            const char* thread_name;
+            thread_policy::role role;
+
+            std::vector<std::unique_ptr<worker>> workers;
+            std::atomic<unsigned> next_worker = 0;
+
+            // Tasks in all queues, so idle workers know when to look for work.
+            std::mutex idle_mutex;
+            std::condition_variable_any idle_cond;
+            std::size_t total_queued = 0;
+
+
+            pool(const char* thread_name,
+                 thread_policy::role role)
+                noexcept :
+                thread_name{thread_name},
+                role{role}
+            {}
+        };
+
+
+        // For tasks that only compute, or do quick file I/O.
+        pool compute_pool{"scheduler", thread_policy::role::background};
+
+        // Network and DNS tasks block for seconds; they get their own workers, so they
+        // can't hold up the other tasks.
+        pool io_pool{"scheduler-io", thread_policy::role::network};
+
+        // Enough for a connect task, waiting on the reverse lookups of the mirrors.
+        const unsigned num_io_threads = 4;
+
+        std::mutex main_mutex;
+        std::deque<queued_main> main_queue;
+        main_function_t wake_main_func;
+
+        std::mutex stats_mutex;
+        std::array<stats, num_categories> all_stats;
+
+        // The worker of the current thread, if it's one.
+        thread_local worker* current_worker = nullptr;
+        // The task running on the current thread, if any.
+        thread_local const detail::task_state* current_task = nullptr;
+
+
+        stats&
+        stats_of(category cat)
+        {
+            return all_stats[static_cast<unsigned>(cat)];
+        }
+
+
+        void
+        record(category cat,
+               clock_type::duration wait,
+               clock_type::duration run,
+               bool failed)
+        {
+            std::lock_guard guard{stats_mutex};
+            auto& st = stats_of(cat);
+            if (failed)
+                ++st.failed;
+            else
+                ++st.completed;
+            st.busy += run;
+            st.max_run = std::max(st.max_run, run);
+            st.max_wait = std::max(st.max_wait, wait);
+        }
+
+
+        // Own tasks are taken from the front, stolen ones from the back.
+        std::optional<queued_task>
+        take(worker& w,
+             bool steal)
+        {
+            std::lock_guard guard{w.mutex};
+            if (w.tasks.empty())
+                return {};
+            std::optional<queued_task> result;
+            if (steal) {
+                result = std::move(w.tasks.back());
+                w.tasks.pop_back();
+            } else {
+                result = std::move(w.tasks.front());
+                w.tasks.pop_front();
+            }
+            return result;
+        }
+
+
+        pool&
+        pool_of(category cat)
+            noexcept
+        {
+            switch (cat) {
+                case category::network:
+                case category::dns:
+                    return io_pool;
+                default:
+                    return compute_pool;
+            }
+        }
+
+
+        std::optional<queued_task>
+        find_task(worker& self)
+        {
+            if (auto t = take(self, false))
+                return t;
+            for (auto& other : self.owner->workers)
+                if (other.get() != &self)
+                    if (auto t = take(*other, true))
+                        return t;
+            return {};
+        }
+
+
+        void
+        execute(queued_task& t)
+        {
+            if (t.state->stopper.stop_requested()) {
+                {
+                    std::lock_guard guard{stats_mutex};
+                    ++stats_of(t.cat).skipped;
+                }
+                t.state->finish();
+                return;
+            }
+
+            const auto start = clock_type::now();
+            bool failed = false;
+            // Note: tasks can nest, when a worker waits for another task.
+            const auto* outer_task = current_task;
+            current_task = t.state.get();
+            try {
+                t.func(t.state->stopper.get_token());
+            }
+            catch (std::exception& e) {
+                cout << "ERROR: scheduler: " << to_string(t.cat) << " task failed: "
+                     << e.what() << endl;
+                failed = true;
+            }
+            catch (...) {
+                // Note: letting it through would end the worker thread.
+                cout << "ERROR: scheduler: " << to_string(t.cat)
+                     << " task failed with an unknown exception" << endl;
+                failed = true;
+            }
+            current_task = outer_task;
+            // Note: destroy what the task captured before anyone is told it's done.
+            t.func = nullptr;
+            record(t.cat, start - t.queued_at, clock_type::now() - start, failed);
+            t.state->finish();
+        }
+
+
+        bool
+        run_one(worker& self)
+        {
+            auto t = find_task(self);
+            if (!t)
+                return false; // another worker got it first
+            {
+                std::lock_guard guard{self.owner->idle_mutex};
+                --self.owner->total_queued;
+            }
+            execute(*t);
+            return true;
+        }
+
+
+        void
+        worker_func(std::stop_token token,
+                    worker& self)
+        {
+            current_worker = &self;
+            pool& p = *self.owner;
+            tracer::set_thread_name(p.thread_name);
+            thread_policy::apply(p.role);
+            while (true) {
+                {
+                    std::unique_lock guard{p.idle_mutex};
+                    if (!p.idle_cond.wait(guard, token, [&p] { return p.total_queued > 0; }))
+                        break;
+                }
+                run_one(self);
+            }
+            current_worker = nullptr;
+        }
+
+
+        unsigned
+        get_num_threads()
+        {
+#ifdef __WIIU__
+            // One per core.
+            return 3;
+#else
+            return std::clamp(std::thread::hardware_concurrency(), 2u, 8u);
+#endif
+        }
+
+
+        void
+        start(pool& p,
+              unsigned n)
+        {
+            p.workers.clear();
+            for (unsigned i = 0; i < n; ++i) {
+                p.workers.push_back(std::make_unique<worker>());
+                p.workers.back()->owner = &p;
+            }
+            for (auto& w : p.workers)
+                w->thread = std::jthread{worker_func, std::ref(*w)};
+        }
+
+
+        void
+        stop(pool& p)
+        {
+            for (auto& w : p.workers)
+                w->thread.request_stop();
+            for (auto& w : p.workers)
+                if (w->thread.joinable())
+                    w->thread.join();
+
+            // Whoever is waiting for the tasks that didn't start must not wait forever.
+            for (auto& w : p.workers)
+                for (auto& t : w->tasks) {
+                    {
+                        std::lock_guard guard{stats_mutex};
+                        ++stats_of(t.cat).skipped;
+                    }
+                    t.state->finish();
+                }
+            p.workers.clear();
+            p.total_queued = 0;
+        }
+
+    } // namespace
+
+
+    const char*
+    to_string(category cat)
+        noexcept
+    {
+        switch (cat) {
+            case category::network:
+                return "network";
+            case category::dns:
+                return "dns";
+            case category::misc:
+                return "misc";
+        }
+        return "unknown";
+    }
+
+
+    task::task()
+        noexcept = default;
+
+
+    task::task(std::shared_ptr<detail::task_state> st)
+        noexcept :
+        state{std::move(st)}
+    {}
+
+
+    task::task(task&& other)
+        noexcept :
+        state{std::move(other.state)}
+    {}
+
+
+    task&
+    task::operator =(task&& other)
+        noexcept
+    {
+        if (this != &other) {
+            request_stop();
+            wait();
+            state = std::move(other.state);
+        }
+        return *this;
+    }
+
+
+    task::~task()
+        noexcept
+    {
+        request_stop();
+        wait();
+    }
+
+
+    void
+    task::request_stop()
+        noexcept
+    {
+        if (state)
+            state->stopper.request_stop();
+    }
+
+
+    bool
+    task::done()
+        const noexcept
+    {
+        if (!state)
+            return true;
+        std::lock_guard guard{state->mutex};
+        return state->done;
+    }
+
+
+    void
+    task::wait()
+        const noexcept
+    {
+        // Note: a task waiting for itself would never finish.
+        if (!state || state.get() == current_task)
+            return;
+
+        if (current_worker) {
+            /*
+             * A worker waiting for another task could be the only one left to run it, so
+             * it keeps running queued tasks meanwhile.
+             */
+            while (!done()) {
+                if (run_one(*current_worker))
+                    continue;
+                std::unique_lock guard{state->mutex};
+                state->done_cond.wait_for(guard, 1ms, [this] { return state->done; });
+            }
+            return;
+        }
+
+        std::unique_lock guard{state->mutex};
+        state->done_cond.wait(guard, [this] { return state->done; });
+    }
+
+
+    void
+    initialize(main_function_t wake_main)
+    {
+        wake_main_func = std::move(wake_main);
+        const unsigned n = get_num_threads();
+        start(compute_pool, n);
+        start(io_pool, num_io_threads);
+        cout << "scheduler: started " << n << " worker threads, and "
+             << num_io_threads << " for network I/O" << endl;
+    }
+
+
+    void
+    finalize()
+    {
+        stop(compute_pool);
+        stop(io_pool);
+
+        {
+            std::lock_guard guard{main_mutex};
+            main_queue.clear();
+        }
+        wake_main_func = nullptr;
+
+        print_stats();
+    }
+
+
+    task
+    submit(category cat,
+           task_function_t func)
+    {
+        pool& p = pool_of(cat);
+        if (p.workers.empty())
+            throw std::logic_error{"scheduler: submit() called while not running"};
+
+        auto state = std::make_shared<detail::task_state>();
+        worker* target = current_worker;
+        if (!target || target->owner != &p)
+            target = p.workers[p.next_worker++ % p.workers.size()].get();
+        {
+            std::lock_guard guard{target->mutex};
+            target->tasks.push_back(queued_task{cat, std::move(func), state, clock_type::now()});
+        }
+        {
+            std::lock_guard guard{stats_mutex};
+            ++stats_of(cat).submitted;
+        }
+        {
+            std::lock_guard guard{p.idle_mutex};
+            ++p.total_queued;
+        }
+        p.idle_cond.notify_one();
+        return task{std::move(state)};
+    }
+
+
+    void
+    post_main(category cat,
+              main_function_t func)
+    {
+        {
+            std::lock_guard guard{main_mutex};
+            main_queue.push_back(queued_main{cat, std::move(func), clock_type::now()});
+        }
+        {
+            std::lock_guard guard{stats_mutex};
+            ++stats_of(cat).submitted;
+        }
+        if (wake_main_func)
+            wake_main_func();
+    }
+
+
+    bool
+    run_main()
+    {
+        std::deque<queued_main> local_queue;
+        {
+            std::lock_guard guard{main_mutex};
+            // Note: what gets posted while running these waits for the next frame.
+            std::swap(local_queue, main_queue);
+        }
+
+        for (auto& item : local_queue) {
+            const auto start = clock_type::now();
+            bool failed = false;
+            try {
+                item.func();
+            }
+            catch (std::exception& e) {
+                cout << "BUG: scheduler: " << to_string(item.cat)
+                     << " main thread call threw: " << e.what() << endl;
+                failed = true;
+            }
+            catch (...) {
+                cout << "BUG: scheduler: " << to_string(item.cat)
+                     << " main thread call threw an unknown exception" << endl;
+                failed = true;
+            }
+            record(item.cat, start - item.queued_at, clock_type::now() - start, failed);
+        }
+        return !local_queue.empty();
+    }
+
+
+    stats
+    get_stats(category cat)
+    {
+        std::lock_guard guard{stats_mutex};
+        return stats_of(cat);
+    }
+
+
+    void
+    print_stats()
+    {
+        using std::chrono::duration;
+        using ms = duration<double, std::milli>;
+
+        cout << "scheduler stats:" << endl;
+        for (unsigned i = 0; i < num_categories; ++i) {
+            const auto cat = static_cast<category>(i);
+            const auto st = get_stats(cat);
+            if (!st.submitted)
+                continue;
+            char buf[192];
+            std::snprintf(buf, sizeof buf,
+                          "  %-8s %6llu submitted, %6llu done, %4llu failed, %4llu skipped,"
+                          " busy %.1f ms, max run %.1f ms, max wait %.1f ms",
+                          to_string(cat),
+                          static_cast<unsigned long long>(st.submitted),
+                          static_cast<unsigned long long>(st.completed),
+                          static_cast<unsigned long long>(st.failed),
+                          static_cast<unsigned long long>(st.skipped),
+                          ms{st.busy}.count(),
+                          ms{st.max_run}.count(),
+                          ms{st.max_wait}.count());
+            cout << buf << endl;
+        }
+    }
+
+} // namespace scheduler
+
+
+#ifdef UNIT_TEST
+
+// compilation: g++ -std=c++23 -DUNIT_TEST scheduler.cpp thread_policy.cpp tracer.cpp
+
+#include <cstdlib>
+#include <string>
+#include <tuple>
+
+#include "coro.hpp"
+#include "unit_test.hpp"
+
+using std::cout;
+using std::endl;
+
+
+// Keeps the worker tasks alive until they run.
+std::vector<scheduler::task> worker_tasks;
+
+
+// Resolved from a worker thread, like a rest callback.
+coro::task<int>
+add_later(int a,
+          int b)
+{
+    co_return co_await coro::from_callbacks<int>(
+        [a, b](coro::resolve_t<int> resolve,
+               coro::reject_t) -> coro::canceler_t
+        {
+            worker_tasks.push_back(
+                scheduler::submit(scheduler::category::misc,
+                                  [a, b, resolve = std::move(resolve)](std::stop_token)
+                                      mutable
+                                  {
+                                      resolve(a + b);
+                                  }));
+            return {};
+        });
+}
+
+
+coro::task<int>
+fail_later(std::string message)
+{
+    co_return co_await coro::from_callbacks<int>(
+        [&message](coro::resolve_t<int>,
+                   coro::reject_t reject) -> coro::canceler_t
+        {
+            worker_tasks.push_back(
+                scheduler::submit(scheduler::category::misc,
+                                  [message, reject = std::move(reject)](std::stop_token)
+                                      mutable
+                                  {
+                                      reject(std::runtime_error{message});
+                                  }));
+            return {};
+        });
+}
+
+
+// Never finishes by itself; only the canceler ends it.
+coro::task<>
+wait_forever(bool& canceled)
+{
+    co_await coro::from_callbacks<>(
+        [&canceled](coro::resolve_t<>,
+                    coro::reject_t) -> coro::canceler_t
+        {
+            return [&canceled] { canceled = true; };
+        });
+}
+
+
+template<typename T>
+void
+run_until_done(const coro::task<T>& t)
+{
+    while (!t.done()) {
+        scheduler::run_main();
+        std::this_thread::yield();
+    }
+}
+
+
+coro::task<>
+store_sum(int& result)
+{
+    result = co_await add_later(2, 3);
+}
+
+
+coro::task<>
+store_both(int& a,
+           int& b)
+{
+    std::tie(a, b) = co_await coro::when_all(add_later(1, 1), add_later(10, 20));
+}
+
+
+coro::task<>
+store_error(std::string& error)
+{
+    try {
+        co_await fail_later("boom");
+    }
+    catch (std::exception& e) {
+        error = e.what();
+    }
+}
+
+
+coro::task<>
+store_canceled(bool& canceled,
+               bool& threw)
+{
+    try {
+        co_await wait_forever(canceled);
+    }
+    catch (coro::canceled_error&) {
+        threw = true;
+    }
+}
+
+
+int main()
+{
+    int total = 0;
+    int successes = 0;
+
+    scheduler::initialize([] {});
+
+    {
+        cout << "Test: resumed on the main thread" << endl;
+        int result = 0;
+        auto t = store_sum(result);
+        t.start();
+        run_until_done(t);
+        CHECK_EQUAL(result, 5);
+    }
+
+    {
+        cout << "Test: when_all()" << endl;
+        int a = 0;
+        int b = 0;
+        auto t = store_both(a, b);
+        t.start();
+        run_until_done(t);
+        CHECK_EQUAL(a, 2);
+        CHECK_EQUAL(b, 30);
+    }
+
+    {
+        cout << "Test: rejected" << endl;
+        std::string error;
+        auto t = store_error(error);
+        t.start();
+        run_until_done(t);
+        CHECK_EQUAL(error, "boom");
+    }
+
+    {
+        cout << "Test: stopped" << endl;
+        bool canceled = false;
+        bool threw = false;
+        auto t = store_canceled(canceled, threw);
+        t.start();
+        t.request_stop();
+        run_until_done(t);
+        CHECK_EQUAL(canceled, true);
+        CHECK_EQUAL(threw, true);
+    }
+
+    {
+        cout << "Test: destroyed while suspended" << endl;
+        bool canceled = false;
+        bool threw = false;
+        {
+            auto t = store_canceled(canceled, threw);
+            t.start();
+        }
+        CHECK_EQUAL(canceled, true);
+        CHECK_EQUAL(threw, false);
+    }
+
+    {
+        cout << "Test: unknown exception" << endl;
+        auto failed = scheduler::get_stats(scheduler::category::misc).failed;
+        {
+            auto t = scheduler::submit(scheduler::category::misc,
+                                       [](std::stop_token) { throw 42; });
+            t.wait();
+        }
+        CHECK_EQUAL(scheduler::get_stats(scheduler::category::misc).failed, failed + 1);
+        bool ran = false;
+        {
+            auto t = scheduler::submit(scheduler::category::misc,
+                                       [&ran](std::stop_token) { ran = true; });
+            t.wait();
+        }
+        CHECK_EQUAL(ran, true);
+    }
+
+    {
+        cout << "Test: blocked network tasks" << endl;
+        std::atomic<bool> released = false;
+        std::atomic<unsigned> timed_out = 0;
+        std::vector<scheduler::task> blocked;
+        for (unsigned i = 0; i < 8; ++i)
+            blocked.push_back(scheduler::submit(
+                scheduler::category::network,
+                [&released, &timed_out](std::stop_token)
+                {
+                    auto deadline = std::chrono::steady_clock::now() + 2s;
+                    while (!released) {
+                        if (std::chrono::steady_clock::now() >= deadline) {
+                            ++timed_out;
+                            return;
+                        }
+                        std::this_thread::sleep_for(1ms);
+                    }
+                }));
+        {
+            auto t = scheduler::submit(scheduler::category::misc,
+                                       [&released](std::stop_token) { released = true; });
+            t.wait();
+        }
+        blocked.clear();
+        CHECK_EQUAL(timed_out.load(), 0u);
+    }
+
+    worker_tasks.clear();
+    scheduler::finalize();
+
+    cout << "Successes: " << successes << " / " << total << endl;
+    return successes < total ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif // UNIT_TEST
@@ -0,0 +1,157 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>           // move_only_function
+#include <memory>               // shared_ptr
+#include <stop_token>
+
+
+/*
+ * Process-wide thread pool, plus a queue of continuations for the main thread.
+ *
+ * Short-lived background work is submitted here, instead of spawning a thread for it. The
+ * number of worker threads is fixed; each worker runs its own queue in order, and idle
+ * workers steal from the others. Network and DNS tasks block on I/O, so they run on a
+ * separate set of workers.
+ *
+ * Code that must run on the main thread (touching the UI, or starting rest calls) is
+ * posted with post_main(), and runs from run_main(), once per frame.
+ *
+ * Long-running loops, like the icon downloader or the audio decoder, keep their own
+ * threads: they would occupy a worker forever.
+ */
+namespace scheduler {
+
+    using clock_type = std::chrono::steady_clock;
+
+
+    enum class category : unsigned {
+        network,                // connecting, fetching mirrors
+        dns,                    // name lookups
+        misc,
+    };
+
+    inline constexpr unsigned num_categories = 3;
+
+
+    const char*
+    to_string(category cat)
+        noexcept;
+
+
+    struct stats {
+        std::uint64_t submitted = 0;
+        std::uint64_t completed = 0;
+        std::uint64_t failed = 0;   // threw an exception
+        std::uint64_t skipped = 0;  // stopped before they started
+        clock_type::duration busy{};
+        clock_type::duration max_run{};
+        clock_type::duration max_wait{};
+    };
+
+
+    using task_function_t = std::move_only_function<void(std::stop_token)>;
+
+    using main_function_t = std::move_only_function<void()>;
+
+
+    namespace detail {
+        struct task_state;
+    }
+
+
+    // Handle to a submitted task, like a jthread that can't be detached.
+    class task {
+
+        std::shared_ptr<detail::task_state> state;
+
+        friend
+        task
+        submit(category cat,
+               task_function_t func);
+
+        explicit
+        task(std::shared_ptr<detail::task_state> st)
+            noexcept;
+
+    public:
+
+        task()
+            noexcept;
+
+        task(task&& other)
+            noexcept;
+
+        // Stops and waits for the old task, like a jthread.
+        task&
+        operator =(task&& other)
+            noexcept;
+
+        // Stops and waits, like a jthread.
+        ~task()
+            noexcept;
+
+
+        void
+        request_stop()
+            noexcept;
+
+        [[nodiscard]]
+        bool
+        done()
+            const noexcept;
+
+        // Block until the task finished, or was skipped.
+        void
+        wait()
+            const noexcept;
+
+    }; // class task
+
+
+    // wake_main is called from any thread, when there's something to run on the main one.
+    void
+    initialize(main_function_t wake_main);
+
+    // Stops the workers; queued tasks that didn't start yet are skipped.
+    void
+    finalize();
+
+
+    // Throws std::logic_error if the scheduler isn't running.
+    [[nodiscard]]
+    task
+    submit(category cat,
+           task_function_t func);
+
+
+    // Can be called from any thread.
+    void
+    post_main(category cat,
+              main_function_t func);
+
+
+    // Call from the main thread; returns true if anything ran.
+    bool
+    run_main();
+
+
+    stats
+    get_stats(category cat);
+
+
+    void
+    print_stats();
+
+} // namespace scheduler
+
+#endif
@@ -0,0 +1,359 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <bitset>
+#include <cctype>
+
+#include "simple_regex.hpp"
+
+
+using namespace std::literals;
+
+
+namespace simple_regex {
+
+    namespace {
+
+        using byte_set = std::bitset<256>;
+
+
+        bool
+        is_word(unsigned char c)
+            noexcept
+        {
+            return std::isalnum(c) || c == '_';
+        }
+
+
+        byte_set
+        make_set(int (*pred)(int))
+        {
+            byte_set result;
+            for (unsigned c = 0; c < 256; ++c)
+                if (pred(c))
+                    result.set(c);
+            return result;
+        }
+
+
+        byte_set
+        posix_class(std::string_view name)
+        {
+            if (name == "alnum")
+                return make_set(std::isalnum);
+            if (name == "alpha")
+                return make_set(std::isalpha);
+            if (name == "digit")
+                return make_set(std::isdigit);
+            if (name == "lower")
+                return make_set(std::islower);
+            if (name == "punct")
+                return make_set(std::ispunct);
+            if (name == "space")
+                return make_set(std::isspace);
+            if (name == "upper")
+                return make_set(std::isupper);
+            if (name == "xdigit")
+                return make_set(std::isxdigit);
+            throw error{"unknown class \"[:" + std::string{name} + ":]\""};
+        }
+
+
+        // Classes like "\d"; an empty set means c is not a class.
+        byte_set
+        escape_class(char c)
+        {
+            switch (c) {
+                case 'd':
+                    return make_set(std::isdigit);
+                case 's':
+                    return make_set(std::isspace);
+                case 'w': {
+                    byte_set result = make_set(std::isalnum);
+                    result.set('_');
+                    return result;
+                }
+                default:
+                    return {};
+            }
+        }
+
+
+        // Parses after the '[', up to and including the ']'.
+        byte_set
+        parse_bracket(std::string_view re,
+                      std::size_t& i)
+        {
+            byte_set result;
+            bool negate = false;
+            if (i < re.size() && re[i] == '^') {
+                negate = true;
+                ++i;
+            }
+            bool first = true;
+            while (true) {
+                if (i >= re.size())
+                    throw error{"missing ']'"};
+                unsigned char c = re[i++];
+                if (c == ']' && !first)
+                    break;
+                first = false;
+
+                if (c == '[' && re.substr(i).starts_with(':')) {
+                    auto end = re.find(":]", i + 1);
+                    if (end == std::string_view::npos)
+                        throw error{"missing \":]\""};
+                    result |= posix_class(re.substr(i + 1, end - i - 1));
+                    i = end + 2;
+                    continue;
+                }
+
+                if (c == '\\') {
+                    if (i >= re.size())
+                        throw error{"trailing '\\'"};
+                    c = re[i++];
+                    if (auto cls = escape_class(c); cls.any()) {
+                        result |= cls;
+                        continue;
+                    }
+                }
+
+                // A range, unless the '-' is the last character.
+                if (i + 1 < re.size() && re[i] == '-' && re[i + 1] != ']') {
+                    const unsigned char last = re[i + 1];
+                    if (last < c)
+                        throw error{"invalid range"};
+                    for (unsigned x = c; x <= last; ++x)
+                        result.set(x);
+                    i += 2;
+                } else
+                    result.set(c);
+            }
+            if (negate)
+                result.flip();
+            return result;
+        }
+
+    } // namespace
+
+
+    error::error(const std::string& msg) :
+        std::runtime_error{msg}
+    {}
+
+
+    pattern::pattern(std::string_view re)
+    {
+        bool can_be_empty = true;
+        std::size_t i = 0;
+        while (i < re.size()) {
+            byte_set set;
+            const char c = re[i++];
+            switch (c) {
+
+                case '^':
+                    begin_mask |= add_step();
+                    continue;
+
+                case '$':
+                    end_mask |= add_step();
+                    continue;
+
+                case '.':
+                    set.set();
+                    break;
+
+                case '[':
+                    set = parse_bracket(re, i);
+                    break;
+
+                case '\\': {
+                    if (i >= re.size())
+                        throw error{"trailing '\\'"};
+                    const char e = re[i++];
+                    if (e == 'b') {
+                        boundary_mask |= add_step();
+                        continue;
+                    }
+                    set = escape_class(e);
+                    if (set.none())
+                        set.set(static_cast<unsigned char>(e));
+                    break;
+                }
+
+                case '(':
+                case ')':
+                case '|':
+                case '{':
+                case '?':
+                case '*':
+                case '+':
+                    throw error{"unsupported '"s + c + "'"};
+
+                default:
+                    set.set(static_cast<unsigned char>(c));
+            }
+
+            const char quantifier = i < re.size() ? re[i] : '\0';
+            if (quantifier == '?' || quantifier == '*' || quantifier == '+')
+                ++i;
+
+            // Note: "x+" is the same as "xx*".
+            std::uint64_t step = add_step();
+            if (quantifier == '+') {
+                for (unsigned b = 0; b < 256; ++b)
+                    if (set.test(b))
+                        accepts[b] |= step;
+                step = add_step();
+            }
+            for (unsigned b = 0; b < 256; ++b)
+                if (set.test(b))
+                    accepts[b] |= step;
+
+            if (quantifier == '?' || quantifier == '*' || quantifier == '+')
+                optional_mask |= step;
+            if (quantifier == '*' || quantifier == '+')
+                repeat_mask |= step;
+            if (quantifier != '?' && quantifier != '*')
+                can_be_empty = false;
+        }
+
+        if (can_be_empty)
+            throw error{"pattern matches an empty string"};
+    }
+
+
+    bool
+    pattern::search(std::string_view input)
+        const noexcept
+    {
+        const std::uint64_t done = std::uint64_t{1} << num_steps;
+        std::uint64_t active = 0;
+        for (std::size_t pos = 0; ; ++pos) {
+            // Note: a match can start anywhere.
+            active = close(active | 1, input, pos);
+            if (active & done)
+                return true;
+            if (pos == input.size())
+                return false;
+            const std::uint64_t hits = active & accepts[static_cast<unsigned char>(input[pos])];
+            active = ((hits & ~repeat_mask) << 1) | (hits & repeat_mask);
+        }
+    }
+
+
+    std::uint64_t
+    pattern::add_step()
+    {
+        if (num_steps >= max_steps)
+            throw error{"pattern is too long"};
+        return std::uint64_t{1} << num_steps++;
+    }
+
+
+    std::uint64_t
+    pattern::close(std::uint64_t active,
+                   std::string_view input,
+                   std::size_t pos)
+        const noexcept
+    {
+        const bool at_begin = pos == 0;
+        const bool at_end = pos == input.size();
+        const bool at_boundary = (!at_begin && is_word(input[pos - 1]))
+                              != (!at_end && is_word(input[pos]));
+        // Note: skipping only moves forward, so one pass is enough.
+        for (std::size_t i = 0; i < num_steps; ++i) {
+            const std::uint64_t step = std::uint64_t{1} << i;
+            if (!(active & step))
+                continue;
+            if ((optional_mask & step)
+                || ((begin_mask & step) && at_begin)
+                || ((end_mask & step) && at_end)
+                || ((boundary_mask & step) && at_boundary))
+                active |= step << 1;
+        }
+        return active;
+    }
+
+} // namespace simple_regex
+
+
+#ifdef UNIT_TEST
+
+// compilation: g++ -std=c++23 -DUNIT_TEST simple_regex.cpp
+
+#include <cstdlib>
+#include <iostream>
+
+#include "unit_test.hpp"
+
+using std::cout;
+using std::endl;
+
+
+bool
+matches(std::string_view text,
+        std::string_view regex)
+{
+    return simple_regex::pattern{regex}.search(text);
+}
+
+
+int main()
+{
+    int total = 0;
+    int successes = 0;
+
+    {
+        cout << "Test: word boundaries" << endl;
+        CHECK_EQUAL(matches("rock fm", "\\bfm\\b"), true);
+        CHECK_EQUAL(matches("film", "\\bfm\\b"), false);
+        CHECK_EQUAL(matches("fm_radio", "\\bfm\\b"), false);
+        CHECK_EQUAL(matches("128k", "\\b[[:digit:]]+k\\b"), true);
+        CHECK_EQUAL(matches("128kbps", "\\b[[:digit:]]+k\\b"), false);
+    }
+
+    {
+        cout << "Test: anchors" << endl;
+        CHECK_EQUAL(matches("http://x", "^http"), true);
+        CHECK_EQUAL(matches("see http", "^http"), false);
+        CHECK_EQUAL(matches("news", "s$"), true);
+        CHECK_EQUAL(matches("sun", "s$"), false);
+    }
+
+    {
+        cout << "Test: classes and repetition" << endl;
+        CHECK_EQUAL(matches("90.5", "[[:digit:]]+\\.[[:alnum:]]"), true);
+        CHECK_EQUAL(matches("90s", "[[:digit:]]+\\.[[:alnum:]]"), false);
+        CHECK_EQUAL(matches("***", "^[*]+"), true);
+        CHECK_EQUAL(matches("colour", "colou?r"), true);
+        CHECK_EQUAL(matches("color", "colou?r"), true);
+        CHECK_EQUAL(matches("aaab", "^a*b"), true);
+        CHECK_EQUAL(matches("x9", "[^a-z]"), true);
+        CHECK_EQUAL(matches("xyz", "[^a-z]"), false);
+    }
+
+    {
+        cout << "Test: literals" << endl;
+        CHECK_EQUAL(matches("a|b", "\\|"), true);
+        CHECK_EQUAL(matches("pop - rock", " - "), true);
+        CHECK_EQUAL(matches("°C", "°"), true);
+    }
+
+    {
+        cout << "Test: invalid patterns" << endl;
+        CHECK_EXCEPT(simple_regex::pattern{"(a)"}, simple_regex::error);
+        CHECK_EXCEPT(simple_regex::pattern{"a|b"}, simple_regex::error);
+        CHECK_EXCEPT(simple_regex::pattern{"a*"}, simple_regex::error);
+        CHECK_EXCEPT(simple_regex::pattern{"[abc"}, simple_regex::error);
+    }
+
+    cout << "Successes: " << successes << " / " << total << endl;
+    return successes < total ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif // UNIT_TEST
@@ -0,0 +1,86 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef SIMPLE_REGEX_HPP
+#define SIMPLE_REGEX_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+
+/*
+ * A small subset of ECMAScript regular expressions, for filtering short strings like
+ * tags, without std::regex.
+ *
+ * Supported: literal characters, '.', bracket expressions (with ranges, negation and
+ * POSIX classes like "[:digit:]"), the escapes "\b", "\d", "\w" and "\s", the anchors '^'
+ * and '$', and the quantifiers '?', '*' and '+'. There are no groups or alternatives; any
+ * other escaped character is a literal.
+ *
+ * A pattern compiles to at most 63 steps, which are all tracked at once as the bits of an
+ * integer, so search() is linear in the input length, and never backtracks.
+ */
+namespace simple_regex {
+
+    struct error : std::runtime_error {
+        error(const std::string& msg);
+    };
+
+
+    class pattern {
+
+    public:
+
+        // Throws simple_regex::error if re is not supported, or matches an empty string.
+        explicit
+        pattern(std::string_view re);
+
+
+        // True if any part of input matches.
+        [[nodiscard]]
+        bool
+        search(std::string_view input)
+            const noexcept;
+
+
+    private:
+
+        static constexpr std::size_t max_steps = 63;
+
+        std::size_t num_steps = 0;
+        // For each byte, the steps that consume it.
+        std::array<std::uint64_t, 256> accepts{};
+        // Steps that can be skipped.
+        std::uint64_t optional_mask = 0;
+        // Steps that stay active after consuming a byte.
+        std::uint64_t repeat_mask = 0;
+        // Steps that don't consume anything, and are skipped when they hold.
+        std::uint64_t begin_mask = 0;
+        std::uint64_t end_mask = 0;
+        std::uint64_t boundary_mask = 0;
+
+
+        std::uint64_t
+        add_step();
+
+        // Follow the steps that don't need to consume a byte at pos.
+        [[nodiscard]]
+        std::uint64_t
+        close(std::uint64_t active,
+              std::string_view input,
+              std::size_t pos)
+            const noexcept;
+
+    }; // class pattern
+
+} // namespace simple_regex
+
+#endif
@@ -0,0 +1,116 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <atomic>
+#include <exception>
+#include <iostream>
+
+#include "socket_tuning.hpp"
+
+
+using std::cout;
+using std::endl;
+
+
+namespace socket_tuning {
+
+    namespace {
+
+        // The default on the Wii U is too small to ride out Wi-Fi hiccups.
+        const unsigned rcvbuf_size = 256 * 1024;
+
+        // In seconds.
+        const unsigned keepalive_idle = 20;
+        const unsigned keepalive_interval = 5;
+        const unsigned keepalive_count = 4;
+
+        // Acknowledge every few segments, instead of every other one.
+        const unsigned ack_frequency = 4;
+
+
+        std::atomic<bool> enabled = true;
+
+        std::atomic<unsigned> num_applied = 0;
+        std::atomic<unsigned> num_failed = 0;
+
+
+        template<typename F>
+        bool
+        try_set(const char* name,
+                F&& func)
+            noexcept
+        {
+            try {
+                func();
+                return true;
+            }
+            catch (std::exception& e) {
+                cout << "WARNING: socket_tuning: could not set " << name << ": "
+                     << e.what() << endl;
+                return false;
+            }
+        }
+
+    } // namespace
+
+
+    void
+    set_enabled(bool enable)
+        noexcept
+    {
+        enabled.store(enable);
+    }
+
+
+    bool
+    is_enabled()
+        noexcept
+    {
+        return enabled.load();
+    }
+
+
+    void
+    apply(net::socket& sock)
+        noexcept
+    {
+        if (!is_enabled())
+            return;
+
+        bool ok = true;
+
+        ok &= try_set("SO_RCVBUF", [&] { sock.set_rcvbuf(rcvbuf_size); });
+
+        ok &= try_set("SO_KEEPALIVE", [&] { sock.set_keepalive(true); });
+#ifdef SO_KEEPIDLE
+        ok &= try_set("SO_KEEPIDLE", [&] { sock.set_keepidle(keepalive_idle); });
+#endif
+#ifdef SO_KEEPINTVL
+        ok &= try_set("SO_KEEPINTVL", [&] { sock.set_keepintvl(keepalive_interval); });
+#endif
+#ifdef SO_KEEPCNT
+        ok &= try_set("SO_KEEPCNT", [&] { sock.set_keepcnt(keepalive_count); });
+#endif
+
+#ifdef TCP_ACKFREQUENCY
+        ok &= try_set("TCP_ACKFREQUENCY", [&] { sock.set_ackfrequency(ack_frequency); });
+#endif
+
+        ++num_applied;
+        if (!ok)
+            ++num_failed;
+    }
+
+
+    stats
+    get_stats()
+        noexcept
+    {
+        return {num_applied.load(), num_failed.load()};
+    }
+
+} // namespace socket_tuning
@@ -0,0 +1,51 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef SOCKET_TUNING_HPP
+#define SOCKET_TUNING_HPP
+
+#include "net/socket.hpp"
+
+
+/*
+ * Socket options for long-lived audio streams: a bigger receive buffer, keepalive probes
+ * to detect dead peers, and fewer ACKs. Options the platform doesn't have are skipped.
+ *
+ * It must be applied before connecting, so the receive window gets scaled.
+ */
+namespace socket_tuning {
+
+    struct stats {
+        unsigned applied = 0;
+        unsigned failed = 0;    // at least one option was rejected
+    };
+
+
+    void
+    set_enabled(bool enable)
+        noexcept;
+
+    [[nodiscard]]
+    bool
+    is_enabled()
+        noexcept;
+
+
+    // Does nothing when disabled; errors are logged, not thrown.
+    void
+    apply(net::socket& sock)
+        noexcept;
+
+
+    [[nodiscard]]
+    stats
+    get_stats()
+        noexcept;
+
+} // namespace socket_tuning
+
+#endif
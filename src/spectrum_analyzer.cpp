@@ -0,0 +1,263 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // clamp(), max()
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+#include "spectrum_analyzer.hpp"
+
+
+namespace {
+
+    // The analyzed signal is decimated to at most this rate.
+    const int analysis_rate = 24000;
+
+    // Range of the bars, in Hz.
+    const float min_freq = 40;
+    const float max_freq = 11000;
+
+    // Levels are shown from this, in dB relative to full scale, up to 0 dB.
+    const float floor_db = -72;
+
+    // How much a bar or meter can fall per analysis (about 1.5 per second at 30 Hz).
+    const float fall_step = 0.05f;
+
+
+    float
+    to_level(float power)
+        noexcept
+    {
+        // Note: 10 * log10() of a power is the level in dB.
+        const float db = 10 * std::log10(power + 1e-12f);
+        return std::clamp(1 - db / floor_db, 0.0f, 1.0f);
+    }
+
+
+    float
+    fall(float old_level,
+         float new_level)
+        noexcept
+    {
+        return std::max(new_level, old_level - fall_step);
+    }
+
+
+    template<typename T>
+    float
+    to_float(T x)
+        noexcept;
+
+
+    template<>
+    inline
+    float
+    to_float<std::int16_t>(std::int16_t x)
+        noexcept
+    {
+        return x * (1.0f / 32768);
+    }
+
+
+    template<>
+    inline
+    float
+    to_float<float>(float x)
+        noexcept
+    {
+        return x;
+    }
+
+
+    struct mixdown_stats {
+        float power[2] = {0, 0};
+    };
+
+
+    // Fills dst with the mono mix, averaged over groups of decim frames; returns the mean
+    // square of the first two channels.
+    template<typename T>
+    mixdown_stats
+    mixdown(std::span<const T> src,
+            int channels,
+            int decim,
+            std::span<float> dst)
+        noexcept
+    {
+        mixdown_stats stats;
+        const int right = channels > 1 ? 1 : 0;
+        const std::size_t frames = src.size() / channels;
+        const float scale = 1.0f / (channels * decim);
+        std::size_t f = 0;
+        for (auto& out : dst) {
+            float sum = 0;
+            for (int d = 0; d < decim; ++d, ++f) {
+                if (f >= frames)
+                    break;
+                const T* frame = src.data() + f * channels;
+                for (int c = 0; c < channels; ++c)
+                    sum += to_float(frame[c]);
+                const float l = to_float(frame[0]);
+                const float r = to_float(frame[right]);
+                stats.power[0] += l * l;
+                stats.power[1] += r * r;
+            }
+            out = sum * scale;
+        }
+        if (frames) {
+            stats.power[0] /= frames;
+            stats.power[1] /= frames;
+        }
+        return stats;
+    }
+
+} // namespace
+
+
+spectrum_analyzer::spectrum_analyzer()
+{
+    using std::numbers::pi;
+
+    // Hann window.
+    for (std::size_t i = 0; i < fft_size; ++i)
+        window[i] = 0.5 - 0.5 * std::cos(2 * pi * i / fft_size);
+
+    for (std::size_t k = 0; k < twiddles.size(); ++k)
+        twiddles[k] = std::polar(1.0, -2 * pi * k / half_size);
+
+    for (std::size_t k = 0; k < half_size; ++k)
+        split_twiddles[k] = std::polar(1.0, -2 * pi * k / fft_size);
+
+    unsigned bits = 0;
+    while ((1u << bits) < half_size)
+        ++bits;
+    for (unsigned i = 0; i < half_size; ++i) {
+        unsigned r = 0;
+        for (unsigned b = 0; b < bits; ++b)
+            if (i & (1u << b))
+                r |= 1u << (bits - 1 - b);
+        bit_reversed[i] = r;
+    }
+}
+
+
+std::size_t
+spectrum_analyzer::get_input_size(const decoder::spec& spec)
+    const noexcept
+{
+    const int decim = std::max(1, spec.rate / analysis_rate);
+    return fft_size * decim * spec.channels * (SDL_AUDIO_BITSIZE(spec.format) / 8);
+}
+
+
+const spectrum_analyzer::result&
+spectrum_analyzer::analyze(std::span<const char> pcm,
+                           const decoder::spec& spec)
+    noexcept
+{
+    samples.fill(0);
+    mixdown_stats stats;
+    const int decim = std::max(1, spec.rate / analysis_rate);
+    if (spec.channels > 0) {
+        if (spec.format == AUDIO_S16SYS)
+            stats = mixdown(std::span{reinterpret_cast<const std::int16_t*>(pcm.data()),
+                                      pcm.size() / sizeof(std::int16_t)},
+                            spec.channels, decim, samples);
+        else if (spec.format == AUDIO_F32SYS)
+            stats = mixdown(std::span{reinterpret_cast<const float*>(pcm.data()),
+                                      pcm.size() / sizeof(float)},
+                            spec.channels, decim, samples);
+    }
+
+    for (int c = 0; c < 2; ++c)
+        current.vu[c] = fall(current.vu[c], to_level(stats.power[c]));
+
+    for (std::size_t i = 0; i < fft_size; ++i)
+        samples[i] *= window[i];
+    fft();
+
+    if (spec.rate > 0 && spec.rate / decim != band_rate)
+        update_bands(spec.rate / decim);
+
+    // Note: a full scale sine, through the Hann window, peaks at fft_size / 4.
+    const float norm = 1.0f / ((fft_size / 4.0f) * (fft_size / 4.0f));
+    for (std::size_t b = 0; b < num_bands; ++b) {
+        float power = 0;
+        for (unsigned k = band_begin[b]; k <= band_end[b]; ++k)
+            power = std::max(power, std::norm(work[k]));
+        current.bands[b] = fall(current.bands[b], to_level(power * norm));
+    }
+
+    return current;
+}
+
+
+void
+spectrum_analyzer::reset()
+    noexcept
+{
+    current = {};
+}
+
+
+void
+spectrum_analyzer::update_bands(int rate)
+    noexcept
+{
+    band_rate = rate;
+    const float bin_width = float(rate) / fft_size;
+    const float ratio = std::pow(max_freq / min_freq, 1.0f / num_bands);
+    float low = min_freq;
+    for (std::size_t b = 0; b < num_bands; ++b) {
+        const float high = low * ratio;
+        // Note: narrow bands at the bottom get the nearest bin, so no bar is left empty.
+        const int first = std::clamp<int>(std::lround(low / bin_width), 1, half_size - 1);
+        const int last = std::clamp<int>(std::lround(high / bin_width) - 1,
+                                         first, half_size - 1);
+        band_begin[b] = first;
+        band_end[b] = last;
+        low = high;
+    }
+}
+
+
+void
+spectrum_analyzer::fft()
+    noexcept
+{
+    // Pack even samples as the real part, odd ones as the imaginary part.
+    for (std::size_t i = 0; i < half_size; ++i)
+        work[bit_reversed[i]] = {samples[2 * i], samples[2 * i + 1]};
+
+    // Iterative radix-2, decimation in time.
+    for (std::size_t len = 2; len <= half_size; len *= 2) {
+        const std::size_t step = half_size / len;
+        for (std::size_t start = 0; start < half_size; start += len)
+            for (std::size_t j = 0; j < len / 2; ++j) {
+                const auto t = twiddles[j * step] * work[start + j + len / 2];
+                const auto u = work[start + j];
+                work[start + j] = u + t;
+                work[start + j + len / 2] = u - t;
+            }
+    }
+
+    // Split: turn the packed half-size transform into the first half of the real one.
+    const std::complex<float> half_i{0, 0.5f};
+    const auto z0 = work[0];
+    work[0] = {z0.real() + z0.imag(), 0};
+    for (std::size_t k = 1; k <= half_size / 2; ++k) {
+        const auto a = work[k];
+        const auto b = std::conj(work[half_size - k]);
+        const auto even = 0.5f * (a + b);
+        const auto odd = -half_i * (a - b);
+        work[k] = even + split_twiddles[k] * odd;
+        // Note: the mirrored bin reuses the same terms, conjugated.
+        if (k != half_size - k)
+            work[half_size - k] = std::conj(even) - std::conj(split_twiddles[k] * odd);
+    }
+}
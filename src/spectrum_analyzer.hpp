@@ -0,0 +1,96 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef SPECTRUM_ANALYZER_HPP
+#define SPECTRUM_ANALYZER_HPP
+
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "decoder.hpp"
+
+
+/*
+ * Computes the bars of a spectrum analyzer, and a stereo VU meter, from a short window of
+ * PCM.
+ *
+ * The input is mixed down to mono and decimated to about 24 kHz, then goes through a
+ * fixed-size real FFT: a half-size complex FFT, and a split step. The twiddle factors,
+ * bit-reversal permutation and window are computed once, in the constructor; analyze()
+ * doesn't allocate.
+ *
+ * Bars are log-spaced in frequency, and scaled in dB; they rise immediately and fall
+ * slowly, like a real meter.
+ */
+class spectrum_analyzer {
+
+public:
+
+    static constexpr std::size_t num_bands = 24;
+
+    struct result {
+        std::array<float, num_bands> bands{}; // 0 to 1
+        std::array<float, 2> vu{};            // left and right, 0 to 1
+    };
+
+
+    spectrum_analyzer();
+
+
+    // How many bytes of PCM analyze() uses.
+    [[nodiscard]]
+    std::size_t
+    get_input_size(const decoder::spec& spec)
+        const noexcept;
+
+    // Missing input counts as silence. Only S16 and F32 are analyzed.
+    const result&
+    analyze(std::span<const char> pcm,
+            const decoder::spec& spec)
+        noexcept;
+
+
+    void
+    reset()
+        noexcept;
+
+
+private:
+
+    static constexpr std::size_t fft_size = 512; // real samples
+    static constexpr std::size_t half_size = fft_size / 2;
+
+    std::array<float, fft_size> window;
+    std::array<std::complex<float>, half_size / 2> twiddles; // for the complex FFT
+    std::array<std::complex<float>, half_size> split_twiddles;
+    std::array<unsigned short, half_size> bit_reversed;
+
+    std::array<float, fft_size> samples;
+    std::array<std::complex<float>, half_size> work;
+
+    // First and last FFT bins of each band, for the current rate.
+    int band_rate = 0;
+    std::array<unsigned short, num_bands> band_begin;
+    std::array<unsigned short, num_bands> band_end;
+
+    result current;
+
+
+    void
+    update_bands(int rate)
+        noexcept;
+
+    void
+    fft()
+        noexcept;
+
+}; // class spectrum_analyzer
+
+#endif
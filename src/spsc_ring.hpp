@@ -0,0 +1,173 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <algorithm>            // min()
+#include <atomic>
+#include <bit>                  // bit_ceil()
+#include <cstddef>
+#include <cstring>              // memcpy()
+#include <span>
+#include <type_traits>
+#include <vector>
+
+
+/*
+ * Bounded lock-free ring buffer, for a single producer thread and a single consumer
+ * thread.
+ *
+ * Only the producer may call write() and peek(); only the consumer may call read(),
+ * discard() and clear(). Everything else can be called from any thread, but the result is only a
+ * snapshot.
+ */
+template<typename T>
+requires(std::is_trivially_copyable_v<T>)
+class spsc_ring {
+
+    // Avoid false sharing between the producer and consumer indices.
+    static constexpr std::size_t line_size = 64;
+
+    std::vector<T> buffer;
+    std::size_t mask;
+
+    alignas(line_size) std::atomic<std::size_t> head = 0; // written by consumer
+    alignas(line_size) std::atomic<std::size_t> tail = 0; // written by producer
+
+public:
+
+    // Capacity gets rounded up to a power of two.
+    explicit
+    spsc_ring(std::size_t min_capacity) :
+        buffer(std::bit_ceil(std::max<std::size_t>(min_capacity, 1))),
+        mask{buffer.size() - 1}
+    {}
+
+    // disallow moving
+    spsc_ring(spsc_ring&&) = delete;
+
+
+    std::size_t
+    capacity()
+        const noexcept
+    {
+        return buffer.size();
+    }
+
+
+    std::size_t
+    size()
+        const noexcept
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+
+    bool
+    empty()
+        const noexcept
+    {
+        return size() == 0;
+    }
+
+
+    std::size_t
+    free_space()
+        const noexcept
+    {
+        return capacity() - size();
+    }
+
+
+    // Producer: append as many elements as fit, return how many were written.
+    std::size_t
+    write(std::span<const T> src)
+        noexcept
+    {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        const std::size_t h = head.load(std::memory_order_acquire);
+        const std::size_t count = std::min(src.size(), capacity() - (t - h));
+        if (!count)
+            return 0;
+
+        const std::size_t start = t & mask;
+        const std::size_t first = std::min(count, capacity() - start);
+        std::memcpy(buffer.data() + start, src.data(), first * sizeof(T));
+        std::memcpy(buffer.data(), src.data() + first, (count - first) * sizeof(T));
+
+        tail.store(t + count, std::memory_order_release);
+        return count;
+    }
+
+
+    // Producer: copy up to dst.size() of the oldest elements, without removing them.
+    // Note: the consumer never modifies the elements, and only the producer overwrites
+    // them, so this is safe even while the consumer is reading.
+    std::size_t
+    peek(std::span<T> dst)
+        const noexcept
+    {
+        const std::size_t h = head.load(std::memory_order_acquire);
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        const std::size_t count = std::min(dst.size(), t - h);
+        if (!count)
+            return 0;
+
+        const std::size_t start = h & mask;
+        const std::size_t first = std::min(count, capacity() - start);
+        std::memcpy(dst.data(), buffer.data() + start, first * sizeof(T));
+        std::memcpy(dst.data() + first, buffer.data(), (count - first) * sizeof(T));
+        return count;
+    }
+
+
+    // Consumer: extract up to dst.size() elements, return how many were read.
+    std::size_t
+    read(std::span<T> dst)
+        noexcept
+    {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        const std::size_t t = tail.load(std::memory_order_acquire);
+        const std::size_t count = std::min(dst.size(), t - h);
+        if (!count)
+            return 0;
+
+        const std::size_t start = h & mask;
+        const std::size_t first = std::min(count, capacity() - start);
+        std::memcpy(dst.data(), buffer.data() + start, first * sizeof(T));
+        std::memcpy(dst.data() + first, buffer.data(), (count - first) * sizeof(T));
+
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+
+    // Consumer: drop up to count elements, return how many were dropped.
+    std::size_t
+    discard(std::size_t count)
+        noexcept
+    {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        const std::size_t t = tail.load(std::memory_order_acquire);
+        count = std::min(count, t - h);
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+
+    // Consumer: drop everything currently stored.
+    void
+    clear()
+        noexcept
+    {
+        head.store(tail.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+}; // class spsc_ring
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // max(), ranges::{all_of,find_if,none_of,sort}()
+#include <cstdio>               // snprintf()
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <utility>              // move()
+
+#include "startup_graph.hpp"
+
+#include "thread_policy.hpp"
+
+
+using std::cout;
+using std::endl;
+
+
+startup_graph::startup_graph() :
+    origin{clock_type::now()}
+{}
+
+
+startup_graph::~startup_graph()
+    noexcept
+{
+    // Note: jthread joins on destruction.
+    workers.clear();
+}
+
+
+void
+startup_graph::add(const std::string& name,
+                   const std::vector<std::string>& deps,
+                   where place,
+                   function_t func)
+{
+    if (!workers.empty())
+        throw std::logic_error{"startup_graph: can't add \"" + name + "\" after run()"};
+
+    task t;
+    t.name = name;
+    t.place = place;
+    t.func = std::move(func);
+    for (auto& dep : deps) {
+        auto it = std::ranges::find_if(tasks,
+                                       [&dep](const task& other)
+                                       {
+                                           return other.name == dep;
+                                       });
+        if (it == tasks.end())
+            throw std::logic_error{"startup_graph: \"" + name
+                                   + "\" depends on unknown step \"" + dep + "\""};
+        t.deps.push_back(it - tasks.begin());
+    }
+    tasks.push_back(std::move(t));
+}
+
+
+void
+startup_graph::run()
+{
+    for (auto& t : tasks)
+        if (t.place == where::worker)
+            workers.emplace_back([this, &t]
+                                 {
+                                     thread_policy::apply(thread_policy::role::background);
+                                     execute(t, false);
+                                 });
+
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+        task& t = tasks[i];
+        if (t.place != where::main)
+            continue;
+        try {
+            execute(t, true);
+        }
+        catch (...) {
+            // Nothing else runs on the main thread; let the workers depending on it finish.
+            {
+                std::lock_guard lock{mutex};
+                for (std::size_t j = i + 1; j < tasks.size(); ++j) {
+                    if (tasks[j].place != where::main)
+                        continue;
+                    tasks[j].start_ms = tasks[j].end_ms = now_ms();
+                    tasks[j].done = true;
+                    tasks[j].failed = true;
+                    ++finished;
+                }
+            }
+            finished_cond.notify_all();
+            throw;
+        }
+    }
+}
+
+
+bool
+startup_graph::is_done(std::string_view name)
+    const
+{
+    std::lock_guard lock{mutex};
+    for (auto& t : tasks)
+        if (t.name == name)
+            return t.done;
+    return false;
+}
+
+
+bool
+startup_graph::all_done()
+    const
+{
+    std::lock_guard lock{mutex};
+    return finished == tasks.size();
+}
+
+
+void
+startup_graph::wait()
+{
+    std::unique_lock lock{mutex};
+    finished_cond.wait(lock, [this] { return finished == tasks.size(); });
+}
+
+
+bool
+startup_graph::try_report()
+{
+    std::vector<const task*> sorted;
+    {
+        std::lock_guard lock{mutex};
+        if (reported || finished != tasks.size())
+            return false;
+        reported = true;
+    }
+
+    // Note: no step is running anymore, so no locking is needed from here.
+    double total = 0;
+    for (auto& t : tasks) {
+        sorted.push_back(&t);
+        total = std::max(total, t.end_ms);
+    }
+    std::ranges::sort(sorted, {}, &task::start_ms);
+
+    cout << "Startup timeline (ms):" << endl;
+    for (auto t : sorted) {
+        char buf[160];
+        std::snprintf(buf, sizeof buf,
+                      "  %8.1f .. %8.1f  %-6s  %s%s",
+                      t->start_ms,
+                      t->end_ms,
+                      t->place == where::main ? "main" : "worker",
+                      t->name.data(),
+                      t->failed ? " (failed)" : "");
+        cout << buf << endl;
+    }
+    char buf[64];
+    std::snprintf(buf, sizeof buf, "Startup took %.1f ms", total);
+    cout << buf << endl;
+    return true;
+}
+
+
+bool
+startup_graph::wait_deps(const task& t)
+{
+    std::unique_lock lock{mutex};
+    finished_cond.wait(lock,
+                       [this, &t]
+                       {
+                           return std::ranges::all_of(t.deps,
+                                                      [this](std::size_t d)
+                                                      {
+                                                          return tasks[d].done;
+                                                      });
+                       });
+    return std::ranges::none_of(t.deps,
+                                [this](std::size_t d)
+                                {
+                                    return tasks[d].failed;
+                                });
+}
+
+
+void
+startup_graph::execute(task& t,
+                       bool rethrow)
+{
+    const bool deps_ok = wait_deps(t);
+    const double start = now_ms();
+    bool failed = !deps_ok;
+    std::exception_ptr error;
+
+    if (deps_ok) {
+        try {
+            t.func();
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: startup step \"" << t.name << "\" failed: " << e.what() << endl;
+            failed = true;
+            if (rethrow)
+                error = std::current_exception();
+        }
+    } else
+        cout << "ERROR: startup step \"" << t.name << "\" skipped, a dependency failed"
+             << endl;
+
+    {
+        std::lock_guard lock{mutex};
+        t.start_ms = start;
+        t.end_ms = now_ms();
+        t.failed = failed;
+        t.done = true;
+        ++finished;
+    }
+    finished_cond.notify_all();
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+
+double
+startup_graph::now_ms()
+    const
+{
+    return std::chrono::duration<double, std::milli>(clock_type::now() - origin).count();
+}
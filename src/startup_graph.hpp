@@ -0,0 +1,128 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef STARTUP_GRAPH_HPP
+#define STARTUP_GRAPH_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+/*
+ * Runs the initialization steps as a dependency graph.
+ *
+ * Steps that touch SDL, the renderer or ImGui stay on the main thread, in the order they
+ * were added; the others get their own worker thread, and start as soon as their
+ * dependencies are done. Dependencies must be added before the steps that need them, so
+ * the graph can't have cycles.
+ *
+ * The start and end time of every step is logged, once they are all done.
+ */
+class startup_graph {
+
+public:
+
+    enum class where {
+        main,
+        worker,
+    };
+
+    using function_t = std::function<void()>;
+
+
+    startup_graph();
+
+    // Waits for the workers.
+    ~startup_graph()
+        noexcept;
+
+
+    // Throws std::logic_error if a dependency wasn't added yet.
+    void
+    add(const std::string& name,
+        const std::vector<std::string>& deps,
+        where place,
+        function_t func);
+
+
+    /*
+     * Start the workers, and run the main thread steps; returns when those are done.
+     *
+     * If a main thread step throws, the steps depending on it are skipped, and the
+     * exception is propagated.
+     */
+    void
+    run();
+
+
+    [[nodiscard]]
+    bool
+    is_done(std::string_view name)
+        const;
+
+    [[nodiscard]]
+    bool
+    all_done()
+        const;
+
+    void
+    wait();
+
+
+    // Print the timeline, only the first time it's called after all steps are done.
+    bool
+    try_report();
+
+private:
+
+    using clock_type = std::chrono::steady_clock;
+
+    struct task {
+        std::string name;
+        std::vector<std::size_t> deps;
+        where place;
+        function_t func;
+        bool done = false;
+        bool failed = false;
+        double start_ms = 0;
+        double end_ms = 0;
+    };
+
+    std::vector<task> tasks;
+    std::size_t finished = 0;
+    bool reported = false;
+
+    mutable std::mutex mutex;
+    std::condition_variable finished_cond;
+
+    std::vector<std::jthread> workers;
+
+    clock_type::time_point origin;
+
+
+    // Returns false if a dependency failed.
+    bool
+    wait_deps(const task& t);
+
+    void
+    execute(task& t,
+            bool rethrow);
+
+    double
+    now_ms()
+        const;
+
+}; // class startup_graph
+
+#endif
@@ -0,0 +1,22 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "station_arena.hpp"
+
+#include "Station.hpp"
+
+
+std::vector<std::shared_ptr<Station>>
+station_arena::make_page(std::size_t count)
+{
+    auto page = std::make_shared<std::vector<Station>>(count);
+    std::vector<std::shared_ptr<Station>> result;
+    result.reserve(count);
+    for (auto& st : *page)
+        result.emplace_back(page, &st);
+    return result;
+}
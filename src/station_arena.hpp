@@ -0,0 +1,67 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef STATION_ARENA_HPP
+#define STATION_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+struct Station;
+
+
+/*
+ * Storage for one result set of stations, allocated as a single slab.
+ *
+ * The stations are handed out as shared_ptr that alias the slab: whoever still holds one
+ * keeps the whole slab alive, so they are always safe to use. Long-lived holders, like
+ * favorites and recent, copy the station instead of keeping the pointer.
+ *
+ * When the next result set arrives, the slab is reused in place if nobody else holds any
+ * of its stations, so the strings keep their capacity.
+ */
+class station_arena {
+
+    // Type-erased, so the slab can hold a type derived from Station.
+    std::shared_ptr<void> slab;
+
+    // The slab's reserved room, while a page is arriving; nothing is added past it.
+    std::size_t page_limit = 0;
+
+    friend struct Station;
+
+public:
+
+    // Allocate a slab of count default-constructed stations.
+    static
+    std::vector<std::shared_ptr<Station>>
+    make_page(std::size_t count);
+
+
+    // True if some of the stations are still referenced from outside.
+    [[nodiscard]]
+    bool
+    in_use()
+        const noexcept
+    {
+        return slab && slab.use_count() > 1;
+    }
+
+
+    void
+    reset()
+        noexcept
+    {
+        slab.reset();
+        page_limit = 0;
+    }
+
+}; // class station_arena
+
+#endif
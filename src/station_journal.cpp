@@ -0,0 +1,214 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // max(), ranges::sort()
+#include <iostream>
+#include <vector>
+
+#include <glaze/json.hpp>
+#include <glaze/exceptions/json_exceptions.hpp>
+
+#include "station_journal.hpp"
+
+
+using std::cout;
+using std::endl;
+
+
+namespace {
+
+    // Note: not prettified, one record per line.
+    constexpr glz::opts line_options{
+        .error_on_unknown_keys = false,
+    };
+
+
+    /*
+     * Returns the number of lines. Bad lines are skipped; so is a torn last line, from a
+     * crash while appending: complete_size is where it starts.
+     */
+    std::size_t
+    read_journal(const std::filesystem::path& filename,
+                 std::vector<station_journal::record>& records,
+                 std::uintmax_t& complete_size)
+    {
+        std::ifstream input{filename, std::ios::binary};
+        std::size_t lines = 0;
+        complete_size = 0;
+        std::string line;
+        while (getline(input, line)) {
+            if (input.eof()) {
+                cout << "WARNING: dropping torn record at the end of " << filename << endl;
+                break;
+            }
+            ++lines;
+            complete_size += line.size() + 1;
+            try {
+                station_journal::record r;
+                glz::ex::read<line_options>(r, line);
+                records.push_back(std::move(r));
+            }
+            catch (std::exception& e) {
+                cout << "WARNING: skipping bad record in " << filename
+                     << ": " << e.what() << endl;
+            }
+        }
+        return lines;
+    }
+
+} // namespace
+
+
+station_journal::station_journal(const std::filesystem::path& snapshot_path) :
+    snapshot_path{snapshot_path}
+{
+    const auto stem = snapshot_path.stem().string();
+    journal_paths[0] = snapshot_path.parent_path() / (stem + "-0.journal");
+    journal_paths[1] = snapshot_path.parent_path() / (stem + "-1.journal");
+}
+
+
+void
+station_journal::add(const Station& st)
+{
+    append({.op = "add", .station = st});
+}
+
+
+void
+station_journal::remove(std::size_t index,
+                        std::size_t count)
+{
+    append({.op = "remove", .index = index, .count = count});
+}
+
+
+void
+station_journal::move(std::size_t from,
+                      std::size_t to)
+{
+    append({.op = "move", .index = from, .count = to});
+}
+
+
+void
+station_journal::edit(std::size_t index,
+                      const Station& st)
+{
+    append({.op = "edit", .index = index, .station = st});
+}
+
+
+bool
+station_journal::replay(const std::function<void(const record&)>& func)
+{
+    struct journal_info {
+        std::vector<record> records;
+        std::size_t lines = 0;
+        std::uintmax_t complete_size = 0;
+        std::uint64_t max_seq = 0;
+    };
+    journal_info infos[2];
+    for (unsigned i = 0; i < 2; ++i) {
+        infos[i].lines = read_journal(journal_paths[i],
+                                      infos[i].records,
+                                      infos[i].complete_size);
+        for (auto& r : infos[i].records)
+            infos[i].max_seq = std::max(infos[i].max_seq, r.seq);
+    }
+
+    active = infos[1].max_seq > infos[0].max_seq ? 1 : 0;
+    active_records = infos[active].lines;
+    const unsigned other = 1 - active;
+
+    std::vector<record> pending;
+    bool needs_other = false;
+    for (unsigned i = 0; i < 2; ++i)
+        for (auto& r : infos[i].records)
+            if (r.seq > snapshot_seq) {
+                pending.push_back(std::move(r));
+                if (i == other)
+                    needs_other = true;
+            }
+    std::ranges::sort(pending, {}, &record::seq);
+
+    seq = snapshot_seq;
+    for (auto& r : pending) {
+        func(r);
+        seq = r.seq;
+    }
+
+    // Note: a torn line is cut off, or the next record would be appended to it.
+    std::error_code ec;
+    if (exists(journal_paths[active], ec)
+        && file_size(journal_paths[active], ec) != infos[active].complete_size) {
+        resize_file(journal_paths[active], infos[active].complete_size, ec);
+        if (ec)
+            cout << "ERROR: could not truncate " << journal_paths[active]
+                 << ": " << ec.message() << endl;
+    }
+
+    output.open(journal_paths[active], std::ios::app);
+    if (!output)
+        cout << "ERROR: could not open " << journal_paths[active] << endl;
+    return needs_other;
+}
+
+
+void
+station_journal::append(record&& r)
+{
+    r.seq = ++seq;
+    std::string line;
+    glz::ex::write<line_options>(r, line);
+    line += '\n';
+    output.write(line.data(), line.size());
+    output.flush();
+    if (!output) {
+        cout << "ERROR: could not write to " << journal_paths[active] << endl;
+        output.clear();
+    }
+    ++active_records;
+}
+
+
+void
+station_journal::rotate()
+{
+    output.close();
+    active = 1 - active;
+    active_records = 0;
+    output.open(journal_paths[active], std::ios::trunc);
+    if (!output)
+        cout << "ERROR: could not open " << journal_paths[active] << endl;
+}
+
+
+void
+station_journal::move_aside(const std::exception& e)
+    noexcept
+{
+    cout << "ERROR: could not load " << snapshot_path << ": " << e.what() << endl;
+
+    const std::filesystem::path paths[] = {
+        snapshot_path,
+        snapshot_path.string() + ".old",
+        journal_paths[0],
+        journal_paths[1],
+    };
+    for (const auto& path : paths) {
+        std::error_code ec;
+        if (!exists(path, ec))
+            continue;
+        std::filesystem::path bad = path.string() + ".bad";
+        rename(path, bad, ec);
+        if (ec)
+            cout << "ERROR: could not rename " << path << ": " << ec.message() << endl;
+        else
+            cout << "Moved " << path << " to " << bad << endl;
+    }
+}
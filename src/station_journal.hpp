@@ -0,0 +1,223 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef STATION_JOURNAL_HPP
+#define STATION_JOURNAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>             // next()
+#include <memory>               // make_shared(), shared_ptr
+#include <optional>
+#include <string>
+#include <utility>              // move()
+
+#include "Serializer.hpp"
+#include "Station.hpp"
+
+
+/*
+ * Persistence for a list of stations, as a snapshot plus an append-only journal.
+ *
+ * Every change is appended to the journal as one JSON line, so its cost doesn't depend on
+ * the size of the list. Once the journal has enough records, a new snapshot is queued to
+ * Serializer's background writer, and the journal starts over.
+ *
+ * Two journal files are used alternately, and every record has a sequence number: a new
+ * snapshot may not be written yet when the journal is switched, so the previous journal
+ * is kept until the snapshot after it is known to be on disk. When loading, only the
+ * records newer than the snapshot are replayed.
+ */
+class station_journal {
+
+public:
+
+    struct record {
+        std::uint64_t seq = 0;
+        // "add", "remove", "move" or "edit".
+        std::string op;
+        std::size_t index = 0;
+        // How many stations to remove, or where to move it to.
+        std::size_t count = 0;
+        std::optional<Station> station = {};
+    };
+
+
+    template<typename List>
+    struct snapshot {
+        std::uint64_t seq = 0;
+        List stations;
+    };
+
+
+    // The journal files are next to the snapshot.
+    explicit
+    station_journal(const std::filesystem::path& snapshot_path);
+
+
+    /*
+     * Load the snapshot and replay the journal.
+     *
+     * Without a snapshot, the old ".json" file is loaded, as a plain list.
+     *
+     * A snapshot that can't be read is renamed to ".bad", along with the journals that
+     * depend on it, and the list starts empty; so the next snapshot never overwrites it.
+     */
+    template<typename List>
+    void
+    load(List& stations)
+    {
+        snapshot<List> snap;
+        const auto json_path = Serializer::get_json_path(snapshot_path);
+        try {
+            if (exists(snapshot_path)
+                || exists(std::filesystem::path{snapshot_path.string() + ".old"}))
+                Serializer::load(snap, snapshot_path);
+            else if (Serializer::can_load(json_path))
+                Serializer::load(snap.stations, json_path);
+        }
+        catch (std::exception& e) {
+            move_aside(e);
+            snap = {};
+        }
+        stations = std::move(snap.stations);
+        snapshot_seq = snap.seq;
+
+        bool needs_snapshot = replay([&stations](const record& r)
+        {
+            apply(stations, r);
+        });
+        if (needs_snapshot) {
+            // Note: the old journal must not be reused until this snapshot is on disk.
+            Serializer::save(snapshot<List>{seq, stations}, snapshot_path);
+            snapshot_seq = seq;
+        }
+    }
+
+
+    void
+    add(const Station& st);
+
+    void
+    remove(std::size_t index,
+           std::size_t count = 1);
+
+    void
+    move(std::size_t from,
+         std::size_t to);
+
+    void
+    edit(std::size_t index,
+         const Station& st);
+
+
+    // Call after every change; a snapshot is only made once the journal is long enough.
+    template<typename List>
+    void
+    maybe_compact(const List& stations)
+    {
+        if (active_records >= max_records)
+            compact(stations);
+    }
+
+
+    template<typename List>
+    void
+    compact(const List& stations)
+    {
+        // The journal being reused must be covered by the last snapshot, on disk.
+        if (Serializer::is_queued(snapshot_path))
+            Serializer::flush();
+        Serializer::save_async(snapshot<List>{seq, stations}, snapshot_path);
+        snapshot_seq = seq;
+        rotate();
+    }
+
+
+    // Queue the final snapshot, if anything changed, and close the journal.
+    template<typename List>
+    void
+    close(const List& stations)
+    {
+        if (seq != snapshot_seq) {
+            Serializer::save_async(snapshot<List>{seq, stations}, snapshot_path);
+            snapshot_seq = seq;
+        }
+        output.close();
+    }
+
+
+    template<typename List>
+    static
+    void
+    apply(List& stations,
+          const record& r)
+    {
+        if (r.op == "add") {
+            if (r.station)
+                stations.push_back(std::make_shared<Station>(*r.station));
+        } else if (r.op == "remove") {
+            if (r.index < stations.size() && r.count <= stations.size() - r.index) {
+                auto first = std::next(stations.begin(), r.index);
+                stations.erase(first, std::next(first, r.count));
+            }
+        } else if (r.op == "move") {
+            if (r.index < stations.size() && r.count < stations.size()) {
+                auto tmp = std::move(stations[r.index]);
+                stations.erase(std::next(stations.begin(), r.index));
+                stations.insert(std::next(stations.begin(), r.count), std::move(tmp));
+            }
+        } else if (r.op == "edit") {
+            if (r.station && r.index < stations.size())
+                *stations[r.index] = *r.station;
+        }
+    }
+
+private:
+
+    // Records in the active journal before a snapshot is made.
+    static constexpr std::size_t max_records = 128;
+
+    std::filesystem::path snapshot_path;
+    std::filesystem::path journal_paths[2];
+    unsigned active = 0;
+    std::size_t active_records = 0;
+    std::ofstream output;
+
+    std::uint64_t seq = 0;
+    std::uint64_t snapshot_seq = 0;
+
+
+    /*
+     * Call func for every record newer than snapshot_seq, in order; then open the journal
+     * with the newest records for appending.
+     *
+     * Returns true if records from the other journal were needed, so it can't be reused
+     * before a new snapshot is written.
+     */
+    bool
+    replay(const std::function<void(const record&)>& func);
+
+    void
+    append(record&& r);
+
+    // Switch to the other journal, emptying it.
+    void
+    rotate();
+
+    // Report the error, and rename the snapshot and the journals, adding ".bad".
+    void
+    move_aside(const std::exception& e)
+        noexcept;
+
+}; // class station_journal
+
+#endif
@@ -0,0 +1,613 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // erase_if(), min()
+#include <charconv>             // from_chars()
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>              // move()
+
+#include "station_prober.hpp"
+
+#include "App.hpp"
+#include "decoder.hpp"
+#include "http_client.hpp"
+#include "m3u.hpp"
+#include "mime_type.hpp"
+#include "pls.hpp"
+#include "resolved_url_cache.hpp"
+#include "Serializer.hpp"
+#include "thread_policy.hpp"
+#include "thread_safe.hpp"
+#include "tracer.hpp"
+
+
+using std::cout;
+using std::endl;
+
+using namespace std::literals;
+
+
+namespace station_prober {
+
+    namespace {
+
+        using clock = std::chrono::steady_clock;
+
+
+        enum class response_kind {
+            m3u,
+            pls,
+            audio,
+        };
+
+        // Note: the playlists must come before "audio/*".
+        constexpr mime_type::table response_kinds{
+            mime_type::rule{ "*/*mpegurl*",     response_kind::m3u   },
+            mime_type::rule{ "audio/x-scpls",   response_kind::pls   },
+            mime_type::rule{ "audio/*",         response_kind::audio },
+            mime_type::rule{ "application/ogg", response_kind::audio },
+        };
+
+
+        // Connections open at the same time; probing should never compete with playback.
+        const std::size_t max_probes = 2;
+
+        // Don't start probes faster than this.
+        const auto start_interval = 2s;
+
+        // While probes are running, they're processed this often.
+        const auto poll_interval = 50ms;
+
+        const auto probe_timeout = 15s;
+
+        // How long until a station is checked again.
+        const auto ok_interval = std::chrono::hours{12};
+        const auto failed_interval = std::chrono::hours{1};
+
+        // Bigger playlists are not playlists.
+        const std::size_t max_playlist_size = 64 * 1024;
+
+        // Playlists pointing to playlists.
+        const unsigned max_playlist_hops = 2;
+
+
+        using result_map = std::map<std::string, result>;
+        thread_safe<result_map> results;
+
+        std::filesystem::path results_filename;
+        std::string user_agent;
+
+        // Protects targets, enabled and changed.
+        std::mutex mutex;
+        std::condition_variable_any changed_cv;
+        std::vector<target> targets;
+        bool enabled = true;
+        bool changed = false;
+
+        std::jthread worker_thread;
+
+
+        std::int64_t
+        now_seconds()
+        {
+            using namespace std::chrono;
+            return duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+        }
+
+
+        // The URL the player starts from.
+        const std::string&
+        get_start_url(const target& t)
+            noexcept
+        {
+            return t.url_resolved.empty() ? t.url : t.url_resolved;
+        }
+
+
+        unsigned
+        to_unsigned(const std::string& str)
+            noexcept
+        {
+            unsigned result = 0;
+            // Note: "icy-br" is sometimes a list, like "128,128"; only the first is used.
+            std::from_chars(str.data(), str.data() + str.size(), result);
+            return result;
+        }
+
+
+        // Follows one station, from its first URL to the first bytes of audio.
+        class probe {
+
+            enum class phase {
+                headers,
+                playlist,
+                audio,
+            };
+
+            http_client http{user_agent};
+            std::vector<std::string> urls; // to try, in order
+            std::size_t next_url = 0;
+            std::string current_url;
+            phase current_phase = phase::headers;
+            response_kind playlist_kind = response_kind::m3u;
+            std::string playlist;
+            unsigned hops = 0;
+            std::size_t sample_size = decoder::probe_window;
+            clock::time_point deadline;
+            bool headers_ready = false;
+            bool transfer_finished = false;
+
+        public:
+
+            const target tgt;
+            // Set if the player would use a URL from resolved_url_cache.
+            const std::optional<std::string> cached_url;
+            result res;
+            bool done = false;
+
+
+            probe(const target& t) :
+                tgt{t},
+                cached_url{resolved_url_cache::lookup(get_start_url(t))}
+            {
+                http.add_header("Icy-MetaData: 1");
+                // Note: only the first bytes are needed, the stream shouldn't pile up.
+                http.set_watermarks(decoder::probe_window, 4 * decoder::probe_window);
+                http.on_response_started = [this] { headers_ready = true; };
+                http.on_response_finished = [this] { transfer_finished = true; };
+
+                if (cached_url)
+                    urls.push_back(*cached_url);
+                urls.push_back(get_start_url(tgt));
+                if (!tgt.url.empty() && tgt.url != get_start_url(tgt))
+                    urls.push_back(tgt.url);
+                try {
+                    try_next();
+                }
+                catch (std::exception& e) {
+                    fail(e.what());
+                }
+            }
+
+
+            void
+            process()
+            {
+                if (done)
+                    return;
+
+                try {
+                    http.process();
+
+                    if (current_phase == phase::headers && headers_ready) {
+                        headers_ready = false;
+                        if (!handle_headers())
+                            return;
+                    }
+
+                    if (current_phase != phase::headers && !handle_data())
+                        return;
+
+                    if (transfer_finished) {
+                        transfer_finished = false;
+                        handle_finished();
+                        return;
+                    }
+                }
+                catch (std::exception& e) {
+                    fail(e.what());
+                    return;
+                }
+
+                if (clock::now() > deadline)
+                    fail("timed out");
+            }
+
+        private:
+
+            void
+            try_next()
+            {
+                if (next_url >= urls.size()) {
+                    done = true;
+                    return;
+                }
+                hops = 0;
+                connect(urls[next_url++]);
+            }
+
+
+            void
+            connect(const std::string& url)
+            {
+                current_url = url;
+                current_phase = phase::headers;
+                playlist.clear();
+                sample_size = decoder::probe_window;
+                headers_ready = false;
+                transfer_finished = false;
+                deadline = clock::now() + probe_timeout;
+                http.set_url(url);
+            }
+
+
+            void
+            fail(const std::string& msg)
+            {
+                cout << "station_prober: \"" << current_url << "\": " << msg << endl;
+                res = {};
+                res.error = msg;
+                try {
+                    try_next();
+                }
+                catch (std::exception& e) {
+                    res.error = e.what();
+                    done = true;
+                }
+            }
+
+
+            void
+            succeed()
+            {
+                auto codec = decoder::probe_content_type(res.content_type);
+                if (codec == decoder::codec::unknown && current_phase == phase::audio) {
+                    const auto sample = http.data_stream.read_as<char>(sample_size);
+                    codec = decoder::probe_data(sample);
+                }
+                if (codec != decoder::codec::unknown)
+                    res.codec = decoder::to_string(codec);
+                res.ok = true;
+                res.url = current_url;
+                res.error.clear();
+                done = true;
+            }
+
+
+            // Returns false if it moved on to another URL, or finished.
+            bool
+            handle_headers()
+            {
+                auto content_type = http.get_header("content-type");
+                if (!content_type) {
+                    fail("no content-type");
+                    return false;
+                }
+
+                const auto kind = response_kinds.lookup(*content_type);
+                if (!kind) {
+                    fail("unknown content-type: " + *content_type);
+                    return false;
+                }
+
+                if (*kind != response_kind::audio) {
+                    playlist_kind = *kind;
+                    current_phase = phase::playlist;
+                    return true;
+                }
+
+                res = {};
+                res.content_type = *content_type;
+                res.name = http.get_header("icy-name").value_or("");
+                res.bitrate = to_unsigned(http.get_header("icy-br").value_or(""));
+                // Note: past the metadata interval, there's metadata mixed in.
+                const auto metaint = http.get_header("icy-metaint").value_or("");
+                if (auto interval = to_unsigned(metaint))
+                    sample_size = std::min<std::size_t>(sample_size, interval);
+                current_phase = phase::audio;
+                return true;
+            }
+
+
+            // Returns false if it moved on to another URL, or finished.
+            bool
+            handle_data()
+            {
+                if (current_phase == phase::playlist) {
+                    playlist += http.data_stream.read_str();
+                    if (playlist.size() > max_playlist_size) {
+                        fail("playlist is too big");
+                        return false;
+                    }
+                    return true;
+                }
+
+                if (http.data_stream.size() < sample_size)
+                    return true;
+                succeed();
+                return false;
+            }
+
+
+            void
+            handle_finished()
+            {
+                switch (current_phase) {
+
+                    case phase::headers:
+                        fail("no response");
+                        return;
+
+                    case phase::audio:
+                        // Note: short files can be smaller than the sample.
+                        if (http.data_stream.empty()) {
+                            fail("no audio data");
+                            return;
+                        }
+                        sample_size = http.data_stream.size();
+                        succeed();
+                        return;
+
+                    case phase::playlist:
+                        break;
+
+                }
+
+                std::optional<std::string> next;
+                if (playlist_kind == response_kind::m3u) {
+                    // Note: the player follows HLS itself; there's no stream URL.
+                    if (playlist.contains("#EXT-X-")) {
+                        res = {};
+                        res.content_type = http.get_header("content-type").value_or("");
+                        res.codec = "HLS";
+                        succeed();
+                        return;
+                    }
+                    m3u::parser parser;
+                    parser.feed(playlist);
+                    parser.finish();
+                    next = parser.first_url();
+                } else {
+                    pls::parser parser;
+                    parser.feed(playlist);
+                    parser.finish();
+                    next = parser.first_url();
+                }
+
+                if (!next) {
+                    fail("empty playlist");
+                    return;
+                }
+                if (++hops > max_playlist_hops) {
+                    fail("too many nested playlists");
+                    return;
+                }
+                connect(*next);
+            }
+
+        }; // class probe
+
+
+        bool
+        is_active(const std::vector<std::unique_ptr<probe>>& active,
+                  const std::string& key)
+        {
+            return std::ranges::any_of(active,
+                                       [&key](const auto& p)
+                                       {
+                                           return p->tgt.key == key;
+                                       });
+        }
+
+
+        // The station checked longest ago, if it's due; otherwise, how long until one is.
+        std::optional<target>
+        pick_due(const std::vector<std::unique_ptr<probe>>& active,
+                 clock::duration& wait)
+        {
+            using std::chrono::duration_cast;
+            using std::chrono::seconds;
+            const auto now = now_seconds();
+            const target* best = nullptr;
+            std::int64_t best_due = 0;
+            std::int64_t next_due = now + duration_cast<seconds>(wait).count();
+
+            auto res = results.lock();
+            for (auto& t : targets) {
+                if (t.key.empty() || is_active(active, t.key))
+                    continue;
+                std::int64_t due = 0;
+                auto it = res->find(t.key);
+                if (it != res->end()) {
+                    const auto interval = it->second.ok ? ok_interval : failed_interval;
+                    due = it->second.timestamp
+                        + duration_cast<seconds>(interval).count();
+                }
+                if (due > now) {
+                    next_due = std::min(next_due, due);
+                    continue;
+                }
+                if (!best || due < best_due) {
+                    best = &t;
+                    best_due = due;
+                }
+            }
+
+            if (best)
+                return *best;
+            wait = seconds{next_due - now};
+            return {};
+        }
+
+
+        void
+        store(probe& p)
+        {
+            {
+                std::lock_guard guard{mutex};
+                // Note: the station may have been removed meanwhile.
+                auto same_key = [&p](const target& t) { return t.key == p.tgt.key; };
+                if (std::ranges::none_of(targets, same_key))
+                    return;
+            }
+
+            const auto& start_url = get_start_url(p.tgt);
+            if (p.res.ok) {
+                cout << "station_prober: \"" << p.tgt.key << "\" works: " << p.res.url
+                     << endl;
+                if (p.res.url != start_url)
+                    resolved_url_cache::store(start_url, p.res.url);
+                else if (p.cached_url)
+                    resolved_url_cache::invalidate(start_url);
+            } else if (p.cached_url)
+                resolved_url_cache::invalidate(start_url);
+
+            p.res.timestamp = now_seconds();
+            results.lock()->insert_or_assign(p.tgt.key, std::move(p.res));
+            App::request_redraw();
+        }
+
+
+        void
+        worker_func(std::stop_token token)
+        {
+            tracer::set_thread_name("station prober");
+            thread_policy::apply(thread_policy::role::network);
+
+            std::vector<std::unique_ptr<probe>> active;
+            clock::time_point last_start{};
+
+            while (!token.stop_requested()) {
+                try {
+                    clock::duration wait = 1min;
+                    std::optional<target> next;
+                    {
+                        std::lock_guard guard{mutex};
+                        changed = false;
+                        if (!enabled)
+                            active.clear();
+                        else if (active.size() < max_probes) {
+                            const auto since_start = clock::now() - last_start;
+                            if (since_start >= start_interval)
+                                next = pick_due(active, wait);
+                            else
+                                wait = start_interval - since_start;
+                        }
+                    }
+
+                    if (next) {
+                        active.push_back(std::make_unique<probe>(*next));
+                        last_start = clock::now();
+                    }
+
+                    for (auto& p : active) {
+                        p->process();
+                        if (p->done)
+                            store(*p);
+                    }
+                    std::erase_if(active, [](const auto& p) { return p->done; });
+
+                    if (!active.empty())
+                        wait = std::min<clock::duration>(wait, poll_interval);
+                    std::unique_lock lock{mutex};
+                    changed_cv.wait_for(lock, token, wait, [] { return changed; });
+                }
+                catch (std::exception& e) {
+                    cout << "ERROR: station_prober::worker_func(): " << e.what() << endl;
+                    active.clear();
+                    std::this_thread::sleep_for(start_interval);
+                }
+            }
+        }
+
+    } // namespace
+
+
+    void
+    initialize(const std::filesystem::path& filename)
+    {
+        TRACE_FUNC;
+
+        results_filename = filename;
+        user_agent = App::get_user_agent();
+        try {
+            if (Serializer::can_load(results_filename)) {
+                result_map loaded;
+                Serializer::load(loaded, results_filename);
+                results.store(std::move(loaded));
+            }
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: station_prober::initialize(): " << e.what() << endl;
+        }
+
+        worker_thread = std::jthread{worker_func};
+    }
+
+
+    void
+    finalize()
+    {
+        TRACE_FUNC;
+
+        worker_thread = {};
+
+        if (results_filename.empty())
+            return;
+        try {
+            Serializer::save(results.load(), results_filename);
+        }
+        catch (std::exception& e) {
+            cout << "ERROR: station_prober::finalize(): " << e.what() << endl;
+        }
+    }
+
+
+    void
+    set_enabled(bool enable)
+    {
+        {
+            std::lock_guard guard{mutex};
+            enabled = enable;
+            changed = true;
+        }
+        changed_cv.notify_all();
+    }
+
+
+    void
+    set_targets(std::vector<target> new_targets)
+    {
+        {
+            auto res = results.lock();
+            std::erase_if(*res,
+                          [&new_targets](const auto& kv)
+                          {
+                              return std::ranges::none_of(new_targets,
+                                                          [&kv](const target& t)
+                                                          {
+                                                              return t.key == kv.first;
+                                                          });
+                          });
+        }
+        {
+            std::lock_guard guard{mutex};
+            targets = std::move(new_targets);
+            changed = true;
+        }
+        changed_cv.notify_all();
+    }
+
+
+    std::optional<result>
+    lookup(const std::string& key)
+    {
+        auto res = results.lock();
+        auto it = res->find(key);
+        if (it == res->end())
+            return {};
+        return it->second;
+    }
+
+} // namespace station_prober
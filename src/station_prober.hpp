@@ -0,0 +1,74 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef STATION_PROBER_HPP
+#define STATION_PROBER_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+/*
+ * Checks, in the background, that the favorite stations still work.
+ *
+ * Each station is connected to, through its playlist if it has one, only until the
+ * response headers and the first bytes of audio arrive; that's enough to know the content
+ * type, the ICY headers and the codec. A few stations are checked at the same time, and
+ * each one is checked again after a while: sooner if it failed.
+ *
+ * The stream URL that worked goes into resolved_url_cache, so the player connects
+ * straight to it.
+ */
+namespace station_prober {
+
+    struct result {
+        bool         ok = false;
+        std::string  url;           // the stream that worked
+        std::string  content_type;
+        std::string  codec;         // empty if unknown
+        std::string  name;          // from "icy-name"
+        unsigned     bitrate = 0;   // from "icy-br", in kbps
+        std::string  error;
+        std::int64_t timestamp = 0; // seconds since the epoch
+    };
+
+
+    struct target {
+        std::string key;            // station uuid, or url
+        std::string url;
+        std::string url_resolved;
+    };
+
+
+    // Loads old results from filename, and starts the worker thread.
+    void
+    initialize(const std::filesystem::path& filename);
+
+    // Stops the worker thread, and saves the results.
+    void
+    finalize();
+
+
+    void
+    set_enabled(bool enable);
+
+
+    // What to check from now on; results for other stations are forgotten.
+    void
+    set_targets(std::vector<target> new_targets);
+
+
+    [[nodiscard]]
+    std::optional<result>
+    lookup(const std::string& key);
+
+} // namespace station_prober
+
+#endif
@@ -11,6 +11,7 @@
 
 #ifdef __WIIU__
 
+#include <cstddef>
 #include <mutex>
 #include <optional>
 #include <string>
@@ -22,6 +23,8 @@
 #include <whb/log_module.h>
 #include <whb/log_udp.h>
 
+#include "logging.hpp"
+
 
 std::optional<std::mutex> whb_log_mutex; // initialized by stderr code.
 
@@ -68,11 +71,10 @@ fini_whb_log()
 }
 
 
-ssize_t
-devoptab_to_whb_log(struct _reent*,
-                    void*,
-                    const char* buf,
-                    size_t len)
+// Note: called by the logging module, from its flusher thread once it's running.
+void
+whb_log_write(const char* buf,
+              std::size_t len)
     noexcept
 {
     try {
@@ -85,11 +87,21 @@ devoptab_to_whb_log(struct _reent*,
         } else {
             WHBLogWrite(msg.data());
         }
-        return len;
-    }
-    catch (...) {
-        return -1;
     }
+    catch (...) {}
+}
+
+
+ssize_t
+devoptab_to_whb_log(struct _reent*,
+                    void*,
+                    const char* buf,
+                    size_t len)
+    noexcept
+{
+    // Note: this only queues the text, so logging threads don't wait for WHBLogWrite().
+    logging::write({buf, len});
+    return len;
 }
 
 
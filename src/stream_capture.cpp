@@ -0,0 +1,181 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // max()
+#include <array>
+
+#include "stream_capture.hpp"
+
+#include "string_utils.hpp"
+
+
+using namespace std::literals;
+
+
+namespace stream_capture {
+
+    namespace {
+
+        const std::string magic = "RADIIU-CAPTURE 1";
+
+
+        template<typename T>
+        void
+        store_le(std::ofstream& out,
+                 T value)
+        {
+            std::array<char, sizeof(T)> buf;
+            for (std::size_t i = 0; i < sizeof(T); ++i)
+                buf[i] = static_cast<char>(value >> (8 * i));
+            out.write(buf.data(), buf.size());
+        }
+
+
+        template<typename T>
+        bool
+        load_le(std::ifstream& in,
+                T& value)
+        {
+            std::array<unsigned char, sizeof(T)> buf;
+            if (!in.read(reinterpret_cast<char*>(buf.data()), buf.size()))
+                return false;
+            value = 0;
+            for (std::size_t i = 0; i < sizeof(T); ++i)
+                value |= static_cast<T>(buf[i]) << (8 * i);
+            return true;
+        }
+
+    } // namespace
+
+
+    error::error(const std::string& msg) :
+        std::runtime_error{"capture error: " + msg}
+    {}
+
+
+    std::optional<std::string>
+    header::get(std::string_view name)
+        const
+    {
+        for (auto& [key, value] : fields)
+            if (string_utils::equal_case(key, name))
+                return value;
+        return {};
+    }
+
+
+    writer::writer(const std::filesystem::path& path,
+                   const header& hdr) :
+        out{path, std::ios::binary},
+        start{std::chrono::steady_clock::now()}
+    {
+        if (!out)
+            throw error{"could not create " + path.string()};
+        out << magic << '\n'
+            << hdr.url << '\n';
+        for (auto& [key, value] : hdr.fields)
+            out << key << ": " << value << '\n';
+        out << '\n';
+    }
+
+
+    void
+    writer::write(std::span<const char> data)
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - start);
+        store_le<std::uint64_t>(out, elapsed.count());
+        store_le<std::uint32_t>(out, data.size());
+        out.write(data.data(), data.size());
+    }
+
+
+    reader::reader(const std::filesystem::path& path) :
+        in{path, std::ios::binary}
+    {
+        if (!in)
+            throw error{"could not open " + path.string()};
+
+        std::string line;
+        if (!std::getline(in, line) || line != magic)
+            throw error{path.string() + " is not a capture file"};
+        if (!std::getline(in, hdr.url))
+            throw error{"missing URL"};
+        while (std::getline(in, line) && !line.empty()) {
+            auto colon = line.find(": ");
+            if (colon == std::string::npos)
+                throw error{"invalid header line: " + line};
+            hdr.fields.emplace_back(line.substr(0, colon), line.substr(colon + 2));
+        }
+    }
+
+
+    const header&
+    reader::get_header()
+        const noexcept
+    {
+        return hdr;
+    }
+
+
+    bool
+    reader::next(chunk& out)
+    {
+        std::uint64_t time;
+        if (!load_le(in, time))
+            return false;
+        std::uint32_t size;
+        if (!load_le(in, size))
+            throw error{"truncated chunk"};
+        out.time = std::chrono::microseconds{time};
+        out.data.resize(size);
+        if (!in.read(out.data.data(), size))
+            throw error{"truncated chunk"};
+        return true;
+    }
+
+
+    player::player(const std::filesystem::path& path,
+                   double speed) :
+        rd{path},
+        speed{std::max(speed, 0.0)},
+        start{std::chrono::steady_clock::now()}
+    {
+        has_pending = rd.next(pending);
+    }
+
+
+    const header&
+    player::get_header()
+        const noexcept
+    {
+        return rd.get_header();
+    }
+
+
+    std::chrono::milliseconds
+    player::time_until_next()
+        const
+    {
+        if (!has_pending || speed == 0)
+            return 0ms;
+        auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                               pending.time / speed);
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(
+                        due - std::chrono::steady_clock::now());
+        return std::max(left, 0ms);
+    }
+
+
+    bool
+    player::finished()
+        const noexcept
+    {
+        return !has_pending;
+    }
+
+} // namespace stream_capture
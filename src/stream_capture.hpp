@@ -0,0 +1,158 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef STREAM_CAPTURE_HPP
+#define STREAM_CAPTURE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+/*
+ * Recording of a raw HTTP response body, with its headers and the time each chunk was
+ * received, so a stream can be replayed off-device with the same chunk boundaries.
+ *
+ * File format:
+ *
+ *   "RADIIU-CAPTURE 1\n"
+ *   URL line
+ *   "name: value\n" header lines, names in lowercase
+ *   "\n"
+ *   chunks: time in microseconds (u64), size (u32), data
+ *
+ * The numbers are little-endian, so captures from the console can be read on a PC.
+ */
+namespace stream_capture {
+
+    struct error : std::runtime_error {
+
+        error(const std::string& msg);
+
+    }; // struct error
+
+
+    struct header {
+
+        std::string url;
+        std::vector<std::pair<std::string, std::string>> fields;
+
+        // Case-insensitive.
+        [[nodiscard]]
+        std::optional<std::string>
+        get(std::string_view name)
+            const;
+
+    }; // struct header
+
+
+    struct chunk {
+        std::chrono::microseconds time{};
+        std::vector<char> data;
+    };
+
+
+    class writer {
+
+        std::ofstream out;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+
+        // Throws stream_capture::error.
+        writer(const std::filesystem::path& path,
+               const header& hdr);
+
+        void
+        write(std::span<const char> data);
+
+    }; // class writer
+
+
+    class reader {
+
+        std::ifstream in;
+        header hdr;
+
+    public:
+
+        // Throws stream_capture::error.
+        reader(const std::filesystem::path& path);
+
+        [[nodiscard]]
+        const header&
+        get_header()
+            const noexcept;
+
+        // Reuses out's buffer. Returns false at the end; throws on a truncated chunk.
+        bool
+        next(chunk& out);
+
+    }; // class reader
+
+
+    /*
+     * Hands out the chunks when their time comes.
+     *
+     * speed scales the recorded timing: 2 plays twice as fast, 0 as fast as possible.
+     */
+    class player {
+
+        reader rd;
+        double speed;
+        std::chrono::steady_clock::time_point start;
+        chunk pending;
+        bool has_pending = false;
+
+    public:
+
+        player(const std::filesystem::path& path,
+               double speed);
+
+        [[nodiscard]]
+        const header&
+        get_header()
+            const noexcept;
+
+        // Call func(data) for every chunk that is due; at speed 0, for one chunk.
+        template<typename F>
+        void
+        deliver(F&& func)
+        {
+            while (has_pending && time_until_next() <= std::chrono::milliseconds::zero()) {
+                func(std::span<const char>{pending.data});
+                has_pending = rd.next(pending);
+                // Note: every chunk is due at speed 0; the caller must get to decode it.
+                if (speed == 0)
+                    break;
+            }
+        }
+
+        // Zero when a chunk is due, or at the end.
+        [[nodiscard]]
+        std::chrono::milliseconds
+        time_until_next()
+            const;
+
+        [[nodiscard]]
+        bool
+        finished()
+            const noexcept;
+
+    }; // class player
+
+} // namespace stream_capture
+
+#endif
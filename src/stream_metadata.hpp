@@ -30,6 +30,9 @@ struct stream_metadata {
     void
     merge(const stream_metadata& other);
 
+    bool
+    operator ==(const stream_metadata& other) const = default;
+
 }; // struct stream_metadata
 
 
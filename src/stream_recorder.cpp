@@ -0,0 +1,246 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // min()
+#include <chrono>
+#include <ctime>                // localtime_r(), strftime()
+#include <fstream>
+#include <string_view>
+#include <thread>
+
+#include "stream_recorder.hpp"
+
+#include "logging.hpp"
+#include "thread_policy.hpp"
+#include "tracer.hpp"
+
+
+using namespace std::literals;
+
+
+namespace {
+
+    // Every write to the file is this big, except the last one of each file.
+    const std::size_t batch_size = 64 * 1024;
+
+    // How much can wait for the writer, before data is dropped.
+    const std::size_t max_queued_bytes = 4 * 1024 * 1024;
+
+    // Titles are cut to this many bytes, to stay well under filename limits.
+    const std::size_t max_title_size = 120;
+
+
+    // How many writer threads haven't finished yet.
+    std::atomic<unsigned> active_writers = 0;
+
+
+    // Replace characters that FAT32 doesn't allow.
+    std::string
+    sanitize(std::string_view name)
+    {
+        std::string result;
+        result.reserve(name.size());
+        for (char c : name) {
+            if (static_cast<unsigned char>(c) < 0x20 || "\\/:*?\"<>|"sv.contains(c))
+                result += '_';
+            else
+                result += c;
+        }
+        return result;
+    }
+
+
+    std::string
+    timestamp()
+    {
+        const std::time_t now = std::chrono::system_clock::to_time_t(
+                                    std::chrono::system_clock::now());
+        std::tm local{};
+        localtime_r(&now, &local);
+        char buf[32];
+        std::strftime(buf, sizeof buf, "%Y-%m-%d %H.%M.%S", &local);
+        return buf;
+    }
+
+} // namespace
+
+
+stream_recorder::stream_recorder(const std::filesystem::path& dir,
+                                 const std::string& station_name) :
+    station_name{sanitize(station_name)},
+    state{std::make_shared<shared_state>(dir)}
+{
+    current.data.reserve(batch_size);
+    ++active_writers;
+    try {
+        std::thread{writer_func, state}.detach();
+    }
+    catch (...) {
+        --active_writers;
+        throw;
+    }
+}
+
+
+stream_recorder::~stream_recorder()
+    noexcept
+{
+    try {
+        // Note: the last batch bypasses the limit, the writer must see it.
+        current.last = true;
+        state->queued_bytes += current.data.size();
+        state->queue.push(std::move(current));
+    }
+    catch (std::exception& e) {
+        LOG(error) << "stream_recorder::~stream_recorder(): " << e.what();
+        // Note: the writer must still exit, or wait_all() would never return.
+        state->queue.stop();
+    }
+}
+
+
+void
+stream_recorder::start_file(const std::string& title,
+                            const std::string& extension)
+{
+    if (!current.data.empty())
+        submit();
+
+    std::string name = station_name + " " + timestamp();
+    if (!title.empty())
+        name += " - " + sanitize(std::string_view{title}.substr(0, max_title_size));
+    current.new_file = state->dir / (name + "." + extension);
+    has_file = true;
+}
+
+
+void
+stream_recorder::write(std::span<const std::byte> data)
+{
+    if (!has_file)
+        return;
+
+    while (!data.empty()) {
+        const std::size_t n = std::min(data.size(), batch_size - current.data.size());
+        current.data.insert(current.data.end(), data.begin(), data.begin() + n);
+        data = data.subspan(n);
+        if (current.data.size() == batch_size)
+            submit();
+    }
+}
+
+
+stream_recorder::stats
+stream_recorder::get_stats()
+    const noexcept
+{
+    return {
+        .written = state->written.load(),
+        .dropped = state->dropped.load(),
+        .files = state->files.load(),
+        .errors = state->errors.load(),
+    };
+}
+
+
+const std::filesystem::path&
+stream_recorder::get_dir()
+    const noexcept
+{
+    return state->dir;
+}
+
+
+void
+stream_recorder::wait_all()
+    noexcept
+{
+    for (unsigned n = active_writers.load(); n; n = active_writers.load())
+        active_writers.wait(n);
+}
+
+
+void
+stream_recorder::submit()
+{
+    const std::size_t size = current.data.size();
+    if (state->queued_bytes.load() + size > max_queued_bytes) {
+        state->dropped += size;
+        current.data.clear();
+        // Note: a new file is still opened, so the next track doesn't end up in this one.
+        if (current.new_file.empty())
+            return;
+    }
+
+    state->queued_bytes += current.data.size();
+    state->queue.push(std::move(current));
+    current = {};
+    current.data.reserve(batch_size);
+}
+
+
+void
+stream_recorder::writer_func(std::shared_ptr<shared_state> state)
+{
+    tracer::set_thread_name("recorder");
+    thread_policy::apply(thread_policy::role::background);
+
+    std::ofstream out;
+    std::filesystem::path out_path;
+    std::vector<batch> batches;
+    bool done = false;
+
+    auto fail = [&](const char* what)
+    {
+        ++state->errors;
+        LOG(error) << "stream_recorder: could not " << what << " " << out_path;
+        out.close();
+    };
+
+    while (!done) {
+        batches.clear();
+        try {
+            batches.push_back(state->queue.pop());
+        }
+        catch (async_queue_error) {
+            // Note: the destructor couldn't queue the last batch.
+            break;
+        }
+        state->queue.pop_all(batches);
+
+        TRACE("stream_recorder::write");
+        for (auto& b : batches) {
+            if (!b.new_file.empty()) {
+                out.close();
+                out_path = std::move(b.new_file);
+                std::error_code ec;
+                std::filesystem::create_directories(state->dir, ec);
+                // Note: unbuffered, so every batch is a single big write.
+                out.rdbuf()->pubsetbuf(nullptr, 0);
+                out.open(out_path, std::ios::binary);
+                if (out)
+                    ++state->files;
+                else
+                    fail("create");
+            }
+            if (!b.data.empty() && out.is_open()) {
+                out.write(reinterpret_cast<const char*>(b.data.data()), b.data.size());
+                if (out)
+                    state->written += b.data.size();
+                else
+                    fail("write");
+            }
+            state->queued_bytes -= b.data.size();
+            done |= b.last;
+        }
+    }
+
+    out.close();
+    state.reset();
+    --active_writers;
+    active_writers.notify_all();
+}
@@ -0,0 +1,132 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef STREAM_RECORDER_HPP
+#define STREAM_RECORDER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "async_queue.hpp"
+
+
+/*
+ * Records the compressed audio of a stream, as it came from the server (minus the ICY
+ * metadata), into one file per track.
+ *
+ * The producer (the decode thread) fills fixed-size batches and queues them; a writer
+ * thread takes everything queued at once, and writes each batch with a single call, so a
+ * slow SD card or USB drive never holds up decoding. When the writer falls too far
+ * behind, new data is dropped, and counted, instead of using more memory.
+ *
+ * Destroying the recorder doesn't wait for the writer: it queues a last batch, and the
+ * writer exits on its own once that's written. If that batch can't be queued, the queue
+ * is stopped instead, and what's still queued is lost.
+ *
+ * Files are named after the station, the time the track started, and its title:
+ *
+ *     "Station Name 2026-10-15 21.04.33 - Artist - Title.mp3"
+ */
+class stream_recorder {
+
+public:
+
+    struct stats {
+        std::uint64_t written = 0; // bytes
+        std::uint64_t dropped = 0; // bytes
+        unsigned files = 0;
+        unsigned errors = 0;
+    };
+
+
+    stream_recorder(const std::filesystem::path& dir,
+                    const std::string& station_name);
+
+    // Doesn't block: the writer finishes everything queued in the background.
+    ~stream_recorder()
+        noexcept;
+
+    // disallow moving
+    stream_recorder(stream_recorder&&) = delete;
+
+
+    // Producer: end the current file; what's written next goes into a new one.
+    void
+    start_file(const std::string& title,
+               const std::string& extension);
+
+    // Producer: ignored until the first start_file().
+    void
+    write(std::span<const std::byte> data);
+
+
+    [[nodiscard]]
+    stats
+    get_stats()
+        const noexcept;
+
+    [[nodiscard]]
+    const std::filesystem::path&
+    get_dir()
+        const noexcept;
+
+
+    // Waits until the writers of all destroyed recorders are done.
+    static
+    void
+    wait_all()
+        noexcept;
+
+
+private:
+
+    struct batch {
+        // When not empty, the writer opens this file before writing data.
+        std::filesystem::path new_file;
+        std::vector<std::byte> data;
+        bool last = false;
+    };
+
+    // Note: the writer thread holds a reference to this, so it can outlive the recorder.
+    struct shared_state {
+        const std::filesystem::path dir;
+
+        async_queue<batch> queue;
+        std::atomic<std::size_t> queued_bytes = 0;
+
+        std::atomic<std::uint64_t> written = 0;
+        std::atomic<std::uint64_t> dropped = 0;
+        std::atomic<unsigned> files = 0;
+        std::atomic<unsigned> errors = 0;
+    };
+
+    const std::string station_name;
+
+    // Note: only the producer touches these.
+    batch current;
+    bool has_file = false;
+
+    std::shared_ptr<shared_state> state;
+
+
+    // Queue the current batch, unless the writer is too far behind.
+    void
+    submit();
+
+    static
+    void
+    writer_func(std::shared_ptr<shared_state> state);
+
+}; // class stream_recorder
+
+#endif
@@ -324,4 +324,16 @@ namespace string_utils {
         return std::string{start, finish};
     }
 
+
+    std::string_view
+    trimmed_view(std::string_view input,
+                 std::string_view discard)
+    {
+        auto start = input.find_first_not_of(discard);
+        if (start == std::string_view::npos)
+            return {};
+        auto finish = input.find_last_not_of(discard);
+        return input.substr(start, finish - start + 1);
+    }
+
 } // namespace string_utils
@@ -134,6 +134,13 @@ namespace string_utils {
         });
     }
 
+
+    // Like trimmed(), but doesn't allocate; the result points into input.
+    [[nodiscard]]
+    std::string_view
+    trimmed_view(std::string_view input,
+                 std::string_view discard = " \t\n\v\f\r");
+
 } // namespace string_utils
 
 #endif
@@ -0,0 +1,86 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <cstdint>
+#include <iostream>
+
+#ifdef __WIIU__
+#include <coreinit/thread.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <cstring>              // strerror()
+#include <sys/resource.h>
+#include <unistd.h>             // gettid()
+#endif
+
+#include "thread_policy.hpp"
+
+
+using std::cout;
+using std::endl;
+
+
+namespace thread_policy {
+
+    namespace {
+
+        struct settings {
+            std::uint32_t affinity; // Wii U cores
+            int priority;           // Wii U: 0 is the highest, 31 the lowest
+            int niceness;           // desktop
+        };
+
+
+        settings
+        get_settings(role r)
+            noexcept
+        {
+#ifdef __WIIU__
+            const std::uint32_t core0 = OS_THREAD_ATTRIB_AFFINITY_CPU0;
+            const std::uint32_t core1 = OS_THREAD_ATTRIB_AFFINITY_CPU1;
+            const std::uint32_t core2 = OS_THREAD_ATTRIB_AFFINITY_CPU2;
+#else
+            const std::uint32_t core0 = 1, core1 = 2, core2 = 4;
+#endif
+            switch (r) {
+                case role::ui:
+                    return {core1, 16, 0};
+                case role::audio:
+                    return {core2, 10, 0};
+                case role::network:
+                    return {core0, 16, 2};
+                case role::background:
+                default:
+                    return {core0 | core2, 20, 5};
+            }
+        }
+
+    } // namespace
+
+
+    void
+    apply(role r)
+        noexcept
+    {
+        [[maybe_unused]] const settings s = get_settings(r);
+#ifdef __WIIU__
+        OSThread* self = OSGetCurrentThread();
+        if (!OSSetThreadAffinity(self, s.affinity))
+            cout << "WARNING: thread_policy::apply(): OSSetThreadAffinity() failed" << endl;
+        if (!OSSetThreadPriority(self, s.priority))
+            cout << "WARNING: thread_policy::apply(): OSSetThreadPriority() failed" << endl;
+        // Note: the new affinity takes effect when the thread is scheduled again.
+        OSYieldThread();
+#elif defined(__linux__)
+        // Note: on Linux, niceness is per thread.
+        if (s.niceness && setpriority(PRIO_PROCESS, gettid(), s.niceness))
+            cout << "WARNING: thread_policy::apply(): setpriority() failed: "
+                 << std::strerror(errno) << endl;
+#endif
+    }
+
+} // namespace thread_policy
@@ -0,0 +1,40 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef THREAD_POLICY_HPP
+#define THREAD_POLICY_HPP
+
+
+/*
+ * Where each kind of thread runs, and how urgent it is.
+ *
+ * On the Wii U, the UI owns core 1 (the main core), audio decoding gets core 2 with a
+ * higher priority than anything else, network loops run on core 0, and background work
+ * can use cores 0 and 2, below everything else. So a busy UI frame can't delay the audio,
+ * and neither can a burst of icon decoding.
+ *
+ * On desktop, the OS decides where threads run; network and background threads are only
+ * made nicer, since raising a priority needs privileges.
+ */
+namespace thread_policy {
+
+    enum class role {
+        ui,
+        audio,
+        network,
+        background,
+    };
+
+
+    // Applies the role's affinity and priority to the calling thread.
+    void
+    apply(role r)
+        noexcept;
+
+} // namespace thread_policy
+
+#endif
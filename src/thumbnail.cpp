@@ -0,0 +1,334 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // clamp(), max(), min()
+#include <cmath>                // ceil(), floor()
+#include <csetjmp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>               // jpeglib.h needs FILE
+#include <cstring>              // memcpy()
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <jpeglib.h>
+#include <SDL_surface.h>
+#include <sdl2xx/img.hpp>
+
+#include "thumbnail.hpp"
+
+
+using namespace std::literals;
+
+
+namespace thumbnail {
+
+    namespace {
+
+        // Tightly packed RGBA8.
+        struct image {
+            int width = 0;
+            int height = 0;
+            std::vector<std::uint8_t> pixels;
+        };
+
+
+        sdl::vec2
+        fit(int width,
+            int height,
+            int max_size)
+            noexcept
+        {
+            sdl::vec2 result;
+            result.x = width;
+            result.y = height;
+            if (width <= max_size && height <= max_size)
+                return result;
+            if (width > height) {
+                result.x = max_size;
+                result.y = std::max(1, max_size * height / width);
+            } else {
+                result.y = max_size;
+                result.x = std::max(1, max_size * width / height);
+            }
+            return result;
+        }
+
+
+        bool
+        is_jpeg(std::span<const char> data)
+            noexcept
+        {
+            return data.size() > 3
+                && static_cast<unsigned char>(data[0]) == 0xff
+                && static_cast<unsigned char>(data[1]) == 0xd8
+                && static_cast<unsigned char>(data[2]) == 0xff;
+        }
+
+
+        struct jpeg_failure {
+            jpeg_error_mgr mgr;
+            std::jmp_buf jump;
+        };
+
+
+        [[noreturn]]
+        void
+        on_jpeg_error(j_common_ptr cinfo)
+        {
+            auto failure = reinterpret_cast<jpeg_failure*>(cinfo->err);
+            std::longjmp(failure->jump, 1);
+        }
+
+
+        void
+        ignore_jpeg_message(j_common_ptr)
+        {}
+
+
+        /*
+         * Note: libjpeg reports errors with longjmp(), so nothing with a destructor can be
+         * created in this function after setjmp().
+         */
+        bool
+        decode_jpeg_into(jpeg_decompress_struct& cinfo,
+                         jpeg_failure& failure,
+                         std::span<const char> data,
+                         int max_size,
+                         image& out,
+                         std::vector<std::uint8_t>& row)
+        {
+            if (setjmp(failure.jump))
+                return false;
+
+            jpeg_mem_src(&cinfo,
+                         reinterpret_cast<const unsigned char*>(data.data()),
+                         data.size());
+            jpeg_read_header(&cinfo, TRUE);
+            cinfo.out_color_space = JCS_RGB;
+
+            // Pick the smallest scale that doesn't go below the thumbnail size.
+            const sdl::vec2 target = fit(cinfo.image_width, cinfo.image_height, max_size);
+            cinfo.scale_num = 1;
+            cinfo.scale_denom = 1;
+            for (unsigned denom = 8; denom > 1; denom /= 2)
+                if ((cinfo.image_width + denom - 1) / denom >= unsigned(target.x)
+                    && (cinfo.image_height + denom - 1) / denom >= unsigned(target.y)) {
+                    cinfo.scale_denom = denom;
+                    break;
+                }
+
+            jpeg_start_decompress(&cinfo);
+            if (cinfo.output_components != 3)
+                return false;
+
+            out.width = cinfo.output_width;
+            out.height = cinfo.output_height;
+            out.pixels.resize(std::size_t(out.width) * out.height * 4);
+            row.resize(std::size_t(out.width) * 3);
+            while (cinfo.output_scanline < cinfo.output_height) {
+                std::uint8_t* dst = out.pixels.data()
+                                  + std::size_t(cinfo.output_scanline) * out.width * 4;
+                JSAMPROW src = row.data();
+                jpeg_read_scanlines(&cinfo, &src, 1);
+                for (int x = 0; x < out.width; ++x) {
+                    dst[x * 4 + 0] = src[x * 3 + 0];
+                    dst[x * 4 + 1] = src[x * 3 + 1];
+                    dst[x * 4 + 2] = src[x * 3 + 2];
+                    dst[x * 4 + 3] = 255;
+                }
+            }
+            jpeg_finish_decompress(&cinfo);
+            return true;
+        }
+
+
+        bool
+        decode_jpeg(std::span<const char> data,
+                    int max_size,
+                    image& out)
+        {
+            jpeg_decompress_struct cinfo;
+            jpeg_failure failure;
+            cinfo.err = jpeg_std_error(&failure.mgr);
+            failure.mgr.error_exit = on_jpeg_error;
+            failure.mgr.output_message = ignore_jpeg_message;
+            jpeg_create_decompress(&cinfo);
+            std::vector<std::uint8_t> row;
+            bool ok = decode_jpeg_into(cinfo, failure, data, max_size, out, row);
+            jpeg_destroy_decompress(&cinfo);
+            return ok;
+        }
+
+
+        image
+        decode_sdl(std::span<const char> data)
+        {
+            sdl::rwops rw{data};
+            auto img = sdl::img::load(rw);
+            SDL_Surface* s = SDL_ConvertSurfaceFormat(img.data(), SDL_PIXELFORMAT_RGBA32, 0);
+            if (!s)
+                throw std::runtime_error{"SDL_ConvertSurfaceFormat() failed: "s
+                                         + SDL_GetError()};
+            image result;
+            result.width = s->w;
+            result.height = s->h;
+            const std::size_t row_size = std::size_t(s->w) * 4;
+            result.pixels.resize(row_size * s->h);
+            SDL_LockSurface(s);
+            for (int y = 0; y < s->h; ++y)
+                std::memcpy(result.pixels.data() + y * row_size,
+                            static_cast<const char*>(s->pixels) + y * s->pitch,
+                            row_size);
+            SDL_UnlockSurface(s);
+            SDL_FreeSurface(s);
+            return result;
+        }
+
+
+        // How each output sample is made from the input samples, along one axis.
+        struct area_weights {
+            std::vector<int> first;
+            std::vector<int> count;
+            std::vector<float> weights; // count[i] weights for each output i
+        };
+
+
+        area_weights
+        make_weights(int src_size,
+                     int dst_size)
+        {
+            area_weights result;
+            result.first.reserve(dst_size);
+            result.count.reserve(dst_size);
+            const double scale = double(src_size) / dst_size;
+            for (int o = 0; o < dst_size; ++o) {
+                const double lo = o * scale;
+                const double hi = (o + 1) * scale;
+                const int i0 = static_cast<int>(std::floor(lo));
+                const int i1 = std::min(src_size, static_cast<int>(std::ceil(hi)));
+                result.first.push_back(i0);
+                result.count.push_back(i1 - i0);
+                for (int i = i0; i < i1; ++i) {
+                    const double cover = std::min(hi, i + 1.0) - std::max(lo, double(i));
+                    result.weights.push_back(static_cast<float>(cover / scale));
+                }
+            }
+            return result;
+        }
+
+
+        /*
+         * Area (box) filter, premultiplying the alpha on the way.
+         *
+         * Runs horizontally first, into a float buffer, then vertically; the vertical pass
+         * works on whole rows, so it vectorizes well.
+         */
+        image
+        resize_premultiplied(const image& src,
+                             int width,
+                             int height)
+        {
+            const auto hw = make_weights(src.width, width);
+            const auto vw = make_weights(src.height, height);
+
+            const std::size_t tmp_stride = std::size_t(width) * 4;
+            std::vector<float> tmp(tmp_stride * src.height);
+            for (int y = 0; y < src.height; ++y) {
+                const std::uint8_t* in = src.pixels.data() + std::size_t(y) * src.width * 4;
+                float* out = tmp.data() + y * tmp_stride;
+                const float* w = hw.weights.data();
+                for (int x = 0; x < width; ++x) {
+                    float acc[4] = {0, 0, 0, 0};
+                    const std::uint8_t* p = in + hw.first[x] * 4;
+                    for (int k = 0; k < hw.count[x]; ++k, p += 4, ++w) {
+                        const float a = *w * p[3] * (1.0f / 255);
+                        acc[0] += a * p[0];
+                        acc[1] += a * p[1];
+                        acc[2] += a * p[2];
+                        acc[3] += a * 255;
+                    }
+                    for (int c = 0; c < 4; ++c)
+                        out[x * 4 + c] = acc[c];
+                }
+            }
+
+            image result;
+            result.width = width;
+            result.height = height;
+            result.pixels.resize(tmp_stride * height);
+            std::vector<float> row(tmp_stride);
+            const float* w = vw.weights.data();
+            for (int y = 0; y < height; ++y) {
+                std::ranges::fill(row, 0.0f);
+                for (int k = 0; k < vw.count[y]; ++k, ++w) {
+                    const float* in = tmp.data() + (vw.first[y] + k) * tmp_stride;
+                    const float weight = *w;
+                    for (std::size_t i = 0; i < tmp_stride; ++i)
+                        row[i] += weight * in[i];
+                }
+                std::uint8_t* out = result.pixels.data() + y * tmp_stride;
+                for (std::size_t i = 0; i < tmp_stride; ++i)
+                    out[i] = static_cast<std::uint8_t>(std::clamp(row[i] + 0.5f, 0.0f, 255.0f));
+            }
+            return result;
+        }
+
+
+        void
+        premultiply(image& img)
+            noexcept
+        {
+            for (std::size_t i = 0; i < img.pixels.size(); i += 4) {
+                const unsigned a = img.pixels[i + 3];
+                for (int c = 0; c < 3; ++c)
+                    img.pixels[i + c] = (img.pixels[i + c] * a + 127) / 255;
+            }
+        }
+
+
+        sdl::surface
+        to_surface(const image& img)
+        {
+            sdl::vec2 size;
+            size.x = img.width;
+            size.y = img.height;
+            sdl::surface result;
+            result.create(size, 32, SDL_PIXELFORMAT_RGBA32);
+            SDL_Surface* s = result.data();
+            const std::size_t row_size = std::size_t(img.width) * 4;
+            SDL_LockSurface(s);
+            for (int y = 0; y < img.height; ++y)
+                std::memcpy(static_cast<char*>(s->pixels) + y * s->pitch,
+                            img.pixels.data() + y * row_size,
+                            row_size);
+            SDL_UnlockSurface(s);
+            return result;
+        }
+
+    } // namespace
+
+
+    sdl::surface
+    make(std::span<const char> data,
+         int max_size)
+    {
+        image img;
+        // Note: unusual JPEGs, like CMYK ones, are left for SDL_image.
+        if (!is_jpeg(data) || !decode_jpeg(data, max_size, img))
+            img = decode_sdl(data);
+
+        const sdl::vec2 size = fit(img.width, img.height, max_size);
+        if (size.x == img.width && size.y == img.height)
+            premultiply(img);
+        else
+            img = resize_premultiplied(img, size.x, size.y);
+        return to_surface(img);
+    }
+
+} // namespace thumbnail
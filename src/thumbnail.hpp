@@ -0,0 +1,30 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef THUMBNAIL_HPP
+#define THUMBNAIL_HPP
+
+#include <span>
+
+#include <sdl2xx/surface.hpp>
+
+
+namespace thumbnail {
+
+    /*
+     * Decode an image, shrunk to fit in max_size x max_size, as premultiplied RGBA32.
+     *
+     * JPEGs are decoded directly at a reduced scale, when possible; the rest of the
+     * shrinking uses an area filter.
+     */
+    sdl::surface
+    make(std::span<const char> data,
+         int max_size);
+
+} // namespace thumbnail
+
+#endif
@@ -0,0 +1,388 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>            // clamp(), max(), min()
+
+#include "timeshift_buffer.hpp"
+
+
+using namespace std::literals;
+
+
+namespace {
+
+    // Used until the rate can be estimated: 128 kbps.
+    const std::size_t default_byte_rate = 16'000;
+
+    // How much data is needed before trusting the estimate.
+    const auto min_estimate_period = 10s;
+
+} // namespace
+
+
+std::size_t
+timeshift_buffer::get_capacity()
+    const noexcept
+{
+    const std::size_t bytes = get_byte_rate() * max_duration.count();
+    // Note: keep at least two blocks, so the cursor isn't pushed around constantly.
+    return std::max(bytes, 2 * block_size);
+}
+
+
+void
+timeshift_buffer::drop_front()
+{
+    const std::uint64_t next_begin = begin_pos + blocks.front().size();
+    if (read_pos < next_begin) {
+        dropped_unread += next_begin - read_pos;
+        read_pos = next_begin;
+    }
+    spare = std::move(blocks.front());
+    spare.clear();
+    blocks.pop_front();
+    begin_pos = next_begin;
+}
+
+
+void
+timeshift_buffer::set_max_duration(std::chrono::seconds duration)
+    noexcept
+{
+    max_duration = duration;
+}
+
+
+std::chrono::seconds
+timeshift_buffer::get_max_duration()
+    const noexcept
+{
+    return max_duration;
+}
+
+
+bool
+timeshift_buffer::is_enabled()
+    const noexcept
+{
+    return max_duration > 0s;
+}
+
+
+void
+timeshift_buffer::set_bitrate(unsigned kbps)
+    noexcept
+{
+    bitrate = kbps;
+}
+
+
+std::size_t
+timeshift_buffer::get_byte_rate()
+    const noexcept
+{
+    if (bitrate)
+        return bitrate * 1000 / 8;
+
+    if (first_write_pos == end_pos)
+        return default_byte_rate;
+    const auto elapsed = std::chrono::steady_clock::now() - first_write;
+    if (elapsed < min_estimate_period)
+        return default_byte_rate;
+    // Note: includes the initial burst from the server, so it starts a little high.
+    using std::chrono::milliseconds;
+    const auto ms = std::chrono::duration_cast<milliseconds>(elapsed).count();
+    return std::max<std::size_t>(1, (end_pos - first_write_pos) * 1000 / ms);
+}
+
+
+void
+timeshift_buffer::write(std::span<const std::byte> data)
+{
+    if (data.empty())
+        return;
+
+    if (first_write == std::chrono::steady_clock::time_point{})
+        first_write = std::chrono::steady_clock::now();
+
+    while (!data.empty()) {
+        if (blocks.empty() || blocks.back().size() == block_size) {
+            blocks.push_back(std::move(spare));
+            spare = block_type{memory_accounting::tag::timeshift};
+            blocks.back().reserve(block_size);
+        }
+        auto& block = blocks.back();
+        const std::size_t n = std::min(data.size(), block_size - block.size());
+        block.insert(block.end(), data.begin(), data.begin() + n);
+        data = data.subspan(n);
+        end_pos += n;
+    }
+
+    const std::size_t capacity = get_capacity();
+    while (blocks.size() > 1 && size() - blocks.front().size() >= capacity)
+        drop_front();
+}
+
+
+void
+timeshift_buffer::write(byte_stream& src)
+{
+    for (auto span : src.readable_spans())
+        write(span);
+    src.clear();
+}
+
+
+std::span<const std::byte>
+timeshift_buffer::peek(std::size_t max_size)
+    const noexcept
+{
+    return peek_ahead(0, max_size);
+}
+
+
+std::span<const std::byte>
+timeshift_buffer::peek_ahead(std::size_t skip,
+                             std::size_t max_size)
+    const noexcept
+{
+    if (skip >= unread())
+        return {};
+    const std::uint64_t offset = read_pos + skip - begin_pos;
+    const auto& block = blocks[offset / block_size];
+    const std::size_t start = offset % block_size;
+    const std::size_t n = std::min(max_size, block.size() - start);
+    return {block.data() + start, n};
+}
+
+
+void
+timeshift_buffer::commit_read(std::size_t count)
+    noexcept
+{
+    read_pos = std::min<std::uint64_t>(read_pos + count, end_pos);
+}
+
+
+std::size_t
+timeshift_buffer::unread()
+    const noexcept
+{
+    return end_pos - read_pos;
+}
+
+
+std::size_t
+timeshift_buffer::size()
+    const noexcept
+{
+    return end_pos - begin_pos;
+}
+
+
+std::uint64_t
+timeshift_buffer::get_begin_pos()
+    const noexcept
+{
+    return begin_pos;
+}
+
+
+std::uint64_t
+timeshift_buffer::get_read_pos()
+    const noexcept
+{
+    return read_pos;
+}
+
+
+std::uint64_t
+timeshift_buffer::get_end_pos()
+    const noexcept
+{
+    return end_pos;
+}
+
+
+std::chrono::seconds
+timeshift_buffer::get_delay()
+    const noexcept
+{
+    return std::chrono::seconds(unread() / get_byte_rate());
+}
+
+
+std::chrono::seconds
+timeshift_buffer::get_length()
+    const noexcept
+{
+    return std::chrono::seconds(size() / get_byte_rate());
+}
+
+
+std::uint64_t
+timeshift_buffer::get_dropped_unread()
+    const noexcept
+{
+    return dropped_unread;
+}
+
+
+void
+timeshift_buffer::seek(std::chrono::seconds delta)
+    noexcept
+{
+    const std::int64_t bytes = static_cast<std::int64_t>(get_byte_rate()) * delta.count();
+    const std::int64_t target = static_cast<std::int64_t>(read_pos) + bytes;
+    read_pos = std::clamp<std::int64_t>(target, begin_pos, end_pos);
+}
+
+
+void
+timeshift_buffer::go_live()
+    noexcept
+{
+    read_pos = end_pos;
+}
+
+
+void
+timeshift_buffer::clear()
+    noexcept
+{
+    blocks.clear();
+    spare = block_type{memory_accounting::tag::timeshift};
+    begin_pos = read_pos = end_pos;
+    first_write = {};
+    first_write_pos = end_pos;
+}
+
+
+#ifdef UNIT_TEST
+
+// compilation: g++ -std=c++23 -DUNIT_TEST timeshift_buffer.cpp
+
+#include "byte_stream.cpp"
+#include "memory_accounting.cpp"
+
+#include <iostream>
+#include <vector>
+
+#include "unit_test.hpp"
+
+using std::cout;
+using std::endl;
+
+
+// Writes count bytes, in chunks, continuing the sequence from next.
+void
+write_sequence(timeshift_buffer& ts,
+               std::uint64_t& next,
+               std::size_t count,
+               std::size_t chunk)
+{
+    std::vector<std::byte> data(chunk);
+    for (std::size_t done = 0; done < count; done += chunk) {
+        for (auto& b : data)
+            b = std::byte(next++ & 0xff);
+        ts.write(data);
+    }
+}
+
+
+// Reads everything unread; returns how many bytes didn't match the sequence.
+std::size_t
+read_sequence(timeshift_buffer& ts,
+              std::uint64_t end)
+{
+    std::uint64_t pos = end - ts.unread();
+    std::size_t mismatches = 0;
+    while (ts.unread()) {
+        auto data = ts.peek(4096);
+        for (auto b : data)
+            if (b != std::byte(pos++ & 0xff))
+                ++mismatches;
+        ts.commit_read(data.size());
+    }
+    return mismatches;
+}
+
+
+int main()
+{
+    int total = 0;
+    int successes = 0;
+
+    // 128 kbps is 16000 bytes/s, so 10 s keeps 160000 bytes, over three 64 KiB blocks.
+    const std::size_t capacity = 160'000;
+    const std::size_t block = 64 * 1024;
+
+    {
+        cout << "Test: wraparound" << endl;
+        timeshift_buffer ts;
+        ts.set_max_duration(10s);
+        ts.set_bitrate(128);
+        std::uint64_t next = 0;
+        write_sequence(ts, next, 1'000'000, 1000);
+        CHECK_EQUAL(ts.size() >= capacity, true);
+        CHECK_EQUAL(ts.size() < capacity + block, true);
+        CHECK_EQUAL(ts.unread(), ts.size());
+        CHECK_EQUAL(ts.get_dropped_unread(), next - ts.unread());
+        CHECK_EQUAL(read_sequence(ts, next), 0u);
+        CHECK_EQUAL(ts.unread(), 0u);
+
+        // Blocks are reused after being dropped.
+        write_sequence(ts, next, 500'000, 777);
+        CHECK_EQUAL(read_sequence(ts, next), 0u);
+    }
+
+    {
+        cout << "Test: seek clamping" << endl;
+        timeshift_buffer ts;
+        ts.set_max_duration(10s);
+        ts.set_bitrate(128);
+        std::uint64_t next = 0;
+        write_sequence(ts, next, 400'000, 1000);
+        CHECK_EQUAL(read_sequence(ts, next), 0u);
+
+        ts.seek(-5s);
+        CHECK_EQUAL(ts.unread(), 80'000u);
+        CHECK_EQUAL(ts.get_delay(), 5s);
+
+        ts.seek(-100s);
+        CHECK_EQUAL(ts.unread(), ts.size());
+        CHECK_EQUAL(read_sequence(ts, next), 0u);
+
+        ts.seek(-3s);
+        ts.seek(100s);
+        CHECK_EQUAL(ts.unread(), 0u);
+
+        ts.seek(-2s);
+        ts.go_live();
+        CHECK_EQUAL(ts.unread(), 0u);
+    }
+
+    {
+        cout << "Test: clear" << endl;
+        timeshift_buffer ts;
+        ts.set_max_duration(10s);
+        ts.set_bitrate(128);
+        std::uint64_t next = 0;
+        write_sequence(ts, next, 10'000, 1000);
+        ts.clear();
+        CHECK_EQUAL(ts.size(), 0u);
+        ts.seek(-10s);
+        CHECK_EQUAL(ts.unread(), 0u);
+        write_sequence(ts, next, 3000, 1000);
+        CHECK_EQUAL(ts.unread(), 3000u);
+        CHECK_EQUAL(read_sequence(ts, next), 0u);
+    }
+
+    cout << "Successes: " << successes << " / " << total << endl;
+}
+
+#endif // UNIT_TEST
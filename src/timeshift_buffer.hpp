@@ -0,0 +1,190 @@
+/*
+ * RadiiU - an internet radio player for the Wii U.
+ *
+ * Copyright (C) 2026  Daniel K. O. <dkosmari>
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef TIMESHIFT_BUFFER_HPP
+#define TIMESHIFT_BUFFER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+#include "byte_stream.hpp"
+#include "memory_accounting.hpp"
+
+
+/*
+ * The last few minutes of a stream's compressed audio, after the ICY metadata was
+ * stripped.
+ *
+ * The network writes at the live end, the decoder reads from a cursor that can be moved
+ * back (rewind) or forward (catch up). When the buffer is full, the oldest data is
+ * dropped; if the cursor was there, it's pushed forward.
+ *
+ * Positions are absolute byte offsets into the stream, so they never have to be adjusted
+ * when old blocks are dropped. Seeking lands anywhere, not on a frame boundary; the
+ * decoders already resynchronize after a gap.
+ *
+ * Not thread-safe; it belongs to the decode thread.
+ */
+class timeshift_buffer {
+
+    using block_type = std::vector<std::byte, memory_accounting::allocator<std::byte>>;
+
+    // Note: memory grows one block at a time, so a short session never allocates it all.
+    static constexpr std::size_t block_size = 64 * 1024;
+
+    // All blocks are full, except the last one.
+    std::deque<block_type> blocks;
+    // The last dropped block, reused for the next one.
+    block_type spare{memory_accounting::tag::timeshift};
+
+    std::uint64_t begin_pos = 0;  // offset of blocks.front()
+    std::uint64_t end_pos = 0;    // live end
+    std::uint64_t read_pos = 0;
+
+    std::chrono::seconds max_duration{};
+    unsigned bitrate = 0;         // kbps
+    std::uint64_t dropped_unread = 0;
+
+    // To estimate the byte rate, when the bitrate is unknown.
+    std::chrono::steady_clock::time_point first_write;
+    std::uint64_t first_write_pos = 0;
+
+
+    [[nodiscard]]
+    std::size_t
+    get_capacity()
+        const noexcept;
+
+    void
+    drop_front();
+
+public:
+
+    // How long to keep; zero disables it, but what's still unread can be read.
+    void
+    set_max_duration(std::chrono::seconds duration)
+        noexcept;
+
+    [[nodiscard]]
+    std::chrono::seconds
+    get_max_duration()
+        const noexcept;
+
+    [[nodiscard]]
+    bool
+    is_enabled()
+        const noexcept;
+
+
+    // The nominal bitrate, in kbps; zero means it's estimated from the data received.
+    void
+    set_bitrate(unsigned kbps)
+        noexcept;
+
+    // Compressed bytes per second.
+    [[nodiscard]]
+    std::size_t
+    get_byte_rate()
+        const noexcept;
+
+
+    void
+    write(std::span<const std::byte> data);
+
+    // Takes all of src, leaving it empty.
+    void
+    write(byte_stream& src);
+
+
+    // Contiguous data at the cursor, at most max_size bytes; empty when caught up.
+    [[nodiscard]]
+    std::span<const std::byte>
+    peek(std::size_t max_size)
+        const noexcept;
+
+    // Like peek(), but skip bytes after the cursor.
+    [[nodiscard]]
+    std::span<const std::byte>
+    peek_ahead(std::size_t skip,
+               std::size_t max_size)
+        const noexcept;
+
+    void
+    commit_read(std::size_t count)
+        noexcept;
+
+
+    // Bytes between the cursor and the live end.
+    [[nodiscard]]
+    std::size_t
+    unread()
+        const noexcept;
+
+    // Bytes kept, both before and after the cursor.
+    [[nodiscard]]
+    std::size_t
+    size()
+        const noexcept;
+
+
+    // Absolute offsets of the oldest data, the cursor, and the live end.
+    [[nodiscard]]
+    std::uint64_t
+    get_begin_pos()
+        const noexcept;
+
+    [[nodiscard]]
+    std::uint64_t
+    get_read_pos()
+        const noexcept;
+
+    [[nodiscard]]
+    std::uint64_t
+    get_end_pos()
+        const noexcept;
+
+    // How far behind the live end the cursor is.
+    [[nodiscard]]
+    std::chrono::seconds
+    get_delay()
+        const noexcept;
+
+    // How far back the cursor can go.
+    [[nodiscard]]
+    std::chrono::seconds
+    get_length()
+        const noexcept;
+
+    // Bytes dropped before the cursor got to them.
+    [[nodiscard]]
+    std::uint64_t
+    get_dropped_unread()
+        const noexcept;
+
+
+    // Negative moves back; it stops at the oldest data, or at the live end.
+    void
+    seek(std::chrono::seconds delta)
+        noexcept;
+
+    void
+    go_live()
+        noexcept;
+
+
+    // Drop everything, and release the memory.
+    void
+    clear()
+        noexcept;
+
+}; // class timeshift_buffer
+
+#endif
@@ -5,39 +5,263 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
-#include <atomic>
-#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>               // snprintf()
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>              // move()
+#include <vector>
 
 #include "tracer.hpp"
 
 
-using std::cout;
-using std::endl;
+namespace tracer {
 
+    namespace detail {
 
-namespace {
+        std::atomic<bool> enabled = false;
 
-    const unsigned indent_width = 4;
+    } // namespace detail
 
-    std::atomic_uint global_level{0};
 
-} // namespace
+    namespace {
 
+        using clock = std::chrono::steady_clock;
 
-Tracer::Tracer(const std::string& name)
+        // About 1 MiB per thread on the Wii U.
+        constexpr std::size_t ring_capacity = 64 * 1024;
+
+        const clock::time_point epoch = clock::now();
+
+
+        struct event {
+            std::uint64_t time; // nanoseconds since epoch
+            const char* name;
+            char phase;         // 'B', 'E' or 'i', as in the Chrome trace format
+        };
+
+
+        /*
+         * Note: the owner thread is the only writer; the mutex is only contended while
+         * exporting, so recording stays cheap.
+         */
+        struct thread_ring {
+
+            std::mutex mutex;
+            std::vector<event> events;
+            std::size_t next = 0;
+            bool wrapped = false;
+            unsigned tid = 0;
+            std::string name;
+
+            void
+            push(const event& ev)
+                noexcept
+            {
+                std::lock_guard guard{mutex};
+                events[next] = ev;
+                if (++next == events.size()) {
+                    next = 0;
+                    wrapped = true;
+                }
+            }
+
+        }; // struct thread_ring
+
+
+        std::mutex rings_mutex;
+        // Note: shared, so the events of threads that already ended can be exported.
+        std::vector<std::shared_ptr<thread_ring>> rings;
+
+
+        // Note: the ring is only allocated when the thread records its first event.
+        thread_local std::shared_ptr<thread_ring> this_ring;
+        thread_local const char* this_thread_name = nullptr;
+
+
+        thread_ring&
+        get_ring()
+        {
+            if (!this_ring) {
+                auto ring = std::make_shared<thread_ring>();
+                ring->events.resize(ring_capacity);
+                std::lock_guard guard{rings_mutex};
+                ring->tid = rings.size() + 1;
+                if (this_thread_name)
+                    ring->name = this_thread_name;
+                else
+                    ring->name = "thread " + std::to_string(ring->tid);
+                rings.push_back(ring);
+                this_ring = std::move(ring);
+            }
+            return *this_ring;
+        }
+
+
+        void
+        record(const char* name,
+               char phase)
+            noexcept
+        try {
+            const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now()
+                                                                                 - epoch);
+            get_ring().push({static_cast<std::uint64_t>(ns.count()), name, phase});
+        }
+        catch (...) {
+            // Note: out of memory for a new ring; drop the event.
+        }
+
+
+        void
+        write_json_string(std::ostream& out,
+                          const char* str)
+        {
+            out << '"';
+            for (; *str; ++str) {
+                const unsigned char c = *str;
+                if (c == '"' || c == '\\')
+                    out << '\\' << c;
+                else if (c < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof buf, "\\u%04x", c);
+                    out << buf;
+                } else
+                    out << c;
+            }
+            out << '"';
+        }
+
+    } // namespace
+
+
+    void
+    set_enabled(bool enable)
+        noexcept
+    {
+        detail::enabled.store(enable);
+    }
+
+
+    void
+    begin(const char* name)
+        noexcept
+    {
+        record(name, 'B');
+    }
+
+
+    void
+    end(const char* name)
+        noexcept
+    {
+        record(name, 'E');
+    }
+
+
+    void
+    instant(const char* name)
+        noexcept
+    {
+        if (is_enabled())
+            record(name, 'i');
+    }
+
+
+    void
+    set_thread_name(const char* name)
+        noexcept
+    try {
+        this_thread_name = name;
+        if (this_ring) {
+            std::lock_guard guard{this_ring->mutex};
+            this_ring->name = name;
+        }
+    }
+    catch (...) {}
+
+
+    void
+    export_chrome_json(const std::filesystem::path& path)
+    {
+        std::vector<std::shared_ptr<thread_ring>> snapshot;
+        {
+            std::lock_guard guard{rings_mutex};
+            snapshot = rings;
+        }
+
+        std::ofstream out{path};
+        if (!out)
+            throw std::runtime_error{"could not create " + path.string()};
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&]
+        {
+            if (!first)
+                out << ",\n";
+            first = false;
+        };
+
+        std::vector<event> events;
+        for (auto& ring : snapshot) {
+            std::string name;
+            {
+                // Note: copy, so the thread isn't blocked while we write the file.
+                std::lock_guard guard{ring->mutex};
+                name = ring->name;
+                if (ring->wrapped) {
+                    events.assign(ring->events.begin() + ring->next, ring->events.end());
+                    events.insert(events.end(),
+                                  ring->events.begin(),
+                                  ring->events.begin() + ring->next);
+                } else
+                    events.assign(ring->events.begin(), ring->events.begin() + ring->next);
+            }
+
+            separator();
+            out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << ring->tid
+                << ",\"args\":{\"name\":";
+            write_json_string(out, name.data());
+            out << "}}";
+
+            for (auto& ev : events) {
+                separator();
+                char ts[32];
+                std::snprintf(ts, sizeof ts, "%.3f", ev.time / 1000.0);
+                out << "{\"ph\":\"" << ev.phase << "\",\"name\":";
+                write_json_string(out, ev.name);
+                out << ",\"ts\":" << ts << ",\"pid\":1,\"tid\":" << ring->tid;
+                if (ev.phase == 'i')
+                    out << ",\"s\":\"t\"";
+                out << "}";
+            }
+        }
+
+        out << "\n]}\n";
+        if (!out)
+            throw std::runtime_error{"could not write " + path.string()};
+    }
+
+} // namespace tracer
+
+
+Tracer::Tracer(const char* name)
     noexcept :
-    level{global_level++},
-    name{name}
+    name{name},
+    active{tracer::is_enabled()}
 {
-    std::string indent(indent_width * level, ' ');
-    cout << indent << ">>> " << name << endl;
+    if (active)
+        tracer::begin(name);
 }
 
 
 Tracer::~Tracer()
     noexcept
 {
-    std::string indent(indent_width * level, ' ');
-    cout << indent << "<<< " << name << endl;
-    --global_level;
+    if (active)
+        tracer::end(name);
 }
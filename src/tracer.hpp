@@ -8,27 +8,105 @@
 #ifndef TRACER_HPP
 #define TRACER_HPP
 
-#include <string>
+#include <atomic>
+#include <filesystem>
+
+
+/*
+ * Event tracer.
+ *
+ * Each thread records begin/end events into its own ring buffer, with monotonic
+ * timestamps; when a ring is full, the oldest events are overwritten. Nothing is printed:
+ * the rings are exported as Chrome trace JSON, that chrome://tracing and Perfetto show on a
+ * single timeline.
+ *
+ * Recording is off by default; then each TRACE_FUNC costs one atomic load. Configuring with
+ * --disable-tracing removes the macros completely.
+ */
+namespace tracer {
+
+    namespace detail {
+
+        extern std::atomic<bool> enabled;
+
+    } // namespace detail
+
+
+    inline
+    bool
+    is_enabled()
+        noexcept
+    {
+        return detail::enabled.load(std::memory_order_relaxed);
+    }
+
+
+    void
+    set_enabled(bool enable)
+        noexcept;
+
+
+    // Note: the names are stored as pointers, they must live until the trace is exported
+    // (string literals, __PRETTY_FUNCTION__).
+
+    // Unconditional: check is_enabled() before begin(), and call end() if begin() was
+    // called, like Tracer does.
+    void
+    begin(const char* name)
+        noexcept;
+
+    void
+    end(const char* name)
+        noexcept;
+
+    // Only recorded when enabled.
+    void
+    instant(const char* name)
+        noexcept;
+
+
+    // How the calling thread is labeled in the trace.
+    void
+    set_thread_name(const char* name)
+        noexcept;
+
+
+    // Throws std::runtime_error.
+    void
+    export_chrome_json(const std::filesystem::path& path);
+
+} // namespace tracer
 
 
 struct Tracer {
 
-    unsigned level;
-    const std::string name;
+    const char* const name;
+    // Note: decided at construction, so the events stay paired if tracing is toggled.
+    const bool active;
 
-    Tracer(const std::string& name)
+    Tracer(const char* name)
         noexcept;
 
     ~Tracer()
         noexcept;
 
-}; // struct tracer
+}; // struct Tracer
 
 
 #define TRACE_MERGE(a, b) a##b
 
+#ifdef RADIIU_NO_TRACING
+
+#define TRACE_FUNC static_cast<void>(0)
+
+#define TRACE(x) static_cast<void>(0)
+
+#else
+
 #define TRACE_FUNC Tracer TRACE_MERGE(tracer_, __COUNTER__){__PRETTY_FUNCTION__}
 
 #define TRACE(x) Tracer TRACE_MERGE(tracer_, __COUNTER__){x}
 
 #endif
+
+#endif